@@ -55,6 +55,9 @@ void wi_initialize(void) {
 
     wi_address_register();
     wi_array_register();
+    wi_atomic_reference_register();
+    wi_base64_decoder_register();
+    wi_base64_encoder_register();
     
 #ifdef WI_CIPHERS
     wi_cipher_register();
@@ -73,6 +76,7 @@ void wi_initialize(void) {
     
     wi_dictionary_register();
     wi_directory_enumerator_register();
+    wi_directory_reader_register();
     
 #ifdef WI_DSA
     wi_dsa_register();
@@ -80,7 +84,10 @@ void wi_initialize(void) {
     
     wi_enumerator_register();
     wi_error_register();
+    wi_fast_lock_register();
     wi_file_register();
+    wi_file_index_register();
+    wi_filesystem_register();
     
 #ifdef WI_FILESYSTEM_EVENTS
     wi_filesystem_events_register();
@@ -88,11 +95,16 @@ void wi_initialize(void) {
     
     wi_host_register();
     wi_indexset_register();
+    wi_io_engine_register();
+    wi_json_document_register();
+    wi_json_reader_register();
+    wi_json_writer_register();
     
 #ifdef WI_PTHREADS
     wi_lock_register();
 #endif
     
+    wi_lock_profiling_register();
     wi_log_register();
     wi_null_register();
     wi_md5_register();
@@ -150,6 +162,9 @@ void wi_initialize(void) {
     wi_xml_node_register();
 #endif
 
+    wi_lock_profiling_initialize();
+    wi_fast_lock_initialize();
+
 #ifdef WI_PTHREADS
     wi_condition_lock_initialize();
     wi_lock_initialize();
@@ -164,6 +179,9 @@ void wi_initialize(void) {
     wi_string_initialize();
 
     wi_address_initialize();
+    wi_atomic_reference_initialize();
+    wi_base64_decoder_initialize();
+    wi_base64_encoder_initialize();
 
 #ifdef WI_CIPHERS
     wi_cipher_initialize();
@@ -177,6 +195,7 @@ void wi_initialize(void) {
 #endif
     
     wi_directory_enumerator_initialize();
+    wi_directory_reader_initialize();
 
 #ifdef WI_DSA
     wi_dsa_initialize();
@@ -185,6 +204,8 @@ void wi_initialize(void) {
     wi_enumerator_initialize();
     wi_error_initialize();
     wi_file_initialize();
+    wi_file_index_initialize();
+    wi_filesystem_initialize();
     
 #ifdef WI_FILESYSTEM_EVENTS
     wi_filesystem_events_initialize();
@@ -192,6 +213,10 @@ void wi_initialize(void) {
     
     wi_host_initialize();
     wi_indexset_initialize();
+    wi_io_engine_initialize();
+    wi_json_document_initialize();
+    wi_json_reader_initialize();
+    wi_json_writer_initialize();
     wi_log_initialize();
     wi_md5_initialize();
     wi_null_initialize();
@@ -297,7 +322,21 @@ wi_hash_code_t wi_hash_utf8_string(const char *s) {
         hash = (hash * 67503105) + (s[4] * 16974593) + (s[5] * 66049) + (s[6] * 257) + s[7];
     }
 
-    return hash + (hash << (length & 31));
+    hash += hash << (length & 31);
+    
+    /* Tables index buckets modulo 2^n-1, which the multiplications above do
+       not spread over, so all bits are mixed into the low ones at the end */
+#ifdef WI_32
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6B;
+    hash ^= hash >> 13;
+#else
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+#endif
+    
+    return hash;
 }
 
 
@@ -192,6 +192,9 @@ typedef struct _wi_address                  wi_address_t;
 typedef struct _wi_address                  wi_mutable_address_t;
 typedef struct _wi_array                    wi_array_t;
 typedef struct _wi_array                    wi_mutable_array_t;
+typedef struct _wi_atomic_reference         wi_atomic_reference_t;
+typedef struct _wi_base64_decoder           wi_base64_decoder_t;
+typedef struct _wi_base64_encoder           wi_base64_encoder_t;
 typedef struct _wi_cipher                   wi_cipher_t;
 typedef struct _wi_condition_lock           wi_condition_lock_t;
 typedef struct _wi_data                     wi_data_t;
@@ -202,15 +205,22 @@ typedef struct _wi_dh                       wi_dh_t;
 typedef struct _wi_dictionary               wi_dictionary_t;
 typedef struct _wi_dictionary               wi_mutable_dictionary_t;
 typedef struct _wi_directory_enumerator     wi_directory_enumerator_t;
+typedef struct _wi_directory_reader         wi_directory_reader_t;
 typedef struct _wi_dsa                      wi_dsa_t;
 typedef struct _wi_enumerator               wi_enumerator_t;
 typedef struct _wi_error                    wi_error_t;
 typedef struct _wi_file                     wi_file_t;
+typedef struct _wi_file_index               wi_file_index_t;
 typedef struct _wi_filesystem_events        wi_filesystem_events_t;
 typedef struct _wi_host                     wi_host_t;
 typedef struct _wi_indexset                 wi_indexset_t;
 typedef struct _wi_indexset                 wi_mutable_indexset_t;
+typedef struct _wi_io_engine                wi_io_engine_t;
+typedef struct _wi_json_document            wi_json_document_t;
+typedef struct _wi_json_reader              wi_json_reader_t;
+typedef struct _wi_json_writer              wi_json_writer_t;
 typedef struct _wi_lock                     wi_lock_t;
+typedef struct _wi_log_category             wi_log_category_t;
 typedef struct _wi_md5                      wi_md5_t;
 typedef struct _wi_null                     wi_null_t;
 typedef struct _wi_number                   wi_number_t;
@@ -58,11 +58,32 @@ struct _wi_enumerator_context {
 typedef struct _wi_enumerator_context       wi_enumerator_context_t;
 
 
+struct _wi_filesystem_walk_entry {
+    const char                              *name;
+    wi_uinteger_t                           name_length;
+    mode_t                                  mode;
+    uint64_t                                size;
+    wi_time_interval_t                      modification_time;
+};
+typedef struct _wi_filesystem_walk_entry    wi_filesystem_walk_entry_t;
+
+typedef void                                wi_filesystem_walk_entries_func_t(const char *, wi_filesystem_walk_entry_t *, wi_uinteger_t, void *);
+
+
+typedef wi_integer_t                        wi_archive_read_func_t(wi_runtime_instance_t *, wi_time_interval_t, void *, wi_uinteger_t);
+
+
 typedef wi_boolean_t                        wi_enumerator_func_t(wi_runtime_instance_t *, wi_enumerator_context_t *, void **);
 
 
+typedef struct _wi_lock_statistics          wi_lock_statistics_t;
+
+
 WI_EXPORT void                              wi_address_register(void);
 WI_EXPORT void                              wi_array_register(void);
+WI_EXPORT void                              wi_atomic_reference_register(void);
+WI_EXPORT void                              wi_base64_decoder_register(void);
+WI_EXPORT void                              wi_base64_encoder_register(void);
 WI_EXPORT void                              wi_cipher_register(void);
 WI_EXPORT void                              wi_condition_lock_register(void);
 WI_EXPORT void                              wi_data_register(void);
@@ -70,14 +91,23 @@ WI_EXPORT void                              wi_date_register(void);
 WI_EXPORT void                              wi_dh_register(void);
 WI_EXPORT void                              wi_dictionary_register(void);
 WI_EXPORT void                              wi_directory_enumerator_register(void);
+WI_EXPORT void                              wi_directory_reader_register(void);
 WI_EXPORT void                              wi_dsa_register(void);
 WI_EXPORT void                              wi_enumerator_register(void);
 WI_EXPORT void                              wi_error_register(void);
+WI_EXPORT void                              wi_fast_lock_register(void);
 WI_EXPORT void                              wi_file_register(void);
+WI_EXPORT void                              wi_file_index_register(void);
+WI_EXPORT void                              wi_filesystem_register(void);
 WI_EXPORT void                              wi_filesystem_events_register(void);
 WI_EXPORT void                              wi_host_register(void);
 WI_EXPORT void                              wi_indexset_register(void);
+WI_EXPORT void                              wi_io_engine_register(void);
+WI_EXPORT void                              wi_json_document_register(void);
+WI_EXPORT void                              wi_json_reader_register(void);
+WI_EXPORT void                              wi_json_writer_register(void);
 WI_EXPORT void                              wi_lock_register(void);
+WI_EXPORT void                              wi_lock_profiling_register(void);
 WI_EXPORT void                              wi_log_register(void);
 WI_EXPORT void                              wi_md5_register(void);
 WI_EXPORT void                              wi_null_register(void);
@@ -109,6 +139,9 @@ WI_EXPORT void                              wi_xml_node_register(void);
 
 WI_EXPORT void                              wi_address_initialize(void);
 WI_EXPORT void                              wi_array_initialize(void);
+WI_EXPORT void                              wi_atomic_reference_initialize(void);
+WI_EXPORT void                              wi_base64_decoder_initialize(void);
+WI_EXPORT void                              wi_base64_encoder_initialize(void);
 WI_EXPORT void                              wi_cipher_initialize(void);
 WI_EXPORT void                              wi_condition_lock_initialize(void);
 WI_EXPORT void                              wi_data_initialize(void);
@@ -116,14 +149,23 @@ WI_EXPORT void                              wi_date_initialize(void);
 WI_EXPORT void                              wi_dh_initialize(void);
 WI_EXPORT void                              wi_dictionary_initialize(void);
 WI_EXPORT void                              wi_directory_enumerator_initialize(void);
+WI_EXPORT void                              wi_directory_reader_initialize(void);
 WI_EXPORT void                              wi_dsa_initialize(void);
 WI_EXPORT void                              wi_enumerator_initialize(void);
 WI_EXPORT void                              wi_error_initialize(void);
+WI_EXPORT void                              wi_fast_lock_initialize(void);
 WI_EXPORT void                              wi_file_initialize(void);
+WI_EXPORT void                              wi_file_index_initialize(void);
+WI_EXPORT void                              wi_filesystem_initialize(void);
 WI_EXPORT void                              wi_filesystem_events_initialize(void);
 WI_EXPORT void                              wi_host_initialize(void);
 WI_EXPORT void                              wi_indexset_initialize(void);
+WI_EXPORT void                              wi_io_engine_initialize(void);
+WI_EXPORT void                              wi_json_document_initialize(void);
+WI_EXPORT void                              wi_json_reader_initialize(void);
+WI_EXPORT void                              wi_json_writer_initialize(void);
 WI_EXPORT void                              wi_lock_initialize(void);
+WI_EXPORT void                              wi_lock_profiling_initialize(void);
 WI_EXPORT void                              wi_log_initialize(void);
 WI_EXPORT void                              wi_md5_initialize(void);
 WI_EXPORT void                              wi_null_initialize(void);
@@ -162,6 +204,8 @@ WI_EXPORT wi_hash_code_t                    wi_hash_int(int);
 WI_EXPORT wi_hash_code_t                    wi_hash_double(double);
 WI_EXPORT wi_hash_code_t                    wi_hash_data(const unsigned char *, wi_uinteger_t);
 
+WI_EXPORT wi_runtime_instance_t *           wi_archive_read_instance_with_function(wi_runtime_instance_t *, wi_time_interval_t, wi_archive_read_func_t *);
+
 WI_EXPORT wi_array_callbacks_t              wi_array_callbacks(wi_array_t *);
 WI_EXPORT wi_dictionary_key_callbacks_t     wi_dictionary_key_callbacks(wi_dictionary_t *);
 WI_EXPORT wi_dictionary_value_callbacks_t   wi_dictionary_value_callbacks(wi_dictionary_t *);
@@ -171,6 +215,9 @@ WI_EXPORT wi_set_callbacks_t                wi_set_callbacks(wi_set_t *);
 WI_EXPORT void *                            wi_dh_openssl_dh(wi_dh_t *);
 #endif
 
+WI_EXPORT wi_data_t *                       wi_data_init_with_mapped_bytes(wi_data_t *, void *, wi_uinteger_t, const void *, wi_uinteger_t);
+WI_EXPORT void                              wi_mutable_data_append_bytes_no_copy(wi_mutable_data_t *, void *, wi_uinteger_t);
+
 WI_EXPORT wi_directory_enumerator_t *       wi_directory_enumerator_alloc(void);
 WI_EXPORT wi_directory_enumerator_t *       wi_directory_enumerator_init_with_path(wi_directory_enumerator_t *, wi_string_t *);
 
@@ -215,12 +262,28 @@ WI_EXPORT void                              wi_error_set_libwired_error(int);
 WI_EXPORT void                              wi_error_set_libwired_error_with_string(int, wi_string_t *);
 WI_EXPORT void                              wi_error_set_libwired_error_with_format(int, wi_string_t *, ...);
 
+WI_EXPORT wi_boolean_t                      wi_filesystem_walk_path_with_entries_callback(wi_string_t *, wi_boolean_t, wi_filesystem_walk_entries_func_t *, void *);
+WI_EXPORT wi_boolean_t                      wi_filesystem_get_walk_entry_at(int, const char *, wi_filesystem_walk_entry_t *);
+
+WI_EXPORT const char * const                wi_json_escapes[256];
+
+WI_EXPORT wi_boolean_t                      wi_json_unescape_string(const char *, const char *, char *, wi_uinteger_t *, const char **);
+WI_EXPORT wi_boolean_t                      wi_json_scan_number(const char *, const char *, const char **, wi_integer_t *, double *, wi_boolean_t *);
+WI_EXPORT int                               wi_json_compare_keys(const void *, const void *);
+
+WI_EXPORT wi_lock_statistics_t *            wi_lock_statistics_with_site(const char *, const char *, void *);
+WI_EXPORT uint64_t                          wi_lock_statistics_time(void);
+WI_EXPORT uint64_t                          wi_lock_statistics_did_lock(wi_lock_statistics_t *, void *, wi_boolean_t, uint64_t);
+WI_EXPORT void                              wi_lock_statistics_will_unlock(wi_lock_statistics_t *, uint64_t);
+
 #ifdef HAVE_OPENSSL_SSL_H
 WI_EXPORT void *                            wi_rsa_openssl_rsa(wi_rsa_t *);
 #endif
 
 WI_EXPORT void                              wi_runtime_make_immutable(wi_runtime_instance_t *);
 
+WI_EXPORT wi_string_t *                     wi_string_init_with_utf8_bytes_no_copy(wi_string_t *, char *, wi_uinteger_t, wi_uinteger_t);
+
 WI_EXPORT wi_string_t *                     wi_string_encoding_utf8_string_from_data(wi_string_encoding_t *, wi_data_t *);
 WI_EXPORT wi_string_t *                     wi_string_encoding_utf8_string_from_bytes(wi_string_encoding_t *, const char *, wi_uinteger_t);
 WI_EXPORT wi_data_t *                       wi_string_encoding_data_from_utf8_bytes(wi_string_encoding_t *, const char *, wi_uinteger_t);
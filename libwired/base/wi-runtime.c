@@ -34,7 +34,6 @@
 #include <wired/wi-file.h>
 #include <wired/wi-pool.h>
 #include <wired/wi-private.h>
-#include <wired/wi-recursive-lock.h>
 #include <wired/wi-runtime.h>
 #include <wired/wi-socket.h>
 #include <wired/wi-string.h>
@@ -66,8 +65,6 @@ static wi_boolean_t                     _wi_zombie_enabled = false;
 static wi_runtime_class_t               *_wi_runtime_class_table[_WI_RUNTIME_CLASS_TABLE_SIZE];
 static wi_uinteger_t                    _wi_runtime_class_table_count = 0;
 
-static wi_recursive_lock_t              *_wi_runtime_retain_count_lock;
-
 static wi_runtime_id_t                  _wi_runtime_null_id = WI_RUNTIME_ID_NULL;
 static wi_runtime_class_t               _wi_runtime_null_class = {
     "wi_runtime_null_class",
@@ -89,8 +86,6 @@ void wi_runtime_register(void) {
 void wi_runtime_initialize(void) {
     char    *env;
     
-    _wi_runtime_retain_count_lock = wi_recursive_lock_init(wi_recursive_lock_alloc());
-    
     env = getenv("wi_zombie_enabled");
     
     if(env) {
@@ -262,19 +257,19 @@ wi_runtime_instance_t * wi_retain(wi_runtime_instance_t *instance) {
 
     _WI_RUNTIME_ASSERT_MAGIC(instance);
     _WI_RUNTIME_ASSERT_ZOMBIE(instance);
-
-    wi_recursive_lock_lock(_wi_runtime_retain_count_lock);
-    
-    WI_RUNTIME_BASE(instance)->retain_count++;
     
-    wi_recursive_lock_unlock(_wi_runtime_retain_count_lock);
+    /* Permanent instances such as shared singletons are never counted */
+    if(WI_RUNTIME_BASE(instance)->options & WI_RUNTIME_OPTION_PERMANENT)
+        return instance;
+
+    __sync_fetch_and_add(&WI_RUNTIME_BASE(instance)->retain_count, 1);
     
     return instance;
 }
 
 
 
-uint16_t wi_retain_count(wi_runtime_instance_t *instance) {
+uint32_t wi_retain_count(wi_runtime_instance_t *instance) {
     if(!instance)
         return 0;
 
@@ -295,9 +290,10 @@ void wi_release(wi_runtime_instance_t *instance) {
     _WI_RUNTIME_ASSERT_MAGIC(instance);
     _WI_RUNTIME_ASSERT_ZOMBIE(instance);
     
-    wi_recursive_lock_lock(_wi_runtime_retain_count_lock);
+    if(WI_RUNTIME_BASE(instance)->options & WI_RUNTIME_OPTION_PERMANENT)
+        return;
     
-    if(--WI_RUNTIME_BASE(instance)->retain_count == 0) {
+    if(__sync_sub_and_fetch(&WI_RUNTIME_BASE(instance)->retain_count, 1) == 0) {
         if(_wi_zombie_enabled && WI_RUNTIME_BASE(instance)->id != wi_pool_runtime_id()) {
             WI_RUNTIME_BASE(instance)->retain_count++;
 
@@ -307,11 +303,7 @@ void wi_release(wi_runtime_instance_t *instance) {
                 wi_socket_close((wi_socket_t *) instance);
 
             WI_RUNTIME_BASE(instance)->options |= WI_RUNTIME_OPTION_ZOMBIE;
-            
-            wi_recursive_lock_unlock(_wi_runtime_retain_count_lock);
         } else {
-            wi_recursive_lock_unlock(_wi_runtime_retain_count_lock);
-            
             class = _wi_runtime_class_table[WI_RUNTIME_BASE(instance)->id];
             
             if(class->dealloc)
@@ -321,8 +313,6 @@ void wi_release(wi_runtime_instance_t *instance) {
             
             wi_free((void *) instance);
         }
-    } else {
-        wi_recursive_lock_unlock(_wi_runtime_retain_count_lock);
     }
 }
 
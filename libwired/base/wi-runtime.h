@@ -39,7 +39,8 @@ typedef uint16_t                        wi_runtime_id_t;
 enum {
     WI_RUNTIME_OPTION_ZOMBIE            = (1 << 0),
     WI_RUNTIME_OPTION_IMMUTABLE         = (1 << 1),
-    WI_RUNTIME_OPTION_MUTABLE           = (1 << 2)
+    WI_RUNTIME_OPTION_MUTABLE           = (1 << 2),
+    WI_RUNTIME_OPTION_PERMANENT         = (1 << 3)
 };
 
 
@@ -66,8 +67,8 @@ typedef struct _wi_runtime_class        wi_runtime_class_t;
 
 struct _wi_runtime_base {
     uint32_t                            magic;
+    uint32_t                            retain_count;
     wi_runtime_id_t                     id;
-    uint16_t                            retain_count;
     uint8_t                             options;
 };
 typedef struct _wi_runtime_base         wi_runtime_base_t;
@@ -87,7 +88,7 @@ WI_EXPORT wi_runtime_id_t               wi_runtime_id(wi_runtime_instance_t *);
 WI_EXPORT uint8_t                       wi_runtime_options(wi_runtime_instance_t *);
 
 WI_EXPORT wi_runtime_instance_t *       wi_retain(wi_runtime_instance_t *);
-WI_EXPORT uint16_t                      wi_retain_count(wi_runtime_instance_t *);
+WI_EXPORT uint32_t                      wi_retain_count(wi_runtime_instance_t *);
 WI_EXPORT void                          wi_release(wi_runtime_instance_t *);
 
 WI_EXPORT wi_runtime_instance_t *       wi_copy(wi_runtime_instance_t *);
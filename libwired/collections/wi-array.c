@@ -36,8 +36,8 @@
 #include <wired/wi-assert.h>
 #include <wired/wi-compat.h>
 #include <wired/wi-dictionary.h>
+#include <wired/wi-fast-lock.h>
 #include <wired/wi-indexset.h>
-#include <wired/wi-lock.h>
 #include <wired/wi-log.h>
 #include <wired/wi-plist.h>
 #include <wired/wi-pool.h>
@@ -106,6 +106,7 @@ struct _wi_array {
     _wi_array_item_t                    **item_chunks;
     wi_uinteger_t                       item_chunks_count;
     wi_uinteger_t                       item_chunks_offset;
+    wi_uinteger_t                       item_chunk_size;
 
     _wi_array_item_t                    *item_free_list;
 };
@@ -152,7 +153,7 @@ const wi_array_callbacks_t              wi_array_null_callbacks = {
 static wi_uinteger_t                    _wi_array_items_per_page;
 
 #ifndef _WI_ARRAY_USE_QSORT_R
-static wi_lock_t                        *_wi_array_sort_lock;
+static wi_fast_lock_t                   _wi_array_sort_lock = WI_FAST_LOCK_INITIALIZER;
 static wi_compare_func_t                *_wi_array_sort_function;
 #endif
 
@@ -176,10 +177,6 @@ void wi_array_register(void) {
 
 void wi_array_initialize(void) {
     _wi_array_items_per_page = wi_page_size() / sizeof(_wi_array_item_t);
-    
-#ifndef _WI_ARRAY_USE_QSORT_R
-    _wi_array_sort_lock = wi_lock_init(wi_lock_alloc());
-#endif
 }
 
 
@@ -265,7 +262,6 @@ wi_array_t * wi_array_init_with_capacity(wi_array_t *array, wi_uinteger_t capaci
 
 wi_array_t * wi_array_init_with_capacity_and_callbacks(wi_array_t *array, wi_uinteger_t capacity, wi_array_callbacks_t callbacks) {
     array->callbacks            = callbacks;
-    array->item_chunks_offset   = _wi_array_items_per_page;
     array->items_count          = WI_MAX(wi_exp2m1(wi_log2(capacity) + 1), _WI_ARRAY_MIN_COUNT);
     array->min_count            = array->items_count;
     array->items                = wi_malloc(array->items_count * sizeof(_wi_array_item_t *));
@@ -654,6 +650,16 @@ wi_boolean_t wi_array_write_to_path(wi_array_t *array, wi_string_t *path) {
 
 
 
+wi_boolean_t wi_array_write_to_path_with_format(wi_array_t *array, wi_string_t *path, wi_plist_format_t format) {
+#ifdef WI_PLIST
+    return wi_plist_write_instance_to_path_with_format(array, path, format);
+#else
+    return false;
+#endif
+}
+
+
+
 #pragma mark -
 
 wi_array_t * wi_array_by_sorting(wi_array_t *array, wi_compare_func_t *compare) {
@@ -698,13 +704,19 @@ static _wi_array_item_t * _wi_array_create_item(wi_array_t *array) {
     size_t              size;
 
     if(!array->item_free_list) {
-        if(array->item_chunks_offset == _wi_array_items_per_page) {
+        if(array->item_chunks_offset == array->item_chunk_size) {
             array->item_chunks_count++;
 
             size = array->item_chunks_count * sizeof(_wi_array_item_t *);
             array->item_chunks = wi_realloc(array->item_chunks, size);
 
-            size = _wi_array_items_per_page * sizeof(_wi_array_item_t);
+            /* Chunks start out small and double up to a page, most arrays are small */
+            if(array->item_chunk_size == 0)
+                array->item_chunk_size = WI_MIN(array->min_count, _wi_array_items_per_page);
+            else
+                array->item_chunk_size = WI_MIN(array->item_chunk_size * 2, _wi_array_items_per_page);
+
+            size = array->item_chunk_size * sizeof(_wi_array_item_t);
             array->item_chunks[array->item_chunks_count - 1] = wi_malloc(size);
 
             array->item_chunks_offset = 0;
@@ -1094,10 +1106,10 @@ void wi_mutable_array_sort(wi_array_t *array, wi_compare_func_t *compare) {
 #ifdef _WI_ARRAY_USE_QSORT_R
     qsort_r(data, array->data_count, sizeof(void *), compare, _wi_array_compare_data);
 #else
-    wi_lock_lock(_wi_array_sort_lock);
+    wi_fast_lock_lock(&_wi_array_sort_lock);
     _wi_array_sort_function = compare;
     qsort(data, array->data_count, sizeof(void *), _wi_array_compare_data);
-    wi_lock_unlock(_wi_array_sort_lock);
+    wi_fast_lock_unlock(&_wi_array_sort_lock);
 #endif
     
     for(i = 0; i < array->data_count; i++)
@@ -29,6 +29,7 @@
 
 #include <stdarg.h>
 #include <wired/wi-base.h>
+#include <wired/wi-plist.h>
 #include <wired/wi-runtime.h>
 
 #define WI_ARRAY(array, i)              wi_array_data_at_index((array), (i))
@@ -81,6 +82,7 @@ WI_EXPORT wi_array_t *                  wi_array_by_adding_data_from_array(wi_ar
 WI_EXPORT wi_array_t *                  wi_array_by_sorting(wi_array_t *, wi_compare_func_t *);
 
 WI_EXPORT wi_boolean_t                  wi_array_write_to_path(wi_array_t *, wi_string_t *);
+WI_EXPORT wi_boolean_t                  wi_array_write_to_path_with_format(wi_array_t *, wi_string_t *, wi_plist_format_t);
 
 WI_EXPORT void                          wi_mutable_array_add_data(wi_mutable_array_t *, void *);
 WI_EXPORT void                          wi_mutable_array_add_data_sorted(wi_mutable_array_t *, void *, wi_compare_func_t *);
@@ -34,7 +34,7 @@
 #include <wired/wi-array.h>
 #include <wired/wi-assert.h>
 #include <wired/wi-dictionary.h>
-#include <wired/wi-lock.h>
+#include <wired/wi-fast-lock.h>
 #include <wired/wi-macros.h>
 #include <wired/wi-plist.h>
 #include <wired/wi-pool.h>
@@ -122,6 +122,7 @@ struct _wi_dictionary {
     _wi_dictionary_bucket_t             **bucket_chunks;
     wi_uinteger_t                       bucket_chunks_count;
     wi_uinteger_t                       bucket_chunks_offset;
+    wi_uinteger_t                       bucket_chunk_size;
 
     _wi_dictionary_bucket_t             *bucket_free_list;
 };
@@ -186,7 +187,7 @@ static wi_dictionary_t                  *_wi_dictionary0;
 static wi_uinteger_t                    _wi_dictionary_buckets_per_page;
 
 #ifndef _WI_DICTIONARY_USE_QSORT_R
-static wi_lock_t                        *_wi_dictionary_sort_lock;
+static wi_fast_lock_t                   _wi_dictionary_sort_lock = WI_FAST_LOCK_INITIALIZER;
 static wi_compare_func_t                *_wi_dictionary_sort_function;
 #endif
 
@@ -211,10 +212,6 @@ void wi_dictionary_register(void) {
 void wi_dictionary_initialize(void) {
     _wi_dictionary_buckets_per_page = wi_page_size() / sizeof(_wi_dictionary_bucket_t);
 
-#ifndef _WI_DICTIONARY_USE_QSORT_R
-    _wi_dictionary_sort_lock = wi_lock_init(wi_lock_alloc());
-#endif
-    
     _wi_dictionary0 = wi_dictionary_init(wi_dictionary_alloc());
 }
 
@@ -326,7 +323,6 @@ wi_dictionary_t * wi_dictionary_init_with_capacity(wi_dictionary_t *dictionary,
 wi_dictionary_t * wi_dictionary_init_with_capacity_and_callbacks(wi_dictionary_t *dictionary, wi_uinteger_t capacity, wi_dictionary_key_callbacks_t key_callbacks, wi_dictionary_value_callbacks_t value_callbacks) {
     dictionary->key_callbacks           = key_callbacks;
     dictionary->value_callbacks         = value_callbacks;
-    dictionary->bucket_chunks_offset    = _wi_dictionary_buckets_per_page;
     dictionary->min_count               = WI_MAX(wi_exp2m1(wi_log2(capacity) + 1), _WI_DICTIONARY_MIN_COUNT);
     dictionary->buckets_count           = dictionary->min_count;
     dictionary->buckets                 = wi_malloc(dictionary->buckets_count * sizeof(_wi_dictionary_bucket_t *));
@@ -573,6 +569,25 @@ wi_array_t * wi_dictionary_all_values(wi_dictionary_t *dictionary) {
 
 
 
+void wi_dictionary_get_keys_and_data(wi_dictionary_t *dictionary, void **keys, void **data) {
+    _wi_dictionary_bucket_t     *bucket;
+    wi_uinteger_t               i, j;
+    
+    for(i = j = 0; i < dictionary->buckets_count; i++) {
+        for(bucket = dictionary->buckets[i]; bucket; bucket = bucket->next) {
+            if(keys)
+                keys[j] = bucket->key;
+            
+            if(data)
+                data[j] = bucket->data;
+            
+            j++;
+        }
+    }
+}
+
+
+
 #ifdef _WI_DICTIONARY_USE_QSORT_R
 
 static int _wi_dictionary_compare_buckets(void *context, const void *p1, const void *p2) {
@@ -616,10 +631,10 @@ wi_array_t * wi_dictionary_keys_sorted_by_value(wi_dictionary_t *dictionary, wi_
 #ifdef _WI_DICTIONARY_USE_QSORT_R
     qsort_r(data, dictionary->key_count, sizeof(void *), compare, _wi_dictionary_compare_buckets);
 #else
-    wi_lock_lock(_wi_dictionary_sort_lock);
+    wi_fast_lock_lock(&_wi_dictionary_sort_lock);
     _wi_dictionary_sort_function = compare;
     qsort(data, dictionary->key_count, sizeof(void *), _wi_dictionary_compare_buckets);
-    wi_lock_unlock(_wi_dictionary_sort_lock);
+    wi_fast_lock_unlock(&_wi_dictionary_sort_lock);
 #endif
     
     callbacks.retain            = dictionary->key_callbacks.retain;
@@ -746,6 +761,16 @@ wi_boolean_t wi_dictionary_write_to_path(wi_dictionary_t *dictionary, wi_string_
 
 
 
+wi_boolean_t wi_dictionary_write_to_path_with_format(wi_dictionary_t *dictionary, wi_string_t *path, wi_plist_format_t format) {
+#ifdef WI_PLIST
+    return wi_plist_write_instance_to_path_with_format(dictionary, path, format);
+#else
+    return false;
+#endif
+}
+
+
+
 
 #pragma mark -
 
@@ -781,13 +806,19 @@ static _wi_dictionary_bucket_t * _wi_dictionary_bucket_create(wi_dictionary_t *d
     size_t                      size;
 
     if(!dictionary->bucket_free_list) {
-        if(dictionary->bucket_chunks_offset == _wi_dictionary_buckets_per_page) {
+        if(dictionary->bucket_chunks_offset == dictionary->bucket_chunk_size) {
             dictionary->bucket_chunks_count++;
 
             size = dictionary->bucket_chunks_count * sizeof(_wi_dictionary_bucket_t *);
             dictionary->bucket_chunks = wi_realloc(dictionary->bucket_chunks, size);
 
-            size = _wi_dictionary_buckets_per_page * sizeof(_wi_dictionary_bucket_t);
+            /* Chunks start out small and double up to a page, most dictionaries are small */
+            if(dictionary->bucket_chunk_size == 0)
+                dictionary->bucket_chunk_size = WI_MIN(dictionary->min_count, _wi_dictionary_buckets_per_page);
+            else
+                dictionary->bucket_chunk_size = WI_MIN(dictionary->bucket_chunk_size * 2, _wi_dictionary_buckets_per_page);
+
+            size = dictionary->bucket_chunk_size * sizeof(_wi_dictionary_bucket_t);
             dictionary->bucket_chunks[dictionary->bucket_chunks_count - 1] = wi_malloc(size);
 
             dictionary->bucket_chunks_offset = 0;
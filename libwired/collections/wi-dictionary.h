@@ -28,6 +28,7 @@
 #define WI_DICTIONARY_H 1
 
 #include <wired/wi-base.h>
+#include <wired/wi-plist.h>
 #include <wired/wi-runtime.h>
 
 struct _wi_dictionary_key_callbacks {
@@ -70,12 +71,14 @@ WI_EXPORT void *                                    wi_dictionary_data_for_key(w
 WI_EXPORT wi_boolean_t                              wi_dictionary_contains_key(wi_dictionary_t *, void *);
 WI_EXPORT wi_array_t *                              wi_dictionary_all_keys(wi_dictionary_t *);
 WI_EXPORT wi_array_t *                              wi_dictionary_all_values(wi_dictionary_t *);
+WI_EXPORT void                                      wi_dictionary_get_keys_and_data(wi_dictionary_t *, void **, void **);
 WI_EXPORT wi_array_t *                              wi_dictionary_keys_sorted_by_value(wi_dictionary_t *, wi_compare_func_t *);
 
 WI_EXPORT wi_enumerator_t *                         wi_dictionary_key_enumerator(wi_dictionary_t *);
 WI_EXPORT wi_enumerator_t *                         wi_dictionary_data_enumerator(wi_dictionary_t *);
 
 WI_EXPORT wi_boolean_t                              wi_dictionary_write_to_path(wi_dictionary_t *, wi_string_t *);
+WI_EXPORT wi_boolean_t                              wi_dictionary_write_to_path_with_format(wi_dictionary_t *, wi_string_t *, wi_plist_format_t);
 
 WI_EXPORT void                                      wi_mutable_dictionary_set_data_for_key(wi_mutable_dictionary_t *, void *, void *);
 WI_EXPORT void                                      wi_mutable_dictionary_add_entries_from_dictionary(wi_mutable_dictionary_t *, wi_dictionary_t *);
@@ -24,131 +24,611 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+#include <wired/wi-assert.h>
+#include <wired/wi-base64.h>
 #include <wired/wi-data.h>
 #include <wired/wi-pool.h>
 #include <wired/wi-private.h>
+#include <wired/wi-runtime.h>
 #include <wired/wi-string.h>
+#include <wired/wi-system.h>
+
+#define _WI_BASE64_PAD                      0x40
+#define _WI_BASE64_INVALID                  0x80
+
+#define _WI_BASE64_ENCODER_ASSERT_OPEN(encoder) \
+    WI_ASSERT(!(encoder)->closed, "%@ has been closed", (encoder))
+
+#define _WI_BASE64_DECODER_ASSERT_OPEN(decoder) \
+    WI_ASSERT(!(decoder)->closed, "%@ has been closed", (decoder))
+
+
+struct _wi_base64_encoder {
+    wi_runtime_base_t                   base;
+    
+    unsigned char                       buffer[3];
+    wi_uinteger_t                       length;
+    
+    wi_boolean_t                        closed;
+};
+
+
+struct _wi_base64_decoder {
+    wi_runtime_base_t                   base;
+    
+    uint32_t                            bits;
+    wi_uinteger_t                       count;
+    wi_boolean_t                        padded;
+    
+    wi_boolean_t                        closed;
+};
+
+
+static wi_uinteger_t                    _wi_base64_encode_blocks(const unsigned char *, wi_uinteger_t, char *);
+static wi_uinteger_t                    _wi_base64_encode_tail(const unsigned char *, wi_uinteger_t, char *);
+static wi_uinteger_t                    _wi_base64_decode_blocks(const unsigned char *, wi_uinteger_t, unsigned char *);
+static wi_uinteger_t                    _wi_base64_decode_bytes(wi_base64_decoder_t *, const unsigned char *, wi_uinteger_t, unsigned char *);
+static wi_uinteger_t                    _wi_base64_decode_tail(wi_base64_decoder_t *, unsigned char *);
+
+static wi_string_t *                    _wi_base64_encoder_description(wi_runtime_instance_t *);
+static wi_string_t *                    _wi_base64_decoder_description(wi_runtime_instance_t *);
+
+
+static const char                       _wi_base64_encode_table[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Maps a character to its 6 bit value, _WI_BASE64_PAD for '=' or
+   _WI_BASE64_INVALID for anything that is skipped */
+static const unsigned char              _wi_base64_decode_table[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3E, 0x80, 0x80, 0x80, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x80, 0x80, 0x80, 0x40, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+};
+
+static wi_runtime_id_t                  _wi_base64_encoder_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t               _wi_base64_encoder_runtime_class = {
+    "wi_base64_encoder_t",
+    NULL,
+    NULL,
+    NULL,
+    _wi_base64_encoder_description,
+    NULL
+};
+
+static wi_runtime_id_t                  _wi_base64_decoder_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t               _wi_base64_decoder_runtime_class = {
+    "wi_base64_decoder_t",
+    NULL,
+    NULL,
+    NULL,
+    _wi_base64_decoder_description,
+    NULL
+};
+
+
+
+void wi_base64_encoder_register(void) {
+    _wi_base64_encoder_runtime_id = wi_runtime_register_class(&_wi_base64_encoder_runtime_class);
+}
+
+
+
+void wi_base64_encoder_initialize(void) {
+}
+
+
+
+void wi_base64_decoder_register(void) {
+    _wi_base64_decoder_runtime_id = wi_runtime_register_class(&_wi_base64_decoder_runtime_class);
+}
+
+
+
+void wi_base64_decoder_initialize(void) {
+}
+
+
+
+#pragma mark -
+
+wi_uinteger_t wi_base64_encoded_length(wi_uinteger_t length) {
+    return ((length + 2) / 3) * 4;
+}
+
+
+
+wi_uinteger_t wi_base64_decoded_length(wi_uinteger_t length) {
+    return ((length + 3) / 4) * 3;
+}
+
+
+
+wi_uinteger_t wi_base64_encode(const void *bytes, wi_uinteger_t length, char *buffer) {
+    wi_uinteger_t   position, count;
+    
+    position = _wi_base64_encode_blocks(bytes, length, buffer);
+    count = (position / 3) * 4;
+    
+    return count + _wi_base64_encode_tail((const unsigned char *) bytes + position, length - position, buffer + count);
+}
+
+
+
+wi_uinteger_t wi_base64_decode(const char *string, wi_uinteger_t length, void *buffer) {
+    wi_base64_decoder_t     decoder;
+    wi_uinteger_t           count;
+    
+    memset(&decoder, 0, sizeof(decoder));
+    
+    count = _wi_base64_decode_bytes(&decoder, (const unsigned char *) string, length, buffer);
+    
+    return count + _wi_base64_decode_tail(&decoder, (unsigned char *) buffer + count);
+}
+
+
+
+#pragma mark -
 
 wi_string_t * wi_base64_string_from_data(wi_data_t *data) {
-    static char             base64_table[] =
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    wi_mutable_string_t     *base64;
-    const unsigned char     *bytes;
-    unsigned char           inbuffer[3], outbuffer[4];
-    wi_uinteger_t           i, length, count, position, remaining;
-    size_t                  size;
-
-    position    = 0;
-    length      = wi_data_length(data);
-    size        = (length * (4.0 / 3.0)) + 3;
-    bytes       = wi_data_bytes(data);
-    base64      = wi_string_init_with_capacity(wi_mutable_string_alloc(), size);
-    
-    while(position < length) {
-        for(i = 0; i < 3; i++) {
-            if(position + i < length)
-                inbuffer[i] = bytes[position + i];
-            else
-                inbuffer[i] = '\0';
-        }
+    char            *buffer;
+    wi_uinteger_t   length, capacity;
+    
+    capacity    = wi_base64_encoded_length(wi_data_length(data)) + 1;
+    buffer      = wi_malloc(capacity);
+    length      = wi_base64_encode(wi_data_bytes(data), wi_data_length(data), buffer);
+    
+    return wi_autorelease(wi_string_init_with_utf8_bytes_no_copy(wi_string_alloc(), buffer, length, capacity));
+}
 
-        outbuffer[0] =  (inbuffer[0] & 0xFC) >> 2;
-        outbuffer[1] = ((inbuffer[0] & 0x03) << 4) | ((inbuffer[1] & 0xF0) >> 4);
-        outbuffer[2] = ((inbuffer[1] & 0x0F) << 2) | ((inbuffer[2] & 0xC0) >> 6);
-        outbuffer[3] =   inbuffer[2] & 0x3F;
 
-        remaining = length - position;
-        
-        if(remaining == 1)
-            count = 2;
-        else if(remaining == 2)
-            count = 3;
-        else
-            count = 4;
 
-        for(i = 0; i < count; i++)
-            wi_mutable_string_append_format(base64, WI_STR("%c"), base64_table[outbuffer[i]]);
+wi_data_t * wi_data_from_base64_string(wi_string_t *string) {
+    void            *buffer;
+    wi_uinteger_t   length;
+    
+    length      = wi_string_length(string);
+    buffer      = wi_malloc(wi_base64_decoded_length(length));
+    length      = wi_base64_decode(wi_string_utf8_string(string), length, buffer);
+    
+    return wi_autorelease(wi_data_init_with_bytes_no_copy(wi_data_alloc(), buffer, length, true));
+}
+
+
 
-        for(i = count; i < 4; i++)
-            wi_mutable_string_append_string(base64, WI_STR("="));
+#pragma mark -
 
+static wi_uinteger_t _wi_base64_encode_blocks(const unsigned char *bytes, wi_uinteger_t length, char *buffer) {
+    wi_uinteger_t   position;
+    uint32_t        value;
+    
+    position = 0;
+    
+#if defined(__AVX2__) || defined(__SSSE3__)
+    /* Each 128 bit lane spreads 12 input bytes over 16 bytes of 6 bit
+       indices, which are then shifted into the alphabet. Loads read 16 bytes
+       per lane, so the loop stops 4 bytes early. */
+#if defined(__AVX2__)
+    while(length - position >= 28) {
+        __m256i     in, t0, t1, t2, t3, indices, offsets;
+        
+        in = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (bytes + position))),
+                                     _mm_loadu_si128((const __m128i *) (bytes + position + 12)), 1);
+        in = _mm256_shuffle_epi8(in, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                                      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+        
+        t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+        t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+        t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        indices = _mm256_or_si256(t1, t3);
+        
+        offsets = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        offsets = _mm256_sub_epi8(offsets, _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(25)));
+        offsets = _mm256_shuffle_epi8(_mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+                                                       65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0), offsets);
+        
+        _mm256_storeu_si256((__m256i *) buffer, _mm256_add_epi8(indices, offsets));
+        
+        position += 24;
+        buffer += 32;
+    }
+#endif
+    
+    while(length - position >= 16) {
+        __m128i     in, t0, t1, t2, t3, indices, offsets;
+        
+        in = _mm_loadu_si128((const __m128i *) (bytes + position));
+        in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+        
+        t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+        t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+        t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        indices = _mm_or_si128(t1, t3);
+        
+        offsets = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        offsets = _mm_sub_epi8(offsets, _mm_cmpgt_epi8(indices, _mm_set1_epi8(25)));
+        offsets = _mm_shuffle_epi8(_mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0), offsets);
+        
+        _mm_storeu_si128((__m128i *) buffer, _mm_add_epi8(indices, offsets));
+        
+        position += 12;
+        buffer += 16;
+    }
+#endif
+    
+    while(length - position >= 3) {
+        value = ((uint32_t) bytes[position] << 16) | ((uint32_t) bytes[position + 1] << 8) | bytes[position + 2];
+        
+        buffer[0] = _wi_base64_encode_table[(value >> 18) & 0x3F];
+        buffer[1] = _wi_base64_encode_table[(value >> 12) & 0x3F];
+        buffer[2] = _wi_base64_encode_table[(value >> 6) & 0x3F];
+        buffer[3] = _wi_base64_encode_table[value & 0x3F];
+        
         position += 3;
+        buffer += 4;
     }
     
-    wi_runtime_make_immutable(base64);
+    return position;
+}
+
+
+
+static wi_uinteger_t _wi_base64_encode_tail(const unsigned char *bytes, wi_uinteger_t length, char *buffer) {
+    uint32_t        value;
+    
+    if(length == 0)
+        return 0;
+    
+    value = (uint32_t) bytes[0] << 16;
+    
+    if(length > 1)
+        value |= (uint32_t) bytes[1] << 8;
     
-    return wi_autorelease(base64);
+    buffer[0] = _wi_base64_encode_table[(value >> 18) & 0x3F];
+    buffer[1] = _wi_base64_encode_table[(value >> 12) & 0x3F];
+    buffer[2] = (length > 1) ? _wi_base64_encode_table[(value >> 6) & 0x3F] : '=';
+    buffer[3] = '=';
+    
+    return 4;
 }
 
 
 
-wi_data_t * wi_data_from_base64_string(wi_string_t *string) {
-    wi_mutable_data_t   *data;
-    const char          *buffer;
-    char                ch, inbuffer[4], outbuffer[3];
-    wi_uinteger_t       length, count, i, position, offset;
-    wi_boolean_t        ignore, stop, end;
-    
-    length          = wi_string_length(string);
-    buffer          = wi_string_utf8_string(string);
-    position        = 0;
-    offset          = 0;
-    data            = wi_data_init_with_capacity(wi_mutable_data_alloc(), length);
-    
-    while(position < length) {
-        ignore = end = false;
-        ch = buffer[position++];
-        
-        if(ch >= 'A' && ch <= 'Z')
-            ch = ch - 'A';
-        else if(ch >= 'a' && ch <= 'z')
-            ch = ch - 'a' + 26;
-        else if(ch >= '0' && ch <= '9')
-            ch = ch - '0' + 52;
-        else if(ch == '+')
-            ch = 62;
-        else if(ch == '=')
-            end = true;
-        else if(ch == '/')
-            ch = 63;
-        else
-            ignore = true;
-        
-        if(!ignore) {
-            count = 3;
-            stop = false;
+static wi_uinteger_t _wi_base64_decode_blocks(const unsigned char *string, wi_uinteger_t length, unsigned char *buffer) {
+    wi_uinteger_t   position;
+    uint32_t        value;
+    
+    position = 0;
+    
+#if defined(__AVX2__) || defined(__SSSE3__)
+    /* Blocks are validated by looking up both nibbles of every character;
+       a block with anything but alphabet characters in it is left to the
+       scalar loop below. Stores go through the stack, since a block only
+       fills 12 of every 16 output bytes. */
+#if defined(__AVX2__)
+    while(length - position >= 32) {
+        __m256i     in, hi_nibbles, lo_nibbles, hi, lo, values, out;
+        union {
+            __m256i         vector;
+            unsigned char   bytes[32];
+        } block;
+        
+        in          = _mm256_loadu_si256((const __m256i *) (string + position));
+        hi_nibbles  = _mm256_and_si256(_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0F));
+        lo_nibbles  = _mm256_and_si256(in, _mm256_set1_epi8(0x0F));
+        hi          = _mm256_shuffle_epi8(_mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                                           0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10), hi_nibbles);
+        lo          = _mm256_shuffle_epi8(_mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                                           0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A), lo_nibbles);
+        
+        if(!_mm256_testz_si256(lo, hi))
+            break;
+        
+        values      = _mm256_add_epi8(in, _mm256_shuffle_epi8(_mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                                                0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0),
+                                                              _mm256_add_epi8(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('/')), hi_nibbles)));
+        out         = _mm256_madd_epi16(_mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+        out         = _mm256_shuffle_epi8(out, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        block.vector = _mm256_permutevar8x32_epi32(out, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        
+        memcpy(buffer, block.bytes, 24);
+        
+        position += 32;
+        buffer += 24;
+    }
+#endif
+    
+    while(length - position >= 16) {
+        __m128i     in, hi_nibbles, lo_nibbles, hi, lo, values, out;
+        union {
+            __m128i         vector;
+            unsigned char   bytes[16];
+        } block;
+        
+        in          = _mm_loadu_si128((const __m128i *) (string + position));
+        hi_nibbles  = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0F));
+        lo_nibbles  = _mm_and_si128(in, _mm_set1_epi8(0x0F));
+        hi          = _mm_shuffle_epi8(_mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10), hi_nibbles);
+        lo          = _mm_shuffle_epi8(_mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A), lo_nibbles);
+        
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF)
+            break;
+        
+        values      = _mm_add_epi8(in, _mm_shuffle_epi8(_mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0),
+                                                        _mm_add_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('/')), hi_nibbles)));
+        out         = _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+        block.vector = _mm_shuffle_epi8(out, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        
+        memcpy(buffer, block.bytes, 12);
+        
+        position += 16;
+        buffer += 12;
+    }
+#endif
+    
+    while(length - position >= 4) {
+        value = _wi_base64_decode_table[string[position]] |
+                _wi_base64_decode_table[string[position + 1]] |
+                _wi_base64_decode_table[string[position + 2]] |
+                _wi_base64_decode_table[string[position + 3]];
+        
+        if(value & (_WI_BASE64_PAD | _WI_BASE64_INVALID))
+            break;
+        
+        value = ((uint32_t) _wi_base64_decode_table[string[position]] << 18) |
+                ((uint32_t) _wi_base64_decode_table[string[position + 1]] << 12) |
+                ((uint32_t) _wi_base64_decode_table[string[position + 2]] << 6) |
+                 (uint32_t) _wi_base64_decode_table[string[position + 3]];
+        
+        buffer[0] = value >> 16;
+        buffer[1] = value >> 8;
+        buffer[2] = value;
+        
+        position += 4;
+        buffer += 3;
+    }
+    
+    return position;
+}
+
+
+
+static wi_uinteger_t _wi_base64_decode_bytes(wi_base64_decoder_t *decoder, const unsigned char *string, wi_uinteger_t length, unsigned char *buffer) {
+    wi_uinteger_t   position, count, offset;
+    unsigned char   value;
+    
+    position = count = 0;
+    
+    while(position < length && !decoder->padded) {
+        /* Whole groups are decoded in bulk until a character that needs
+           attention, such as a line break or padding, comes up */
+        if(decoder->count == 0) {
+            offset = _wi_base64_decode_blocks(string + position, length - position, buffer + count);
             
-            if(end) {
-                if(offset == 0)
-                    break;
-                else if(offset == 1 || offset == 2)
-                    count = 1;
-                else
-                    count = 2;
-                
-                offset = 3;
-                stop = true;
-            }
+            position += offset;
+            count += (offset / 4) * 3;
             
-            inbuffer[offset++] = ch;
+            if(position == length)
+                break;
+        }
+        
+        value = _wi_base64_decode_table[string[position++]];
+        
+        if(value == _WI_BASE64_INVALID)
+            continue;
+        
+        if(value == _WI_BASE64_PAD) {
+            count += _wi_base64_decode_tail(decoder, buffer + count);
             
-            if(offset == 4) {
-                outbuffer[0] =  (inbuffer[0]         << 2) | ((inbuffer[1] & 0x30) >> 4);
-                outbuffer[1] = ((inbuffer[1] & 0x0F) << 4) | ((inbuffer[2] & 0x3C) >> 2);
-                outbuffer[2] = ((inbuffer[2] & 0x03) << 6) |  (inbuffer[3] & 0x3F);
-                
-                for(i = 0; i < count; i++)
-                    wi_mutable_data_append_bytes(data, &outbuffer[i], 1);
-
-                offset = 0;
-            }
+            decoder->padded = true;
             
-            if(stop)
-                break;
+            break;
+        }
+        
+        decoder->bits = (decoder->bits << 6) | value;
+        
+        if(++decoder->count == 4) {
+            buffer[count++] = decoder->bits >> 16;
+            buffer[count++] = decoder->bits >> 8;
+            buffer[count++] = decoder->bits;
+            
+            decoder->bits = 0;
+            decoder->count = 0;
         }
     }
     
-    wi_runtime_make_immutable(data);
+    return count;
+}
+
+
+
+static wi_uinteger_t _wi_base64_decode_tail(wi_base64_decoder_t *decoder, unsigned char *buffer) {
+    wi_uinteger_t   count;
+    
+    count = 0;
+    
+    /* A lone character is not enough for a byte and is dropped */
+    if(decoder->count == 2) {
+        buffer[count++] = decoder->bits >> 4;
+    }
+    else if(decoder->count == 3) {
+        buffer[count++] = decoder->bits >> 10;
+        buffer[count++] = decoder->bits >> 2;
+    }
+    
+    decoder->bits = 0;
+    decoder->count = 0;
+    
+    return count;
+}
+
+
+
+#pragma mark -
+
+wi_runtime_id_t wi_base64_encoder_runtime_id(void) {
+    return _wi_base64_encoder_runtime_id;
+}
+
+
+
+#pragma mark -
+
+wi_base64_encoder_t * wi_base64_encoder(void) {
+    return wi_autorelease(wi_base64_encoder_init(wi_base64_encoder_alloc()));
+}
+
+
+
+#pragma mark -
+
+wi_base64_encoder_t * wi_base64_encoder_alloc(void) {
+    return wi_runtime_create_instance(_wi_base64_encoder_runtime_id, sizeof(wi_base64_encoder_t));
+}
+
+
+
+wi_base64_encoder_t * wi_base64_encoder_init(wi_base64_encoder_t *encoder) {
+    return encoder;
+}
+
+
+
+static wi_string_t * _wi_base64_encoder_description(wi_runtime_instance_t *instance) {
+    wi_base64_encoder_t     *encoder = instance;
+    
+    return wi_string_with_format(WI_STR("<%@ %p>{closed = %d}"),
+        wi_runtime_class_name(encoder),
+        encoder,
+        encoder->closed);
+}
+
+
+
+#pragma mark -
+
+wi_uinteger_t wi_base64_encoder_update(wi_base64_encoder_t *encoder, const void *bytes, wi_uinteger_t length, char *buffer) {
+    const unsigned char     *p = bytes;
+    wi_uinteger_t           count, position;
+    
+    _WI_BASE64_ENCODER_ASSERT_OPEN(encoder);
+    
+    count = 0;
+    
+    if(encoder->length > 0) {
+        while(encoder->length < 3 && length > 0) {
+            encoder->buffer[encoder->length++] = *p++;
+            length--;
+        }
+        
+        if(encoder->length < 3)
+            return 0;
+        
+        _wi_base64_encode_blocks(encoder->buffer, 3, buffer);
+        
+        encoder->length = 0;
+        count = 4;
+    }
+    
+    position = _wi_base64_encode_blocks(p, length, buffer + count);
+    count += (position / 3) * 4;
+    
+    memcpy(encoder->buffer, p + position, length - position);
+    
+    encoder->length = length - position;
+    
+    return count;
+}
+
+
+
+wi_uinteger_t wi_base64_encoder_close(wi_base64_encoder_t *encoder, char *buffer) {
+    _WI_BASE64_ENCODER_ASSERT_OPEN(encoder);
+    
+    encoder->closed = true;
+    
+    return _wi_base64_encode_tail(encoder->buffer, encoder->length, buffer);
+}
+
+
+
+#pragma mark -
+
+wi_runtime_id_t wi_base64_decoder_runtime_id(void) {
+    return _wi_base64_decoder_runtime_id;
+}
+
+
+
+#pragma mark -
+
+wi_base64_decoder_t * wi_base64_decoder(void) {
+    return wi_autorelease(wi_base64_decoder_init(wi_base64_decoder_alloc()));
+}
+
+
+
+#pragma mark -
+
+wi_base64_decoder_t * wi_base64_decoder_alloc(void) {
+    return wi_runtime_create_instance(_wi_base64_decoder_runtime_id, sizeof(wi_base64_decoder_t));
+}
+
+
+
+wi_base64_decoder_t * wi_base64_decoder_init(wi_base64_decoder_t *decoder) {
+    return decoder;
+}
+
+
+
+static wi_string_t * _wi_base64_decoder_description(wi_runtime_instance_t *instance) {
+    wi_base64_decoder_t     *decoder = instance;
+    
+    return wi_string_with_format(WI_STR("<%@ %p>{padded = %d, closed = %d}"),
+        wi_runtime_class_name(decoder),
+        decoder,
+        decoder->padded,
+        decoder->closed);
+}
+
+
+
+#pragma mark -
+
+wi_uinteger_t wi_base64_decoder_update(wi_base64_decoder_t *decoder, const char *string, wi_uinteger_t length, void *buffer) {
+    _WI_BASE64_DECODER_ASSERT_OPEN(decoder);
+    
+    return _wi_base64_decode_bytes(decoder, (const unsigned char *) string, length, buffer);
+}
+
+
+
+wi_uinteger_t wi_base64_decoder_close(wi_base64_decoder_t *decoder, void *buffer) {
+    _WI_BASE64_DECODER_ASSERT_OPEN(decoder);
+    
+    decoder->closed = true;
     
-    return wi_autorelease(data);
+    return _wi_base64_decode_tail(decoder, buffer);
 }
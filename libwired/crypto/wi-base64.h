@@ -30,7 +30,35 @@
 #include <wired/wi-base.h>
 #include <wired/wi-runtime.h>
 
+WI_EXPORT wi_uinteger_t                 wi_base64_encoded_length(wi_uinteger_t);
+WI_EXPORT wi_uinteger_t                 wi_base64_decoded_length(wi_uinteger_t);
+
+WI_EXPORT wi_uinteger_t                 wi_base64_encode(const void *, wi_uinteger_t, char *);
+WI_EXPORT wi_uinteger_t                 wi_base64_decode(const char *, wi_uinteger_t, void *);
+
 WI_EXPORT wi_string_t *                 wi_base64_string_from_data(wi_data_t *);
 WI_EXPORT wi_data_t *                   wi_data_from_base64_string(wi_string_t *);
 
+
+WI_EXPORT wi_runtime_id_t               wi_base64_encoder_runtime_id(void);
+
+WI_EXPORT wi_base64_encoder_t *         wi_base64_encoder(void);
+
+WI_EXPORT wi_base64_encoder_t *         wi_base64_encoder_alloc(void);
+WI_EXPORT wi_base64_encoder_t *         wi_base64_encoder_init(wi_base64_encoder_t *);
+
+WI_EXPORT wi_uinteger_t                 wi_base64_encoder_update(wi_base64_encoder_t *, const void *, wi_uinteger_t, char *);
+WI_EXPORT wi_uinteger_t                 wi_base64_encoder_close(wi_base64_encoder_t *, char *);
+
+
+WI_EXPORT wi_runtime_id_t               wi_base64_decoder_runtime_id(void);
+
+WI_EXPORT wi_base64_decoder_t *         wi_base64_decoder(void);
+
+WI_EXPORT wi_base64_decoder_t *         wi_base64_decoder_alloc(void);
+WI_EXPORT wi_base64_decoder_t *         wi_base64_decoder_init(wi_base64_decoder_t *);
+
+WI_EXPORT wi_uinteger_t                 wi_base64_decoder_update(wi_base64_decoder_t *, const char *, wi_uinteger_t, void *);
+WI_EXPORT wi_uinteger_t                 wi_base64_decoder_close(wi_base64_decoder_t *, void *);
+
 #endif /* WI_BASE64_H */
@@ -27,12 +27,16 @@
 #include "config.h"
 
 #include <sys/fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <wired/wi-assert.h>
 #include <wired/wi-base64.h>
 #include <wired/wi-data.h>
+#include <wired/wi-fast-lock.h>
 #include <wired/wi-file.h>
 #include <wired/wi-filesystem.h>
 #include <wired/wi-macros.h>
@@ -46,6 +50,27 @@
 #include <wired/wi-system.h>
 
 #define _WI_DATA_MIN_SIZE               128
+#define _WI_DATA_MAP_THRESHOLD          (256 * 1024)
+
+#define _WI_DATA_RANGE_ASSERT(data, range)                                      \
+    WI_ASSERT((range).location + (range).length <= (data)->length,              \
+        "range {%lu, %lu} out of range (length %lu)",                           \
+        (range).location, (range).length, (data)->length)
+
+#define _WI_DATA_FLATTEN(data) \
+    WI_STMT_START \
+        if(!(data)->bytes) \
+            _wi_data_flatten((data)); \
+    WI_STMT_END
+
+
+struct _wi_data_chunk {
+    void                                *bytes;
+    wi_uinteger_t                       length;
+    
+    struct _wi_data_chunk               *next;
+};
+typedef struct _wi_data_chunk           _wi_data_chunk_t;
 
 
 struct _wi_data {
@@ -55,6 +80,13 @@ struct _wi_data {
     wi_uinteger_t                       length;
     wi_uinteger_t                       capacity;
     wi_boolean_t                        free;
+    
+    void                                *mapping;
+    wi_uinteger_t                       mapping_length;
+    
+    wi_data_t                           *parent;
+    
+    _wi_data_chunk_t                    *chunks, *last_chunk;
 };
 
 
@@ -64,6 +96,7 @@ static wi_boolean_t                     _wi_data_is_equal(wi_runtime_instance_t
 static wi_string_t *                    _wi_data_description(wi_runtime_instance_t *);
 static wi_hash_code_t                   _wi_data_hash(wi_runtime_instance_t *);
 
+static void                             _wi_data_flatten(wi_data_t *);
 static void                             _wi_data_append_bytes(wi_mutable_data_t *, const void *, wi_uinteger_t);
 
 
@@ -77,6 +110,8 @@ static wi_runtime_class_t               _wi_data_runtime_class = {
     _wi_data_hash
 };
 
+static wi_fast_lock_t                   _wi_data_flatten_lock = WI_FAST_LOCK_INITIALIZER;
+
 
 
 void wi_data_register(void) {
@@ -189,6 +224,18 @@ wi_data_t * wi_data_init_with_bytes_no_copy(wi_data_t *data, void *bytes, wi_uin
 
 
 
+wi_data_t * wi_data_init_with_mapped_bytes(wi_data_t *data, void *mapping, wi_uinteger_t mapping_length, const void *bytes, wi_uinteger_t length) {
+    data->mapping           = mapping;
+    data->mapping_length    = mapping_length;
+    data->bytes             = (void *) bytes;
+    data->capacity          = length;
+    data->length            = length;
+    
+    return data;
+}
+
+
+
 wi_data_t * wi_data_init_with_random_bytes(wi_data_t *data, wi_uinteger_t length) {
     data = wi_data_init_with_capacity(data, length);
     
@@ -213,6 +260,7 @@ wi_data_t * wi_data_init_with_base64_string(wi_data_t *data, wi_string_t *string
 
 wi_data_t * wi_data_init_with_contents_of_file(wi_data_t *data, wi_string_t *path) {
     wi_file_t       *file;
+    struct stat     sb;
     
     wi_release(data);
     
@@ -221,7 +269,13 @@ wi_data_t * wi_data_init_with_contents_of_file(wi_data_t *data, wi_string_t *pat
     if(!file)
         return NULL;
     
-    data = wi_file_read_to_end_of_file(file);
+    data = NULL;
+    
+    if(fstat(wi_file_descriptor(file), &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size >= _WI_DATA_MAP_THRESHOLD)
+        data = wi_file_map_with_advice(file, 0, sb.st_size, WI_FILE_ADVICE_SEQUENTIAL);
+    
+    if(!data)
+        data = wi_file_read_to_end_of_file(file);
     
     if(!data)
         return NULL;
@@ -232,10 +286,22 @@ wi_data_t * wi_data_init_with_contents_of_file(wi_data_t *data, wi_string_t *pat
 
 
 static void _wi_data_dealloc(wi_runtime_instance_t *instance) {
-    wi_data_t   *data = instance;
+    wi_data_t           *data = instance;
+    _wi_data_chunk_t    *chunk, *next_chunk;
     
-    if(data->free)
+    for(chunk = data->chunks; chunk; chunk = next_chunk) {
+        next_chunk = chunk->next;
+        
+        wi_free(chunk->bytes);
+        wi_free(chunk);
+    }
+    
+    if(data->mapping)
+        munmap(data->mapping, data->mapping_length);
+    else if(data->free)
         wi_free(data->bytes);
+    
+    wi_release(data->parent);
 }
 
 
@@ -243,6 +309,8 @@ static void _wi_data_dealloc(wi_runtime_instance_t *instance) {
 static wi_runtime_instance_t * _wi_data_copy(wi_runtime_instance_t *instance) {
     wi_data_t   *data = instance;
     
+    _WI_DATA_FLATTEN(data);
+    
     return wi_data_init_with_bytes(wi_data_alloc(), data->bytes, data->length);
 }
 
@@ -255,6 +323,9 @@ static wi_boolean_t _wi_data_is_equal(wi_runtime_instance_t *instance1, wi_runti
     if(data1->length != data2->length)
         return false;
     
+    _WI_DATA_FLATTEN(data1);
+    _WI_DATA_FLATTEN(data2);
+    
     return (memcmp(data1->bytes, data2->bytes, data1->length) == 0);
 }
 
@@ -266,6 +337,8 @@ static wi_string_t * _wi_data_description(wi_runtime_instance_t *instance) {
     const unsigned char     *bytes;
     wi_uinteger_t           i;
     
+    _WI_DATA_FLATTEN(data);
+    
     string  = wi_mutable_string();
     bytes   = data->bytes;
     
@@ -286,6 +359,8 @@ static wi_string_t * _wi_data_description(wi_runtime_instance_t *instance) {
 static wi_hash_code_t _wi_data_hash(wi_runtime_instance_t *instance) {
     wi_data_t   *data = instance;
     
+    _WI_DATA_FLATTEN(data);
+    
     return wi_hash_data(data->bytes, WI_MIN(data->length, 16));
 }
 
@@ -294,6 +369,8 @@ static wi_hash_code_t _wi_data_hash(wi_runtime_instance_t *instance) {
 #pragma mark -
 
 const void * wi_data_bytes(wi_data_t *data) {
+    _WI_DATA_FLATTEN(data);
+    
     return data->bytes;
 }
 
@@ -306,6 +383,8 @@ wi_uinteger_t wi_data_length(wi_data_t *data) {
 
 
 void wi_data_get_bytes(wi_data_t *data, void *bytes, wi_uinteger_t length) {
+    _WI_DATA_FLATTEN(data);
+    
     memcpy(bytes, data->bytes, length);
 }
 
@@ -319,9 +398,49 @@ wi_string_t * wi_data_string(wi_data_t *data, wi_string_encoding_t *encoding) {
 
 #pragma mark -
 
+static void _wi_data_flatten(wi_data_t *data) {
+    _wi_data_chunk_t    *chunk, *next_chunk;
+    char                *bytes;
+    wi_uinteger_t       offset;
+    
+    wi_fast_lock_lock(&_wi_data_flatten_lock);
+    
+    if(!data->bytes && data->chunks) {
+        bytes   = wi_malloc(WI_MAX(data->length, 1));
+        offset  = 0;
+        
+        for(chunk = data->chunks; chunk; chunk = next_chunk) {
+            next_chunk = chunk->next;
+            
+            memcpy(bytes + offset, chunk->bytes, chunk->length);
+            
+            offset += chunk->length;
+            
+            wi_free(chunk->bytes);
+            wi_free(chunk);
+        }
+        
+        data->chunks        = NULL;
+        data->last_chunk    = NULL;
+        data->capacity      = WI_MAX(data->length, 1);
+        data->free          = true;
+        
+        /* Publish the flattened bytes last, readers only look at data->bytes */
+        __sync_synchronize();
+        
+        data->bytes         = bytes;
+    }
+    
+    wi_fast_lock_unlock(&_wi_data_flatten_lock);
+}
+
+
+
 static void _wi_data_append_bytes(wi_mutable_data_t *data, const void *bytes, wi_uinteger_t length) {
+    _WI_DATA_FLATTEN(data);
+    
     if(data->length + length > data->capacity) {
-        data->capacity  = data->length + length;
+        data->capacity  = WI_MAX(data->length + length, data->capacity * 2);
         data->bytes     = wi_realloc(data->bytes, data->capacity);
     }
     
@@ -338,7 +457,7 @@ wi_data_t * wi_data_by_appending_data(wi_data_t *data, wi_data_t *append_data) {
     wi_mutable_data_t   *newdata;
     
     newdata = wi_mutable_copy(data);
-    wi_mutable_data_append_bytes(newdata, append_data->bytes, append_data->length);
+    wi_mutable_data_append_data(newdata, append_data);
     
     wi_runtime_make_immutable(data);
     
@@ -360,6 +479,26 @@ wi_data_t * wi_data_by_appending_bytes(wi_data_t *data, const void *bytes, wi_ui
 
 
 
+wi_data_t * wi_data_subdata_with_range(wi_data_t *data, wi_range_t range) {
+    wi_data_t   *subdata, *parent;
+    
+    _WI_DATA_RANGE_ASSERT(data, range);
+    _WI_DATA_FLATTEN(data);
+    
+    parent = data->parent ? data->parent : data;
+    
+    /* Mutable data can move its bytes, so only immutable data is shared */
+    if(wi_runtime_options(data) & WI_RUNTIME_OPTION_MUTABLE)
+        return wi_data_with_bytes((char *) data->bytes + range.location, range.length);
+    
+    subdata = wi_data_init_with_bytes_no_copy(wi_data_alloc(), (char *) data->bytes + range.location, range.length, false);
+    subdata->parent = wi_retain(parent);
+    
+    return wi_autorelease(subdata);
+}
+
+
+
 #pragma mark -
 
 #ifdef WI_MD5
@@ -420,6 +559,8 @@ wi_boolean_t wi_data_write_to_path(wi_data_t *data, wi_string_t *path) {
 void wi_mutable_data_append_data(wi_mutable_data_t *data, wi_data_t *append_data) {
     WI_RUNTIME_ASSERT_MUTABLE(data);
     
+    _WI_DATA_FLATTEN(append_data);
+    
     _wi_data_append_bytes(data, append_data->bytes, append_data->length);
 }
 
@@ -430,3 +571,39 @@ void wi_mutable_data_append_bytes(wi_mutable_data_t *data, const void *bytes, wi
     
     _wi_data_append_bytes(data, bytes, length);
 }
+
+
+
+void wi_mutable_data_append_bytes_no_copy(wi_mutable_data_t *data, void *bytes, wi_uinteger_t length) {
+    _wi_data_chunk_t    *chunk;
+    
+    WI_RUNTIME_ASSERT_MUTABLE(data);
+    
+    if(data->bytes && data->length > 0) {
+        _wi_data_append_bytes(data, bytes, length);
+        
+        wi_free(bytes);
+        
+        return;
+    }
+    
+    if(data->bytes) {
+        if(data->free)
+            wi_free(data->bytes);
+        
+        data->bytes     = NULL;
+        data->capacity  = 0;
+    }
+    
+    chunk           = wi_malloc(sizeof(*chunk));
+    chunk->bytes    = bytes;
+    chunk->length   = length;
+    
+    if(data->last_chunk)
+        data->last_chunk->next = chunk;
+    else
+        data->chunks = chunk;
+    
+    data->last_chunk = chunk;
+    data->length += length;
+}
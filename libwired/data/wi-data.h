@@ -55,6 +55,7 @@ WI_EXPORT wi_string_t *                     wi_data_string(wi_data_t *, wi_strin
 
 WI_EXPORT wi_data_t *                       wi_data_by_appending_data(wi_data_t *, wi_data_t *);
 WI_EXPORT wi_data_t *                       wi_data_by_appending_bytes(wi_data_t *, const void *, wi_uinteger_t);
+WI_EXPORT wi_data_t *                       wi_data_subdata_with_range(wi_data_t *, wi_range_t);
 
 WI_EXPORT wi_string_t *                     wi_data_md5_string(wi_data_t *);
 WI_EXPORT wi_string_t *                     wi_data_sha1_string(wi_data_t *);
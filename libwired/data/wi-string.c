@@ -51,9 +51,9 @@
 #include <wired/wi-compat.h>
 #include <wired/wi-data.h>
 #include <wired/wi-dictionary.h>
+#include <wired/wi-fast-lock.h>
 #include <wired/wi-file.h>
 #include <wired/wi-filesystem.h>
-#include <wired/wi-lock.h>
 #include <wired/wi-macros.h>
 #include <wired/wi-pool.h>
 #include <wired/wi-private.h>
@@ -65,6 +65,8 @@
 
 #define _WI_STRING_MIN_SIZE             256
 #define _WI_STRING_FORMAT_BUFSIZ        64
+#define _WI_STRING_FORMAT_NONE          -1
+#define _WI_STRING_FORMAT_ARGUMENT      -2
 
 #define _WI_STRING_GROW(string, n)                                              \
     WI_STMT_START                                                               \
@@ -93,6 +95,43 @@ struct _wi_string {
 };
 
 
+enum _wi_string_format_flag {
+    _WI_STRING_FORMAT_ALT               = (1 << 0),
+    _WI_STRING_FORMAT_LEFT              = (1 << 1),
+    _WI_STRING_FORMAT_PLUS              = (1 << 2),
+    _WI_STRING_FORMAT_SPACE             = (1 << 3),
+    _WI_STRING_FORMAT_ZERO              = (1 << 4),
+    _WI_STRING_FORMAT_GROUPING          = (1 << 5)
+};
+
+
+enum _wi_string_format_modifier {
+    _WI_STRING_FORMAT_INT               = 0,
+    _WI_STRING_FORMAT_CHAR,
+    _WI_STRING_FORMAT_SHORT,
+    _WI_STRING_FORMAT_LONG,
+    _WI_STRING_FORMAT_LONG_LONG,
+    _WI_STRING_FORMAT_INTMAX,
+    _WI_STRING_FORMAT_PTRDIFF,
+    _WI_STRING_FORMAT_SIZE,
+    _WI_STRING_FORMAT_LONG_DOUBLE
+};
+
+
+/* One conversion of a format, with the literal text that precedes it; the
+   last one has a zero conversion and only holds the trailing literal */
+struct _wi_string_conversion {
+    const char                          *literal;
+    wi_uinteger_t                       literal_length;
+    char                                conversion;
+    uint8_t                             flags;
+    uint8_t                             modifier;
+    int                                 width;
+    int                                 precision;
+};
+typedef struct _wi_string_conversion    _wi_string_conversion_t;
+
+
 static void                             _wi_string_dealloc(wi_runtime_instance_t *);
 static wi_runtime_instance_t *          _wi_string_copy(wi_runtime_instance_t *);
 static wi_boolean_t                     _wi_string_is_equal(wi_runtime_instance_t *, wi_runtime_instance_t *);
@@ -100,7 +139,18 @@ static wi_string_t *                    _wi_string_description(wi_runtime_instan
 static wi_hash_code_t                   _wi_string_hash(wi_runtime_instance_t *);
 
 static void                             _wi_string_grow(wi_string_t *, wi_uinteger_t);
-static void                             _wi_string_append_arguments(wi_string_t *, const char *, va_list);
+static void                             _wi_string_append_arguments(wi_string_t *, wi_string_t *, va_list);
+static const _wi_string_conversion_t *  _wi_string_compiled_format(wi_string_t *);
+static const char *                     _wi_string_parse_conversion(const char *, _wi_string_conversion_t *);
+static void                             _wi_string_append_conversion(wi_string_t *, const _wi_string_conversion_t *, wi_uinteger_t, va_list *);
+static intmax_t                         _wi_string_signed_argument(int, va_list *);
+static uintmax_t                        _wi_string_unsigned_argument(int, va_list *);
+static void                             _wi_string_append_integer(wi_string_t *, uintmax_t, const char *, int, wi_boolean_t, int, int, int);
+static wi_boolean_t                     _wi_string_append_fixed_double(wi_string_t *, double, int, int, int);
+static void                             _wi_string_append_padded_bytes(wi_string_t *, const char *, wi_uinteger_t, int, int);
+static void                             _wi_string_append_padding(wi_string_t *, char, int, wi_uinteger_t, int, wi_boolean_t);
+static const char *                     _wi_string_conversion_format(const _wi_string_conversion_t *, int, int, int, const char *, char *);
+static void                             _wi_string_append_c_format(wi_string_t *, const char *, ...);
 static void                             _wi_string_append_utf8_string(wi_string_t *, const char *);
 static void                             _wi_string_append_utf8_bytes(wi_string_t *, const void *, wi_uinteger_t);
 
@@ -109,9 +159,12 @@ static wi_boolean_t                     _wi_mutable_string_char_is_whitespace(ch
 static wi_mutable_array_t *             _wi_string_path_components(wi_string_t *);
 
 
-static wi_lock_t                        *_wi_string_constant_string_lock;
+static wi_fast_lock_t                   _wi_string_constant_string_lock = WI_FAST_LOCK_INITIALIZER;
 static wi_dictionary_t                  *_wi_string_constant_string_table;
 
+static wi_fast_lock_t                   _wi_string_format_lock = WI_FAST_LOCK_INITIALIZER;
+static wi_dictionary_t                  *_wi_string_format_table;
+
 static wi_runtime_id_t                  _wi_string_runtime_id = WI_RUNTIME_ID_NULL;
 static wi_runtime_class_t               _wi_string_runtime_class = {
     "wi_string_t",
@@ -131,9 +184,11 @@ void wi_string_register(void) {
 
 
 void wi_string_initialize(void) {
-    _wi_string_constant_string_lock = wi_lock_init(wi_lock_alloc());
     _wi_string_constant_string_table = wi_dictionary_init_with_capacity_and_callbacks(wi_mutable_dictionary_alloc(),
         2000, wi_dictionary_null_key_callbacks, wi_dictionary_default_value_callbacks);
+    
+    _wi_string_format_table = wi_dictionary_init_with_capacity_and_callbacks(wi_mutable_dictionary_alloc(),
+        1000, wi_dictionary_null_key_callbacks, wi_dictionary_null_value_callbacks);
 }
 
 
@@ -347,6 +402,20 @@ wi_string_t * wi_string_init_with_utf8_bytes(wi_string_t *string, const void *bu
 
 
 
+wi_string_t * wi_string_init_with_utf8_bytes_no_copy(wi_string_t *string, char *buffer, wi_uinteger_t length, wi_uinteger_t capacity) {
+    WI_ASSERT(length < capacity, "length %d leaves no room for a terminator (capacity %d)", length, capacity);
+    
+    string->string      = buffer;
+    string->length      = length;
+    string->capacity    = capacity;
+    
+    string->string[string->length] = '\0';
+    
+    return string;
+}
+
+
+
 wi_string_t * wi_string_init_with_format(wi_string_t *string, wi_string_t *fmt, ...) {
     va_list     ap;
     
@@ -362,7 +431,7 @@ wi_string_t * wi_string_init_with_format(wi_string_t *string, wi_string_t *fmt,
 wi_string_t * wi_string_init_with_format_and_arguments(wi_string_t *string, wi_string_t *fmt, va_list ap) {
     string = wi_string_init(string);
     
-    _wi_string_append_arguments(string, wi_string_utf8_string(fmt), ap);
+    _wi_string_append_arguments(string, fmt, ap);
     
     return string;
 }
@@ -502,16 +571,21 @@ char wi_string_character_at_index(wi_string_t *string, wi_uinteger_t index) {
 wi_string_t * _wi_string_constant_utf8_string(const char *utf8_string) {
     wi_string_t     *string;
     
-    wi_lock_lock(_wi_string_constant_string_lock);
+    wi_fast_lock_lock(&_wi_string_constant_string_lock);
     string = wi_dictionary_data_for_key(_wi_string_constant_string_table, (void *) utf8_string);
     
     if(!string) {
         string = wi_string_init_with_utf8_string(wi_string_alloc(), utf8_string);
+        
+        /* Constant strings live as long as the process, which also lets
+           compiled formats be cached by their address */
+        WI_RUNTIME_BASE(string)->options |= WI_RUNTIME_OPTION_PERMANENT;
+        
         wi_mutable_dictionary_set_data_for_key(_wi_string_constant_string_table, string, (void *) utf8_string);
         wi_release(string);
     }
     
-    wi_lock_unlock(_wi_string_constant_string_lock);
+    wi_fast_lock_unlock(&_wi_string_constant_string_lock);
 
     return string;
 }
@@ -529,67 +603,160 @@ static void _wi_string_grow(wi_string_t *string, wi_uinteger_t capacity) {
 
 
 
-static void _wi_string_append_arguments(wi_string_t *string, const char *fmt, va_list ap) {
-    wi_string_t         *description;
-    const char          *p, *pfmt;
-    char                *s, *vbuffer, cfmt[_WI_STRING_FORMAT_BUFSIZ], buffer[_WI_STRING_FORMAT_BUFSIZ];
-    wi_uinteger_t       i, size, totalsize;
-    int                 ch, length;
-    wi_boolean_t        alt, star, h, hh, j, t, l, ll, L, z;
+static void _wi_string_append_arguments(wi_string_t *string, wi_string_t *fmt, va_list ap) {
+    _wi_string_conversion_t         conversion;
+    const _wi_string_conversion_t   *conversions;
+    const char                      *p;
+    wi_uinteger_t                   start;
+    va_list                         arguments;
     
-    pfmt = fmt;
-    totalsize = 0;
+    /* %n counts what the conversions wrote, not the literal text */
+    start = string->length;
     
-    while(true) {
-        i = length = 0;
-        p = pfmt;
-        
-        while(*pfmt && *pfmt != '%')
-            pfmt++;
+    va_copy(arguments, ap);
+    
+    /* Constant formats are parsed once and kept, anything else is parsed as
+       it is written out */
+    if(WI_RUNTIME_BASE(fmt)->options & WI_RUNTIME_OPTION_PERMANENT) {
+        for(conversions = _wi_string_compiled_format(fmt); ; conversions++) {
+            if(conversions->literal_length > 0) {
+                _wi_string_append_utf8_bytes(string, conversions->literal, conversions->literal_length);
+                
+                start += conversions->literal_length;
+            }
+            
+            if(conversions->conversion == '\0')
+                break;
+            
+            _wi_string_append_conversion(string, conversions, start, &arguments);
+        }
+    } else {
+        for(p = fmt->string; ; ) {
+            p = _wi_string_parse_conversion(p, &conversion);
+            
+            if(conversion.literal_length > 0) {
+                _wi_string_append_utf8_bytes(string, conversion.literal, conversion.literal_length);
+                
+                start += conversion.literal_length;
+            }
+            
+            if(conversion.conversion == '\0')
+                break;
+            
+            _wi_string_append_conversion(string, &conversion, start, &arguments);
+        }
+    }
+    
+    va_end(arguments);
+}
 
-        size = pfmt - p;
-        
-        if(size > 0)
-            _wi_string_append_utf8_bytes(string, p, size);
+
+
+static const _wi_string_conversion_t * _wi_string_compiled_format(wi_string_t *fmt) {
+    _wi_string_conversion_t     *conversions, *existing_conversions;
+    const char                  *p;
+    wi_uinteger_t               count, capacity;
+    
+    wi_fast_lock_lock(&_wi_string_format_lock);
+    conversions = wi_dictionary_data_for_key(_wi_string_format_table, fmt);
+    wi_fast_lock_unlock(&_wi_string_format_lock);
+    
+    if(conversions)
+        return conversions;
+    
+    count = 0;
+    capacity = 4;
+    conversions = wi_malloc(capacity * sizeof(*conversions));
+    
+    for(p = fmt->string; ; count++) {
+        if(count == capacity) {
+            capacity *= 2;
+            conversions = wi_realloc(conversions, capacity * sizeof(*conversions));
+        }
         
-        if(!*pfmt)
-            return;
+        p = _wi_string_parse_conversion(p, &conversions[count]);
         
-        alt = star = h = hh = j = t = l = ll = L = z = false;
+        if(conversions[count].conversion == '\0')
+            break;
+    }
+    
+    wi_fast_lock_lock(&_wi_string_format_lock);
+    
+    existing_conversions = wi_dictionary_data_for_key(_wi_string_format_table, fmt);
+    
+    if(existing_conversions) {
+        wi_free(conversions);
         
-        ch          = *pfmt++;
-        cfmt[i++]   = ch;
+        conversions = existing_conversions;
+    } else {
+        wi_mutable_dictionary_set_data_for_key(_wi_string_format_table, conversions, fmt);
+    }
+    
+    wi_fast_lock_unlock(&_wi_string_format_lock);
+    
+    return conversions;
+}
+
 
-nextflag:
-        ch          = *pfmt++;
-        cfmt[i++]   = ch;
-        cfmt[i]     = '\0';
 
+static const char * _wi_string_parse_conversion(const char *fmt, _wi_string_conversion_t *conversion) {
+    wi_boolean_t    precision;
+    int             ch, number;
+    
+    conversion->literal = fmt;
+    
+    while(*fmt && *fmt != '%')
+        fmt++;
+    
+    conversion->literal_length  = fmt - conversion->literal;
+    conversion->conversion      = '\0';
+    conversion->flags           = 0;
+    conversion->modifier        = _WI_STRING_FORMAT_INT;
+    conversion->width           = _WI_STRING_FORMAT_NONE;
+    conversion->precision       = _WI_STRING_FORMAT_NONE;
+    
+    if(!*fmt)
+        return fmt;
+    
+    fmt++;
+    precision = false;
+    
+    while(true) {
+        ch = *fmt++;
+        
         switch(ch) {
             case '#':
-                alt = true;
-                
-                goto nextflag;
-                break;
-                
-            case '@':
-                description = wi_description(va_arg(ap, wi_runtime_instance_t *));
-                
-                if(description) {
-                    _wi_string_append_utf8_string(string, description->string);
-                    totalsize += description->length;
-                }
-                else if(!alt) {
-                    _wi_string_append_utf8_string(string, "(null)");
-                    totalsize += 6;
-                }
+                conversion->flags |= _WI_STRING_FORMAT_ALT;
                 break;
             
-            case ' ':
             case '-':
+                conversion->flags |= _WI_STRING_FORMAT_LEFT;
+                break;
+            
             case '+':
-            case '.':
+                conversion->flags |= _WI_STRING_FORMAT_PLUS;
+                break;
+            
+            case ' ':
+                conversion->flags |= _WI_STRING_FORMAT_SPACE;
+                break;
+            
             case '\'':
+                conversion->flags |= _WI_STRING_FORMAT_GROUPING;
+                break;
+            
+            case '.':
+                precision = true;
+                conversion->precision = 0;
+                break;
+            
+            case '*':
+                if(precision)
+                    conversion->precision = _WI_STRING_FORMAT_ARGUMENT;
+                else
+                    conversion->width = _WI_STRING_FORMAT_ARGUMENT;
+                break;
+            
             case '0':
             case '1':
             case '2':
@@ -600,169 +767,541 @@ nextflag:
             case '7':
             case '8':
             case '9':
-                goto nextflag;
-                break;
-            
-            case '*':
-                star = true;
-                length = va_arg(ap, int);
+                if(ch == '0' && !precision) {
+                    conversion->flags |= _WI_STRING_FORMAT_ZERO;
+                    
+                    break;
+                }
                 
-                goto nextflag;
-                break;
+                for(number = ch - '0'; *fmt >= '0' && *fmt <= '9'; fmt++) {
+                    if(number < 100000)
+                        number = (number * 10) + (*fmt - '0');
+                }
                 
-            case 'h':
-                if(h)
-                    hh = true;
+                if(precision)
+                    conversion->precision = number;
                 else
-                    h = true;
-
-                goto nextflag;
+                    conversion->width = number;
                 break;
-                
+            
+            case 'h':
+                conversion->modifier = (conversion->modifier == _WI_STRING_FORMAT_SHORT)
+                    ? _WI_STRING_FORMAT_CHAR
+                    : _WI_STRING_FORMAT_SHORT;
+                break;
+            
+            case 'l':
+                conversion->modifier = (conversion->modifier == _WI_STRING_FORMAT_LONG)
+                    ? _WI_STRING_FORMAT_LONG_LONG
+                    : _WI_STRING_FORMAT_LONG;
+                break;
+            
             case 'j':
-                j = true;
-                
-                goto nextflag;
+                conversion->modifier = _WI_STRING_FORMAT_INTMAX;
                 break;
             
             case 't':
-                t = true;
-                
-                goto nextflag;
+                conversion->modifier = _WI_STRING_FORMAT_PTRDIFF;
                 break;
             
-            case 'l':
-                if(l)
-                    ll = true;
-                else
-                    l = true;
-
-                goto nextflag;
+            case 'z':
+                conversion->modifier = _WI_STRING_FORMAT_SIZE;
                 break;
-
+            
             case 'L':
-                L = true;
-                
-                goto nextflag;
+                conversion->modifier = _WI_STRING_FORMAT_LONG_DOUBLE;
                 break;
             
-            case 'a':
-            case 'A':
-            case 'e':
-            case 'E':
-            case 'f':
-            case 'g':
-            case 'G':
-                if(L)
-                    size = snprintf(buffer, sizeof(buffer), cfmt, va_arg(ap, long double));
-                else
-                    size = snprintf(buffer, sizeof(buffer), cfmt, va_arg(ap, double));
-                
-                _wi_string_append_utf8_bytes(string, buffer, size);
-                totalsize += size;
-                break;
+            case '\0':
+                return fmt - 1;
+            
+            default:
+                conversion->conversion = ch;
                 
-            case 'c':
-            case 'D':
-            case 'd':
-            case 'i':
-            case 'O':
-            case 'o':
-            case 'p':
-            case 'U':
-            case 'u':
-            case 'X':
-            case 'x':
-                if(ll)
-                    size = snprintf(buffer, sizeof(buffer), cfmt, va_arg(ap, long long));
-                else if(l || ch == 'D' || ch == 'O' || ch == 'U')
-                    size = snprintf(buffer, sizeof(buffer), cfmt, va_arg(ap, long));
-                else if(ch == 'p')
-                    size = snprintf(buffer, sizeof(buffer), cfmt, va_arg(ap, void *));
-#ifdef HAVE_INTMAX_T
-                else if(j)
-                    size = snprintf(buffer, sizeof(buffer), cfmt, va_arg(ap, intmax_t));
-#endif
-#ifdef HAVE_PTRDIFF_T
-                else if(t)
-                    size = snprintf(buffer, sizeof(buffer), cfmt, va_arg(ap, ptrdiff_t));
-#endif
-                else if(z)
-                    size = snprintf(buffer, sizeof(buffer), cfmt, va_arg(ap, size_t));
-                else
-                    size = snprintf(buffer, sizeof(buffer), cfmt, va_arg(ap, int));
+                return fmt;
+        }
+    }
+}
+
+
+
+static void _wi_string_append_conversion(wi_string_t *string, const _wi_string_conversion_t *conversion, wi_uinteger_t start, va_list *ap) {
+    wi_runtime_instance_t   *instance;
+    wi_string_t             *description;
+    const char              *s;
+    char                    cfmt[_WI_STRING_FORMAT_BUFSIZ], ch;
+    intmax_t                value;
+    uintmax_t               magnitude;
+    double                  d;
+    wi_uinteger_t           length;
+    int                     flags, width, precision;
+    
+    flags       = conversion->flags;
+    width       = conversion->width;
+    precision   = conversion->precision;
+    
+    if(width == _WI_STRING_FORMAT_ARGUMENT) {
+        width = va_arg(*ap, int);
+        
+        if(width < 0) {
+            flags |= _WI_STRING_FORMAT_LEFT;
+            width = -width;
+        }
+    }
+    
+    if(precision == _WI_STRING_FORMAT_ARGUMENT) {
+        precision = va_arg(*ap, int);
+        
+        if(precision < 0)
+            precision = _WI_STRING_FORMAT_NONE;
+    }
+    
+    switch(conversion->conversion) {
+        case '@':
+            instance = va_arg(*ap, wi_runtime_instance_t *);
+            
+            if(instance) {
+                description = (wi_runtime_id(instance) == _wi_string_runtime_id) ? instance : wi_description(instance);
                 
-                _wi_string_append_utf8_bytes(string, buffer, size);
-                totalsize += size;
-                break;
+                if(description)
+                    _wi_string_append_utf8_bytes(string, description->string, description->length);
+            }
+            else if(!(flags & _WI_STRING_FORMAT_ALT)) {
+                _wi_string_append_utf8_bytes(string, "(null)", 6);
+            }
+            break;
+        
+        case 's':
+            s = va_arg(*ap, const char *);
             
-            case 'm':
-                description = wi_error_string();
-                _wi_string_append_utf8_string(string, description->string);
-                totalsize += description->length;
-                break;
+            if(s) {
+                if(precision == _WI_STRING_FORMAT_NONE) {
+                    length = strlen(s);
+                } else {
+                    for(length = 0; length < (wi_uinteger_t) precision && s[length]; length++)
+                        ;
+                }
+                
+                _wi_string_append_padded_bytes(string, s, length, flags, width);
+            }
+            else if(!(flags & _WI_STRING_FORMAT_ALT)) {
+                _wi_string_append_utf8_bytes(string, "(null)", 6);
+            }
+            break;
+        
+        case 'c':
+            ch = va_arg(*ap, int);
             
-            case 'n':
-                if(hh)
-                    *(va_arg(ap, signed char *)) = totalsize;
-                else if(h)
-                    *(va_arg(ap, short *)) = totalsize;
-                if(ll)
-                    *(va_arg(ap, long long *)) = totalsize;
-                else if(l)
-                    *(va_arg(ap, long *)) = totalsize;
-#ifdef HAVE_INTMAX_T
-                else if(j)
-                    *(va_arg(ap, intmax_t *)) = totalsize;
-#endif
-#ifdef HAVE_PTRDIFF_T
-                else if(t)
-                    *(va_arg(ap, ptrdiff_t *)) = totalsize;
-#endif
-                else if(z)
-                    *(va_arg(ap, size_t *)) = totalsize;
-                else
-                    *(va_arg(ap, int *)) = totalsize;
-                break;
+            _wi_string_append_padded_bytes(string, &ch, 1, flags, width);
+            break;
+        
+        case 'D':
+        case 'd':
+        case 'i':
+            if(conversion->conversion == 'D')
+                value = va_arg(*ap, long);
+            else
+                value = _wi_string_signed_argument(conversion->modifier, ap);
             
-            case 's':
-                s = va_arg(ap, char *);
+            if(flags & (_WI_STRING_FORMAT_PLUS | _WI_STRING_FORMAT_SPACE | _WI_STRING_FORMAT_GROUPING)) {
+                _wi_string_append_c_format(string, _wi_string_conversion_format(conversion, flags, width, precision, "j", cfmt),
+                                           value);
+            } else {
+                magnitude = (value < 0) ? -(uintmax_t) value : (uintmax_t) value;
                 
-                if(s) {
-                    if(star)
-                        size = wi_asprintf(&vbuffer, cfmt, length, s);
-                    else
-                        size = wi_asprintf(&vbuffer, cfmt, s);
+                _wi_string_append_integer(string, magnitude, (value < 0) ? "-" : NULL, 10, false, flags, width, precision);
+            }
+            break;
+        
+        case 'O':
+        case 'o':
+        case 'U':
+        case 'u':
+        case 'X':
+        case 'x':
+            if(conversion->conversion == 'O' || conversion->conversion == 'U')
+                magnitude = va_arg(*ap, unsigned long);
+            else
+                magnitude = _wi_string_unsigned_argument(conversion->modifier, ap);
+            
+            if(flags & (_WI_STRING_FORMAT_ALT | _WI_STRING_FORMAT_GROUPING)) {
+                _wi_string_append_c_format(string, _wi_string_conversion_format(conversion, flags, width, precision, "j", cfmt),
+                                           magnitude);
+            } else {
+                switch(conversion->conversion) {
+                    case 'O':
+                    case 'o':
+                        _wi_string_append_integer(string, magnitude, NULL, 8, false, flags, width, precision);
+                        break;
                     
-                    if(size > 0 && vbuffer) {
-                        _wi_string_append_utf8_bytes(string, vbuffer, size);
-                        totalsize += size;
-                        free(vbuffer);
-                    }
-                }
-                else if(!alt) {
-                    _wi_string_append_utf8_string(string, "(null)");
-                    totalsize += 6;
+                    case 'X':
+                    case 'x':
+                        _wi_string_append_integer(string, magnitude, NULL, 16, (conversion->conversion == 'X'), flags, width, precision);
+                        break;
+                    
+                    default:
+                        _wi_string_append_integer(string, magnitude, NULL, 10, false, flags, width, precision);
+                        break;
                 }
-                break;
+            }
+            break;
+        
+        case 'p':
+            s = va_arg(*ap, void *);
             
-            case 'z':
-                z = true;
-                
-                goto nextflag;
-                break;
-                
-            default:
-                if(ch == '\0')
-                    return;
+            /* How a null pointer is printed is up to the C library */
+            if(!s || flags & (_WI_STRING_FORMAT_PLUS | _WI_STRING_FORMAT_SPACE | _WI_STRING_FORMAT_ALT | _WI_STRING_FORMAT_GROUPING))
+                _wi_string_append_c_format(string, _wi_string_conversion_format(conversion, flags, width, precision, "", cfmt), s);
+            else
+                _wi_string_append_integer(string, (uintptr_t) s, "0x", 16, false, flags, width, precision);
+            break;
+        
+        case 'a':
+        case 'A':
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'g':
+        case 'G':
+            if(conversion->modifier == _WI_STRING_FORMAT_LONG_DOUBLE) {
+                _wi_string_append_c_format(string, _wi_string_conversion_format(conversion, flags, width, precision, "L", cfmt),
+                                           va_arg(*ap, long double));
+            } else {
+                d = va_arg(*ap, double);
                 
-                buffer[0] = ch;
+                if(conversion->conversion != 'f' ||
+                   flags & (_WI_STRING_FORMAT_PLUS | _WI_STRING_FORMAT_SPACE | _WI_STRING_FORMAT_ALT | _WI_STRING_FORMAT_GROUPING) ||
+                   !_wi_string_append_fixed_double(string, d, flags, width, precision)) {
+                    _wi_string_append_c_format(string, _wi_string_conversion_format(conversion, flags, width, precision, "", cfmt), d);
+                }
+            }
+            break;
+        
+        case 'm':
+            description = wi_error_string();
+            
+            _wi_string_append_utf8_bytes(string, description->string, description->length);
+            break;
+        
+        case 'n':
+            length = string->length - start;
+            
+            switch(conversion->modifier) {
+                case _WI_STRING_FORMAT_CHAR:        *(va_arg(*ap, signed char *)) = length;     break;
+                case _WI_STRING_FORMAT_SHORT:       *(va_arg(*ap, short *)) = length;           break;
+                case _WI_STRING_FORMAT_LONG:        *(va_arg(*ap, long *)) = length;            break;
+                case _WI_STRING_FORMAT_LONG_LONG:   *(va_arg(*ap, long long *)) = length;       break;
+                case _WI_STRING_FORMAT_INTMAX:      *(va_arg(*ap, intmax_t *)) = length;        break;
+                case _WI_STRING_FORMAT_PTRDIFF:     *(va_arg(*ap, ptrdiff_t *)) = length;       break;
+                case _WI_STRING_FORMAT_SIZE:        *(va_arg(*ap, size_t *)) = length;          break;
+                default:                            *(va_arg(*ap, int *)) = length;             break;
+            }
+            break;
+        
+        default:
+            ch = conversion->conversion;
+            
+            _wi_string_append_utf8_bytes(string, &ch, 1);
+            break;
+    }
+}
 
-                _wi_string_append_utf8_bytes(string, buffer, 1);
-                totalsize += 1;
-                break;
+
+
+static intmax_t _wi_string_signed_argument(int modifier, va_list *ap) {
+    switch(modifier) {
+        case _WI_STRING_FORMAT_CHAR:        return (signed char) va_arg(*ap, int);
+        case _WI_STRING_FORMAT_SHORT:       return (short) va_arg(*ap, int);
+        case _WI_STRING_FORMAT_LONG:        return va_arg(*ap, long);
+        case _WI_STRING_FORMAT_LONG_LONG:   return va_arg(*ap, long long);
+        case _WI_STRING_FORMAT_INTMAX:      return va_arg(*ap, intmax_t);
+        case _WI_STRING_FORMAT_PTRDIFF:     return va_arg(*ap, ptrdiff_t);
+        case _WI_STRING_FORMAT_SIZE:        return va_arg(*ap, ssize_t);
+        default:                            return va_arg(*ap, int);
+    }
+}
+
+
+
+static uintmax_t _wi_string_unsigned_argument(int modifier, va_list *ap) {
+    switch(modifier) {
+        case _WI_STRING_FORMAT_CHAR:        return (unsigned char) va_arg(*ap, unsigned int);
+        case _WI_STRING_FORMAT_SHORT:       return (unsigned short) va_arg(*ap, unsigned int);
+        case _WI_STRING_FORMAT_LONG:        return va_arg(*ap, unsigned long);
+        case _WI_STRING_FORMAT_LONG_LONG:   return va_arg(*ap, unsigned long long);
+        case _WI_STRING_FORMAT_INTMAX:      return va_arg(*ap, uintmax_t);
+        case _WI_STRING_FORMAT_PTRDIFF:     return (size_t) va_arg(*ap, ptrdiff_t);
+        case _WI_STRING_FORMAT_SIZE:        return va_arg(*ap, size_t);
+        default:                            return va_arg(*ap, unsigned int);
+    }
+}
+
+
+
+static void _wi_string_append_integer(wi_string_t *string, uintmax_t magnitude, const char *prefix, int base, wi_boolean_t uppercase, int flags, int width, int precision) {
+    static const char   digit_pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    const char          *digits;
+    char                buffer[_WI_STRING_FORMAT_BUFSIZ], *p;
+    wi_uinteger_t       length, prefix_length, zeros;
+    
+    p = buffer + sizeof(buffer);
+    
+    /* A zero precision prints nothing at all for zero */
+    if(magnitude > 0 || precision != 0) {
+        if(base == 10) {
+            while(magnitude >= 100) {
+                p -= 2;
+                memcpy(p, &digit_pairs[(magnitude % 100) * 2], 2);
+                magnitude /= 100;
+            }
+            
+            if(magnitude >= 10) {
+                p -= 2;
+                memcpy(p, &digit_pairs[magnitude * 2], 2);
+            } else {
+                *--p = '0' + magnitude;
+            }
+        } else {
+            digits = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+            
+            do {
+                *--p = digits[magnitude & (base - 1)];
+                magnitude = (base == 16) ? magnitude >> 4 : magnitude >> 3;
+            } while(magnitude > 0);
         }
     }
+    
+    length          = (buffer + sizeof(buffer)) - p;
+    prefix_length   = prefix ? strlen(prefix) : 0;
+    zeros           = (precision > 0 && (wi_uinteger_t) precision > length) ? precision - length : 0;
+    
+    if(precision == _WI_STRING_FORMAT_NONE && (flags & _WI_STRING_FORMAT_ZERO) && !(flags & _WI_STRING_FORMAT_LEFT) &&
+       width > 0 && (wi_uinteger_t) width > prefix_length + length)
+        zeros = width - prefix_length - length;
+    
+    _wi_string_append_padding(string, ' ', width, prefix_length + zeros + length, flags, false);
+    
+    if(prefix_length > 0)
+        _wi_string_append_utf8_bytes(string, prefix, prefix_length);
+    
+    _wi_string_append_padding(string, '0', zeros, 0, 0, false);
+    _wi_string_append_utf8_bytes(string, p, length);
+    _wi_string_append_padding(string, ' ', width, prefix_length + zeros + length, flags, true);
+}
+
+
+
+static wi_boolean_t _wi_string_append_fixed_double(wi_string_t *string, double d, int flags, int width, int precision) {
+#ifdef __SIZEOF_INT128__
+    static const uint64_t   powers[] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+        1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+        100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL
+    };
+    unsigned __int128       n, remainder, half;
+    uint64_t                bits, mantissa, q, scale;
+    char                    buffer[_WI_STRING_FORMAT_BUFSIZ], *p;
+    wi_uinteger_t           length, zeros;
+    int                     exponent, shift, i;
+    wi_boolean_t            negative;
+    
+    if(precision == _WI_STRING_FORMAT_NONE)
+        precision = 6;
+    
+    if(precision >= (int) WI_ARRAY_SIZE(powers))
+        return false;
+    
+    memcpy(&bits, &d, sizeof(bits));
+    
+    negative    = (bits >> 63) != 0;
+    exponent    = (bits >> 52) & 0x7FF;
+    mantissa    = bits & 0xFFFFFFFFFFFFFULL;
+    scale       = powers[precision];
+    
+    if(exponent == 0x7FF)
+        return false;
+    
+    if(exponent == 0) {
+        exponent = -1074;
+    } else {
+        mantissa |= 1ULL << 52;
+        exponent -= 1075;
+    }
+    
+    /* The value is exactly mantissa * 2^exponent, so scaling it by the
+       precision and rounding half to even gives the same digits as printf */
+    if(mantissa == 0) {
+        q = 0;
+    }
+    else if(exponent >= 0) {
+        if(exponent > 10)
+            return false;
+        
+        n = ((unsigned __int128) mantissa << exponent) * scale;
+        
+        if(n >> 64)
+            return false;
+        
+        q = n;
+    }
+    else {
+        shift = -exponent;
+        
+        if(shift >= 128) {
+            q = 0;
+        } else {
+            n           = (unsigned __int128) mantissa * scale;
+            remainder   = n & ((((unsigned __int128) 1) << shift) - 1);
+            half        = ((unsigned __int128) 1) << (shift - 1);
+            n         >>= shift;
+            
+            if(remainder > half || (remainder == half && (n & 1)))
+                n++;
+            
+            if(n >> 64)
+                return false;
+            
+            q = n;
+        }
+    }
+    
+    p = buffer + sizeof(buffer);
+    
+    if(precision > 0) {
+        for(i = 0; i < precision; i++) {
+            *--p = '0' + (q % 10);
+            q /= 10;
+        }
+        
+        *--p = '.';
+    }
+    
+    do {
+        *--p = '0' + (q % 10);
+        q /= 10;
+    } while(q > 0);
+    
+    length = (buffer + sizeof(buffer)) - p;
+    zeros = 0;
+    
+    if((flags & _WI_STRING_FORMAT_ZERO) && !(flags & _WI_STRING_FORMAT_LEFT) && width > 0 && (wi_uinteger_t) width > negative + length)
+        zeros = width - negative - length;
+    
+    _wi_string_append_padding(string, ' ', width, negative + zeros + length, flags, false);
+    
+    if(negative)
+        _wi_string_append_utf8_bytes(string, "-", 1);
+    
+    _wi_string_append_padding(string, '0', zeros, 0, 0, false);
+    _wi_string_append_utf8_bytes(string, p, length);
+    _wi_string_append_padding(string, ' ', width, negative + zeros + length, flags, true);
+    
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+
+static void _wi_string_append_padded_bytes(wi_string_t *string, const char *bytes, wi_uinteger_t length, int flags, int width) {
+    _wi_string_append_padding(string, ' ', width, length, flags, false);
+    _wi_string_append_utf8_bytes(string, bytes, length);
+    _wi_string_append_padding(string, ' ', width, length, flags, true);
+}
+
+
+
+static void _wi_string_append_padding(wi_string_t *string, char ch, int width, wi_uinteger_t length, int flags, wi_boolean_t left) {
+    wi_uinteger_t   count;
+    
+    if(width <= 0 || (wi_uinteger_t) width <= length)
+        return;
+    
+    if(((flags & _WI_STRING_FORMAT_LEFT) != 0) != left)
+        return;
+    
+    count = width - length;
+    
+    _WI_STRING_GROW(string, count);
+    
+    memset(string->string + string->length, ch, count);
+    
+    string->length += count;
+    string->string[string->length] = '\0';
+}
+
+
+
+static const char * _wi_string_conversion_format(const _wi_string_conversion_t *conversion, int flags, int width, int precision, const char *modifier, char *buffer) {
+    char    *p = buffer;
+    
+    *p++ = '%';
+    
+    if(flags & _WI_STRING_FORMAT_ALT)
+        *p++ = '#';
+    
+    if(flags & _WI_STRING_FORMAT_LEFT)
+        *p++ = '-';
+    
+    if(flags & _WI_STRING_FORMAT_PLUS)
+        *p++ = '+';
+    
+    if(flags & _WI_STRING_FORMAT_SPACE)
+        *p++ = ' ';
+    
+    if(flags & _WI_STRING_FORMAT_GROUPING)
+        *p++ = '\'';
+    
+    if(flags & _WI_STRING_FORMAT_ZERO)
+        *p++ = '0';
+    
+    if(width > 0)
+        p += sprintf(p, "%d", width);
+    
+    if(precision >= 0)
+        p += sprintf(p, ".%d", precision);
+    
+    while(*modifier)
+        *p++ = *modifier++;
+    
+    *p++ = conversion->conversion;
+    *p = '\0';
+    
+    return buffer;
+}
+
+
+
+static void _wi_string_append_c_format(wi_string_t *string, const char *fmt, ...) {
+    va_list         ap;
+    wi_uinteger_t   available;
+    int             size;
+    
+    available = string->capacity - string->length;
+    
+    va_start(ap, fmt);
+    size = vsnprintf(string->string + string->length, available, fmt, ap);
+    va_end(ap);
+    
+    if(size < 0) {
+        string->string[string->length] = '\0';
+        
+        return;
+    }
+    
+    if((wi_uinteger_t) size >= available) {
+        _WI_STRING_GROW(string, (wi_uinteger_t) size);
+        
+        va_start(ap, fmt);
+        (void) vsnprintf(string->string + string->length, size + 1, fmt, ap);
+        va_end(ap);
+    }
+    
+    string->length += size;
 }
 
 
@@ -1537,13 +2076,21 @@ void wi_mutable_string_append_string(wi_mutable_string_t *string, wi_string_t *o
 
 
 
+void wi_mutable_string_append_utf8_bytes(wi_mutable_string_t *string, const void *buffer, wi_uinteger_t length) {
+    WI_RUNTIME_ASSERT_MUTABLE(string);
+    
+    _wi_string_append_utf8_bytes(string, buffer, length);
+}
+
+
+
 void wi_mutable_string_append_format(wi_mutable_string_t *string, wi_string_t *fmt, ...) {
     va_list     ap;
     
     WI_RUNTIME_ASSERT_MUTABLE(string);
     
     va_start(ap, fmt);
-    _wi_string_append_arguments(string, wi_string_utf8_string(fmt), ap);
+    _wi_string_append_arguments(string, fmt, ap);
     va_end(ap);
 }
 
@@ -1552,7 +2099,7 @@ void wi_mutable_string_append_format(wi_mutable_string_t *string, wi_string_t *f
 void wi_mutable_string_append_format_and_arguments(wi_mutable_string_t *string, wi_string_t *fmt, va_list ap) {
     WI_RUNTIME_ASSERT_MUTABLE(string);
     
-    _wi_string_append_arguments(string, wi_string_utf8_string(fmt), ap);
+    _wi_string_append_arguments(string, fmt, ap);
 }
 
 
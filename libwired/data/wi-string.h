@@ -146,6 +146,7 @@ WI_EXPORT void                              wi_mutable_string_set_format(wi_stri
 WI_EXPORT void                              wi_mutable_string_set_format_and_arguments(wi_string_t *, wi_string_t *, va_list);
 
 WI_EXPORT void                              wi_mutable_string_append_string(wi_mutable_string_t *, wi_string_t *);
+WI_EXPORT void                              wi_mutable_string_append_utf8_bytes(wi_mutable_string_t *, const void *, wi_uinteger_t);
 WI_EXPORT void                              wi_mutable_string_append_format(wi_mutable_string_t *, wi_string_t *, ...);
 WI_EXPORT void                              wi_mutable_string_append_format_and_arguments(wi_mutable_string_t *, wi_string_t *, va_list);
 
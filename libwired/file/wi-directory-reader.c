@@ -0,0 +1,400 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+
+#ifdef SYS_getdents64
+#define _WI_DIRECTORY_READER_GETDENTS       1
+#endif
+#endif
+
+#include <wired/wi-directory-reader.h>
+#include <wired/wi-error.h>
+#include <wired/wi-private.h>
+#include <wired/wi-string.h>
+#include <wired/wi-system.h>
+
+#define _WI_DIRECTORY_READER_BUFFER_SIZE    (64 * 1024)
+
+
+#ifdef _WI_DIRECTORY_READER_GETDENTS
+
+struct _wi_directory_reader_dirent {
+    uint64_t                                d_ino;
+    int64_t                                 d_off;
+    unsigned short                          d_reclen;
+    unsigned char                           d_type;
+    char                                    d_name[];
+};
+typedef struct _wi_directory_reader_dirent  _wi_directory_reader_dirent_t;
+
+#endif
+
+
+struct _wi_directory_reader {
+    wi_runtime_base_t                       base;
+    
+    wi_string_t                             *path;
+    int                                     fd;
+    
+#ifdef _WI_DIRECTORY_READER_GETDENTS
+    char                                    *buffer;
+    wi_uinteger_t                           offset;
+    wi_uinteger_t                           length;
+#else
+    DIR                                     *dir;
+#endif
+};
+
+
+static void                                 _wi_directory_reader_dealloc(wi_runtime_instance_t *);
+static wi_string_t *                        _wi_directory_reader_description(wi_runtime_instance_t *);
+
+static wi_directory_entry_type_t            _wi_directory_reader_type_for_dirent_type(unsigned char);
+static wi_directory_entry_type_t            _wi_directory_reader_type_for_mode(mode_t);
+
+
+static wi_runtime_id_t                      _wi_directory_reader_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t                   _wi_directory_reader_runtime_class = {
+    "wi_directory_reader_t",
+    _wi_directory_reader_dealloc,
+    NULL,
+    NULL,
+    _wi_directory_reader_description,
+    NULL
+};
+
+
+
+void wi_directory_reader_register(void) {
+    _wi_directory_reader_runtime_id = wi_runtime_register_class(&_wi_directory_reader_runtime_class);
+}
+
+
+
+void wi_directory_reader_initialize(void) {
+}
+
+
+
+#pragma mark -
+
+wi_runtime_id_t wi_directory_reader_runtime_id(void) {
+    return _wi_directory_reader_runtime_id;
+}
+
+
+
+#pragma mark -
+
+wi_directory_reader_t * wi_directory_reader_alloc(void) {
+    return wi_runtime_create_instance(_wi_directory_reader_runtime_id, sizeof(wi_directory_reader_t));
+}
+
+
+
+wi_directory_reader_t * wi_directory_reader_init_with_path(wi_directory_reader_t *reader, wi_string_t *path) {
+#ifndef _WI_DIRECTORY_READER_GETDENTS
+    int         fd;
+#endif
+    
+    reader->fd = open(wi_string_utf8_string(path), O_RDONLY | O_DIRECTORY);
+    
+    if(reader->fd < 0) {
+        wi_error_set_errno(errno);
+        wi_release(reader);
+        
+        return NULL;
+    }
+    
+#ifdef _WI_DIRECTORY_READER_GETDENTS
+    reader->buffer = wi_malloc(_WI_DIRECTORY_READER_BUFFER_SIZE);
+#else
+    /* The stream reads from its own descriptor, the original one is kept for fstatat() */
+    fd = dup(reader->fd);
+    reader->dir = (fd >= 0) ? fdopendir(fd) : NULL;
+    
+    if(!reader->dir) {
+        wi_error_set_errno(errno);
+        
+        if(fd >= 0)
+            close(fd);
+        
+        wi_release(reader);
+        
+        return NULL;
+    }
+#endif
+    
+    reader->path = wi_copy(path);
+    
+    return reader;
+}
+
+
+
+static void _wi_directory_reader_dealloc(wi_runtime_instance_t *instance) {
+    wi_directory_reader_t   *reader = instance;
+    
+#ifdef _WI_DIRECTORY_READER_GETDENTS
+    wi_free(reader->buffer);
+#else
+    if(reader->dir)
+        closedir(reader->dir);
+#endif
+    
+    if(reader->fd >= 0)
+        close(reader->fd);
+    
+    wi_release(reader->path);
+}
+
+
+
+static wi_string_t * _wi_directory_reader_description(wi_runtime_instance_t *instance) {
+    wi_directory_reader_t   *reader = instance;
+    
+    return wi_string_with_format(WI_STR("<%@ %p>{path = %@}"),
+        wi_runtime_class_name(reader),
+        reader,
+        reader->path);
+}
+
+
+
+#pragma mark -
+
+static wi_directory_entry_type_t _wi_directory_reader_type_for_dirent_type(unsigned char type) {
+    switch(type) {
+        case DT_REG:    return WI_DIRECTORY_ENTRY_FILE;
+        case DT_DIR:    return WI_DIRECTORY_ENTRY_DIRECTORY;
+        case DT_LNK:    return WI_DIRECTORY_ENTRY_SYMBOLIC_LINK;
+        case DT_UNKNOWN:return WI_DIRECTORY_ENTRY_UNKNOWN;
+        default:        return WI_DIRECTORY_ENTRY_OTHER;
+    }
+}
+
+
+
+static wi_directory_entry_type_t _wi_directory_reader_type_for_mode(mode_t mode) {
+    if(S_ISREG(mode))
+        return WI_DIRECTORY_ENTRY_FILE;
+    else if(S_ISDIR(mode))
+        return WI_DIRECTORY_ENTRY_DIRECTORY;
+    else if(S_ISLNK(mode))
+        return WI_DIRECTORY_ENTRY_SYMBOLIC_LINK;
+    
+    return WI_DIRECTORY_ENTRY_OTHER;
+}
+
+
+
+#pragma mark -
+
+wi_directory_reader_status_t wi_directory_reader_read_entry(wi_directory_reader_t *reader, wi_directory_entry_t *entry) {
+#ifdef _WI_DIRECTORY_READER_GETDENTS
+    _wi_directory_reader_dirent_t   *de;
+    long                            bytes;
+    
+    while(true) {
+        if(reader->offset >= reader->length) {
+            bytes = syscall(SYS_getdents64, reader->fd, reader->buffer, _WI_DIRECTORY_READER_BUFFER_SIZE);
+            
+            if(bytes < 0) {
+                if(errno == EINTR)
+                    continue;
+                
+                wi_error_set_errno(errno);
+                
+                return WI_DIRECTORY_READER_ERROR;
+            }
+            
+            if(bytes == 0)
+                return WI_DIRECTORY_READER_EOF;
+            
+            reader->offset = 0;
+            reader->length = bytes;
+        }
+        
+        de = (_wi_directory_reader_dirent_t *) (reader->buffer + reader->offset);
+        reader->offset += de->d_reclen;
+        
+        if(de->d_name[0] == '.' && (de->d_name[1] == '\0' || (de->d_name[1] == '.' && de->d_name[2] == '\0')))
+            continue;
+        
+        entry->name             = de->d_name;
+        entry->name_length      = strlen(de->d_name);
+        entry->type             = _wi_directory_reader_type_for_dirent_type(de->d_type);
+        entry->inode            = de->d_ino;
+        
+        return WI_DIRECTORY_READER_ENTRY;
+    }
+#else
+    struct dirent       *de;
+    
+    while(true) {
+        errno = 0;
+        de = readdir(reader->dir);
+        
+        if(!de) {
+            if(errno != 0) {
+                wi_error_set_errno(errno);
+                
+                return WI_DIRECTORY_READER_ERROR;
+            }
+            
+            return WI_DIRECTORY_READER_EOF;
+        }
+        
+        if(strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        
+        entry->name             = de->d_name;
+        entry->name_length      = strlen(de->d_name);
+#ifdef DT_DIR
+        entry->type             = _wi_directory_reader_type_for_dirent_type(de->d_type);
+#else
+        entry->type             = WI_DIRECTORY_ENTRY_UNKNOWN;
+#endif
+        entry->inode            = de->d_ino;
+        
+        return WI_DIRECTORY_READER_ENTRY;
+    }
+#endif
+}
+
+
+
+wi_boolean_t wi_directory_reader_get_stats_for_entry(wi_directory_reader_t *reader, wi_directory_entry_t *entry, wi_directory_entry_fields_t fields, wi_directory_entry_stats_t *stats) {
+#ifdef HAVE_STATX
+    struct statx        stx;
+    unsigned int        mask = 0;
+#endif
+    struct stat         sb;
+    
+#ifdef HAVE_STATX
+    if(fields & (WI_DIRECTORY_ENTRY_TYPE | WI_DIRECTORY_ENTRY_MODE))
+        mask |= STATX_TYPE | STATX_MODE;
+    
+    if(fields & WI_DIRECTORY_ENTRY_SIZE)
+        mask |= STATX_SIZE;
+    
+    if(fields & WI_DIRECTORY_ENTRY_OWNER)
+        mask |= STATX_UID | STATX_GID;
+    
+    if(fields & WI_DIRECTORY_ENTRY_MODIFICATION_TIME)
+        mask |= STATX_MTIME;
+    
+    /* Only the requested fields are asked for, network filesystems may skip a round trip for the rest */
+    if(statx(reader->fd, entry->name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, mask, &stx) == 0) {
+        /* Filesystems may leave out fields that were asked for, fstatat() below fills those in */
+        if((stx.stx_mask & mask) == mask) {
+            if(fields & WI_DIRECTORY_ENTRY_TYPE)
+                entry->type = _wi_directory_reader_type_for_mode(stx.stx_mode);
+            
+            stats->mode                 = stx.stx_mode;
+            stats->size                 = stx.stx_size;
+            stats->uid                  = stx.stx_uid;
+            stats->gid                  = stx.stx_gid;
+            stats->modification_time    = stx.stx_mtime.tv_sec + ((double) stx.stx_mtime.tv_nsec / 1000000000.0);
+            
+            return true;
+        }
+    } else if(errno != ENOSYS) {
+        wi_error_set_errno(errno);
+        
+        return false;
+    }
+#endif
+    
+    if(fstatat(reader->fd, entry->name, &sb, AT_SYMLINK_NOFOLLOW) < 0) {
+        wi_error_set_errno(errno);
+        
+        return false;
+    }
+    
+    if(fields & WI_DIRECTORY_ENTRY_TYPE)
+        entry->type = _wi_directory_reader_type_for_mode(sb.st_mode);
+    
+    stats->mode                 = sb.st_mode;
+    stats->size                 = sb.st_size;
+    stats->uid                  = sb.st_uid;
+    stats->gid                  = sb.st_gid;
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+    stats->modification_time    = sb.st_mtim.tv_sec + ((double) sb.st_mtim.tv_nsec / 1000000000.0);
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    stats->modification_time    = sb.st_mtimespec.tv_sec + ((double) sb.st_mtimespec.tv_nsec / 1000000000.0);
+#else
+    stats->modification_time    = sb.st_mtime;
+#endif
+    
+    return true;
+}
+
+
+
+wi_string_t * wi_directory_reader_path_for_entry(wi_directory_reader_t *reader, wi_directory_entry_t *entry) {
+    wi_string_t     *path;
+    const char      *directory;
+    char            *buffer;
+    wi_uinteger_t   length;
+    
+    directory = wi_string_utf8_string(reader->path);
+    length = strlen(directory);
+    buffer = wi_malloc(length + entry->name_length + 2);
+    
+    memcpy(buffer, directory, length);
+    
+    /* Paths like "/" already end in a separator */
+    if(length == 0 || buffer[length - 1] != '/')
+        buffer[length++] = '/';
+    
+    memcpy(buffer + length, entry->name, entry->name_length);
+    
+    path = wi_string_with_utf8_bytes(buffer, length + entry->name_length);
+    
+    wi_free(buffer);
+    
+    return path;
+}
+
+
+
+wi_string_t * wi_directory_reader_path(wi_directory_reader_t *reader) {
+    return reader->path;
+}
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WI_DIRECTORY_READER_H
+#define WI_DIRECTORY_READER_H 1
+
+#include <wired/wi-base.h>
+#include <wired/wi-runtime.h>
+
+enum _wi_directory_reader_status {
+    WI_DIRECTORY_READER_EOF,
+    WI_DIRECTORY_READER_ERROR,
+    WI_DIRECTORY_READER_ENTRY
+};
+typedef enum _wi_directory_reader_status        wi_directory_reader_status_t;
+
+enum _wi_directory_entry_type {
+    WI_DIRECTORY_ENTRY_UNKNOWN,
+    WI_DIRECTORY_ENTRY_FILE,
+    WI_DIRECTORY_ENTRY_DIRECTORY,
+    WI_DIRECTORY_ENTRY_SYMBOLIC_LINK,
+    WI_DIRECTORY_ENTRY_OTHER
+};
+typedef enum _wi_directory_entry_type           wi_directory_entry_type_t;
+
+enum _wi_directory_entry_fields {
+    WI_DIRECTORY_ENTRY_TYPE                     = (1 << 0),
+    WI_DIRECTORY_ENTRY_MODE                     = (1 << 1),
+    WI_DIRECTORY_ENTRY_SIZE                     = (1 << 2),
+    WI_DIRECTORY_ENTRY_OWNER                    = (1 << 3),
+    WI_DIRECTORY_ENTRY_MODIFICATION_TIME        = (1 << 4)
+};
+typedef enum _wi_directory_entry_fields         wi_directory_entry_fields_t;
+
+struct _wi_directory_entry {
+    const char                                  *name;
+    wi_uinteger_t                               name_length;
+    wi_directory_entry_type_t                   type;
+    uint64_t                                    inode;
+};
+typedef struct _wi_directory_entry              wi_directory_entry_t;
+
+struct _wi_directory_entry_stats {
+    uint32_t                                    mode;
+    uint64_t                                    size;
+    uint32_t                                    uid;
+    uint32_t                                    gid;
+    wi_time_interval_t                          modification_time;
+};
+typedef struct _wi_directory_entry_stats        wi_directory_entry_stats_t;
+
+
+WI_EXPORT wi_runtime_id_t                       wi_directory_reader_runtime_id(void);
+
+WI_EXPORT wi_directory_reader_t *               wi_directory_reader_alloc(void);
+WI_EXPORT wi_directory_reader_t *               wi_directory_reader_init_with_path(wi_directory_reader_t *, wi_string_t *);
+
+WI_EXPORT wi_directory_reader_status_t          wi_directory_reader_read_entry(wi_directory_reader_t *, wi_directory_entry_t *);
+WI_EXPORT wi_boolean_t                          wi_directory_reader_get_stats_for_entry(wi_directory_reader_t *, wi_directory_entry_t *, wi_directory_entry_fields_t, wi_directory_entry_stats_t *);
+WI_EXPORT wi_string_t *                         wi_directory_reader_path_for_entry(wi_directory_reader_t *, wi_directory_entry_t *);
+WI_EXPORT wi_string_t *                         wi_directory_reader_path(wi_directory_reader_t *);
+
+#endif /* WI_DIRECTORY_READER_H */
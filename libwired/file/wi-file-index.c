@@ -0,0 +1,1157 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include <wired/wi-array.h>
+#include <wired/wi-data.h>
+#include <wired/wi-dictionary.h>
+#include <wired/wi-error.h>
+#include <wired/wi-file.h>
+#include <wired/wi-file-index.h>
+#include <wired/wi-pool.h>
+#include <wired/wi-private.h>
+#include <wired/wi-readwrite-lock.h>
+#include <wired/wi-string.h>
+#include <wired/wi-system.h>
+
+#define _WI_FILE_INDEX_MAGIC                    "WIFIDX1"
+#define _WI_FILE_INDEX_VERSION                  1
+
+#define _WI_FILE_INDEX_COMPACT_THRESHOLD        4096
+
+#define _WI_FILE_INDEX_ALIGN(n)                 (((n) + 7) & ~((wi_uinteger_t) 7))
+
+
+/*
+ * The on-disk image is a header, the root path, fixed size records sorted
+ * by relative path, the record indexes sorted by name for name searches,
+ * and finally the NUL terminated relative paths. It is mapped as is.
+ */
+struct _wi_file_index_header {
+    char                                        magic[8];
+    uint32_t                                    version;
+    uint32_t                                    root_length;
+    uint64_t                                    count;
+    uint64_t                                    strings_size;
+};
+typedef struct _wi_file_index_header            _wi_file_index_header_t;
+
+struct _wi_file_index_record {
+    uint64_t                                    size;
+    double                                      modification_time;
+    uint64_t                                    path_offset;
+    uint32_t                                    path_length;
+    uint32_t                                    name_offset;
+    uint32_t                                    type;
+    uint32_t                                    reserved;
+};
+typedef struct _wi_file_index_record            _wi_file_index_record_t;
+
+
+struct _wi_file_index_scan_entry {
+    char                                        *path;
+    uint32_t                                    path_length;
+    uint32_t                                    name_offset;
+    wi_file_index_entry_t                       entry;
+};
+typedef struct _wi_file_index_scan_entry        _wi_file_index_scan_entry_t;
+
+struct _wi_file_index_scan_entries {
+    _wi_file_index_scan_entry_t                 *entries;
+    wi_uinteger_t                               count;
+    wi_uinteger_t                               capacity;
+};
+typedef struct _wi_file_index_scan_entries      _wi_file_index_scan_entries_t;
+
+struct _wi_file_index_scan {
+    wi_uinteger_t                               root_length;
+    _wi_file_index_scan_entries_t               *entries;
+};
+typedef struct _wi_file_index_scan              _wi_file_index_scan_t;
+
+
+struct _wi_file_index_change {
+    wi_runtime_base_t                           base;
+    
+    wi_boolean_t                                deleted;
+    wi_file_index_entry_t                       entry;
+};
+typedef struct _wi_file_index_change            _wi_file_index_change_t;
+
+
+struct _wi_file_index {
+    wi_runtime_base_t                           base;
+    
+    wi_string_t                                 *root;
+    
+    wi_data_t                                   *image;
+    const _wi_file_index_record_t               *records;
+    const uint32_t                              *names;
+    const char                                  *strings;
+    wi_uinteger_t                               records_count;
+    
+    /* Updates since the image was built, keyed by relative path */
+    wi_mutable_dictionary_t                     *changes;
+    wi_uinteger_t                               count;
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_t                         *lock;
+#endif
+};
+
+
+static void                                     _wi_file_index_dealloc(wi_runtime_instance_t *);
+static wi_string_t *                            _wi_file_index_description(wi_runtime_instance_t *);
+
+static wi_boolean_t                             _wi_file_index_set_image(wi_file_index_t *, wi_data_t *);
+static wi_data_t *                              _wi_file_index_image_with_entries(wi_string_t *, _wi_file_index_scan_entries_t *);
+static int                                      _wi_file_index_compare_entries(const void *, const void *);
+static int                                      _wi_file_index_compare_names(const void *, const void *);
+static void                                     _wi_file_index_compact(wi_file_index_t *);
+
+static const char *                             _wi_file_index_relative_path(wi_file_index_t *, wi_string_t *);
+static wi_boolean_t                             _wi_file_index_path_is_hidden(const char *);
+static wi_boolean_t                             _wi_file_index_find_record(wi_file_index_t *, const char *, wi_uinteger_t *);
+static wi_boolean_t                             _wi_file_index_get_entry(wi_file_index_t *, wi_string_t *, wi_file_index_entry_t *);
+static void                                     _wi_file_index_set_entry(wi_file_index_t *, wi_string_t *, wi_file_index_entry_t *);
+static void                                     _wi_file_index_remove_path(wi_file_index_t *, wi_string_t *, wi_boolean_t);
+static wi_boolean_t                             _wi_file_index_update_path(wi_file_index_t *, wi_string_t *, wi_boolean_t);
+static wi_boolean_t                             _wi_file_index_name_matches(const char *, const char *, wi_uinteger_t, wi_file_index_match_options_t);
+static wi_file_type_t                           _wi_file_index_type_for_mode(mode_t);
+
+static void                                     _wi_file_index_scan_entries_append(_wi_file_index_scan_entries_t *, _wi_file_index_scan_entry_t *, wi_uinteger_t);
+static void                                     _wi_file_index_scan_entries_free(_wi_file_index_scan_entries_t *);
+static char *                                   _wi_file_index_copy_path(const char *, wi_uinteger_t);
+static wi_boolean_t                             _wi_file_index_scan_path(wi_string_t *, const char *, _wi_file_index_scan_entries_t *);
+static void                                     _wi_file_index_scan_directory(const char *, wi_filesystem_walk_entry_t *, wi_uinteger_t, void *);
+
+static _wi_file_index_change_t *                _wi_file_index_change_with_entry(wi_file_index_entry_t *);
+
+
+static wi_runtime_id_t                          _wi_file_index_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t                       _wi_file_index_runtime_class = {
+    "wi_file_index_t",
+    _wi_file_index_dealloc,
+    NULL,
+    NULL,
+    _wi_file_index_description,
+    NULL
+};
+
+static wi_runtime_id_t                          _wi_file_index_change_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t                       _wi_file_index_change_runtime_class = {
+    "_wi_file_index_change_t",
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+
+void wi_file_index_register(void) {
+    _wi_file_index_runtime_id = wi_runtime_register_class(&_wi_file_index_runtime_class);
+    _wi_file_index_change_runtime_id = wi_runtime_register_class(&_wi_file_index_change_runtime_class);
+}
+
+
+
+void wi_file_index_initialize(void) {
+}
+
+
+
+#pragma mark -
+
+wi_runtime_id_t wi_file_index_runtime_id(void) {
+    return _wi_file_index_runtime_id;
+}
+
+
+
+#pragma mark -
+
+wi_file_index_t * wi_file_index_alloc(void) {
+    return wi_runtime_create_instance(_wi_file_index_runtime_id, sizeof(wi_file_index_t));
+}
+
+
+
+wi_file_index_t * wi_file_index_init_with_path(wi_file_index_t *index, wi_string_t *path) {
+    _wi_file_index_scan_entries_t   entries;
+    wi_data_t                       *image;
+    wi_mutable_string_t             *root;
+    
+    root = wi_mutable_copy(path);
+    
+    while(wi_string_length(root) > 1 && wi_string_has_suffix(root, WI_STR("/")))
+        wi_mutable_string_delete_characters_from_index(root, wi_string_length(root) - 1);
+    
+    index->root = root;
+    index->changes = wi_dictionary_init(wi_mutable_dictionary_alloc());
+    
+#ifdef WI_PTHREADS
+    index->lock = wi_readwrite_lock_init(wi_readwrite_lock_alloc());
+#endif
+    
+    memset(&entries, 0, sizeof(entries));
+    
+    if(!_wi_file_index_scan_path(index->root, "", &entries)) {
+        wi_release(index);
+        
+        return NULL;
+    }
+    
+    qsort(entries.entries, entries.count, sizeof(_wi_file_index_scan_entry_t), _wi_file_index_compare_entries);
+    
+    image = _wi_file_index_image_with_entries(index->root, &entries);
+    
+    _wi_file_index_scan_entries_free(&entries);
+    
+    _wi_file_index_set_image(index, image);
+    
+    index->count = index->records_count;
+    
+    return index;
+}
+
+
+
+wi_file_index_t * wi_file_index_init_with_contents_of_file(wi_file_index_t *index, wi_string_t *path) {
+    const _wi_file_index_header_t   *header;
+    wi_file_t                       *file;
+    wi_data_t                       *image;
+    
+    file = wi_file_for_reading(path);
+    
+    if(!file) {
+        wi_release(index);
+        
+        return NULL;
+    }
+    
+    /* The image is used straight from the mapping, pages are only read as they are touched */
+    image = wi_file_map_with_advice(file, 0, 0, WI_FILE_ADVICE_RANDOM);
+    
+    if(!image || !_wi_file_index_set_image(index, image)) {
+        wi_release(index);
+        
+        return NULL;
+    }
+    
+    header = wi_data_bytes(image);
+    
+    index->root = wi_string_init_with_utf8_bytes(wi_string_alloc(), (const char *) (header + 1), header->root_length);
+    index->changes = wi_dictionary_init(wi_mutable_dictionary_alloc());
+    index->count = index->records_count;
+    
+#ifdef WI_PTHREADS
+    index->lock = wi_readwrite_lock_init(wi_readwrite_lock_alloc());
+#endif
+    
+    return index;
+}
+
+
+
+static void _wi_file_index_dealloc(wi_runtime_instance_t *instance) {
+    wi_file_index_t     *index = instance;
+    
+    wi_release(index->root);
+    wi_release(index->image);
+    wi_release(index->changes);
+    
+#ifdef WI_PTHREADS
+    wi_release(index->lock);
+#endif
+}
+
+
+
+static wi_string_t * _wi_file_index_description(wi_runtime_instance_t *instance) {
+    wi_file_index_t     *index = instance;
+    
+    return wi_string_with_format(WI_STR("<%@ %p>{root = %@, count = %lu}"),
+        wi_runtime_class_name(index),
+        index,
+        index->root,
+        index->count);
+}
+
+
+
+#pragma mark -
+
+static wi_boolean_t _wi_file_index_set_image(wi_file_index_t *index, wi_data_t *image) {
+    const _wi_file_index_header_t   *header;
+    const _wi_file_index_record_t   *records;
+    const uint32_t                  *names;
+    const char                      *bytes, *root, *strings;
+    wi_uinteger_t                   i, length, offset;
+    
+    bytes = wi_data_bytes(image);
+    length = wi_data_length(image);
+    header = (const _wi_file_index_header_t *) bytes;
+    
+    if(length < sizeof(_wi_file_index_header_t) ||
+       memcmp(header->magic, _WI_FILE_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != _WI_FILE_INDEX_VERSION) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_FILE_INDEX_READFAILED, WI_STR("Invalid header"));
+        
+        return false;
+    }
+    
+    offset = sizeof(_wi_file_index_header_t) + _WI_FILE_INDEX_ALIGN(header->root_length + 1);
+    
+    if(header->count > length / sizeof(_wi_file_index_record_t) ||
+       header->strings_size > length ||
+       offset + (header->count * sizeof(_wi_file_index_record_t)) + _WI_FILE_INDEX_ALIGN(header->count * sizeof(uint32_t)) + header->strings_size != length) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_FILE_INDEX_READFAILED, WI_STR("Invalid length"));
+        
+        return false;
+    }
+    
+    root = bytes + sizeof(_wi_file_index_header_t);
+    records = (const _wi_file_index_record_t *) (bytes + offset);
+    names = (const uint32_t *) (records + header->count);
+    strings = (const char *) names + _WI_FILE_INDEX_ALIGN(header->count * sizeof(uint32_t));
+    
+    if(root[header->root_length] != '\0') {
+        wi_error_set_libwired_error_with_format(WI_ERROR_FILE_INDEX_READFAILED, WI_STR("Invalid root path"));
+        
+        return false;
+    }
+    
+    /* Everything is checked up front so that lookups can trust the offsets */
+    for(i = 0; i < header->count; i++) {
+        if(records[i].path_offset >= header->strings_size ||
+           records[i].path_length >= header->strings_size - records[i].path_offset ||
+           strings[records[i].path_offset + records[i].path_length] != '\0' ||
+           records[i].name_offset > records[i].path_length ||
+           names[i] >= header->count) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_FILE_INDEX_READFAILED, WI_STR("Invalid record %lu"), i);
+            
+            return false;
+        }
+    }
+    
+    wi_retain(image);
+    wi_release(index->image);
+    
+    index->image            = image;
+    index->records          = records;
+    index->names            = names;
+    index->strings          = strings;
+    index->records_count    = header->count;
+    
+    return true;
+}
+
+
+
+static wi_data_t * _wi_file_index_image_with_entries(wi_string_t *root, _wi_file_index_scan_entries_t *entries) {
+    _wi_file_index_header_t         *header;
+    _wi_file_index_record_t         *records;
+    _wi_file_index_scan_entry_t     **names;
+    uint32_t                        *order;
+    char                            *buffer, *strings;
+    wi_uinteger_t                   i, length, root_length, strings_size, offset;
+    
+    root_length = wi_string_length(root);
+    strings_size = 0;
+    
+    for(i = 0; i < entries->count; i++)
+        strings_size += entries->entries[i].path_length + 1;
+    
+    offset = sizeof(_wi_file_index_header_t) + _WI_FILE_INDEX_ALIGN(root_length + 1);
+    length = offset + (entries->count * sizeof(_wi_file_index_record_t)) + _WI_FILE_INDEX_ALIGN(entries->count * sizeof(uint32_t)) + strings_size;
+    buffer = wi_malloc(length);
+    
+    header = (_wi_file_index_header_t *) buffer;
+    records = (_wi_file_index_record_t *) (buffer + offset);
+    order = (uint32_t *) (records + entries->count);
+    strings = (char *) order + _WI_FILE_INDEX_ALIGN(entries->count * sizeof(uint32_t));
+    
+    memcpy(header->magic, _WI_FILE_INDEX_MAGIC, sizeof(header->magic));
+    
+    header->version         = _WI_FILE_INDEX_VERSION;
+    header->root_length     = root_length;
+    header->count           = entries->count;
+    header->strings_size    = strings_size;
+    
+    memcpy(buffer + sizeof(_wi_file_index_header_t), wi_string_utf8_string(root), root_length);
+    
+    offset = 0;
+    
+    for(i = 0; i < entries->count; i++) {
+        records[i].size                 = entries->entries[i].entry.size;
+        records[i].modification_time    = entries->entries[i].entry.modification_time;
+        records[i].path_offset          = offset;
+        records[i].path_length          = entries->entries[i].path_length;
+        records[i].name_offset          = entries->entries[i].name_offset;
+        records[i].type                 = entries->entries[i].entry.type;
+        
+        memcpy(strings + offset, entries->entries[i].path, entries->entries[i].path_length);
+        
+        offset += entries->entries[i].path_length + 1;
+    }
+    
+    if(entries->count > 0) {
+        names = wi_malloc(entries->count * sizeof(_wi_file_index_scan_entry_t *));
+        
+        for(i = 0; i < entries->count; i++)
+            names[i] = &entries->entries[i];
+        
+        qsort(names, entries->count, sizeof(_wi_file_index_scan_entry_t *), _wi_file_index_compare_names);
+        
+        for(i = 0; i < entries->count; i++)
+            order[i] = (uint32_t) (names[i] - entries->entries);
+        
+        wi_free(names);
+    }
+    
+    return wi_autorelease(wi_data_init_with_bytes_no_copy(wi_data_alloc(), buffer, length, true));
+}
+
+
+
+static int _wi_file_index_compare_entries(const void *p1, const void *p2) {
+    const _wi_file_index_scan_entry_t   *entry1 = p1, *entry2 = p2;
+    
+    return strcmp(entry1->path, entry2->path);
+}
+
+
+
+static int _wi_file_index_compare_names(const void *p1, const void *p2) {
+    const _wi_file_index_scan_entry_t   *entry1 = *(const _wi_file_index_scan_entry_t **) p1;
+    const _wi_file_index_scan_entry_t   *entry2 = *(const _wi_file_index_scan_entry_t **) p2;
+    int                                 result;
+    
+    result = strcasecmp(entry1->path + entry1->name_offset, entry2->path + entry2->name_offset);
+    
+    if(result == 0)
+        result = (entry1 < entry2) ? -1 : 1;
+    
+    return result;
+}
+
+
+
+static void _wi_file_index_compact(wi_file_index_t *index) {
+    _wi_file_index_scan_entries_t   entries;
+    _wi_file_index_scan_entry_t     *changes, entry;
+    _wi_file_index_change_t         *change;
+    wi_array_t                      *keys;
+    wi_string_t                     *key;
+    const char                      *path;
+    wi_uinteger_t                   i, j, count;
+    int                             result;
+    
+    keys = wi_dictionary_all_keys(index->changes);
+    count = wi_array_count(keys);
+    changes = wi_malloc(WI_MAX(count, 1) * sizeof(_wi_file_index_scan_entry_t));
+    
+    for(i = 0; i < count; i++) {
+        key = WI_ARRAY(keys, i);
+        change = wi_dictionary_data_for_key(index->changes, key);
+        
+        path = wi_string_utf8_string(key);
+        
+        changes[i].path         = (char *) path;
+        changes[i].path_length  = wi_string_length(key);
+        changes[i].name_offset  = strrchr(path, '/') ? strrchr(path, '/') + 1 - path : 0;
+        changes[i].entry        = change->entry;
+        
+        /* A deleted entry is marked by a missing path */
+        if(change->deleted)
+            changes[i].path_length = UINT32_MAX;
+    }
+    
+    qsort(changes, count, sizeof(_wi_file_index_scan_entry_t), _wi_file_index_compare_entries);
+    
+    memset(&entries, 0, sizeof(entries));
+    
+    /* Both lists are sorted by path, so they merge in one pass */
+    for(i = j = 0; i < index->records_count || j < count; ) {
+        if(i < index->records_count && j < count)
+            result = strcmp(index->strings + index->records[i].path_offset, changes[j].path);
+        else
+            result = (i < index->records_count) ? -1 : 1;
+        
+        if(result < 0) {
+            path = index->strings + index->records[i].path_offset;
+            
+            entry.path                      = _wi_file_index_copy_path(path, index->records[i].path_length);
+            entry.path_length               = index->records[i].path_length;
+            entry.name_offset               = index->records[i].name_offset;
+            entry.entry.type                = index->records[i].type;
+            entry.entry.size                = index->records[i].size;
+            entry.entry.modification_time   = index->records[i].modification_time;
+            
+            _wi_file_index_scan_entries_append(&entries, &entry, 1);
+            
+            i++;
+        } else {
+            if(changes[j].path_length != UINT32_MAX) {
+                entry = changes[j];
+                entry.path = _wi_file_index_copy_path(changes[j].path, changes[j].path_length);
+                
+                _wi_file_index_scan_entries_append(&entries, &entry, 1);
+            }
+            
+            if(result == 0)
+                i++;
+            
+            j++;
+        }
+    }
+    
+    wi_free(changes);
+    
+    _wi_file_index_set_image(index, _wi_file_index_image_with_entries(index->root, &entries));
+    _wi_file_index_scan_entries_free(&entries);
+    
+    wi_mutable_dictionary_remove_all_data(index->changes);
+    
+    index->count = index->records_count;
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_file_index_write_to_path(wi_file_index_t *index, wi_string_t *path) {
+    wi_data_t       *image;
+    wi_boolean_t    result;
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_write_lock(index->lock);
+#endif
+    
+    if(wi_dictionary_count(index->changes) > 0)
+        _wi_file_index_compact(index);
+    
+    image = wi_retain(index->image);
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_unlock(index->lock);
+#endif
+    
+    result = wi_data_write_to_path(image, path);
+    
+    wi_release(image);
+    
+    return result;
+}
+
+
+
+#pragma mark -
+
+wi_string_t * wi_file_index_root_path(wi_file_index_t *index) {
+    return index->root;
+}
+
+
+
+wi_uinteger_t wi_file_index_count(wi_file_index_t *index) {
+    wi_uinteger_t   count;
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_read_lock(index->lock);
+#endif
+    
+    count = index->count;
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_unlock(index->lock);
+#endif
+    
+    return count;
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_file_index_update_path(wi_file_index_t *index, wi_string_t *path) {
+    return _wi_file_index_update_path(index, path, true);
+}
+
+
+
+wi_boolean_t wi_file_index_update_path_for_event(wi_file_index_t *index, wi_string_t *path, wi_filesystem_event_kind_t kind) {
+    if(kind & WI_FILESYSTEM_EVENT_OVERFLOW)
+        return _wi_file_index_update_path(index, index->root, true);
+    
+    /* Contents only need a rescan when a directory may have appeared */
+    if(kind & (WI_FILESYSTEM_EVENT_CREATED | WI_FILESYSTEM_EVENT_DELETED | WI_FILESYSTEM_EVENT_RENAMED))
+        return _wi_file_index_update_path(index, path, true);
+    
+    return _wi_file_index_update_path(index, path, false);
+}
+
+
+
+static wi_boolean_t _wi_file_index_update_path(wi_file_index_t *index, wi_string_t *path, wi_boolean_t recursive) {
+    _wi_file_index_scan_entries_t   entries;
+    wi_filesystem_walk_entry_t      walk_entry;
+    wi_file_index_entry_t           entry, existing_entry;
+    wi_string_t                     *key;
+    wi_data_t                       *image = NULL;
+    const char                      *relative_path;
+    wi_uinteger_t                   i;
+    wi_boolean_t                    exists, existed, subtree, scanned = false;
+    
+    memset(&entry, 0, sizeof(entry));
+    memset(&entries, 0, sizeof(entries));
+    
+    relative_path = _wi_file_index_relative_path(index, path);
+    
+    if(!relative_path) {
+        wi_error_set_errno(EINVAL);
+        
+        return false;
+    }
+    
+    if(_wi_file_index_path_is_hidden(relative_path))
+        return true;
+    
+    /* Stat the same way as the scan, so that modification times compare equal */
+    if(!wi_filesystem_get_walk_entry_at(AT_FDCWD, wi_string_utf8_string(path), &walk_entry)) {
+        if(errno != ENOENT && errno != ENOTDIR) {
+            wi_error_set_errno(errno);
+            
+            return false;
+        }
+        
+        exists = false;
+    } else {
+        exists = true;
+        
+        entry.type                  = _wi_file_index_type_for_mode(walk_entry.mode);
+        entry.size                  = walk_entry.size;
+        entry.modification_time     = walk_entry.modification_time;
+    }
+    
+    /* Directories are scanned before the lock is taken, readers are only blocked for the merge */
+    if(exists && entry.type == WI_FILE_DIRECTORY && recursive) {
+        if(!_wi_file_index_scan_path(index->root, relative_path, &entries))
+            return false;
+        
+        scanned = true;
+        
+        if(*relative_path == '\0') {
+            qsort(entries.entries, entries.count, sizeof(_wi_file_index_scan_entry_t), _wi_file_index_compare_entries);
+            
+            image = _wi_file_index_image_with_entries(index->root, &entries);
+        }
+    }
+    
+    key = wi_string_with_utf8_string(relative_path);
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_write_lock(index->lock);
+#endif
+    
+    if(image) {
+        _wi_file_index_set_image(index, image);
+        
+        wi_mutable_dictionary_remove_all_data(index->changes);
+        
+        index->count = index->records_count;
+    } else if(*relative_path != '\0') {
+        existed = _wi_file_index_get_entry(index, key, &existing_entry);
+        
+        subtree = (existed && existing_entry.type == WI_FILE_DIRECTORY);
+        
+        if(!exists || (subtree && (scanned || entry.type != WI_FILE_DIRECTORY)))
+            _wi_file_index_remove_path(index, key, subtree);
+        
+        if(exists)
+            _wi_file_index_set_entry(index, key, &entry);
+        
+        for(i = 0; i < entries.count; i++)
+            _wi_file_index_set_entry(index, wi_string_with_utf8_string(entries.entries[i].path), &entries.entries[i].entry);
+        
+        if(wi_dictionary_count(index->changes) > _WI_FILE_INDEX_COMPACT_THRESHOLD &&
+           wi_dictionary_count(index->changes) > index->records_count / 8)
+            _wi_file_index_compact(index);
+    }
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_unlock(index->lock);
+#endif
+    
+    _wi_file_index_scan_entries_free(&entries);
+    
+    return true;
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_file_index_get_entry_for_path(wi_file_index_t *index, wi_string_t *path, wi_file_index_entry_t *entry) {
+    const char      *relative_path;
+    wi_boolean_t    result;
+    
+    relative_path = _wi_file_index_relative_path(index, path);
+    
+    if(!relative_path || *relative_path == '\0')
+        return false;
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_read_lock(index->lock);
+#endif
+    
+    result = _wi_file_index_get_entry(index, wi_string_with_utf8_string(relative_path), entry);
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_unlock(index->lock);
+#endif
+    
+    return result;
+}
+
+
+
+wi_array_t * wi_file_index_paths_matching_name(wi_file_index_t *index, wi_string_t *name, wi_file_index_match_options_t options) {
+    wi_enumerator_t                 *enumerator;
+    wi_mutable_array_t              *paths;
+    wi_string_t                     *key;
+    _wi_file_index_change_t         *change;
+    const _wi_file_index_record_t   *record;
+    const char                      *query, *path, *slash;
+    wi_uinteger_t                   i, min, max, mid, length;
+    wi_boolean_t                    changed;
+    
+    query = wi_string_utf8_string(name);
+    length = strlen(query);
+    paths = wi_mutable_array();
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_read_lock(index->lock);
+#endif
+    
+    changed = (wi_dictionary_count(index->changes) > 0);
+    
+    if(options & WI_FILE_INDEX_MATCH_SUBSTRING) {
+        i = 0;
+    } else {
+        /* Names are sorted without regard to case, so the matches are one run found by bisection */
+        min = 0;
+        max = index->records_count;
+        
+        while(min < max) {
+            mid = min + ((max - min) / 2);
+            record = &index->records[index->names[mid]];
+            
+            if(strncasecmp(index->strings + record->path_offset + record->name_offset, query, length) < 0)
+                min = mid + 1;
+            else
+                max = mid;
+        }
+        
+        i = min;
+    }
+    
+    for(; i < index->records_count; i++) {
+        record = &index->records[index->names[i]];
+        path = index->strings + record->path_offset;
+        
+        if(!_wi_file_index_name_matches(path + record->name_offset, query, length, options)) {
+            if(options & WI_FILE_INDEX_MATCH_SUBSTRING)
+                continue;
+            
+            break;
+        }
+        
+        if(changed && wi_dictionary_contains_key(index->changes, wi_string_with_utf8_string(path)))
+            continue;
+        
+        wi_mutable_array_add_data(paths, wi_string_with_format(WI_STR("%@/%s"), index->root, path));
+    }
+    
+    if(changed) {
+        enumerator = wi_dictionary_key_enumerator(index->changes);
+        
+        while(wi_enumerator_get_next_data(enumerator, (void **) &key)) {
+            change = wi_dictionary_data_for_key(index->changes, key);
+            
+            if(change->deleted)
+                continue;
+            
+            path = wi_string_utf8_string(key);
+            slash = strrchr(path, '/');
+            
+            if(_wi_file_index_name_matches(slash ? slash + 1 : path, query, length, options))
+                wi_mutable_array_add_data(paths, wi_string_with_format(WI_STR("%@/%s"), index->root, path));
+        }
+    }
+    
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_unlock(index->lock);
+#endif
+    
+    wi_runtime_make_immutable(paths);
+    
+    return paths;
+}
+
+
+
+#pragma mark -
+
+static const char * _wi_file_index_relative_path(wi_file_index_t *index, wi_string_t *path) {
+    const char      *string;
+    wi_uinteger_t   length;
+    
+    string = wi_string_utf8_string(path);
+    length = wi_string_length(index->root);
+    
+    if(strncmp(string, wi_string_utf8_string(index->root), length) != 0)
+        return NULL;
+    
+    if(string[length] == '\0')
+        return string + length;
+    
+    if(string[length] != '/' && !(length == 1 && string[0] == '/'))
+        return NULL;
+    
+    while(string[length] == '/')
+        length++;
+    
+    return string + length;
+}
+
+
+
+static wi_boolean_t _wi_file_index_path_is_hidden(const char *path) {
+    return (path[0] == '.' || strstr(path, "/.") != NULL);
+}
+
+
+
+static wi_boolean_t _wi_file_index_find_record(wi_file_index_t *index, const char *path, wi_uinteger_t *position) {
+    wi_uinteger_t   min, max, mid;
+    int             result;
+    
+    min = 0;
+    max = index->records_count;
+    
+    while(min < max) {
+        mid = min + ((max - min) / 2);
+        result = strcmp(index->strings + index->records[mid].path_offset, path);
+        
+        if(result == 0) {
+            *position = mid;
+            
+            return true;
+        }
+        
+        if(result < 0)
+            min = mid + 1;
+        else
+            max = mid;
+    }
+    
+    *position = min;
+    
+    return false;
+}
+
+
+
+static wi_boolean_t _wi_file_index_get_entry(wi_file_index_t *index, wi_string_t *path, wi_file_index_entry_t *entry) {
+    _wi_file_index_change_t     *change;
+    wi_uinteger_t               i;
+    
+    change = wi_dictionary_data_for_key(index->changes, path);
+    
+    if(change) {
+        if(change->deleted)
+            return false;
+        
+        if(entry)
+            *entry = change->entry;
+        
+        return true;
+    }
+    
+    if(!_wi_file_index_find_record(index, wi_string_utf8_string(path), &i))
+        return false;
+    
+    if(entry) {
+        entry->type                 = index->records[i].type;
+        entry->size                 = index->records[i].size;
+        entry->modification_time    = index->records[i].modification_time;
+    }
+    
+    return true;
+}
+
+
+
+static void _wi_file_index_set_entry(wi_file_index_t *index, wi_string_t *path, wi_file_index_entry_t *entry) {
+    if(!_wi_file_index_get_entry(index, path, NULL))
+        index->count++;
+    
+    wi_mutable_dictionary_set_data_for_key(index->changes, _wi_file_index_change_with_entry(entry), path);
+}
+
+
+
+static void _wi_file_index_remove_path(wi_file_index_t *index, wi_string_t *path, wi_boolean_t subtree) {
+    _wi_file_index_change_t     *change, *deleted;
+    wi_array_t                  *keys;
+    wi_string_t                 *key, *prefix;
+    const char                  *string;
+    wi_uinteger_t               i, count, length;
+    
+    deleted = _wi_file_index_change_with_entry(NULL);
+    
+    if(_wi_file_index_get_entry(index, path, NULL))
+        index->count--;
+    
+    /* Records in the image are masked, everything else is just dropped */
+    if(_wi_file_index_find_record(index, wi_string_utf8_string(path), &i))
+        wi_mutable_dictionary_set_data_for_key(index->changes, deleted, path);
+    else
+        wi_mutable_dictionary_remove_data_for_key(index->changes, path);
+    
+    if(!subtree)
+        return;
+    
+    /* Records below the path sort right after the path and its separator */
+    prefix = wi_string_by_appending_string(path, WI_STR("/"));
+    string = wi_string_utf8_string(prefix);
+    length = wi_string_length(prefix);
+    
+    _wi_file_index_find_record(index, string, &i);
+    
+    for(; i < index->records_count; i++) {
+        if(strncmp(index->strings + index->records[i].path_offset, string, length) != 0)
+            break;
+        
+        key = wi_string_with_utf8_bytes(index->strings + index->records[i].path_offset, index->records[i].path_length);
+        
+        if(_wi_file_index_get_entry(index, key, NULL))
+            index->count--;
+        
+        wi_mutable_dictionary_set_data_for_key(index->changes, deleted, key);
+    }
+    
+    /* What is left below the path was added since the image was built, and can only be found by looking at all changes */
+    keys = wi_dictionary_all_keys(index->changes);
+    count = wi_array_count(keys);
+    
+    for(i = 0; i < count; i++) {
+        key = WI_ARRAY(keys, i);
+        change = wi_dictionary_data_for_key(index->changes, key);
+        
+        if(!change->deleted && wi_string_has_prefix(key, prefix)) {
+            wi_mutable_dictionary_remove_data_for_key(index->changes, key);
+            
+            index->count--;
+        }
+    }
+}
+
+
+
+static wi_boolean_t _wi_file_index_name_matches(const char *name, const char *query, wi_uinteger_t length, wi_file_index_match_options_t options) {
+    int     c;
+    
+    if(!(options & WI_FILE_INDEX_MATCH_SUBSTRING))
+        return (strncasecmp(name, query, length) == 0);
+    
+    if(length == 0)
+        return true;
+    
+    c = tolower((unsigned char) query[0]);
+    
+    for(; *name; name++) {
+        if(tolower((unsigned char) *name) == c && strncasecmp(name, query, length) == 0)
+            return true;
+    }
+    
+    return false;
+}
+
+
+
+static wi_file_type_t _wi_file_index_type_for_mode(mode_t mode) {
+    if(S_ISREG(mode))
+        return WI_FILE_REGULAR;
+    else if(S_ISDIR(mode))
+        return WI_FILE_DIRECTORY;
+    else if(S_ISLNK(mode))
+        return WI_FILE_SYMBOLIC_LINK;
+    else if(S_ISSOCK(mode))
+        return WI_FILE_SOCKET;
+    else if(S_ISFIFO(mode))
+        return WI_FILE_PIPE;
+    
+    return WI_FILE_UNKNOWN;
+}
+
+
+
+#pragma mark -
+
+static void _wi_file_index_scan_entries_append(_wi_file_index_scan_entries_t *entries, _wi_file_index_scan_entry_t *entry, wi_uinteger_t count) {
+    if(entries->count + count > entries->capacity) {
+        entries->capacity = WI_MAX(WI_MAX(entries->capacity * 2, 256), entries->count + count);
+        entries->entries = wi_realloc(entries->entries, entries->capacity * sizeof(_wi_file_index_scan_entry_t));
+    }
+    
+    memcpy(entries->entries + entries->count, entry, count * sizeof(_wi_file_index_scan_entry_t));
+    
+    entries->count += count;
+}
+
+
+
+static void _wi_file_index_scan_entries_free(_wi_file_index_scan_entries_t *entries) {
+    wi_uinteger_t   i;
+    
+    for(i = 0; i < entries->count; i++)
+        wi_free(entries->entries[i].path);
+    
+    wi_free(entries->entries);
+    
+    memset(entries, 0, sizeof(*entries));
+}
+
+
+
+static char * _wi_file_index_copy_path(const char *path, wi_uinteger_t length) {
+    char    *copy;
+    
+    copy = wi_malloc(length + 1);
+    
+    memcpy(copy, path, length);
+    
+    return copy;
+}
+
+
+
+#pragma mark -
+
+static wi_boolean_t _wi_file_index_scan_path(wi_string_t *root, const char *path, _wi_file_index_scan_entries_t *entries) {
+    _wi_file_index_scan_t       scan;
+    wi_string_t                 *full_path;
+    wi_boolean_t                is_directory;
+    
+    full_path = (*path == '\0') ? root : wi_string_with_format(WI_STR("%@/%s"), root, path);
+    
+    if(!wi_filesystem_file_exists_at_path(full_path, &is_directory)) {
+        wi_error_set_errno(ENOENT);
+        
+        return false;
+    }
+    
+    if(!is_directory) {
+        wi_error_set_errno(ENOTDIR);
+        
+        return false;
+    }
+    
+    scan.root_length    = strlen(wi_string_utf8_string(root));
+    scan.entries        = entries;
+    
+    /* Directories that vanish or cannot be read while scanning are left out */
+    wi_filesystem_walk_path_with_entries_callback(full_path, true, _wi_file_index_scan_directory, &scan);
+    
+    return true;
+}
+
+
+
+static void _wi_file_index_scan_directory(const char *path, wi_filesystem_walk_entry_t *walk_entries, wi_uinteger_t count, void *context) {
+    _wi_file_index_scan_t           *scan = context;
+    _wi_file_index_scan_entry_t     entry;
+    wi_uinteger_t                   i, length;
+    
+    /* The walker hands out full paths, the index keeps them relative to the root */
+    path += scan->root_length;
+    
+    if(*path == '/')
+        path++;
+    
+    length = strlen(path);
+    
+    for(i = 0; i < count; i++) {
+        entry.name_offset               = (length > 0) ? length + 1 : 0;
+        entry.path_length               = entry.name_offset + walk_entries[i].name_length;
+        entry.path                      = wi_malloc(entry.path_length + 1);
+        entry.entry.type                = _wi_file_index_type_for_mode(walk_entries[i].mode);
+        entry.entry.size                = walk_entries[i].size;
+        entry.entry.modification_time   = walk_entries[i].modification_time;
+        
+        if(length > 0) {
+            memcpy(entry.path, path, length);
+            
+            entry.path[length] = '/';
+        }
+        
+        memcpy(entry.path + entry.name_offset, walk_entries[i].name, walk_entries[i].name_length);
+        
+        _wi_file_index_scan_entries_append(scan->entries, &entry, 1);
+    }
+}
+
+
+
+#pragma mark -
+
+static _wi_file_index_change_t * _wi_file_index_change_with_entry(wi_file_index_entry_t *entry) {
+    _wi_file_index_change_t     *change;
+    
+    change = wi_runtime_create_instance(_wi_file_index_change_runtime_id, sizeof(_wi_file_index_change_t));
+    
+    if(entry)
+        change->entry = *entry;
+    else
+        change->deleted = true;
+    
+    return wi_autorelease(change);
+}
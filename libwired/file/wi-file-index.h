@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WI_FILE_INDEX_H
+#define WI_FILE_INDEX_H 1
+
+#include <wired/wi-base.h>
+#include <wired/wi-filesystem.h>
+#include <wired/wi-filesystem-events.h>
+#include <wired/wi-runtime.h>
+
+enum _wi_file_index_match_options {
+    WI_FILE_INDEX_MATCH_PREFIX              = (1 << 0),
+    WI_FILE_INDEX_MATCH_SUBSTRING           = (1 << 1)
+};
+typedef enum _wi_file_index_match_options   wi_file_index_match_options_t;
+
+struct _wi_file_index_entry {
+    wi_file_type_t                          type;
+    wi_file_offset_t                        size;
+    wi_time_interval_t                      modification_time;
+};
+typedef struct _wi_file_index_entry         wi_file_index_entry_t;
+
+
+WI_EXPORT wi_runtime_id_t                   wi_file_index_runtime_id(void);
+
+WI_EXPORT wi_file_index_t *                 wi_file_index_alloc(void);
+WI_EXPORT wi_file_index_t *                 wi_file_index_init_with_path(wi_file_index_t *, wi_string_t *);
+WI_EXPORT wi_file_index_t *                 wi_file_index_init_with_contents_of_file(wi_file_index_t *, wi_string_t *);
+
+WI_EXPORT wi_boolean_t                      wi_file_index_write_to_path(wi_file_index_t *, wi_string_t *);
+
+WI_EXPORT wi_string_t *                     wi_file_index_root_path(wi_file_index_t *);
+WI_EXPORT wi_uinteger_t                     wi_file_index_count(wi_file_index_t *);
+
+WI_EXPORT wi_boolean_t                      wi_file_index_update_path(wi_file_index_t *, wi_string_t *);
+WI_EXPORT wi_boolean_t                      wi_file_index_update_path_for_event(wi_file_index_t *, wi_string_t *, wi_filesystem_event_kind_t);
+
+WI_EXPORT wi_boolean_t                      wi_file_index_get_entry_for_path(wi_file_index_t *, wi_string_t *, wi_file_index_entry_t *);
+WI_EXPORT wi_array_t *                      wi_file_index_paths_matching_name(wi_file_index_t *, wi_string_t *, wi_file_index_match_options_t);
+
+#endif /* WI_FILE_INDEX_H */
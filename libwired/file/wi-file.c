@@ -28,7 +28,11 @@
 
 #include <sys/param.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
@@ -39,13 +43,16 @@
 #include <wired/wi-assert.h>
 #include <wired/wi-byteorder.h>
 #include <wired/wi-compat.h>
+#include <wired/wi-data.h>
 #include <wired/wi-file.h>
 #include <wired/wi-fts.h>
 #include <wired/wi-lock.h>
+#include <wired/wi-macros.h>
 #include <wired/wi-pool.h>
 #include <wired/wi-private.h>
 #include <wired/wi-runtime.h>
 #include <wired/wi-string.h>
+#include <wired/wi-system.h>
 
 #define _WI_FILE_ASSERT_OPEN(file) \
     WI_ASSERT((file)->fd >= 0, "%@ is not open", (file))
@@ -63,6 +70,16 @@ struct _wi_file {
 static void                             _wi_file_dealloc(wi_runtime_instance_t *);
 static wi_string_t *                    _wi_file_description(wi_runtime_instance_t *);
 
+static wi_integer_t                     _wi_file_transfer_vectors(wi_file_t *, const struct iovec *, wi_uinteger_t, wi_file_offset_t, wi_boolean_t);
+
+#ifdef HAVE_MADVISE
+static int                              _wi_file_madvise_advice(wi_file_advice_t);
+#endif
+
+#ifdef HAVE_POSIX_FADVISE
+static int                              _wi_file_fadvise_advice(wi_file_advice_t);
+#endif
+
 
 static wi_runtime_id_t                  _wi_file_runtime_id = WI_RUNTIME_ID_NULL;
 static wi_runtime_class_t               _wi_file_runtime_class = {
@@ -267,32 +284,43 @@ wi_data_t * wi_file_read(wi_file_t *file, wi_uinteger_t length) {
 
 
 wi_data_t * wi_file_read_to_end_of_file(wi_file_t *file) {
-    wi_mutable_data_t   *data;
-    char                buffer[WI_FILE_BUFFER_SIZE];
+    struct stat         sb;
+    char                *buffer;
+    wi_uinteger_t       length, capacity;
     wi_integer_t        bytes;
     
     _WI_FILE_ASSERT_OPEN(file);
     
-    data = wi_data_init_with_capacity(wi_mutable_data_alloc(), WI_FILE_BUFFER_SIZE);
+    /* Size regular files up front, with one extra byte so end of file is seen without growing */
+    if(fstat(file->fd, &sb) == 0 && S_ISREG(sb.st_mode) && (wi_file_offset_t) sb.st_size > file->offset)
+        capacity = sb.st_size - file->offset + 1;
+    else
+        capacity = WI_FILE_BUFFER_SIZE;
+    
+    buffer = wi_malloc(capacity);
+    length = 0;
     
     while(true) {
-        bytes = wi_file_read_bytes(file, buffer, sizeof(buffer));
+        if(length == capacity) {
+            capacity *= 2;
+            buffer = wi_realloc(buffer, capacity);
+        }
+        
+        bytes = wi_file_read_bytes(file, buffer + length, capacity - length);
         
         if(bytes <= 0)
             break;
-
-        wi_mutable_data_append_bytes(data, buffer, bytes);
+        
+        length += bytes;
     }
 
     if(bytes < 0) {
-        wi_release(data);
+        wi_free(buffer);
         
-        data = NULL;
+        return NULL;
     }
     
-    wi_runtime_make_immutable(data);
-    
-    return wi_autorelease(data);
+    return wi_autorelease(wi_data_init_with_bytes_no_copy(wi_data_alloc(), buffer, length, true));
 }
 
 
@@ -331,6 +359,137 @@ wi_integer_t wi_file_read_bytes(wi_file_t *file, void *buffer, wi_uinteger_t len
 
 
 
+wi_data_t * wi_file_read_at_offset(wi_file_t *file, wi_uinteger_t length, wi_file_offset_t offset) {
+    char            *buffer;
+    wi_integer_t    bytes;
+    
+    _WI_FILE_ASSERT_OPEN(file);
+    
+    buffer  = wi_malloc(WI_MAX(length, 1));
+    bytes   = wi_file_read_bytes_at_offset(file, buffer, length, offset);
+    
+    if(bytes < 0) {
+        wi_free(buffer);
+        
+        return NULL;
+    }
+    
+    return wi_autorelease(wi_data_init_with_bytes_no_copy(wi_data_alloc(), buffer, bytes, true));
+}
+
+
+
+wi_integer_t wi_file_read_bytes_at_offset(wi_file_t *file, void *buffer, wi_uinteger_t length, wi_file_offset_t offset) {
+    wi_uinteger_t   position;
+    wi_integer_t    bytes;
+    
+    _WI_FILE_ASSERT_OPEN(file);
+    
+    position = 0;
+    
+    while(position < length) {
+        bytes = pread(file->fd, buffer + position, length - position, offset + position);
+        
+        if(bytes > 0) {
+            position += bytes;
+        } else {
+            if(bytes == 0) {
+                return position;
+            } else {
+                if(errno == EINTR) {
+                    continue;
+                } else {
+                    wi_error_set_errno(errno);
+                    
+                    return -1;
+                }
+            }
+        }
+    }
+    
+    return position;
+}
+
+
+
+wi_integer_t wi_file_read_vectors_at_offset(wi_file_t *file, const struct iovec *vectors, wi_uinteger_t count, wi_file_offset_t offset) {
+    return _wi_file_transfer_vectors(file, vectors, count, offset, false);
+}
+
+
+
+#pragma mark -
+
+wi_data_t * wi_file_map(wi_file_t *file, wi_file_offset_t offset, wi_uinteger_t length) {
+    return wi_file_map_with_advice(file, offset, length, WI_FILE_ADVICE_NORMAL);
+}
+
+
+
+wi_data_t * wi_file_map_with_advice(wi_file_t *file, wi_file_offset_t offset, wi_uinteger_t length, wi_file_advice_t advice) {
+    struct stat         sb;
+    void                *mapping;
+    wi_file_offset_t    mapping_offset;
+    wi_uinteger_t       mapping_length;
+    
+    _WI_FILE_ASSERT_OPEN(file);
+    
+    if(fstat(file->fd, &sb) < 0) {
+        wi_error_set_errno(errno);
+        
+        return NULL;
+    }
+    
+    if(length == 0) {
+        if((wi_file_offset_t) sb.st_size <= offset)
+            return wi_data();
+        
+        length = sb.st_size - offset;
+    } else if(offset > (wi_file_offset_t) sb.st_size || length > (wi_file_offset_t) sb.st_size - offset) {
+        /* Touching mapped pages past the end of the file raises SIGBUS */
+        wi_error_set_errno(EINVAL);
+        
+        return NULL;
+    }
+    
+    mapping_offset = offset - (offset % wi_page_size());
+    mapping_length = length + (offset - mapping_offset);
+    mapping = mmap(NULL, mapping_length, PROT_READ, MAP_PRIVATE, file->fd, (off_t) mapping_offset);
+    
+    if(mapping == MAP_FAILED) {
+        wi_error_set_errno(errno);
+        
+        return NULL;
+    }
+    
+#ifdef HAVE_MADVISE
+    if(advice != WI_FILE_ADVICE_NORMAL)
+        (void) madvise(mapping, mapping_length, _wi_file_madvise_advice(advice));
+#endif
+    
+    return wi_autorelease(wi_data_init_with_mapped_bytes(wi_data_alloc(), mapping, mapping_length, (char *) mapping + (offset - mapping_offset), length));
+}
+
+
+
+#ifdef HAVE_MADVISE
+
+static int _wi_file_madvise_advice(wi_file_advice_t advice) {
+    switch(advice) {
+        case WI_FILE_ADVICE_NORMAL:         return MADV_NORMAL;
+        case WI_FILE_ADVICE_SEQUENTIAL:     return MADV_SEQUENTIAL;
+        case WI_FILE_ADVICE_RANDOM:         return MADV_RANDOM;
+        case WI_FILE_ADVICE_WILL_NEED:      return MADV_WILLNEED;
+        case WI_FILE_ADVICE_DONT_NEED:      return MADV_DONTNEED;
+    }
+    
+    return MADV_NORMAL;
+}
+
+#endif
+
+
+
 #pragma mark -
 
 wi_integer_t wi_file_write(wi_file_t *file, wi_data_t *data) {
@@ -373,6 +532,179 @@ wi_integer_t wi_file_write_bytes(wi_file_t *file, const void *buffer, wi_uintege
 
 
 
+wi_integer_t wi_file_write_at_offset(wi_file_t *file, wi_data_t *data, wi_file_offset_t offset) {
+    return wi_file_write_bytes_at_offset(file, wi_data_bytes(data), wi_data_length(data), offset);
+}
+
+
+
+wi_integer_t wi_file_write_bytes_at_offset(wi_file_t *file, const void *buffer, wi_uinteger_t length, wi_file_offset_t offset) {
+    wi_uinteger_t   position;
+    wi_integer_t    bytes;
+    
+    _WI_FILE_ASSERT_OPEN(file);
+    
+    position = 0;
+    
+    while(position < length) {
+        bytes = pwrite(file->fd, buffer + position, length - position, offset + position);
+        
+        if(bytes > 0) {
+            position += bytes;
+        } else {
+            if(bytes == 0) {
+                return position;
+            } else {
+                if(errno == EINTR) {
+                    continue;
+                } else {
+                    wi_error_set_errno(errno);
+                    
+                    return -1;
+                }
+            }
+        }
+    }
+    
+    return position;
+}
+
+
+
+wi_integer_t wi_file_write_vectors_at_offset(wi_file_t *file, const struct iovec *vectors, wi_uinteger_t count, wi_file_offset_t offset) {
+    return _wi_file_transfer_vectors(file, vectors, count, offset, true);
+}
+
+
+
+static wi_integer_t _wi_file_transfer_vectors(wi_file_t *file, const struct iovec *vectors, wi_uinteger_t count, wi_file_offset_t offset, wi_boolean_t writing) {
+    struct iovec    *iov;
+    wi_uinteger_t   i, position;
+    wi_integer_t    bytes;
+    
+    _WI_FILE_ASSERT_OPEN(file);
+    
+    /* Work on a copy, partial transfers advance the vectors in place */
+    iov = wi_malloc(WI_MAX(count, 1) * sizeof(*iov));
+    
+    memcpy(iov, vectors, count * sizeof(*iov));
+    
+    i = position = 0;
+    
+    while(i < count) {
+        if(iov[i].iov_len == 0) {
+            i++;
+            
+            continue;
+        }
+        
+#if defined(HAVE_PREADV) && defined(HAVE_PWRITEV)
+        if(writing)
+            bytes = pwritev(file->fd, &iov[i], WI_MIN(count - i, IOV_MAX), offset + position);
+        else
+            bytes = preadv(file->fd, &iov[i], WI_MIN(count - i, IOV_MAX), offset + position);
+#else
+        if(writing)
+            bytes = pwrite(file->fd, iov[i].iov_base, iov[i].iov_len, offset + position);
+        else
+            bytes = pread(file->fd, iov[i].iov_base, iov[i].iov_len, offset + position);
+#endif
+        
+        if(bytes > 0) {
+            position += bytes;
+            
+            while(i < count && (wi_uinteger_t) bytes >= iov[i].iov_len) {
+                bytes -= iov[i].iov_len;
+                i++;
+            }
+            
+            if(i < count) {
+                iov[i].iov_base = (char *) iov[i].iov_base + bytes;
+                iov[i].iov_len -= bytes;
+            }
+        } else {
+            if(bytes == 0) {
+                break;
+            } else {
+                if(errno == EINTR) {
+                    continue;
+                } else {
+                    wi_error_set_errno(errno);
+                    wi_free(iov);
+                    
+                    return -1;
+                }
+            }
+        }
+    }
+    
+    wi_free(iov);
+    
+    return position;
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_file_advise(wi_file_t *file, wi_file_offset_t offset, wi_file_offset_t length, wi_file_advice_t advice) {
+#ifdef HAVE_POSIX_FADVISE
+    int     err;
+    
+    _WI_FILE_ASSERT_OPEN(file);
+    
+    err = posix_fadvise(file->fd, offset, length, _wi_file_fadvise_advice(advice));
+    
+    if(err != 0) {
+        wi_error_set_errno(err);
+        
+        return false;
+    }
+#else
+    _WI_FILE_ASSERT_OPEN(file);
+#endif
+    
+    return true;
+}
+
+
+
+wi_boolean_t wi_file_read_ahead(wi_file_t *file, wi_file_offset_t offset, wi_file_offset_t length) {
+#ifdef HAVE_READAHEAD
+    _WI_FILE_ASSERT_OPEN(file);
+    
+    if(readahead(file->fd, offset, length) < 0) {
+        wi_error_set_errno(errno);
+        
+        return false;
+    }
+    
+    return true;
+#else
+    return wi_file_advise(file, offset, length, WI_FILE_ADVICE_WILL_NEED);
+#endif
+}
+
+
+
+#ifdef HAVE_POSIX_FADVISE
+
+static int _wi_file_fadvise_advice(wi_file_advice_t advice) {
+    switch(advice) {
+        case WI_FILE_ADVICE_NORMAL:         return POSIX_FADV_NORMAL;
+        case WI_FILE_ADVICE_SEQUENTIAL:     return POSIX_FADV_SEQUENTIAL;
+        case WI_FILE_ADVICE_RANDOM:         return POSIX_FADV_RANDOM;
+        case WI_FILE_ADVICE_WILL_NEED:      return POSIX_FADV_WILLNEED;
+        case WI_FILE_ADVICE_DONT_NEED:      return POSIX_FADV_DONTNEED;
+    }
+    
+    return POSIX_FADV_NORMAL;
+}
+
+#endif
+
+
+
 #pragma mark -
 
 void wi_file_seek(wi_file_t *file, wi_file_offset_t offset) {
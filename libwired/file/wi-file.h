@@ -30,6 +30,7 @@
 #include <sys/types.h>
 #include <sys/param.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <stdio.h>
 #include <wired/wi-base.h>
 #include <wired/wi-runtime.h>
@@ -47,6 +48,15 @@ enum _wi_file_mode {
 };
 typedef enum _wi_file_mode          wi_file_mode_t;
 
+enum _wi_file_advice {
+    WI_FILE_ADVICE_NORMAL           = 0,
+    WI_FILE_ADVICE_SEQUENTIAL,
+    WI_FILE_ADVICE_RANDOM,
+    WI_FILE_ADVICE_WILL_NEED,
+    WI_FILE_ADVICE_DONT_NEED
+};
+typedef enum _wi_file_advice        wi_file_advice_t;
+
 
 WI_EXPORT wi_runtime_id_t           wi_file_runtime_id(void);
 
@@ -66,9 +76,21 @@ WI_EXPORT int                       wi_file_descriptor(wi_file_t *);
 WI_EXPORT wi_data_t *               wi_file_read(wi_file_t *, wi_uinteger_t);
 WI_EXPORT wi_data_t *               wi_file_read_to_end_of_file(wi_file_t *);
 WI_EXPORT wi_integer_t              wi_file_read_bytes(wi_file_t *, void *, wi_uinteger_t);
+WI_EXPORT wi_data_t *               wi_file_read_at_offset(wi_file_t *, wi_uinteger_t, wi_file_offset_t);
+WI_EXPORT wi_integer_t              wi_file_read_bytes_at_offset(wi_file_t *, void *, wi_uinteger_t, wi_file_offset_t);
+WI_EXPORT wi_integer_t              wi_file_read_vectors_at_offset(wi_file_t *, const struct iovec *, wi_uinteger_t, wi_file_offset_t);
+
+WI_EXPORT wi_data_t *               wi_file_map(wi_file_t *, wi_file_offset_t, wi_uinteger_t);
+WI_EXPORT wi_data_t *               wi_file_map_with_advice(wi_file_t *, wi_file_offset_t, wi_uinteger_t, wi_file_advice_t);
 
 WI_EXPORT wi_integer_t              wi_file_write(wi_file_t *, wi_data_t *);
 WI_EXPORT wi_integer_t              wi_file_write_bytes(wi_file_t *, const void *, wi_uinteger_t);
+WI_EXPORT wi_integer_t              wi_file_write_at_offset(wi_file_t *, wi_data_t *, wi_file_offset_t);
+WI_EXPORT wi_integer_t              wi_file_write_bytes_at_offset(wi_file_t *, const void *, wi_uinteger_t, wi_file_offset_t);
+WI_EXPORT wi_integer_t              wi_file_write_vectors_at_offset(wi_file_t *, const struct iovec *, wi_uinteger_t, wi_file_offset_t);
+
+WI_EXPORT wi_boolean_t              wi_file_advise(wi_file_t *, wi_file_offset_t, wi_file_offset_t, wi_file_advice_t);
+WI_EXPORT wi_boolean_t              wi_file_read_ahead(wi_file_t *, wi_file_offset_t, wi_file_offset_t);
 
 WI_EXPORT void                      wi_file_seek(wi_file_t *, wi_file_offset_t);
 WI_EXPORT wi_file_offset_t          wi_file_seek_to_end_of_file(wi_file_t *);
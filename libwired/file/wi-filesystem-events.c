@@ -32,9 +32,12 @@ int wi_filesystem_events_dummy = 1;
 
 #else
 
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
 #include <pthread.h>
 
 #ifdef HAVE_SYS_EVENT_H
@@ -49,7 +52,11 @@ int wi_filesystem_events_dummy = 1;
 #include <inotifytools/inotify.h>
 #endif
 
+#include <wired/wi-array.h>
 #include <wired/wi-condition-lock.h>
+#include <wired/wi-date.h>
+#include <wired/wi-dictionary.h>
+#include <wired/wi-directory-reader.h>
 #include <wired/wi-error.h>
 #include <wired/wi-filesystem-events.h>
 #include <wired/wi-number.h>
@@ -57,6 +64,7 @@ int wi_filesystem_events_dummy = 1;
 #include <wired/wi-private.h>
 #include <wired/wi-recursive-lock.h>
 #include <wired/wi-string.h>
+#include <wired/wi-system.h>
 
 #if defined(HAVE_SYS_EVENT_H)
 #define _WI_FILESYSTEM_EVENTS_KQUEUE            1
@@ -66,6 +74,9 @@ int wi_filesystem_events_dummy = 1;
 
 #ifdef _WI_FILESYSTEM_EVENTS_INOTIFY
 #define _WI_FILESYSTEM_EVENTS_INOTIFY_MASK      (IN_CREATE | IN_DELETE | IN_MOVE)
+#define _WI_FILESYSTEM_EVENTS_INOTIFY_ALL_MASK  (IN_CREATE | IN_DELETE | IN_MOVE | IN_MODIFY | IN_ATTRIB | \
+                                                 IN_DELETE_SELF | IN_MOVE_SELF)
+#define _WI_FILESYSTEM_EVENTS_BUFFER_SIZE       (64 * 1024)
 #endif
 
 
@@ -76,17 +87,46 @@ struct _wi_filesystem_events {
     int                                         kqueue;
 #elif defined(_WI_FILESYSTEM_EVENTS_INOTIFY)
     int                                         inotify;
+    char                                        *buffer;
 #endif
     
     wi_recursive_lock_t                         *lock;
     
-    wi_mutable_dictionary_t                     *callbacks_for_paths;
+    wi_mutable_dictionary_t                     *watches_for_paths;
     wi_mutable_dictionary_t                     *fds_for_paths;
 
 #ifdef _WI_FILESYSTEM_EVENTS_INOTIFY
     wi_mutable_dictionary_t                     *paths_for_fds;
+    wi_mutable_dictionary_t                     *watches_for_fds;
 #endif
+    
+    wi_time_interval_t                          coalescing_interval;
+    wi_mutable_dictionary_t                     *changes_for_paths;
+    wi_mutable_array_t                          *changes;
+};
+
+
+struct _wi_filesystem_events_watch {
+    wi_runtime_base_t                           base;
+    
+    wi_string_t                                 *path;
+    wi_filesystem_events_options_t              options;
+    wi_filesystem_events_callback_t             *callback;
+    wi_filesystem_events_event_callback_t       *event_callback;
 };
+typedef struct _wi_filesystem_events_watch      _wi_filesystem_events_watch_t;
+
+
+struct _wi_filesystem_events_change {
+    wi_runtime_base_t                           base;
+    
+    wi_string_t                                 *path;
+    _wi_filesystem_events_watch_t               *watch;
+    wi_filesystem_event_kind_t                  kinds;
+    wi_time_interval_t                          deadline;
+};
+typedef struct _wi_filesystem_events_change     _wi_filesystem_events_change_t;
+
 
 enum _wi_filesystem_events_state {
     WI_FILESYSTEM_EVENTS_NO_DATA                = 0,
@@ -98,6 +138,26 @@ static void                                     _wi_filesystem_events_dealloc(wi
 
 static void                                     _wi_filesystem_events_thread(wi_runtime_instance_t *);
 static wi_boolean_t                             _wi_filesystem_events_run_with_timeout(wi_filesystem_events_t *, wi_time_interval_t );
+static wi_boolean_t                             _wi_filesystem_events_add_path(wi_filesystem_events_t *, wi_string_t *, wi_filesystem_events_options_t, wi_filesystem_events_callback_t *, wi_filesystem_events_event_callback_t *);
+
+#ifdef _WI_FILESYSTEM_EVENTS_INOTIFY
+static void                                     _wi_filesystem_events_read_events(wi_filesystem_events_t *, ssize_t);
+static void                                     _wi_filesystem_events_read_event(wi_filesystem_events_t *, struct inotify_event *, _wi_filesystem_events_watch_t *, wi_string_t *);
+static wi_filesystem_event_kind_t               _wi_filesystem_events_kinds_for_mask(uint32_t);
+static wi_boolean_t                             _wi_filesystem_events_add_watch(wi_filesystem_events_t *, _wi_filesystem_events_watch_t *, wi_string_t *);
+static void                                     _wi_filesystem_events_add_watches_for_tree(wi_filesystem_events_t *, _wi_filesystem_events_watch_t *, wi_string_t *, wi_boolean_t);
+static void                                     _wi_filesystem_events_remove_watch(wi_filesystem_events_t *, _wi_filesystem_events_watch_t *, int);
+static void                                     _wi_filesystem_events_remove_watches_for_tree(wi_filesystem_events_t *, _wi_filesystem_events_watch_t *, wi_string_t *);
+static void                                     _wi_filesystem_events_remove_fd(wi_filesystem_events_t *, int);
+static void                                     _wi_filesystem_events_forget_path(wi_filesystem_events_t *, wi_string_t *, int);
+#endif
+
+static void                                     _wi_filesystem_events_add_change(wi_filesystem_events_t *, _wi_filesystem_events_watch_t *, wi_string_t *, wi_filesystem_event_kind_t);
+static void                                     _wi_filesystem_events_deliver_changes(wi_filesystem_events_t *, wi_time_interval_t);
+static void                                     _wi_filesystem_events_deliver_change(wi_filesystem_events_t *, _wi_filesystem_events_watch_t *, wi_string_t *, wi_filesystem_event_kind_t);
+
+static void                                     _wi_filesystem_events_watch_dealloc(wi_runtime_instance_t *);
+static void                                     _wi_filesystem_events_change_dealloc(wi_runtime_instance_t *);
 
 
 static wi_mutable_array_t                       *_wi_filesystem_events;
@@ -114,10 +174,32 @@ static wi_runtime_class_t                       _wi_filesystem_events_runtime_cl
     NULL
 };
 
+static wi_runtime_id_t                          _wi_filesystem_events_watch_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t                       _wi_filesystem_events_watch_runtime_class = {
+    "_wi_filesystem_events_watch_t",
+    _wi_filesystem_events_watch_dealloc,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+static wi_runtime_id_t                          _wi_filesystem_events_change_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t                       _wi_filesystem_events_change_runtime_class = {
+    "_wi_filesystem_events_change_t",
+    _wi_filesystem_events_change_dealloc,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
 
 
 void wi_filesystem_events_register(void) {
     _wi_filesystem_events_runtime_id = wi_runtime_register_class(&_wi_filesystem_events_runtime_class);
+    _wi_filesystem_events_watch_runtime_id = wi_runtime_register_class(&_wi_filesystem_events_watch_runtime_class);
+    _wi_filesystem_events_change_runtime_id = wi_runtime_register_class(&_wi_filesystem_events_change_runtime_class);
 }
 
 
@@ -213,14 +295,13 @@ wi_filesystem_events_t * wi_filesystem_events_init(wi_filesystem_events_t *files
         
         return NULL;
     }
+    
+    filesystem_events->buffer = wi_malloc(_WI_FILESYSTEM_EVENTS_BUFFER_SIZE);
 #endif
     
     filesystem_events->lock = wi_recursive_lock_init(wi_recursive_lock_alloc());
     
-    filesystem_events->callbacks_for_paths = wi_dictionary_init_with_capacity_and_callbacks(wi_mutable_dictionary_alloc(),
-                                                                                            0,
-                                                                                            wi_dictionary_default_key_callbacks,
-                                                                                            wi_dictionary_null_value_callbacks);
+    filesystem_events->watches_for_paths = wi_dictionary_init(wi_mutable_dictionary_alloc());
     
     filesystem_events->fds_for_paths = wi_dictionary_init_with_capacity_and_callbacks(wi_mutable_dictionary_alloc(),
                                                                                       0,
@@ -232,8 +313,16 @@ wi_filesystem_events_t * wi_filesystem_events_init(wi_filesystem_events_t *files
                                                                                       0,
                                                                                       wi_dictionary_null_key_callbacks,
                                                                                       wi_dictionary_default_value_callbacks);
+
+    filesystem_events->watches_for_fds = wi_dictionary_init_with_capacity_and_callbacks(wi_mutable_dictionary_alloc(),
+                                                                                        0,
+                                                                                        wi_dictionary_null_key_callbacks,
+                                                                                        wi_dictionary_default_value_callbacks);
 #endif
     
+    filesystem_events->changes_for_paths = wi_dictionary_init(wi_mutable_dictionary_alloc());
+    filesystem_events->changes = wi_array_init(wi_mutable_array_alloc());
+    
     pthread_once(&_wi_filesystem_events_once_control, _wi_filesystem_events_create_thread);
     
     wi_condition_lock_lock(_wi_filesystem_events_lock);
@@ -248,29 +337,87 @@ wi_filesystem_events_t * wi_filesystem_events_init(wi_filesystem_events_t *files
 static void _wi_filesystem_events_dealloc(wi_runtime_instance_t *instance) {
     wi_filesystem_events_t   *filesystem_events = instance;
     
-    wi_filesystem_events_remove_all_paths(filesystem_events);
+    /* Take the instance away from the shared thread before tearing it down */
+    wi_condition_lock_lock(_wi_filesystem_events_lock);
+    
+    wi_mutable_array_remove_data(_wi_filesystem_events, filesystem_events);
+    
+    if(wi_array_count(_wi_filesystem_events) > 0)
+        wi_condition_lock_unlock_with_condition(_wi_filesystem_events_lock, WI_FILESYSTEM_EVENTS_HAVE_DATA);
+    else
+        wi_condition_lock_unlock_with_condition(_wi_filesystem_events_lock, WI_FILESYSTEM_EVENTS_NO_DATA);
+    
+    if(filesystem_events->lock)
+        wi_filesystem_events_remove_all_paths(filesystem_events);
     
 #if defined(_WI_FILESYSTEM_EVENTS_KQUEUE)
     close(filesystem_events->kqueue);
 #elif defined(_WI_FILESYSTEM_EVENTS_INOTIFY)
     close(filesystem_events->inotify);
+    
+    wi_free(filesystem_events->buffer);
 #endif
     
-    wi_release(filesystem_events->callbacks_for_paths);
+    wi_release(filesystem_events->lock);
+    wi_release(filesystem_events->watches_for_paths);
     wi_release(filesystem_events->fds_for_paths);
 
 #ifdef _WI_FILESYSTEM_EVENTS_INOTIFY
     wi_release(filesystem_events->paths_for_fds);
+    wi_release(filesystem_events->watches_for_fds);
 #endif
+    
+    wi_release(filesystem_events->changes_for_paths);
+    wi_release(filesystem_events->changes);
+}
 
-    wi_condition_lock_lock(_wi_filesystem_events_lock);
+
+
+#pragma mark -
+
+static _wi_filesystem_events_watch_t * _wi_filesystem_events_watch_alloc(void) {
+    return wi_runtime_create_instance(_wi_filesystem_events_watch_runtime_id, sizeof(_wi_filesystem_events_watch_t));
+}
+
+
+
+static void _wi_filesystem_events_watch_dealloc(wi_runtime_instance_t *instance) {
+    _wi_filesystem_events_watch_t   *watch = instance;
     
-    wi_mutable_array_remove_data(_wi_filesystem_events, filesystem_events);
+    wi_release(watch->path);
+}
+
+
+
+static _wi_filesystem_events_change_t * _wi_filesystem_events_change_alloc(void) {
+    return wi_runtime_create_instance(_wi_filesystem_events_change_runtime_id, sizeof(_wi_filesystem_events_change_t));
+}
+
+
+
+static void _wi_filesystem_events_change_dealloc(wi_runtime_instance_t *instance) {
+    _wi_filesystem_events_change_t  *change = instance;
     
-    if(wi_array_count(_wi_filesystem_events) > 0)
-        wi_condition_lock_unlock_with_condition(_wi_filesystem_events_lock, WI_FILESYSTEM_EVENTS_HAVE_DATA);
-    else
-        wi_condition_lock_unlock_with_condition(_wi_filesystem_events_lock, WI_FILESYSTEM_EVENTS_NO_DATA);
+    wi_release(change->path);
+    wi_release(change->watch);
+}
+
+
+
+#pragma mark -
+
+void wi_filesystem_events_set_coalescing_interval(wi_filesystem_events_t *filesystem_events, wi_time_interval_t interval) {
+    wi_recursive_lock_lock(filesystem_events->lock);
+    
+    filesystem_events->coalescing_interval = interval;
+    
+    wi_recursive_lock_unlock(filesystem_events->lock);
+}
+
+
+
+wi_time_interval_t wi_filesystem_events_coalescing_interval(wi_filesystem_events_t *filesystem_events) {
+    return filesystem_events->coalescing_interval;
 }
 
 
@@ -278,25 +425,33 @@ static void _wi_filesystem_events_dealloc(wi_runtime_instance_t *instance) {
 #pragma mark -
 
 static wi_boolean_t _wi_filesystem_events_run_with_timeout(wi_filesystem_events_t *filesystem_events, wi_time_interval_t timeout) {
-    wi_filesystem_events_callback_t     *callback;
+    _wi_filesystem_events_change_t      *change;
+    wi_time_interval_t                  interval, wait;
 #if defined(_WI_FILESYSTEM_EVENTS_KQUEUE)
+    _wi_filesystem_events_watch_t       *watch;
+    wi_filesystem_event_kind_t          kinds;
     struct kevent                       event;
     struct timespec                     ts;
     int                                 result;
 #elif defined(_WI_FILESYSTEM_EVENTS_INOTIFY)
-    wi_string_t                         *path;
-    struct inotify_event                *event;
-    struct timeval                      tv;
-    char                                buffer[1024];
-    fd_set                              rfds;
-    ssize_t                             i, result;
+    struct pollfd                       pfd;
+    ssize_t                             result;
     int                                 state;
 #endif
     
-#if defined(_WI_FILESYSTEM_EVENTS_KQUEUE)
     do {
-        ts = wi_dtots(timeout);
-        result = kevent(filesystem_events->kqueue, NULL, 0, &event, 1, (timeout > 0.0) ? &ts : NULL);
+        wait = timeout;
+        
+        /* Wake up in time for the oldest coalesced change */
+        if(wi_array_count(filesystem_events->changes) > 0) {
+            change = WI_ARRAY(filesystem_events->changes, 0);
+            interval = change->deadline - wi_time_interval();
+            wait = (interval > 0.0) ? ((wait > 0.0) ? WI_MIN(wait, interval) : interval) : 0.001;
+        }
+        
+#if defined(_WI_FILESYSTEM_EVENTS_KQUEUE)
+        ts = wi_dtots(wait);
+        result = kevent(filesystem_events->kqueue, NULL, 0, &event, 1, (wait > 0.0) ? &ts : NULL);
         
         if(result < 0) {
             wi_error_set_errno(errno);
@@ -305,28 +460,42 @@ static wi_boolean_t _wi_filesystem_events_run_with_timeout(wi_filesystem_events_
         }
         else if(result > 0) {
             if(event.filter == EVFILT_VNODE) {
-                callback = wi_dictionary_data_for_key(filesystem_events->callbacks_for_paths, event.udata);
+                watch = event.udata;
+                kinds = 0;
+                
+                if(event.fflags & NOTE_WRITE)
+                    kinds |= WI_FILESYSTEM_EVENT_MODIFIED;
+                
+                if(event.fflags & NOTE_DELETE)
+                    kinds |= WI_FILESYSTEM_EVENT_DELETED;
+                
+                if(event.fflags & NOTE_RENAME)
+                    kinds |= WI_FILESYSTEM_EVENT_RENAMED;
                 
-                if(callback)
-                    (*callback)(filesystem_events, event.udata);
+                if(event.fflags & NOTE_ATTRIB)
+                    kinds |= WI_FILESYSTEM_EVENT_ATTRIBUTES_CHANGED;
+                
+                if(wi_dictionary_data_for_key(filesystem_events->watches_for_paths, watch->path) == watch)
+                    _wi_filesystem_events_add_change(filesystem_events, watch, watch->path, kinds);
             }
         }
-    } while(timeout == 0.0);
 #elif defined(_WI_FILESYSTEM_EVENTS_INOTIFY)
-    do {
-        FD_ZERO(&rfds);
-        FD_SET(filesystem_events->inotify, &rfds);
-
-        tv = wi_dtotv(timeout);
-        state = select(filesystem_events->inotify + 1, &rfds, NULL, NULL, (timeout > 0.0) ? &tv : NULL);
+        pfd.fd = filesystem_events->inotify;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        
+        state = poll(&pfd, 1, (wait > 0.0) ? (int) (wait * 1000.0) : -1);
 
         if(state < 0) {
+            if(errno == EINTR)
+                continue;
+            
             wi_error_set_errno(errno);
 
             return false;
         }
         else if(state > 0) {
-            result = read(filesystem_events->inotify, buffer, sizeof(buffer));
+            result = read(filesystem_events->inotify, filesystem_events->buffer, _WI_FILESYSTEM_EVENTS_BUFFER_SIZE);
 
             if(result < 0) {
                 wi_error_set_errno(errno);
@@ -334,49 +503,410 @@ static wi_boolean_t _wi_filesystem_events_run_with_timeout(wi_filesystem_events_
                 return false;
             }
             else if(result > 0) {
-                i = 0;
+                _wi_filesystem_events_read_events(filesystem_events, result);
+            }
+        }
+#endif
+        
+        _wi_filesystem_events_deliver_changes(filesystem_events, wi_time_interval());
+    } while(timeout == 0.0);
+    
+    return true;
+}
 
-                while(i < result) {
-                    event = (struct inotify_event *) &buffer[i];
-                    path = wi_dictionary_data_for_key(filesystem_events->paths_for_fds, (void *) (intptr_t) event->wd);
 
-                    if(_WI_FILESYSTEM_EVENTS_INOTIFY_MASK & event->mask && path) {
-                        callback = wi_dictionary_data_for_key(filesystem_events->callbacks_for_paths, path);
-                        
-                        if(callback)
-                            (*callback)(filesystem_events, path);
-                    }
 
-                    i += sizeof(*event) + event->len;
-                }
-            }
+#ifdef _WI_FILESYSTEM_EVENTS_INOTIFY
+
+static void _wi_filesystem_events_read_events(wi_filesystem_events_t *filesystem_events, ssize_t length) {
+    _wi_filesystem_events_watch_t       *watch;
+    struct inotify_event                *event;
+    wi_enumerator_t                     *enumerator;
+    wi_array_t                          *watches, *directories;
+    wi_uinteger_t                       j;
+    ssize_t                             i;
+    
+    for(i = 0; i < length; i += sizeof(*event) + event->len) {
+        event = (struct inotify_event *) &filesystem_events->buffer[i];
+        
+        if(event->mask & IN_Q_OVERFLOW) {
+            /* Events were lost, every watcher has to rescan */
+            enumerator = wi_dictionary_data_enumerator(filesystem_events->watches_for_paths);
+            
+            while((watch = wi_enumerator_next_data(enumerator)))
+                _wi_filesystem_events_add_change(filesystem_events, watch, watch->path, WI_FILESYSTEM_EVENT_OVERFLOW);
+            
+            continue;
         }
-    } while(timeout == 0.0);
-#endif
+        
+        watches = wi_dictionary_data_for_key(filesystem_events->watches_for_fds, (void *) (intptr_t) event->wd);
+        directories = wi_dictionary_data_for_key(filesystem_events->paths_for_fds, (void *) (intptr_t) event->wd);
+        
+        if(!watches || !directories)
+            continue;
+        
+        if(event->mask & IN_IGNORED) {
+            _wi_filesystem_events_remove_fd(filesystem_events, event->wd);
+            
+            continue;
+        }
+        
+        /* Watches that overlap share the descriptor, and handling the event may add or remove watches */
+        watches = wi_autorelease(wi_copy(watches));
+        directories = wi_autorelease(wi_copy(directories));
+        
+        for(j = 0; j < wi_array_count(watches); j++)
+            _wi_filesystem_events_read_event(filesystem_events, event, WI_ARRAY(watches, j), WI_ARRAY(directories, j));
+    }
+}
+
+
+
+static void _wi_filesystem_events_read_event(wi_filesystem_events_t *filesystem_events, struct inotify_event *event, _wi_filesystem_events_watch_t *watch, wi_string_t *directory) {
+    wi_string_t                         *path;
+    wi_filesystem_event_kind_t          kinds;
+    
+    if(!watch->event_callback) {
+        if(event->mask & _WI_FILESYSTEM_EVENTS_INOTIFY_MASK)
+            _wi_filesystem_events_add_change(filesystem_events, watch, watch->path, _wi_filesystem_events_kinds_for_mask(event->mask));
+        
+        return;
+    }
+    
+    /* Subdirectories report their own removal through their parent */
+    if(event->len == 0 && (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) && !wi_is_equal(directory, watch->path))
+        return;
+    
+    path = (event->len > 0) ? wi_string_by_appending_path_component(directory, wi_string_with_utf8_string(event->name)) : directory;
+    kinds = _wi_filesystem_events_kinds_for_mask(event->mask);
+    
+    _wi_filesystem_events_add_change(filesystem_events, watch, path, kinds);
+    
+    if(wi_dictionary_data_for_key(filesystem_events->watches_for_paths, watch->path) != watch)
+        return;
+    
+    if((watch->options & WI_FILESYSTEM_EVENTS_RECURSIVE) && (event->mask & IN_ISDIR) && event->len > 0) {
+        if(event->mask & (IN_CREATE | IN_MOVED_TO))
+            _wi_filesystem_events_add_watches_for_tree(filesystem_events, watch, path, true);
+        else if(event->mask & IN_MOVED_FROM)
+            _wi_filesystem_events_remove_watches_for_tree(filesystem_events, watch, path);
+    }
+}
+
+
+
+static wi_filesystem_event_kind_t _wi_filesystem_events_kinds_for_mask(uint32_t mask) {
+    wi_filesystem_event_kind_t      kinds = 0;
+    
+    if(mask & IN_CREATE)
+        kinds |= WI_FILESYSTEM_EVENT_CREATED;
+    
+    if(mask & (IN_DELETE | IN_DELETE_SELF))
+        kinds |= WI_FILESYSTEM_EVENT_DELETED;
+    
+    if(mask & IN_MODIFY)
+        kinds |= WI_FILESYSTEM_EVENT_MODIFIED;
+    
+    if(mask & (IN_MOVE | IN_MOVE_SELF))
+        kinds |= WI_FILESYSTEM_EVENT_RENAMED;
+    
+    if(mask & IN_ATTRIB)
+        kinds |= WI_FILESYSTEM_EVENT_ATTRIBUTES_CHANGED;
+    
+    return kinds;
+}
+
+
+
+static wi_boolean_t _wi_filesystem_events_add_watch(wi_filesystem_events_t *filesystem_events, _wi_filesystem_events_watch_t *watch, wi_string_t *path) {
+    wi_mutable_array_t  *watches, *paths;
+    wi_string_t         *oldpath;
+    wi_uinteger_t       index;
+    uint32_t            mask;
+    int                 fd;
+    
+    if(watch->event_callback)
+        mask = _WI_FILESYSTEM_EVENTS_INOTIFY_ALL_MASK;
+    else
+        mask = _WI_FILESYSTEM_EVENTS_INOTIFY_MASK;
+    
+    if(watch->options & WI_FILESYSTEM_EVENTS_RECURSIVE)
+        mask |= IN_ONLYDIR | IN_DONT_FOLLOW;
+    
+    /* Another watch may already cover the same inode, keep the events it asked for too */
+    fd = inotify_add_watch(filesystem_events->inotify, wi_string_utf8_string(path), mask | IN_MASK_ADD);
+
+    if(fd < 0) {
+        wi_error_set_errno(errno);
+        
+        return false;
+    }
+    
+    /* inotify returns the same descriptor for the same inode, so every watch that reaches it
+       is registered with the path it used, and the descriptor lives until the last one is removed */
+    watches = wi_dictionary_data_for_key(filesystem_events->watches_for_fds, (void *) (intptr_t) fd);
+    paths = wi_dictionary_data_for_key(filesystem_events->paths_for_fds, (void *) (intptr_t) fd);
+    
+    if(!watches) {
+        watches = wi_mutable_array();
+        paths = wi_mutable_array();
+        
+        wi_mutable_dictionary_set_data_for_key(filesystem_events->watches_for_fds, watches, (void *) (intptr_t) fd);
+        wi_mutable_dictionary_set_data_for_key(filesystem_events->paths_for_fds, paths, (void *) (intptr_t) fd);
+    }
+    
+    index = wi_array_index_of_data(watches, watch);
+    
+    if(index == WI_NOT_FOUND) {
+        wi_mutable_array_add_data(watches, watch);
+        wi_mutable_array_add_data(paths, path);
+    } else {
+        /* A directory that was moved keeps its watch descriptor, forget its old path */
+        oldpath = wi_autorelease(wi_retain(WI_ARRAY(paths, index)));
+        
+        wi_mutable_array_replace_data_at_index(paths, path, index);
+        
+        _wi_filesystem_events_forget_path(filesystem_events, oldpath, fd);
+    }
+    
+    wi_mutable_dictionary_set_data_for_key(filesystem_events->fds_for_paths, (void *) (intptr_t) fd, path);
     
     return true;
 }
 
 
 
+static void _wi_filesystem_events_add_watches_for_tree(wi_filesystem_events_t *filesystem_events, _wi_filesystem_events_watch_t *watch, wi_string_t *path, wi_boolean_t report) {
+    wi_directory_reader_t           *reader;
+    wi_string_t                     *subpath;
+    wi_directory_entry_t            entry;
+    wi_directory_entry_stats_t      stats;
+    
+    if(!_wi_filesystem_events_add_watch(filesystem_events, watch, path))
+        return;
+    
+    reader = wi_directory_reader_init_with_path(wi_directory_reader_alloc(), path);
+    
+    if(!reader)
+        return;
+    
+    while(wi_directory_reader_read_entry(reader, &entry) == WI_DIRECTORY_READER_ENTRY) {
+        if(entry.type == WI_DIRECTORY_ENTRY_UNKNOWN)
+            wi_directory_reader_get_stats_for_entry(reader, &entry, WI_DIRECTORY_ENTRY_TYPE, &stats);
+        
+        /* Entries created before the watch existed are reported as new */
+        if(!report && entry.type != WI_DIRECTORY_ENTRY_DIRECTORY)
+            continue;
+        
+        subpath = wi_directory_reader_path_for_entry(reader, &entry);
+        
+        if(report)
+            _wi_filesystem_events_add_change(filesystem_events, watch, subpath, WI_FILESYSTEM_EVENT_CREATED);
+        
+        if(entry.type == WI_DIRECTORY_ENTRY_DIRECTORY)
+            _wi_filesystem_events_add_watches_for_tree(filesystem_events, watch, subpath, report);
+    }
+    
+    wi_release(reader);
+}
+
+
+
+static void _wi_filesystem_events_remove_watch(wi_filesystem_events_t *filesystem_events, _wi_filesystem_events_watch_t *watch, int fd) {
+    wi_mutable_array_t  *watches, *paths;
+    wi_string_t         *path;
+    wi_uinteger_t       index;
+    
+    watches = wi_dictionary_data_for_key(filesystem_events->watches_for_fds, (void *) (intptr_t) fd);
+    paths = wi_dictionary_data_for_key(filesystem_events->paths_for_fds, (void *) (intptr_t) fd);
+    
+    if(!watches)
+        return;
+    
+    index = wi_array_index_of_data(watches, watch);
+    
+    if(index == WI_NOT_FOUND)
+        return;
+    
+    if(wi_array_count(watches) == 1) {
+        inotify_rm_watch(filesystem_events->inotify, fd);
+        
+        _wi_filesystem_events_remove_fd(filesystem_events, fd);
+    } else {
+        path = wi_autorelease(wi_retain(WI_ARRAY(paths, index)));
+        
+        wi_mutable_array_remove_data_at_index(watches, index);
+        wi_mutable_array_remove_data_at_index(paths, index);
+        
+        _wi_filesystem_events_forget_path(filesystem_events, path, fd);
+    }
+}
+
+
+
+static void _wi_filesystem_events_remove_watches_for_tree(wi_filesystem_events_t *filesystem_events, _wi_filesystem_events_watch_t *watch, wi_string_t *path) {
+    wi_enumerator_t     *enumerator;
+    wi_string_t         *prefix, *subpath;
+    int                 fd;
+    
+    prefix = wi_string_by_appending_string(path, WI_STR("/"));
+    enumerator = wi_array_data_enumerator(wi_dictionary_all_keys(filesystem_events->fds_for_paths));
+    
+    while((subpath = wi_enumerator_next_data(enumerator))) {
+        if(wi_is_equal(subpath, path) || wi_string_has_prefix(subpath, prefix)) {
+            fd = (int) (intptr_t) wi_dictionary_data_for_key(filesystem_events->fds_for_paths, subpath);
+            
+            _wi_filesystem_events_remove_watch(filesystem_events, watch, fd);
+        }
+    }
+}
+
+
+
+static void _wi_filesystem_events_remove_fd(wi_filesystem_events_t *filesystem_events, int fd) {
+    wi_array_t          *paths;
+    wi_uinteger_t       i, count;
+    
+    paths = wi_dictionary_data_for_key(filesystem_events->paths_for_fds, (void *) (intptr_t) fd);
+    
+    if(paths) {
+        paths = wi_autorelease(wi_retain(paths));
+        
+        wi_mutable_dictionary_remove_data_for_key(filesystem_events->paths_for_fds, (void *) (intptr_t) fd);
+        
+        count = wi_array_count(paths);
+        
+        for(i = 0; i < count; i++)
+            _wi_filesystem_events_forget_path(filesystem_events, WI_ARRAY(paths, i), fd);
+    }
+    
+    wi_mutable_dictionary_remove_data_for_key(filesystem_events->watches_for_fds, (void *) (intptr_t) fd);
+}
+
+
+
+static void _wi_filesystem_events_forget_path(wi_filesystem_events_t *filesystem_events, wi_string_t *path, int fd) {
+    wi_array_t          *paths;
+    
+    if((int) (intptr_t) wi_dictionary_data_for_key(filesystem_events->fds_for_paths, path) != fd)
+        return;
+    
+    /* Another watch may still reach the descriptor through the same path */
+    paths = wi_dictionary_data_for_key(filesystem_events->paths_for_fds, (void *) (intptr_t) fd);
+    
+    if(!paths || !wi_array_contains_data(paths, path))
+        wi_mutable_dictionary_remove_data_for_key(filesystem_events->fds_for_paths, path);
+}
+
+#endif
+
+
+
+#pragma mark -
+
+static void _wi_filesystem_events_add_change(wi_filesystem_events_t *filesystem_events, _wi_filesystem_events_watch_t *watch, wi_string_t *path, wi_filesystem_event_kind_t kinds) {
+    _wi_filesystem_events_change_t      *change;
+    
+    if(filesystem_events->coalescing_interval <= 0.0) {
+        _wi_filesystem_events_deliver_change(filesystem_events, watch, path, kinds);
+        
+        return;
+    }
+    
+    change = wi_dictionary_data_for_key(filesystem_events->changes_for_paths, path);
+    
+    if(change && change->watch == watch) {
+        change->kinds |= kinds;
+        
+        return;
+    }
+    
+    change              = _wi_filesystem_events_change_alloc();
+    change->path        = wi_retain(path);
+    change->watch       = wi_retain(watch);
+    change->kinds       = kinds;
+    change->deadline    = wi_time_interval() + filesystem_events->coalescing_interval;
+    
+    wi_mutable_dictionary_set_data_for_key(filesystem_events->changes_for_paths, change, path);
+    wi_mutable_array_add_data(filesystem_events->changes, change);
+    wi_release(change);
+}
+
+
+
+static void _wi_filesystem_events_deliver_changes(wi_filesystem_events_t *filesystem_events, wi_time_interval_t interval) {
+    _wi_filesystem_events_change_t      *change;
+    
+    /* Changes are queued in deadline order, since the interval is the same for all of them */
+    while(wi_array_count(filesystem_events->changes) > 0) {
+        change = WI_ARRAY(filesystem_events->changes, 0);
+        
+        if(change->deadline > interval)
+            break;
+        
+        wi_retain(change);
+        
+        wi_mutable_array_remove_data_at_index(filesystem_events->changes, 0);
+        
+        if(wi_dictionary_data_for_key(filesystem_events->changes_for_paths, change->path) == change)
+            wi_mutable_dictionary_remove_data_for_key(filesystem_events->changes_for_paths, change->path);
+        
+        _wi_filesystem_events_deliver_change(filesystem_events, change->watch, change->path, change->kinds);
+        
+        wi_release(change);
+    }
+}
+
+
+
+static void _wi_filesystem_events_deliver_change(wi_filesystem_events_t *filesystem_events, _wi_filesystem_events_watch_t *watch, wi_string_t *path, wi_filesystem_event_kind_t kinds) {
+    /* The path may have been removed while the change was pending */
+    if(wi_dictionary_data_for_key(filesystem_events->watches_for_paths, watch->path) != watch)
+        return;
+    
+    if(watch->event_callback)
+        (*watch->event_callback)(filesystem_events, path, kinds);
+    else if(watch->callback)
+        (*watch->callback)(filesystem_events, watch->path);
+}
+
+
+
 #pragma mark -
 
 wi_boolean_t wi_filesystem_events_add_path_with_callback(wi_filesystem_events_t *filesystem_events, wi_string_t *path, wi_filesystem_events_callback_t *callback) {
+    return _wi_filesystem_events_add_path(filesystem_events, path, 0, callback, NULL);
+}
+
+
+
+wi_boolean_t wi_filesystem_events_add_path_with_options_and_callback(wi_filesystem_events_t *filesystem_events, wi_string_t *path, wi_filesystem_events_options_t options, wi_filesystem_events_event_callback_t *callback) {
+    return _wi_filesystem_events_add_path(filesystem_events, path, options, NULL, callback);
+}
+
+
+
+static wi_boolean_t _wi_filesystem_events_add_path(wi_filesystem_events_t *filesystem_events, wi_string_t *path, wi_filesystem_events_options_t options, wi_filesystem_events_callback_t *callback, wi_filesystem_events_event_callback_t *event_callback) {
+    _wi_filesystem_events_watch_t   *watch;
 #if defined(_WI_FILESYSTEM_EVENTS_KQUEUE)
-    struct kevent   ev;
-    int             fd;
-#elif defined(_WI_FILESYSTEM_EVENTS_INOTIFY)
-    int             fd;
+    struct kevent                   ev;
+    int                             fd;
 #endif
     
     wi_recursive_lock_lock(filesystem_events->lock);
     
-    if(wi_dictionary_contains_key(filesystem_events->callbacks_for_paths, path)) {
+    if(wi_dictionary_contains_key(filesystem_events->watches_for_paths, path)) {
         wi_recursive_lock_unlock(filesystem_events->lock);
     
         return true;
     }
     
+    watch                   = _wi_filesystem_events_watch_alloc();
+    watch->path             = wi_copy(path);
+    watch->options          = options;
+    watch->callback         = callback;
+    watch->event_callback   = event_callback;
+    
 #if defined(_WI_FILESYSTEM_EVENTS_KQUEUE)
     fd = open(wi_string_utf8_string(path),
 #ifdef O_EVTONLY
@@ -389,18 +919,20 @@ wi_boolean_t wi_filesystem_events_add_path_with_callback(wi_filesystem_events_t
     if(fd < 0) {
         wi_error_set_errno(errno);
         
+        wi_release(watch);
         wi_recursive_lock_unlock(filesystem_events->lock);
         
         return false;
     }
     
-    EV_SET(&ev, fd, EVFILT_VNODE, EV_ADD | EV_ENABLE | EV_CLEAR, NOTE_WRITE | NOTE_DELETE | NOTE_RENAME, 0, path);
+    EV_SET(&ev, fd, EVFILT_VNODE, EV_ADD | EV_ENABLE | EV_CLEAR, NOTE_WRITE | NOTE_DELETE | NOTE_RENAME | NOTE_ATTRIB, 0, watch);
     
     if(kevent(filesystem_events->kqueue, &ev, 1, NULL, 0, NULL) < 0) {
         wi_error_set_errno(errno);
         
         close(fd);
         
+        wi_release(watch);
         wi_recursive_lock_unlock(filesystem_events->lock);
         
         return false;
@@ -408,21 +940,19 @@ wi_boolean_t wi_filesystem_events_add_path_with_callback(wi_filesystem_events_t
     
     wi_mutable_dictionary_set_data_for_key(filesystem_events->fds_for_paths, (void *) (intptr_t) fd, path);
 #elif defined(_WI_FILESYSTEM_EVENTS_INOTIFY)
-    fd = inotify_add_watch(filesystem_events->inotify, wi_string_utf8_string(path), _WI_FILESYSTEM_EVENTS_INOTIFY_MASK);
-
-    if(fd < 0) {
-        wi_error_set_errno(errno);
-        
+    if(!_wi_filesystem_events_add_watch(filesystem_events, watch, path)) {
+        wi_release(watch);
         wi_recursive_lock_unlock(filesystem_events->lock);
         
         return false;
     }
-
-    wi_mutable_dictionary_set_data_for_key(filesystem_events->fds_for_paths, (void *) (intptr_t) fd, path);
-    wi_mutable_dictionary_set_data_for_key(filesystem_events->paths_for_fds, path, (void *) (intptr_t) fd);
+    
+    if(options & WI_FILESYSTEM_EVENTS_RECURSIVE)
+        _wi_filesystem_events_add_watches_for_tree(filesystem_events, watch, path, false);
 #endif
 
-    wi_mutable_dictionary_set_data_for_key(filesystem_events->callbacks_for_paths, callback, path);
+    wi_mutable_dictionary_set_data_for_key(filesystem_events->watches_for_paths, watch, path);
+    wi_release(watch);
     
     wi_recursive_lock_unlock(filesystem_events->lock);
 
@@ -432,27 +962,43 @@ wi_boolean_t wi_filesystem_events_add_path_with_callback(wi_filesystem_events_t
 
 
 void wi_filesystem_events_remove_path(wi_filesystem_events_t *filesystem_events, wi_string_t *path) {
-    int     fd;
+    _wi_filesystem_events_watch_t   *watch;
+#ifdef _WI_FILESYSTEM_EVENTS_INOTIFY
+    void                            **fds;
+    wi_uinteger_t                   i, count;
+#else
+    int                             fd;
+#endif
     
     wi_recursive_lock_lock(filesystem_events->lock);
     
-    if(wi_dictionary_contains_key(filesystem_events->callbacks_for_paths, path)) {
+    watch = wi_dictionary_data_for_key(filesystem_events->watches_for_paths, path);
+    
+    if(watch) {
+#if defined(_WI_FILESYSTEM_EVENTS_KQUEUE)
         fd = (int) (intptr_t) wi_dictionary_data_for_key(filesystem_events->fds_for_paths, path);
         
-#if defined(_WI_FILESYSTEM_EVENTS_KQUEUE)
         close(fd);
+        
+        wi_mutable_dictionary_remove_data_for_key(filesystem_events->fds_for_paths, path);
 #elif defined(_WI_FILESYSTEM_EVENTS_INOTIFY)
-        inotify_rm_watch(filesystem_events->inotify, fd);
+        count = wi_dictionary_count(filesystem_events->watches_for_fds);
+        
+        if(count > 0) {
+            fds = wi_malloc(count * sizeof(*fds));
+            
+            wi_dictionary_get_keys_and_data(filesystem_events->watches_for_fds, fds, NULL);
+            
+            for(i = 0; i < count; i++)
+                _wi_filesystem_events_remove_watch(filesystem_events, watch, (int) (intptr_t) fds[i]);
+            
+            wi_free(fds);
+        }
 #endif
+        
+        wi_mutable_dictionary_remove_data_for_key(filesystem_events->watches_for_paths, path);
     }
     
-#if defined(_WI_FILESYSTEM_EVENTS_INOTIFY)
-    wi_mutable_dictionary_remove_data_for_key(filesystem_events->fds_for_paths, (void *) (intptr_t) path);
-#endif
-    
-    wi_mutable_dictionary_remove_data_for_key(filesystem_events->fds_for_paths, path);
-    wi_mutable_dictionary_remove_data_for_key(filesystem_events->callbacks_for_paths, path);
-    
     wi_recursive_lock_unlock(filesystem_events->lock);
 }
 
@@ -474,12 +1020,16 @@ void wi_filesystem_events_remove_all_paths(wi_filesystem_events_t *filesystem_ev
 #endif
     }
     
-    wi_mutable_dictionary_remove_all_data(filesystem_events->callbacks_for_paths);
+    wi_mutable_dictionary_remove_all_data(filesystem_events->watches_for_paths);
     wi_mutable_dictionary_remove_all_data(filesystem_events->fds_for_paths);
 
 #ifdef _WI_FILESYSTEM_EVENTS_INOTIFY
     wi_mutable_dictionary_remove_all_data(filesystem_events->paths_for_fds);
+    wi_mutable_dictionary_remove_all_data(filesystem_events->watches_for_fds);
 #endif
+    
+    wi_mutable_dictionary_remove_all_data(filesystem_events->changes_for_paths);
+    wi_mutable_array_remove_all_data(filesystem_events->changes);
 
     wi_recursive_lock_unlock(filesystem_events->lock);
 }
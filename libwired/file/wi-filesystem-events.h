@@ -30,7 +30,23 @@
 #include <wired/wi-base.h>
 #include <wired/wi-runtime.h>
 
+enum _wi_filesystem_events_options {
+    WI_FILESYSTEM_EVENTS_RECURSIVE              = (1 << 0)
+};
+typedef enum _wi_filesystem_events_options      wi_filesystem_events_options_t;
+
+enum _wi_filesystem_event_kind {
+    WI_FILESYSTEM_EVENT_CREATED                 = (1 << 0),
+    WI_FILESYSTEM_EVENT_DELETED                 = (1 << 1),
+    WI_FILESYSTEM_EVENT_MODIFIED                = (1 << 2),
+    WI_FILESYSTEM_EVENT_RENAMED                 = (1 << 3),
+    WI_FILESYSTEM_EVENT_ATTRIBUTES_CHANGED      = (1 << 4),
+    WI_FILESYSTEM_EVENT_OVERFLOW                = (1 << 5)
+};
+typedef enum _wi_filesystem_event_kind          wi_filesystem_event_kind_t;
+
 typedef void                                wi_filesystem_events_callback_t(wi_filesystem_events_t *, wi_string_t *);
+typedef void                                wi_filesystem_events_event_callback_t(wi_filesystem_events_t *, wi_string_t *, wi_filesystem_event_kind_t);
 
 
 WI_EXPORT wi_runtime_id_t                   wi_filesystem_events_runtime_id(void);
@@ -40,7 +56,11 @@ WI_EXPORT wi_filesystem_events_t *          wi_filesystem_events(void);
 WI_EXPORT wi_filesystem_events_t *          wi_filesystem_events_alloc(void);
 WI_EXPORT wi_filesystem_events_t *          wi_filesystem_events_init(wi_filesystem_events_t *);
 
+WI_EXPORT void                              wi_filesystem_events_set_coalescing_interval(wi_filesystem_events_t *, wi_time_interval_t);
+WI_EXPORT wi_time_interval_t                wi_filesystem_events_coalescing_interval(wi_filesystem_events_t *);
+
 WI_EXPORT wi_boolean_t                      wi_filesystem_events_add_path_with_callback(wi_filesystem_events_t *, wi_string_t *, wi_filesystem_events_callback_t *);
+WI_EXPORT wi_boolean_t                      wi_filesystem_events_add_path_with_options_and_callback(wi_filesystem_events_t *, wi_string_t *, wi_filesystem_events_options_t, wi_filesystem_events_event_callback_t *);
 WI_EXPORT void                              wi_filesystem_events_remove_path(wi_filesystem_events_t *, wi_string_t *);
 WI_EXPORT void                              wi_filesystem_events_remove_all_paths(wi_filesystem_events_t *);
 
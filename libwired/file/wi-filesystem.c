@@ -43,31 +43,202 @@
 #include <sys/statfs.h>
 #endif
 
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+#ifdef HAVE_LINUX_FS_H
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <dirent.h>
+#include <pwd.h>
+#include <grp.h>
 
 #include <wired/wi-array.h>
 #include <wired/wi-assert.h>
 #include <wired/wi-byteorder.h>
 #include <wired/wi-compat.h>
+#include <wired/wi-condition-lock.h>
 #include <wired/wi-date.h>
+#include <wired/wi-directory-reader.h>
+#include <wired/wi-fast-lock.h>
 #include <wired/wi-filesystem.h>
 #include <wired/wi-fts.h>
 #include <wired/wi-lock.h>
+#include <wired/wi-macros.h>
 #include <wired/wi-pool.h>
 #include <wired/wi-private.h>
 #include <wired/wi-runtime.h>
 #include <wired/wi-string.h>
 #include <wired/wi-system.h>
+#include <wired/wi-thread.h>
+
+#define _WI_FILESYSTEM_COPY_CHUNK_SIZE              (8 * 1024 * 1024)
+#define _WI_FILESYSTEM_COPY_BUFFER_SIZE             (1024 * 1024)
+#define _WI_FILESYSTEM_COPY_MAX_THREADS             8
+#define _WI_FILESYSTEM_WALK_MAX_THREADS             8
+#define _WI_FILESYSTEM_WALK_BATCH_SIZE              256
+#define _WI_FILESYSTEM_WALK_SERIAL_DIRECTORIES      16
+#define _WI_FILESYSTEM_WALK_MAX_RETAINED            64
+#define _WI_FILESYSTEM_NAME_CACHE_SIZE              256
+#define _WI_FILESYSTEM_NAME_CACHE_TTL               60.0
+
+
+struct _wi_filesystem_copy {
+    wi_runtime_base_t                       base;
+    
+    wi_filesystem_copy_path_callback_t      *callback;
+    wi_filesystem_copy_path_progress_callback_t *progress_callback;
+    
+    wi_mutable_array_t                      *frompaths;
+    wi_mutable_array_t                      *topaths;
+    wi_uinteger_t                           index;
+    int                                     error;
+    
+    wi_condition_lock_t                     *lock;
+};
+typedef struct _wi_filesystem_copy          _wi_filesystem_copy_t;
+
+
+struct _wi_filesystem_walk_directory {
+    struct _wi_filesystem_walk_directory    *parent;
+    struct _wi_filesystem_walk_directory    *next;
+    
+    char                                    *path;
+    char                                    *name;
+    int                                     fd;
+    
+    /* One for the directory itself plus one per unfinished subdirectory */
+    wi_uinteger_t                           pending;
+    
+    /* Subdirectories that have yet to open themselves relative to fd */
+    wi_uinteger_t                           unopened;
+};
+typedef struct _wi_filesystem_walk_directory _wi_filesystem_walk_directory_t;
+
+
+struct _wi_filesystem_walker {
+    wi_runtime_base_t                       base;
+    
+    wi_boolean_t                            delete;
+    wi_filesystem_delete_path_callback_t    *delete_callback;
+    wi_filesystem_walk_path_callback_t      *walk_callback;
+    
+    wi_boolean_t                            skip_hidden;
+    wi_filesystem_walk_entries_func_t       *entries_callback;
+    void                                    *context;
+    
+    _wi_filesystem_walk_directory_t         *directories;
+    wi_boolean_t                            done;
+    int                                     error;
+    
+    /* Descriptors kept open for subdirectories to open relative to */
+    wi_uinteger_t                           retained;
+    
+#ifdef WI_PTHREADS
+    wi_condition_lock_t                     *lock;
+    wi_condition_lock_t                     *threads_lock;
+#endif
+};
+typedef struct _wi_filesystem_walker        _wi_filesystem_walker_t;
+
+
+struct _wi_filesystem_name {
+    uint32_t                                id;
+    wi_string_t                             *name;
+    wi_time_interval_t                      time;
+};
+typedef struct _wi_filesystem_name          _wi_filesystem_name_t;
+
 
 static wi_boolean_t                         _wi_filesystem_delete_file(wi_string_t *, wi_filesystem_delete_path_callback_t *);
 static wi_boolean_t                         _wi_filesystem_delete_directory(wi_string_t *, wi_filesystem_delete_path_callback_t *);
-static wi_boolean_t                         _wi_filesystem_copy_file(wi_string_t *, wi_string_t *, wi_filesystem_copy_path_callback_t);
-static wi_boolean_t                         _wi_filesystem_copy_directory(wi_string_t *, wi_string_t *, wi_filesystem_copy_path_callback_t);
+
+static _wi_filesystem_copy_t *              _wi_filesystem_copy_alloc(void);
+static void                                 _wi_filesystem_copy_dealloc(wi_runtime_instance_t *);
+static wi_boolean_t                         _wi_filesystem_copy_path(wi_string_t *, wi_string_t *, wi_filesystem_copy_path_callback_t *, wi_filesystem_copy_path_progress_callback_t *);
+static wi_boolean_t                         _wi_filesystem_copy_file(_wi_filesystem_copy_t *, wi_string_t *, wi_string_t *);
+static wi_boolean_t                         _wi_filesystem_copy_file_contents(_wi_filesystem_copy_t *, wi_string_t *, wi_string_t *, int, int, uint64_t);
+static void                                 _wi_filesystem_copy_report_progress(_wi_filesystem_copy_t *, wi_string_t *, wi_string_t *, uint64_t, uint64_t);
+static wi_boolean_t                         _wi_filesystem_copy_directory(_wi_filesystem_copy_t *, wi_string_t *, wi_string_t *);
+static wi_boolean_t                         _wi_filesystem_copy_files(_wi_filesystem_copy_t *);
+
+#ifdef WI_PTHREADS
+static void                                 _wi_filesystem_copy_thread(wi_runtime_instance_t *);
+#endif
+
+static _wi_filesystem_walker_t *            _wi_filesystem_walker_alloc(void);
+static void                                 _wi_filesystem_walker_dealloc(wi_runtime_instance_t *);
+static wi_boolean_t                         _wi_filesystem_walker_walk_path(_wi_filesystem_walker_t *, wi_string_t *);
+static void                                 _wi_filesystem_walker_run(_wi_filesystem_walker_t *, wi_uinteger_t);
+static _wi_filesystem_walk_directory_t *    _wi_filesystem_walker_next_directory(_wi_filesystem_walker_t *);
+static wi_boolean_t                         _wi_filesystem_walker_open_directory(_wi_filesystem_walker_t *, _wi_filesystem_walk_directory_t *);
+static void                                 _wi_filesystem_walker_release_directory(_wi_filesystem_walker_t *, _wi_filesystem_walk_directory_t *);
+static void                                 _wi_filesystem_walker_read_directory(_wi_filesystem_walker_t *, _wi_filesystem_walk_directory_t *, wi_mutable_array_t *);
+static void                                 _wi_filesystem_walker_finish_directory(_wi_filesystem_walker_t *, _wi_filesystem_walk_directory_t *, wi_mutable_array_t *);
+static void                                 _wi_filesystem_walker_set_error(_wi_filesystem_walker_t *, int);
+static void                                 _wi_filesystem_walker_deliver(_wi_filesystem_walker_t *, wi_mutable_array_t *);
+static void                                 _wi_filesystem_walker_deliver_entries(_wi_filesystem_walker_t *, _wi_filesystem_walk_directory_t *, wi_filesystem_walk_entry_t *, wi_uinteger_t);
+static _wi_filesystem_walk_directory_t *    _wi_filesystem_walk_directory_create(_wi_filesystem_walk_directory_t *, const char *);
+static void                                 _wi_filesystem_walk_directory_free(_wi_filesystem_walk_directory_t *);
+
+#ifdef WI_PTHREADS
+static void                                 _wi_filesystem_walker_thread(wi_runtime_instance_t *);
+#endif
+
+static void                                 _wi_filesystem_get_file_stats(wi_file_stats_t *, wi_file_stats_fields_t, dev_t, uint64_t, mode_t, uint64_t, nlink_t, uid_t, gid_t, time_t, time_t);
+static wi_string_t *                        _wi_filesystem_name_for_id(_wi_filesystem_name_t *, uint32_t, wi_boolean_t);
+static wi_string_t *                        _wi_filesystem_user_name_for_id(uint32_t);
+static wi_string_t *                        _wi_filesystem_group_name_for_id(uint32_t);
+
+
+/* Direct-mapped caches of user and group names, so that NSS is not consulted for every stat */
+static _wi_filesystem_name_t                _wi_filesystem_user_names[_WI_FILESYSTEM_NAME_CACHE_SIZE];
+static _wi_filesystem_name_t                _wi_filesystem_group_names[_WI_FILESYSTEM_NAME_CACHE_SIZE];
+static wi_fast_lock_t                       _wi_filesystem_names_lock = WI_FAST_LOCK_INITIALIZER;
+
+static wi_runtime_id_t                      _wi_filesystem_copy_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t                   _wi_filesystem_copy_runtime_class = {
+    "_wi_filesystem_copy_t",
+    _wi_filesystem_copy_dealloc,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+static wi_runtime_id_t                      _wi_filesystem_walker_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t                   _wi_filesystem_walker_runtime_class = {
+    "_wi_filesystem_walker_t",
+    _wi_filesystem_walker_dealloc,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+
+void wi_filesystem_register(void) {
+    _wi_filesystem_copy_runtime_id = wi_runtime_register_class(&_wi_filesystem_copy_runtime_class);
+    _wi_filesystem_walker_runtime_id = wi_runtime_register_class(&_wi_filesystem_walker_runtime_class);
+}
+
+
+
+void wi_filesystem_initialize(void) {
+}
+
+
+
+#pragma mark -
 
 
 wi_string_t * wi_filesystem_temporary_path_with_template(wi_string_t *template) {
@@ -128,7 +299,7 @@ wi_string_t * wi_filesystem_current_directory_path(void) {
 wi_boolean_t wi_filesystem_file_exists_at_path(wi_string_t *path, wi_boolean_t *is_directory) {
     wi_file_stats_t     stats;
     
-    if(!wi_filesystem_get_file_stats_for_path(path, &stats))
+    if(!wi_filesystem_get_file_stats_for_path_with_fields(path, 0, &stats))
         return false;
     
     if(is_directory)
@@ -142,17 +313,46 @@ wi_boolean_t wi_filesystem_file_exists_at_path(wi_string_t *path, wi_boolean_t *
 #pragma mark -
 
 wi_boolean_t wi_filesystem_copy_path(wi_string_t *frompath, wi_string_t *topath) {
-    return wi_filesystem_copy_path_with_callback(frompath, topath, NULL);
+    return _wi_filesystem_copy_path(frompath, topath, NULL, NULL);
 }
 
 
 
 wi_boolean_t wi_filesystem_copy_path_with_callback(wi_string_t *frompath, wi_string_t *topath, wi_filesystem_copy_path_callback_t callback) {
-    wi_file_stats_t     stats;
-    int                 err;
-    wi_boolean_t        result;
+    return _wi_filesystem_copy_path(frompath, topath, callback, NULL);
+}
+
+
+
+wi_boolean_t wi_filesystem_copy_path_with_progress_callback(wi_string_t *frompath, wi_string_t *topath, wi_filesystem_copy_path_progress_callback_t *callback) {
+    return _wi_filesystem_copy_path(frompath, topath, NULL, callback);
+}
+
+
+
+static _wi_filesystem_copy_t * _wi_filesystem_copy_alloc(void) {
+    return wi_runtime_create_instance(_wi_filesystem_copy_runtime_id, sizeof(_wi_filesystem_copy_t));
+}
+
+
+
+static void _wi_filesystem_copy_dealloc(wi_runtime_instance_t *instance) {
+    _wi_filesystem_copy_t   *copy = instance;
+    
+    wi_release(copy->frompaths);
+    wi_release(copy->topaths);
+    wi_release(copy->lock);
+}
+
+
+
+static wi_boolean_t _wi_filesystem_copy_path(wi_string_t *frompath, wi_string_t *topath, wi_filesystem_copy_path_callback_t *callback, wi_filesystem_copy_path_progress_callback_t *progress_callback) {
+    _wi_filesystem_copy_t   *copy;
+    wi_file_stats_t         stats;
+    int                     err;
+    wi_boolean_t            result;
     
-    if(!wi_filesystem_get_file_stats_for_path(frompath, &stats))
+    if(!wi_filesystem_get_file_stats_for_path_with_fields(frompath, 0, &stats))
         return false;
     
     if(wi_filesystem_file_exists_at_path(topath, NULL)) {
@@ -161,14 +361,20 @@ wi_boolean_t wi_filesystem_copy_path_with_callback(wi_string_t *frompath, wi_str
         return false;
     }
     
+    copy                        = _wi_filesystem_copy_alloc();
+    copy->callback              = callback;
+    copy->progress_callback     = progress_callback;
+    
     if(stats.file_type == WI_FILE_DIRECTORY)
-        result = _wi_filesystem_copy_directory(frompath, topath, callback);
+        result = _wi_filesystem_copy_directory(copy, frompath, topath);
     else
-        result = _wi_filesystem_copy_file(frompath, topath, callback);
+        result = _wi_filesystem_copy_file(copy, frompath, topath);
+    
+    err = errno;
+    
+    wi_release(copy);
     
     if(!result) {
-        err = errno;
-        
         wi_filesystem_delete_path(topath);
         
         wi_error_set_errno(err);
@@ -179,10 +385,9 @@ wi_boolean_t wi_filesystem_copy_path_with_callback(wi_string_t *frompath, wi_str
 
 
 
-static wi_boolean_t _wi_filesystem_copy_file(wi_string_t *frompath, wi_string_t *topath, wi_filesystem_copy_path_callback_t callback) {
-    char            buffer[8192];
+static wi_boolean_t _wi_filesystem_copy_file(_wi_filesystem_copy_t *copy, wi_string_t *frompath, wi_string_t *topath) {
+    struct stat     sb;
     int             fromfd = -1, tofd = -1;
-    int             rbytes, wbytes;
     wi_boolean_t    result = false;
     
     fromfd = open(wi_string_utf8_string(frompath), O_RDONLY, 0);
@@ -190,21 +395,27 @@ static wi_boolean_t _wi_filesystem_copy_file(wi_string_t *frompath, wi_string_t
     if(fromfd < 0)
         goto end;
     
+    if(fstat(fromfd, &sb) < 0)
+        goto end;
+    
     tofd = open(wi_string_utf8_string(topath), O_WRONLY | O_TRUNC | O_CREAT, 0666);
     
     if(tofd < 0)
         goto end;
     
-    while((rbytes = read(fromfd, buffer, sizeof(buffer))) > 0) {
-        wbytes = write(tofd, buffer, rbytes);
+    if(!_wi_filesystem_copy_file_contents(copy, frompath, topath, fromfd, tofd, sb.st_size))
+        goto end;
+    
+    if(copy->callback) {
+        if(copy->lock)
+            wi_condition_lock_lock(copy->lock);
+        
+        (*copy->callback)(frompath, topath);
         
-        if(rbytes != wbytes || wbytes < 0)
-            goto end;
+        if(copy->lock)
+            wi_condition_lock_unlock(copy->lock);
     }
     
-    if(callback)
-        (*callback)(frompath, topath);
-    
     result = true;
     
 end:
@@ -219,7 +430,131 @@ end:
 
 
 
-static wi_boolean_t _wi_filesystem_copy_directory(wi_string_t *frompath, wi_string_t *topath, wi_filesystem_copy_path_callback_t callback) {
+static wi_boolean_t _wi_filesystem_copy_file_contents(_wi_filesystem_copy_t *copy, wi_string_t *frompath, wi_string_t *topath, int fromfd, int tofd, uint64_t size) {
+    char            *buffer;
+    off_t           offset;
+    ssize_t         rbytes, wbytes, bytes;
+    wi_uinteger_t   length;
+    
+    offset = 0;
+    
+#ifdef FICLONE
+    /* A reflink shares the source extents and finishes in constant time */
+    if(size > 0 && ioctl(tofd, FICLONE, fromfd) == 0) {
+        _wi_filesystem_copy_report_progress(copy, frompath, topath, size, size);
+        
+        return true;
+    }
+#endif
+    
+#ifdef HAVE_COPY_FILE_RANGE
+    while((uint64_t) offset < size) {
+        bytes = copy_file_range(fromfd, &offset, tofd, NULL, WI_MIN(size - offset, _WI_FILESYSTEM_COPY_CHUNK_SIZE), 0);
+        
+        if(bytes < 0) {
+            if(errno == EINTR)
+                continue;
+            
+            if(errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL)
+                break;
+            
+            return false;
+        }
+        
+        if(bytes == 0)
+            break;
+        
+        _wi_filesystem_copy_report_progress(copy, frompath, topath, offset, size);
+    }
+#endif
+    
+#ifdef HAVE_SYS_SENDFILE_H
+    while((uint64_t) offset < size) {
+        bytes = sendfile(tofd, fromfd, &offset, WI_MIN(size - offset, _WI_FILESYSTEM_COPY_CHUNK_SIZE));
+        
+        if(bytes < 0) {
+            if(errno == EINTR)
+                continue;
+            
+            if(errno == ENOSYS || errno == EINVAL)
+                break;
+            
+            return false;
+        }
+        
+        if(bytes == 0)
+            break;
+        
+        _wi_filesystem_copy_report_progress(copy, frompath, topath, offset, size);
+    }
+#endif
+    
+    /* Whatever is left, including files that grew while being copied, goes through a buffer */
+    if(lseek(fromfd, offset, SEEK_SET) < 0 || lseek(tofd, offset, SEEK_SET) < 0)
+        return false;
+    
+    length = WI_MAX(WI_MIN(size - WI_MIN((uint64_t) offset, size), _WI_FILESYSTEM_COPY_BUFFER_SIZE), 8192);
+    buffer = wi_malloc(length);
+    
+    while(true) {
+        rbytes = read(fromfd, buffer, length);
+        
+        if(rbytes < 0) {
+            if(errno == EINTR)
+                continue;
+            
+            wi_free(buffer);
+            
+            return false;
+        }
+        
+        if(rbytes == 0)
+            break;
+        
+        for(wbytes = 0; wbytes < rbytes; wbytes += bytes) {
+            bytes = write(tofd, buffer + wbytes, rbytes - wbytes);
+            
+            if(bytes < 0) {
+                if(errno == EINTR) {
+                    bytes = 0;
+                    
+                    continue;
+                }
+                
+                wi_free(buffer);
+                
+                return false;
+            }
+        }
+        
+        offset += rbytes;
+        
+        _wi_filesystem_copy_report_progress(copy, frompath, topath, offset, WI_MAX(size, (uint64_t) offset));
+    }
+    
+    wi_free(buffer);
+    
+    return true;
+}
+
+
+
+static void _wi_filesystem_copy_report_progress(_wi_filesystem_copy_t *copy, wi_string_t *frompath, wi_string_t *topath, uint64_t bytes, uint64_t size) {
+    if(!copy->progress_callback)
+        return;
+    
+    if(copy->lock)
+        wi_condition_lock_lock(copy->lock);
+    
+    (*copy->progress_callback)(frompath, topath, bytes, size);
+    
+    if(copy->lock)
+        wi_condition_lock_unlock(copy->lock);
+}
+
+
+
+static wi_boolean_t _wi_filesystem_copy_directory(_wi_filesystem_copy_t *copy, wi_string_t *frompath, wi_string_t *topath) {
     WI_FTS                  *fts;
     WI_FTSENT               *p;
     wi_mutable_string_t     *newpath;
@@ -238,6 +573,10 @@ static wi_boolean_t _wi_filesystem_copy_directory(wi_string_t *frompath, wi_stri
     
     pathlength = wi_string_length(frompath);
     
+    /* Directories are created during the walk, files are queued and copied in parallel afterwards */
+    copy->frompaths     = wi_array_init(wi_mutable_array_alloc());
+    copy->topaths       = wi_array_init(wi_mutable_array_alloc());
+    
     while((p = wi_fts_read(fts))) {
         path        = wi_string_init_with_utf8_string(wi_string_alloc(), p->fts_path);
         newpath     = wi_string_init_with_utf8_string(wi_mutable_string_alloc(), p->fts_path + pathlength);
@@ -260,14 +599,14 @@ static wi_boolean_t _wi_filesystem_copy_directory(wi_string_t *frompath, wi_stri
                 if(!wi_filesystem_create_directory_at_path(newpath)) {
                     result = false;
                 } else {
-                    if(callback)
-                        (*callback)(path, newpath);
+                    if(copy->callback)
+                        (*copy->callback)(path, newpath);
                 }
                 break;
                 
             default:
-                if(!_wi_filesystem_copy_file(path, newpath, callback))
-                    result = false;
+                wi_mutable_array_add_data(copy->frompaths, path);
+                wi_mutable_array_add_data(copy->topaths, newpath);
                 break;
         }
         
@@ -277,11 +616,118 @@ static wi_boolean_t _wi_filesystem_copy_directory(wi_string_t *frompath, wi_stri
     
     wi_fts_close(fts);
     
+    if(!_wi_filesystem_copy_files(copy))
+        result = false;
+    
     return result;
 }
 
 
 
+static wi_boolean_t _wi_filesystem_copy_files(_wi_filesystem_copy_t *copy) {
+    wi_uinteger_t       i, count;
+#ifdef WI_PTHREADS
+    wi_uinteger_t       threads;
+    long                cpus;
+#endif
+    
+    count = wi_array_count(copy->frompaths);
+    
+#ifdef WI_PTHREADS
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = WI_MIN(WI_MAX((cpus > 0) ? (wi_uinteger_t) cpus * 2 : 2, 2), _WI_FILESYSTEM_COPY_MAX_THREADS);
+    threads = WI_MIN(threads, count);
+    
+    if(threads > 1) {
+        copy->lock = wi_condition_lock_init_with_condition(wi_condition_lock_alloc(), 0);
+        
+        /* The threads that did start copy everything, so failing to create
+           more is not an error */
+        for(i = 0; i < threads; i++) {
+            wi_condition_lock_lock(copy->lock);
+            
+            if(!wi_thread_create_thread(_wi_filesystem_copy_thread, copy)) {
+                wi_condition_lock_unlock(copy->lock);
+                
+                break;
+            }
+            
+            wi_condition_lock_unlock_with_condition(copy->lock, wi_condition_lock_condition(copy->lock) + 1);
+        }
+        
+        if(i > 0) {
+            /* The condition counts running copy threads */
+            wi_condition_lock_lock_when_condition(copy->lock, 0, 0.0);
+            wi_condition_lock_unlock(copy->lock);
+            
+            if(copy->error != 0) {
+                errno = copy->error;
+                
+                return false;
+            }
+            
+            return true;
+        }
+    }
+#endif
+    
+    /* Copy serially on this thread if no copy threads could be started */
+    for(i = 0; i < count; i++) {
+        if(!_wi_filesystem_copy_file(copy, WI_ARRAY(copy->frompaths, i), WI_ARRAY(copy->topaths, i)))
+            return false;
+    }
+    
+    return true;
+}
+
+
+
+#ifdef WI_PTHREADS
+
+static void _wi_filesystem_copy_thread(wi_runtime_instance_t *instance) {
+    _wi_filesystem_copy_t   *copy = instance;
+    wi_pool_t               *pool;
+    wi_string_t             *frompath, *topath;
+    wi_uinteger_t           count;
+    
+    pool = wi_pool_init(wi_pool_alloc());
+    count = wi_array_count(copy->frompaths);
+    
+    while(true) {
+        wi_condition_lock_lock(copy->lock);
+        
+        if(copy->index >= count || copy->error != 0) {
+            wi_condition_lock_unlock_with_condition(copy->lock, wi_condition_lock_condition(copy->lock) - 1);
+            
+            break;
+        }
+        
+        frompath    = WI_ARRAY(copy->frompaths, copy->index);
+        topath      = WI_ARRAY(copy->topaths, copy->index);
+        
+        copy->index++;
+        
+        wi_condition_lock_unlock(copy->lock);
+        
+        if(!_wi_filesystem_copy_file(copy, frompath, topath)) {
+            wi_condition_lock_lock(copy->lock);
+            
+            if(copy->error == 0)
+                copy->error = errno;
+            
+            wi_condition_lock_unlock(copy->lock);
+        }
+        
+        wi_pool_drain(pool);
+    }
+    
+    wi_release(pool);
+}
+
+#endif
+
+
+
 wi_boolean_t wi_filesystem_delete_path(wi_string_t *path) {
     return wi_filesystem_delete_path_with_callback(path, NULL);
 }
@@ -291,7 +737,7 @@ wi_boolean_t wi_filesystem_delete_path(wi_string_t *path) {
 wi_boolean_t wi_filesystem_delete_path_with_callback(wi_string_t *path, wi_filesystem_delete_path_callback_t *callback) {
     wi_file_stats_t     stats;
     
-    if(!wi_filesystem_get_file_stats_for_path(path, &stats))
+    if(!wi_filesystem_get_file_stats_for_path_with_fields(path, 0, &stats))
         return false;
     
     if(stats.file_type == WI_FILE_DIRECTORY)
@@ -318,74 +764,595 @@ static wi_boolean_t _wi_filesystem_delete_file(wi_string_t *path, wi_filesystem_
 
 
 static wi_boolean_t _wi_filesystem_delete_directory(wi_string_t *path, wi_filesystem_delete_path_callback_t *callback) {
-    WI_FTS          *fts;
-    WI_FTSENT       *p;
-    char            *paths[2];
-    wi_boolean_t    result = true;
-    int             err = 0;
+    _wi_filesystem_walker_t     *walker;
+    wi_boolean_t                result;
     
-    paths[0] = (char *) wi_string_utf8_string(path);
-    paths[1] = NULL;
+    walker                      = _wi_filesystem_walker_alloc();
+    walker->delete              = true;
+    walker->delete_callback     = callback;
     
-    errno = 0;
+    result = _wi_filesystem_walker_walk_path(walker, path);
+    
+    wi_release(walker);
+    
+    return result;
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_filesystem_walk_path_with_callback(wi_string_t *path, wi_filesystem_walk_path_callback_t *callback) {
+    _wi_filesystem_walker_t     *walker;
+    wi_boolean_t                result;
+    
+    walker                      = _wi_filesystem_walker_alloc();
+    walker->walk_callback       = callback;
+    
+    result = _wi_filesystem_walker_walk_path(walker, path);
+    
+    wi_release(walker);
+    
+    return result;
+}
+
+
+
+wi_boolean_t wi_filesystem_walk_path_with_entries_callback(wi_string_t *path, wi_boolean_t skip_hidden, wi_filesystem_walk_entries_func_t *callback, void *context) {
+    _wi_filesystem_walker_t     *walker;
+    wi_boolean_t                result;
+    
+    walker                      = _wi_filesystem_walker_alloc();
+    walker->skip_hidden         = skip_hidden;
+    walker->entries_callback    = callback;
+    walker->context             = context;
+    
+    result = _wi_filesystem_walker_walk_path(walker, path);
+    
+    wi_release(walker);
+    
+    return result;
+}
+
 
-    fts = wi_fts_open(paths, WI_FTS_NOSTAT | WI_FTS_LOGICAL, NULL);
 
-    if(!fts || errno != 0)
+wi_boolean_t wi_filesystem_get_walk_entry_at(int fd, const char *name, wi_filesystem_walk_entry_t *entry) {
+#ifdef HAVE_STATX
+    struct statx        stx;
+    unsigned int        mask = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME;
+#endif
+    struct stat         sb;
+    
+#ifdef HAVE_STATX
+    if(statx(fd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, mask, &stx) == 0) {
+        /* Filesystems may leave out fields that were asked for, fstatat() below fills those in */
+        if((stx.stx_mask & mask) == mask) {
+            entry->mode                 = stx.stx_mode;
+            entry->size                 = stx.stx_size;
+            entry->modification_time    = stx.stx_mtime.tv_sec + ((double) stx.stx_mtime.tv_nsec / 1000000000.0);
+            
+            return true;
+        }
+    } else if(errno != ENOSYS) {
         return false;
+    }
+#endif
     
-    while((p = wi_fts_read(fts))) {
-        switch(p->fts_info) {
-            case WI_FTS_NS:
-            case WI_FTS_ERR:
-            case WI_FTS_DNR:
-                err = p->fts_errno;
-                result = false;
+    if(fstatat(fd, name, &sb, AT_SYMLINK_NOFOLLOW) < 0)
+        return false;
+    
+    entry->mode                 = sb.st_mode;
+    entry->size                 = sb.st_size;
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+    entry->modification_time    = sb.st_mtim.tv_sec + ((double) sb.st_mtim.tv_nsec / 1000000000.0);
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    entry->modification_time    = sb.st_mtimespec.tv_sec + ((double) sb.st_mtimespec.tv_nsec / 1000000000.0);
+#else
+    entry->modification_time    = sb.st_mtime;
+#endif
+    
+    return true;
+}
+
+
+
+static _wi_filesystem_walker_t * _wi_filesystem_walker_alloc(void) {
+    return wi_runtime_create_instance(_wi_filesystem_walker_runtime_id, sizeof(_wi_filesystem_walker_t));
+}
+
+
+
+static void _wi_filesystem_walker_dealloc(wi_runtime_instance_t *instance) {
+#ifdef WI_PTHREADS
+    _wi_filesystem_walker_t     *walker = instance;
+    
+    wi_release(walker->lock);
+    wi_release(walker->threads_lock);
+#endif
+}
+
+
+
+static wi_boolean_t _wi_filesystem_walker_walk_path(_wi_filesystem_walker_t *walker, wi_string_t *path) {
+#ifdef WI_PTHREADS
+    wi_uinteger_t       i, threads;
+    long                cpus;
+#endif
+    
+    walker->directories = _wi_filesystem_walk_directory_create(NULL, wi_string_utf8_string(path));
+    
+#ifdef WI_PTHREADS
+    /* The condition is 1 while there is a directory to take or the walk is done */
+    walker->lock = wi_condition_lock_init_with_condition(wi_condition_lock_alloc(), 1);
+    
+    /* The condition counts running walker threads, the lock also serializes callbacks */
+    walker->threads_lock = wi_condition_lock_init_with_condition(wi_condition_lock_alloc(), 0);
+    
+    /* Small trees are done before starting any threads would pay off */
+    _wi_filesystem_walker_run(walker, _WI_FILESYSTEM_WALK_SERIAL_DIRECTORIES);
+    
+    if(!walker->done) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = WI_MIN(WI_MAX((cpus > 0) ? (wi_uinteger_t) cpus * 2 : 2, 2), _WI_FILESYSTEM_WALK_MAX_THREADS);
+        
+        /* The calling thread is one of the workers */
+        for(i = 1; i < threads; i++) {
+            wi_condition_lock_lock(walker->threads_lock);
+            
+            if(!wi_thread_create_thread(_wi_filesystem_walker_thread, walker)) {
+                wi_condition_lock_unlock(walker->threads_lock);
+                
                 break;
+            }
+            
+            wi_condition_lock_unlock_with_condition(walker->threads_lock, wi_condition_lock_condition(walker->threads_lock) + 1);
+        }
+        
+        _wi_filesystem_walker_run(walker, 0);
+        
+        wi_condition_lock_lock_when_condition(walker->threads_lock, 0, 0.0);
+        wi_condition_lock_unlock(walker->threads_lock);
+    }
+#else
+    _wi_filesystem_walker_run(walker, 0);
+#endif
+    
+    if(walker->error != 0) {
+        wi_error_set_errno(walker->error);
+        
+        return false;
+    }
+    
+    return true;
+}
+
+
+
+static void _wi_filesystem_walker_run(_wi_filesystem_walker_t *walker, wi_uinteger_t limit) {
+    _wi_filesystem_walk_directory_t     *directory;
+    wi_pool_t                           *pool;
+    wi_mutable_array_t                  *batch;
+    wi_uinteger_t                       count = 0;
+    
+    pool = wi_pool_init(wi_pool_alloc());
+    batch = wi_array_init_with_capacity(wi_mutable_array_alloc(), _WI_FILESYSTEM_WALK_BATCH_SIZE);
+    
+    /* A limit of 0 runs until the walk is done */
+    while((limit == 0 || count < limit) && (directory = _wi_filesystem_walker_next_directory(walker))) {
+        _wi_filesystem_walker_read_directory(walker, directory, batch);
+        
+        if(wi_array_count(batch) >= _WI_FILESYSTEM_WALK_BATCH_SIZE)
+            _wi_filesystem_walker_deliver(walker, batch);
+        
+        wi_pool_drain(pool);
+        
+        count++;
+    }
+    
+    _wi_filesystem_walker_deliver(walker, batch);
+    
+    wi_release(batch);
+    wi_release(pool);
+}
+
+
+
+static _wi_filesystem_walk_directory_t * _wi_filesystem_walker_next_directory(_wi_filesystem_walker_t *walker) {
+    _wi_filesystem_walk_directory_t     *directory;
+    
+#ifdef WI_PTHREADS
+    wi_condition_lock_lock_when_condition(walker->lock, 1, 0.0);
+#endif
+    
+    directory = walker->directories;
+    
+    if(directory)
+        walker->directories = directory->next;
+    
+#ifdef WI_PTHREADS
+    wi_condition_lock_unlock_with_condition(walker->lock, (walker->directories || walker->done) ? 1 : 0);
+#endif
+    
+    return directory;
+}
+
+
+
+static void _wi_filesystem_walker_read_directory(_wi_filesystem_walker_t *walker, _wi_filesystem_walk_directory_t *directory, wi_mutable_array_t *batch) {
+    _wi_filesystem_walk_directory_t     *subdirectory, *subdirectories = NULL, *last = NULL;
+    wi_filesystem_walk_entry_t          *entries = NULL, entry;
+    struct dirent                       *de;
+    struct stat                         sb;
+    DIR                                 *dir;
+    char                                *path, *name;
+    wi_uinteger_t                       i, count = 0, entries_count = 0, entries_capacity = 0;
+    wi_boolean_t                        is_directory, report;
+    int                                 fd;
+    
+    report = (walker->delete_callback || walker->walk_callback);
+    
+    if(!_wi_filesystem_walker_open_directory(walker, directory)) {
+        _wi_filesystem_walker_set_error(walker, errno);
+        _wi_filesystem_walker_finish_directory(walker, directory, batch);
+        
+        return;
+    }
+    
+    /* Entries are resolved against the directory descriptor, so the stream gets its own */
+    fd = dup(directory->fd);
+    dir = (fd >= 0) ? fdopendir(fd) : NULL;
+    
+    if(!dir) {
+        _wi_filesystem_walker_set_error(walker, errno);
+        
+        if(fd >= 0)
+            close(fd);
+        
+        close(directory->fd);
+        
+        directory->fd = -1;
+        
+        _wi_filesystem_walker_finish_directory(walker, directory, batch);
+        
+        return;
+    }
+    
+    errno = 0;
+    
+    while((de = readdir(dir))) {
+        if(strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        
+        if(walker->skip_hidden && de->d_name[0] == '.')
+            continue;
+        
+        if(walker->entries_callback) {
+            if(!wi_filesystem_get_walk_entry_at(directory->fd, de->d_name, &entry)) {
+                _wi_filesystem_walker_set_error(walker, errno);
                 
-            case WI_FTS_DC:
-                err = ELOOP;
+                errno = 0;
                 
-                result = false;
-                break;
+                continue;
+            }
+            
+            if(entries_count == entries_capacity) {
+                entries_capacity = WI_MAX(entries_capacity * 2, 64);
+                entries = wi_realloc(entries, entries_capacity * sizeof(wi_filesystem_walk_entry_t));
+            }
+            
+            /* The dirent is reused by the next readdir() */
+            entry.name_length   = strlen(de->d_name);
+            name                = wi_malloc(entry.name_length + 1);
+            
+            memcpy(name, de->d_name, entry.name_length);
+            
+            entry.name          = name;
+            
+            entries[entries_count++] = entry;
+            
+            is_directory = S_ISDIR(entry.mode);
+        }
+#ifdef DT_DIR
+        else if(de->d_type != DT_UNKNOWN) {
+            is_directory = (de->d_type == DT_DIR);
+        }
+#endif
+        else {
+            if(fstatat(directory->fd, de->d_name, &sb, AT_SYMLINK_NOFOLLOW) < 0) {
+                _wi_filesystem_walker_set_error(walker, errno);
+                
+                errno = 0;
+                
+                continue;
+            }
+            
+            is_directory = S_ISDIR(sb.st_mode);
+        }
+        
+        if(is_directory) {
+            subdirectory = _wi_filesystem_walk_directory_create(directory, de->d_name);
+            
+            if(last)
+                last->next = subdirectory;
+            else
+                subdirectories = subdirectory;
+            
+            last = subdirectory;
+            count++;
+            
+            if(report && !walker->delete)
+                wi_mutable_array_add_data(batch, wi_string_with_utf8_string(subdirectory->path));
+        } else {
+            if(walker->delete && unlinkat(directory->fd, de->d_name, 0) < 0) {
+                _wi_filesystem_walker_set_error(walker, errno);
+            } else if(report) {
+                path = wi_malloc(strlen(directory->path) + strlen(de->d_name) + 2);
+                
+                sprintf(path, "%s/%s", directory->path, de->d_name);
+                wi_mutable_array_add_data(batch, wi_string_with_utf8_string(path));
+                wi_free(path);
+            }
+        }
+        
+        errno = 0;
+    }
+    
+    if(errno != 0)
+        _wi_filesystem_walker_set_error(walker, errno);
+    
+    closedir(dir);
+    
+    if(entries_count > 0) {
+        _wi_filesystem_walker_deliver_entries(walker, directory, entries, entries_count);
+        
+        for(i = 0; i < entries_count; i++)
+            wi_free((char *) entries[i].name);
+    }
+    
+    wi_free(entries);
+    
+    /* Subdirectories open themselves relative to this descriptor, but only a
+       limited number are kept, so deep trees do not run out of descriptors */
+    if(count > 0 && __sync_add_and_fetch(&walker->retained, 1) <= _WI_FILESYSTEM_WALK_MAX_RETAINED) {
+        directory->unopened = count;
+    } else {
+        if(count > 0)
+            __sync_sub_and_fetch(&walker->retained, 1);
+        
+        close(directory->fd);
+        
+        directory->fd = -1;
+    }
+    
+    if(count > 0) {
+        /* Account for the subdirectories before anyone can finish them */
+        __sync_add_and_fetch(&directory->pending, count);
+        
+#ifdef WI_PTHREADS
+        wi_condition_lock_lock(walker->lock);
+#endif
+        
+        last->next = walker->directories;
+        walker->directories = subdirectories;
+        
+#ifdef WI_PTHREADS
+        wi_condition_lock_unlock_with_condition(walker->lock, 1);
+#endif
+    }
+    
+    _wi_filesystem_walker_finish_directory(walker, directory, batch);
+}
 
-            case WI_FTS_D:
-                break;
 
-            case WI_FTS_DP:
-                if(rmdir(p->fts_path) < 0) {
-                    err = errno;
 
-                    result = false;
-                } else {
-                    if(callback)
-                        (*callback)(wi_string_with_utf8_string(p->fts_path));
-                }
-                break;
+static wi_boolean_t _wi_filesystem_walker_open_directory(_wi_filesystem_walker_t *walker, _wi_filesystem_walk_directory_t *directory) {
+    _wi_filesystem_walk_directory_t     *parent;
+    int                                 error;
+    
+    parent = directory->parent;
+    
+    if(!parent) {
+        directory->fd = open(directory->path, O_RDONLY | O_DIRECTORY);
+        
+        return (directory->fd >= 0);
+    }
+    
+    /* The parent keeps its descriptor until its last subdirectory has released it */
+    if(parent->fd >= 0) {
+        directory->fd = openat(parent->fd, directory->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+        
+        if(directory->fd >= 0 || (errno != EMFILE && errno != ENFILE)) {
+            error = errno;
+            
+            _wi_filesystem_walker_release_directory(walker, parent);
+            
+            errno = error;
+            
+            return (directory->fd >= 0);
+        }
+    }
+    
+    /* Releasing the parent first may free up a descriptor for the path */
+    _wi_filesystem_walker_release_directory(walker, parent);
+    
+    directory->fd = open(directory->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    
+    return (directory->fd >= 0);
+}
 
-            default:
-                if(unlink(p->fts_path) < 0) {
-                    err = errno;
 
-                    result = false;
-                } else {
-                    if(callback)
-                        (*callback)(wi_string_with_utf8_string(p->fts_path));
-                }
-                break;
+
+static void _wi_filesystem_walker_release_directory(_wi_filesystem_walker_t *walker, _wi_filesystem_walk_directory_t *directory) {
+    if(directory->fd < 0)
+        return;
+    
+    if(__sync_sub_and_fetch(&directory->unopened, 1) == 0) {
+        close(directory->fd);
+        
+        directory->fd = -1;
+        
+        __sync_sub_and_fetch(&walker->retained, 1);
+    }
+}
+
+
+
+static void _wi_filesystem_walker_finish_directory(_wi_filesystem_walker_t *walker, _wi_filesystem_walk_directory_t *directory, wi_mutable_array_t *batch) {
+    _wi_filesystem_walk_directory_t     *parent;
+    int                                 result;
+    
+    while(directory && __sync_sub_and_fetch(&directory->pending, 1) == 0) {
+        parent = directory->parent;
+        
+        if(directory->fd >= 0) {
+            close(directory->fd);
+            
+            directory->fd = -1;
+            
+            __sync_sub_and_fetch(&walker->retained, 1);
+        }
+        
+        /* The parent descriptor may already be closed, so remove by path */
+        if(walker->delete) {
+            result = rmdir(directory->path);
+            
+            if(result < 0)
+                _wi_filesystem_walker_set_error(walker, errno);
+            else if(walker->delete_callback)
+                wi_mutable_array_add_data(batch, wi_string_with_utf8_string(directory->path));
+        }
+        
+        if(!parent) {
+#ifdef WI_PTHREADS
+            wi_condition_lock_lock(walker->lock);
+#endif
+            
+            walker->done = true;
+            
+#ifdef WI_PTHREADS
+            wi_condition_lock_unlock_with_condition(walker->lock, 1);
+#endif
         }
+        
+        _wi_filesystem_walk_directory_free(directory);
+        
+        directory = parent;
     }
+}
+
+
+
+static void _wi_filesystem_walker_set_error(_wi_filesystem_walker_t *walker, int error) {
+#ifdef WI_PTHREADS
+    wi_condition_lock_lock(walker->lock);
+#endif
     
-    wi_fts_close(fts);
+    if(walker->error == 0)
+        walker->error = error;
     
-    if(err > 0)
-        wi_error_set_errno(err);
+#ifdef WI_PTHREADS
+    wi_condition_lock_unlock(walker->lock);
+#endif
+}
 
-    return result;
+
+
+static void _wi_filesystem_walker_deliver(_wi_filesystem_walker_t *walker, wi_mutable_array_t *batch) {
+    wi_uinteger_t       i, count;
+    
+    count = wi_array_count(batch);
+    
+    if(count == 0)
+        return;
+    
+#ifdef WI_PTHREADS
+    wi_condition_lock_lock(walker->threads_lock);
+#endif
+    
+    if(walker->walk_callback) {
+        (*walker->walk_callback)(batch);
+    } else {
+        for(i = 0; i < count; i++)
+            (*walker->delete_callback)(WI_ARRAY(batch, i));
+    }
+    
+#ifdef WI_PTHREADS
+    wi_condition_lock_unlock(walker->threads_lock);
+#endif
+    
+    wi_mutable_array_remove_all_data(batch);
+}
+
+
+
+static void _wi_filesystem_walker_deliver_entries(_wi_filesystem_walker_t *walker, _wi_filesystem_walk_directory_t *directory, wi_filesystem_walk_entry_t *entries, wi_uinteger_t count) {
+#ifdef WI_PTHREADS
+    wi_condition_lock_lock(walker->threads_lock);
+#endif
+    
+    (*walker->entries_callback)(directory->path, entries, count, walker->context);
+    
+#ifdef WI_PTHREADS
+    wi_condition_lock_unlock(walker->threads_lock);
+#endif
+}
+
+
+
+#ifdef WI_PTHREADS
+
+static void _wi_filesystem_walker_thread(wi_runtime_instance_t *instance) {
+    _wi_filesystem_walker_t     *walker = instance;
+    
+    _wi_filesystem_walker_run(walker, 0);
+    
+    wi_condition_lock_lock(walker->threads_lock);
+    wi_condition_lock_unlock_with_condition(walker->threads_lock, wi_condition_lock_condition(walker->threads_lock) - 1);
+}
+
+#endif
+
+
+
+static _wi_filesystem_walk_directory_t * _wi_filesystem_walk_directory_create(_wi_filesystem_walk_directory_t *parent, const char *name) {
+    _wi_filesystem_walk_directory_t     *directory;
+    wi_uinteger_t                       length;
+    
+    directory           = wi_malloc(sizeof(_wi_filesystem_walk_directory_t));
+    directory->parent   = parent;
+    directory->fd       = -1;
+    directory->pending  = 1;
+    
+    if(parent) {
+        length              = strlen(parent->path);
+        directory->path     = wi_malloc(length + strlen(name) + 2);
+        
+        sprintf(directory->path, "%s/%s", parent->path, name);
+        
+        directory->name     = directory->path + length + 1;
+    } else {
+        length              = strlen(name);
+        directory->path     = wi_malloc(length + 1);
+        
+        memcpy(directory->path, name, length);
+        
+        directory->name     = directory->path;
+    }
+    
+    return directory;
+}
+
+
+
+static void _wi_filesystem_walk_directory_free(_wi_filesystem_walk_directory_t *directory) {
+    wi_free(directory->path);
+    wi_free(directory);
 }
 
 
 
+#pragma mark -
+
 wi_boolean_t wi_filesystem_rename_path(wi_string_t *path, wi_string_t *newpath) {
     if(rename(wi_string_utf8_string(path), wi_string_utf8_string(newpath)) < 0) {
         wi_error_set_errno(errno);
@@ -413,106 +1380,177 @@ wi_boolean_t wi_filesystem_create_symbolic_link_from_path(wi_string_t *frompath,
 #pragma mark -
 
 wi_boolean_t wi_filesystem_get_file_stats_for_path(wi_string_t *path, wi_file_stats_t *stats) {
-    struct passwd       *user;
-    struct group        *group;
+    return wi_filesystem_get_file_stats_for_path_with_fields(path, WI_FILE_STATS_ALL, stats);
+}
+
+
+
+wi_boolean_t wi_filesystem_get_file_stats_for_path_with_fields(wi_string_t *path, wi_file_stats_fields_t fields, wi_file_stats_t *stats) {
 #if defined(HAVE_STAT64) && !defined(_DARWIN_FEATURE_64_BIT_INODE)
-    struct stat64        sb;
+    struct stat64       sb;
     
     if(lstat64(wi_string_utf8_string(path), &sb) < 0) {
         wi_error_set_errno(errno);
         
         return false;
     }
+#else
+    struct stat         sb;
     
-    if(stats) {
-        stats->filesystem_id        = sb.st_dev;
-        stats->file_id              = sb.st_ino;
-        
-        if(S_ISREG(sb.st_mode))
-            stats->file_type        = WI_FILE_REGULAR;
-        else if(S_ISDIR(sb.st_mode))
-            stats->file_type        = WI_FILE_DIRECTORY;
-        else if(S_ISLNK(sb.st_mode))
-            stats->file_type        = WI_FILE_SYMBOLIC_LINK;
-        else if(S_ISSOCK(sb.st_mode))
-            stats->file_type        = WI_FILE_SOCKET;
-        else if(S_ISFIFO(sb.st_mode))
-            stats->file_type        = WI_FILE_PIPE;
-        else
-            stats->file_type        = WI_FILE_UNKNOWN;
-        
-        stats->size                 = sb.st_size;
-        stats->posix_permissions    = sb.st_mode;
-        stats->reference_count      = sb.st_nlink;
-        stats->user_id              = sb.st_uid;
-        
-        if((user = getpwuid(sb.st_uid)))
-            stats->user              = wi_string_with_utf8_string(user->pw_name);
-        
-        stats->group_id             = sb.st_gid;
-        
-        if((group = getgrgid(sb.st_gid)))
-            stats->group            = wi_string_with_utf8_string(group->gr_name);
+    if(lstat(wi_string_utf8_string(path), &sb) < 0) {
+        wi_error_set_errno(errno);
         
+        return false;
+    }
+#endif
+    
+    if(stats) {
 #ifdef HAVE_STRUCT_STAT_ST_BIRTHTIME
-        stats->creation_date        = wi_date_with_time(sb.st_birthtime);
+        _wi_filesystem_get_file_stats(stats, fields, sb.st_dev, sb.st_ino, sb.st_mode, sb.st_size, sb.st_nlink, sb.st_uid, sb.st_gid, sb.st_birthtime, sb.st_mtime);
 #else
-        stats->creation_date        = wi_date_with_time(sb.st_ctime);
+        _wi_filesystem_get_file_stats(stats, fields, sb.st_dev, sb.st_ino, sb.st_mode, sb.st_size, sb.st_nlink, sb.st_uid, sb.st_gid, sb.st_ctime, sb.st_mtime);
 #endif
-        
-        stats->modification_date    = wi_date_with_time(sb.st_mtime);
     }
     
     return true;
-#else
-    struct stat        sb;
+}
+
+
+
+static void _wi_filesystem_get_file_stats(wi_file_stats_t *stats, wi_file_stats_fields_t fields, dev_t dev, uint64_t ino, mode_t mode, uint64_t size, nlink_t nlink, uid_t uid, gid_t gid, time_t ctime, time_t mtime) {
+    stats->filesystem_id        = dev;
+    stats->file_id              = ino;
     
-    if(lstat(wi_string_utf8_string(path), &sb) < 0) {
-        wi_error_set_errno(errno);
+    if(S_ISREG(mode))
+        stats->file_type        = WI_FILE_REGULAR;
+    else if(S_ISDIR(mode))
+        stats->file_type        = WI_FILE_DIRECTORY;
+    else if(S_ISLNK(mode))
+        stats->file_type        = WI_FILE_SYMBOLIC_LINK;
+    else if(S_ISSOCK(mode))
+        stats->file_type        = WI_FILE_SOCKET;
+    else if(S_ISFIFO(mode))
+        stats->file_type        = WI_FILE_PIPE;
+    else
+        stats->file_type        = WI_FILE_UNKNOWN;
+    
+    stats->size                 = size;
+    stats->posix_permissions    = mode;
+    stats->reference_count      = nlink;
+    stats->user_id              = uid;
+    stats->user                 = (fields & WI_FILE_STATS_USER) ? _wi_filesystem_name_for_id(_wi_filesystem_user_names, uid, true) : NULL;
+    stats->group_id             = gid;
+    stats->group                = (fields & WI_FILE_STATS_GROUP) ? _wi_filesystem_name_for_id(_wi_filesystem_group_names, gid, false) : NULL;
+    stats->creation_time        = ctime;
+    stats->creation_date        = (fields & WI_FILE_STATS_CREATION_DATE) ? wi_date_with_time(ctime) : NULL;
+    stats->modification_time    = mtime;
+    stats->modification_date    = (fields & WI_FILE_STATS_MODIFICATION_DATE) ? wi_date_with_time(mtime) : NULL;
+}
+
+
+
+static wi_string_t * _wi_filesystem_name_for_id(_wi_filesystem_name_t *names, uint32_t id, wi_boolean_t user) {
+    _wi_filesystem_name_t   *entry;
+    wi_string_t             *name;
+    wi_time_interval_t      interval;
+    
+    interval = wi_time_interval();
+    entry = &names[id % _WI_FILESYSTEM_NAME_CACHE_SIZE];
+    
+    wi_fast_lock_lock(&_wi_filesystem_names_lock);
+    
+    /* Lookups that found nothing are cached too, until they expire */
+    if(entry->time != 0.0 && entry->id == id && interval - entry->time <= _WI_FILESYSTEM_NAME_CACHE_TTL) {
+        name = wi_retain(entry->name);
         
-        return false;
+        wi_fast_lock_unlock(&_wi_filesystem_names_lock);
+        
+        return wi_autorelease(name);
     }
     
-    if(stats) {
-        stats->filesystem_id        = sb.st_dev;
-        stats->file_id              = sb.st_ino;
-        
-        if(S_ISREG(sb.st_mode))
-            stats->file_type        = WI_FILE_REGULAR;
-        else if(S_ISDIR(sb.st_mode))
-            stats->file_type        = WI_FILE_DIRECTORY;
-        else if(S_ISLNK(sb.st_mode))
-            stats->file_type        = WI_FILE_SYMBOLIC_LINK;
-        else if(S_ISSOCK(sb.st_mode))
-            stats->file_type        = WI_FILE_SOCKET;
-        else if(S_ISFIFO(sb.st_mode))
-            stats->file_type        = WI_FILE_PIPE;
-        else
-            stats->file_type        = WI_FILE_UNKNOWN;
-        
-        stats->size                 = sb.st_size;
-        stats->posix_permissions    = sb.st_mode;
-        stats->reference_count      = sb.st_nlink;
-        stats->user_id              = sb.st_uid;
-        
-        if((user = getpwuid(sb.st_uid)))
-           stats->user              = wi_string_with_utf8_string(user->pw_name);
-        
-        stats->group_id             = sb.st_gid;
-        
-        if((group = getgrgid(sb.st_gid)))
-            stats->group            = wi_string_with_utf8_string(group->gr_name);
-        
-#ifdef HAVE_STRUCT_STAT_ST_BIRTHTIME
-        stats->creation_date        = wi_date_with_time(sb.st_birthtime);
+    wi_fast_lock_unlock(&_wi_filesystem_names_lock);
+    
+    /* NSS may go out to the network, so other threads are not kept waiting on it */
+    name = user ? _wi_filesystem_user_name_for_id(id) : _wi_filesystem_group_name_for_id(id);
+    
+    wi_fast_lock_lock(&_wi_filesystem_names_lock);
+    
+    wi_release(entry->name);
+    
+    entry->id       = id;
+    entry->name     = wi_retain(name);
+    entry->time     = interval;
+    
+    wi_fast_lock_unlock(&_wi_filesystem_names_lock);
+    
+    return wi_autorelease(name);
+}
+
+
+
+static wi_string_t * _wi_filesystem_user_name_for_id(uint32_t id) {
+#ifdef HAVE_GETPWUID_R
+    struct passwd       user, *result;
+    wi_string_t         *name = NULL;
+    char                *buffer;
+    size_t              size;
+    int                 err;
+    
+    size = 1024;
+    buffer = wi_malloc(size);
+    
+    while((err = getpwuid_r(id, &user, buffer, size, &result)) == ERANGE) {
+        size *= 2;
+        buffer = wi_realloc(buffer, size);
+    }
+    
+    if(err == 0 && result)
+        name = wi_string_init_with_utf8_string(wi_string_alloc(), result->pw_name);
+    
+    wi_free(buffer);
+    
+    return name;
 #else
-        stats->creation_date        = wi_date_with_time(sb.st_ctime);
+    struct passwd       *user;
+    
+    if(!(user = getpwuid(id)))
+        return NULL;
+    
+    return wi_string_init_with_utf8_string(wi_string_alloc(), user->pw_name);
 #endif
-        
-        stats->modification_date    = wi_date_with_time(sb.st_mtime);
+}
+
+
+
+static wi_string_t * _wi_filesystem_group_name_for_id(uint32_t id) {
+#ifdef HAVE_GETGRGID_R
+    struct group        group, *result;
+    wi_string_t         *name = NULL;
+    char                *buffer;
+    size_t              size;
+    int                 err;
+    
+    size = 1024;
+    buffer = wi_malloc(size);
+    
+    while((err = getgrgid_r(id, &group, buffer, size, &result)) == ERANGE) {
+        size *= 2;
+        buffer = wi_realloc(buffer, size);
     }
     
-    return true;
+    if(err == 0 && result)
+        name = wi_string_init_with_utf8_string(wi_string_alloc(), result->gr_name);
+    
+    wi_free(buffer);
+    
+    return name;
+#else
+    struct group        *group;
+    
+    if(!(group = getgrgid(id)))
+        return NULL;
+    
+    return wi_string_init_with_utf8_string(wi_string_alloc(), group->gr_name);
 #endif
 }
 
@@ -557,34 +1595,32 @@ wi_boolean_t wi_filesystem_get_filesystem_stats_for_path(wi_string_t *path, wi_f
 #pragma mark -
 
 wi_array_t * wi_filesystem_directory_contents_at_path(wi_string_t *path) {
-    wi_mutable_array_t        *contents;
-    wi_string_t                *name;
-    DIR                        *dir;
-    struct dirent            *de, *dep;
+    wi_mutable_array_t              *contents;
+    wi_directory_reader_t           *reader;
+    wi_string_t                     *name;
+    wi_directory_entry_t            entry;
+    wi_directory_reader_status_t    status;
     
-    dir = opendir(wi_string_utf8_string(path));
+    reader = wi_directory_reader_init_with_path(wi_directory_reader_alloc(), path);
     
-    if(!dir) {
-        wi_error_set_errno(errno);
-        
+    if(!reader)
         return NULL;
-    }
     
     contents = wi_array_init_with_capacity(wi_mutable_array_alloc(), 100);
     
-    de = wi_malloc(sizeof(struct dirent) + WI_PATH_SIZE);
-    
-    while(readdir_r(dir, de, &dep) == 0 && dep) {
-        if(strcmp(dep->d_name, ".") != 0 && strcmp(dep->d_name, "..") != 0) {
-            name = wi_string_init_with_utf8_string(wi_string_alloc(), dep->d_name);
-            wi_mutable_array_add_data(contents, name);
-            wi_release(name);
-        }
+    while((status = wi_directory_reader_read_entry(reader, &entry)) == WI_DIRECTORY_READER_ENTRY) {
+        name = wi_string_init_with_utf8_bytes(wi_string_alloc(), entry.name, entry.name_length);
+        wi_mutable_array_add_data(contents, name);
+        wi_release(name);
     }
     
-    wi_free(de);
+    wi_release(reader);
     
-    closedir(dir);
+    if(status == WI_DIRECTORY_READER_ERROR) {
+        wi_release(contents);
+        
+        return NULL;
+    }
     
     wi_runtime_make_immutable(contents);
     
@@ -596,3 +1632,9 @@ wi_array_t * wi_filesystem_directory_contents_at_path(wi_string_t *path) {
 wi_directory_enumerator_t * wi_filesystem_directory_enumerator_at_path(wi_string_t *path) {
     return wi_autorelease(wi_directory_enumerator_init_with_path(wi_directory_enumerator_alloc(), path));
 }
+
+
+
+wi_directory_reader_t * wi_filesystem_directory_reader_at_path(wi_string_t *path) {
+    return wi_autorelease(wi_directory_reader_init_with_path(wi_directory_reader_alloc(), path));
+}
@@ -57,9 +57,23 @@ struct _wi_file_stats {
     wi_string_t                             *group;
     wi_date_t                               *creation_date;
     wi_date_t                               *modification_date;
+    wi_time_interval_t                      creation_time;
+    wi_time_interval_t                      modification_time;
 };
 typedef struct _wi_file_stats               wi_file_stats_t;
 
+enum _wi_file_stats_fields {
+    WI_FILE_STATS_USER                      = (1 << 0),
+    WI_FILE_STATS_GROUP                     = (1 << 1),
+    WI_FILE_STATS_CREATION_DATE             = (1 << 2),
+    WI_FILE_STATS_MODIFICATION_DATE         = (1 << 3),
+    WI_FILE_STATS_ALL                       = WI_FILE_STATS_USER |
+                                              WI_FILE_STATS_GROUP |
+                                              WI_FILE_STATS_CREATION_DATE |
+                                              WI_FILE_STATS_MODIFICATION_DATE
+};
+typedef enum _wi_file_stats_fields          wi_file_stats_fields_t;
+
 struct _wi_filesystem_stats {
     uint32_t                                filesystem_id;
     uint64_t                                size;
@@ -71,6 +85,8 @@ typedef struct _wi_filesystem_stats         wi_filesystem_stats_t;
 
 typedef void                                wi_filesystem_delete_path_callback_t(wi_string_t *);
 typedef void                                wi_filesystem_copy_path_callback_t(wi_string_t *, wi_string_t *);
+typedef void                                wi_filesystem_copy_path_progress_callback_t(wi_string_t *, wi_string_t *, uint64_t, uint64_t);
+typedef void                                wi_filesystem_walk_path_callback_t(wi_array_t *);
 
 
 WI_EXPORT wi_string_t *                     wi_filesystem_temporary_path_with_template(wi_string_t *);
@@ -83,15 +99,19 @@ WI_EXPORT wi_boolean_t                      wi_filesystem_file_exists_at_path(wi
 
 WI_EXPORT wi_boolean_t                      wi_filesystem_copy_path(wi_string_t *, wi_string_t *);
 WI_EXPORT wi_boolean_t                      wi_filesystem_copy_path_with_callback(wi_string_t *, wi_string_t *, wi_filesystem_copy_path_callback_t);
+WI_EXPORT wi_boolean_t                      wi_filesystem_copy_path_with_progress_callback(wi_string_t *, wi_string_t *, wi_filesystem_copy_path_progress_callback_t *);
 WI_EXPORT wi_boolean_t                      wi_filesystem_delete_path(wi_string_t *);
 WI_EXPORT wi_boolean_t                      wi_filesystem_delete_path_with_callback(wi_string_t *, wi_filesystem_delete_path_callback_t *);
+WI_EXPORT wi_boolean_t                      wi_filesystem_walk_path_with_callback(wi_string_t *, wi_filesystem_walk_path_callback_t *);
 WI_EXPORT wi_boolean_t                      wi_filesystem_rename_path(wi_string_t *, wi_string_t *);
 WI_EXPORT wi_boolean_t                      wi_filesystem_create_symbolic_link_from_path(wi_string_t *, wi_string_t *);
 
 WI_EXPORT wi_boolean_t                      wi_filesystem_get_file_stats_for_path(wi_string_t *, wi_file_stats_t *);
+WI_EXPORT wi_boolean_t                      wi_filesystem_get_file_stats_for_path_with_fields(wi_string_t *, wi_file_stats_fields_t, wi_file_stats_t *);
 WI_EXPORT wi_boolean_t                      wi_filesystem_get_filesystem_stats_for_path(wi_string_t *, wi_filesystem_stats_t *);
 
 WI_EXPORT wi_array_t *                      wi_filesystem_directory_contents_at_path(wi_string_t *);
 WI_EXPORT wi_directory_enumerator_t *       wi_filesystem_directory_enumerator_at_path(wi_string_t *);
+WI_EXPORT wi_directory_reader_t *           wi_filesystem_directory_reader_at_path(wi_string_t *);
 
 #endif /* WI_FILESYSTEM_H */
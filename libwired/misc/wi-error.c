@@ -91,6 +91,9 @@ static const char                       *_wi_error_strings[] = {
     /* WI_ERROR_CIPHER_CIPHERNOTSUPPORTED */
     "Cipher not supported",
     
+    /* WI_ERROR_FILE_INDEX_READFAILED */
+    "File index read failed",
+    
     /* WI_ERROR_HOST_NOAVAILABLEADDRESSES */
     "No available addresses",
     
@@ -107,6 +110,11 @@ static const char                       *_wi_error_strings[] = {
     /* WI_ERROR_JSON_WRITEFAILED */
     "JSON write failed",
     
+    /* WI_ERROR_ARCHIVE_READFAILED */
+    "Archive read failed",
+    /* WI_ERROR_ARCHIVE_WRITEFAILED */
+    "Archive write failed",
+    
     /* WI_ERROR_SOCKET_NOVALIDCIPHER */
     "No valid cipher",
     /* WI_ERROR_SOCKET_EOF */
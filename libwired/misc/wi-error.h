@@ -52,6 +52,8 @@ enum _wi_error_code {
     
     WI_ERROR_CIPHER_CIPHERNOTSUPPORTED,
     
+    WI_ERROR_FILE_INDEX_READFAILED,
+    
     WI_ERROR_HOST_NOAVAILABLEADDRESSES,
     
     WI_ERROR_LOG_NOSUCHFACILITY,
@@ -61,6 +63,9 @@ enum _wi_error_code {
     
     WI_ERROR_JSON_READFAILED,
     WI_ERROR_JSON_WRITEFAILED,
+    
+    WI_ERROR_ARCHIVE_READFAILED,
+    WI_ERROR_ARCHIVE_WRITEFAILED,
 
     WI_ERROR_SOCKET_NOVALIDCIPHER,
     WI_ERROR_SOCKET_EOF,
@@ -30,6 +30,7 @@
 #include <wired/wi-base.h>
 
 #define WI_TEST_EXPORT                  WI_EXPORT
+#define WI_BENCHMARK_EXPORT             WI_EXPORT
 
 #define WI_TEST_FAIL(fmt, ...)                                          \
     WI_ASSERT(false, fmt, ## __VA_ARGS__)
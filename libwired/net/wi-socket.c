@@ -64,8 +64,8 @@
 #include <wired/wi-date.h>
 #include <wired/wi-dh.h>
 #include <wired/wi-dsa.h>
+#include <wired/wi-fast-lock.h>
 #include <wired/wi-macros.h>
-#include <wired/wi-lock.h>
 #include <wired/wi-pool.h>
 #include <wired/wi-private.h>
 #include <wired/wi-rsa.h>
@@ -116,10 +116,13 @@ static wi_boolean_t                     _wi_socket_set_option_int(wi_socket_t *,
 static wi_boolean_t                     _wi_socket_get_option_int(wi_socket_t *, int, int, int *);
 
 static wi_integer_t                     _wi_socket_read_bytes(wi_socket_t *, wi_time_interval_t, void *, wi_uinteger_t);
+#ifdef HAVE_OPENSSL_SSL_H
+static wi_integer_t                     _wi_socket_read_tls_bytes(wi_socket_t *, wi_time_interval_t, void *, wi_uinteger_t);
+#endif
 
 
 #if defined(HAVE_OPENSSL_SSL_H) && defined(WI_PTHREADS)
-static wi_mutable_array_t               *_wi_socket_ssl_locks;
+static wi_fast_lock_t                   *_wi_socket_ssl_locks;
 #endif
 
 
@@ -144,7 +147,7 @@ void wi_socket_register(void) {
 void wi_socket_initialize(void) {
 #ifdef HAVE_OPENSSL_SSL_H
 #ifdef WI_PTHREADS
-    wi_lock_t       *lock;
+    wi_fast_lock_t  lock = WI_FAST_LOCK_INITIALIZER;
     wi_uinteger_t   i, count;
 #endif
 
@@ -152,13 +155,10 @@ void wi_socket_initialize(void) {
 
 #ifdef WI_PTHREADS
     count = CRYPTO_num_locks();
-    _wi_socket_ssl_locks = wi_array_init_with_capacity(wi_mutable_array_alloc(), count);
+    _wi_socket_ssl_locks = wi_malloc(count * sizeof(wi_fast_lock_t));
     
-    for(i = 0; i < count; i++) {
-        lock = wi_lock_init(wi_lock_alloc());
-        wi_mutable_array_add_data(_wi_socket_ssl_locks, lock);
-        wi_release(lock);
-    }
+    for(i = 0; i < count; i++)
+        _wi_socket_ssl_locks[i] = lock;
 
     CRYPTO_set_id_callback(_wi_socket_ssl_id_function);
     CRYPTO_set_locking_callback(_wi_socket_ssl_locking_function);
@@ -179,14 +179,10 @@ static unsigned long _wi_socket_ssl_id_function(void) {
 
 
 static void _wi_socket_ssl_locking_function(int mode, int n, const char *file, int line) {
-    wi_lock_t   *lock;
-    
-    lock = WI_ARRAY(_wi_socket_ssl_locks, n);
-    
     if(mode & CRYPTO_LOCK)
-        wi_lock_lock(lock);
+        wi_fast_lock_lock(&_wi_socket_ssl_locks[n]);
     else
-        wi_lock_unlock(lock);
+        wi_fast_lock_unlock(&_wi_socket_ssl_locks[n]);
 }
 
 #endif
@@ -1371,9 +1367,6 @@ wi_data_t * wi_socket_read_data(wi_socket_t *socket, wi_time_interval_t timeout,
 
 
 wi_integer_t wi_socket_read_bytes(wi_socket_t *socket, wi_time_interval_t timeout, void *buffer, wi_uinteger_t length) {
-#ifdef HAVE_OPENSSL_SSL_H
-    wi_socket_state_t   state;
-#endif
     wi_uinteger_t       offset;
     wi_integer_t        bytes;
     
@@ -1381,59 +1374,81 @@ wi_integer_t wi_socket_read_bytes(wi_socket_t *socket, wi_time_interval_t timeou
     WI_ASSERT(socket->sd >= 0, "socket %@ should be valid", socket);
     
 #ifdef HAVE_OPENSSL_SSL_H
-    if(socket->ssl) {
-        while(true) {
-            if(timeout > 0.0 && SSL_pending(socket->ssl) == 0) {
-                state = wi_socket_wait_descriptor(socket->sd, timeout, true, false);
+    if(socket->ssl)
+        return _wi_socket_read_tls_bytes(socket, timeout, buffer, length);
+#endif
+    
+    offset = 0;
+    
+    while(offset < length) {
+        bytes = _wi_socket_read_bytes(socket, timeout, buffer + offset, length - offset);
+        
+        if(bytes <= 0)
+            return bytes;
+        
+        offset += bytes;
+    }
+    
+    return offset;
+}
 
-                if(state != WI_SOCKET_READY) {
-                    if(state == WI_SOCKET_TIMEOUT)
-                        wi_error_set_errno(ETIMEDOUT);
-                    
-                    return -1;
-                }
-            }
-            
-            ERR_clear_error();
-            
-            bytes = SSL_read(socket->ssl, buffer, length);
-            
-            if(bytes > 0) {
-                break;
-            } else {
-                if(bytes < 0 && SSL_get_error(socket->ssl, bytes) == SSL_ERROR_WANT_READ)
-                    continue;
 
-                wi_error_set_openssl_ssl_error_with_result(socket->ssl, bytes);
+
+wi_integer_t wi_socket_read_available_bytes(wi_socket_t *socket, wi_time_interval_t timeout, void *buffer, wi_uinteger_t length) {
+    WI_ASSERT(buffer != NULL, "buffer of length %u should not be NULL", length);
+    WI_ASSERT(socket->sd >= 0, "socket %@ should be valid", socket);
+    
+#ifdef HAVE_OPENSSL_SSL_H
+    if(socket->ssl)
+        return _wi_socket_read_tls_bytes(socket, timeout, buffer, length);
+#endif
+    
+    return _wi_socket_read_bytes(socket, timeout, buffer, length);
+}
+
+
+
+#ifdef HAVE_OPENSSL_SSL_H
+
+static wi_integer_t _wi_socket_read_tls_bytes(wi_socket_t *socket, wi_time_interval_t timeout, void *buffer, wi_uinteger_t length) {
+    wi_socket_state_t   state;
+    wi_integer_t        bytes;
+    
+    while(true) {
+        if(timeout > 0.0 && SSL_pending(socket->ssl) == 0) {
+            state = wi_socket_wait_descriptor(socket->sd, timeout, true, false);
+
+            if(state != WI_SOCKET_READY) {
+                if(state == WI_SOCKET_TIMEOUT)
+                    wi_error_set_errno(ETIMEDOUT);
                 
-                break;
+                return -1;
             }
         }
         
         ERR_clear_error();
         
-        return bytes;
-    } else {
-#endif
-        offset = 0;
+        bytes = SSL_read(socket->ssl, buffer, length);
         
-        while(offset < length) {
-            bytes = _wi_socket_read_bytes(socket, timeout, buffer + offset, length - offset);
-            
-            if(bytes <= 0)
-                return bytes;
+        if(bytes > 0) {
+            break;
+        } else {
+            if(bytes < 0 && SSL_get_error(socket->ssl, bytes) == SSL_ERROR_WANT_READ)
+                continue;
+
+            wi_error_set_openssl_ssl_error_with_result(socket->ssl, bytes);
             
-            offset += bytes;
+            break;
         }
-        
-        return offset;
-#ifdef HAVE_OPENSSL_SSL_H
     }
-#endif
-
-    return 0;
+    
+    ERR_clear_error();
+    
+    return bytes;
 }
 
+#endif
+
 
 
 static wi_integer_t _wi_socket_read_bytes(wi_socket_t *socket, wi_time_interval_t timeout, void *buffer, wi_uinteger_t length) {
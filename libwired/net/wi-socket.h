@@ -117,5 +117,6 @@ WI_EXPORT wi_integer_t                  wi_socket_write_data(wi_socket_t *, wi_t
 WI_EXPORT wi_integer_t                  wi_socket_write_bytes(wi_socket_t *, wi_time_interval_t, const void *, wi_uinteger_t);
 WI_EXPORT wi_data_t *                   wi_socket_read_data(wi_socket_t *, wi_time_interval_t, wi_uinteger_t);
 WI_EXPORT wi_integer_t                  wi_socket_read_bytes(wi_socket_t *, wi_time_interval_t, void *, wi_uinteger_t);
+WI_EXPORT wi_integer_t                  wi_socket_read_available_bytes(wi_socket_t *, wi_time_interval_t, void *, wi_uinteger_t);
 
 #endif /* WI_SOCKET_H */
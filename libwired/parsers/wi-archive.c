@@ -0,0 +1,917 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <wired/wi-archive.h>
+#include <wired/wi-array.h>
+#include <wired/wi-byteorder.h>
+#include <wired/wi-data.h>
+#include <wired/wi-date.h>
+#include <wired/wi-dictionary.h>
+#include <wired/wi-file.h>
+#include <wired/wi-macros.h>
+#include <wired/wi-null.h>
+#include <wired/wi-number.h>
+#include <wired/wi-pipe.h>
+#include <wired/wi-pool.h>
+#include <wired/wi-private.h>
+#include <wired/wi-runtime.h>
+#include <wired/wi-socket.h>
+#include <wired/wi-string.h>
+#include <wired/wi-system.h>
+
+/* An archive is a header followed by a single value:
+ *
+ *   "WA" <version> <flags> <payload length, 32 bits big endian> <value>
+ *
+ * Every value starts with a tag byte. Integers, lengths and counts are
+ * unsigned LEB128 varints, signed integers are zigzag encoded first. Every
+ * string literal is appended to a per-archive table, and repeated strings
+ * are written as references into it. */
+#define _WI_ARCHIVE_MAGIC                       "WA"
+#define _WI_ARCHIVE_VERSION                     1
+#define _WI_ARCHIVE_HEADER_LENGTH               8
+#define _WI_ARCHIVE_MAX_DEPTH                   512
+#define _WI_ARCHIVE_MAX_STREAM_LENGTH           (256 * 1024 * 1024)
+
+#define _WI_ARCHIVE_NULL                        0x00
+#define _WI_ARCHIVE_FALSE                       0x01
+#define _WI_ARCHIVE_TRUE                        0x02
+#define _WI_ARCHIVE_INTEGER                     0x03
+#define _WI_ARCHIVE_REAL                        0x04
+#define _WI_ARCHIVE_STRING                      0x05
+#define _WI_ARCHIVE_STRING_REFERENCE            0x06
+#define _WI_ARCHIVE_DATA                        0x07
+#define _WI_ARCHIVE_DATE                        0x08
+#define _WI_ARCHIVE_ARRAY                       0x09
+#define _WI_ARCHIVE_DICTIONARY                  0x0A
+
+/* Integers from 0 to 127 are stored in the tag byte itself */
+#define _WI_ARCHIVE_SMALL_INTEGER               0x80
+
+
+typedef wi_integer_t                            _wi_archive_write_func_t(wi_runtime_instance_t *, wi_time_interval_t, const void *, wi_uinteger_t);
+
+
+struct _wi_archive_encoder {
+    unsigned char                               *bytes;
+    wi_uinteger_t                               length;
+    wi_uinteger_t                               capacity;
+    
+    wi_mutable_dictionary_t                     *strings;
+    
+    void                                        **scratch;
+    wi_uinteger_t                               scratch_count;
+    wi_uinteger_t                               scratch_capacity;
+    
+    wi_uinteger_t                               depth;
+};
+typedef struct _wi_archive_encoder              _wi_archive_encoder_t;
+
+
+struct _wi_archive_decoder {
+    wi_data_t                                   *data;
+    const unsigned char                         *bytes;
+    wi_uinteger_t                               position;
+    wi_uinteger_t                               length;
+    
+    wi_string_t                                 **strings;
+    wi_uinteger_t                               strings_count;
+    wi_uinteger_t                               strings_capacity;
+    
+    wi_uinteger_t                               depth;
+};
+typedef struct _wi_archive_decoder              _wi_archive_decoder_t;
+
+
+static wi_integer_t                             _wi_archive_read_bytes(wi_runtime_instance_t *, wi_time_interval_t, wi_archive_read_func_t *, void *, wi_uinteger_t);
+static wi_integer_t                             _wi_archive_read_file(wi_runtime_instance_t *, wi_time_interval_t, void *, wi_uinteger_t);
+static wi_integer_t                             _wi_archive_read_socket(wi_runtime_instance_t *, wi_time_interval_t, void *, wi_uinteger_t);
+static wi_integer_t                             _wi_archive_read_pipe(wi_runtime_instance_t *, wi_time_interval_t, void *, wi_uinteger_t);
+static wi_boolean_t                             _wi_archive_read_header(const unsigned char *, wi_uinteger_t *);
+
+static wi_boolean_t                             _wi_archive_write_instance(wi_runtime_instance_t *, wi_runtime_instance_t *, wi_time_interval_t, _wi_archive_write_func_t *);
+static wi_integer_t                             _wi_archive_write_file(wi_runtime_instance_t *, wi_time_interval_t, const void *, wi_uinteger_t);
+static wi_integer_t                             _wi_archive_write_socket(wi_runtime_instance_t *, wi_time_interval_t, const void *, wi_uinteger_t);
+static wi_integer_t                             _wi_archive_write_pipe(wi_runtime_instance_t *, wi_time_interval_t, const void *, wi_uinteger_t);
+
+static wi_runtime_instance_t *                  _wi_archive_decode(wi_data_t *, wi_uinteger_t, wi_uinteger_t);
+static wi_runtime_instance_t *                  _wi_archive_decode_value(_wi_archive_decoder_t *);
+static wi_runtime_instance_t *                  _wi_archive_decode_container(_wi_archive_decoder_t *, unsigned char);
+static wi_boolean_t                             _wi_archive_decode_varint(_wi_archive_decoder_t *, uint64_t *);
+static wi_boolean_t                             _wi_archive_decode_length(_wi_archive_decoder_t *, wi_uinteger_t *);
+
+static unsigned char *                          _wi_archive_encode(wi_runtime_instance_t *, wi_uinteger_t *);
+static wi_boolean_t                             _wi_archive_encode_value(_wi_archive_encoder_t *, wi_runtime_instance_t *);
+static wi_boolean_t                             _wi_archive_encode_dictionary(_wi_archive_encoder_t *, wi_dictionary_t *);
+static wi_boolean_t                             _wi_archive_encode_array(_wi_archive_encoder_t *, wi_array_t *);
+static void                                     _wi_archive_encode_number(_wi_archive_encoder_t *, wi_number_t *);
+static void                                     _wi_archive_encode_string(_wi_archive_encoder_t *, wi_string_t *);
+static void                                     _wi_archive_encode_double(_wi_archive_encoder_t *, unsigned char, double);
+static void                                     _wi_archive_encode_varint(_wi_archive_encoder_t *, unsigned char, uint64_t);
+static void                                     _wi_archive_encode_bytes(_wi_archive_encoder_t *, const void *, wi_uinteger_t);
+static void                                     _wi_archive_encode_reserve(_wi_archive_encoder_t *, wi_uinteger_t);
+
+
+
+wi_runtime_instance_t * wi_archive_instance_for_data(wi_data_t *data) {
+    wi_uinteger_t       length;
+    
+    if(wi_data_length(data) < _WI_ARCHIVE_HEADER_LENGTH) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+            WI_STR("Archive of %lu bytes is too short"),
+            wi_data_length(data));
+        
+        return NULL;
+    }
+    
+    if(!_wi_archive_read_header(wi_data_bytes(data), &length))
+        return NULL;
+    
+    if(length != wi_data_length(data) - _WI_ARCHIVE_HEADER_LENGTH) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+            WI_STR("Archive payload of %lu bytes does not match its header, which says %lu bytes"),
+            wi_data_length(data) - _WI_ARCHIVE_HEADER_LENGTH,
+            length);
+        
+        return NULL;
+    }
+    
+    return _wi_archive_decode(data, _WI_ARCHIVE_HEADER_LENGTH, wi_data_length(data));
+}
+
+
+
+wi_runtime_instance_t * wi_archive_read_instance_from_file(wi_file_t *file) {
+    return wi_archive_read_instance_with_function(file, 0.0, _wi_archive_read_file);
+}
+
+
+
+wi_runtime_instance_t * wi_archive_read_instance_from_socket(wi_socket_t *socket, wi_time_interval_t timeout) {
+    return wi_archive_read_instance_with_function(socket, timeout, _wi_archive_read_socket);
+}
+
+
+
+wi_runtime_instance_t * wi_archive_read_instance_from_pipe(wi_pipe_t *pipe) {
+    return wi_archive_read_instance_with_function(pipe, 0.0, _wi_archive_read_pipe);
+}
+
+
+
+wi_runtime_instance_t * wi_archive_read_instance_with_function(wi_runtime_instance_t *source, wi_time_interval_t timeout, wi_archive_read_func_t *read) {
+    wi_data_t           *data;
+    unsigned char       header[_WI_ARCHIVE_HEADER_LENGTH];
+    void                *bytes;
+    wi_uinteger_t       length;
+    wi_integer_t        result;
+    
+    result = _wi_archive_read_bytes(source, timeout, read, header, sizeof(header));
+    
+    if(result < 0)
+        return NULL;
+    
+    if(result == 0) {
+        wi_error_set_libwired_error(WI_ERROR_SOCKET_EOF);
+        
+        return NULL;
+    }
+    
+    if(result < (wi_integer_t) sizeof(header)) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+            WI_STR("Archive header is truncated"));
+        
+        return NULL;
+    }
+    
+    if(!_wi_archive_read_header(header, &length))
+        return NULL;
+    
+    /* The length comes from the peer, so it is bounded before anything is allocated for it */
+    if(length > _WI_ARCHIVE_MAX_STREAM_LENGTH) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+            WI_STR("Archive payload of %lu bytes is too large"),
+            length);
+        
+        return NULL;
+    }
+    
+    bytes = wi_malloc(WI_MAX(length, 1));
+    result = _wi_archive_read_bytes(source, timeout, read, bytes, length);
+    
+    if(result < (wi_integer_t) length) {
+        if(result >= 0) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+                WI_STR("Archive payload is truncated after %ld of %lu bytes"),
+                result, length);
+        }
+        
+        wi_free(bytes);
+        
+        return NULL;
+    }
+    
+    /* Data values are decoded as views of the payload, which they keep alive */
+    data = wi_data_init_with_bytes_no_copy(wi_data_alloc(), bytes, length, true);
+    
+    wi_autorelease(data);
+    
+    return _wi_archive_decode(data, 0, length);
+}
+
+
+
+static wi_integer_t _wi_archive_read_bytes(wi_runtime_instance_t *source, wi_time_interval_t timeout, wi_archive_read_func_t *read, void *buffer, wi_uinteger_t length) {
+    wi_uinteger_t       offset;
+    wi_integer_t        result;
+    
+    /* A single read may return less, a TLS socket returns at most one record */
+    offset = 0;
+    
+    while(offset < length) {
+        result = (*read)(source, timeout, (char *) buffer + offset, length - offset);
+        
+        if(result < 0)
+            return result;
+        
+        if(result == 0)
+            break;
+        
+        offset += result;
+    }
+    
+    return offset;
+}
+
+
+
+static wi_integer_t _wi_archive_read_file(wi_runtime_instance_t *source, wi_time_interval_t timeout, void *buffer, wi_uinteger_t length) {
+    return wi_file_read_bytes(source, buffer, length);
+}
+
+
+
+static wi_integer_t _wi_archive_read_socket(wi_runtime_instance_t *source, wi_time_interval_t timeout, void *buffer, wi_uinteger_t length) {
+    return wi_socket_read_bytes(source, timeout, buffer, length);
+}
+
+
+
+static wi_integer_t _wi_archive_read_pipe(wi_runtime_instance_t *source, wi_time_interval_t timeout, void *buffer, wi_uinteger_t length) {
+    return wi_pipe_read_bytes(source, buffer, length);
+}
+
+
+
+static wi_boolean_t _wi_archive_read_header(const unsigned char *header, wi_uinteger_t *length) {
+    if(memcmp(header, _WI_ARCHIVE_MAGIC, 2) != 0) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+            WI_STR("Data is not an archive"));
+        
+        return false;
+    }
+    
+    if(header[2] != _WI_ARCHIVE_VERSION || header[3] != 0) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+            WI_STR("Archive version %u with flags 0x%02x is not supported"),
+            header[2], header[3]);
+        
+        return false;
+    }
+    
+    *length = wi_read_swap_big_to_host_int32((void *) header, 4);
+    
+    return true;
+}
+
+
+
+#pragma mark -
+
+wi_data_t * wi_archive_data_for_instance(wi_runtime_instance_t *instance) {
+    unsigned char       *bytes;
+    wi_uinteger_t       length;
+    
+    bytes = _wi_archive_encode(instance, &length);
+    
+    if(!bytes)
+        return NULL;
+    
+    return wi_autorelease(wi_data_init_with_bytes_no_copy(wi_data_alloc(), bytes, length, true));
+}
+
+
+
+wi_boolean_t wi_archive_write_instance_to_file(wi_runtime_instance_t *instance, wi_file_t *file) {
+    return _wi_archive_write_instance(instance, file, 0.0, _wi_archive_write_file);
+}
+
+
+
+wi_boolean_t wi_archive_write_instance_to_socket(wi_runtime_instance_t *instance, wi_socket_t *socket, wi_time_interval_t timeout) {
+    return _wi_archive_write_instance(instance, socket, timeout, _wi_archive_write_socket);
+}
+
+
+
+wi_boolean_t wi_archive_write_instance_to_pipe(wi_runtime_instance_t *instance, wi_pipe_t *pipe) {
+    return _wi_archive_write_instance(instance, pipe, 0.0, _wi_archive_write_pipe);
+}
+
+
+
+static wi_boolean_t _wi_archive_write_instance(wi_runtime_instance_t *instance, wi_runtime_instance_t *destination, wi_time_interval_t timeout, _wi_archive_write_func_t *write) {
+    unsigned char       *bytes;
+    wi_uinteger_t       length;
+    wi_integer_t        result;
+    
+    bytes = _wi_archive_encode(instance, &length);
+    
+    if(!bytes)
+        return false;
+    
+    result = (*write)(destination, timeout, bytes, length);
+    
+    wi_free(bytes);
+    
+    return (result == (wi_integer_t) length);
+}
+
+
+
+static wi_integer_t _wi_archive_write_file(wi_runtime_instance_t *destination, wi_time_interval_t timeout, const void *buffer, wi_uinteger_t length) {
+    return wi_file_write_bytes(destination, buffer, length);
+}
+
+
+
+static wi_integer_t _wi_archive_write_socket(wi_runtime_instance_t *destination, wi_time_interval_t timeout, const void *buffer, wi_uinteger_t length) {
+    return wi_socket_write_bytes(destination, timeout, buffer, length);
+}
+
+
+
+static wi_integer_t _wi_archive_write_pipe(wi_runtime_instance_t *destination, wi_time_interval_t timeout, const void *buffer, wi_uinteger_t length) {
+    return wi_pipe_write_bytes(destination, buffer, length);
+}
+
+
+
+#pragma mark -
+
+static wi_runtime_instance_t * _wi_archive_decode(wi_data_t *data, wi_uinteger_t offset, wi_uinteger_t length) {
+    _wi_archive_decoder_t       decoder;
+    wi_runtime_instance_t       *instance;
+    wi_uinteger_t               i;
+    
+    memset(&decoder, 0, sizeof(decoder));
+    
+    decoder.data        = data;
+    decoder.bytes       = wi_data_bytes(data);
+    decoder.position    = offset;
+    decoder.length      = length;
+    
+    instance = _wi_archive_decode_value(&decoder);
+    
+    if(instance && decoder.position != decoder.length) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+            WI_STR("Archive has %lu trailing bytes"),
+            decoder.length - decoder.position);
+        
+        wi_release(instance);
+        
+        instance = NULL;
+    }
+    
+    for(i = 0; i < decoder.strings_count; i++)
+        wi_release(decoder.strings[i]);
+    
+    wi_free(decoder.strings);
+    
+    return wi_autorelease(instance);
+}
+
+
+
+static wi_runtime_instance_t * _wi_archive_decode_value(_wi_archive_decoder_t *decoder) {
+    wi_runtime_instance_t       *instance;
+    wi_uinteger_t               length;
+    uint64_t                    value;
+    double                      real;
+    unsigned char               tag;
+    
+    if(decoder->position >= decoder->length) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+            WI_STR("Archive is truncated"));
+        
+        return NULL;
+    }
+    
+    tag = decoder->bytes[decoder->position++];
+    
+    if(tag & _WI_ARCHIVE_SMALL_INTEGER)
+        return wi_number_init_with_int64(wi_number_alloc(), tag & ~_WI_ARCHIVE_SMALL_INTEGER);
+    
+    switch(tag) {
+        case _WI_ARCHIVE_NULL:
+            return wi_retain(wi_null());
+            
+        case _WI_ARCHIVE_FALSE:
+        case _WI_ARCHIVE_TRUE:
+            return wi_number_init_with_bool(wi_number_alloc(), (tag == _WI_ARCHIVE_TRUE));
+            
+        case _WI_ARCHIVE_INTEGER:
+            if(!_wi_archive_decode_varint(decoder, &value))
+                return NULL;
+            
+            return wi_number_init_with_int64(wi_number_alloc(), (int64_t) (value >> 1) ^ -(int64_t) (value & 1));
+            
+        case _WI_ARCHIVE_REAL:
+        case _WI_ARCHIVE_DATE:
+            if(decoder->length - decoder->position < 8)
+                break;
+            
+            value = wi_read_swap_big_to_host_int64((void *) decoder->bytes, decoder->position);
+            
+            memcpy(&real, &value, sizeof(real));
+            
+            decoder->position += 8;
+            
+            if(tag == _WI_ARCHIVE_DATE)
+                return wi_date_init_with_time_interval(wi_date_alloc(), real);
+            
+            return wi_number_init_with_double(wi_number_alloc(), real);
+            
+        case _WI_ARCHIVE_STRING:
+            if(!_wi_archive_decode_length(decoder, &length))
+                return NULL;
+            
+            instance = wi_string_init_with_utf8_bytes(wi_string_alloc(), decoder->bytes + decoder->position, length);
+            
+            decoder->position += length;
+            
+            if(decoder->strings_count == decoder->strings_capacity) {
+                decoder->strings_capacity = WI_MAX(decoder->strings_capacity * 2, 64);
+                decoder->strings = wi_realloc(decoder->strings, decoder->strings_capacity * sizeof(wi_string_t *));
+            }
+            
+            decoder->strings[decoder->strings_count++] = wi_retain(instance);
+            
+            return instance;
+            
+        case _WI_ARCHIVE_STRING_REFERENCE:
+            if(!_wi_archive_decode_varint(decoder, &value))
+                return NULL;
+            
+            if(value >= decoder->strings_count) {
+                wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+                    WI_STR("String reference %llu is out of range (%lu strings)"),
+                    value, decoder->strings_count);
+                
+                return NULL;
+            }
+            
+            return wi_retain(decoder->strings[value]);
+            
+        case _WI_ARCHIVE_DATA:
+            if(!_wi_archive_decode_length(decoder, &length))
+                return NULL;
+            
+            instance = wi_data_subdata_with_range(decoder->data, wi_make_range(decoder->position, length));
+            
+            decoder->position += length;
+            
+            return wi_retain(instance);
+            
+        case _WI_ARCHIVE_ARRAY:
+        case _WI_ARCHIVE_DICTIONARY:
+            return _wi_archive_decode_container(decoder, tag);
+            
+        default:
+            wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+                WI_STR("Value with tag 0x%02x at offset %lu is not supported"),
+                tag, decoder->position - 1);
+            
+            return NULL;
+    }
+    
+    wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+        WI_STR("Archive is truncated"));
+    
+    return NULL;
+}
+
+
+
+static wi_runtime_instance_t * _wi_archive_decode_container(_wi_archive_decoder_t *decoder, unsigned char tag) {
+    wi_runtime_instance_t       *instance, *key, *value;
+    wi_uinteger_t               i, count;
+    
+    if(decoder->depth == _WI_ARCHIVE_MAX_DEPTH) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+            WI_STR("Archive is nested deeper than %u levels"),
+            _WI_ARCHIVE_MAX_DEPTH);
+        
+        return NULL;
+    }
+    
+    /* Every value takes at least one byte, which bounds the count before it is used as a capacity */
+    if(!_wi_archive_decode_length(decoder, &count))
+        return NULL;
+    
+    decoder->depth++;
+    
+    if(tag == _WI_ARCHIVE_ARRAY) {
+        instance = wi_array_init_with_capacity(wi_mutable_array_alloc(), count);
+        
+        for(i = 0; i < count; i++) {
+            value = _wi_archive_decode_value(decoder);
+            
+            if(!value)
+                break;
+            
+            wi_mutable_array_add_data(instance, value);
+            wi_release(value);
+        }
+    } else {
+        instance = wi_dictionary_init_with_capacity(wi_mutable_dictionary_alloc(), count);
+        
+        for(i = 0; i < count; i++) {
+            key = _wi_archive_decode_value(decoder);
+            
+            if(!key)
+                break;
+            
+            if(wi_runtime_id(key) != wi_string_runtime_id()) {
+                wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+                    WI_STR("Dictionary key of class %@ at offset %lu is not a string"),
+                    wi_runtime_class_name(key), decoder->position);
+                
+                wi_release(key);
+                
+                break;
+            }
+            
+            value = _wi_archive_decode_value(decoder);
+            
+            if(!value) {
+                wi_release(key);
+                
+                break;
+            }
+            
+            wi_mutable_dictionary_set_data_for_key(instance, value, key);
+            wi_release(key);
+            wi_release(value);
+        }
+    }
+    
+    decoder->depth--;
+    
+    if(i < count) {
+        wi_release(instance);
+        
+        return NULL;
+    }
+    
+    wi_runtime_make_immutable(instance);
+    
+    return instance;
+}
+
+
+
+static wi_boolean_t _wi_archive_decode_varint(_wi_archive_decoder_t *decoder, uint64_t *value) {
+    unsigned char       byte;
+    wi_uinteger_t       shift;
+    
+    *value = 0;
+    
+    for(shift = 0; shift < 64; shift += 7) {
+        if(decoder->position >= decoder->length)
+            break;
+        
+        byte = decoder->bytes[decoder->position++];
+        
+        *value |= (uint64_t) (byte & 0x7F) << shift;
+        
+        if(!(byte & 0x80))
+            return true;
+    }
+    
+    wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+        WI_STR("Varint at offset %lu is truncated or too long"),
+        decoder->position);
+    
+    return false;
+}
+
+
+
+static wi_boolean_t _wi_archive_decode_length(_wi_archive_decoder_t *decoder, wi_uinteger_t *length) {
+    uint64_t        value;
+    
+    if(!_wi_archive_decode_varint(decoder, &value))
+        return false;
+    
+    if(value > decoder->length - decoder->position) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_READFAILED,
+            WI_STR("Length %llu at offset %lu runs past the end of the archive"),
+            value, decoder->position);
+        
+        return false;
+    }
+    
+    *length = (wi_uinteger_t) value;
+    
+    return true;
+}
+
+
+
+#pragma mark -
+
+static unsigned char * _wi_archive_encode(wi_runtime_instance_t *instance, wi_uinteger_t *length) {
+    _wi_archive_encoder_t           encoder;
+    wi_dictionary_key_callbacks_t   key_callbacks;
+    wi_boolean_t                    result;
+    
+    memset(&encoder, 0, sizeof(encoder));
+    
+    /* Interned strings are only looked up, so they are retained instead of copied */
+    key_callbacks           = wi_dictionary_default_key_callbacks;
+    key_callbacks.retain    = wi_retain;
+    
+    encoder.strings         = wi_dictionary_init_with_capacity_and_callbacks(wi_mutable_dictionary_alloc(), 0, key_callbacks, wi_dictionary_null_value_callbacks);
+    encoder.capacity        = 256;
+    encoder.bytes           = wi_malloc(encoder.capacity);
+    encoder.length          = _WI_ARCHIVE_HEADER_LENGTH;
+    
+    result = _wi_archive_encode_value(&encoder, instance);
+    
+    if(result && encoder.length - _WI_ARCHIVE_HEADER_LENGTH > UINT32_MAX) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_WRITEFAILED,
+            WI_STR("Archive payload of %lu bytes is too large"),
+            encoder.length - _WI_ARCHIVE_HEADER_LENGTH);
+        
+        result = false;
+    }
+    
+    wi_release(encoder.strings);
+    wi_free(encoder.scratch);
+    
+    if(!result) {
+        wi_free(encoder.bytes);
+        
+        return NULL;
+    }
+    
+    memcpy(encoder.bytes, _WI_ARCHIVE_MAGIC, 2);
+    
+    encoder.bytes[2] = _WI_ARCHIVE_VERSION;
+    encoder.bytes[3] = 0;
+    
+    wi_write_swap_host_to_big_int32(encoder.bytes, 4, encoder.length - _WI_ARCHIVE_HEADER_LENGTH);
+    
+    *length = encoder.length;
+    
+    return encoder.bytes;
+}
+
+
+
+static wi_boolean_t _wi_archive_encode_value(_wi_archive_encoder_t *encoder, wi_runtime_instance_t *instance) {
+    wi_runtime_id_t     id;
+    wi_boolean_t        result;
+    
+    id = wi_runtime_id(instance);
+    
+    if(id == wi_string_runtime_id()) {
+        _wi_archive_encode_string(encoder, instance);
+    }
+    else if(id == wi_number_runtime_id()) {
+        _wi_archive_encode_number(encoder, instance);
+    }
+    else if(id == wi_dictionary_runtime_id() || id == wi_array_runtime_id()) {
+        /* Mutable containers can contain themselves, the depth limit stops that */
+        if(encoder->depth == _WI_ARCHIVE_MAX_DEPTH) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_WRITEFAILED,
+                WI_STR("Instance is nested deeper than %u levels"),
+                _WI_ARCHIVE_MAX_DEPTH);
+            
+            return false;
+        }
+        
+        encoder->depth++;
+        
+        if(id == wi_dictionary_runtime_id())
+            result = _wi_archive_encode_dictionary(encoder, instance);
+        else
+            result = _wi_archive_encode_array(encoder, instance);
+        
+        encoder->depth--;
+        
+        return result;
+    }
+    else if(id == wi_data_runtime_id()) {
+        _wi_archive_encode_varint(encoder, _WI_ARCHIVE_DATA, wi_data_length(instance));
+        _wi_archive_encode_bytes(encoder, wi_data_bytes(instance), wi_data_length(instance));
+    }
+    else if(id == wi_date_runtime_id()) {
+        _wi_archive_encode_double(encoder, _WI_ARCHIVE_DATE, wi_date_time_interval(instance));
+    }
+    else if(id == wi_null_runtime_id()) {
+        _wi_archive_encode_reserve(encoder, 1);
+        
+        encoder->bytes[encoder->length++] = _WI_ARCHIVE_NULL;
+    }
+    else {
+        wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_WRITEFAILED,
+            WI_STR("Value of class %@ not supported in archives"),
+            wi_runtime_class_name(instance));
+        
+        return false;
+    }
+    
+    return true;
+}
+
+
+
+static wi_boolean_t _wi_archive_encode_dictionary(_wi_archive_encoder_t *encoder, wi_dictionary_t *dictionary) {
+    wi_uinteger_t       i, offset, count;
+    
+    /* Keys and values are fetched into a scratch stack shared by all levels,
+       so nested dictionaries do not allocate */
+    offset = encoder->scratch_count;
+    count = wi_dictionary_count(dictionary);
+    
+    if(offset + (count * 2) > encoder->scratch_capacity) {
+        encoder->scratch_capacity = WI_MAX(offset + (count * 2), encoder->scratch_capacity * 2);
+        encoder->scratch = wi_realloc(encoder->scratch, encoder->scratch_capacity * sizeof(void *));
+    }
+    
+    wi_dictionary_get_keys_and_data(dictionary, encoder->scratch + offset, encoder->scratch + offset + count);
+    
+    encoder->scratch_count = offset + (count * 2);
+    
+    _wi_archive_encode_varint(encoder, _WI_ARCHIVE_DICTIONARY, count);
+    
+    for(i = 0; i < count; i++) {
+        /* Only string keys are read back, so nothing else is written */
+        if(wi_runtime_id(encoder->scratch[offset + i]) != wi_string_runtime_id()) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_ARCHIVE_WRITEFAILED,
+                WI_STR("Dictionary key of class %@ not supported in archives"),
+                wi_runtime_class_name(encoder->scratch[offset + i]));
+            
+            return false;
+        }
+        
+        if(!_wi_archive_encode_value(encoder, encoder->scratch[offset + i]) ||
+           !_wi_archive_encode_value(encoder, encoder->scratch[offset + count + i]))
+            return false;
+    }
+    
+    encoder->scratch_count = offset;
+    
+    return true;
+}
+
+
+
+static wi_boolean_t _wi_archive_encode_array(_wi_archive_encoder_t *encoder, wi_array_t *array) {
+    wi_uinteger_t       i, count;
+    
+    count = wi_array_count(array);
+    
+    _wi_archive_encode_varint(encoder, _WI_ARCHIVE_ARRAY, count);
+    
+    for(i = 0; i < count; i++) {
+        if(!_wi_archive_encode_value(encoder, WI_ARRAY(array, i)))
+            return false;
+    }
+    
+    return true;
+}
+
+
+
+static void _wi_archive_encode_number(_wi_archive_encoder_t *encoder, wi_number_t *number) {
+    int64_t     value;
+    
+    if(wi_number_type(number) == WI_NUMBER_BOOL) {
+        _wi_archive_encode_reserve(encoder, 1);
+        
+        encoder->bytes[encoder->length++] = wi_number_bool(number) ? _WI_ARCHIVE_TRUE : _WI_ARCHIVE_FALSE;
+    }
+    else if(wi_number_storage_type(number) == WI_NUMBER_STORAGE_FLOAT || wi_number_storage_type(number) == WI_NUMBER_STORAGE_DOUBLE) {
+        _wi_archive_encode_double(encoder, _WI_ARCHIVE_REAL, wi_number_double(number));
+    }
+    else {
+        value = wi_number_int64(number);
+        
+        if(value >= 0 && value < _WI_ARCHIVE_SMALL_INTEGER) {
+            _wi_archive_encode_reserve(encoder, 1);
+            
+            encoder->bytes[encoder->length++] = _WI_ARCHIVE_SMALL_INTEGER | (unsigned char) value;
+        } else {
+            _wi_archive_encode_varint(encoder, _WI_ARCHIVE_INTEGER, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+        }
+    }
+}
+
+
+
+static void _wi_archive_encode_string(_wi_archive_encoder_t *encoder, wi_string_t *string) {
+    wi_uinteger_t       index;
+    
+    /* Indexes are stored off by one, so that a missing string is NULL */
+    index = (wi_uinteger_t) wi_dictionary_data_for_key(encoder->strings, string);
+    
+    if(index > 0) {
+        _wi_archive_encode_varint(encoder, _WI_ARCHIVE_STRING_REFERENCE, index - 1);
+    } else {
+        wi_mutable_dictionary_set_data_for_key(encoder->strings, (void *) (wi_dictionary_count(encoder->strings) + 1), string);
+        
+        _wi_archive_encode_varint(encoder, _WI_ARCHIVE_STRING, wi_string_length(string));
+        _wi_archive_encode_bytes(encoder, wi_string_utf8_string(string), wi_string_length(string));
+    }
+}
+
+
+
+static void _wi_archive_encode_double(_wi_archive_encoder_t *encoder, unsigned char tag, double real) {
+    uint64_t    value;
+    
+    memcpy(&value, &real, sizeof(value));
+    
+    _wi_archive_encode_reserve(encoder, 9);
+    
+    encoder->bytes[encoder->length++] = tag;
+    
+    wi_write_swap_host_to_big_int64(encoder->bytes, encoder->length, value);
+    
+    encoder->length += 8;
+}
+
+
+
+static void _wi_archive_encode_varint(_wi_archive_encoder_t *encoder, unsigned char tag, uint64_t value) {
+    _wi_archive_encode_reserve(encoder, 11);
+    
+    encoder->bytes[encoder->length++] = tag;
+    
+    while(value >= 0x80) {
+        encoder->bytes[encoder->length++] = (unsigned char) (value | 0x80);
+        
+        value >>= 7;
+    }
+    
+    encoder->bytes[encoder->length++] = (unsigned char) value;
+}
+
+
+
+static void _wi_archive_encode_bytes(_wi_archive_encoder_t *encoder, const void *bytes, wi_uinteger_t length) {
+    _wi_archive_encode_reserve(encoder, length);
+    
+    memcpy(encoder->bytes + encoder->length, bytes, length);
+    
+    encoder->length += length;
+}
+
+
+
+static void _wi_archive_encode_reserve(_wi_archive_encoder_t *encoder, wi_uinteger_t length) {
+    if(encoder->length + length > encoder->capacity) {
+        encoder->capacity = WI_MAX(encoder->capacity * 2, encoder->length + length);
+        encoder->bytes = wi_realloc(encoder->bytes, encoder->capacity);
+    }
+}
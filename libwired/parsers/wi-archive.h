@@ -0,0 +1,43 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ * 
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WI_ARCHIVE_H
+#define WI_ARCHIVE_H 1
+
+#include <wired/wi-base.h>
+#include <wired/wi-runtime.h>
+
+WI_EXPORT wi_runtime_instance_t *       wi_archive_instance_for_data(wi_data_t *);
+WI_EXPORT wi_runtime_instance_t *       wi_archive_read_instance_from_file(wi_file_t *);
+WI_EXPORT wi_runtime_instance_t *       wi_archive_read_instance_from_socket(wi_socket_t *, wi_time_interval_t);
+WI_EXPORT wi_runtime_instance_t *       wi_archive_read_instance_from_pipe(wi_pipe_t *);
+
+WI_EXPORT wi_data_t *                   wi_archive_data_for_instance(wi_runtime_instance_t *);
+WI_EXPORT wi_boolean_t                  wi_archive_write_instance_to_file(wi_runtime_instance_t *, wi_file_t *);
+WI_EXPORT wi_boolean_t                  wi_archive_write_instance_to_socket(wi_runtime_instance_t *, wi_socket_t *, wi_time_interval_t);
+WI_EXPORT wi_boolean_t                  wi_archive_write_instance_to_pipe(wi_runtime_instance_t *, wi_pipe_t *);
+
+#endif /* WI_ARCHIVE_H */
@@ -0,0 +1,1207 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <wired/wi-data.h>
+#include <wired/wi-dictionary.h>
+#include <wired/wi-json-document.h>
+#include <wired/wi-null.h>
+#include <wired/wi-number.h>
+#include <wired/wi-pool.h>
+#include <wired/wi-private.h>
+#include <wired/wi-runtime.h>
+#include <wired/wi-string.h>
+#include <wired/wi-system.h>
+
+#define _WI_JSON_DOCUMENT_MAX_DEPTH             512
+#define _WI_JSON_DOCUMENT_MAX_COUNT             0xFFFF
+
+#define _WI_JSON_TAPE_ROOT                      'r'
+#define _WI_JSON_TAPE_OBJECT_START              '{'
+#define _WI_JSON_TAPE_OBJECT_END                '}'
+#define _WI_JSON_TAPE_ARRAY_START               '['
+#define _WI_JSON_TAPE_ARRAY_END                 ']'
+#define _WI_JSON_TAPE_KEY                       'k'
+#define _WI_JSON_TAPE_STRING                    '"'
+#define _WI_JSON_TAPE_INTEGER                   'l'
+#define _WI_JSON_TAPE_REAL                      'd'
+#define _WI_JSON_TAPE_TRUE                      't'
+#define _WI_JSON_TAPE_FALSE                     'f'
+#define _WI_JSON_TAPE_NULL                      'n'
+
+#define _WI_JSON_TAPE_WORD(type, payload)       (((uint64_t) (type) << 56) | (uint64_t) (payload))
+#define _WI_JSON_TAPE_TYPE(word)                ((char) ((word) >> 56))
+#define _WI_JSON_TAPE_PAYLOAD(word)             ((word) & 0x00FFFFFFFFFFFFFFULL)
+
+#define _WI_JSON_TAPE_NEXT(word)                ((wi_uinteger_t) ((word) & 0xFFFFFFFFFFULL))
+#define _WI_JSON_TAPE_COUNT(word)               ((wi_uinteger_t) (((word) >> 40) & 0xFFFF))
+
+
+/*
+ * A document is parsed in two passes. The first finds the offsets of all
+ * structural characters, opening quotes and scalars 64 bytes at a time,
+ * and validates UTF-8 on the way. The second walks those offsets, checks
+ * the grammar and writes a tape of 64-bit words: a type in the top byte
+ * and a payload below. Containers are bracketed by start and end words
+ * that point at each other, so whole subtrees can be skipped, integers
+ * and reals take an extra word, and strings point into a pool of
+ * unescaped, length prefixed and NUL terminated bytes.
+ */
+struct _wi_json_document_block {
+    uint64_t                                    quote;
+    uint64_t                                    backslash;
+    uint64_t                                    structural;
+    uint64_t                                    whitespace;
+    uint64_t                                    nonascii;
+};
+typedef struct _wi_json_document_block          _wi_json_document_block_t;
+
+struct _wi_json_document_container {
+    wi_uinteger_t                               start;
+    wi_uinteger_t                               count;
+    char                                        end;
+};
+typedef struct _wi_json_document_container      _wi_json_document_container_t;
+
+struct _wi_json_document_parser {
+    const unsigned char                         *bytes;
+    wi_uinteger_t                               length;
+    
+    uint32_t                                    *indexes;
+    wi_uinteger_t                               indexes_count;
+    
+    uint64_t                                    *tape;
+    wi_uinteger_t                               tape_length;
+    
+    char                                        *strings;
+    wi_uinteger_t                               strings_length;
+    
+    _wi_json_document_container_t               stack[_WI_JSON_DOCUMENT_MAX_DEPTH];
+    wi_uinteger_t                               depth;
+};
+typedef struct _wi_json_document_parser         _wi_json_document_parser_t;
+
+
+enum _wi_json_document_state {
+    _WI_JSON_DOCUMENT_VALUE,
+    _WI_JSON_DOCUMENT_OBJECT_KEY_OR_END,
+    _WI_JSON_DOCUMENT_OBJECT_KEY,
+    _WI_JSON_DOCUMENT_OBJECT_COLON,
+    _WI_JSON_DOCUMENT_OBJECT_COMMA_OR_END,
+    _WI_JSON_DOCUMENT_ARRAY_VALUE_OR_END,
+    _WI_JSON_DOCUMENT_ARRAY_COMMA_OR_END,
+    _WI_JSON_DOCUMENT_DONE
+};
+typedef enum _wi_json_document_state            _wi_json_document_state_t;
+
+
+struct _wi_json_document {
+    wi_runtime_base_t                           base;
+    
+    uint64_t                                    *tape;
+    wi_uinteger_t                               tape_length;
+    
+    char                                        *strings;
+    wi_uinteger_t                               strings_length;
+};
+
+
+static void                                     _wi_json_document_dealloc(wi_runtime_instance_t *);
+static wi_string_t *                            _wi_json_document_description(wi_runtime_instance_t *);
+
+static wi_json_document_t *                     _wi_json_document_init_with_bytes(wi_json_document_t *, const void *, wi_uinteger_t);
+static void                                     _wi_json_document_set_error(wi_uinteger_t, const char *);
+
+static wi_boolean_t                             _wi_json_document_find_structurals(_wi_json_document_parser_t *);
+static void                                     _wi_json_document_classify_block(const unsigned char *, _wi_json_document_block_t *);
+static uint64_t                                 _wi_json_document_escaped(uint64_t, uint64_t *);
+static uint64_t                                 _wi_json_document_prefix_xor(uint64_t);
+static wi_boolean_t                             _wi_json_document_validate_utf8(const unsigned char *, const unsigned char *, const unsigned char *, const unsigned char **);
+
+static wi_boolean_t                             _wi_json_document_build_tape(_wi_json_document_parser_t *);
+static _wi_json_document_state_t                _wi_json_document_end_container(_wi_json_document_parser_t *);
+static _wi_json_document_state_t                _wi_json_document_end_value(_wi_json_document_parser_t *);
+static wi_boolean_t                             _wi_json_document_parse_scalar(_wi_json_document_parser_t *, wi_uinteger_t);
+static wi_boolean_t                             _wi_json_document_parse_string(_wi_json_document_parser_t *, wi_uinteger_t, char);
+static wi_boolean_t                             _wi_json_document_is_terminator(_wi_json_document_parser_t *, const unsigned char *);
+
+static wi_uinteger_t                            _wi_json_document_skip_value(wi_json_document_t *, wi_json_value_t);
+static wi_boolean_t                             _wi_json_document_is_valid_value(wi_json_document_t *, wi_json_value_t);
+static wi_string_t *                            _wi_json_document_string_at_offset(wi_json_document_t *, wi_uinteger_t);
+static wi_runtime_instance_t *                  _wi_json_document_instance_for_value(wi_json_document_t *, wi_json_value_t);
+
+
+static wi_runtime_id_t                          _wi_json_document_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t                       _wi_json_document_runtime_class = {
+    "wi_json_document_t",
+    _wi_json_document_dealloc,
+    NULL,
+    NULL,
+    _wi_json_document_description,
+    NULL
+};
+
+
+
+void wi_json_document_register(void) {
+    _wi_json_document_runtime_id = wi_runtime_register_class(&_wi_json_document_runtime_class);
+}
+
+
+
+void wi_json_document_initialize(void) {
+}
+
+
+
+#pragma mark -
+
+wi_runtime_id_t wi_json_document_runtime_id(void) {
+    return _wi_json_document_runtime_id;
+}
+
+
+
+#pragma mark -
+
+wi_json_document_t * wi_json_document_with_string(wi_string_t *string) {
+    return wi_autorelease(wi_json_document_init_with_string(wi_json_document_alloc(), string));
+}
+
+
+
+#pragma mark -
+
+wi_json_document_t * wi_json_document_alloc(void) {
+    return wi_runtime_create_instance(_wi_json_document_runtime_id, sizeof(wi_json_document_t));
+}
+
+
+
+wi_json_document_t * wi_json_document_init_with_string(wi_json_document_t *document, wi_string_t *string) {
+    return _wi_json_document_init_with_bytes(document, wi_string_utf8_string(string), wi_string_length(string));
+}
+
+
+
+wi_json_document_t * wi_json_document_init_with_data(wi_json_document_t *document, wi_data_t *data) {
+    return _wi_json_document_init_with_bytes(document, wi_data_bytes(data), wi_data_length(data));
+}
+
+
+
+wi_json_document_t * wi_json_document_init_with_contents_of_file(wi_json_document_t *document, wi_string_t *path) {
+    wi_data_t       *data;
+    
+    data = wi_data_with_contents_of_file(path);
+    
+    if(!data) {
+        wi_release(document);
+        
+        return NULL;
+    }
+    
+    return wi_json_document_init_with_data(document, data);
+}
+
+
+
+static void _wi_json_document_dealloc(wi_runtime_instance_t *instance) {
+    wi_json_document_t      *document = instance;
+    
+    wi_free(document->tape);
+    wi_free(document->strings);
+}
+
+
+
+static wi_string_t * _wi_json_document_description(wi_runtime_instance_t *instance) {
+    wi_json_document_t      *document = instance;
+    
+    return wi_string_with_format(WI_STR("<%@ %p>{tape = %lu, strings = %lu}"),
+        wi_runtime_class_name(document),
+        document,
+        document->tape_length,
+        document->strings_length);
+}
+
+
+
+#pragma mark -
+
+static wi_json_document_t * _wi_json_document_init_with_bytes(wi_json_document_t *document, const void *bytes, wi_uinteger_t length) {
+    _wi_json_document_parser_t      parser;
+    wi_boolean_t                    result;
+    
+    /* Offsets are kept in 32 bits */
+    if(length >= UINT32_MAX) {
+        _wi_json_document_set_error(0, "document too large");
+        
+        wi_release(document);
+        
+        return NULL;
+    }
+    
+    memset(&parser, 0, sizeof(parser));
+    
+    parser.bytes    = bytes;
+    parser.length   = length;
+    parser.indexes  = wi_malloc((length + 1) * sizeof(uint32_t));
+    
+    result = _wi_json_document_find_structurals(&parser);
+    
+    if(result) {
+        /* Every index writes at most two words, and every string at most five bytes more than its source */
+        parser.tape     = wi_malloc(((parser.indexes_count * 2) + 2) * sizeof(uint64_t));
+        parser.strings  = wi_malloc(length + (parser.indexes_count * 5) + 1);
+        
+        result = _wi_json_document_build_tape(&parser);
+    }
+    
+    wi_free(parser.indexes);
+    
+    if(!result) {
+        wi_free(parser.tape);
+        wi_free(parser.strings);
+        wi_release(document);
+        
+        return NULL;
+    }
+    
+    document->tape              = wi_realloc(parser.tape, parser.tape_length * sizeof(uint64_t));
+    document->tape_length       = parser.tape_length;
+    document->strings           = wi_realloc(parser.strings, WI_MAX(parser.strings_length, 1));
+    document->strings_length    = parser.strings_length;
+    
+    return document;
+}
+
+
+
+static void _wi_json_document_set_error(wi_uinteger_t offset, const char *reason) {
+    wi_error_set_libwired_error_with_format(WI_ERROR_JSON_READFAILED,
+        WI_STR("Syntax error at offset %lu (%s)"),
+        offset,
+        reason);
+}
+
+
+
+#pragma mark -
+
+static wi_boolean_t _wi_json_document_find_structurals(_wi_json_document_parser_t *parser) {
+    _wi_json_document_block_t   block;
+    const unsigned char         *bytes, *end, *validated;
+    unsigned char               padding[64];
+    uint64_t                    escaped, quotes, in_string, scalars, bits;
+    uint64_t                    escape_carry, string_carry, scalar_carry;
+    wi_uinteger_t               offset, count;
+    
+    bytes = parser->bytes;
+    end = bytes + parser->length;
+    validated = bytes;
+    escape_carry = string_carry = scalar_carry = 0;
+    count = 0;
+    
+    for(offset = 0; offset < parser->length; offset += 64) {
+        if(parser->length - offset >= 64) {
+            _wi_json_document_classify_block(bytes + offset, &block);
+        } else {
+            /* The last block is padded with whitespace, which ends any scalar in it */
+            memset(padding, ' ', sizeof(padding));
+            memcpy(padding, bytes + offset, parser->length - offset);
+            
+            _wi_json_document_classify_block(padding, &block);
+        }
+        
+        /* Pure ASCII blocks need no validation, others are checked a sequence at a time */
+        if(block.nonascii != 0 && validated < end) {
+            if(!_wi_json_document_validate_utf8(WI_MAX(validated, bytes + offset), WI_MIN(bytes + offset + 64, end), end, &validated)) {
+                _wi_json_document_set_error(validated - bytes, "invalid UTF-8");
+                
+                return false;
+            }
+        }
+        
+        escaped     = _wi_json_document_escaped(block.backslash, &escape_carry);
+        quotes      = block.quote & ~escaped;
+        
+        /* Bits are set from an opening quote up to, but not including, its closing quote */
+        in_string   = _wi_json_document_prefix_xor(quotes) ^ string_carry;
+        string_carry = (uint64_t) ((int64_t) in_string >> 63);
+        
+        /* Scalars are runs of anything else outside strings, only their first byte is indexed */
+        scalars     = ~(block.structural | block.whitespace | quotes) & ~in_string;
+        bits        = (block.structural & ~in_string) | (quotes & in_string) | (scalars & ~((scalars << 1) | scalar_carry));
+        scalar_carry = scalars >> 63;
+        
+        while(bits != 0) {
+            parser->indexes[count++] = offset + __builtin_ctzll(bits);
+            
+            bits &= bits - 1;
+        }
+    }
+    
+    parser->indexes_count = count;
+    
+    if(string_carry != 0) {
+        _wi_json_document_set_error(parser->length, "unterminated string");
+        
+        return false;
+    }
+    
+    return true;
+}
+
+
+
+static void _wi_json_document_classify_block(const unsigned char *bytes, _wi_json_document_block_t *block) {
+#if defined(__AVX2__)
+    __m256i         chunk, folded;
+    uint64_t        mask;
+    wi_uinteger_t   i;
+    
+    memset(block, 0, sizeof(*block));
+    
+    for(i = 0; i < 64; i += 32) {
+        chunk   = _mm256_loadu_si256((const __m256i *) (bytes + i));
+        folded  = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+        
+        mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')));
+        block->quote |= mask << i;
+        
+        mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')));
+        block->backslash |= mask << i;
+        
+        /* '[' and ']' fold onto '{' and '}' */
+        mask = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(',')))));
+        block->structural |= mask << i;
+        
+        mask = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')))));
+        block->whitespace |= mask << i;
+        
+        mask = (uint32_t) _mm256_movemask_epi8(chunk);
+        block->nonascii |= mask << i;
+    }
+#elif defined(__SSE2__)
+    __m128i         chunk, folded;
+    uint64_t        mask;
+    wi_uinteger_t   i;
+    
+    memset(block, 0, sizeof(*block));
+    
+    for(i = 0; i < 64; i += 16) {
+        chunk   = _mm_loadu_si128((const __m128i *) (bytes + i));
+        folded  = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        
+        mask = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')));
+        block->quote |= mask << i;
+        
+        mask = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')));
+        block->backslash |= mask << i;
+        
+        /* '[' and ']' fold onto '{' and '}' */
+        mask = (uint16_t) _mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(':')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(',')))));
+        block->structural |= mask << i;
+        
+        mask = (uint16_t) _mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')))));
+        block->whitespace |= mask << i;
+        
+        mask = (uint16_t) _mm_movemask_epi8(chunk);
+        block->nonascii |= mask << i;
+    }
+#else
+    uint64_t        bit;
+    wi_uinteger_t   i;
+    
+    memset(block, 0, sizeof(*block));
+    
+    for(i = 0; i < 64; i++) {
+        bit = (uint64_t) 1 << i;
+        
+        switch(bytes[i]) {
+            case '"':
+                block->quote |= bit;
+                break;
+            
+            case '\\':
+                block->backslash |= bit;
+                break;
+            
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                block->structural |= bit;
+                break;
+            
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                block->whitespace |= bit;
+                break;
+            
+            default:
+                if(bytes[i] & 0x80)
+                    block->nonascii |= bit;
+                break;
+        }
+    }
+#endif
+}
+
+
+
+static uint64_t _wi_json_document_escaped(uint64_t backslash, uint64_t *carry) {
+    uint64_t    escaped, bit;
+    
+    /* A backslash escaped by the previous block escapes nothing itself */
+    escaped = *carry;
+    backslash &= ~escaped;
+    *carry = 0;
+    
+    /* Backslashes are rare, so they are resolved one run at a time */
+    while(backslash != 0) {
+        bit = backslash & -backslash;
+        
+        if(bit == ((uint64_t) 1 << 63))
+            *carry = 1;
+        
+        escaped |= bit << 1;
+        backslash &= ~(bit | (bit << 1));
+    }
+    
+    return escaped;
+}
+
+
+
+static uint64_t _wi_json_document_prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    
+    return bits;
+}
+
+
+
+static wi_boolean_t _wi_json_document_validate_utf8(const unsigned char *p, const unsigned char *stop, const unsigned char *end, const unsigned char **next) {
+    unsigned char       c, low, high;
+    wi_uinteger_t       i, length;
+    
+    /* Sequences that start before stop are followed to their end, wherever that is */
+    while(p < stop) {
+        c = *p;
+        
+        if(c < 0x80) {
+            p++;
+            
+            continue;
+        }
+        
+        low = 0x80;
+        high = 0xBF;
+        
+        if(c >= 0xC2 && c <= 0xDF) {
+            length = 1;
+        }
+        else if(c >= 0xE0 && c <= 0xEF) {
+            length = 2;
+            
+            /* No overlong forms and no surrogates */
+            if(c == 0xE0)
+                low = 0xA0;
+            else if(c == 0xED)
+                high = 0x9F;
+        }
+        else if(c >= 0xF0 && c <= 0xF4) {
+            length = 3;
+            
+            /* No overlong forms and nothing above U+10FFFF */
+            if(c == 0xF0)
+                low = 0x90;
+            else if(c == 0xF4)
+                high = 0x8F;
+        }
+        else {
+            *next = p;
+            
+            return false;
+        }
+        
+        if((wi_uinteger_t) (end - p) <= length || p[1] < low || p[1] > high) {
+            *next = p;
+            
+            return false;
+        }
+        
+        for(i = 2; i <= length; i++) {
+            if((p[i] & 0xC0) != 0x80) {
+                *next = p;
+                
+                return false;
+            }
+        }
+        
+        p += length + 1;
+    }
+    
+    *next = p;
+    
+    return true;
+}
+
+
+
+#pragma mark -
+
+static wi_boolean_t _wi_json_document_build_tape(_wi_json_document_parser_t *parser) {
+    _wi_json_document_state_t       state;
+    wi_uinteger_t                   i, offset;
+    char                            c;
+    
+    parser->tape[parser->tape_length++] = _WI_JSON_TAPE_WORD(_WI_JSON_TAPE_ROOT, 0);
+    
+    state = _WI_JSON_DOCUMENT_VALUE;
+    
+    for(i = 0; i < parser->indexes_count; i++) {
+        offset = parser->indexes[i];
+        c = parser->bytes[offset];
+        
+        if(state == _WI_JSON_DOCUMENT_OBJECT_KEY_OR_END || state == _WI_JSON_DOCUMENT_ARRAY_VALUE_OR_END) {
+            if(c == parser->stack[parser->depth - 1].end) {
+                state = _wi_json_document_end_container(parser);
+                
+                continue;
+            }
+            
+            state = (state == _WI_JSON_DOCUMENT_OBJECT_KEY_OR_END) ? _WI_JSON_DOCUMENT_OBJECT_KEY : _WI_JSON_DOCUMENT_VALUE;
+        }
+        
+        switch(state) {
+            case _WI_JSON_DOCUMENT_VALUE:
+                if(c == '{' || c == '[') {
+                    if(parser->depth == _WI_JSON_DOCUMENT_MAX_DEPTH) {
+                        _wi_json_document_set_error(offset, "nesting too deep");
+                        
+                        return false;
+                    }
+                    
+                    /* The start word is filled in when the container ends */
+                    parser->stack[parser->depth].start  = parser->tape_length;
+                    parser->stack[parser->depth].count  = 0;
+                    parser->stack[parser->depth].end    = (c == '{') ? '}' : ']';
+                    parser->depth++;
+                    
+                    parser->tape[parser->tape_length++] = 0;
+                    
+                    state = (c == '{') ? _WI_JSON_DOCUMENT_OBJECT_KEY_OR_END : _WI_JSON_DOCUMENT_ARRAY_VALUE_OR_END;
+                } else {
+                    if(c == '"') {
+                        if(!_wi_json_document_parse_string(parser, offset, _WI_JSON_TAPE_STRING))
+                            return false;
+                    } else {
+                        if(!_wi_json_document_parse_scalar(parser, offset))
+                            return false;
+                    }
+                    
+                    state = _wi_json_document_end_value(parser);
+                }
+                break;
+            
+            case _WI_JSON_DOCUMENT_OBJECT_KEY:
+                if(c != '"') {
+                    _wi_json_document_set_error(offset, "expected key");
+                    
+                    return false;
+                }
+                
+                if(!_wi_json_document_parse_string(parser, offset, _WI_JSON_TAPE_KEY))
+                    return false;
+                
+                state = _WI_JSON_DOCUMENT_OBJECT_COLON;
+                break;
+            
+            case _WI_JSON_DOCUMENT_OBJECT_COLON:
+                if(c != ':') {
+                    _wi_json_document_set_error(offset, "expected ':'");
+                    
+                    return false;
+                }
+                
+                state = _WI_JSON_DOCUMENT_VALUE;
+                break;
+            
+            case _WI_JSON_DOCUMENT_OBJECT_COMMA_OR_END:
+            case _WI_JSON_DOCUMENT_ARRAY_COMMA_OR_END:
+                if(c == ',') {
+                    state = (state == _WI_JSON_DOCUMENT_OBJECT_COMMA_OR_END) ? _WI_JSON_DOCUMENT_OBJECT_KEY : _WI_JSON_DOCUMENT_VALUE;
+                }
+                else if(c == parser->stack[parser->depth - 1].end) {
+                    state = _wi_json_document_end_container(parser);
+                }
+                else {
+                    _wi_json_document_set_error(offset, (state == _WI_JSON_DOCUMENT_OBJECT_COMMA_OR_END) ? "expected ',' or '}'" : "expected ',' or ']'");
+                    
+                    return false;
+                }
+                break;
+            
+            default:
+                _wi_json_document_set_error(offset, "unexpected data after value");
+                
+                return false;
+        }
+    }
+    
+    if(state != _WI_JSON_DOCUMENT_DONE) {
+        _wi_json_document_set_error(parser->length, "unexpected end of data");
+        
+        return false;
+    }
+    
+    parser->tape[0] = _WI_JSON_TAPE_WORD(_WI_JSON_TAPE_ROOT, parser->tape_length);
+    parser->tape[parser->tape_length++] = _WI_JSON_TAPE_WORD(_WI_JSON_TAPE_ROOT, 0);
+    
+    return true;
+}
+
+
+
+static _wi_json_document_state_t _wi_json_document_end_container(_wi_json_document_parser_t *parser) {
+    _wi_json_document_container_t   *container;
+    
+    container = &parser->stack[--parser->depth];
+    
+    parser->tape[container->start] = _WI_JSON_TAPE_WORD((container->end == '}') ? _WI_JSON_TAPE_OBJECT_START : _WI_JSON_TAPE_ARRAY_START,
+        ((uint64_t) WI_MIN(container->count, _WI_JSON_DOCUMENT_MAX_COUNT) << 40) | (parser->tape_length + 1));
+    parser->tape[parser->tape_length++] = _WI_JSON_TAPE_WORD(container->end, container->start);
+    
+    return _wi_json_document_end_value(parser);
+}
+
+
+
+static _wi_json_document_state_t _wi_json_document_end_value(_wi_json_document_parser_t *parser) {
+    _wi_json_document_container_t   *container;
+    
+    if(parser->depth == 0)
+        return _WI_JSON_DOCUMENT_DONE;
+    
+    container = &parser->stack[parser->depth - 1];
+    container->count++;
+    
+    return (container->end == '}') ? _WI_JSON_DOCUMENT_OBJECT_COMMA_OR_END : _WI_JSON_DOCUMENT_ARRAY_COMMA_OR_END;
+}
+
+
+
+static wi_boolean_t _wi_json_document_parse_scalar(_wi_json_document_parser_t *parser, wi_uinteger_t offset) {
+    const unsigned char     *p, *end;
+    const char              *next;
+    wi_integer_t            integer;
+    double                  real;
+    wi_boolean_t            isfloat;
+    
+    p = parser->bytes + offset;
+    end = parser->bytes + parser->length;
+    
+    switch(*p) {
+        case 't':
+            if(end - p < 4 || memcmp(p, "true", 4) != 0 || !_wi_json_document_is_terminator(parser, p + 4))
+                break;
+            
+            parser->tape[parser->tape_length++] = _WI_JSON_TAPE_WORD(_WI_JSON_TAPE_TRUE, 0);
+            
+            return true;
+        
+        case 'f':
+            if(end - p < 5 || memcmp(p, "false", 5) != 0 || !_wi_json_document_is_terminator(parser, p + 5))
+                break;
+            
+            parser->tape[parser->tape_length++] = _WI_JSON_TAPE_WORD(_WI_JSON_TAPE_FALSE, 0);
+            
+            return true;
+        
+        case 'n':
+            if(end - p < 4 || memcmp(p, "null", 4) != 0 || !_wi_json_document_is_terminator(parser, p + 4))
+                break;
+            
+            parser->tape[parser->tape_length++] = _WI_JSON_TAPE_WORD(_WI_JSON_TAPE_NULL, 0);
+            
+            return true;
+        
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            if(!wi_json_scan_number((const char *) p, (const char *) end, &next, &integer, &real, &isfloat) ||
+               !_wi_json_document_is_terminator(parser, (const unsigned char *) next)) {
+                _wi_json_document_set_error(offset, "invalid number");
+                
+                return false;
+            }
+            
+            if(isfloat) {
+                parser->tape[parser->tape_length++] = _WI_JSON_TAPE_WORD(_WI_JSON_TAPE_REAL, 0);
+                
+                memcpy(&parser->tape[parser->tape_length++], &real, sizeof(real));
+            } else {
+                parser->tape[parser->tape_length++] = _WI_JSON_TAPE_WORD(_WI_JSON_TAPE_INTEGER, 0);
+                parser->tape[parser->tape_length++] = (uint64_t) integer;
+            }
+            
+            return true;
+        
+        default:
+            _wi_json_document_set_error(offset, "unexpected character");
+            
+            return false;
+    }
+    
+    _wi_json_document_set_error(offset, "invalid literal");
+    
+    return false;
+}
+
+
+
+static wi_boolean_t _wi_json_document_parse_string(_wi_json_document_parser_t *parser, wi_uinteger_t offset, char type) {
+    const char          *start, *p, *end, *next;
+    char                *buffer;
+    wi_uinteger_t       length;
+    uint32_t            length32;
+    
+    start = p = (const char *) parser->bytes + offset + 1;
+    end = (const char *) parser->bytes + parser->length;
+    buffer = parser->strings + parser->strings_length + sizeof(uint32_t);
+    
+    while(p < end && *p != '"' && *p != '\\')
+        p++;
+    
+    memcpy(buffer, start, p - start);
+    
+    if(p < end && *p == '"') {
+        length = p - start;
+    } else {
+        if(!wi_json_unescape_string(p, end, buffer + (p - start), &length, &next)) {
+            _wi_json_document_set_error(next - (const char *) parser->bytes, (next >= end) ? "unterminated string" : "invalid escape");
+            
+            return false;
+        }
+        
+        length += p - start;
+    }
+    
+    length32 = length;
+    
+    memcpy(parser->strings + parser->strings_length, &length32, sizeof(length32));
+    buffer[length] = '\0';
+    
+    parser->tape[parser->tape_length++] = _WI_JSON_TAPE_WORD(type, parser->strings_length);
+    parser->strings_length += sizeof(uint32_t) + length + 1;
+    
+    return true;
+}
+
+
+
+static wi_boolean_t _wi_json_document_is_terminator(_wi_json_document_parser_t *parser, const unsigned char *p) {
+    if(p >= parser->bytes + parser->length)
+        return true;
+    
+    switch(*p) {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+        case ',':
+        case ':':
+        case ']':
+        case '}':
+            return true;
+    }
+    
+    return false;
+}
+
+
+
+#pragma mark -
+
+wi_json_value_t wi_json_document_root_value(wi_json_document_t *document) {
+    return 1;
+}
+
+
+
+wi_json_type_t wi_json_document_value_type(wi_json_document_t *document, wi_json_value_t value) {
+    if(!_wi_json_document_is_valid_value(document, value))
+        return WI_JSON_NULL;
+    
+    switch(_WI_JSON_TAPE_TYPE(document->tape[value])) {
+        case _WI_JSON_TAPE_OBJECT_START:    return WI_JSON_OBJECT;
+        case _WI_JSON_TAPE_ARRAY_START:     return WI_JSON_ARRAY;
+        case _WI_JSON_TAPE_STRING:          return WI_JSON_STRING;
+        case _WI_JSON_TAPE_INTEGER:         return WI_JSON_INTEGER;
+        case _WI_JSON_TAPE_REAL:            return WI_JSON_REAL;
+        case _WI_JSON_TAPE_TRUE:            return WI_JSON_BOOLEAN;
+        case _WI_JSON_TAPE_FALSE:           return WI_JSON_BOOLEAN;
+    }
+    
+    return WI_JSON_NULL;
+}
+
+
+
+wi_uinteger_t wi_json_document_value_count(wi_json_document_t *document, wi_json_value_t value) {
+    wi_uinteger_t       count;
+    
+    if(!_wi_json_document_is_valid_value(document, value))
+        return 0;
+    
+    switch(_WI_JSON_TAPE_TYPE(document->tape[value])) {
+        case _WI_JSON_TAPE_OBJECT_START:
+        case _WI_JSON_TAPE_ARRAY_START:
+            count = _WI_JSON_TAPE_COUNT(document->tape[value]);
+            
+            /* Large containers are counted the long way */
+            if(count == _WI_JSON_DOCUMENT_MAX_COUNT) {
+                count = 0;
+                
+                for(value = wi_json_document_first_value(document, value); value != WI_NOT_FOUND; value = wi_json_document_next_value(document, value))
+                    count++;
+            }
+            
+            return count;
+    }
+    
+    return 0;
+}
+
+
+
+wi_json_value_t wi_json_document_value_at_index(wi_json_document_t *document, wi_json_value_t value, wi_uinteger_t index) {
+    if(wi_json_document_value_type(document, value) != WI_JSON_ARRAY)
+        return WI_NOT_FOUND;
+    
+    value = wi_json_document_first_value(document, value);
+    
+    while(value != WI_NOT_FOUND && index-- > 0)
+        value = wi_json_document_next_value(document, value);
+    
+    return value;
+}
+
+
+
+wi_json_value_t wi_json_document_value_for_key(wi_json_document_t *document, wi_json_value_t value, wi_string_t *key) {
+    const char          *bytes;
+    wi_json_value_t     match;
+    wi_uinteger_t       offset, length;
+    uint32_t            key_length;
+    
+    if(wi_json_document_value_type(document, value) != WI_JSON_OBJECT)
+        return WI_NOT_FOUND;
+    
+    bytes = wi_string_utf8_string(key);
+    length = wi_string_length(key);
+    match = WI_NOT_FOUND;
+    
+    /* Keys are compared in place, and the last of any duplicates wins as in wi_json_instance_for_string() */
+    for(value = wi_json_document_first_value(document, value); value != WI_NOT_FOUND; value = wi_json_document_next_value(document, value)) {
+        offset = _WI_JSON_TAPE_PAYLOAD(document->tape[value - 1]);
+        
+        memcpy(&key_length, document->strings + offset, sizeof(key_length));
+        
+        if(key_length == length && memcmp(document->strings + offset + sizeof(key_length), bytes, length) == 0)
+            match = value;
+    }
+    
+    return match;
+}
+
+
+
+wi_json_value_t wi_json_document_first_value(wi_json_document_t *document, wi_json_value_t value) {
+    wi_json_type_t      type;
+    char                next;
+    
+    type = wi_json_document_value_type(document, value);
+    
+    if(type != WI_JSON_OBJECT && type != WI_JSON_ARRAY)
+        return WI_NOT_FOUND;
+    
+    next = _WI_JSON_TAPE_TYPE(document->tape[value + 1]);
+    
+    if(next == _WI_JSON_TAPE_OBJECT_END || next == _WI_JSON_TAPE_ARRAY_END)
+        return WI_NOT_FOUND;
+    
+    /* Members of objects are a key word followed by the value */
+    return (next == _WI_JSON_TAPE_KEY) ? value + 2 : value + 1;
+}
+
+
+
+wi_json_value_t wi_json_document_next_value(wi_json_document_t *document, wi_json_value_t value) {
+    char                next;
+    
+    if(!_wi_json_document_is_valid_value(document, value))
+        return WI_NOT_FOUND;
+    
+    value = _wi_json_document_skip_value(document, value);
+    next = _WI_JSON_TAPE_TYPE(document->tape[value]);
+    
+    if(next == _WI_JSON_TAPE_KEY)
+        return value + 1;
+    
+    if(next == _WI_JSON_TAPE_OBJECT_END || next == _WI_JSON_TAPE_ARRAY_END || next == _WI_JSON_TAPE_ROOT)
+        return WI_NOT_FOUND;
+    
+    return value;
+}
+
+
+
+wi_string_t * wi_json_document_key_for_value(wi_json_document_t *document, wi_json_value_t value) {
+    if(!_wi_json_document_is_valid_value(document, value) || _WI_JSON_TAPE_TYPE(document->tape[value - 1]) != _WI_JSON_TAPE_KEY)
+        return NULL;
+    
+    return wi_autorelease(_wi_json_document_string_at_offset(document, _WI_JSON_TAPE_PAYLOAD(document->tape[value - 1])));
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_json_document_bool_for_value(wi_json_document_t *document, wi_json_value_t value) {
+    switch(wi_json_document_value_type(document, value)) {
+        case WI_JSON_BOOLEAN:
+            return (_WI_JSON_TAPE_TYPE(document->tape[value]) == _WI_JSON_TAPE_TRUE);
+        
+        case WI_JSON_INTEGER:
+            return (wi_json_document_integer_for_value(document, value) != 0);
+        
+        case WI_JSON_REAL:
+            return (wi_json_document_double_for_value(document, value) != 0.0);
+        
+        default:
+            return false;
+    }
+}
+
+
+
+wi_integer_t wi_json_document_integer_for_value(wi_json_document_t *document, wi_json_value_t value) {
+    switch(wi_json_document_value_type(document, value)) {
+        case WI_JSON_BOOLEAN:
+            return (_WI_JSON_TAPE_TYPE(document->tape[value]) == _WI_JSON_TAPE_TRUE) ? 1 : 0;
+        
+        case WI_JSON_INTEGER:
+            return (wi_integer_t) document->tape[value + 1];
+        
+        case WI_JSON_REAL:
+            return (wi_integer_t) wi_json_document_double_for_value(document, value);
+        
+        default:
+            return 0;
+    }
+}
+
+
+
+double wi_json_document_double_for_value(wi_json_document_t *document, wi_json_value_t value) {
+    double      real;
+    
+    switch(wi_json_document_value_type(document, value)) {
+        case WI_JSON_BOOLEAN:
+        case WI_JSON_INTEGER:
+            return (double) wi_json_document_integer_for_value(document, value);
+        
+        case WI_JSON_REAL:
+            memcpy(&real, &document->tape[value + 1], sizeof(real));
+            
+            return real;
+        
+        default:
+            return 0.0;
+    }
+}
+
+
+
+wi_string_t * wi_json_document_string_for_value(wi_json_document_t *document, wi_json_value_t value) {
+    if(wi_json_document_value_type(document, value) != WI_JSON_STRING)
+        return NULL;
+    
+    return wi_autorelease(_wi_json_document_string_at_offset(document, _WI_JSON_TAPE_PAYLOAD(document->tape[value])));
+}
+
+
+
+wi_runtime_instance_t * wi_json_document_instance_for_value(wi_json_document_t *document, wi_json_value_t value) {
+    if(!_wi_json_document_is_valid_value(document, value))
+        return NULL;
+    
+    return wi_autorelease(_wi_json_document_instance_for_value(document, value));
+}
+
+
+
+#pragma mark -
+
+static wi_uinteger_t _wi_json_document_skip_value(wi_json_document_t *document, wi_json_value_t value) {
+    switch(_WI_JSON_TAPE_TYPE(document->tape[value])) {
+        case _WI_JSON_TAPE_OBJECT_START:
+        case _WI_JSON_TAPE_ARRAY_START:
+            return _WI_JSON_TAPE_NEXT(document->tape[value]);
+        
+        case _WI_JSON_TAPE_INTEGER:
+        case _WI_JSON_TAPE_REAL:
+            return value + 2;
+        
+        default:
+            return value + 1;
+    }
+}
+
+
+
+static wi_boolean_t _wi_json_document_is_valid_value(wi_json_document_t *document, wi_json_value_t value) {
+    if(value == WI_NOT_FOUND || value == 0 || value >= document->tape_length - 1)
+        return false;
+    
+    switch(_WI_JSON_TAPE_TYPE(document->tape[value])) {
+        case _WI_JSON_TAPE_OBJECT_START:
+        case _WI_JSON_TAPE_ARRAY_START:
+        case _WI_JSON_TAPE_STRING:
+        case _WI_JSON_TAPE_INTEGER:
+        case _WI_JSON_TAPE_REAL:
+        case _WI_JSON_TAPE_TRUE:
+        case _WI_JSON_TAPE_FALSE:
+        case _WI_JSON_TAPE_NULL:
+            return true;
+    }
+    
+    return false;
+}
+
+
+
+static wi_string_t * _wi_json_document_string_at_offset(wi_json_document_t *document, wi_uinteger_t offset) {
+    uint32_t        length;
+    
+    memcpy(&length, document->strings + offset, sizeof(length));
+    
+    return wi_string_init_with_utf8_bytes(wi_string_alloc(), document->strings + offset + sizeof(length), length);
+}
+
+
+
+static wi_runtime_instance_t * _wi_json_document_instance_for_value(wi_json_document_t *document, wi_json_value_t value) {
+    wi_runtime_instance_t   *instance, *key, *child;
+    wi_json_value_t         end;
+    
+    switch(_WI_JSON_TAPE_TYPE(document->tape[value])) {
+        case _WI_JSON_TAPE_OBJECT_START:
+            instance = wi_dictionary_init_with_capacity(wi_mutable_dictionary_alloc(), _WI_JSON_TAPE_COUNT(document->tape[value]));
+            end = _WI_JSON_TAPE_NEXT(document->tape[value]) - 1;
+            
+            for(value = value + 1; value < end; value = _wi_json_document_skip_value(document, value + 1)) {
+                key = _wi_json_document_string_at_offset(document, _WI_JSON_TAPE_PAYLOAD(document->tape[value]));
+                child = _wi_json_document_instance_for_value(document, value + 1);
+                
+                wi_mutable_dictionary_set_data_for_key(instance, child, key);
+                
+                wi_release(child);
+                wi_release(key);
+            }
+            
+            return instance;
+        
+        case _WI_JSON_TAPE_ARRAY_START:
+            instance = wi_array_init_with_capacity(wi_mutable_array_alloc(), _WI_JSON_TAPE_COUNT(document->tape[value]));
+            end = _WI_JSON_TAPE_NEXT(document->tape[value]) - 1;
+            
+            for(value = value + 1; value < end; value = _wi_json_document_skip_value(document, value)) {
+                child = _wi_json_document_instance_for_value(document, value);
+                
+                wi_mutable_array_add_data(instance, child);
+                
+                wi_release(child);
+            }
+            
+            return instance;
+        
+        case _WI_JSON_TAPE_STRING:
+            return _wi_json_document_string_at_offset(document, _WI_JSON_TAPE_PAYLOAD(document->tape[value]));
+        
+        case _WI_JSON_TAPE_INTEGER:
+            return wi_number_init_with_integer(wi_number_alloc(), (wi_integer_t) document->tape[value + 1]);
+        
+        case _WI_JSON_TAPE_REAL:
+            return wi_number_init_with_double(wi_number_alloc(), wi_json_document_double_for_value(document, value));
+        
+        case _WI_JSON_TAPE_TRUE:
+            return wi_number_init_with_bool(wi_number_alloc(), true);
+        
+        case _WI_JSON_TAPE_FALSE:
+            return wi_number_init_with_bool(wi_number_alloc(), false);
+        
+        default:
+            return wi_retain(wi_null());
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WI_JSON_DOCUMENT_H
+#define WI_JSON_DOCUMENT_H 1
+
+#include <wired/wi-base.h>
+#include <wired/wi-runtime.h>
+
+enum _wi_json_type {
+    WI_JSON_NULL                            = 0,
+    WI_JSON_BOOLEAN,
+    WI_JSON_INTEGER,
+    WI_JSON_REAL,
+    WI_JSON_STRING,
+    WI_JSON_ARRAY,
+    WI_JSON_OBJECT
+};
+typedef enum _wi_json_type                  wi_json_type_t;
+
+typedef wi_uinteger_t                       wi_json_value_t;
+
+
+WI_EXPORT wi_runtime_id_t                   wi_json_document_runtime_id(void);
+
+WI_EXPORT wi_json_document_t *              wi_json_document_with_string(wi_string_t *);
+
+WI_EXPORT wi_json_document_t *              wi_json_document_alloc(void);
+WI_EXPORT wi_json_document_t *              wi_json_document_init_with_string(wi_json_document_t *, wi_string_t *);
+WI_EXPORT wi_json_document_t *              wi_json_document_init_with_data(wi_json_document_t *, wi_data_t *);
+WI_EXPORT wi_json_document_t *              wi_json_document_init_with_contents_of_file(wi_json_document_t *, wi_string_t *);
+
+WI_EXPORT wi_json_value_t                   wi_json_document_root_value(wi_json_document_t *);
+
+WI_EXPORT wi_json_type_t                    wi_json_document_value_type(wi_json_document_t *, wi_json_value_t);
+WI_EXPORT wi_uinteger_t                     wi_json_document_value_count(wi_json_document_t *, wi_json_value_t);
+WI_EXPORT wi_json_value_t                   wi_json_document_value_at_index(wi_json_document_t *, wi_json_value_t, wi_uinteger_t);
+WI_EXPORT wi_json_value_t                   wi_json_document_value_for_key(wi_json_document_t *, wi_json_value_t, wi_string_t *);
+WI_EXPORT wi_json_value_t                   wi_json_document_first_value(wi_json_document_t *, wi_json_value_t);
+WI_EXPORT wi_json_value_t                   wi_json_document_next_value(wi_json_document_t *, wi_json_value_t);
+WI_EXPORT wi_string_t *                     wi_json_document_key_for_value(wi_json_document_t *, wi_json_value_t);
+
+WI_EXPORT wi_boolean_t                      wi_json_document_bool_for_value(wi_json_document_t *, wi_json_value_t);
+WI_EXPORT wi_integer_t                      wi_json_document_integer_for_value(wi_json_document_t *, wi_json_value_t);
+WI_EXPORT double                            wi_json_document_double_for_value(wi_json_document_t *, wi_json_value_t);
+WI_EXPORT wi_string_t *                     wi_json_document_string_for_value(wi_json_document_t *, wi_json_value_t);
+WI_EXPORT wi_runtime_instance_t *           wi_json_document_instance_for_value(wi_json_document_t *, wi_json_value_t);
+
+#endif /* WI_JSON_DOCUMENT_H */
@@ -0,0 +1,664 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <wired/wi-dictionary.h>
+#include <wired/wi-file.h>
+#include <wired/wi-json-reader.h>
+#include <wired/wi-null.h>
+#include <wired/wi-number.h>
+#include <wired/wi-pipe.h>
+#include <wired/wi-pool.h>
+#include <wired/wi-private.h>
+#include <wired/wi-runtime.h>
+#include <wired/wi-socket.h>
+#include <wired/wi-string.h>
+#include <wired/wi-system.h>
+
+#define _WI_JSON_READER_BUFFER_SIZE             (64 * 1024)
+#define _WI_JSON_READER_MAX_DEPTH               512
+
+
+enum _wi_json_reader_state {
+    _WI_JSON_READER_VALUE,
+    _WI_JSON_READER_OBJECT_KEY_OR_END,
+    _WI_JSON_READER_OBJECT_KEY,
+    _WI_JSON_READER_OBJECT_COLON,
+    _WI_JSON_READER_ARRAY_VALUE_OR_END,
+    _WI_JSON_READER_COMMA_OR_END
+};
+typedef enum _wi_json_reader_state              _wi_json_reader_state_t;
+
+
+typedef wi_integer_t                            _wi_json_reader_read_func_t(wi_json_reader_t *, void *, wi_uinteger_t);
+
+
+struct _wi_json_reader {
+    wi_runtime_base_t                           base;
+    
+    wi_runtime_instance_t                       *source;
+    _wi_json_reader_read_func_t                 *read;
+    wi_time_interval_t                          timeout;
+    
+    /* Input is consumed from a window that only grows to hold the largest token */
+    char                                        *buffer;
+    wi_uinteger_t                               buffer_size;
+    wi_uinteger_t                               position;
+    wi_uinteger_t                               length;
+    wi_uinteger_t                               offset;
+    wi_boolean_t                                eof;
+    
+    _wi_json_reader_state_t                     state;
+    char                                        stack[_WI_JSON_READER_MAX_DEPTH];
+    wi_uinteger_t                               depth;
+    
+    wi_json_token_t                             token;
+    const char                                  *string;
+    wi_uinteger_t                               string_length;
+    char                                        *scratch;
+    wi_uinteger_t                               scratch_size;
+    wi_integer_t                                integer;
+    double                                      real;
+    wi_boolean_t                                boolean;
+};
+
+
+static void                                     _wi_json_reader_dealloc(wi_runtime_instance_t *);
+
+static wi_integer_t                             _wi_json_reader_read_file(wi_json_reader_t *, void *, wi_uinteger_t);
+static wi_integer_t                             _wi_json_reader_read_socket(wi_json_reader_t *, void *, wi_uinteger_t);
+static wi_integer_t                             _wi_json_reader_read_pipe(wi_json_reader_t *, void *, wi_uinteger_t);
+
+static wi_json_reader_t *                       _wi_json_reader_init_with_source(wi_json_reader_t *, wi_runtime_instance_t *, _wi_json_reader_read_func_t *);
+static wi_integer_t                             _wi_json_reader_fill(wi_json_reader_t *);
+static wi_boolean_t                             _wi_json_reader_skip_whitespace(wi_json_reader_t *);
+static wi_json_token_t                          _wi_json_reader_set_error(wi_json_reader_t *, const char *);
+static wi_json_token_t                          _wi_json_reader_end_value(wi_json_reader_t *, wi_json_token_t);
+static wi_json_token_t                          _wi_json_reader_read_string(wi_json_reader_t *, wi_json_token_t);
+static wi_json_token_t                          _wi_json_reader_read_scalar(wi_json_reader_t *);
+static wi_runtime_instance_t *                  _wi_json_reader_instance_for_token(wi_json_reader_t *, wi_json_token_t);
+
+
+static wi_runtime_id_t                          _wi_json_reader_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t                       _wi_json_reader_runtime_class = {
+    "wi_json_reader_t",
+    _wi_json_reader_dealloc,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+
+void wi_json_reader_register(void) {
+    _wi_json_reader_runtime_id = wi_runtime_register_class(&_wi_json_reader_runtime_class);
+}
+
+
+
+void wi_json_reader_initialize(void) {
+}
+
+
+
+#pragma mark -
+
+wi_runtime_id_t wi_json_reader_runtime_id(void) {
+    return _wi_json_reader_runtime_id;
+}
+
+
+
+#pragma mark -
+
+wi_json_reader_t * wi_json_reader_alloc(void) {
+    return wi_runtime_create_instance(_wi_json_reader_runtime_id, sizeof(wi_json_reader_t));
+}
+
+
+
+wi_json_reader_t * wi_json_reader_init_with_file(wi_json_reader_t *reader, wi_file_t *file) {
+    return _wi_json_reader_init_with_source(reader, file, _wi_json_reader_read_file);
+}
+
+
+
+wi_json_reader_t * wi_json_reader_init_with_socket(wi_json_reader_t *reader, wi_socket_t *socket, wi_time_interval_t timeout) {
+    reader->timeout = timeout;
+    
+    return _wi_json_reader_init_with_source(reader, socket, _wi_json_reader_read_socket);
+}
+
+
+
+wi_json_reader_t * wi_json_reader_init_with_pipe(wi_json_reader_t *reader, wi_pipe_t *pipe) {
+    return _wi_json_reader_init_with_source(reader, pipe, _wi_json_reader_read_pipe);
+}
+
+
+
+static wi_json_reader_t * _wi_json_reader_init_with_source(wi_json_reader_t *reader, wi_runtime_instance_t *source, _wi_json_reader_read_func_t *read) {
+    reader->source          = wi_retain(source);
+    reader->read            = read;
+    reader->buffer_size     = _WI_JSON_READER_BUFFER_SIZE;
+    reader->buffer          = wi_malloc(reader->buffer_size);
+    reader->state           = _WI_JSON_READER_VALUE;
+    
+    return reader;
+}
+
+
+
+static void _wi_json_reader_dealloc(wi_runtime_instance_t *instance) {
+    wi_json_reader_t    *reader = instance;
+    
+    wi_release(reader->source);
+    
+    wi_free(reader->buffer);
+    wi_free(reader->scratch);
+}
+
+
+
+#pragma mark -
+
+static wi_integer_t _wi_json_reader_read_file(wi_json_reader_t *reader, void *buffer, wi_uinteger_t length) {
+    return wi_file_read_bytes(reader->source, buffer, length);
+}
+
+
+
+static wi_integer_t _wi_json_reader_read_socket(wi_json_reader_t *reader, void *buffer, wi_uinteger_t length) {
+    return wi_socket_read_available_bytes(reader->source, reader->timeout, buffer, length);
+}
+
+
+
+static wi_integer_t _wi_json_reader_read_pipe(wi_json_reader_t *reader, void *buffer, wi_uinteger_t length) {
+    return wi_pipe_read_available_bytes(reader->source, buffer, length);
+}
+
+
+
+#pragma mark -
+
+wi_json_token_t wi_json_reader_next_token(wi_json_reader_t *reader) {
+    char        c;
+    
+    if(reader->token == WI_JSON_TOKEN_ERROR)
+        return WI_JSON_TOKEN_ERROR;
+    
+    while(true) {
+        if(!_wi_json_reader_skip_whitespace(reader)) {
+            if(reader->token == WI_JSON_TOKEN_ERROR)
+                return WI_JSON_TOKEN_ERROR;
+            
+            /* Values follow each other at the top level, so the input may end between them */
+            if(reader->state == _WI_JSON_READER_VALUE && reader->depth == 0) {
+                reader->token = WI_JSON_TOKEN_NONE;
+                
+                return WI_JSON_TOKEN_NONE;
+            }
+            
+            return _wi_json_reader_set_error(reader, "unexpected end of data");
+        }
+        
+        c = reader->buffer[reader->position];
+        
+        switch(reader->state) {
+            case _WI_JSON_READER_OBJECT_COLON:
+                if(c != ':')
+                    return _wi_json_reader_set_error(reader, "expected ':'");
+                
+                reader->position++;
+                reader->state = _WI_JSON_READER_VALUE;
+                continue;
+            
+            case _WI_JSON_READER_COMMA_OR_END:
+                if(c == ',') {
+                    reader->position++;
+                    reader->state = (reader->stack[reader->depth - 1] == '}') ? _WI_JSON_READER_OBJECT_KEY : _WI_JSON_READER_VALUE;
+                    
+                    continue;
+                }
+                
+                if(c != reader->stack[reader->depth - 1])
+                    return _wi_json_reader_set_error(reader, (reader->stack[reader->depth - 1] == '}') ? "expected ',' or '}'" : "expected ',' or ']'");
+                
+                reader->position++;
+                reader->depth--;
+                
+                return _wi_json_reader_end_value(reader, (c == '}') ? WI_JSON_TOKEN_OBJECT_END : WI_JSON_TOKEN_ARRAY_END);
+            
+            case _WI_JSON_READER_OBJECT_KEY_OR_END:
+            case _WI_JSON_READER_ARRAY_VALUE_OR_END:
+                if(c == reader->stack[reader->depth - 1]) {
+                    reader->position++;
+                    reader->depth--;
+                    
+                    return _wi_json_reader_end_value(reader, (c == '}') ? WI_JSON_TOKEN_OBJECT_END : WI_JSON_TOKEN_ARRAY_END);
+                }
+                
+                reader->state = (reader->state == _WI_JSON_READER_OBJECT_KEY_OR_END) ? _WI_JSON_READER_OBJECT_KEY : _WI_JSON_READER_VALUE;
+                continue;
+            
+            case _WI_JSON_READER_OBJECT_KEY:
+                if(c != '"')
+                    return _wi_json_reader_set_error(reader, "expected key");
+                
+                return _wi_json_reader_read_string(reader, WI_JSON_TOKEN_KEY);
+            
+            case _WI_JSON_READER_VALUE:
+                if(c == '{' || c == '[') {
+                    if(reader->depth == _WI_JSON_READER_MAX_DEPTH)
+                        return _wi_json_reader_set_error(reader, "nesting too deep");
+                    
+                    reader->position++;
+                    reader->stack[reader->depth++] = (c == '{') ? '}' : ']';
+                    reader->state = (c == '{') ? _WI_JSON_READER_OBJECT_KEY_OR_END : _WI_JSON_READER_ARRAY_VALUE_OR_END;
+                    reader->token = (c == '{') ? WI_JSON_TOKEN_OBJECT_START : WI_JSON_TOKEN_ARRAY_START;
+                    
+                    return reader->token;
+                }
+                
+                if(c == '"')
+                    return _wi_json_reader_read_string(reader, WI_JSON_TOKEN_STRING);
+                
+                return _wi_json_reader_read_scalar(reader);
+        }
+    }
+}
+
+
+
+wi_uinteger_t wi_json_reader_depth(wi_json_reader_t *reader) {
+    return reader->depth;
+}
+
+
+
+#pragma mark -
+
+wi_string_t * wi_json_reader_string(wi_json_reader_t *reader) {
+    if(reader->token != WI_JSON_TOKEN_KEY && reader->token != WI_JSON_TOKEN_STRING)
+        return NULL;
+    
+    return wi_autorelease(wi_string_init_with_utf8_bytes(wi_string_alloc(), reader->string, reader->string_length));
+}
+
+
+
+wi_integer_t wi_json_reader_integer(wi_json_reader_t *reader) {
+    switch(reader->token) {
+        case WI_JSON_TOKEN_INTEGER:     return reader->integer;
+        case WI_JSON_TOKEN_REAL:        return (wi_integer_t) reader->real;
+        case WI_JSON_TOKEN_BOOLEAN:     return reader->boolean ? 1 : 0;
+        default:                        return 0;
+    }
+}
+
+
+
+double wi_json_reader_double(wi_json_reader_t *reader) {
+    switch(reader->token) {
+        case WI_JSON_TOKEN_INTEGER:     return (double) reader->integer;
+        case WI_JSON_TOKEN_REAL:        return reader->real;
+        case WI_JSON_TOKEN_BOOLEAN:     return reader->boolean ? 1.0 : 0.0;
+        default:                        return 0.0;
+    }
+}
+
+
+
+wi_boolean_t wi_json_reader_bool(wi_json_reader_t *reader) {
+    switch(reader->token) {
+        case WI_JSON_TOKEN_INTEGER:     return (reader->integer != 0);
+        case WI_JSON_TOKEN_REAL:        return (reader->real != 0.0);
+        case WI_JSON_TOKEN_BOOLEAN:     return reader->boolean;
+        default:                        return false;
+    }
+}
+
+
+
+#pragma mark -
+
+wi_runtime_instance_t * wi_json_reader_instance(wi_json_reader_t *reader) {
+    return wi_autorelease(_wi_json_reader_instance_for_token(reader, reader->token));
+}
+
+
+
+wi_boolean_t wi_json_reader_skip_value(wi_json_reader_t *reader) {
+    wi_uinteger_t       depth;
+    
+    if(reader->token != WI_JSON_TOKEN_OBJECT_START && reader->token != WI_JSON_TOKEN_ARRAY_START)
+        return (reader->token != WI_JSON_TOKEN_ERROR);
+    
+    depth = reader->depth - 1;
+    
+    while(reader->depth > depth) {
+        if(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_ERROR)
+            return false;
+    }
+    
+    return true;
+}
+
+
+
+#pragma mark -
+
+static wi_integer_t _wi_json_reader_fill(wi_json_reader_t *reader) {
+    wi_integer_t        bytes;
+    
+    if(reader->eof)
+        return 0;
+    
+    /* The token being read is moved to the front, and the window grows only if it is full */
+    if(reader->position > 0) {
+        memmove(reader->buffer, reader->buffer + reader->position, reader->length - reader->position);
+        
+        reader->offset += reader->position;
+        reader->length -= reader->position;
+        reader->position = 0;
+    }
+    
+    if(reader->length == reader->buffer_size) {
+        reader->buffer_size *= 2;
+        reader->buffer = wi_realloc(reader->buffer, reader->buffer_size);
+    }
+    
+    bytes = (*reader->read)(reader, reader->buffer + reader->length, reader->buffer_size - reader->length);
+    
+    if(bytes > 0)
+        reader->length += bytes;
+    else if(bytes == 0)
+        reader->eof = true;
+    else
+        reader->token = WI_JSON_TOKEN_ERROR;
+    
+    return bytes;
+}
+
+
+
+static wi_boolean_t _wi_json_reader_skip_whitespace(wi_json_reader_t *reader) {
+    while(true) {
+        while(reader->position < reader->length) {
+            switch(reader->buffer[reader->position]) {
+                case ' ':
+                case '\t':
+                case '\r':
+                case '\n':
+                    reader->position++;
+                    break;
+                
+                default:
+                    return true;
+            }
+        }
+        
+        if(_wi_json_reader_fill(reader) <= 0)
+            return false;
+    }
+}
+
+
+
+static wi_json_token_t _wi_json_reader_set_error(wi_json_reader_t *reader, const char *reason) {
+    wi_error_set_libwired_error_with_format(WI_ERROR_JSON_READFAILED,
+        WI_STR("Syntax error at offset %lu (%s)"),
+        reader->offset + reader->position,
+        reason);
+    
+    reader->token = WI_JSON_TOKEN_ERROR;
+    
+    return WI_JSON_TOKEN_ERROR;
+}
+
+
+
+static wi_json_token_t _wi_json_reader_end_value(wi_json_reader_t *reader, wi_json_token_t token) {
+    if(reader->depth == 0)
+        reader->state = _WI_JSON_READER_VALUE;
+    else
+        reader->state = _WI_JSON_READER_COMMA_OR_END;
+    
+    reader->token = token;
+    
+    return token;
+}
+
+
+
+static wi_json_token_t _wi_json_reader_read_string(wi_json_reader_t *reader, wi_json_token_t token) {
+    const char          *start, *next;
+    wi_uinteger_t       i, length;
+    wi_boolean_t        escaped;
+    
+    i = 1;
+    escaped = false;
+    
+    /* Offsets are relative to the token, which stays put while more input is read */
+    while(true) {
+        while(reader->position + i < reader->length) {
+            if(reader->buffer[reader->position + i] == '"')
+                break;
+            
+            if(reader->buffer[reader->position + i] == '\\') {
+                escaped = true;
+                i++;
+            }
+            
+            i++;
+        }
+        
+        if(reader->position + i < reader->length)
+            break;
+        
+        if(_wi_json_reader_fill(reader) <= 0) {
+            if(reader->token == WI_JSON_TOKEN_ERROR)
+                return WI_JSON_TOKEN_ERROR;
+            
+            return _wi_json_reader_set_error(reader, "unterminated string");
+        }
+    }
+    
+    start = reader->buffer + reader->position + 1;
+    
+    if(!escaped) {
+        reader->string = start;
+        reader->string_length = i - 1;
+    } else {
+        if(reader->scratch_size < i) {
+            reader->scratch_size = i;
+            reader->scratch = wi_realloc(reader->scratch, reader->scratch_size);
+        }
+        
+        if(!wi_json_unescape_string(start, reader->buffer + reader->position + i + 1, reader->scratch, &length, &next)) {
+            reader->position = next - reader->buffer;
+            
+            return _wi_json_reader_set_error(reader, "invalid escape");
+        }
+        
+        reader->string = reader->scratch;
+        reader->string_length = length;
+    }
+    
+    reader->position += i + 1;
+    
+    if(token == WI_JSON_TOKEN_KEY) {
+        reader->state = _WI_JSON_READER_OBJECT_COLON;
+        reader->token = token;
+        
+        return token;
+    }
+    
+    return _wi_json_reader_end_value(reader, token);
+}
+
+
+
+static wi_json_token_t _wi_json_reader_read_scalar(wi_json_reader_t *reader) {
+    const char          *start, *next;
+    wi_uinteger_t       i;
+    wi_boolean_t        isfloat;
+    char                c;
+    
+    i = 0;
+    
+    /* A scalar runs until whitespace, punctuation or the end of input */
+    while(true) {
+        while(reader->position + i < reader->length) {
+            c = reader->buffer[reader->position + i];
+            
+            if(c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ':' || c == ']' || c == '}' || c == '[' || c == '{' || c == '"')
+                break;
+            
+            i++;
+        }
+        
+        if(reader->position + i < reader->length)
+            break;
+        
+        if(_wi_json_reader_fill(reader) <= 0) {
+            if(reader->token == WI_JSON_TOKEN_ERROR)
+                return WI_JSON_TOKEN_ERROR;
+            
+            break;
+        }
+    }
+    
+    start = reader->buffer + reader->position;
+    
+    if(i == 4 && memcmp(start, "true", 4) == 0) {
+        reader->boolean = true;
+        reader->position += i;
+        
+        return _wi_json_reader_end_value(reader, WI_JSON_TOKEN_BOOLEAN);
+    }
+    else if(i == 5 && memcmp(start, "false", 5) == 0) {
+        reader->boolean = false;
+        reader->position += i;
+        
+        return _wi_json_reader_end_value(reader, WI_JSON_TOKEN_BOOLEAN);
+    }
+    else if(i == 4 && memcmp(start, "null", 4) == 0) {
+        reader->position += i;
+        
+        return _wi_json_reader_end_value(reader, WI_JSON_TOKEN_NULL);
+    }
+    else if(i > 0 && (*start == '-' || (*start >= '0' && *start <= '9'))) {
+        if(!wi_json_scan_number(start, start + i, &next, &reader->integer, &reader->real, &isfloat) || next != start + i)
+            return _wi_json_reader_set_error(reader, "invalid number");
+        
+        reader->position += i;
+        
+        return _wi_json_reader_end_value(reader, isfloat ? WI_JSON_TOKEN_REAL : WI_JSON_TOKEN_INTEGER);
+    }
+    else if(i > 0 && (*start == 't' || *start == 'f' || *start == 'n')) {
+        return _wi_json_reader_set_error(reader, "invalid literal");
+    }
+    
+    return _wi_json_reader_set_error(reader, "unexpected character");
+}
+
+
+
+static wi_runtime_instance_t * _wi_json_reader_instance_for_token(wi_json_reader_t *reader, wi_json_token_t token) {
+    wi_runtime_instance_t   *instance, *key, *value;
+    
+    switch(token) {
+        case WI_JSON_TOKEN_OBJECT_START:
+            instance = wi_dictionary_init(wi_mutable_dictionary_alloc());
+            
+            while((token = wi_json_reader_next_token(reader)) == WI_JSON_TOKEN_KEY) {
+                key = wi_string_init_with_utf8_bytes(wi_string_alloc(), reader->string, reader->string_length);
+                value = _wi_json_reader_instance_for_token(reader, wi_json_reader_next_token(reader));
+                
+                if(value)
+                    wi_mutable_dictionary_set_data_for_key(instance, value, key);
+                
+                wi_release(value);
+                wi_release(key);
+                
+                if(!value)
+                    break;
+            }
+            
+            if(reader->token != WI_JSON_TOKEN_OBJECT_END) {
+                wi_release(instance);
+                
+                return NULL;
+            }
+            
+            return instance;
+        
+        case WI_JSON_TOKEN_ARRAY_START:
+            instance = wi_array_init(wi_mutable_array_alloc());
+            
+            while((token = wi_json_reader_next_token(reader)) != WI_JSON_TOKEN_ARRAY_END) {
+                value = _wi_json_reader_instance_for_token(reader, token);
+                
+                if(!value)
+                    break;
+                
+                wi_mutable_array_add_data(instance, value);
+                wi_release(value);
+            }
+            
+            if(reader->token != WI_JSON_TOKEN_ARRAY_END) {
+                wi_release(instance);
+                
+                return NULL;
+            }
+            
+            return instance;
+        
+        case WI_JSON_TOKEN_STRING:
+            return wi_string_init_with_utf8_bytes(wi_string_alloc(), reader->string, reader->string_length);
+        
+        case WI_JSON_TOKEN_INTEGER:
+            return wi_number_init_with_integer(wi_number_alloc(), reader->integer);
+        
+        case WI_JSON_TOKEN_REAL:
+            return wi_number_init_with_double(wi_number_alloc(), reader->real);
+        
+        case WI_JSON_TOKEN_BOOLEAN:
+            return wi_number_init_with_bool(wi_number_alloc(), reader->boolean);
+        
+        case WI_JSON_TOKEN_NULL:
+            return wi_retain(wi_null());
+        
+        default:
+            return NULL;
+    }
+}
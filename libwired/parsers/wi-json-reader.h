@@ -0,0 +1,68 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WI_JSON_READER_H
+#define WI_JSON_READER_H 1
+
+#include <wired/wi-base.h>
+#include <wired/wi-runtime.h>
+
+enum _wi_json_token {
+    WI_JSON_TOKEN_NONE                      = 0,
+    WI_JSON_TOKEN_ERROR,
+    WI_JSON_TOKEN_OBJECT_START,
+    WI_JSON_TOKEN_OBJECT_END,
+    WI_JSON_TOKEN_ARRAY_START,
+    WI_JSON_TOKEN_ARRAY_END,
+    WI_JSON_TOKEN_KEY,
+    WI_JSON_TOKEN_STRING,
+    WI_JSON_TOKEN_INTEGER,
+    WI_JSON_TOKEN_REAL,
+    WI_JSON_TOKEN_BOOLEAN,
+    WI_JSON_TOKEN_NULL
+};
+typedef enum _wi_json_token                 wi_json_token_t;
+
+
+WI_EXPORT wi_runtime_id_t                   wi_json_reader_runtime_id(void);
+
+WI_EXPORT wi_json_reader_t *                wi_json_reader_alloc(void);
+WI_EXPORT wi_json_reader_t *                wi_json_reader_init_with_file(wi_json_reader_t *, wi_file_t *);
+WI_EXPORT wi_json_reader_t *                wi_json_reader_init_with_socket(wi_json_reader_t *, wi_socket_t *, wi_time_interval_t);
+WI_EXPORT wi_json_reader_t *                wi_json_reader_init_with_pipe(wi_json_reader_t *, wi_pipe_t *);
+
+WI_EXPORT wi_json_token_t                   wi_json_reader_next_token(wi_json_reader_t *);
+WI_EXPORT wi_uinteger_t                     wi_json_reader_depth(wi_json_reader_t *);
+
+WI_EXPORT wi_string_t *                     wi_json_reader_string(wi_json_reader_t *);
+WI_EXPORT wi_integer_t                      wi_json_reader_integer(wi_json_reader_t *);
+WI_EXPORT double                            wi_json_reader_double(wi_json_reader_t *);
+WI_EXPORT wi_boolean_t                      wi_json_reader_bool(wi_json_reader_t *);
+
+WI_EXPORT wi_runtime_instance_t *           wi_json_reader_instance(wi_json_reader_t *);
+WI_EXPORT wi_boolean_t                      wi_json_reader_skip_value(wi_json_reader_t *);
+
+#endif /* WI_JSON_READER_H */
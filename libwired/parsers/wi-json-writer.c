@@ -0,0 +1,586 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <wired/wi-array.h>
+#include <wired/wi-assert.h>
+#include <wired/wi-dictionary.h>
+#include <wired/wi-file.h>
+#include <wired/wi-json-writer.h>
+#include <wired/wi-null.h>
+#include <wired/wi-number.h>
+#include <wired/wi-pipe.h>
+#include <wired/wi-private.h>
+#include <wired/wi-runtime.h>
+#include <wired/wi-socket.h>
+#include <wired/wi-string.h>
+#include <wired/wi-system.h>
+
+#define _WI_JSON_WRITER_BUFFER_SIZE             (64 * 1024)
+#define _WI_JSON_WRITER_MAX_DEPTH               512
+
+
+typedef wi_integer_t                            _wi_json_writer_write_func_t(wi_json_writer_t *, const void *, wi_uinteger_t);
+
+
+struct _wi_json_writer_container {
+    char                                        type;
+    wi_boolean_t                                empty;
+};
+typedef struct _wi_json_writer_container        _wi_json_writer_container_t;
+
+
+struct _wi_json_writer {
+    wi_runtime_base_t                           base;
+    
+    wi_runtime_instance_t                       *destination;
+    _wi_json_writer_write_func_t                *write;
+    wi_time_interval_t                          timeout;
+    
+    char                                        *buffer;
+    wi_uinteger_t                               length;
+    
+    _wi_json_writer_container_t                 stack[_WI_JSON_WRITER_MAX_DEPTH];
+    wi_uinteger_t                               depth;
+    wi_boolean_t                                key;
+    wi_uinteger_t                               values;
+    
+    void                                        **keys;
+    wi_uinteger_t                               keys_count;
+    wi_uinteger_t                               keys_capacity;
+    
+    wi_boolean_t                                failed;
+};
+
+
+static void                                     _wi_json_writer_dealloc(wi_runtime_instance_t *);
+
+static wi_integer_t                             _wi_json_writer_write_file(wi_json_writer_t *, const void *, wi_uinteger_t);
+static wi_integer_t                             _wi_json_writer_write_socket(wi_json_writer_t *, const void *, wi_uinteger_t);
+static wi_integer_t                             _wi_json_writer_write_pipe(wi_json_writer_t *, const void *, wi_uinteger_t);
+
+static wi_json_writer_t *                       _wi_json_writer_init_with_destination(wi_json_writer_t *, wi_runtime_instance_t *, _wi_json_writer_write_func_t *);
+static wi_boolean_t                             _wi_json_writer_check(wi_json_writer_t *);
+static wi_boolean_t                             _wi_json_writer_fail(wi_json_writer_t *);
+static wi_boolean_t                             _wi_json_writer_append(wi_json_writer_t *, const char *, wi_uinteger_t);
+static wi_boolean_t                             _wi_json_writer_append_string(wi_json_writer_t *, wi_string_t *);
+static wi_boolean_t                             _wi_json_writer_begin_value(wi_json_writer_t *);
+static wi_boolean_t                             _wi_json_writer_begin_container(wi_json_writer_t *, char);
+static wi_boolean_t                             _wi_json_writer_end_container(wi_json_writer_t *, char);
+static wi_boolean_t                             _wi_json_writer_write_dictionary(wi_json_writer_t *, wi_dictionary_t *);
+static wi_boolean_t                             _wi_json_writer_write_array(wi_json_writer_t *, wi_array_t *);
+
+
+static wi_runtime_id_t                          _wi_json_writer_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t                       _wi_json_writer_runtime_class = {
+    "wi_json_writer_t",
+    _wi_json_writer_dealloc,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+
+void wi_json_writer_register(void) {
+    _wi_json_writer_runtime_id = wi_runtime_register_class(&_wi_json_writer_runtime_class);
+}
+
+
+
+void wi_json_writer_initialize(void) {
+}
+
+
+
+#pragma mark -
+
+wi_runtime_id_t wi_json_writer_runtime_id(void) {
+    return _wi_json_writer_runtime_id;
+}
+
+
+
+#pragma mark -
+
+wi_json_writer_t * wi_json_writer_alloc(void) {
+    return wi_runtime_create_instance(_wi_json_writer_runtime_id, sizeof(wi_json_writer_t));
+}
+
+
+
+wi_json_writer_t * wi_json_writer_init_with_file(wi_json_writer_t *writer, wi_file_t *file) {
+    return _wi_json_writer_init_with_destination(writer, file, _wi_json_writer_write_file);
+}
+
+
+
+wi_json_writer_t * wi_json_writer_init_with_socket(wi_json_writer_t *writer, wi_socket_t *socket, wi_time_interval_t timeout) {
+    writer->timeout = timeout;
+    
+    return _wi_json_writer_init_with_destination(writer, socket, _wi_json_writer_write_socket);
+}
+
+
+
+wi_json_writer_t * wi_json_writer_init_with_pipe(wi_json_writer_t *writer, wi_pipe_t *pipe) {
+    return _wi_json_writer_init_with_destination(writer, pipe, _wi_json_writer_write_pipe);
+}
+
+
+
+static wi_json_writer_t * _wi_json_writer_init_with_destination(wi_json_writer_t *writer, wi_runtime_instance_t *destination, _wi_json_writer_write_func_t *write) {
+    writer->destination     = wi_retain(destination);
+    writer->write           = write;
+    writer->buffer          = wi_malloc(_WI_JSON_WRITER_BUFFER_SIZE);
+    
+    return writer;
+}
+
+
+
+static void _wi_json_writer_dealloc(wi_runtime_instance_t *instance) {
+    wi_json_writer_t    *writer = instance;
+    
+    /* Output of a failed writer may end in the middle of a value */
+    if(!writer->failed)
+        wi_json_writer_flush(writer);
+    
+    wi_release(writer->destination);
+    
+    wi_free(writer->buffer);
+    wi_free(writer->keys);
+}
+
+
+
+#pragma mark -
+
+static wi_integer_t _wi_json_writer_write_file(wi_json_writer_t *writer, const void *buffer, wi_uinteger_t length) {
+    return wi_file_write_bytes(writer->destination, buffer, length);
+}
+
+
+
+static wi_integer_t _wi_json_writer_write_socket(wi_json_writer_t *writer, const void *buffer, wi_uinteger_t length) {
+    return wi_socket_write_bytes(writer->destination, writer->timeout, buffer, length);
+}
+
+
+
+static wi_integer_t _wi_json_writer_write_pipe(wi_json_writer_t *writer, const void *buffer, wi_uinteger_t length) {
+    return wi_pipe_write_bytes(writer->destination, buffer, length);
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_json_writer_begin_object(wi_json_writer_t *writer) {
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    return _wi_json_writer_begin_container(writer, '{');
+}
+
+
+
+wi_boolean_t wi_json_writer_end_object(wi_json_writer_t *writer) {
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    return _wi_json_writer_end_container(writer, '}');
+}
+
+
+
+wi_boolean_t wi_json_writer_begin_array(wi_json_writer_t *writer) {
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    return _wi_json_writer_begin_container(writer, '[');
+}
+
+
+
+wi_boolean_t wi_json_writer_end_array(wi_json_writer_t *writer) {
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    return _wi_json_writer_end_container(writer, ']');
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_json_writer_write_key(wi_json_writer_t *writer, wi_string_t *key) {
+    _wi_json_writer_container_t     *container;
+    
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    WI_ASSERT(writer->depth > 0 && writer->stack[writer->depth - 1].type == '{' && !writer->key,
+              "writer %p is not expecting a key", writer);
+    
+    container = &writer->stack[writer->depth - 1];
+    
+    if(!container->empty && !_wi_json_writer_append(writer, ", ", 2))
+        return false;
+    
+    container->empty = false;
+    writer->key = true;
+    
+    return (_wi_json_writer_append_string(writer, key) && _wi_json_writer_append(writer, ":", 1));
+}
+
+
+
+wi_boolean_t wi_json_writer_write_string(wi_json_writer_t *writer, wi_string_t *string) {
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    return (_wi_json_writer_begin_value(writer) && _wi_json_writer_append_string(writer, string));
+}
+
+
+
+wi_boolean_t wi_json_writer_write_integer(wi_json_writer_t *writer, wi_integer_t integer) {
+    char        buffer[32];
+    int         length;
+    
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    length = snprintf(buffer, sizeof(buffer), "%lld", (long long) integer);
+    
+    return (_wi_json_writer_begin_value(writer) && _wi_json_writer_append(writer, buffer, length));
+}
+
+
+
+wi_boolean_t wi_json_writer_write_double(wi_json_writer_t *writer, double real) {
+    char        buffer[32];
+    int         length;
+    
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    /* JSON has no infinities or NaNs */
+    if(!isfinite(real))
+        return wi_json_writer_write_null(writer);
+    
+    length = snprintf(buffer, sizeof(buffer), "%g", real);
+    
+    return (_wi_json_writer_begin_value(writer) && _wi_json_writer_append(writer, buffer, length));
+}
+
+
+
+wi_boolean_t wi_json_writer_write_bool(wi_json_writer_t *writer, wi_boolean_t value) {
+    if(!_wi_json_writer_check(writer) || !_wi_json_writer_begin_value(writer))
+        return false;
+    
+    return value ? _wi_json_writer_append(writer, "true", 4) : _wi_json_writer_append(writer, "false", 5);
+}
+
+
+
+wi_boolean_t wi_json_writer_write_null(wi_json_writer_t *writer) {
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    return (_wi_json_writer_begin_value(writer) && _wi_json_writer_append(writer, "null", 4));
+}
+
+
+
+wi_boolean_t wi_json_writer_write_instance(wi_json_writer_t *writer, wi_runtime_instance_t *instance) {
+    wi_runtime_id_t     id;
+    
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    id = wi_runtime_id(instance);
+    
+    if(id == wi_dictionary_runtime_id()) {
+        return _wi_json_writer_write_dictionary(writer, instance);
+    }
+    else if(id == wi_array_runtime_id()) {
+        return _wi_json_writer_write_array(writer, instance);
+    }
+    else if(id == wi_string_runtime_id()) {
+        return wi_json_writer_write_string(writer, instance);
+    }
+    else if(id == wi_number_runtime_id()) {
+        if(wi_number_type(instance) == WI_NUMBER_BOOL)
+            return wi_json_writer_write_bool(writer, wi_number_bool(instance));
+        else if(wi_number_type(instance) == WI_NUMBER_FLOAT || wi_number_type(instance) == WI_NUMBER_DOUBLE)
+            return wi_json_writer_write_double(writer, wi_number_double(instance));
+        else
+            return wi_json_writer_write_integer(writer, wi_number_int64(instance));
+    }
+    else if(id == wi_null_runtime_id()) {
+        return wi_json_writer_write_null(writer);
+    }
+    
+    wi_error_set_libwired_error_with_format(WI_ERROR_JSON_WRITEFAILED,
+        WI_STR("Value of class %@ not supported in JSON"),
+        wi_runtime_class_name(instance));
+    
+    return _wi_json_writer_fail(writer);
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_json_writer_flush(wi_json_writer_t *writer) {
+    if(!_wi_json_writer_check(writer))
+        return false;
+    
+    if(writer->length > 0) {
+        if((*writer->write)(writer, writer->buffer, writer->length) < 0)
+            return _wi_json_writer_fail(writer);
+        
+        writer->length = 0;
+    }
+    
+    return true;
+}
+
+
+
+#pragma mark -
+
+static wi_boolean_t _wi_json_writer_check(wi_json_writer_t *writer) {
+    if(writer->failed) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_JSON_WRITEFAILED,
+            WI_STR("Writer has failed"));
+        
+        return false;
+    }
+    
+    return true;
+}
+
+
+
+static wi_boolean_t _wi_json_writer_fail(wi_json_writer_t *writer) {
+    /* The output may end in the middle of a value, so nothing more can be written */
+    writer->failed = true;
+    
+    return false;
+}
+
+
+
+static wi_boolean_t _wi_json_writer_append(wi_json_writer_t *writer, const char *bytes, wi_uinteger_t length) {
+    if(writer->failed)
+        return false;
+    
+    if(writer->length + length > _WI_JSON_WRITER_BUFFER_SIZE) {
+        if(!wi_json_writer_flush(writer))
+            return false;
+        
+        /* Anything that does not fit in the buffer goes straight out */
+        if(length > _WI_JSON_WRITER_BUFFER_SIZE) {
+            if((*writer->write)(writer, bytes, length) < 0)
+                return _wi_json_writer_fail(writer);
+            
+            return true;
+        }
+    }
+    
+    memcpy(writer->buffer + writer->length, bytes, length);
+    
+    writer->length += length;
+    
+    return true;
+}
+
+
+
+static wi_boolean_t _wi_json_writer_append_string(wi_json_writer_t *writer, wi_string_t *string) {
+    const unsigned char     *bytes;
+    const char              *escape;
+    wi_uinteger_t           i, start, length;
+    
+    bytes = (const unsigned char *) wi_string_utf8_string(string);
+    length = wi_string_length(string);
+    
+    if(!_wi_json_writer_append(writer, "\"", 1))
+        return false;
+    
+    /* Runs that need no escaping are copied as they are */
+    for(i = start = 0; i < length; i++) {
+        escape = wi_json_escapes[bytes[i]];
+        
+        if(!escape)
+            continue;
+        
+        if(!_wi_json_writer_append(writer, (const char *) bytes + start, i - start) ||
+           !_wi_json_writer_append(writer, escape, strlen(escape)))
+            return false;
+        
+        start = i + 1;
+    }
+    
+    return (_wi_json_writer_append(writer, (const char *) bytes + start, length - start) && _wi_json_writer_append(writer, "\"", 1));
+}
+
+
+
+static wi_boolean_t _wi_json_writer_begin_value(wi_json_writer_t *writer) {
+    _wi_json_writer_container_t     *container;
+    
+    if(writer->depth == 0) {
+        /* Top level values are written one per line */
+        if(writer->values++ > 0)
+            return _wi_json_writer_append(writer, "\n", 1);
+        
+        return !writer->failed;
+    }
+    
+    container = &writer->stack[writer->depth - 1];
+    
+    if(container->type == '{') {
+        WI_ASSERT(writer->key, "writer %p is expecting a key", writer);
+        
+        writer->key = false;
+        
+        return !writer->failed;
+    }
+    
+    if(!container->empty)
+        return _wi_json_writer_append(writer, ", ", 2);
+    
+    container->empty = false;
+    
+    return !writer->failed;
+}
+
+
+
+static wi_boolean_t _wi_json_writer_begin_container(wi_json_writer_t *writer, char type) {
+    if(writer->depth == _WI_JSON_WRITER_MAX_DEPTH) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_JSON_WRITEFAILED,
+            WI_STR("Nesting too deep"));
+        
+        return _wi_json_writer_fail(writer);
+    }
+    
+    if(!_wi_json_writer_begin_value(writer) || !_wi_json_writer_append(writer, &type, 1))
+        return false;
+    
+    writer->stack[writer->depth].type = type;
+    writer->stack[writer->depth].empty = true;
+    writer->depth++;
+    
+    return true;
+}
+
+
+
+static wi_boolean_t _wi_json_writer_end_container(wi_json_writer_t *writer, char type) {
+    WI_ASSERT(writer->depth > 0 && writer->stack[writer->depth - 1].type == ((type == '}') ? '{' : '[') && !writer->key,
+              "writer %p can not end a container with '%c'", writer, type);
+    
+    writer->depth--;
+    
+    return _wi_json_writer_append(writer, &type, 1);
+}
+
+
+
+static wi_boolean_t _wi_json_writer_write_dictionary(wi_json_writer_t *writer, wi_dictionary_t *dictionary) {
+    void                    *key;
+    wi_uinteger_t           i, offset, count;
+    wi_boolean_t            result;
+    
+    /* Keys are sorted as in wi_json_string_for_instance(), in a scratch stack
+       shared by all levels */
+    offset = writer->keys_count;
+    count = wi_dictionary_count(dictionary);
+    
+    if(offset + count > writer->keys_capacity) {
+        writer->keys_capacity = WI_MAX(offset + count, writer->keys_capacity * 2);
+        writer->keys = wi_realloc(writer->keys, writer->keys_capacity * sizeof(void *));
+    }
+    
+    wi_dictionary_get_keys_and_data(dictionary, writer->keys + offset, NULL);
+    
+    for(i = 0; i < count; i++) {
+        if(wi_runtime_id(writer->keys[offset + i]) != wi_string_runtime_id()) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_JSON_WRITEFAILED,
+                WI_STR("Dictionary keys that are not strings is not supported in JSON"));
+            
+            return _wi_json_writer_fail(writer);
+        }
+    }
+    
+    qsort(writer->keys + offset, count, sizeof(void *), wi_json_compare_keys);
+    
+    if(!wi_json_writer_begin_object(writer))
+        return false;
+    
+    writer->keys_count = offset + count;
+    result = true;
+    
+    for(i = 0; i < count && result; i++) {
+        key = writer->keys[offset + i];
+        result = (wi_json_writer_write_key(writer, key) && wi_json_writer_write_instance(writer, wi_dictionary_data_for_key(dictionary, key)));
+    }
+    
+    writer->keys_count = offset;
+    
+    return (result && wi_json_writer_end_object(writer));
+}
+
+
+
+static wi_boolean_t _wi_json_writer_write_array(wi_json_writer_t *writer, wi_array_t *array) {
+    wi_uinteger_t       i, count;
+    
+    if(!wi_json_writer_begin_array(writer))
+        return false;
+    
+    count = wi_array_count(array);
+    
+    for(i = 0; i < count; i++) {
+        if(!wi_json_writer_write_instance(writer, WI_ARRAY(array, i)))
+            return false;
+    }
+    
+    return wi_json_writer_end_array(writer);
+}
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WI_JSON_WRITER_H
+#define WI_JSON_WRITER_H 1
+
+#include <wired/wi-base.h>
+#include <wired/wi-runtime.h>
+
+WI_EXPORT wi_runtime_id_t                   wi_json_writer_runtime_id(void);
+
+WI_EXPORT wi_json_writer_t *                wi_json_writer_alloc(void);
+WI_EXPORT wi_json_writer_t *                wi_json_writer_init_with_file(wi_json_writer_t *, wi_file_t *);
+WI_EXPORT wi_json_writer_t *                wi_json_writer_init_with_socket(wi_json_writer_t *, wi_socket_t *, wi_time_interval_t);
+WI_EXPORT wi_json_writer_t *                wi_json_writer_init_with_pipe(wi_json_writer_t *, wi_pipe_t *);
+
+WI_EXPORT wi_boolean_t                      wi_json_writer_begin_object(wi_json_writer_t *);
+WI_EXPORT wi_boolean_t                      wi_json_writer_end_object(wi_json_writer_t *);
+WI_EXPORT wi_boolean_t                      wi_json_writer_begin_array(wi_json_writer_t *);
+WI_EXPORT wi_boolean_t                      wi_json_writer_end_array(wi_json_writer_t *);
+
+WI_EXPORT wi_boolean_t                      wi_json_writer_write_key(wi_json_writer_t *, wi_string_t *);
+WI_EXPORT wi_boolean_t                      wi_json_writer_write_string(wi_json_writer_t *, wi_string_t *);
+WI_EXPORT wi_boolean_t                      wi_json_writer_write_integer(wi_json_writer_t *, wi_integer_t);
+WI_EXPORT wi_boolean_t                      wi_json_writer_write_double(wi_json_writer_t *, double);
+WI_EXPORT wi_boolean_t                      wi_json_writer_write_bool(wi_json_writer_t *, wi_boolean_t);
+WI_EXPORT wi_boolean_t                      wi_json_writer_write_null(wi_json_writer_t *);
+WI_EXPORT wi_boolean_t                      wi_json_writer_write_instance(wi_json_writer_t *, wi_runtime_instance_t *);
+
+WI_EXPORT wi_boolean_t                      wi_json_writer_flush(wi_json_writer_t *);
+
+#endif /* WI_JSON_WRITER_H */
@@ -27,8 +27,11 @@
 #include "config.h"
 
 #include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <wired/wi-array.h>
 #include <wired/wi-data.h>
 #include <wired/wi-date.h>
 #include <wired/wi-dictionary.h>
@@ -36,221 +39,87 @@
 #include <wired/wi-macros.h>
 #include <wired/wi-number.h>
 #include <wired/wi-null.h>
+#include <wired/wi-pool.h>
 #include <wired/wi-private.h>
 #include <wired/wi-runtime.h>
 #include <wired/wi-string.h>
 #include <wired/wi-string-encoding.h>
-
-static wi_string_t *                _wi_json_quoted_string_for_string(wi_string_t *, wi_uinteger_t *);
-static wi_string_t *                _wi_json_number_string_for_string(wi_string_t *, wi_boolean_t *);
-static wi_string_t *                _wi_json_boolean_or_null_string_for_string(wi_string_t *);
-
-static wi_string_t *                _wi_json_string_for_dictionary(wi_dictionary_t *);
-static wi_string_t *                _wi_json_string_for_array(wi_array_t *);
-static wi_string_t *                _wi_json_string_for_key_and_value(wi_string_t *, wi_runtime_instance_t *);
-static wi_string_t *                _wi_json_string_for_value(wi_runtime_instance_t *);
-static wi_string_t *                _wi_json_string_for_string(wi_string_t *);
-static wi_string_t *                _wi_json_string_for_number(wi_number_t *);
-static wi_string_t *                _wi_json_string_for_null(wi_null_t *);
+#include <wired/wi-system.h>
+
+#define _WI_JSON_MAX_DEPTH          512
+
+
+struct _wi_json_parser {
+    const char                      *start;
+    const char                      *position;
+    const char                      *end;
+    wi_uinteger_t                   depth;
+    
+    char                            *buffer;
+    wi_uinteger_t                   buffer_size;
+};
+typedef struct _wi_json_parser      _wi_json_parser_t;
+
+
+struct _wi_json_serializer {
+    wi_mutable_string_t             *string;
+    
+    void                            **keys;
+    wi_uinteger_t                   keys_count;
+    wi_uinteger_t                   keys_capacity;
+};
+typedef struct _wi_json_serializer  _wi_json_serializer_t;
+
+
+/* Bytes that have to be escaped in a JSON string, everything else is copied */
+const char * const                  wi_json_escapes[256] = {
+    [0x00] = "\\u0000", [0x01] = "\\u0001", [0x02] = "\\u0002", [0x03] = "\\u0003",
+    [0x04] = "\\u0004", [0x05] = "\\u0005", [0x06] = "\\u0006", [0x07] = "\\u0007",
+    [0x08] = "\\b",    [0x09] = "\\t",    [0x0a] = "\\n",    [0x0b] = "\\u000b",
+    [0x0c] = "\\f",    [0x0d] = "\\r",    [0x0e] = "\\u000e", [0x0f] = "\\u000f",
+    [0x10] = "\\u0010", [0x11] = "\\u0011", [0x12] = "\\u0012", [0x13] = "\\u0013",
+    [0x14] = "\\u0014", [0x15] = "\\u0015", [0x16] = "\\u0016", [0x17] = "\\u0017",
+    [0x18] = "\\u0018", [0x19] = "\\u0019", [0x1a] = "\\u001a", [0x1b] = "\\u001b",
+    [0x1c] = "\\u001c", [0x1d] = "\\u001d", [0x1e] = "\\u001e", [0x1f] = "\\u001f",
+    ['"']  = "\\\"",
+    ['\\'] = "\\\\",
+};
+
+
+static wi_runtime_instance_t *      _wi_json_instance_for_bytes(const char *, wi_uinteger_t);
+static void                         _wi_json_set_error(_wi_json_parser_t *, const char *);
+static void                         _wi_json_skip_whitespace(_wi_json_parser_t *);
+static wi_runtime_instance_t *      _wi_json_parse_value(_wi_json_parser_t *);
+static wi_runtime_instance_t *      _wi_json_parse_object(_wi_json_parser_t *);
+static wi_runtime_instance_t *      _wi_json_parse_array(_wi_json_parser_t *);
+static wi_runtime_instance_t *      _wi_json_parse_string(_wi_json_parser_t *);
+static wi_boolean_t                 _wi_json_parse_hex(const char *, const char *, uint32_t *);
+static wi_uinteger_t                _wi_json_encode_utf8(uint32_t, char *);
+static wi_runtime_instance_t *      _wi_json_parse_number(_wi_json_parser_t *);
+static wi_runtime_instance_t *      _wi_json_parse_literal(_wi_json_parser_t *, const char *, wi_runtime_instance_t *);
+
+static wi_boolean_t                 _wi_json_write_value(_wi_json_serializer_t *, wi_runtime_instance_t *);
+static wi_boolean_t                 _wi_json_write_dictionary(_wi_json_serializer_t *, wi_dictionary_t *);
+static wi_boolean_t                 _wi_json_write_array(_wi_json_serializer_t *, wi_array_t *);
+static void                         _wi_json_write_string(_wi_json_serializer_t *, wi_string_t *);
+static void                         _wi_json_write_number(_wi_json_serializer_t *, wi_number_t *);
 
 
 wi_runtime_instance_t * wi_json_read_instance_from_file(wi_string_t *path) {
-    wi_string_t     *string;
+    wi_data_t       *data;
     
-    string = wi_string_with_utf8_contents_of_file(path);
+    data = wi_data_with_contents_of_file(path);
     
-    return wi_json_instance_for_string(string);
+    if(!data)
+        return NULL;
+    
+    return _wi_json_instance_for_bytes(wi_data_bytes(data), wi_data_length(data));
 }
 
 
 
 wi_runtime_instance_t * wi_json_instance_for_string(wi_string_t *string) {
-    wi_runtime_instance_t   *top_container, *current_container, *current_underlying_container, *container, *current_value;
-    wi_string_t             *substring, *current_key;
-    wi_uinteger_t           i, characters;
-    wi_boolean_t            isfloat;
-    char                    ch;
-    
-    top_container = NULL;
-    current_underlying_container = NULL;
-    current_container = NULL;
-    current_key = NULL;
-    current_value = NULL;
-    
-    for(i = 0; i < wi_string_length(string); i++) {
-        ch = wi_string_character_at_index(string, i);
-        
-        switch(ch) {
-            case '{':
-            case '[':
-                if(ch == '{')
-                    container = wi_mutable_dictionary();
-                else
-                    container = wi_mutable_array();
-                
-                if(current_container) {
-                    if(wi_runtime_id(current_container) == wi_dictionary_runtime_id()) {
-                        if(!current_key) {
-                            wi_error_set_libwired_error_with_format(WI_ERROR_JSON_READFAILED,
-                                WI_STR("Syntax error while reading collection (no key parsed)"));
-                            
-                            return NULL;
-                        }
-                        
-                        wi_mutable_dictionary_set_data_for_key(current_container, container, current_key);
-                        
-                        if(ch == '{')
-                            current_key = NULL;
-                    }
-                    else if(wi_runtime_id(current_container) == wi_array_runtime_id()) {
-                        wi_mutable_array_add_data(current_container, container);
-                    }
-                    
-                    current_underlying_container = current_container;
-                }
-                
-                current_container = container;
-                
-                if(!top_container)
-                    top_container = current_container;
-                break;
-                
-            case '}':
-            case ']':
-                current_container = current_underlying_container;
-                current_key = NULL;
-                break;
-            
-            case '"':
-                substring = _wi_json_quoted_string_for_string(wi_string_substring_from_index(string, i), &characters);
-                
-                if(!substring) {
-                    wi_error_set_libwired_error_with_format(WI_ERROR_JSON_READFAILED,
-                        WI_STR("Syntax error while reading string (no value parsed)"));
-                    
-                    return NULL;
-                }
-                
-                if(!current_key)
-                    current_key = substring;
-                else
-                    current_value = substring;
-                
-                if(current_value) {
-                    if(wi_runtime_id(current_container) == wi_dictionary_runtime_id()) {
-                        if(!current_key) {
-                            wi_error_set_libwired_error_with_format(WI_ERROR_JSON_READFAILED,
-                                WI_STR("Syntax error while reading string (no key parsed)"));
-                            
-                            return NULL;
-                        }
-                        
-                        wi_mutable_dictionary_set_data_for_key(current_container, current_value, current_key);
-                        
-                        current_key = NULL;
-                    }
-                    else if(wi_runtime_id(current_container) == wi_array_runtime_id()) {
-                        wi_mutable_array_add_data(current_container, current_value);
-                    }
-                    
-                    current_value = NULL;
-                }
-                
-                i += characters + 1;
-                break;
-            
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-                substring = _wi_json_number_string_for_string(wi_string_substring_from_index(string, i), &isfloat);
-                
-                if(!substring) {
-                    wi_error_set_libwired_error_with_format(WI_ERROR_JSON_READFAILED,
-                        WI_STR("Syntax error while reading number (no value parsed)"));
-                    
-                    return NULL;
-                }
-                
-                if(isfloat)
-                    current_value = wi_number_with_double(wi_string_double(substring));
-                else
-                    current_value = wi_number_with_integer(wi_string_uinteger(substring));
-                
-                if(current_value) {
-                    if(wi_runtime_id(current_container) == wi_dictionary_runtime_id()) {
-                        if(!current_key) {
-                            wi_error_set_libwired_error_with_format(WI_ERROR_JSON_READFAILED,
-                                WI_STR("Syntax error while reading number (no key parsed)"));
-                            
-                            return NULL;
-                        }
-                        
-                        wi_mutable_dictionary_set_data_for_key(current_container, current_value, current_key);
-                        
-                        current_key = NULL;
-                    }
-                    else if(wi_runtime_id(current_container) == wi_array_runtime_id()) {
-                        wi_mutable_array_add_data(current_container, current_value);
-                    }
-                
-                    current_value = NULL;
-                }
-                
-                i += wi_string_length(substring);
-                break;
-            
-            case 't':
-            case 'f':
-            case 'n':
-                substring = _wi_json_boolean_or_null_string_for_string(wi_string_substring_from_index(string, i));
-                
-                if(!substring) {
-                    wi_error_set_libwired_error_with_format(WI_ERROR_JSON_READFAILED,
-                        WI_STR("Syntax error while reading boolean or null (no value parsed)"));
-                    
-                    return NULL;
-                }
-                
-                if(wi_is_equal(substring, WI_STR("true")))
-                    current_value = wi_number_with_bool(true);
-                else if(wi_is_equal(substring, WI_STR("false")))
-                    current_value = wi_number_with_bool(false);
-                else if(wi_is_equal(substring, WI_STR("null")))
-                    current_value = wi_null();
-                
-                if(current_value) {
-                    if(wi_runtime_id(current_container) == wi_dictionary_runtime_id()) {
-                        if(!current_key) {
-                            wi_error_set_libwired_error_with_format(WI_ERROR_JSON_READFAILED,
-                                WI_STR("Syntax error while reading boolean or null (no key parsed)"));
-                            
-                            return NULL;
-                        }
-                        
-                        wi_mutable_dictionary_set_data_for_key(current_container, current_value, current_key);
-                        
-                        current_key = NULL;
-                    }
-                    else if(wi_runtime_id(current_container) == wi_array_runtime_id()) {
-                        wi_mutable_array_add_data(current_container, current_value);
-                    }
-                    
-                    current_value = NULL;
-                }
-                
-                i += wi_string_length(substring);
-                break;
-        }
-    }
-    
-    return top_container;
+    return _wi_json_instance_for_bytes(wi_string_utf8_string(string), wi_string_length(string));
 }
 
 
@@ -271,228 +140,746 @@ wi_boolean_t wi_json_write_instance_to_path(wi_runtime_instance_t *instance, wi_
 
 
 wi_string_t * wi_json_string_for_instance(wi_runtime_instance_t *instance) {
-    wi_mutable_string_t     *string;
+    _wi_json_serializer_t   serializer;
+    wi_runtime_id_t         id;
+    wi_boolean_t            result = true;
+    
+    memset(&serializer, 0, sizeof(serializer));
+    
+    serializer.string = wi_mutable_string();
+    
+    id = wi_runtime_id(instance);
+    
+    if(id == wi_dictionary_runtime_id() || id == wi_array_runtime_id())
+        result = _wi_json_write_value(&serializer, instance);
     
-    string = wi_mutable_string();
+    wi_free(serializer.keys);
     
-    if(wi_runtime_id(instance) == wi_dictionary_runtime_id())
-        wi_mutable_string_append_string(string, _wi_json_string_for_dictionary(instance));
-    else if(wi_runtime_id(instance) == wi_array_runtime_id())
-        wi_mutable_string_append_string(string, _wi_json_string_for_array(instance));
+    if(!result)
+        return NULL;
     
-    return string;
+    wi_runtime_make_immutable(serializer.string);
+    
+    return serializer.string;
 }
 
 
 
 #pragma mark -
 
-static wi_string_t * _wi_json_quoted_string_for_string(wi_string_t *string, wi_uinteger_t *characters) {
-    wi_mutable_string_t     *quoted_string;
-    wi_uinteger_t           i, skipped;
-    char                    ch;
+static wi_runtime_instance_t * _wi_json_instance_for_bytes(const char *bytes, wi_uinteger_t length) {
+    _wi_json_parser_t           parser;
+    wi_runtime_instance_t       *instance;
+    
+    parser.position     = bytes;
+    parser.start        = bytes;
+    parser.end          = bytes + length;
+    parser.depth        = 0;
+    parser.buffer       = NULL;
+    parser.buffer_size  = 0;
+    
+    instance = _wi_json_parse_value(&parser);
+    
+    if(instance) {
+        _wi_json_skip_whitespace(&parser);
+        
+        if(parser.position < parser.end) {
+            _wi_json_set_error(&parser, "unexpected data after value");
+            
+            wi_release(instance);
+            
+            instance = NULL;
+        }
+    }
     
-    quoted_string = wi_mutable_string();
-    skipped = 0;
+    wi_free(parser.buffer);
     
-    for(i = 1; i < wi_string_length(string); i++) {
-        ch = wi_string_character_at_index(string, i);
+    return wi_autorelease(instance);
+}
+
+
+
+static void _wi_json_set_error(_wi_json_parser_t *parser, const char *reason) {
+    wi_error_set_libwired_error_with_format(WI_ERROR_JSON_READFAILED,
+        WI_STR("Syntax error at offset %lu (%s)"),
+        parser->position - parser->start,
+        reason);
+}
+
+
+
+static void _wi_json_skip_whitespace(_wi_json_parser_t *parser) {
+    while(parser->position < parser->end) {
+        switch(*parser->position) {
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                parser->position++;
+                break;
+            
+            default:
+                return;
+        }
+    }
+}
+
+
+
+static wi_runtime_instance_t * _wi_json_parse_value(_wi_json_parser_t *parser) {
+    _wi_json_skip_whitespace(parser);
+    
+    if(parser->position >= parser->end) {
+        _wi_json_set_error(parser, "unexpected end of data");
         
-        if(ch == '\"') {
+        return NULL;
+    }
+    
+    switch(*parser->position) {
+        case '{':
+            return _wi_json_parse_object(parser);
+        
+        case '[':
+            return _wi_json_parse_array(parser);
+        
+        case '"':
+            return _wi_json_parse_string(parser);
+        
+        case 't':
+            return _wi_json_parse_literal(parser, "true", wi_number_init_with_bool(wi_number_alloc(), true));
+        
+        case 'f':
+            return _wi_json_parse_literal(parser, "false", wi_number_init_with_bool(wi_number_alloc(), false));
+        
+        case 'n':
+            return _wi_json_parse_literal(parser, "null", wi_retain(wi_null()));
+        
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            return _wi_json_parse_number(parser);
+    }
+    
+    _wi_json_set_error(parser, "unexpected character");
+    
+    return NULL;
+}
+
+
+
+static wi_runtime_instance_t * _wi_json_parse_object(_wi_json_parser_t *parser) {
+    wi_mutable_dictionary_t     *dictionary;
+    wi_runtime_instance_t       *key, *value;
+    
+    if(++parser->depth > _WI_JSON_MAX_DEPTH) {
+        _wi_json_set_error(parser, "nesting too deep");
+        
+        return NULL;
+    }
+    
+    dictionary = wi_dictionary_init(wi_mutable_dictionary_alloc());
+    
+    parser->position++;
+    
+    _wi_json_skip_whitespace(parser);
+    
+    if(parser->position < parser->end && *parser->position == '}') {
+        parser->position++;
+        parser->depth--;
+        
+        return dictionary;
+    }
+    
+    while(true) {
+        _wi_json_skip_whitespace(parser);
+        
+        if(parser->position >= parser->end || *parser->position != '"') {
+            _wi_json_set_error(parser, "expected key");
+            
             break;
         }
-        else if(ch == '\\' && i + 1 < wi_string_length(string)) {
-            ch = wi_string_character_at_index(string, ++i);
+        
+        key = _wi_json_parse_string(parser);
+        
+        if(!key)
+            break;
+        
+        _wi_json_skip_whitespace(parser);
+        
+        if(parser->position >= parser->end || *parser->position != ':') {
+            _wi_json_set_error(parser, "expected ':'");
             
-            switch(ch) {
-                case '\"':
-                case '\\':
-                case '/':
-                case 'b':
-                case 'f':
-                case 'r':
-                case 'n':
-                case 't':
-                    wi_mutable_string_append_format(quoted_string, WI_STR("%c"), ch);
-                    break;
-                
-                case 'u':
-                    break;
-                
-                default:
-                    return NULL;
-                    break;
-            }
+            wi_release(key);
+            
+            break;
+        }
+        
+        parser->position++;
+        
+        value = _wi_json_parse_value(parser);
+        
+        if(!value) {
+            wi_release(key);
+            
+            break;
+        }
+        
+        wi_mutable_dictionary_set_data_for_key(dictionary, value, key);
+        
+        wi_release(value);
+        wi_release(key);
+        
+        _wi_json_skip_whitespace(parser);
+        
+        if(parser->position < parser->end && *parser->position == ',') {
+            parser->position++;
             
-            skipped++;
+            continue;
         }
-        else {
-            wi_mutable_string_append_format(quoted_string, WI_STR("%c"), ch);
+        
+        if(parser->position < parser->end && *parser->position == '}') {
+            parser->position++;
+            parser->depth--;
+            
+            return dictionary;
         }
+        
+        _wi_json_set_error(parser, "expected ',' or '}'");
+        
+        break;
     }
     
-    *characters = wi_string_length(quoted_string) + skipped;
+    wi_release(dictionary);
     
-    return quoted_string;
+    return NULL;
 }
 
 
 
-static wi_string_t * _wi_json_number_string_for_string(wi_string_t *string, wi_boolean_t *isfloat) {
-    wi_uinteger_t   i;
-    wi_range_t      range;
-    char            ch;
+static wi_runtime_instance_t * _wi_json_parse_array(_wi_json_parser_t *parser) {
+    wi_mutable_array_t          *array;
+    wi_runtime_instance_t       *value;
     
-    *isfloat = false;
+    if(++parser->depth > _WI_JSON_MAX_DEPTH) {
+        _wi_json_set_error(parser, "nesting too deep");
+        
+        return NULL;
+    }
+    
+    array = wi_array_init(wi_mutable_array_alloc());
+    
+    parser->position++;
     
-    range.location = 0;
+    _wi_json_skip_whitespace(parser);
     
-    for(i = 0; i < wi_string_length(string); i++) {
-        ch = wi_string_character_at_index(string, i);
+    if(parser->position < parser->end && *parser->position == ']') {
+        parser->position++;
+        parser->depth--;
         
-        if(ch == '.')
-            *isfloat = true;
+        return array;
+    }
+    
+    while(true) {
+        value = _wi_json_parse_value(parser);
         
-        if(!isdigit(ch) && ch != '.' && ch != '-') {
-            range.length = i;
-            
+        if(!value)
             break;
+        
+        wi_mutable_array_add_data(array, value);
+        wi_release(value);
+        
+        _wi_json_skip_whitespace(parser);
+        
+        if(parser->position < parser->end && *parser->position == ',') {
+            parser->position++;
+            
+            continue;
+        }
+        
+        if(parser->position < parser->end && *parser->position == ']') {
+            parser->position++;
+            parser->depth--;
+            
+            return array;
         }
+        
+        _wi_json_set_error(parser, "expected ',' or ']'");
+        
+        break;
     }
     
-    return wi_string_substring_with_range(string, range);
+    wi_release(array);
+    
+    return NULL;
 }
 
 
 
-static wi_string_t * _wi_json_boolean_or_null_string_for_string(wi_string_t *string) {
-    wi_range_t  range;
+static wi_runtime_instance_t * _wi_json_parse_string(_wi_json_parser_t *parser) {
+    const char          *start, *p, *next;
+    wi_uinteger_t       length;
+    
+    start = p = parser->position + 1;
     
-    range.location = 0;
+    /* Most strings have no escapes and are copied straight from the input */
+    while(p < parser->end && *p != '"' && *p != '\\')
+        p++;
     
-    if(wi_string_has_prefix(string, WI_STR("t"))) {
-        range.length = 4;
+    if(p >= parser->end) {
+        _wi_json_set_error(parser, "unterminated string");
         
-        if(!wi_is_equal(wi_string_substring_with_range(string, range), WI_STR("true")))
-            return NULL;
+        return NULL;
     }
-    else if(wi_string_has_prefix(string, WI_STR("f"))) {
-        range.length = 5;
+    
+    if(*p == '"') {
+        parser->position = p + 1;
         
-        if(!wi_is_equal(wi_string_substring_with_range(string, range), WI_STR("false")))
-            return NULL;
+        return wi_string_init_with_utf8_bytes(wi_string_alloc(), start, p - start);
+    }
+    
+    /* Unescaping never makes a string longer, so the rest of the input bounds the buffer */
+    if(parser->buffer_size < (wi_uinteger_t) (parser->end - start)) {
+        parser->buffer_size = parser->end - start;
+        parser->buffer = wi_realloc(parser->buffer, parser->buffer_size);
     }
-    else if(wi_string_has_prefix(string, WI_STR("null"))) {
-        range.length = 4;
+    
+    memcpy(parser->buffer, start, p - start);
+    
+    if(!wi_json_unescape_string(p, parser->end, parser->buffer + (p - start), &length, &next)) {
+        parser->position = next;
+        
+        _wi_json_set_error(parser, (next >= parser->end) ? "unterminated string" : "invalid escape");
         
-        if(!wi_is_equal(wi_string_substring_with_range(string, range), WI_STR("null")))
-            return NULL;
+        return NULL;
     }
     
-    return wi_string_substring_with_range(string, range);
+    parser->position = next;
+    
+    return wi_string_init_with_utf8_bytes(wi_string_alloc(), parser->buffer, (p - start) + length);
 }
 
 
 
-#pragma mark -
+static wi_boolean_t _wi_json_parse_hex(const char *p, const char *end, uint32_t *value) {
+    wi_uinteger_t   i;
+    
+    if(end - p < 4)
+        return false;
+    
+    *value = 0;
+    
+    for(i = 0; i < 4; i++) {
+        *value <<= 4;
+        
+        if(p[i] >= '0' && p[i] <= '9')
+            *value |= p[i] - '0';
+        else if(p[i] >= 'a' && p[i] <= 'f')
+            *value |= p[i] - 'a' + 10;
+        else if(p[i] >= 'A' && p[i] <= 'F')
+            *value |= p[i] - 'A' + 10;
+        else
+            return false;
+    }
+    
+    return true;
+}
+
+
+
+static wi_uinteger_t _wi_json_encode_utf8(uint32_t codepoint, char *q) {
+    /* Unpaired surrogates can not be encoded, they become U+FFFD */
+    if(codepoint >= 0xD800 && codepoint <= 0xDFFF)
+        codepoint = 0xFFFD;
+    
+    if(codepoint < 0x80) {
+        q[0] = codepoint;
+        
+        return 1;
+    }
+    else if(codepoint < 0x800) {
+        q[0] = 0xC0 | (codepoint >> 6);
+        q[1] = 0x80 | (codepoint & 0x3F);
+        
+        return 2;
+    }
+    else if(codepoint < 0x10000) {
+        q[0] = 0xE0 | (codepoint >> 12);
+        q[1] = 0x80 | ((codepoint >> 6) & 0x3F);
+        q[2] = 0x80 | (codepoint & 0x3F);
+        
+        return 3;
+    }
+    
+    q[0] = 0xF0 | (codepoint >> 18);
+    q[1] = 0x80 | ((codepoint >> 12) & 0x3F);
+    q[2] = 0x80 | ((codepoint >> 6) & 0x3F);
+    q[3] = 0x80 | (codepoint & 0x3F);
+    
+    return 4;
+}
+
+
 
-static wi_string_t * _wi_json_string_for_dictionary(wi_dictionary_t *dictionary) {
-    wi_mutable_array_t      *strings;
-    wi_array_t              *keys;
-    wi_runtime_instance_t   *key, *value;
-    wi_enumerator_t         *enumerator;
+static wi_runtime_instance_t * _wi_json_parse_number(_wi_json_parser_t *parser) {
+    const char          *next;
+    wi_integer_t        integer;
+    double              real;
+    wi_boolean_t        isfloat;
     
-    strings = wi_mutable_array();
-    keys = wi_array_by_sorting(wi_dictionary_all_keys(dictionary), wi_string_compare);
-    enumerator = wi_array_data_enumerator(keys);
+    if(!wi_json_scan_number(parser->position, parser->end, &next, &integer, &real, &isfloat)) {
+        _wi_json_set_error(parser, "invalid number");
+        
+        return NULL;
+    }
     
-    while((key = wi_enumerator_next_data(enumerator))) {
-        if(wi_runtime_id(key) != wi_string_runtime_id()) {
-            wi_error_set_libwired_error_with_format(WI_ERROR_JSON_WRITEFAILED,
-                WI_STR("Dictionary keys that are not strings is not supported in JSON"));
+    parser->position = next;
+    
+    if(isfloat)
+        return wi_number_init_with_double(wi_number_alloc(), real);
+    
+    return wi_number_init_with_integer(wi_number_alloc(), integer);
+}
+
+
 
-            return NULL;
+static wi_runtime_instance_t * _wi_json_parse_literal(_wi_json_parser_t *parser, const char *literal, wi_runtime_instance_t *instance) {
+    wi_uinteger_t       length;
+    
+    length = strlen(literal);
+    
+    if((wi_uinteger_t) (parser->end - parser->position) < length || memcmp(parser->position, literal, length) != 0) {
+        _wi_json_set_error(parser, "invalid literal");
+        
+        wi_release(instance);
+        
+        return NULL;
+    }
+    
+    parser->position += length;
+    
+    return instance;
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_json_unescape_string(const char *p, const char *end, char *buffer, wi_uinteger_t *length, const char **next) {
+    char                *q;
+    uint32_t            codepoint, low;
+    
+    q = buffer;
+    
+    while(p < end && *p != '"') {
+        if(*p != '\\') {
+            *q++ = *p++;
+            
+            continue;
         }
         
-        value = wi_dictionary_data_for_key(dictionary, key);
+        if(++p >= end)
+            break;
+        
+        switch(*p++) {
+            case '"':   *q++ = '"';     break;
+            case '\\':  *q++ = '\\';    break;
+            case '/':   *q++ = '/';     break;
+            case 'b':   *q++ = '\b';    break;
+            case 'f':   *q++ = '\f';    break;
+            case 'n':   *q++ = '\n';    break;
+            case 'r':   *q++ = '\r';    break;
+            case 't':   *q++ = '\t';    break;
+            
+            case 'u':
+                if(!_wi_json_parse_hex(p, end, &codepoint)) {
+                    *next = p;
+                    
+                    return false;
+                }
+                
+                p += 4;
+                
+                /* Characters outside the basic plane are escaped as surrogate pairs */
+                if(codepoint >= 0xD800 && codepoint <= 0xDBFF && p + 1 < end && p[0] == '\\' && p[1] == 'u' &&
+                   _wi_json_parse_hex(p + 2, end, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                
+                q += _wi_json_encode_utf8(codepoint, q);
+                break;
+            
+            default:
+                *next = p - 1;
+                
+                return false;
+        }
+    }
+    
+    if(p >= end) {
+        *next = end;
         
-        wi_mutable_array_add_data(strings, _wi_json_string_for_key_and_value(key, value));
+        return false;
     }
     
-    return wi_string_with_format(WI_STR("{%@}"), wi_array_components_joined_by_string(strings, WI_STR(", ")));
+    *length = q - buffer;
+    *next = p + 1;
+    
+    return true;
 }
 
 
 
-static wi_string_t * _wi_json_string_for_array(wi_array_t *array) {
-    wi_mutable_array_t      *strings;
-    wi_runtime_instance_t   *value;
-    wi_enumerator_t         *enumerator;
+wi_boolean_t wi_json_scan_number(const char *p, const char *end, const char **next, wi_integer_t *integer, double *real, wi_boolean_t *isfloat) {
+    const char          *start;
+    char                buffer[64], *number;
+    wi_integer_t        value;
+    wi_boolean_t        negative, overflow;
+    
+    start = p;
+    negative = (p < end && *p == '-');
+    overflow = false;
+    value = 0;
+    
+    *isfloat = false;
+    
+    if(negative)
+        p++;
+    
+    if(p >= end || !isdigit((unsigned char) *p))
+        return false;
+    
+    /* Integers are accumulated while scanning, negative so that the minimum fits */
+    while(p < end && isdigit((unsigned char) *p)) {
+        if(value < (WI_INTEGER_MIN + (*p - '0')) / 10)
+            overflow = true;
+        else
+            value = (value * 10) - (*p - '0');
+        
+        p++;
+    }
     
-    strings = wi_mutable_array();
-    enumerator = wi_array_data_enumerator(array);
+    if(p < end && *p == '.') {
+        *isfloat = true;
+        p++;
+        
+        while(p < end && isdigit((unsigned char) *p))
+            p++;
+    }
     
-    while((value = wi_enumerator_next_data(enumerator)))
-        wi_mutable_array_add_data(strings, _wi_json_string_for_value(value));
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        *isfloat = true;
+        p++;
+        
+        if(p < end && (*p == '+' || *p == '-'))
+            p++;
+        
+        while(p < end && isdigit((unsigned char) *p))
+            p++;
+    }
     
-    return wi_string_with_format(WI_STR("[%@]"), wi_array_components_joined_by_string(strings, WI_STR(", ")));
+    *next = p;
+    
+    if(!*isfloat && !overflow && (negative || value != WI_INTEGER_MIN)) {
+        *integer = negative ? value : -value;
+        
+        return true;
+    }
+    
+    /* The input need not be terminated, so strtod() gets a copy */
+    number = (p - start < (wi_integer_t) sizeof(buffer)) ? buffer : wi_malloc(p - start + 1);
+    
+    memcpy(number, start, p - start);
+    number[p - start] = '\0';
+    
+    *real = strtod(number, NULL);
+    *isfloat = true;
+    
+    if(number != buffer)
+        wi_free(number);
+    
+    return true;
 }
 
 
 
-static wi_string_t * _wi_json_string_for_key_and_value(wi_string_t *key, wi_runtime_instance_t *value) {
-    return wi_string_with_format(WI_STR("\"%@\":%@"), key, _wi_json_string_for_value(value));
+int wi_json_compare_keys(const void *p1, const void *p2) {
+    return wi_string_compare(*(void **) p1, *(void **) p2);
 }
 
 
 
-static wi_string_t * _wi_json_string_for_value(wi_runtime_instance_t *value) {
-    if(wi_runtime_id(value) == wi_dictionary_runtime_id())
-        return _wi_json_string_for_dictionary(value);
-    else if(wi_runtime_id(value) == wi_array_runtime_id())
-        return _wi_json_string_for_array(value);
-    else if(wi_runtime_id(value) == wi_string_runtime_id())
-        return _wi_json_string_for_string(value);
-    else if(wi_runtime_id(value) == wi_number_runtime_id())
-        return _wi_json_string_for_number(value);
-    else if(wi_runtime_id(value) == wi_null_runtime_id())
-        return _wi_json_string_for_null(value);
+#pragma mark -
+
+static wi_boolean_t _wi_json_write_value(_wi_json_serializer_t *serializer, wi_runtime_instance_t *value) {
+    wi_runtime_id_t     id;
+    
+    id = wi_runtime_id(value);
+    
+    if(id == wi_dictionary_runtime_id()) {
+        return _wi_json_write_dictionary(serializer, value);
+    }
+    else if(id == wi_array_runtime_id()) {
+        return _wi_json_write_array(serializer, value);
+    }
+    else if(id == wi_string_runtime_id()) {
+        _wi_json_write_string(serializer, value);
+        
+        return true;
+    }
+    else if(id == wi_number_runtime_id()) {
+        _wi_json_write_number(serializer, value);
+        
+        return true;
+    }
+    else if(id == wi_null_runtime_id()) {
+        wi_mutable_string_append_utf8_bytes(serializer->string, "null", 4);
+        
+        return true;
+    }
     
     wi_error_set_libwired_error_with_format(WI_ERROR_JSON_WRITEFAILED,
         WI_STR("Value of class %@ not supported in JSON"),
         wi_runtime_class_name(value));
     
-    return NULL;
+    return false;
+}
+
+
+
+static wi_boolean_t _wi_json_write_dictionary(_wi_json_serializer_t *serializer, wi_dictionary_t *dictionary) {
+    void                *key;
+    wi_uinteger_t       i, offset, count;
+    
+    /* Keys are sorted in a scratch stack shared by all levels, so nested
+       dictionaries do not allocate */
+    offset = serializer->keys_count;
+    count = wi_dictionary_count(dictionary);
+    
+    if(offset + count > serializer->keys_capacity) {
+        serializer->keys_capacity = WI_MAX(offset + count, serializer->keys_capacity * 2);
+        serializer->keys = wi_realloc(serializer->keys, serializer->keys_capacity * sizeof(void *));
+    }
+    
+    wi_dictionary_get_keys_and_data(dictionary, serializer->keys + offset, NULL);
+    
+    for(i = 0; i < count; i++) {
+        if(wi_runtime_id(serializer->keys[offset + i]) != wi_string_runtime_id()) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_JSON_WRITEFAILED,
+                WI_STR("Dictionary keys that are not strings is not supported in JSON"));
+            
+            return false;
+        }
+    }
+    
+    qsort(serializer->keys + offset, count, sizeof(void *), wi_json_compare_keys);
+    
+    serializer->keys_count = offset + count;
+    
+    wi_mutable_string_append_utf8_bytes(serializer->string, "{", 1);
+    
+    for(i = 0; i < count; i++) {
+        key = serializer->keys[offset + i];
+        
+        if(i > 0)
+            wi_mutable_string_append_utf8_bytes(serializer->string, ", ", 2);
+        
+        _wi_json_write_string(serializer, key);
+        
+        wi_mutable_string_append_utf8_bytes(serializer->string, ":", 1);
+        
+        if(!_wi_json_write_value(serializer, wi_dictionary_data_for_key(dictionary, key)))
+            return false;
+    }
+    
+    wi_mutable_string_append_utf8_bytes(serializer->string, "}", 1);
+    
+    serializer->keys_count = offset;
+    
+    return true;
 }
 
 
 
-static wi_string_t * _wi_json_string_for_string(wi_string_t *value) {
-    wi_mutable_string_t     *escaped_string;
+static wi_boolean_t _wi_json_write_array(_wi_json_serializer_t *serializer, wi_array_t *array) {
+    wi_uinteger_t       i, count;
     
-    escaped_string = wi_mutable_copy(value);
+    count = wi_array_count(array);
     
-    wi_mutable_string_replace_string_with_string(escaped_string, WI_STR("\\"), WI_STR("\\\\"), 0);
-    wi_mutable_string_replace_string_with_string(escaped_string, WI_STR("\""), WI_STR("\\\""), 0);
+    wi_mutable_string_append_utf8_bytes(serializer->string, "[", 1);
     
-    return wi_string_with_format(WI_STR("\"%@\""), escaped_string);
+    for(i = 0; i < count; i++) {
+        if(i > 0)
+            wi_mutable_string_append_utf8_bytes(serializer->string, ", ", 2);
+        
+        if(!_wi_json_write_value(serializer, WI_ARRAY(array, i)))
+            return false;
+    }
+    
+    wi_mutable_string_append_utf8_bytes(serializer->string, "]", 1);
+    
+    return true;
 }
 
 
 
-static wi_string_t * _wi_json_string_for_number(wi_number_t *value) {
-    if(wi_number_type(value) == WI_NUMBER_BOOL) {
-        if(wi_number_bool(value))
-            return WI_STR("true");
-        else
-            return WI_STR("false");
-    } else {
-        return wi_number_string(value);
+static void _wi_json_write_string(_wi_json_serializer_t *serializer, wi_string_t *string) {
+    const unsigned char     *bytes;
+    const char              *escape;
+    wi_uinteger_t           i, start, length;
+    
+    bytes = (const unsigned char *) wi_string_utf8_string(string);
+    length = wi_string_length(string);
+    
+    wi_mutable_string_append_utf8_bytes(serializer->string, "\"", 1);
+    
+    /* Runs that need no escaping are copied as they are */
+    for(i = start = 0; i < length; i++) {
+        escape = wi_json_escapes[bytes[i]];
+        
+        if(!escape)
+            continue;
+        
+        wi_mutable_string_append_utf8_bytes(serializer->string, bytes + start, i - start);
+        wi_mutable_string_append_utf8_bytes(serializer->string, escape, strlen(escape));
+        
+        start = i + 1;
     }
+    
+    wi_mutable_string_append_utf8_bytes(serializer->string, bytes + start, length - start);
+    wi_mutable_string_append_utf8_bytes(serializer->string, "\"", 1);
 }
 
 
 
-static wi_string_t * _wi_json_string_for_null(wi_null_t *value) {
-    return WI_STR("null");
+static void _wi_json_write_number(_wi_json_serializer_t *serializer, wi_number_t *number) {
+    wi_number_type_t    type;
+    char                buffer[64];
+    int                 length;
+    
+    type = wi_number_type(number);
+    
+    if(type == WI_NUMBER_BOOL) {
+        if(wi_number_bool(number))
+            wi_mutable_string_append_utf8_bytes(serializer->string, "true", 4);
+        else
+            wi_mutable_string_append_utf8_bytes(serializer->string, "false", 5);
+        
+        return;
+    }
+    
+    if(type == WI_NUMBER_FLOAT || type == WI_NUMBER_DOUBLE)
+        length = snprintf(buffer, sizeof(buffer), "%g", wi_number_double(number));
+    else
+        length = snprintf(buffer, sizeof(buffer), "%lld", (long long) wi_number_int64(number));
+    
+    wi_mutable_string_append_utf8_bytes(serializer->string, buffer, length);
 }
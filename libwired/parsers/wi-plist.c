@@ -32,49 +32,229 @@ int wi_plist_dummy = 0;
 
 #else
 
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include <wired/wi-array.h>
+#include <wired/wi-base64.h>
 #include <wired/wi-data.h>
 #include <wired/wi-date.h>
 #include <wired/wi-dictionary.h>
+#include <wired/wi-file.h>
 #include <wired/wi-macros.h>
 #include <wired/wi-number.h>
 #include <wired/wi-plist.h>
+#include <wired/wi-pool.h>
 #include <wired/wi-private.h>
 #include <wired/wi-runtime.h>
 #include <wired/wi-string.h>
 #include <wired/wi-string-encoding.h>
-#include <wired/wi-xml-parser.h>
+#include <wired/wi-system.h>
 
-static wi_runtime_instance_t *          _wi_plist_instance_for_node(wi_xml_node_t *);
-static wi_runtime_instance_t *          _wi_plist_instance_for_content_node(wi_xml_node_t *);
-static wi_string_t *                    _wi_plist_xml_string_for_instance(wi_runtime_instance_t *, wi_uinteger_t);
-static wi_string_t *                    _wi_plist_xml_string_for_string(wi_string_t *);
+#include <libxml/xmlreader.h>
+
+#define _WI_PLIST_XML_TEXT_CAPACITY             256
+#define _WI_PLIST_XML_DATA_CHUNK_LENGTH         3072
+
+#define _WI_PLIST_BINARY_MAGIC                  "bplist00"
+#define _WI_PLIST_BINARY_MAGIC_LENGTH           8
+#define _WI_PLIST_BINARY_TRAILER_LENGTH         32
+#define _WI_PLIST_BINARY_MAX_DEPTH              512
+
+/* Binary plist dates are relative to 2001-01-01 00:00:00 UTC */
+#define _WI_PLIST_BINARY_EPOCH                  978307200.0
+
+
+enum _wi_plist_xml_element {
+    _WI_PLIST_XML_NONE                  = 0,
+    _WI_PLIST_XML_PLIST,
+    _WI_PLIST_XML_DICT,
+    _WI_PLIST_XML_ARRAY,
+    _WI_PLIST_XML_KEY,
+    _WI_PLIST_XML_STRING,
+    _WI_PLIST_XML_INTEGER,
+    _WI_PLIST_XML_REAL,
+    _WI_PLIST_XML_TRUE,
+    _WI_PLIST_XML_FALSE,
+    _WI_PLIST_XML_DATE,
+    _WI_PLIST_XML_DATA
+};
+typedef enum _wi_plist_xml_element      _wi_plist_xml_element_t;
+
+
+struct _wi_plist_xml_frame {
+    _wi_plist_xml_element_t             element;
+    wi_runtime_instance_t               *instance;
+    wi_string_t                         *key;
+    wi_uinteger_t                       count;
+};
+typedef struct _wi_plist_xml_frame      _wi_plist_xml_frame_t;
+
+
+struct _wi_plist_xml_reader {
+    xmlTextReaderPtr                    reader;
+    
+    _wi_plist_xml_frame_t               *frames;
+    wi_uinteger_t                       frames_count;
+    wi_uinteger_t                       frames_capacity;
+    
+    _wi_plist_xml_element_t             leaf;
+    char                                *text;
+    wi_uinteger_t                       text_length;
+    wi_uinteger_t                       text_capacity;
+    
+    wi_runtime_instance_t               *root;
+};
+typedef struct _wi_plist_xml_reader     _wi_plist_xml_reader_t;
+
+
+struct _wi_plist_serializer {
+    wi_mutable_string_t                 *string;
+    
+    void                                **keys;
+    wi_uinteger_t                       keys_count;
+    wi_uinteger_t                       keys_capacity;
+};
+typedef struct _wi_plist_serializer     _wi_plist_serializer_t;
+
+
+struct _wi_plist_binary_reader {
+    const unsigned char                 *bytes;
+    const unsigned char                 *offsets;
+    wi_uinteger_t                       offset_size;
+    wi_uinteger_t                       ref_size;
+    
+    wi_runtime_instance_t               **objects;
+    wi_uinteger_t                       objects_count;
+    wi_uinteger_t                       depth;
+};
+typedef struct _wi_plist_binary_reader  _wi_plist_binary_reader_t;
+
+
+struct _wi_plist_binary_writer {
+    wi_mutable_data_t                   *data;
+    
+    wi_runtime_instance_t               **objects;
+    wi_uinteger_t                       *objects_refs;
+    wi_uinteger_t                       objects_count;
+    wi_uinteger_t                       objects_capacity;
+    
+    wi_uinteger_t                       *refs;
+    wi_uinteger_t                       refs_count;
+    wi_uinteger_t                       refs_capacity;
+    wi_uinteger_t                       ref_size;
+    
+    void                                **keys;
+    wi_uinteger_t                       keys_count;
+    wi_uinteger_t                       keys_capacity;
+    
+    wi_mutable_dictionary_t             *unique_objects;
+    wi_mutable_dictionary_t             *unique_reals;
+    wi_uinteger_t                       true_index;
+    wi_uinteger_t                       false_index;
+    
+    unsigned char                       *buffer;
+    wi_uinteger_t                       buffer_size;
+};
+typedef struct _wi_plist_binary_writer  _wi_plist_binary_writer_t;
+
+
+static const char * const               _wi_plist_xml_element_names[] = {
+    [_WI_PLIST_XML_NONE]                = "",
+    [_WI_PLIST_XML_PLIST]               = "plist",
+    [_WI_PLIST_XML_DICT]                = "dict",
+    [_WI_PLIST_XML_ARRAY]               = "array",
+    [_WI_PLIST_XML_KEY]                 = "key",
+    [_WI_PLIST_XML_STRING]              = "string",
+    [_WI_PLIST_XML_INTEGER]             = "integer",
+    [_WI_PLIST_XML_REAL]                = "real",
+    [_WI_PLIST_XML_TRUE]                = "true",
+    [_WI_PLIST_XML_FALSE]               = "false",
+    [_WI_PLIST_XML_DATE]                = "date",
+    [_WI_PLIST_XML_DATA]                = "data",
+};
+
+/* Bytes that have to be escaped in XML character data, everything else is copied */
+static const char * const               _wi_plist_xml_escapes[256] = {
+    ['&'] = "&amp;",
+    ['<'] = "&lt;",
+    ['>'] = "&gt;",
+};
+
+
+
+static wi_runtime_instance_t *          _wi_plist_xml_instance_for_bytes(const void *, wi_uinteger_t);
+static wi_boolean_t                     _wi_plist_xml_read_start_element(_wi_plist_xml_reader_t *);
+static wi_boolean_t                     _wi_plist_xml_read_end_element(_wi_plist_xml_reader_t *);
+static void                             _wi_plist_xml_read_text(_wi_plist_xml_reader_t *);
+static wi_runtime_instance_t *          _wi_plist_xml_leaf_instance(_wi_plist_xml_reader_t *);
+static wi_boolean_t                     _wi_plist_xml_is_number_end(const char *);
+static wi_boolean_t                     _wi_plist_xml_is_base64(const char *, wi_uinteger_t);
+static void                             _wi_plist_xml_add_instance(_wi_plist_xml_reader_t *, wi_runtime_instance_t *);
+static void                             _wi_plist_xml_push_frame(_wi_plist_xml_reader_t *, _wi_plist_xml_element_t, wi_runtime_instance_t *);
+static _wi_plist_xml_element_t          _wi_plist_xml_element_for_name(const char *);
+
+static wi_boolean_t                     _wi_plist_xml_write_instance(_wi_plist_serializer_t *, wi_runtime_instance_t *, wi_uinteger_t);
+static void                             _wi_plist_xml_write_indent(_wi_plist_serializer_t *, wi_uinteger_t);
+static void                             _wi_plist_xml_write_element(_wi_plist_serializer_t *, const char *, wi_string_t *);
+static void                             _wi_plist_xml_write_data(_wi_plist_serializer_t *, wi_data_t *);
+static void                             _wi_plist_xml_write_bytes(_wi_plist_serializer_t *, const char *);
+static int                              _wi_plist_compare_keys(const void *, const void *);
+
+static wi_runtime_instance_t *          _wi_plist_binary_instance_for_bytes(const unsigned char *, wi_uinteger_t);
+static wi_runtime_instance_t *          _wi_plist_binary_read_object(_wi_plist_binary_reader_t *, wi_uinteger_t);
+static wi_runtime_instance_t *          _wi_plist_binary_read_container(_wi_plist_binary_reader_t *, unsigned char, const unsigned char *, wi_uinteger_t);
+static wi_boolean_t                     _wi_plist_binary_read_length(const unsigned char **, const unsigned char *, unsigned char, wi_uinteger_t *);
+static wi_string_t *                    _wi_plist_binary_read_utf16_string(const unsigned char *, wi_uinteger_t);
+static uint64_t                         _wi_plist_binary_read_uint(const unsigned char *, wi_uinteger_t);
+
+static wi_data_t *                      _wi_plist_binary_data_for_instance(wi_runtime_instance_t *);
+static wi_boolean_t                     _wi_plist_binary_flatten(_wi_plist_binary_writer_t *, wi_runtime_instance_t *, wi_uinteger_t, wi_uinteger_t *);
+static wi_uinteger_t                    _wi_plist_binary_add_object(_wi_plist_binary_writer_t *, wi_runtime_instance_t *, wi_uinteger_t);
+static void                             _wi_plist_binary_write_object(_wi_plist_binary_writer_t *, wi_uinteger_t);
+static void                             _wi_plist_binary_write_string(_wi_plist_binary_writer_t *, wi_string_t *);
+static void                             _wi_plist_binary_write_marker(_wi_plist_binary_writer_t *, unsigned char, wi_uinteger_t);
+static void                             _wi_plist_binary_write_integer(_wi_plist_binary_writer_t *, int64_t);
+static void                             _wi_plist_binary_write_uint(_wi_plist_binary_writer_t *, uint64_t, wi_uinteger_t);
+static void                             _wi_plist_binary_write_double(_wi_plist_binary_writer_t *, unsigned char, double);
+static wi_uinteger_t                    _wi_plist_binary_uint_size(uint64_t);
 
 
 
 wi_runtime_instance_t * wi_plist_read_instance_from_path(wi_string_t *path) {
-    wi_xml_node_t     *node;
+    wi_file_t       *file;
+    wi_data_t       *data;
+    
+    file = wi_file_for_reading(path);
+    
+    if(!file)
+        return NULL;
     
-    node = wi_xml_parser_read_node_from_path(path);
+    data = wi_file_map(file, 0, 0);
     
-    if(!node)
+    if(!data)
         return NULL;
     
-    return _wi_plist_instance_for_node(node);
+    return wi_plist_instance_for_data(data);
 }
 
 
 
 wi_runtime_instance_t * wi_plist_instance_for_string(wi_string_t *string) {
-    wi_xml_node_t   *node;
-    
-    node = wi_xml_parser_node_from_data(wi_string_utf8_data(string));
-    
-    if(!node)
-        return NULL;
+    return _wi_plist_xml_instance_for_bytes(wi_string_utf8_string(string), wi_string_length(string));
+}
+
+
+
+wi_runtime_instance_t * wi_plist_instance_for_data(wi_data_t *data) {
+    if(wi_data_length(data) >= _WI_PLIST_BINARY_MAGIC_LENGTH && memcmp(wi_data_bytes(data), _WI_PLIST_BINARY_MAGIC, _WI_PLIST_BINARY_MAGIC_LENGTH) == 0)
+        return _wi_plist_binary_instance_for_bytes(wi_data_bytes(data), wi_data_length(data));
     
-    return _wi_plist_instance_for_node(node);
+    return _wi_plist_xml_instance_for_bytes(wi_data_bytes(data), wi_data_length(data));
 }
 
 
@@ -82,283 +262,1495 @@ wi_runtime_instance_t * wi_plist_instance_for_string(wi_string_t *string) {
 #pragma mark -
 
 wi_boolean_t wi_plist_write_instance_to_path(wi_runtime_instance_t *instance, wi_string_t *path) {
+    return wi_plist_write_instance_to_path_with_format(instance, path, WI_PLIST_FORMAT_XML);
+}
+
+
+
+wi_boolean_t wi_plist_write_instance_to_path_with_format(wi_runtime_instance_t *instance, wi_string_t *path, wi_plist_format_t format) {
     wi_string_t     *string;
+    wi_data_t       *data;
     
-    string = wi_plist_string_for_instance(instance);
+    if(format == WI_PLIST_FORMAT_XML) {
+        string = wi_plist_string_for_instance(instance);
+        
+        if(!string)
+            return false;
+        
+        return wi_string_write_utf8_string_to_path(string, path);
+    }
+    
+    data = _wi_plist_binary_data_for_instance(instance);
     
-    if(!string)
+    if(!data)
         return false;
     
-    return wi_string_write_utf8_string_to_path(string, path);
+    return wi_data_write_to_path(data, path);
 }
 
 
 
 wi_string_t * wi_plist_string_for_instance(wi_runtime_instance_t *instance) {
-    wi_mutable_string_t     *string;
+    _wi_plist_serializer_t      serializer;
+    wi_boolean_t                result;
     
-    string = wi_mutable_string();
+    memset(&serializer, 0, sizeof(serializer));
     
-    wi_mutable_string_append_string(string, WI_STR("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"));
-    wi_mutable_string_append_string(string, WI_STR("<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n"));
-    wi_mutable_string_append_string(string, WI_STR("<plist version=\"1.0\">\n"));
-    wi_mutable_string_append_string(string, _wi_plist_xml_string_for_instance(instance, 0));
-    wi_mutable_string_append_string(string, WI_STR("</plist>\n"));
+    serializer.string = wi_mutable_string();
     
-    wi_runtime_make_immutable(string);
+    _wi_plist_xml_write_bytes(&serializer, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    _wi_plist_xml_write_bytes(&serializer, "<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n");
+    _wi_plist_xml_write_bytes(&serializer, "<plist version=\"1.0\">\n");
     
-    return string;
+    result = _wi_plist_xml_write_instance(&serializer, instance, 0);
+    
+    _wi_plist_xml_write_bytes(&serializer, "</plist>\n");
+    
+    wi_free(serializer.keys);
+    
+    if(!result)
+        return NULL;
+    
+    wi_runtime_make_immutable(serializer.string);
+    
+    return serializer.string;
+}
+
+
+
+wi_data_t * wi_plist_data_for_instance(wi_runtime_instance_t *instance, wi_plist_format_t format) {
+    wi_string_t     *string;
+    
+    if(format == WI_PLIST_FORMAT_XML) {
+        string = wi_plist_string_for_instance(instance);
+        
+        if(!string)
+            return NULL;
+        
+        return wi_string_utf8_data(string);
+    }
+    
+    return _wi_plist_binary_data_for_instance(instance);
 }
 
 
 
 #pragma mark -
 
-static wi_runtime_instance_t * _wi_plist_instance_for_node(wi_xml_node_t *node) {
-    wi_runtime_instance_t   *collection;
-    wi_xml_node_t           *collection_node, *content_node;
-    wi_string_t             *element;
-    wi_dictionary_t         *attributes;
-    wi_uinteger_t           i;
+static wi_runtime_instance_t * _wi_plist_xml_instance_for_bytes(const void *bytes, wi_uinteger_t length) {
+    _wi_plist_xml_reader_t      reader;
+    wi_boolean_t                result;
+    int                         status;
     
-    element = wi_xml_node_element(node);
-    attributes = wi_xml_node_attributes(node);
+    memset(&reader, 0, sizeof(reader));
     
-    if(!wi_is_equal(element, WI_STR("plist"))) {
-        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
-                                                WI_STR("Root node \"%@\" is not equal to \"plist\""),
-                                                element);
+    reader.reader = xmlReaderForMemory(bytes, length, NULL, NULL, XML_PARSE_NONET);
+    
+    if(!reader.reader) {
+        wi_error_set_libxml2_error();
         
         return NULL;
     }
     
-    if(!wi_is_equal(wi_dictionary_data_for_key(attributes, WI_STR("version")), WI_STR("1.0"))) {
-        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
-                                                WI_STR("Unsuppported plist version \"%@\""),
-                                                wi_dictionary_data_for_key(attributes, WI_STR("version")));
+    reader.text_capacity = _WI_PLIST_XML_TEXT_CAPACITY;
+    reader.text = wi_malloc(reader.text_capacity);
+    
+    result = true;
+    status = 0;
+    
+    while(result && (status = xmlTextReaderRead(reader.reader)) == 1) {
+        switch(xmlTextReaderNodeType(reader.reader)) {
+            case XML_READER_TYPE_ELEMENT:
+                result = _wi_plist_xml_read_start_element(&reader);
+                break;
+            
+            case XML_READER_TYPE_END_ELEMENT:
+                result = _wi_plist_xml_read_end_element(&reader);
+                break;
+            
+            case XML_READER_TYPE_TEXT:
+            case XML_READER_TYPE_CDATA:
+            case XML_READER_TYPE_WHITESPACE:
+            case XML_READER_TYPE_SIGNIFICANT_WHITESPACE:
+                if(reader.leaf != _WI_PLIST_XML_NONE)
+                    _wi_plist_xml_read_text(&reader);
+                break;
+            
+            default:
+                break;
+        }
+    }
+    
+    if(result && status < 0) {
+        wi_error_set_libxml2_error();
         
-        return NULL;
+        result = false;
     }
     
-    if(wi_xml_node_number_of_children(node) != 1) {
+    if(result && !reader.root) {
         wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
-                                                WI_STR("Root node should have one content node"));
+                                                WI_STR("Document does not contain a \"plist\" node"));
+        
+        result = false;
+    }
+    
+    while(reader.frames_count > 0) {
+        reader.frames_count--;
+        
+        wi_release(reader.frames[reader.frames_count].instance);
+        wi_release(reader.frames[reader.frames_count].key);
+    }
+    
+    xmlFreeTextReader(reader.reader);
+    
+    wi_free(reader.frames);
+    wi_free(reader.text);
+    
+    if(!result) {
+        wi_release(reader.root);
         
         return NULL;
     }
     
-    return _wi_plist_instance_for_content_node(wi_xml_node_child_at_index(node, 0));
+    return wi_autorelease(reader.root);
 }
 
 
 
-static wi_runtime_instance_t * _wi_plist_instance_for_content_node(wi_xml_node_t *node) {
-    wi_runtime_instance_t   *instance, *value;
-    wi_string_t             *element, *key;
-    wi_xml_node_t           *child_node;
-    wi_uinteger_t           i;
+static wi_boolean_t _wi_plist_xml_read_start_element(_wi_plist_xml_reader_t *reader) {
+    _wi_plist_xml_frame_t       *frame;
+    _wi_plist_xml_element_t     element;
+    const char                  *name;
+    xmlChar                     *version;
+    wi_boolean_t                supported;
     
-    element = wi_xml_node_element(node);
-
-    if(wi_is_equal(element, WI_STR("dict"))) {
-        instance = wi_mutable_dictionary();
+    name = (const char *) xmlTextReaderConstName(reader->reader);
+    element = _wi_plist_xml_element_for_name(name);
+    
+    if(reader->frames_count == 0) {
+        if(element != _WI_PLIST_XML_PLIST) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+                                                    WI_STR("Root node \"%s\" is not equal to \"plist\""),
+                                                    name);
+            
+            return false;
+        }
+        
+        version = xmlTextReaderGetAttribute(reader->reader, BAD_CAST "version");
+        supported = (version && strcmp((const char *) version, "1.0") == 0);
         
-        if(wi_xml_node_number_of_children(node) % 2 != 0) {
+        if(!supported) {
             wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
-                                                    WI_STR("Content node \"dict\" must contain an even number of nodes"));
+                                                    WI_STR("Unsupported plist version \"%s\""),
+                                                    version ? (const char *) version : "");
+        }
+        
+        xmlFree(version);
+        
+        if(!supported)
+            return false;
+        
+        _wi_plist_xml_push_frame(reader, element, NULL);
+    } else {
+        if(reader->leaf != _WI_PLIST_XML_NONE) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+                                                    WI_STR("Content node \"%s\" must not contain node \"%s\""),
+                                                    _wi_plist_xml_element_names[reader->leaf],
+                                                    name);
             
-            return NULL;
+            return false;
+        }
+        
+        if(element == _WI_PLIST_XML_NONE || element == _WI_PLIST_XML_PLIST) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+                                                    WI_STR("Content node \"%s\" is not supported"),
+                                                    name);
+            
+            return false;
         }
         
-        for(i = 0; i < wi_xml_node_number_of_children(node); i += 2) {
-            child_node = wi_xml_node_child_at_index(node, i);
+        frame = &reader->frames[reader->frames_count - 1];
+        
+        if(frame->element == _WI_PLIST_XML_PLIST && frame->count > 0) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+                                                    WI_STR("Root node should have one content node"));
             
-            if(!wi_is_equal(wi_xml_node_element(child_node), WI_STR("key"))) {
+            return false;
+        }
+        
+        if(frame->element == _WI_PLIST_XML_DICT) {
+            if(frame->count % 2 == 0 && element != _WI_PLIST_XML_KEY) {
                 wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
-                                                        WI_STR("Content node \"dict\" node \"%@\" is not equal to \"key\""),
-                                                        wi_xml_node_element(child_node));
+                                                        WI_STR("Content node \"dict\" node \"%s\" is not equal to \"key\""),
+                                                        name);
                 
-                return NULL;
+                return false;
             }
-            
-            key = _wi_plist_instance_for_content_node(child_node);
-            
-            if(!key)
-                return NULL;
-            
-            if(wi_string_length(key) == 0) {
+            else if(frame->count % 2 != 0 && element == _WI_PLIST_XML_KEY) {
                 wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
-                                                        WI_STR("Content node \"dict\" node \"key\" must not be empty"),
-                                                        wi_xml_node_element(child_node));
+                                                        WI_STR("Content node \"dict\" node \"%s\" is equal to \"key\""),
+                                                        name);
                 
-                return NULL;
+                return false;
             }
+        }
+        
+        if(element == _WI_PLIST_XML_DICT) {
+            _wi_plist_xml_push_frame(reader, element, wi_dictionary_init(wi_mutable_dictionary_alloc()));
+        }
+        else if(element == _WI_PLIST_XML_ARRAY) {
+            _wi_plist_xml_push_frame(reader, element, wi_array_init(wi_mutable_array_alloc()));
+        }
+        else {
+            reader->leaf = element;
+            reader->text_length = 0;
+            reader->text[0] = '\0';
+        }
+    }
+    
+    if(xmlTextReaderIsEmptyElement(reader->reader))
+        return _wi_plist_xml_read_end_element(reader);
+    
+    return true;
+}
+
 
-            child_node = wi_xml_node_child_at_index(node, i + 1);
+
+static wi_boolean_t _wi_plist_xml_read_end_element(_wi_plist_xml_reader_t *reader) {
+    _wi_plist_xml_frame_t       *frame;
+    wi_runtime_instance_t       *instance;
+    
+    if(reader->leaf != _WI_PLIST_XML_NONE) {
+        instance = _wi_plist_xml_leaf_instance(reader);
+        
+        reader->leaf = _WI_PLIST_XML_NONE;
+        
+        if(!instance)
+            return false;
+        
+        _wi_plist_xml_add_instance(reader, instance);
+        
+        return true;
+    }
+    
+    frame = &reader->frames[reader->frames_count - 1];
+    
+    if(frame->element == _WI_PLIST_XML_PLIST) {
+        if(frame->count != 1) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+                                                    WI_STR("Root node should have one content node"));
             
-            if(wi_is_equal(wi_xml_node_element(child_node), WI_STR("key"))) {
+            return false;
+        }
+        
+        reader->frames_count--;
+        
+        return true;
+    }
+    
+    if(frame->element == _WI_PLIST_XML_DICT && frame->count % 2 != 0) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+                                                WI_STR("Content node \"dict\" must contain an even number of nodes"));
+        
+        return false;
+    }
+    
+    instance = frame->instance;
+    
+    reader->frames_count--;
+    
+    wi_runtime_make_immutable(instance);
+    
+    _wi_plist_xml_add_instance(reader, instance);
+    
+    wi_release(instance);
+    
+    return true;
+}
+
+
+
+static void _wi_plist_xml_read_text(_wi_plist_xml_reader_t *reader) {
+    const char          *value;
+    wi_uinteger_t       length;
+    
+    value = (const char *) xmlTextReaderConstValue(reader->reader);
+    
+    if(!value)
+        return;
+    
+    length = strlen(value);
+    
+    if(reader->text_length + length + 1 > reader->text_capacity) {
+        reader->text_capacity = WI_MAX(reader->text_capacity * 2, reader->text_length + length + 1);
+        reader->text = wi_realloc(reader->text, reader->text_capacity);
+    }
+    
+    memcpy(reader->text + reader->text_length, value, length + 1);
+    
+    reader->text_length += length;
+}
+
+
+
+static wi_runtime_instance_t * _wi_plist_xml_leaf_instance(_wi_plist_xml_reader_t *reader) {
+    wi_runtime_instance_t       *instance;
+    void                        *bytes;
+    char                        *ep;
+    long long                   ll;
+    double                      d;
+    
+    instance = NULL;
+    
+    switch(reader->leaf) {
+        case _WI_PLIST_XML_KEY:
+            if(reader->text_length == 0) {
                 wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
-                                                        WI_STR("Content node \"dict\" node \"%@\" is equal to \"key\""),
-                                                        wi_xml_node_element(child_node));
+                                                        WI_STR("Content node \"dict\" node \"key\" must not be empty"));
                 
                 return NULL;
             }
             
-            value = _wi_plist_instance_for_content_node(child_node);
+            instance = wi_string_with_utf8_bytes(reader->text, reader->text_length);
+            break;
+        
+        case _WI_PLIST_XML_STRING:
+            instance = wi_string_with_utf8_bytes(reader->text, reader->text_length);
+            break;
+        
+        case _WI_PLIST_XML_INTEGER:
+            errno = 0;
+            ll = strtoll(reader->text, &ep, 0);
             
-            if(!value)
-                return NULL;
+            if(reader->text != ep && _wi_plist_xml_is_number_end(ep) && errno != ERANGE)
+                instance = wi_number_with_integer((wi_integer_t) ll);
+            break;
+        
+        case _WI_PLIST_XML_REAL:
+            errno = 0;
+            d = strtod(reader->text, &ep);
             
-            wi_mutable_dictionary_set_data_for_key(instance, value, key);
-        }
+            if(reader->text != ep && _wi_plist_xml_is_number_end(ep) && errno != ERANGE)
+                instance = wi_number_with_double(d);
+            break;
         
-        wi_runtime_make_immutable(instance);
-    }
-    else if(wi_is_equal(element, WI_STR("array"))) {
-        instance = wi_mutable_array();
+        case _WI_PLIST_XML_TRUE:
+            instance = wi_number_with_bool(true);
+            break;
         
-        for(i = 0; i < wi_xml_node_number_of_children(node); i++) {
-            child_node = wi_xml_node_child_at_index(node, i);
-            value = _wi_plist_instance_for_content_node(child_node);
-            
-            wi_mutable_array_add_data(instance, value);
-        }
+        case _WI_PLIST_XML_FALSE:
+            instance = wi_number_with_bool(false);
+            break;
+        
+        case _WI_PLIST_XML_DATE:
+            instance = wi_date_with_rfc3339_string(wi_string_with_utf8_bytes(reader->text, reader->text_length));
+            break;
+        
+        case _WI_PLIST_XML_DATA:
+            /* The decoder skips anything outside the alphabet, so check first */
+            if(_wi_plist_xml_is_base64(reader->text, reader->text_length)) {
+                bytes = wi_malloc(wi_base64_decoded_length(reader->text_length));
+                instance = wi_data_with_bytes_no_copy(bytes, wi_base64_decode(reader->text, reader->text_length, bytes), true);
+            }
+            break;
         
-        wi_runtime_make_immutable(instance);
+        default:
+            break;
     }
-    else if(wi_is_equal(element, WI_STR("key")) || wi_is_equal(element, WI_STR("string"))) {
-        instance = wi_xml_node_text(node);
+    
+    if(!instance) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+                                                WI_STR("Content node \"%s\" has invalid contents \"%s\""),
+                                                _wi_plist_xml_element_names[reader->leaf],
+                                                reader->text);
     }
-    else if(wi_is_equal(element, WI_STR("integer"))) {
-        instance = wi_number_with_integer(wi_string_integer(wi_xml_node_text(node)));
+    
+    return instance;
+}
+
+
+
+static wi_boolean_t _wi_plist_xml_is_number_end(const char *p) {
+    while(isspace((unsigned char) *p))
+        p++;
+    
+    return (*p == '\0');
+}
+
+
+
+static wi_boolean_t _wi_plist_xml_is_base64(const char *text, wi_uinteger_t length) {
+    wi_uinteger_t       i, count, padding;
+    unsigned char       c;
+    
+    /* Whitespace may appear anywhere, padding only at the end */
+    for(i = count = padding = 0; i < length; i++) {
+        c = text[i];
+        
+        if(isspace(c))
+            continue;
+        
+        if(c == '=') {
+            if(++padding > 2)
+                return false;
+        }
+        else if(padding > 0 || !(isalnum(c) || c == '+' || c == '/')) {
+            return false;
+        }
+        
+        count++;
     }
-    else if(wi_is_equal(element, WI_STR("real"))) {
-        instance = wi_number_with_double(wi_string_double(wi_xml_node_text(node)));
+    
+    if(padding > 0)
+        return (count % 4 == 0);
+    
+    return (count % 4 != 1);
+}
+
+
+
+static void _wi_plist_xml_add_instance(_wi_plist_xml_reader_t *reader, wi_runtime_instance_t *instance) {
+    _wi_plist_xml_frame_t       *frame;
+    
+    frame = &reader->frames[reader->frames_count - 1];
+    
+    if(frame->element == _WI_PLIST_XML_PLIST) {
+        reader->root = wi_retain(instance);
     }
-    else if(wi_is_equal(element, WI_STR("true"))) {
-        instance = wi_number_with_bool(true);
+    else if(frame->element == _WI_PLIST_XML_ARRAY) {
+        wi_mutable_array_add_data(frame->instance, instance);
     }
-    else if(wi_is_equal(element, WI_STR("false"))) {
-        instance = wi_number_with_bool(false);
+    else if(frame->count % 2 == 0) {
+        frame->key = wi_retain(instance);
     }
-    else if(wi_is_equal(element, WI_STR("date"))) {
-        instance = wi_date_with_rfc3339_string(wi_xml_node_text(node));
+    else {
+        wi_mutable_dictionary_set_data_for_key(frame->instance, instance, frame->key);
+        wi_release(frame->key);
+        
+        frame->key = NULL;
     }
-    else if(wi_is_equal(element, WI_STR("data"))) {
-        instance = wi_data_with_base64_string(wi_xml_node_text(node));
+    
+    frame->count++;
+}
+
+
+
+static void _wi_plist_xml_push_frame(_wi_plist_xml_reader_t *reader, _wi_plist_xml_element_t element, wi_runtime_instance_t *instance) {
+    _wi_plist_xml_frame_t       *frame;
+    
+    if(reader->frames_count == reader->frames_capacity) {
+        reader->frames_capacity = WI_MAX(reader->frames_capacity * 2, 16);
+        reader->frames = wi_realloc(reader->frames, reader->frames_capacity * sizeof(_wi_plist_xml_frame_t));
     }
-    else {
-        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
-                                                WI_STR("Content node \"%@\" is not supported"),
-                                                element);
+    
+    frame = &reader->frames[reader->frames_count++];
+    frame->element = element;
+    frame->instance = instance;
+    frame->key = NULL;
+    frame->count = 0;
+}
+
+
+
+static _wi_plist_xml_element_t _wi_plist_xml_element_for_name(const char *name) {
+    _wi_plist_xml_element_t     element;
+    
+    /* Every plist element is identified by its length and at most two characters, one comparison confirms it */
+    switch(strlen(name)) {
+        case 3:
+            element = _WI_PLIST_XML_KEY;
+            break;
         
-        return NULL;
+        case 4:
+            if(name[0] == 'd')
+                element = (name[1] == 'i') ? _WI_PLIST_XML_DICT : (name[3] == 'e') ? _WI_PLIST_XML_DATE : _WI_PLIST_XML_DATA;
+            else
+                element = (name[0] == 'r') ? _WI_PLIST_XML_REAL : _WI_PLIST_XML_TRUE;
+            break;
+        
+        case 5:
+            element = (name[0] == 'p') ? _WI_PLIST_XML_PLIST : (name[0] == 'a') ? _WI_PLIST_XML_ARRAY : _WI_PLIST_XML_FALSE;
+            break;
+        
+        case 6:
+            element = _WI_PLIST_XML_STRING;
+            break;
+        
+        case 7:
+            element = _WI_PLIST_XML_INTEGER;
+            break;
+        
+        default:
+            return _WI_PLIST_XML_NONE;
     }
     
-    return instance;
+    if(strcmp(name, _wi_plist_xml_element_names[element]) != 0)
+        return _WI_PLIST_XML_NONE;
+    
+    return element;
 }
 
 
 
-static wi_string_t * _wi_plist_xml_string_for_instance(wi_runtime_instance_t *instance, wi_uinteger_t level) {
-    wi_mutable_string_t     *string;
-    wi_enumerator_t         *enumerator;
-    wi_array_t              *keys;
-    wi_string_t             *key, *value;
+#pragma mark -
+
+static wi_boolean_t _wi_plist_xml_write_instance(_wi_plist_serializer_t *serializer, wi_runtime_instance_t *instance, wi_uinteger_t level) {
+    struct tm               tm;
+    char                    buffer[64];
+    void                    *key;
     wi_runtime_id_t         id;
     wi_number_type_t        type;
-    wi_uinteger_t           i;
+    wi_uinteger_t           i, offset, count;
+    time_t                  time;
     
-    string = wi_mutable_string();
     id = wi_runtime_id(instance);
     
-    for(i = 0; i < level; i++)
-        wi_mutable_string_append_string(string, WI_STR("\t"));
+    _wi_plist_xml_write_indent(serializer, level);
     
     if(id == wi_dictionary_runtime_id()) {
-        if(wi_dictionary_count(instance) == 0) {
-            wi_mutable_string_append_string(string, WI_STR("<dict/>\n"));
+        count = wi_dictionary_count(instance);
+        
+        if(count == 0) {
+            _wi_plist_xml_write_bytes(serializer, "<dict/>\n");
         } else {
-            wi_mutable_string_append_format(string, WI_STR("<dict>\n"));
+            /* Keys are sorted in a scratch stack shared by all levels, so
+               nested dictionaries do not allocate */
+            offset = serializer->keys_count;
+            
+            if(offset + count > serializer->keys_capacity) {
+                serializer->keys_capacity = WI_MAX(offset + count, serializer->keys_capacity * 2);
+                serializer->keys = wi_realloc(serializer->keys, serializer->keys_capacity * sizeof(void *));
+            }
+            
+            wi_dictionary_get_keys_and_data(instance, serializer->keys + offset, NULL);
+            
+            for(i = 0; i < count; i++) {
+                if(wi_runtime_id(serializer->keys[offset + i]) != wi_string_runtime_id()) {
+                    wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_WRITEFAILED,
+                        WI_STR("Dictionary keys that are not strings is not supported in property lists"));
+                    
+                    return false;
+                }
+            }
             
-            keys = wi_array_by_sorting(wi_dictionary_all_keys(instance), wi_string_compare);
-            enumerator = wi_array_data_enumerator(keys);
+            qsort(serializer->keys + offset, count, sizeof(void *), _wi_plist_compare_keys);
             
-            while((key = wi_enumerator_next_data(enumerator))) {
-                value = wi_dictionary_data_for_key(instance, key);
+            serializer->keys_count = offset + count;
+            
+            _wi_plist_xml_write_bytes(serializer, "<dict>\n");
+            
+            for(i = 0; i < count; i++) {
+                key = serializer->keys[offset + i];
                 
-                for(i = 0; i < level + 1; i++)
-                    wi_mutable_string_append_string(string, WI_STR("\t"));
+                _wi_plist_xml_write_indent(serializer, level + 1);
+                _wi_plist_xml_write_element(serializer, "key", key);
                 
-                wi_mutable_string_append_format(string, WI_STR("<key>%@</key>\n"), _wi_plist_xml_string_for_string(key));
-                wi_mutable_string_append_string(string, _wi_plist_xml_string_for_instance(value, level + 1));
+                if(!_wi_plist_xml_write_instance(serializer, wi_dictionary_data_for_key(instance, key), level + 1))
+                    return false;
             }
             
-            for(i = 0; i < level; i++)
-                wi_mutable_string_append_string(string, WI_STR("\t"));
+            serializer->keys_count = offset;
             
-            wi_mutable_string_append_string(string, WI_STR("</dict>\n"));
+            _wi_plist_xml_write_indent(serializer, level);
+            _wi_plist_xml_write_bytes(serializer, "</dict>\n");
         }
     }
     else if(id == wi_array_runtime_id()) {
-        if(wi_array_count(instance) == 0) {
-            wi_mutable_string_append_string(string, WI_STR("<array/>\n"));
+        count = wi_array_count(instance);
+        
+        if(count == 0) {
+            _wi_plist_xml_write_bytes(serializer, "<array/>\n");
         } else {
-            wi_mutable_string_append_format(string, WI_STR("<array>\n"));
-            
-            enumerator = wi_array_data_enumerator(instance);
+            _wi_plist_xml_write_bytes(serializer, "<array>\n");
             
-            while((value = wi_enumerator_next_data(enumerator)))
-                wi_mutable_string_append_string(string, _wi_plist_xml_string_for_instance(value, level + 1));
-            
-            for(i = 0; i < level; i++)
-                wi_mutable_string_append_string(string, WI_STR("\t"));
+            for(i = 0; i < count; i++) {
+                if(!_wi_plist_xml_write_instance(serializer, WI_ARRAY(instance, i), level + 1))
+                    return false;
+            }
             
-            wi_mutable_string_append_string(string, WI_STR("</array>\n"));
+            _wi_plist_xml_write_indent(serializer, level);
+            _wi_plist_xml_write_bytes(serializer, "</array>\n");
         }
     }
     else if(id == wi_string_runtime_id()) {
-        wi_mutable_string_append_format(string, WI_STR("<string>%@</string>\n"), _wi_plist_xml_string_for_string(instance));
+        _wi_plist_xml_write_element(serializer, "string", instance);
     }
     else if(id == wi_number_runtime_id()) {
         type = wi_number_type(instance);
         
         if(type == WI_NUMBER_BOOL) {
             if(wi_number_bool(instance))
-                wi_mutable_string_append_string(string, WI_STR("<true/>\n"));
+                _wi_plist_xml_write_bytes(serializer, "<true/>\n");
             else
-                wi_mutable_string_append_string(string, WI_STR("<false/>\n"));
+                _wi_plist_xml_write_bytes(serializer, "<false/>\n");
         } else {
             if(type == WI_NUMBER_FLOAT || type == WI_NUMBER_DOUBLE)
-                wi_mutable_string_append_format(string, WI_STR("<real>%@</real>\n"), wi_number_string(instance));
+                snprintf(buffer, sizeof(buffer), "<real>%g</real>\n", wi_number_double(instance));
             else
-                wi_mutable_string_append_format(string, WI_STR("<integer>%@</integer>\n"), wi_number_string(instance));
+                snprintf(buffer, sizeof(buffer), "<integer>%lld</integer>\n", (long long) wi_number_int64(instance));
+            
+            _wi_plist_xml_write_bytes(serializer, buffer);
         }
     }
     else if(id == wi_date_runtime_id()) {
-        wi_mutable_string_append_format(string, WI_STR("<date>%@</date>\n"), wi_date_string_with_format(instance, WI_STR("%Y-%m-%dT%H:%M:%SZ")));
+        time = wi_date_time_interval(instance);
+        
+        memset(&tm, 0, sizeof(tm));
+        gmtime_r(&time, &tm);
+        
+        (void) strftime(buffer, sizeof(buffer), "<date>%Y-%m-%dT%H:%M:%SZ</date>\n", &tm);
+        
+        _wi_plist_xml_write_bytes(serializer, buffer);
     }
     else if(id == wi_data_runtime_id()) {
-        wi_mutable_string_append_format(string, WI_STR("<data>%@</data>\n"), wi_data_base64_string(instance));
+        _wi_plist_xml_write_bytes(serializer, "<data>");
+        _wi_plist_xml_write_data(serializer, instance);
+        _wi_plist_xml_write_bytes(serializer, "</data>\n");
     }
     
-    return string;
+    return true;
 }
 
 
 
-static wi_string_t * _wi_plist_xml_string_for_string(wi_string_t *string) {
-    wi_mutable_string_t     *escaped_string;
-    
-    escaped_string = wi_mutable_copy(string);
+static void _wi_plist_xml_write_indent(_wi_plist_serializer_t *serializer, wi_uinteger_t level) {
+    static const char       tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+    wi_uinteger_t           length;
     
-    wi_mutable_string_replace_string_with_string(escaped_string, WI_STR("&"), WI_STR("&amp;"), 0);
-    wi_mutable_string_replace_string_with_string(escaped_string, WI_STR("<"), WI_STR("&lt;"), 0);
-    wi_mutable_string_replace_string_with_string(escaped_string, WI_STR(">"), WI_STR("&gt;"), 0);
-    
-    wi_runtime_make_immutable(escaped_string);
-    
-    return escaped_string;
-}
+    while(level > 0) {
+        length = WI_MIN(level, sizeof(tabs) - 1);
+        
+        wi_mutable_string_append_utf8_bytes(serializer->string, tabs, length);
+        
+        level -= length;
+    }
+}
+
+
+
+static void _wi_plist_xml_write_element(_wi_plist_serializer_t *serializer, const char *name, wi_string_t *string) {
+    const unsigned char     *bytes;
+    const char              *escape;
+    wi_uinteger_t           i, start, length;
+    
+    bytes = (const unsigned char *) wi_string_utf8_string(string);
+    length = wi_string_length(string);
+    
+    _wi_plist_xml_write_bytes(serializer, "<");
+    _wi_plist_xml_write_bytes(serializer, name);
+    _wi_plist_xml_write_bytes(serializer, ">");
+    
+    /* Runs that need no escaping are copied as they are */
+    for(i = start = 0; i < length; i++) {
+        escape = _wi_plist_xml_escapes[bytes[i]];
+        
+        if(!escape)
+            continue;
+        
+        wi_mutable_string_append_utf8_bytes(serializer->string, bytes + start, i - start);
+        
+        _wi_plist_xml_write_bytes(serializer, escape);
+        
+        start = i + 1;
+    }
+    
+    wi_mutable_string_append_utf8_bytes(serializer->string, bytes + start, length - start);
+    
+    _wi_plist_xml_write_bytes(serializer, "</");
+    _wi_plist_xml_write_bytes(serializer, name);
+    _wi_plist_xml_write_bytes(serializer, ">\n");
+}
+
+
+
+static void _wi_plist_xml_write_data(_wi_plist_serializer_t *serializer, wi_data_t *data) {
+    const unsigned char     *bytes;
+    char                    buffer[(_WI_PLIST_XML_DATA_CHUNK_LENGTH / 3) * 4];
+    wi_uinteger_t           position, length, count;
+    
+    bytes = wi_data_bytes(data);
+    length = wi_data_length(data);
+    
+    /* Chunks are a multiple of 3 bytes long, so they encode without padding
+       in between */
+    for(position = 0; position < length; position += count) {
+        count = WI_MIN(length - position, _WI_PLIST_XML_DATA_CHUNK_LENGTH);
+        
+        wi_mutable_string_append_utf8_bytes(serializer->string, buffer, wi_base64_encode(bytes + position, count, buffer));
+    }
+}
+
+
+
+static void _wi_plist_xml_write_bytes(_wi_plist_serializer_t *serializer, const char *bytes) {
+    wi_mutable_string_append_utf8_bytes(serializer->string, bytes, strlen(bytes));
+}
+
+
+
+static int _wi_plist_compare_keys(const void *p1, const void *p2) {
+    return wi_string_compare(*(void **) p1, *(void **) p2);
+}
+
+#pragma mark -
+
+static wi_runtime_instance_t * _wi_plist_binary_instance_for_bytes(const unsigned char *bytes, wi_uinteger_t length) {
+    _wi_plist_binary_reader_t   reader;
+    wi_runtime_instance_t       *instance;
+    const unsigned char         *trailer;
+    uint64_t                    objects_count, top, table;
+    wi_uinteger_t               i;
+    
+    if(length < _WI_PLIST_BINARY_MAGIC_LENGTH + _WI_PLIST_BINARY_TRAILER_LENGTH) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+            WI_STR("Binary property list is too short"));
+        
+        return NULL;
+    }
+    
+    trailer = bytes + length - _WI_PLIST_BINARY_TRAILER_LENGTH;
+    
+    memset(&reader, 0, sizeof(reader));
+    
+    reader.bytes            = bytes;
+    reader.offset_size      = trailer[6];
+    reader.ref_size         = trailer[7];
+    objects_count           = _wi_plist_binary_read_uint(trailer + 8, 8);
+    top                     = _wi_plist_binary_read_uint(trailer + 16, 8);
+    table                   = _wi_plist_binary_read_uint(trailer + 24, 8);
+    
+    /* The offset table has to fit between the objects and the trailer, which
+       also bounds the number of objects by the size of the file */
+    if(reader.offset_size < 1 || reader.offset_size > 8 || reader.ref_size < 1 || reader.ref_size > 8 ||
+       table < _WI_PLIST_BINARY_MAGIC_LENGTH || table > length - _WI_PLIST_BINARY_TRAILER_LENGTH ||
+       objects_count == 0 || objects_count > (length - _WI_PLIST_BINARY_TRAILER_LENGTH - table) / reader.offset_size ||
+       top >= objects_count) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+            WI_STR("Binary property list has an invalid trailer"));
+        
+        return NULL;
+    }
+    
+    reader.offsets          = bytes + table;
+    reader.objects_count    = objects_count;
+    reader.objects          = wi_malloc(reader.objects_count * sizeof(wi_runtime_instance_t *));
+    
+    /* Objects are only decoded when they are first referenced from the top
+       object, and every later reference shares the decoded instance */
+    instance = wi_retain(_wi_plist_binary_read_object(&reader, top));
+    
+    for(i = 0; i < reader.objects_count; i++)
+        wi_release(reader.objects[i]);
+    
+    wi_free(reader.objects);
+    
+    return wi_autorelease(instance);
+}
+
+
+
+static wi_runtime_instance_t * _wi_plist_binary_read_object(_wi_plist_binary_reader_t *reader, wi_uinteger_t index) {
+    wi_runtime_instance_t   *instance = NULL;
+    const unsigned char     *p, *end;
+    uint64_t                offset, value;
+    wi_uinteger_t           length;
+    unsigned char           marker;
+    uint32_t                value32;
+    float                   real32;
+    double                  real;
+    
+    if(reader->objects[index])
+        return reader->objects[index];
+    
+    end = reader->offsets;
+    offset = _wi_plist_binary_read_uint(reader->offsets + (index * reader->offset_size), reader->offset_size);
+    
+    if(offset < _WI_PLIST_BINARY_MAGIC_LENGTH || offset >= (uint64_t) (end - reader->bytes)) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+            WI_STR("Object %lu has an invalid offset"), index);
+        
+        return NULL;
+    }
+    
+    p = reader->bytes + offset;
+    marker = *p++;
+    
+    switch(marker >> 4) {
+        case 0x0:
+            if(marker == 0x08 || marker == 0x09)
+                instance = wi_number_init_with_bool(wi_number_alloc(), (marker == 0x09));
+            break;
+        
+        case 0x1:
+            /* Integers are 2^n bytes, of which only 64 bits can be represented */
+            length = (wi_uinteger_t) 1 << (marker & 0x0F);
+            
+            if(length <= 16 && length <= (wi_uinteger_t) (end - p)) {
+                value = (length == 16) ? _wi_plist_binary_read_uint(p + 8, 8) : _wi_plist_binary_read_uint(p, length);
+                instance = wi_number_init_with_int64(wi_number_alloc(), (int64_t) value);
+            }
+            break;
+        
+        case 0x2:
+            if(marker == 0x22 && end - p >= 4) {
+                value32 = (uint32_t) _wi_plist_binary_read_uint(p, 4);
+                
+                memcpy(&real32, &value32, sizeof(real32));
+                
+                instance = wi_number_init_with_double(wi_number_alloc(), real32);
+            }
+            else if(marker == 0x23 && end - p >= 8) {
+                value = _wi_plist_binary_read_uint(p, 8);
+                
+                memcpy(&real, &value, sizeof(real));
+                
+                instance = wi_number_init_with_double(wi_number_alloc(), real);
+            }
+            break;
+        
+        case 0x3:
+            if(marker == 0x33 && end - p >= 8) {
+                value = _wi_plist_binary_read_uint(p, 8);
+                
+                memcpy(&real, &value, sizeof(real));
+                
+                instance = wi_date_init_with_time_interval(wi_date_alloc(), real + _WI_PLIST_BINARY_EPOCH);
+            }
+            break;
+        
+        case 0x4:
+            if(_wi_plist_binary_read_length(&p, end, marker, &length) && length <= (wi_uinteger_t) (end - p))
+                instance = wi_data_init_with_bytes(wi_data_alloc(), p, length);
+            break;
+        
+        case 0x5:
+            if(_wi_plist_binary_read_length(&p, end, marker, &length) && length <= (wi_uinteger_t) (end - p))
+                instance = wi_string_init_with_utf8_bytes(wi_string_alloc(), p, length);
+            break;
+        
+        case 0x6:
+            if(_wi_plist_binary_read_length(&p, end, marker, &length) && length <= (wi_uinteger_t) (end - p) / 2)
+                instance = wi_retain(_wi_plist_binary_read_utf16_string(p, length));
+            break;
+        
+        case 0x8:
+            /* UIDs are n + 1 bytes, and are read as plain integers */
+            length = (wi_uinteger_t) (marker & 0x0F) + 1;
+            
+            if(length <= 8 && length <= (wi_uinteger_t) (end - p))
+                instance = wi_number_init_with_int64(wi_number_alloc(), (int64_t) _wi_plist_binary_read_uint(p, length));
+            break;
+        
+        case 0xA:
+        case 0xD:
+            if(!_wi_plist_binary_read_length(&p, end, marker, &length))
+                break;
+            
+            if(reader->depth == _WI_PLIST_BINARY_MAX_DEPTH) {
+                /* This also stops containers that reference themselves */
+                wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+                    WI_STR("Object %lu is nested too deep"), index);
+                
+                return NULL;
+            }
+            
+            reader->depth++;
+            instance = _wi_plist_binary_read_container(reader, marker, p, length);
+            reader->depth--;
+            
+            if(!instance)
+                return NULL;
+            break;
+    }
+    
+    if(!instance) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+            WI_STR("Object %lu of type 0x%02x is invalid or not supported"), index, marker);
+        
+        return NULL;
+    }
+    
+    reader->objects[index] = instance;
+    
+    return instance;
+}
+
+
+
+static wi_runtime_instance_t * _wi_plist_binary_read_container(_wi_plist_binary_reader_t *reader, unsigned char marker, const unsigned char *p, wi_uinteger_t count) {
+    wi_runtime_instance_t   *instance, *key, *value;
+    wi_uinteger_t           i, refs;
+    uint64_t                ref;
+    
+    /* Dictionaries have all their key references before the value references */
+    refs = ((marker >> 4) == 0xD) ? 2 : 1;
+    
+    if(count > (wi_uinteger_t) (reader->offsets - p) / reader->ref_size / refs) {
+        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+            WI_STR("Container with %lu objects does not fit in the property list"), count);
+        
+        return NULL;
+    }
+    
+    for(i = 0; i < count * refs; i++) {
+        ref = _wi_plist_binary_read_uint(p + (i * reader->ref_size), reader->ref_size);
+        
+        if(ref >= reader->objects_count) {
+            wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+                WI_STR("Object reference %llu is out of range"), ref);
+            
+            return NULL;
+        }
+    }
+    
+    if(refs == 1) {
+        instance = wi_array_init_with_capacity(wi_mutable_array_alloc(), count);
+        
+        for(i = 0; i < count; i++) {
+            value = _wi_plist_binary_read_object(reader, _wi_plist_binary_read_uint(p + (i * reader->ref_size), reader->ref_size));
+            
+            if(!value) {
+                wi_release(instance);
+                
+                return NULL;
+            }
+            
+            wi_mutable_array_add_data(instance, value);
+        }
+    } else {
+        instance = wi_dictionary_init_with_capacity(wi_mutable_dictionary_alloc(), count);
+        
+        for(i = 0; i < count; i++) {
+            key = _wi_plist_binary_read_object(reader, _wi_plist_binary_read_uint(p + (i * reader->ref_size), reader->ref_size));
+            value = key ? _wi_plist_binary_read_object(reader, _wi_plist_binary_read_uint(p + ((count + i) * reader->ref_size), reader->ref_size)) : NULL;
+            
+            if(!value) {
+                wi_release(instance);
+                
+                return NULL;
+            }
+            
+            if(wi_runtime_id(key) != wi_string_runtime_id()) {
+                wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_READFAILED,
+                    WI_STR("Dictionary key of class %@ is not a string"), wi_runtime_class_name(key));
+                
+                wi_release(instance);
+                
+                return NULL;
+            }
+            
+            wi_mutable_dictionary_set_data_for_key(instance, value, key);
+        }
+    }
+    
+    wi_runtime_make_immutable(instance);
+    
+    return instance;
+}
+
+
+
+static wi_boolean_t _wi_plist_binary_read_length(const unsigned char **p, const unsigned char *end, unsigned char marker, wi_uinteger_t *length) {
+    wi_uinteger_t       size;
+    
+    if((marker & 0x0F) != 0x0F) {
+        *length = marker & 0x0F;
+        
+        return true;
+    }
+    
+    /* Longer lengths follow the marker as an integer object */
+    if(*p >= end || (**p >> 4) != 0x1)
+        return false;
+    
+    size = (wi_uinteger_t) 1 << (**p & 0x0F);
+    
+    if(size > 8 || size > (wi_uinteger_t) (end - *p - 1))
+        return false;
+    
+    *length = _wi_plist_binary_read_uint(*p + 1, size);
+    *p += 1 + size;
+    
+    return true;
+}
+
+
+
+static wi_string_t * _wi_plist_binary_read_utf16_string(const unsigned char *p, wi_uinteger_t count) {
+    wi_string_t     *string;
+    char            *buffer, *q;
+    uint32_t        codepoint, low;
+    wi_uinteger_t   i;
+    
+    buffer = wi_malloc((count * 3) + 1);
+    q = buffer;
+    
+    for(i = 0; i < count; i++) {
+        codepoint = ((uint32_t) p[i * 2] << 8) | p[(i * 2) + 1];
+        
+        if(codepoint >= 0xD800 && codepoint <= 0xDBFF && i + 1 < count) {
+            low = ((uint32_t) p[(i + 1) * 2] << 8) | p[((i + 1) * 2) + 1];
+            
+            if(low >= 0xDC00 && low <= 0xDFFF) {
+                codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+            }
+        }
+        
+        /* Unpaired surrogates can not be represented in UTF-8 */
+        if(codepoint >= 0xD800 && codepoint <= 0xDFFF)
+            codepoint = 0xFFFD;
+        
+        if(codepoint < 0x80) {
+            *q++ = codepoint;
+        }
+        else if(codepoint < 0x800) {
+            *q++ = 0xC0 | (codepoint >> 6);
+            *q++ = 0x80 | (codepoint & 0x3F);
+        }
+        else if(codepoint < 0x10000) {
+            *q++ = 0xE0 | (codepoint >> 12);
+            *q++ = 0x80 | ((codepoint >> 6) & 0x3F);
+            *q++ = 0x80 | (codepoint & 0x3F);
+        }
+        else {
+            *q++ = 0xF0 | (codepoint >> 18);
+            *q++ = 0x80 | ((codepoint >> 12) & 0x3F);
+            *q++ = 0x80 | ((codepoint >> 6) & 0x3F);
+            *q++ = 0x80 | (codepoint & 0x3F);
+        }
+    }
+    
+    string = wi_string_with_utf8_bytes(buffer, q - buffer);
+    
+    wi_free(buffer);
+    
+    return string;
+}
+
+
+
+static uint64_t _wi_plist_binary_read_uint(const unsigned char *p, wi_uinteger_t size) {
+    uint64_t        value = 0;
+    wi_uinteger_t   i;
+    
+    for(i = 0; i < size; i++)
+        value = (value << 8) | p[i];
+    
+    return value;
+}
+
+
+
+#pragma mark -
+
+static wi_data_t * _wi_plist_binary_data_for_instance(wi_runtime_instance_t *instance) {
+    _wi_plist_binary_writer_t       writer;
+    wi_dictionary_key_callbacks_t   key_callbacks;
+    wi_uinteger_t                   *offsets;
+    wi_uinteger_t                   i, index, table, offset_size;
+    wi_boolean_t                    result;
+    
+    memset(&writer, 0, sizeof(writer));
+    
+    /* Uniqued objects are immutable already, so they are retained instead of copied */
+    key_callbacks               = wi_dictionary_default_key_callbacks;
+    key_callbacks.retain        = wi_retain;
+    
+    writer.unique_objects       = wi_dictionary_init_with_capacity_and_callbacks(wi_mutable_dictionary_alloc(), 0, key_callbacks, wi_dictionary_null_value_callbacks);
+    writer.unique_reals         = wi_dictionary_init_with_capacity_and_callbacks(wi_mutable_dictionary_alloc(), 0, key_callbacks, wi_dictionary_null_value_callbacks);
+    writer.true_index           = WI_NOT_FOUND;
+    writer.false_index          = WI_NOT_FOUND;
+    
+    result = _wi_plist_binary_flatten(&writer, instance, 0, &index);
+    
+    wi_release(writer.unique_objects);
+    wi_release(writer.unique_reals);
+    wi_free(writer.keys);
+    
+    if(result) {
+        writer.data         = wi_mutable_data();
+        writer.ref_size     = _wi_plist_binary_uint_size(writer.objects_count - 1);
+        offsets             = wi_malloc(writer.objects_count * sizeof(wi_uinteger_t));
+        
+        wi_mutable_data_append_bytes(writer.data, _WI_PLIST_BINARY_MAGIC, _WI_PLIST_BINARY_MAGIC_LENGTH);
+        
+        for(i = 0; i < writer.objects_count; i++) {
+            offsets[i] = wi_data_length(writer.data);
+            
+            _wi_plist_binary_write_object(&writer, i);
+        }
+        
+        table = wi_data_length(writer.data);
+        offset_size = _wi_plist_binary_uint_size(table);
+        
+        for(i = 0; i < writer.objects_count; i++)
+            _wi_plist_binary_write_uint(&writer, offsets[i], offset_size);
+        
+        wi_free(offsets);
+        
+        _wi_plist_binary_write_uint(&writer, 0, 6);
+        _wi_plist_binary_write_uint(&writer, offset_size, 1);
+        _wi_plist_binary_write_uint(&writer, writer.ref_size, 1);
+        _wi_plist_binary_write_uint(&writer, writer.objects_count, 8);
+        _wi_plist_binary_write_uint(&writer, index, 8);
+        _wi_plist_binary_write_uint(&writer, table, 8);
+        
+        wi_runtime_make_immutable(writer.data);
+    }
+    
+    wi_free(writer.objects);
+    wi_free(writer.objects_refs);
+    wi_free(writer.refs);
+    wi_free(writer.buffer);
+    
+    return writer.data;
+}
+
+
+
+static wi_boolean_t _wi_plist_binary_flatten(_wi_plist_binary_writer_t *writer, wi_runtime_instance_t *instance, wi_uinteger_t depth, wi_uinteger_t *index) {
+    wi_mutable_dictionary_t     *unique;
+    void                        *key, *value;
+    wi_runtime_id_t             id;
+    wi_number_type_t            type;
+    wi_uinteger_t               i, offset, count, refs;
+    
+    id = wi_runtime_id(instance);
+    
+    if((id == wi_dictionary_runtime_id() || id == wi_array_runtime_id()) && depth == _WI_PLIST_BINARY_MAX_DEPTH) {
+        /* Same limit as the reader, this also stops containers that contain themselves */
+        wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_WRITEFAILED,
+            WI_STR("Value is nested too deep"));
+        
+        return false;
+    }
+    
+    if(id == wi_dictionary_runtime_id()) {
+        count = wi_dictionary_count(instance);
+        *index = _wi_plist_binary_add_object(writer, instance, count * 2);
+        
+        /* Keys are sorted in a scratch stack shared by all levels, as in the
+           XML writer, so the output does not depend on hashing */
+        offset = writer->keys_count;
+        
+        if(offset + count > writer->keys_capacity) {
+            writer->keys_capacity = WI_MAX(offset + count, writer->keys_capacity * 2);
+            writer->keys = wi_realloc(writer->keys, writer->keys_capacity * sizeof(void *));
+        }
+        
+        wi_dictionary_get_keys_and_data(instance, writer->keys + offset, NULL);
+        
+        for(i = 0; i < count; i++) {
+            if(wi_runtime_id(writer->keys[offset + i]) != wi_string_runtime_id()) {
+                wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_WRITEFAILED,
+                    WI_STR("Dictionary keys that are not strings is not supported in property lists"));
+                
+                return false;
+            }
+        }
+        
+        qsort(writer->keys + offset, count, sizeof(void *), _wi_plist_compare_keys);
+        
+        writer->keys_count = offset + count;
+        
+        for(i = 0; i < count; i++) {
+            key = writer->keys[offset + i];
+            
+            if(!_wi_plist_binary_flatten(writer, key, depth + 1, &refs))
+                return false;
+            
+            writer->refs[writer->objects_refs[*index] + i] = refs;
+            
+            if(!_wi_plist_binary_flatten(writer, wi_dictionary_data_for_key(instance, key), depth + 1, &refs))
+                return false;
+            
+            writer->refs[writer->objects_refs[*index] + count + i] = refs;
+        }
+        
+        writer->keys_count = offset;
+        
+        return true;
+    }
+    else if(id == wi_array_runtime_id()) {
+        count = wi_array_count(instance);
+        *index = _wi_plist_binary_add_object(writer, instance, count);
+        
+        for(i = 0; i < count; i++) {
+            if(!_wi_plist_binary_flatten(writer, WI_ARRAY(instance, i), depth + 1, &refs))
+                return false;
+            
+            writer->refs[writer->objects_refs[*index] + i] = refs;
+        }
+        
+        return true;
+    }
+    else if(id == wi_string_runtime_id() || id == wi_number_runtime_id() || id == wi_date_runtime_id() || id == wi_data_runtime_id()) {
+        unique = writer->unique_objects;
+        
+        if(id == wi_number_runtime_id()) {
+            type = wi_number_type(instance);
+            
+            if(type == WI_NUMBER_BOOL) {
+                if(wi_number_bool(instance)) {
+                    if(writer->true_index == WI_NOT_FOUND)
+                        writer->true_index = _wi_plist_binary_add_object(writer, instance, 0);
+                    
+                    *index = writer->true_index;
+                } else {
+                    if(writer->false_index == WI_NOT_FOUND)
+                        writer->false_index = _wi_plist_binary_add_object(writer, instance, 0);
+                    
+                    *index = writer->false_index;
+                }
+                
+                return true;
+            }
+            
+            /* Numbers compare equal across types, so reals are uniqued apart
+               from integers */
+            if(type == WI_NUMBER_FLOAT || type == WI_NUMBER_DOUBLE)
+                unique = writer->unique_reals;
+        }
+        
+        value = wi_dictionary_data_for_key(unique, instance);
+        
+        if(value) {
+            *index = (wi_uinteger_t) value - 1;
+        } else {
+            *index = _wi_plist_binary_add_object(writer, instance, 0);
+            
+            wi_mutable_dictionary_set_data_for_key(unique, (void *) (*index + 1), instance);
+        }
+        
+        return true;
+    }
+    
+    wi_error_set_libwired_error_with_format(WI_ERROR_PLIST_WRITEFAILED,
+        WI_STR("Value of class %@ not supported in property lists"),
+        wi_runtime_class_name(instance));
+    
+    return false;
+}
+
+
+
+static wi_uinteger_t _wi_plist_binary_add_object(_wi_plist_binary_writer_t *writer, wi_runtime_instance_t *instance, wi_uinteger_t refs) {
+    if(writer->objects_count == writer->objects_capacity) {
+        writer->objects_capacity = WI_MAX(writer->objects_capacity * 2, 64);
+        writer->objects = wi_realloc(writer->objects, writer->objects_capacity * sizeof(wi_runtime_instance_t *));
+        writer->objects_refs = wi_realloc(writer->objects_refs, writer->objects_capacity * sizeof(wi_uinteger_t));
+    }
+    
+    /* Containers reserve their references now, they are filled in as the
+       children are flattened */
+    if(writer->refs_count + refs > writer->refs_capacity) {
+        writer->refs_capacity = WI_MAX(writer->refs_count + refs, writer->refs_capacity * 2);
+        writer->refs = wi_realloc(writer->refs, writer->refs_capacity * sizeof(wi_uinteger_t));
+    }
+    
+    writer->objects[writer->objects_count] = instance;
+    writer->objects_refs[writer->objects_count] = writer->refs_count;
+    writer->refs_count += refs;
+    
+    return writer->objects_count++;
+}
+
+
+
+static void _wi_plist_binary_write_object(_wi_plist_binary_writer_t *writer, wi_uinteger_t index) {
+    wi_runtime_instance_t   *instance;
+    wi_runtime_id_t         id;
+    wi_number_type_t        type;
+    wi_uinteger_t           i, count, refs;
+    unsigned char           marker;
+    
+    instance = writer->objects[index];
+    id = wi_runtime_id(instance);
+    
+    if(id == wi_dictionary_runtime_id() || id == wi_array_runtime_id()) {
+        if(id == wi_dictionary_runtime_id()) {
+            count = wi_dictionary_count(instance);
+            refs = count * 2;
+            
+            _wi_plist_binary_write_marker(writer, 0xD0, count);
+        } else {
+            count = wi_array_count(instance);
+            refs = count;
+            
+            _wi_plist_binary_write_marker(writer, 0xA0, count);
+        }
+        
+        for(i = 0; i < refs; i++)
+            _wi_plist_binary_write_uint(writer, writer->refs[writer->objects_refs[index] + i], writer->ref_size);
+    }
+    else if(id == wi_string_runtime_id()) {
+        _wi_plist_binary_write_string(writer, instance);
+    }
+    else if(id == wi_number_runtime_id()) {
+        type = wi_number_type(instance);
+        
+        if(type == WI_NUMBER_BOOL) {
+            marker = wi_number_bool(instance) ? 0x09 : 0x08;
+            
+            wi_mutable_data_append_bytes(writer->data, &marker, 1);
+        }
+        else if(type == WI_NUMBER_FLOAT || type == WI_NUMBER_DOUBLE) {
+            _wi_plist_binary_write_double(writer, 0x23, wi_number_double(instance));
+        }
+        else {
+            _wi_plist_binary_write_integer(writer, wi_number_int64(instance));
+        }
+    }
+    else if(id == wi_date_runtime_id()) {
+        _wi_plist_binary_write_double(writer, 0x33, wi_date_time_interval(instance) - _WI_PLIST_BINARY_EPOCH);
+    }
+    else if(id == wi_data_runtime_id()) {
+        _wi_plist_binary_write_marker(writer, 0x40, wi_data_length(instance));
+        
+        wi_mutable_data_append_bytes(writer->data, wi_data_bytes(instance), wi_data_length(instance));
+    }
+}
+
+
+
+static void _wi_plist_binary_write_string(_wi_plist_binary_writer_t *writer, wi_string_t *string) {
+    const unsigned char     *bytes;
+    unsigned char           *q;
+    uint32_t                codepoint;
+    wi_uinteger_t           i, length;
+    
+    bytes = (const unsigned char *) wi_string_utf8_string(string);
+    length = wi_string_length(string);
+    
+    for(i = 0; i < length; i++) {
+        if(bytes[i] >= 0x80)
+            break;
+    }
+    
+    if(i == length) {
+        _wi_plist_binary_write_marker(writer, 0x50, length);
+        
+        wi_mutable_data_append_bytes(writer->data, bytes, length);
+        
+        return;
+    }
+    
+    /* Anything that is not ASCII is written as UTF-16, which never needs
+       more than two bytes per byte of UTF-8 */
+    if(writer->buffer_size < length * 2) {
+        writer->buffer_size = length * 2;
+        writer->buffer = wi_realloc(writer->buffer, writer->buffer_size);
+    }
+    
+    q = writer->buffer;
+    
+    for(i = 0; i < length; ) {
+        if(bytes[i] < 0x80) {
+            codepoint = bytes[i];
+            i += 1;
+        }
+        else if(bytes[i] < 0xE0 && i + 1 < length) {
+            codepoint = ((bytes[i] & 0x1F) << 6) | (bytes[i + 1] & 0x3F);
+            i += 2;
+        }
+        else if(bytes[i] < 0xF0 && i + 2 < length) {
+            codepoint = ((bytes[i] & 0x0F) << 12) | ((bytes[i + 1] & 0x3F) << 6) | (bytes[i + 2] & 0x3F);
+            i += 3;
+        }
+        else if(i + 3 < length) {
+            codepoint = ((bytes[i] & 0x07) << 18) | ((bytes[i + 1] & 0x3F) << 12) | ((bytes[i + 2] & 0x3F) << 6) | (bytes[i + 3] & 0x3F);
+            i += 4;
+        }
+        else {
+            codepoint = 0xFFFD;
+            i = length;
+        }
+        
+        if(codepoint >= 0x10000) {
+            codepoint -= 0x10000;
+            
+            *q++ = (0xD800 | (codepoint >> 10)) >> 8;
+            *q++ = (0xD800 | (codepoint >> 10)) & 0xFF;
+            *q++ = (0xDC00 | (codepoint & 0x3FF)) >> 8;
+            *q++ = (0xDC00 | (codepoint & 0x3FF)) & 0xFF;
+        } else {
+            *q++ = codepoint >> 8;
+            *q++ = codepoint & 0xFF;
+        }
+    }
+    
+    _wi_plist_binary_write_marker(writer, 0x60, (q - writer->buffer) / 2);
+    
+    wi_mutable_data_append_bytes(writer->data, writer->buffer, q - writer->buffer);
+}
+
+
+
+static void _wi_plist_binary_write_marker(_wi_plist_binary_writer_t *writer, unsigned char type, wi_uinteger_t length) {
+    unsigned char       marker;
+    
+    marker = type | ((length < 0x0F) ? length : 0x0F);
+    
+    wi_mutable_data_append_bytes(writer->data, &marker, 1);
+    
+    if(length >= 0x0F)
+        _wi_plist_binary_write_integer(writer, length);
+}
+
+
+
+static void _wi_plist_binary_write_integer(_wi_plist_binary_writer_t *writer, int64_t value) {
+    unsigned char       marker;
+    wi_uinteger_t       size;
+    
+    /* Negative integers are always written as 8 bytes */
+    size = (value < 0) ? 8 : _wi_plist_binary_uint_size(value);
+    marker = 0x10 | ((size == 1) ? 0 : (size == 2) ? 1 : (size == 4) ? 2 : 3);
+    
+    wi_mutable_data_append_bytes(writer->data, &marker, 1);
+    
+    _wi_plist_binary_write_uint(writer, (uint64_t) value, size);
+}
+
+
+
+static void _wi_plist_binary_write_uint(_wi_plist_binary_writer_t *writer, uint64_t value, wi_uinteger_t size) {
+    unsigned char       buffer[8];
+    wi_uinteger_t       i;
+    
+    for(i = size; i > 0; i--) {
+        buffer[i - 1] = value & 0xFF;
+        value >>= 8;
+    }
+    
+    wi_mutable_data_append_bytes(writer->data, buffer, size);
+}
+
+
+
+static void _wi_plist_binary_write_double(_wi_plist_binary_writer_t *writer, unsigned char marker, double real) {
+    uint64_t        value;
+    
+    memcpy(&value, &real, sizeof(value));
+    
+    wi_mutable_data_append_bytes(writer->data, &marker, 1);
+    
+    _wi_plist_binary_write_uint(writer, value, 8);
+}
+
+
+
+static wi_uinteger_t _wi_plist_binary_uint_size(uint64_t value) {
+    if(value <= 0xFF)
+        return 1;
+    else if(value <= 0xFFFF)
+        return 2;
+    else if(value <= 0xFFFFFFFFULL)
+        return 4;
+    
+    return 8;
+}
+
 
 #endif
@@ -30,10 +30,20 @@
 #include <wired/wi-base.h>
 #include <wired/wi-runtime.h>
 
+enum _wi_plist_format {
+    WI_PLIST_FORMAT_XML,
+    WI_PLIST_FORMAT_BINARY
+};
+typedef enum _wi_plist_format           wi_plist_format_t;
+
+
 WI_EXPORT wi_runtime_instance_t *       wi_plist_read_instance_from_path(wi_string_t *);
 WI_EXPORT wi_runtime_instance_t *       wi_plist_instance_for_string(wi_string_t *);
+WI_EXPORT wi_runtime_instance_t *       wi_plist_instance_for_data(wi_data_t *);
 
 WI_EXPORT wi_boolean_t                  wi_plist_write_instance_to_path(wi_runtime_instance_t *, wi_string_t *);
+WI_EXPORT wi_boolean_t                  wi_plist_write_instance_to_path_with_format(wi_runtime_instance_t *, wi_string_t *, wi_plist_format_t);
 WI_EXPORT wi_string_t *                 wi_plist_string_for_instance(wi_runtime_instance_t *);
+WI_EXPORT wi_data_t *                   wi_plist_data_for_instance(wi_runtime_instance_t *, wi_plist_format_t);
 
 #endif /* WI_PLIST_H */
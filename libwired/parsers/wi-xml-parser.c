@@ -34,16 +34,16 @@ int wi_xml_dummy = 0;
 
 #include <string.h>
 
+#include <wired/wi-array.h>
 #include <wired/wi-data.h>
-#include <wired/wi-date.h>
 #include <wired/wi-dictionary.h>
+#include <wired/wi-fast-lock.h>
 #include <wired/wi-macros.h>
-#include <wired/wi-number.h>
 #include <wired/wi-pool.h>
 #include <wired/wi-private.h>
 #include <wired/wi-runtime.h>
 #include <wired/wi-string.h>
-#include <wired/wi-string-encoding.h>
+#include <wired/wi-system.h>
 #include <wired/wi-xml-parser.h>
 
 #include <libxml/tree.h>
@@ -51,24 +51,54 @@ int wi_xml_dummy = 0;
 #include <libxml/xmlerror.h>
 #include <libxml/xpath.h>
 
+
+/* Nodes share one document, which owns the libxml2 tree. It is a plain
+   record rather than a runtime instance, and every node that points into
+   the tree holds a reference to it. */
+struct _wi_xml_document {
+    xmlDocPtr                           doc;
+    volatile wi_uinteger_t              references;
+    
+    wi_fast_lock_t                      lock;
+    wi_mutable_dictionary_t             *names;
+};
+typedef struct _wi_xml_document         _wi_xml_document_t;
+
+
+/* The lazy fields are filled in under the document lock and published with
+   release stores, so readers that see them set with an acquire load do not
+   need the lock. */
 struct _wi_xml_node {
     wi_runtime_base_t                   base;
     
+    _wi_xml_document_t                  *document;
+    xmlNodePtr                          node;
+    
     wi_string_t                         *element;
+    wi_boolean_t                        text_loaded;
     wi_string_t                         *text;
-    wi_mutable_dictionary_t             *attributes;
-    wi_mutable_array_t                  *children;
+    wi_dictionary_t                     *attributes;
+    wi_array_t                          *children;
 };
 
 
-static wi_boolean_t                     _wi_xml_parser_parse_node(wi_xml_node_t *, xmlNodePtr);
-static wi_string_t *                    _wi_xml_parser_string_from_chars(const xmlChar *);
+static wi_xml_node_t *                  _wi_xml_parser_node_for_doc(xmlDocPtr);
+
+static _wi_xml_document_t *             _wi_xml_document_create(xmlDocPtr);
+static _wi_xml_document_t *             _wi_xml_document_retain(_wi_xml_document_t *);
+static void                             _wi_xml_document_release(_wi_xml_document_t *);
+static wi_string_t *                    _wi_xml_document_string_for_name(_wi_xml_document_t *, const xmlChar *);
 
 static wi_xml_node_t *                  _wi_xml_node_alloc(void);
-static wi_xml_node_t *                  _wi_xml_node_init(wi_xml_node_t *);
+static wi_xml_node_t *                  _wi_xml_node_init_with_node(wi_xml_node_t *, _wi_xml_document_t *, xmlNodePtr);
 static void                             _wi_xml_node_dealloc(wi_runtime_instance_t *);
 static wi_string_t *                    _wi_xml_node_description(wi_runtime_instance_t *);
 
+static void                             _wi_xml_node_load_text(wi_xml_node_t *);
+static void                             _wi_xml_node_load_attributes(wi_xml_node_t *);
+static void                             _wi_xml_node_load_children(wi_xml_node_t *);
+static xmlXPathObjectPtr                _wi_xml_node_evaluate_xpath(wi_xml_node_t *, wi_string_t *);
+
 
 static wi_runtime_id_t                  _wi_xml_node_runtime_id = WI_RUNTIME_ID_NULL;
 static wi_runtime_class_t               _wi_xml_node_runtime_class = {
@@ -96,9 +126,7 @@ void wi_xml_node_initialize(void) {
 #pragma mark -
 
 wi_xml_node_t * wi_xml_parser_read_node_from_path(wi_string_t *path) {
-    wi_xml_node_t   *xml_node;
     xmlDocPtr       doc;
-    xmlNodePtr      node;
     
     doc = xmlReadFile(wi_string_utf8_string(path), NULL, 0);
     
@@ -108,24 +136,13 @@ wi_xml_node_t * wi_xml_parser_read_node_from_path(wi_string_t *path) {
         return NULL;
     }
     
-    node = xmlDocGetRootElement(doc);
-    xml_node = _wi_xml_node_init(_wi_xml_node_alloc());
-    
-    if(!_wi_xml_parser_parse_node(xml_node, node)) {
-        xmlFreeDoc(doc);
-        
-        return NULL;
-    }
-    
-    return wi_autorelease(xml_node);
+    return _wi_xml_parser_node_for_doc(doc);
 }
 
 
 
 wi_xml_node_t * wi_xml_parser_node_from_data(wi_data_t *data) {
-    wi_xml_node_t   *xml_node;
     xmlDocPtr       doc;
-    xmlNodePtr      node;
     
     doc = xmlReadMemory(wi_data_bytes(data), wi_data_length(data), NULL, NULL, 0);
     
@@ -135,70 +152,78 @@ wi_xml_node_t * wi_xml_parser_node_from_data(wi_data_t *data) {
         return NULL;
     }
     
-    node = xmlDocGetRootElement(doc);
-    xml_node = _wi_xml_node_init(_wi_xml_node_alloc());
+    return _wi_xml_parser_node_for_doc(doc);
+}
+
+
+
+static wi_xml_node_t * _wi_xml_parser_node_for_doc(xmlDocPtr doc) {
+    _wi_xml_document_t  *document;
+    wi_xml_node_t       *xml_node;
     
-    if(!_wi_xml_parser_parse_node(xml_node, node)) {
-        xmlFreeDoc(doc);
-        
-        return NULL;
-    }
+    document = _wi_xml_document_create(doc);
+    xml_node = _wi_xml_node_init_with_node(_wi_xml_node_alloc(), document, xmlDocGetRootElement(doc));
+    
+    _wi_xml_document_release(document);
     
     return wi_autorelease(xml_node);
 }
 
 
 
-static wi_boolean_t _wi_xml_parser_parse_node(wi_xml_node_t *xml_node, xmlNodePtr node) {
-    wi_xml_node_t   *child_xml_node;
-    wi_string_t     *string;
-    xmlNodePtr      child_node;
-    xmlAttr         *attribute;
-    xmlChar         *value;
+#pragma mark -
+
+static _wi_xml_document_t * _wi_xml_document_create(xmlDocPtr doc) {
+    _wi_xml_document_t  *document;
     
-    xml_node->element = wi_retain(_wi_xml_parser_string_from_chars(node->name));
+    document = wi_malloc(sizeof(_wi_xml_document_t));
+    document->doc           = doc;
+    document->references    = 1;
+    document->lock          = (wi_fast_lock_t) WI_FAST_LOCK_INITIALIZER;
+    document->names         = wi_dictionary_init_with_capacity_and_callbacks(wi_mutable_dictionary_alloc(), 0,
+        wi_dictionary_null_key_callbacks, wi_dictionary_default_value_callbacks);
     
-    value = xmlNodeListGetString(node->doc, node->children, 1);
+    return document;
+}
+
+
+
+static _wi_xml_document_t * _wi_xml_document_retain(_wi_xml_document_t *document) {
+    __sync_add_and_fetch(&document->references, 1);
     
-    if(value) {
-        string = _wi_xml_parser_string_from_chars(value);
-        
-        if(wi_string_length(wi_string_by_deleting_surrounding_whitespace(string)) > 0)
-            xml_node->text = wi_retain(string);
-        
-        xmlFree(value);
-    }
+    return document;
+}
+
+
+
+static void _wi_xml_document_release(_wi_xml_document_t *document) {
+    if(__sync_sub_and_fetch(&document->references, 1) > 0)
+        return;
     
-    for(attribute = node->properties; attribute != NULL; attribute = attribute->next) {
-        value = xmlNodeListGetString(attribute->doc, attribute->children, 1);
-        
-        if(value) {
-            wi_mutable_dictionary_set_data_for_key(xml_node->attributes,
-                                                   _wi_xml_parser_string_from_chars(value),
-                                                   _wi_xml_parser_string_from_chars(attribute->name));
-            
-            xmlFree(value);
-        }
-    }
+    wi_release(document->names);
     
-    for(child_node = node->children; child_node != NULL; child_node = child_node->next) {
-        if(child_node->type == XML_ELEMENT_NODE) {
-            child_xml_node = wi_autorelease(_wi_xml_node_init(_wi_xml_node_alloc()));
-            
-            if(!_wi_xml_parser_parse_node(child_xml_node, child_node))
-                return false;
-            
-            wi_mutable_array_add_data(xml_node->children, child_xml_node);
-        }
-    }
+    xmlFreeDoc(document->doc);
     
-    return true;
+    wi_free(document);
 }
 
 
 
-static wi_string_t * _wi_xml_parser_string_from_chars(const xmlChar *chars) {
-    return wi_string_with_utf8_string((const char *) chars);
+static wi_string_t * _wi_xml_document_string_for_name(_wi_xml_document_t *document, const xmlChar *name) {
+    wi_string_t     *string;
+    
+    /* libxml2 keeps names in a per document dictionary, so the pointer itself
+       identifies the name. Must be called with the document locked. */
+    string = wi_dictionary_data_for_key(document->names, (void *) name);
+    
+    if(!string) {
+        string = wi_string_init_with_utf8_string(wi_string_alloc(), (const char *) name);
+        
+        wi_mutable_dictionary_set_data_for_key(document->names, string, (void *) name);
+        wi_release(string);
+    }
+    
+    return string;
 }
 
 
@@ -219,9 +244,9 @@ static wi_xml_node_t * _wi_xml_node_alloc(void) {
 
 
 
-static wi_xml_node_t * _wi_xml_node_init(wi_xml_node_t *xml_node) {
-    xml_node->attributes = wi_dictionary_init(wi_mutable_dictionary_alloc());
-    xml_node->children = wi_array_init(wi_mutable_array_alloc());
+static wi_xml_node_t * _wi_xml_node_init_with_node(wi_xml_node_t *xml_node, _wi_xml_document_t *document, xmlNodePtr node) {
+    xml_node->document  = _wi_xml_document_retain(document);
+    xml_node->node      = node;
     
     return xml_node;
 }
@@ -235,6 +260,8 @@ static void _wi_xml_node_dealloc(wi_runtime_instance_t *instance) {
     wi_release(xml_node->text);
     wi_release(xml_node->attributes);
     wi_release(xml_node->children);
+    
+    _wi_xml_document_release(xml_node->document);
 }
 
 
@@ -245,10 +272,113 @@ static wi_string_t * _wi_xml_node_description(wi_runtime_instance_t *instance) {
     return wi_string_with_format(WI_STR("<%@ %p>{element = %@, text = %@, attributes = %@, children = %@}"),
         wi_runtime_class_name(xml_node),
         xml_node,
-        xml_node->element,
-        xml_node->text,
-        xml_node->attributes,
-        xml_node->children);
+        wi_xml_node_element(xml_node),
+        wi_xml_node_text(xml_node),
+        wi_xml_node_attributes(xml_node),
+        wi_xml_node_children(xml_node));
+}
+
+
+
+#pragma mark -
+
+static void _wi_xml_node_load_text(wi_xml_node_t *xml_node) {
+    wi_string_t     *string;
+    xmlChar         *value;
+    
+    value = xmlNodeListGetString(xml_node->node->doc, xml_node->node->children, 1);
+    
+    if(value) {
+        string = wi_string_with_utf8_string((const char *) value);
+        
+        if(wi_string_length(wi_string_by_deleting_surrounding_whitespace(string)) > 0)
+            xml_node->text = wi_retain(string);
+        
+        xmlFree(value);
+    }
+    
+    __atomic_store_n(&xml_node->text_loaded, true, __ATOMIC_RELEASE);
+}
+
+
+
+static void _wi_xml_node_load_attributes(wi_xml_node_t *xml_node) {
+    wi_mutable_dictionary_t         *attributes;
+    wi_dictionary_key_callbacks_t   key_callbacks;
+    xmlAttr                         *attribute;
+    xmlChar                         *value;
+    
+    /* Keys are interned names, so retain them instead of copying */
+    key_callbacks           = wi_dictionary_default_key_callbacks;
+    key_callbacks.retain    = wi_retain;
+    
+    attributes = wi_dictionary_init_with_capacity_and_callbacks(wi_mutable_dictionary_alloc(), 0,
+        key_callbacks, wi_dictionary_default_value_callbacks);
+    
+    for(attribute = xml_node->node->properties; attribute != NULL; attribute = attribute->next) {
+        value = xmlNodeListGetString(attribute->doc, attribute->children, 1);
+        
+        if(value) {
+            wi_mutable_dictionary_set_data_for_key(attributes,
+                                                   wi_string_with_utf8_string((const char *) value),
+                                                   _wi_xml_document_string_for_name(xml_node->document, attribute->name));
+            
+            xmlFree(value);
+        }
+    }
+    
+    wi_runtime_make_immutable(attributes);
+    
+    __atomic_store_n(&xml_node->attributes, attributes, __ATOMIC_RELEASE);
+}
+
+
+
+static void _wi_xml_node_load_children(wi_xml_node_t *xml_node) {
+    wi_mutable_array_t      *children;
+    wi_xml_node_t           *child_xml_node;
+    xmlNodePtr              child_node;
+    
+    children = wi_array_init_with_capacity(wi_mutable_array_alloc(), xmlChildElementCount(xml_node->node));
+    
+    for(child_node = xml_node->node->children; child_node != NULL; child_node = child_node->next) {
+        if(child_node->type == XML_ELEMENT_NODE) {
+            child_xml_node = _wi_xml_node_init_with_node(_wi_xml_node_alloc(), xml_node->document, child_node);
+            
+            wi_mutable_array_add_data(children, child_xml_node);
+            wi_release(child_xml_node);
+        }
+    }
+    
+    wi_runtime_make_immutable(children);
+    
+    __atomic_store_n(&xml_node->children, children, __ATOMIC_RELEASE);
+}
+
+
+
+static xmlXPathObjectPtr _wi_xml_node_evaluate_xpath(wi_xml_node_t *xml_node, wi_string_t *xpath) {
+    xmlXPathContextPtr      context;
+    xmlXPathObjectPtr       object;
+    
+    context = xmlXPathNewContext(xml_node->document->doc);
+    
+    if(!context) {
+        wi_error_set_libxml2_error();
+        
+        return NULL;
+    }
+    
+    context->node = xml_node->node;
+    
+    object = xmlXPathEvalExpression((const xmlChar *) wi_string_utf8_string(xpath), context);
+    
+    if(!object)
+        wi_error_set_libxml2_error();
+    
+    xmlXPathFreeContext(context);
+    
+    return object;
 }
 
 
@@ -256,31 +386,159 @@ static wi_string_t * _wi_xml_node_description(wi_runtime_instance_t *instance) {
 #pragma mark -
 
 wi_string_t * wi_xml_node_element(wi_xml_node_t *xml_node) {
-    return xml_node->element;
+    wi_string_t     *element;
+    
+    element = __atomic_load_n(&xml_node->element, __ATOMIC_ACQUIRE);
+    
+    if(!element) {
+        wi_fast_lock_lock(&xml_node->document->lock);
+        
+        element = xml_node->element;
+        
+        if(!element) {
+            element = wi_retain(_wi_xml_document_string_for_name(xml_node->document, xml_node->node->name));
+            
+            __atomic_store_n(&xml_node->element, element, __ATOMIC_RELEASE);
+        }
+        
+        wi_fast_lock_unlock(&xml_node->document->lock);
+    }
+    
+    return element;
 }
 
 
 
 wi_string_t * wi_xml_node_text(wi_xml_node_t *xml_node) {
+    if(!__atomic_load_n(&xml_node->text_loaded, __ATOMIC_ACQUIRE)) {
+        wi_fast_lock_lock(&xml_node->document->lock);
+        
+        if(!xml_node->text_loaded)
+            _wi_xml_node_load_text(xml_node);
+        
+        wi_fast_lock_unlock(&xml_node->document->lock);
+    }
+    
     return xml_node->text;
 }
 
 
 
 wi_dictionary_t * wi_xml_node_attributes(wi_xml_node_t *xml_node) {
-    return wi_autorelease(wi_copy(xml_node->attributes));
+    wi_dictionary_t     *attributes;
+    
+    attributes = __atomic_load_n(&xml_node->attributes, __ATOMIC_ACQUIRE);
+    
+    if(!attributes) {
+        wi_fast_lock_lock(&xml_node->document->lock);
+        
+        if(!xml_node->attributes)
+            _wi_xml_node_load_attributes(xml_node);
+        
+        attributes = xml_node->attributes;
+        
+        wi_fast_lock_unlock(&xml_node->document->lock);
+    }
+    
+    return attributes;
 }
 
 
 
 wi_uinteger_t wi_xml_node_number_of_children(wi_xml_node_t *xml_node) {
-    return wi_array_count(xml_node->children);
+    wi_array_t      *children;
+    
+    children = __atomic_load_n(&xml_node->children, __ATOMIC_ACQUIRE);
+    
+    if(!children)
+        return xmlChildElementCount(xml_node->node);
+    
+    return wi_array_count(children);
 }
 
 
 
 wi_xml_node_t * wi_xml_node_child_at_index(wi_xml_node_t *xml_node, wi_uinteger_t index) {
-    return WI_ARRAY(xml_node->children, index);
+    return WI_ARRAY(wi_xml_node_children(xml_node), index);
+}
+
+
+
+wi_array_t * wi_xml_node_children(wi_xml_node_t *xml_node) {
+    wi_array_t      *children;
+    
+    children = __atomic_load_n(&xml_node->children, __ATOMIC_ACQUIRE);
+    
+    if(!children) {
+        wi_fast_lock_lock(&xml_node->document->lock);
+        
+        if(!xml_node->children)
+            _wi_xml_node_load_children(xml_node);
+        
+        children = xml_node->children;
+        
+        wi_fast_lock_unlock(&xml_node->document->lock);
+    }
+    
+    return children;
+}
+
+
+
+#pragma mark -
+
+wi_array_t * wi_xml_node_nodes_for_xpath(wi_xml_node_t *xml_node, wi_string_t *xpath) {
+    wi_mutable_array_t      *array;
+    wi_xml_node_t           *result_xml_node;
+    xmlXPathObjectPtr       object;
+    xmlNodeSetPtr           nodes;
+    int                     i;
+    
+    object = _wi_xml_node_evaluate_xpath(xml_node, xpath);
+    
+    if(!object)
+        return NULL;
+    
+    array = wi_mutable_array();
+    nodes = object->nodesetval;
+    
+    if(object->type == XPATH_NODESET && nodes) {
+        for(i = 0; i < nodes->nodeNr; i++) {
+            if(nodes->nodeTab[i]->type == XML_ELEMENT_NODE) {
+                result_xml_node = _wi_xml_node_init_with_node(_wi_xml_node_alloc(), xml_node->document, nodes->nodeTab[i]);
+                
+                wi_mutable_array_add_data(array, result_xml_node);
+                wi_release(result_xml_node);
+            }
+        }
+    }
+    
+    xmlXPathFreeObject(object);
+    
+    wi_runtime_make_immutable(array);
+    
+    return array;
+}
+
+
+
+wi_string_t * wi_xml_node_string_for_xpath(wi_xml_node_t *xml_node, wi_string_t *xpath) {
+    wi_string_t             *string;
+    xmlXPathObjectPtr       object;
+    xmlChar                 *value;
+    
+    object = _wi_xml_node_evaluate_xpath(xml_node, xpath);
+    
+    if(!object)
+        return NULL;
+    
+    value = xmlXPathCastToString(object);
+    string = wi_string_with_utf8_string((const char *) value);
+    
+    xmlFree(value);
+    xmlXPathFreeObject(object);
+    
+    return string;
 }
 
 #endif
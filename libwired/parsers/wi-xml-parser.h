@@ -41,5 +41,9 @@ WI_EXPORT wi_string_t *                 wi_xml_node_text(wi_xml_node_t *);
 WI_EXPORT wi_dictionary_t *             wi_xml_node_attributes(wi_xml_node_t *);
 WI_EXPORT wi_uinteger_t                 wi_xml_node_number_of_children(wi_xml_node_t *);
 WI_EXPORT wi_xml_node_t *               wi_xml_node_child_at_index(wi_xml_node_t *, wi_uinteger_t);
+WI_EXPORT wi_array_t *                  wi_xml_node_children(wi_xml_node_t *);
+
+WI_EXPORT wi_array_t *                  wi_xml_node_nodes_for_xpath(wi_xml_node_t *, wi_string_t *);
+WI_EXPORT wi_string_t *                 wi_xml_node_string_for_xpath(wi_xml_node_t *, wi_string_t *);
 
 #endif /* WI_XML_PARSER_H */
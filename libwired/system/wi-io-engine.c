@@ -0,0 +1,1148 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define _WI_IO_ENGINE_IO_URING          1
+#endif
+#endif
+
+#include <wired/wi-address.h>
+#include <wired/wi-file.h>
+#include <wired/wi-io-engine.h>
+#include <wired/wi-macros.h>
+#include <wired/wi-pool.h>
+#include <wired/wi-private.h>
+#include <wired/wi-runtime.h>
+#include <wired/wi-socket.h>
+#include <wired/wi-string.h>
+#include <wired/wi-system.h>
+
+#define _WI_IO_ENGINE_QUEUE_SIZE        256
+
+
+enum _wi_io_engine_operation {
+    _WI_IO_ENGINE_READ_FILE,
+    _WI_IO_ENGINE_WRITE_FILE,
+    _WI_IO_ENGINE_SYNCHRONIZE_FILE,
+    _WI_IO_ENGINE_READ_SOCKET,
+    _WI_IO_ENGINE_WRITE_SOCKET,
+    _WI_IO_ENGINE_ACCEPT_SOCKET,
+    _WI_IO_ENGINE_CONNECT_SOCKET
+};
+typedef enum _wi_io_engine_operation    _wi_io_engine_operation_t;
+
+
+struct _wi_io_engine_request {
+    _wi_io_engine_operation_t           operation;
+    int                                 fd;
+    void                                *buffer;
+    wi_uinteger_t                       length;
+    wi_file_offset_t                    offset;
+    
+    struct sockaddr_storage             ss;
+    socklen_t                           sslength;
+    
+    wi_runtime_instance_t               *instance;
+    wi_io_engine_func_t                 *func;
+    void                                *context;
+    wi_integer_t                        result;
+    
+    struct _wi_io_engine_request        *previous, *next;
+};
+typedef struct _wi_io_engine_request    _wi_io_engine_request_t;
+
+
+#ifdef _WI_IO_ENGINE_IO_URING
+
+struct _wi_io_engine_ring {
+    int                                 fd;
+    unsigned int                        features;
+    
+    void                                *sq_mapping, *cq_mapping;
+    size_t                              sq_mapping_length, cq_mapping_length;
+    
+    unsigned int                        *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned int                        sq_entries, sq_pending;
+    struct io_uring_sqe                 *sqes;
+    size_t                              sqes_length;
+    
+    unsigned int                        *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe                 *cqes;
+};
+typedef struct _wi_io_engine_ring       _wi_io_engine_ring_t;
+
+#endif
+
+
+struct _wi_io_engine {
+    wi_runtime_base_t                   base;
+    
+    wi_io_engine_backend_t              backend;
+    wi_uinteger_t                       pending_count;
+    
+    struct iovec                        *buffers;
+    wi_uinteger_t                       buffers_count;
+    
+    _wi_io_engine_request_t             *queued, *last_queued;
+    _wi_io_engine_request_t             *in_flight;
+    _wi_io_engine_request_t             *completed, *last_completed;
+    
+    struct pollfd                       *fds;
+    wi_uinteger_t                       fds_capacity;
+    
+#ifdef _WI_IO_ENGINE_IO_URING
+    _wi_io_engine_ring_t                ring;
+#endif
+};
+
+
+static void                             _wi_io_engine_dealloc(wi_runtime_instance_t *);
+static wi_string_t *                    _wi_io_engine_description(wi_runtime_instance_t *);
+
+static wi_boolean_t                     _wi_io_engine_queue_request(wi_io_engine_t *, _wi_io_engine_request_t *);
+static _wi_io_engine_request_t *        _wi_io_engine_request(_wi_io_engine_operation_t, int, wi_runtime_instance_t *, wi_io_engine_func_t *, void *);
+static void                             _wi_io_engine_complete_request(wi_io_engine_t *, _wi_io_engine_request_t *);
+static wi_integer_t                     _wi_io_engine_deliver_completions(wi_io_engine_t *);
+
+static void                             _wi_io_engine_poll_perform_request(_wi_io_engine_request_t *, wi_boolean_t);
+static wi_boolean_t                     _wi_io_engine_poll_start_connect(_wi_io_engine_request_t *);
+static wi_integer_t                     _wi_io_engine_poll_submit(wi_io_engine_t *);
+static wi_integer_t                     _wi_io_engine_poll_wait(wi_io_engine_t *, wi_time_interval_t);
+
+#ifdef _WI_IO_ENGINE_IO_URING
+static wi_boolean_t                     _wi_io_engine_ring_setup(wi_io_engine_t *);
+static void                             _wi_io_engine_ring_close(wi_io_engine_t *);
+static struct io_uring_sqe *            _wi_io_engine_ring_next_sqe(wi_io_engine_t *);
+static void                             _wi_io_engine_ring_commit_sqe(wi_io_engine_t *);
+static int                              _wi_io_engine_ring_enter(wi_io_engine_t *, unsigned int, unsigned int, unsigned int, void *, size_t);
+static wi_boolean_t                     _wi_io_engine_ring_prepare_request(wi_io_engine_t *, _wi_io_engine_request_t *);
+static void                             _wi_io_engine_ring_remove_request(wi_io_engine_t *, _wi_io_engine_request_t *);
+static void                             _wi_io_engine_ring_cancel_requests(wi_io_engine_t *);
+static wi_integer_t                     _wi_io_engine_ring_submit(wi_io_engine_t *);
+static wi_integer_t                     _wi_io_engine_ring_wait(wi_io_engine_t *, wi_time_interval_t);
+#endif
+
+
+static wi_runtime_id_t                  _wi_io_engine_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t               _wi_io_engine_runtime_class = {
+    "wi_io_engine_t",
+    _wi_io_engine_dealloc,
+    NULL,
+    NULL,
+    _wi_io_engine_description,
+    NULL
+};
+
+
+
+void wi_io_engine_register(void) {
+    _wi_io_engine_runtime_id = wi_runtime_register_class(&_wi_io_engine_runtime_class);
+}
+
+
+
+void wi_io_engine_initialize(void) {
+}
+
+
+
+#pragma mark -
+
+wi_runtime_id_t wi_io_engine_runtime_id(void) {
+    return _wi_io_engine_runtime_id;
+}
+
+
+
+#pragma mark -
+
+wi_io_engine_t * wi_io_engine(void) {
+    return wi_autorelease(wi_io_engine_init(wi_io_engine_alloc()));
+}
+
+
+
+#pragma mark -
+
+wi_io_engine_t * wi_io_engine_alloc(void) {
+    return wi_runtime_create_instance(_wi_io_engine_runtime_id, sizeof(wi_io_engine_t));
+}
+
+
+
+wi_io_engine_t * wi_io_engine_init(wi_io_engine_t *engine) {
+    return wi_io_engine_init_with_backend(engine, WI_IO_ENGINE_AUTOMATIC);
+}
+
+
+
+wi_io_engine_t * wi_io_engine_init_with_backend(wi_io_engine_t *engine, wi_io_engine_backend_t backend) {
+#ifdef _WI_IO_ENGINE_IO_URING
+    engine->ring.fd = -1;
+    
+    if(backend == WI_IO_ENGINE_AUTOMATIC || backend == WI_IO_ENGINE_IO_URING) {
+        if(_wi_io_engine_ring_setup(engine)) {
+            engine->backend = WI_IO_ENGINE_IO_URING;
+            
+            return engine;
+        }
+        
+        if(backend == WI_IO_ENGINE_IO_URING) {
+            wi_release(engine);
+            
+            return NULL;
+        }
+    }
+#else
+    if(backend == WI_IO_ENGINE_IO_URING) {
+        wi_error_set_errno(ENOSYS);
+        
+        wi_release(engine);
+        
+        return NULL;
+    }
+#endif
+    
+    engine->backend = WI_IO_ENGINE_POLL;
+    
+    return engine;
+}
+
+
+
+#pragma mark -
+
+static void _wi_io_engine_dealloc(wi_runtime_instance_t *instance) {
+    wi_io_engine_t              *engine = instance;
+    _wi_io_engine_request_t     *request, *next_request;
+    _wi_io_engine_request_t     *lists[3];
+    wi_uinteger_t               i;
+    
+#ifdef _WI_IO_ENGINE_IO_URING
+    if(engine->ring.fd >= 0) {
+        _wi_io_engine_ring_cancel_requests(engine);
+        _wi_io_engine_ring_close(engine);
+    }
+#endif
+    
+    lists[0] = engine->queued;
+    lists[1] = engine->in_flight;
+    lists[2] = engine->completed;
+    
+    for(i = 0; i < WI_ARRAY_SIZE(lists); i++) {
+        for(request = lists[i]; request; request = next_request) {
+            next_request = request->next;
+            
+            wi_release(request->instance);
+            wi_free(request);
+        }
+    }
+    
+    wi_free(engine->buffers);
+    wi_free(engine->fds);
+}
+
+
+
+static wi_string_t * _wi_io_engine_description(wi_runtime_instance_t *instance) {
+    wi_io_engine_t      *engine = instance;
+    
+    return wi_string_with_format(WI_STR("<%@ %p>{backend = %s, pending = %lu}"),
+        wi_runtime_class_name(engine),
+        engine,
+        engine->backend == WI_IO_ENGINE_IO_URING ? "io_uring" : "poll",
+        engine->pending_count);
+}
+
+
+
+#pragma mark -
+
+wi_io_engine_backend_t wi_io_engine_backend(wi_io_engine_t *engine) {
+    return engine->backend;
+}
+
+
+
+wi_uinteger_t wi_io_engine_pending_count(wi_io_engine_t *engine) {
+    return engine->pending_count;
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_io_engine_register_buffers(wi_io_engine_t *engine, const struct iovec *buffers, wi_uinteger_t count) {
+#ifdef _WI_IO_ENGINE_IO_URING
+    if(engine->backend == WI_IO_ENGINE_IO_URING) {
+        if(engine->buffers_count > 0)
+            (void) syscall(__NR_io_uring_register, engine->ring.fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+        
+        if(count > 0 && syscall(__NR_io_uring_register, engine->ring.fd, IORING_REGISTER_BUFFERS, buffers, count) < 0) {
+            wi_error_set_errno(errno);
+            
+            wi_free(engine->buffers);
+            
+            engine->buffers         = NULL;
+            engine->buffers_count   = 0;
+            
+            return false;
+        }
+    }
+#endif
+    
+    /* The poll backend has nothing to pin, but keeps the list so both backends behave alike */
+    engine->buffers         = wi_realloc(engine->buffers, WI_MAX(count, 1) * sizeof(struct iovec));
+    engine->buffers_count   = count;
+    
+    memcpy(engine->buffers, buffers, count * sizeof(struct iovec));
+    
+    return true;
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_io_engine_read_file(wi_io_engine_t *engine, wi_file_t *file, void *buffer, wi_uinteger_t length, wi_file_offset_t offset, wi_io_engine_func_t *func, void *context) {
+    _wi_io_engine_request_t     *request;
+    
+    request             = _wi_io_engine_request(_WI_IO_ENGINE_READ_FILE, wi_file_descriptor(file), file, func, context);
+    request->buffer     = buffer;
+    request->length     = length;
+    request->offset     = offset;
+    
+    return _wi_io_engine_queue_request(engine, request);
+}
+
+
+
+wi_boolean_t wi_io_engine_write_file(wi_io_engine_t *engine, wi_file_t *file, const void *buffer, wi_uinteger_t length, wi_file_offset_t offset, wi_io_engine_func_t *func, void *context) {
+    _wi_io_engine_request_t     *request;
+    
+    request             = _wi_io_engine_request(_WI_IO_ENGINE_WRITE_FILE, wi_file_descriptor(file), file, func, context);
+    request->buffer     = (void *) buffer;
+    request->length     = length;
+    request->offset     = offset;
+    
+    return _wi_io_engine_queue_request(engine, request);
+}
+
+
+
+wi_boolean_t wi_io_engine_synchronize_file(wi_io_engine_t *engine, wi_file_t *file, wi_io_engine_func_t *func, void *context) {
+    return _wi_io_engine_queue_request(engine, _wi_io_engine_request(_WI_IO_ENGINE_SYNCHRONIZE_FILE, wi_file_descriptor(file), file, func, context));
+}
+
+
+
+#pragma mark -
+
+wi_boolean_t wi_io_engine_read_socket(wi_io_engine_t *engine, wi_socket_t *socket, void *buffer, wi_uinteger_t length, wi_io_engine_func_t *func, void *context) {
+    _wi_io_engine_request_t     *request;
+    
+    request             = _wi_io_engine_request(_WI_IO_ENGINE_READ_SOCKET, wi_socket_descriptor(socket), socket, func, context);
+    request->buffer     = buffer;
+    request->length     = length;
+    
+    return _wi_io_engine_queue_request(engine, request);
+}
+
+
+
+wi_boolean_t wi_io_engine_write_socket(wi_io_engine_t *engine, wi_socket_t *socket, const void *buffer, wi_uinteger_t length, wi_io_engine_func_t *func, void *context) {
+    _wi_io_engine_request_t     *request;
+    
+    request             = _wi_io_engine_request(_WI_IO_ENGINE_WRITE_SOCKET, wi_socket_descriptor(socket), socket, func, context);
+    request->buffer     = (void *) buffer;
+    request->length     = length;
+    
+    return _wi_io_engine_queue_request(engine, request);
+}
+
+
+
+wi_boolean_t wi_io_engine_accept_socket(wi_io_engine_t *engine, wi_socket_t *socket, wi_io_engine_func_t *func, void *context) {
+    return _wi_io_engine_queue_request(engine, _wi_io_engine_request(_WI_IO_ENGINE_ACCEPT_SOCKET, wi_socket_descriptor(socket), socket, func, context));
+}
+
+
+
+wi_boolean_t wi_io_engine_connect_socket(wi_io_engine_t *engine, wi_socket_t *socket, wi_io_engine_func_t *func, void *context) {
+    _wi_io_engine_request_t     *request;
+    wi_address_t                *address;
+    
+    address             = wi_socket_address(socket);
+    request             = _wi_io_engine_request(_WI_IO_ENGINE_CONNECT_SOCKET, wi_socket_descriptor(socket), socket, func, context);
+    request->sslength   = wi_address_sa_length(address);
+    
+    memcpy(&request->ss, wi_address_sa(address), request->sslength);
+    
+    return _wi_io_engine_queue_request(engine, request);
+}
+
+
+
+#pragma mark -
+
+wi_integer_t wi_io_engine_submit(wi_io_engine_t *engine) {
+#ifdef _WI_IO_ENGINE_IO_URING
+    if(engine->backend == WI_IO_ENGINE_IO_URING)
+        return _wi_io_engine_ring_submit(engine);
+#endif
+    
+    return _wi_io_engine_poll_submit(engine);
+}
+
+
+
+wi_integer_t wi_io_engine_wait_for_completions(wi_io_engine_t *engine, wi_time_interval_t timeout) {
+    if(engine->pending_count == 0)
+        return 0;
+    
+#ifdef _WI_IO_ENGINE_IO_URING
+    if(engine->backend == WI_IO_ENGINE_IO_URING)
+        return _wi_io_engine_ring_wait(engine, timeout);
+#endif
+    
+    return _wi_io_engine_poll_wait(engine, timeout);
+}
+
+
+
+#pragma mark -
+
+static _wi_io_engine_request_t * _wi_io_engine_request(_wi_io_engine_operation_t operation, int fd, wi_runtime_instance_t *instance, wi_io_engine_func_t *func, void *context) {
+    _wi_io_engine_request_t     *request;
+    
+    request                 = wi_malloc(sizeof(_wi_io_engine_request_t));
+    request->operation      = operation;
+    request->fd             = fd;
+    request->instance       = wi_retain(instance);
+    request->func           = func;
+    request->context        = context;
+    
+    return request;
+}
+
+
+
+static wi_boolean_t _wi_io_engine_queue_request(wi_io_engine_t *engine, _wi_io_engine_request_t *request) {
+#ifdef _WI_IO_ENGINE_IO_URING
+    if(engine->backend == WI_IO_ENGINE_IO_URING) {
+        if(!_wi_io_engine_ring_prepare_request(engine, request)) {
+            wi_release(request->instance);
+            wi_free(request);
+            
+            return false;
+        }
+        
+        engine->pending_count++;
+        
+        return true;
+    }
+#endif
+    
+    if(engine->last_queued)
+        engine->last_queued->next = request;
+    else
+        engine->queued = request;
+    
+    engine->last_queued = request;
+    engine->pending_count++;
+    
+    return true;
+}
+
+
+
+static void _wi_io_engine_complete_request(wi_io_engine_t *engine, _wi_io_engine_request_t *request) {
+    request->next = NULL;
+    
+    if(engine->last_completed)
+        engine->last_completed->next = request;
+    else
+        engine->completed = request;
+    
+    engine->last_completed = request;
+}
+
+
+
+static wi_integer_t _wi_io_engine_deliver_completions(wi_io_engine_t *engine) {
+    _wi_io_engine_request_t     *request, *next_request;
+    wi_integer_t                count;
+    
+    /* Detach the list first, callbacks are free to queue new requests */
+    request = engine->completed;
+    count = 0;
+    
+    engine->completed = engine->last_completed = NULL;
+    
+    while(request) {
+        next_request = request->next;
+        
+        engine->pending_count--;
+        
+        if(request->func) {
+            if(request->result < 0) {
+                wi_error_set_errno(-request->result);
+                
+                (*request->func)(engine, -1, request->context);
+            } else {
+                (*request->func)(engine, request->result, request->context);
+            }
+        }
+        
+        wi_release(request->instance);
+        wi_free(request);
+        
+        request = next_request;
+        count++;
+    }
+    
+    return count;
+}
+
+
+
+#pragma mark -
+
+static void _wi_io_engine_poll_perform_request(_wi_io_engine_request_t *request, wi_boolean_t nonblocking) {
+    ssize_t     bytes;
+    socklen_t   length;
+    int         flags, error;
+    
+    flags = nonblocking ? MSG_DONTWAIT : 0;
+    
+    do {
+        switch(request->operation) {
+            case _WI_IO_ENGINE_READ_FILE:
+                bytes = pread(request->fd, request->buffer, request->length, request->offset);
+                break;
+                
+            case _WI_IO_ENGINE_WRITE_FILE:
+                bytes = pwrite(request->fd, request->buffer, request->length, request->offset);
+                break;
+                
+            case _WI_IO_ENGINE_SYNCHRONIZE_FILE:
+                bytes = fsync(request->fd);
+                break;
+                
+            case _WI_IO_ENGINE_READ_SOCKET:
+                bytes = recv(request->fd, request->buffer, request->length, flags);
+                break;
+                
+            case _WI_IO_ENGINE_WRITE_SOCKET:
+                bytes = send(request->fd, request->buffer, request->length, flags);
+                break;
+                
+            case _WI_IO_ENGINE_ACCEPT_SOCKET:
+                bytes = accept(request->fd, NULL, NULL);
+                break;
+                
+            case _WI_IO_ENGINE_CONNECT_SOCKET:
+                /* The connect was started by _wi_io_engine_poll_start_connect(), fetch its outcome */
+                length = sizeof(error);
+                bytes = getsockopt(request->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                
+                if(bytes == 0 && error != 0) {
+                    bytes = -1;
+                    errno = error;
+                }
+                break;
+                
+            default:
+                bytes = -1;
+                errno = EINVAL;
+                break;
+        }
+    } while(bytes < 0 && errno == EINTR);
+    
+    request->result = (bytes < 0) ? -errno : bytes;
+}
+
+
+
+static wi_boolean_t _wi_io_engine_poll_start_connect(_wi_io_engine_request_t *request) {
+    int     flags, result, error;
+    
+    /* Start the connect without blocking, poll() reports when it is done */
+    flags = fcntl(request->fd, F_GETFL);
+    
+    if(flags >= 0 && !(flags & O_NONBLOCK))
+        fcntl(request->fd, F_SETFL, flags | O_NONBLOCK);
+    
+    result = connect(request->fd, (struct sockaddr *) &request->ss, request->sslength);
+    error = (result < 0) ? errno : 0;
+    
+    if(flags >= 0 && !(flags & O_NONBLOCK))
+        fcntl(request->fd, F_SETFL, flags);
+    
+    if(error == EINPROGRESS || error == EINTR)
+        return false;
+    
+    request->result = -error;
+    
+    return true;
+}
+
+
+
+static wi_integer_t _wi_io_engine_poll_submit(wi_io_engine_t *engine) {
+    _wi_io_engine_request_t     *request, *next_request, **link;
+    wi_integer_t                count;
+    
+    request = engine->queued;
+    count = 0;
+    
+    engine->queued = engine->last_queued = NULL;
+    
+    /* Requests are kept in submission order, so writes to the same file land in order */
+    for(link = &engine->in_flight; *link; link = &(*link)->next)
+        ;
+    
+    /* Nothing is performed here, so submitting never blocks. Regular files
+       are always ready, so file requests are done by the next wait. */
+    while(request) {
+        next_request = request->next;
+        
+        if(request->operation == _WI_IO_ENGINE_CONNECT_SOCKET && _wi_io_engine_poll_start_connect(request)) {
+            _wi_io_engine_complete_request(engine, request);
+        } else {
+            request->next = NULL;
+            
+            *link = request;
+            link = &request->next;
+        }
+        
+        request = next_request;
+        count++;
+    }
+    
+    return count;
+}
+
+
+
+static wi_integer_t _wi_io_engine_poll_wait(wi_io_engine_t *engine, wi_time_interval_t timeout) {
+    _wi_io_engine_request_t     *request, **link;
+    wi_uinteger_t               i, count;
+    int                         result;
+    
+    _wi_io_engine_poll_submit(engine);
+    
+    link = &engine->in_flight;
+    count = 0;
+    
+    while((request = *link)) {
+        switch(request->operation) {
+            case _WI_IO_ENGINE_READ_FILE:
+            case _WI_IO_ENGINE_WRITE_FILE:
+            case _WI_IO_ENGINE_SYNCHRONIZE_FILE:
+                *link = request->next;
+                
+                _wi_io_engine_poll_perform_request(request, false);
+                _wi_io_engine_complete_request(engine, request);
+                break;
+            
+            default:
+                link = &request->next;
+                count++;
+                break;
+        }
+    }
+    
+    if(!engine->completed && count > 0) {
+        if(count > engine->fds_capacity) {
+            engine->fds_capacity = WI_MAX(count, engine->fds_capacity * 2);
+            engine->fds = wi_realloc(engine->fds, engine->fds_capacity * sizeof(struct pollfd));
+        }
+        
+        for(i = 0, request = engine->in_flight; request; request = request->next, i++) {
+            engine->fds[i].fd       = request->fd;
+            engine->fds[i].events   = (request->operation == _WI_IO_ENGINE_WRITE_SOCKET || request->operation == _WI_IO_ENGINE_CONNECT_SOCKET) ? POLLOUT : POLLIN;
+            engine->fds[i].revents  = 0;
+        }
+        
+        do {
+            result = poll(engine->fds, count, (timeout > 0.0) ? (int) (timeout * 1000.0) : -1);
+        } while(result < 0 && errno == EINTR);
+        
+        if(result < 0) {
+            wi_error_set_errno(errno);
+            
+            return -1;
+        }
+        
+        link = &engine->in_flight;
+        i = 0;
+        
+        while((request = *link)) {
+            if(engine->fds[i].revents != 0) {
+                _wi_io_engine_poll_perform_request(request, true);
+                
+                if(request->result != -EAGAIN && request->result != -EWOULDBLOCK) {
+                    *link = request->next;
+                    
+                    _wi_io_engine_complete_request(engine, request);
+                    
+                    i++;
+                    
+                    continue;
+                }
+            }
+            
+            link = &request->next;
+            i++;
+        }
+    }
+    
+    return _wi_io_engine_deliver_completions(engine);
+}
+
+
+
+#pragma mark -
+
+#ifdef _WI_IO_ENGINE_IO_URING
+
+static wi_boolean_t _wi_io_engine_ring_setup(wi_io_engine_t *engine) {
+    _wi_io_engine_ring_t        *ring = &engine->ring;
+    struct io_uring_params      params;
+    char                        *sq, *cq;
+    
+    memset(&params, 0, sizeof(params));
+    
+    ring->fd = syscall(__NR_io_uring_setup, _WI_IO_ENGINE_QUEUE_SIZE, &params);
+    
+    if(ring->fd < 0) {
+        wi_error_set_errno(errno);
+        
+        return false;
+    }
+    
+    /* Fast poll arrived with the kernels that also know all the opcodes used below */
+    if(!(params.features & IORING_FEAT_FAST_POLL)) {
+        close(ring->fd);
+        
+        ring->fd = -1;
+        
+        wi_error_set_errno(ENOSYS);
+        
+        return false;
+    }
+    
+    ring->features              = params.features;
+    ring->sq_mapping_length     = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_mapping_length     = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_length           = params.sq_entries * sizeof(struct io_uring_sqe);
+    
+    if(ring->features & IORING_FEAT_SINGLE_MMAP) {
+        ring->sq_mapping_length = ring->cq_mapping_length = WI_MAX(ring->sq_mapping_length, ring->cq_mapping_length);
+    }
+    
+    ring->sq_mapping = mmap(NULL, ring->sq_mapping_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    
+    if(ring->sq_mapping == MAP_FAILED)
+        goto err;
+    
+    if(ring->features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_mapping = ring->sq_mapping;
+    } else {
+        ring->cq_mapping = mmap(NULL, ring->cq_mapping_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        
+        if(ring->cq_mapping == MAP_FAILED) {
+            munmap(ring->sq_mapping, ring->sq_mapping_length);
+            
+            goto err;
+        }
+    }
+    
+    ring->sqes = mmap(NULL, ring->sqes_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    
+    if(ring->sqes == MAP_FAILED) {
+        if(ring->cq_mapping != ring->sq_mapping)
+            munmap(ring->cq_mapping, ring->cq_mapping_length);
+        
+        munmap(ring->sq_mapping, ring->sq_mapping_length);
+        
+        goto err;
+    }
+    
+    sq = ring->sq_mapping;
+    cq = ring->cq_mapping;
+    
+    ring->sq_head       = (unsigned int *) (sq + params.sq_off.head);
+    ring->sq_tail       = (unsigned int *) (sq + params.sq_off.tail);
+    ring->sq_mask       = (unsigned int *) (sq + params.sq_off.ring_mask);
+    ring->sq_array      = (unsigned int *) (sq + params.sq_off.array);
+    ring->sq_entries    = params.sq_entries;
+    
+    ring->cq_head       = (unsigned int *) (cq + params.cq_off.head);
+    ring->cq_tail       = (unsigned int *) (cq + params.cq_off.tail);
+    ring->cq_mask       = (unsigned int *) (cq + params.cq_off.ring_mask);
+    ring->cqes          = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    
+    return true;
+    
+err:
+    wi_error_set_errno(errno);
+    
+    close(ring->fd);
+    
+    ring->fd = -1;
+    
+    return false;
+}
+
+
+
+static void _wi_io_engine_ring_close(wi_io_engine_t *engine) {
+    _wi_io_engine_ring_t    *ring = &engine->ring;
+    
+    munmap(ring->sqes, ring->sqes_length);
+    
+    if(ring->cq_mapping != ring->sq_mapping)
+        munmap(ring->cq_mapping, ring->cq_mapping_length);
+    
+    munmap(ring->sq_mapping, ring->sq_mapping_length);
+    close(ring->fd);
+    
+    ring->fd = -1;
+}
+
+
+
+static struct io_uring_sqe * _wi_io_engine_ring_next_sqe(wi_io_engine_t *engine) {
+    _wi_io_engine_ring_t    *ring = &engine->ring;
+    struct io_uring_sqe     *sqe;
+    unsigned int            head, tail;
+    
+    head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    tail = *ring->sq_tail;
+    
+    if(tail - head >= ring->sq_entries) {
+        if(_wi_io_engine_ring_submit(engine) < 0)
+            return NULL;
+        
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        
+        if(tail - head >= ring->sq_entries) {
+            wi_error_set_errno(EBUSY);
+            
+            return NULL;
+        }
+    }
+    
+    sqe = &ring->sqes[tail & *ring->sq_mask];
+    
+    memset(sqe, 0, sizeof(*sqe));
+    
+    return sqe;
+}
+
+
+
+static void _wi_io_engine_ring_commit_sqe(wi_io_engine_t *engine) {
+    _wi_io_engine_ring_t    *ring = &engine->ring;
+    unsigned int            tail;
+    
+    tail = *ring->sq_tail;
+    
+    ring->sq_array[tail & *ring->sq_mask] = tail & *ring->sq_mask;
+    ring->sq_pending++;
+    
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+
+static int _wi_io_engine_ring_enter(wi_io_engine_t *engine, unsigned int submit, unsigned int complete, unsigned int flags, void *argument, size_t argument_length) {
+    int     result;
+    
+    do {
+        result = syscall(__NR_io_uring_enter, engine->ring.fd, submit, complete, flags, argument, argument_length);
+    } while(result < 0 && errno == EINTR);
+    
+    if(result >= 0)
+        engine->ring.sq_pending -= WI_MIN((unsigned int) result, engine->ring.sq_pending);
+    
+    return result;
+}
+
+
+
+static wi_boolean_t _wi_io_engine_ring_prepare_request(wi_io_engine_t *engine, _wi_io_engine_request_t *request) {
+    struct io_uring_sqe     *sqe;
+    wi_uinteger_t           i;
+    
+    sqe = _wi_io_engine_ring_next_sqe(engine);
+    
+    if(!sqe)
+        return false;
+    
+    sqe->fd         = request->fd;
+    sqe->user_data  = (uint64_t) (uintptr_t) request;
+    
+    switch(request->operation) {
+        case _WI_IO_ENGINE_READ_FILE:
+        case _WI_IO_ENGINE_WRITE_FILE:
+            sqe->opcode     = (request->operation == _WI_IO_ENGINE_READ_FILE) ? IORING_OP_READ : IORING_OP_WRITE;
+            sqe->addr       = (uint64_t) (uintptr_t) request->buffer;
+            sqe->len        = request->length;
+            sqe->off        = request->offset;
+            
+            /* Buffers inside a registered region skip the per-request page pinning */
+            for(i = 0; i < engine->buffers_count; i++) {
+                if((char *) request->buffer >= (char *) engine->buffers[i].iov_base &&
+                   (char *) request->buffer + request->length <= (char *) engine->buffers[i].iov_base + engine->buffers[i].iov_len) {
+                    sqe->opcode     = (request->operation == _WI_IO_ENGINE_READ_FILE) ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+                    sqe->buf_index  = i;
+                    break;
+                }
+            }
+            break;
+            
+        case _WI_IO_ENGINE_SYNCHRONIZE_FILE:
+            sqe->opcode     = IORING_OP_FSYNC;
+            break;
+            
+        case _WI_IO_ENGINE_READ_SOCKET:
+        case _WI_IO_ENGINE_WRITE_SOCKET:
+            sqe->opcode     = (request->operation == _WI_IO_ENGINE_READ_SOCKET) ? IORING_OP_RECV : IORING_OP_SEND;
+            sqe->addr       = (uint64_t) (uintptr_t) request->buffer;
+            sqe->len        = request->length;
+            break;
+            
+        case _WI_IO_ENGINE_ACCEPT_SOCKET:
+            sqe->opcode     = IORING_OP_ACCEPT;
+            break;
+            
+        case _WI_IO_ENGINE_CONNECT_SOCKET:
+            sqe->opcode     = IORING_OP_CONNECT;
+            sqe->addr       = (uint64_t) (uintptr_t) &request->ss;
+            sqe->off        = request->sslength;
+            break;
+    }
+    
+    _wi_io_engine_ring_commit_sqe(engine);
+    
+    /* The kernel only hands back user_data, so submitted requests are also
+       kept on the in flight list for the engine to find them again */
+    request->previous = NULL;
+    request->next = engine->in_flight;
+    
+    if(engine->in_flight)
+        engine->in_flight->previous = request;
+    
+    engine->in_flight = request;
+    
+    return true;
+}
+
+
+
+static void _wi_io_engine_ring_remove_request(wi_io_engine_t *engine, _wi_io_engine_request_t *request) {
+    if(request->previous)
+        request->previous->next = request->next;
+    else
+        engine->in_flight = request->next;
+    
+    if(request->next)
+        request->next->previous = request->previous;
+}
+
+
+
+static void _wi_io_engine_ring_cancel_requests(wi_io_engine_t *engine) {
+    _wi_io_engine_ring_t        *ring = &engine->ring;
+    struct io_uring_cqe         *cqe;
+    struct io_uring_sqe         *sqe;
+    _wi_io_engine_request_t     *request;
+    unsigned int                head, tail;
+    
+    for(request = engine->in_flight; request; request = request->next) {
+        sqe = _wi_io_engine_ring_next_sqe(engine);
+        
+        if(!sqe) {
+            if(_wi_io_engine_ring_submit(engine) < 0)
+                break;
+            
+            sqe = _wi_io_engine_ring_next_sqe(engine);
+            
+            if(!sqe)
+                break;
+        }
+        
+        sqe->opcode     = IORING_OP_ASYNC_CANCEL;
+        sqe->fd         = -1;
+        sqe->addr       = (uint64_t) (uintptr_t) request;
+        
+        _wi_io_engine_ring_commit_sqe(engine);
+    }
+    
+    /* The kernel may still write into a request until its completion has been
+       posted, so every one is waited for before it is freed. Callbacks are not
+       run, the engine is going away. */
+    while(engine->in_flight) {
+        if(_wi_io_engine_ring_enter(engine, ring->sq_pending, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+            break;
+        
+        head = *ring->cq_head;
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        
+        while(head != tail) {
+            cqe = &ring->cqes[head & *ring->cq_mask];
+            request = (_wi_io_engine_request_t *) (uintptr_t) cqe->user_data;
+            
+            if(request) {
+                _wi_io_engine_ring_remove_request(engine, request);
+                
+                wi_release(request->instance);
+                wi_free(request);
+            }
+            
+            head++;
+        }
+        
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+
+
+static wi_integer_t _wi_io_engine_ring_submit(wi_io_engine_t *engine) {
+    int     result;
+    
+    if(engine->ring.sq_pending == 0)
+        return 0;
+    
+    result = _wi_io_engine_ring_enter(engine, engine->ring.sq_pending, 0, 0, NULL, 0);
+    
+    if(result < 0) {
+        wi_error_set_errno(errno);
+        
+        return -1;
+    }
+    
+    return result;
+}
+
+
+
+static wi_integer_t _wi_io_engine_ring_wait(wi_io_engine_t *engine, wi_time_interval_t timeout) {
+    _wi_io_engine_ring_t                *ring = &engine->ring;
+    struct io_uring_cqe                 *cqe;
+    struct io_uring_sqe                 *sqe;
+    struct io_uring_getevents_arg       argument;
+    struct __kernel_timespec            ts;
+    _wi_io_engine_request_t             *request;
+    unsigned int                        head, tail;
+    int                                 result;
+    
+    head = *ring->cq_head;
+    tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    
+    if(head != tail) {
+        if(_wi_io_engine_ring_submit(engine) < 0)
+            return -1;
+    } else {
+        if(timeout > 0.0) {
+            ts.tv_sec   = (long long) timeout;
+            ts.tv_nsec  = (long long) ((timeout - (long long) timeout) * 1000000000.0);
+            
+            if(ring->features & IORING_FEAT_EXT_ARG) {
+                memset(&argument, 0, sizeof(argument));
+                
+                argument.ts = (uint64_t) (uintptr_t) &ts;
+                
+                result = _wi_io_engine_ring_enter(engine, ring->sq_pending, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &argument, sizeof(argument));
+            } else {
+                sqe = _wi_io_engine_ring_next_sqe(engine);
+                
+                if(!sqe)
+                    return -1;
+                
+                sqe->opcode     = IORING_OP_TIMEOUT;
+                sqe->fd         = -1;
+                sqe->addr       = (uint64_t) (uintptr_t) &ts;
+                sqe->len        = 1;
+                
+                _wi_io_engine_ring_commit_sqe(engine);
+                
+                result = _wi_io_engine_ring_enter(engine, ring->sq_pending, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            }
+        } else {
+            result = _wi_io_engine_ring_enter(engine, ring->sq_pending, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        }
+        
+        if(result < 0 && errno != ETIME) {
+            wi_error_set_errno(errno);
+            
+            return -1;
+        }
+        
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    }
+    
+    while(head != tail) {
+        cqe = &ring->cqes[head & *ring->cq_mask];
+        request = (_wi_io_engine_request_t *) (uintptr_t) cqe->user_data;
+        
+        /* Timeout and cancel entries carry no request */
+        if(request) {
+            request->result = cqe->res;
+            
+            _wi_io_engine_ring_remove_request(engine, request);
+            _wi_io_engine_complete_request(engine, request);
+        }
+        
+        head++;
+    }
+    
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    
+    return _wi_io_engine_deliver_completions(engine);
+}
+
+#endif
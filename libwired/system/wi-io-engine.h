@@ -0,0 +1,71 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WI_IO_ENGINE_H
+#define WI_IO_ENGINE_H 1
+
+#include <sys/uio.h>
+#include <wired/wi-base.h>
+#include <wired/wi-file.h>
+#include <wired/wi-runtime.h>
+
+enum _wi_io_engine_backend {
+    WI_IO_ENGINE_AUTOMATIC          = 0,
+    WI_IO_ENGINE_IO_URING,
+    WI_IO_ENGINE_POLL
+};
+typedef enum _wi_io_engine_backend  wi_io_engine_backend_t;
+
+
+typedef void                        wi_io_engine_func_t(wi_io_engine_t *, wi_integer_t, void *);
+
+
+WI_EXPORT wi_runtime_id_t           wi_io_engine_runtime_id(void);
+
+WI_EXPORT wi_io_engine_t *          wi_io_engine(void);
+
+WI_EXPORT wi_io_engine_t *          wi_io_engine_alloc(void);
+WI_EXPORT wi_io_engine_t *          wi_io_engine_init(wi_io_engine_t *);
+WI_EXPORT wi_io_engine_t *          wi_io_engine_init_with_backend(wi_io_engine_t *, wi_io_engine_backend_t);
+
+WI_EXPORT wi_io_engine_backend_t    wi_io_engine_backend(wi_io_engine_t *);
+WI_EXPORT wi_uinteger_t             wi_io_engine_pending_count(wi_io_engine_t *);
+
+WI_EXPORT wi_boolean_t              wi_io_engine_register_buffers(wi_io_engine_t *, const struct iovec *, wi_uinteger_t);
+
+WI_EXPORT wi_boolean_t              wi_io_engine_read_file(wi_io_engine_t *, wi_file_t *, void *, wi_uinteger_t, wi_file_offset_t, wi_io_engine_func_t *, void *);
+WI_EXPORT wi_boolean_t              wi_io_engine_write_file(wi_io_engine_t *, wi_file_t *, const void *, wi_uinteger_t, wi_file_offset_t, wi_io_engine_func_t *, void *);
+WI_EXPORT wi_boolean_t              wi_io_engine_synchronize_file(wi_io_engine_t *, wi_file_t *, wi_io_engine_func_t *, void *);
+
+WI_EXPORT wi_boolean_t              wi_io_engine_read_socket(wi_io_engine_t *, wi_socket_t *, void *, wi_uinteger_t, wi_io_engine_func_t *, void *);
+WI_EXPORT wi_boolean_t              wi_io_engine_write_socket(wi_io_engine_t *, wi_socket_t *, const void *, wi_uinteger_t, wi_io_engine_func_t *, void *);
+WI_EXPORT wi_boolean_t              wi_io_engine_accept_socket(wi_io_engine_t *, wi_socket_t *, wi_io_engine_func_t *, void *);
+WI_EXPORT wi_boolean_t              wi_io_engine_connect_socket(wi_io_engine_t *, wi_socket_t *, wi_io_engine_func_t *, void *);
+
+WI_EXPORT wi_integer_t              wi_io_engine_submit(wi_io_engine_t *);
+WI_EXPORT wi_integer_t              wi_io_engine_wait_for_completions(wi_io_engine_t *, wi_time_interval_t);
+
+#endif /* WI_IO_ENGINE_H */
@@ -44,21 +44,59 @@
 
 #include <wired/wi-base.h>
 #include <wired/wi-compat.h>
+#include <wired/wi-dictionary.h>
+#include <wired/wi-fast-lock.h>
 #include <wired/wi-file.h>
 #include <wired/wi-log.h>
+#include <wired/wi-null.h>
+#include <wired/wi-number.h>
 #include <wired/wi-process.h>
 #include <wired/wi-private.h>
-#include <wired/wi-recursive-lock.h>
+#include <wired/wi-runtime.h>
 #include <wired/wi-string.h>
 #include <wired/wi-system.h>
 
 #define _WI_LOG_DATE_SIZE           32
+#define _WI_LOG_JSON_BUFFER_SIZE    512
 
+#define _WI_LOG_LEVEL_INHERIT       -1
 
-static void                         _wi_log_vlog(wi_log_level_t, wi_string_t *, va_list);
+
+struct _wi_log_category {
+    wi_runtime_base_t               base;
+    
+    wi_string_t                     *name;
+    wi_integer_t                    level;
+};
+
+
+struct _wi_log_json_buffer {
+    char                            *bytes;
+    wi_uinteger_t                   length;
+    wi_uinteger_t                   capacity;
+    char                            buffer[_WI_LOG_JSON_BUFFER_SIZE];
+};
+typedef struct _wi_log_json_buffer  _wi_log_json_buffer_t;
+
+
+static void                         _wi_log_category_dealloc(wi_runtime_instance_t *);
+static wi_string_t *                _wi_log_category_description(wi_runtime_instance_t *);
+
+static wi_boolean_t                 _wi_log_is_enabled(wi_log_category_t *, wi_log_level_t);
+static void                         _wi_log_vlog(wi_log_category_t *, wi_log_level_t, wi_string_t *, va_list);
+static void                         _wi_log_write(wi_log_category_t *, wi_log_level_t, wi_string_t *, _wi_log_json_buffer_t *);
+static const char *                 _wi_log_level_name(wi_log_level_t);
 static void                         _wi_log_get_date(char *);
+static void                         _wi_log_get_json_date(char *);
 static void                         _wi_log_truncate_file(const char *);
 
+static void                         _wi_log_json_buffer_init(_wi_log_json_buffer_t *);
+static void                         _wi_log_json_buffer_destroy(_wi_log_json_buffer_t *);
+static void                         _wi_log_json_buffer_append_bytes(_wi_log_json_buffer_t *, const char *, wi_uinteger_t);
+static void                         _wi_log_json_buffer_append_quoted_string(_wi_log_json_buffer_t *, const char *);
+static void                         _wi_log_json_buffer_append_field(_wi_log_json_buffer_t *, const char *, const char *);
+static void                         _wi_log_json_buffer_append_instance(_wi_log_json_buffer_t *, wi_runtime_instance_t *);
+
 
 static wi_log_level_t               _wi_log_level = WI_LOG_INFO;
 
@@ -76,18 +114,122 @@ static wi_boolean_t                 _wi_log_callback_enabled;
 wi_log_callback_func_t              *_wi_log_callback_function;
 
 static wi_uinteger_t                _wi_log_file_lines;
-static wi_recursive_lock_t          *_wi_log_file_lock;
+static wi_fast_lock_t               _wi_log_file_lock = WI_FAST_LOCK_INITIALIZER;
 static wi_boolean_t                 _wi_log_in_callback;
 
+static wi_mutable_dictionary_t      *_wi_log_categories;
+static wi_fast_lock_t               _wi_log_categories_lock = WI_FAST_LOCK_INITIALIZER;
+
+static wi_runtime_id_t              _wi_log_category_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t           _wi_log_category_runtime_class = {
+    "wi_log_category_t",
+    _wi_log_category_dealloc,
+    NULL,
+    NULL,
+    _wi_log_category_description,
+    NULL
+};
+
 
 
 void wi_log_register(void) {
+    _wi_log_category_runtime_id = wi_runtime_register_class(&_wi_log_category_runtime_class);
 }
 
 
 
 void wi_log_initialize(void) {
-    _wi_log_file_lock = wi_recursive_lock_init(wi_recursive_lock_alloc());
+    _wi_log_categories = wi_dictionary_init(wi_mutable_dictionary_alloc());
+}
+
+
+
+#pragma mark -
+
+wi_runtime_id_t wi_log_category_runtime_id(void) {
+    return _wi_log_category_runtime_id;
+}
+
+
+
+#pragma mark -
+
+wi_log_category_t * wi_log_category_with_name(wi_string_t *name) {
+    wi_log_category_t   *category;
+    
+    wi_fast_lock_lock(&_wi_log_categories_lock);
+    
+    category = wi_dictionary_data_for_key(_wi_log_categories, name);
+    
+    if(!category) {
+        category = wi_runtime_create_instance(_wi_log_category_runtime_id, sizeof(wi_log_category_t));
+        category->name = wi_copy(name);
+        category->level = _WI_LOG_LEVEL_INHERIT;
+        
+        wi_mutable_dictionary_set_data_for_key(_wi_log_categories, category, name);
+        wi_release(category);
+    }
+    
+    wi_fast_lock_unlock(&_wi_log_categories_lock);
+    
+    return category;
+}
+
+
+
+#pragma mark -
+
+static void _wi_log_category_dealloc(wi_runtime_instance_t *instance) {
+    wi_log_category_t   *category = instance;
+    
+    wi_release(category->name);
+}
+
+
+
+static wi_string_t * _wi_log_category_description(wi_runtime_instance_t *instance) {
+    wi_log_category_t   *category = instance;
+    
+    return wi_string_with_format(WI_STR("<%@ %p>{name = %@, level = %d}"),
+        wi_runtime_class_name(category),
+        category,
+        category->name,
+        wi_log_category_level(category));
+}
+
+
+
+#pragma mark -
+
+wi_string_t * wi_log_category_name(wi_log_category_t *category) {
+    return category->name;
+}
+
+
+
+void wi_log_category_set_level(wi_log_category_t *category, wi_log_level_t level) {
+    category->level = level;
+}
+
+
+
+void wi_log_category_reset_level(wi_log_category_t *category) {
+    category->level = _WI_LOG_LEVEL_INHERIT;
+}
+
+
+
+wi_log_level_t wi_log_category_level(wi_log_category_t *category) {
+    if(category->level == _WI_LOG_LEVEL_INHERIT)
+        return _wi_log_level;
+    
+    return category->level;
+}
+
+
+
+wi_boolean_t wi_log_category_is_enabled(wi_log_category_t *category, wi_log_level_t level) {
+    return _wi_log_is_enabled(category, level);
 }
 
 
@@ -106,6 +248,12 @@ wi_log_level_t wi_log_level(void) {
 
 
 
+wi_boolean_t wi_log_is_enabled(wi_log_level_t level) {
+    return _wi_log_is_enabled(NULL, level);
+}
+
+
+
 #pragma mark -
 
 void wi_log_add_stdout_logger(wi_log_style_t style) {
@@ -209,21 +357,59 @@ int wi_log_syslog_facility_with_name(wi_string_t *name) {
 
 #pragma mark -
 
-static void _wi_log_vlog(wi_log_level_t level, wi_string_t *fmt, va_list ap) {
-    wi_string_t     *string;
-    FILE            *fp = NULL;
-    const char      *utf8string, *name, *path, *prefix;
-    char            date[_WI_LOG_DATE_SIZE];
-    int             priority;
-    
+static wi_boolean_t _wi_log_is_enabled(wi_log_category_t *category, wi_log_level_t level) {
     if(_wi_log_in_callback)
-        return;
+        return false;
+    
+    if(level == WI_LOG_FATAL)
+        return true;
+    
+    if(level > (category ? wi_log_category_level(category) : _wi_log_level))
+        return false;
+    
+    return (_wi_log_stdout_enabled || _wi_log_file_enabled || _wi_log_syslog_enabled || _wi_log_callback_enabled);
+}
+
+
+
+static void _wi_log_vlog(wi_log_category_t *category, wi_log_level_t level, wi_string_t *fmt, va_list ap) {
+    wi_string_t     *string;
     
     string = wi_string_init_with_format_and_arguments(wi_string_alloc(), fmt, ap);
-    utf8string = wi_string_utf8_string(string);
+    
+    _wi_log_write(category, level, string, NULL);
+    
+    if(level == WI_LOG_FATAL)
+        exit(1);
+
+    wi_release(string);
+}
+
+
+
+static void _wi_log_write(wi_log_category_t *category, wi_log_level_t level, wi_string_t *message, _wi_log_json_buffer_t *fields) {
+    _wi_log_json_buffer_t   json, *record;
+    wi_string_t             *string = NULL;
+    FILE                    *fp = NULL;
+    const char              *utf8string, *name, *path, *prefix;
+    char                    date[_WI_LOG_DATE_SIZE];
+    int                     priority;
+    
+    if(fields) {
+        utf8string = fields->bytes;
+    }
+    else if(category) {
+        string = wi_string_init_with_format(wi_string_alloc(), WI_STR("[%@] %@"), category->name, message);
+        utf8string = wi_string_utf8_string(string);
+    }
+    else {
+        utf8string = wi_string_utf8_string(message);
+    }
+    
     name = wi_string_utf8_string(wi_process_name(wi_process()));
     
-    _wi_log_get_date(date);
+    if((_wi_log_stdout_enabled && _wi_log_stdout_style == WI_LOG_DAEMON) || _wi_log_file_enabled)
+        _wi_log_get_date(date);
     
     switch(level) {
         default:
@@ -262,6 +448,30 @@ static void _wi_log_vlog(wi_log_level_t level, wi_string_t *fmt, va_list ap) {
             case WI_LOG_TOOL:
                 printf("%s: %s\n", name, utf8string);
                 break;
+                
+            case WI_LOG_JSON:
+                record = fields;
+                
+                if(!record) {
+                    record = &json;
+                    
+                    _wi_log_json_buffer_init(record);
+                    _wi_log_json_buffer_append_field(record, "message", wi_string_utf8_string(message));
+                    
+                    if(category)
+                        _wi_log_json_buffer_append_field(record, "category", wi_string_utf8_string(category->name));
+                    
+                    _wi_log_json_buffer_append_bytes(record, "}", 1);
+                }
+                
+                _wi_log_get_json_date(date);
+                
+                printf("{\"time\":\"%s\",\"level\":\"%s\",\"process\":\"%s\",%s\n",
+                       date, _wi_log_level_name(level), name, record->bytes + 1);
+                
+                if(record != fields)
+                    _wi_log_json_buffer_destroy(record);
+                break;
         }
         
         fflush(stdout);
@@ -271,7 +481,7 @@ static void _wi_log_vlog(wi_log_level_t level, wi_string_t *fmt, va_list ap) {
         syslog(priority, "%s", utf8string);
 
     if(_wi_log_file_enabled) {
-        wi_recursive_lock_lock(_wi_log_file_lock);
+        wi_fast_lock_lock(&_wi_log_file_lock);
 
         path = wi_string_utf8_string(_wi_log_file_path);
 
@@ -294,23 +504,41 @@ static void _wi_log_vlog(wi_log_level_t level, wi_string_t *fmt, va_list ap) {
             fprintf(stderr, "%s: %s: %s\n", name, path, strerror(errno));
         }
 
-        wi_recursive_lock_unlock(_wi_log_file_lock);
+        wi_fast_lock_unlock(&_wi_log_file_lock);
     }
 
     if(_wi_log_callback_enabled) {
+        if(!string) {
+            if(fields)
+                string = wi_string_init_with_utf8_bytes(wi_string_alloc(), fields->bytes, fields->length);
+            else
+                string = wi_retain(message);
+        }
+        
         _wi_log_in_callback = true;
         (*_wi_log_callback_function)(level, string);
         _wi_log_in_callback = false;
     }
     
-    if(level == WI_LOG_FATAL)
-        exit(1);
-
     wi_release(string);
 }
 
 
 
+static const char * _wi_log_level_name(wi_log_level_t level) {
+    switch(level) {
+        case WI_LOG_FATAL:  return "fatal";
+        case WI_LOG_ERROR:  return "error";
+        case WI_LOG_WARN:   return "warn";
+        case WI_LOG_INFO:   return "info";
+        case WI_LOG_DEBUG:  return "debug";
+    }
+    
+    return "info";
+}
+
+
+
 static void _wi_log_get_date(char *string) {
     struct tm   tm;
     time_t      now;
@@ -322,6 +550,17 @@ static void _wi_log_get_date(char *string) {
 
 
 
+static void _wi_log_get_json_date(char *string) {
+    struct tm   tm;
+    time_t      now;
+
+    now = time(NULL);
+    localtime_r(&now, &tm);
+    strftime(string, _WI_LOG_DATE_SIZE, "%Y-%m-%dT%H:%M:%S%z", &tm);
+}
+
+
+
 static void _wi_log_truncate_file(const char *path) {
     wi_file_t       *file = NULL;
     FILE            *fp = NULL, *tmp = NULL;
@@ -387,14 +626,160 @@ end:
 
 
 
+#pragma mark -
+
+static void _wi_log_json_buffer_init(_wi_log_json_buffer_t *buffer) {
+    buffer->bytes       = buffer->buffer;
+    buffer->capacity    = sizeof(buffer->buffer);
+    buffer->length      = 1;
+    buffer->bytes[0]    = '{';
+    buffer->bytes[1]    = '\0';
+}
+
+
+
+static void _wi_log_json_buffer_destroy(_wi_log_json_buffer_t *buffer) {
+    if(buffer->bytes != buffer->buffer)
+        wi_free(buffer->bytes);
+}
+
+
+
+static void _wi_log_json_buffer_append_bytes(_wi_log_json_buffer_t *buffer, const char *bytes, wi_uinteger_t length) {
+    wi_uinteger_t   capacity;
+    
+    if(buffer->length + length + 1 > buffer->capacity) {
+        capacity = WI_MAX(buffer->capacity * 2, buffer->length + length + 1);
+        
+        if(buffer->bytes == buffer->buffer) {
+            buffer->bytes = wi_malloc(capacity);
+            
+            memcpy(buffer->bytes, buffer->buffer, buffer->length);
+        } else {
+            buffer->bytes = wi_realloc(buffer->bytes, capacity);
+        }
+        
+        buffer->capacity = capacity;
+    }
+    
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    
+    buffer->length += length;
+    buffer->bytes[buffer->length] = '\0';
+}
+
+
+
+static void _wi_log_json_buffer_append_quoted_string(_wi_log_json_buffer_t *buffer, const char *string) {
+    const char      *run;
+    char            escape[7];
+    unsigned char   ch;
+    
+    _wi_log_json_buffer_append_bytes(buffer, "\"", 1);
+    
+    for(run = string; (ch = *string) != '\0'; string++) {
+        if(ch >= 0x20 && ch != '"' && ch != '\\')
+            continue;
+        
+        if(string > run)
+            _wi_log_json_buffer_append_bytes(buffer, run, string - run);
+        
+        switch(ch) {
+            case '"':   _wi_log_json_buffer_append_bytes(buffer, "\\\"", 2);    break;
+            case '\\':  _wi_log_json_buffer_append_bytes(buffer, "\\\\", 2);    break;
+            case '\n':  _wi_log_json_buffer_append_bytes(buffer, "\\n", 2);     break;
+            case '\r':  _wi_log_json_buffer_append_bytes(buffer, "\\r", 2);     break;
+            case '\t':  _wi_log_json_buffer_append_bytes(buffer, "\\t", 2);     break;
+                
+            default:
+                snprintf(escape, sizeof(escape), "\\u%04x", ch);
+                
+                _wi_log_json_buffer_append_bytes(buffer, escape, 6);
+                break;
+        }
+        
+        run = string + 1;
+    }
+    
+    if(string > run)
+        _wi_log_json_buffer_append_bytes(buffer, run, string - run);
+    
+    _wi_log_json_buffer_append_bytes(buffer, "\"", 1);
+}
+
+
+
+static void _wi_log_json_buffer_append_field(_wi_log_json_buffer_t *buffer, const char *key, const char *value) {
+    if(buffer->length > 1)
+        _wi_log_json_buffer_append_bytes(buffer, ",", 1);
+    
+    _wi_log_json_buffer_append_quoted_string(buffer, key);
+    _wi_log_json_buffer_append_bytes(buffer, ":", 1);
+    
+    if(value)
+        _wi_log_json_buffer_append_quoted_string(buffer, value);
+}
+
+
+
+static void _wi_log_json_buffer_append_instance(_wi_log_json_buffer_t *buffer, wi_runtime_instance_t *instance) {
+    wi_runtime_id_t     id;
+    char                number[32];
+    double              d;
+    int                 length;
+    
+    id = instance ? wi_runtime_id(instance) : WI_RUNTIME_ID_NULL;
+    
+    if(id == WI_RUNTIME_ID_NULL || id == wi_null_runtime_id()) {
+        _wi_log_json_buffer_append_bytes(buffer, "null", 4);
+    }
+    else if(id == wi_string_runtime_id()) {
+        _wi_log_json_buffer_append_quoted_string(buffer, wi_string_utf8_string(instance));
+    }
+    else if(id == wi_number_runtime_id()) {
+        switch(wi_number_type(instance)) {
+            case WI_NUMBER_BOOL:
+                if(wi_number_bool(instance))
+                    _wi_log_json_buffer_append_bytes(buffer, "true", 4);
+                else
+                    _wi_log_json_buffer_append_bytes(buffer, "false", 5);
+                break;
+                
+            case WI_NUMBER_FLOAT:
+            case WI_NUMBER_DOUBLE:
+                d = wi_number_double(instance);
+                
+                if(isfinite(d)) {
+                    length = snprintf(number, sizeof(number), "%.17g", d);
+                    
+                    _wi_log_json_buffer_append_bytes(buffer, number, length);
+                } else {
+                    _wi_log_json_buffer_append_bytes(buffer, "null", 4);
+                }
+                break;
+                
+            default:
+                length = snprintf(number, sizeof(number), "%lld", (long long) wi_number_int64(instance));
+                
+                _wi_log_json_buffer_append_bytes(buffer, number, length);
+                break;
+        }
+    }
+    else {
+        _wi_log_json_buffer_append_quoted_string(buffer, wi_string_utf8_string(wi_description(instance)));
+    }
+}
+
+
+
 #pragma mark -
 
 void wi_log_debug(wi_string_t *fmt, ...) {
     va_list     ap;
 
-    if(_wi_log_level >= WI_LOG_DEBUG) {
+    if(_wi_log_is_enabled(NULL, WI_LOG_DEBUG)) {
         va_start(ap, fmt);
-        _wi_log_vlog(WI_LOG_DEBUG, fmt, ap);
+        _wi_log_vlog(NULL, WI_LOG_DEBUG, fmt, ap);
         va_end(ap);
     }
 }
@@ -404,9 +789,9 @@ void wi_log_debug(wi_string_t *fmt, ...) {
 void wi_log_info(wi_string_t *fmt, ...) {
     va_list     ap;
 
-    if(_wi_log_level >= WI_LOG_INFO) {
+    if(_wi_log_is_enabled(NULL, WI_LOG_INFO)) {
         va_start(ap, fmt);
-        _wi_log_vlog(WI_LOG_INFO, fmt, ap);
+        _wi_log_vlog(NULL, WI_LOG_INFO, fmt, ap);
         va_end(ap);
     }
 }
@@ -416,9 +801,9 @@ void wi_log_info(wi_string_t *fmt, ...) {
 void wi_log_warn(wi_string_t *fmt, ...) {
     va_list     ap;
 
-    if(_wi_log_level >= WI_LOG_WARN) {
+    if(_wi_log_is_enabled(NULL, WI_LOG_WARN)) {
         va_start(ap, fmt);
-        _wi_log_vlog(WI_LOG_WARN, fmt, ap);
+        _wi_log_vlog(NULL, WI_LOG_WARN, fmt, ap);
         va_end(ap);
     }
 }
@@ -428,9 +813,9 @@ void wi_log_warn(wi_string_t *fmt, ...) {
 void wi_log_error(wi_string_t *fmt, ...) {
     va_list     ap;
 
-    if(_wi_log_level >= WI_LOG_ERROR) {
+    if(_wi_log_is_enabled(NULL, WI_LOG_ERROR)) {
         va_start(ap, fmt);
-        _wi_log_vlog(WI_LOG_ERROR, fmt, ap);
+        _wi_log_vlog(NULL, WI_LOG_ERROR, fmt, ap);
         va_end(ap);
     }
 }
@@ -440,7 +825,61 @@ void wi_log_error(wi_string_t *fmt, ...) {
 void wi_log_fatal(wi_string_t *fmt, ...) {
     va_list     ap;
 
-    va_start(ap, fmt);
-    _wi_log_vlog(WI_LOG_FATAL, fmt, ap);
+    if(_wi_log_is_enabled(NULL, WI_LOG_FATAL)) {
+        va_start(ap, fmt);
+        _wi_log_vlog(NULL, WI_LOG_FATAL, fmt, ap);
+        va_end(ap);
+    }
+}
+
+
+
+#pragma mark -
+
+void wi_log_category_log(wi_log_category_t *category, wi_log_level_t level, wi_string_t *fmt, ...) {
+    va_list     ap;
+    
+    if(_wi_log_is_enabled(category, level)) {
+        va_start(ap, fmt);
+        _wi_log_vlog(category, level, fmt, ap);
+        va_end(ap);
+    }
+}
+
+
+
+void wi_log_structured(wi_log_category_t *category, wi_log_level_t level, wi_string_t *message, ...) {
+    _wi_log_json_buffer_t   buffer;
+    wi_runtime_instance_t   *value;
+    const char              *key;
+    va_list                 ap;
+    
+    if(!_wi_log_is_enabled(category, level))
+        return;
+    
+    _wi_log_json_buffer_init(&buffer);
+    _wi_log_json_buffer_append_field(&buffer, "message", wi_string_utf8_string(message));
+    
+    if(category)
+        _wi_log_json_buffer_append_field(&buffer, "category", wi_string_utf8_string(category->name));
+    
+    va_start(ap, message);
+    
+    while((key = va_arg(ap, const char *))) {
+        value = va_arg(ap, wi_runtime_instance_t *);
+        
+        _wi_log_json_buffer_append_field(&buffer, key, NULL);
+        _wi_log_json_buffer_append_instance(&buffer, value);
+    }
+    
     va_end(ap);
+    
+    _wi_log_json_buffer_append_bytes(&buffer, "}", 1);
+    
+    _wi_log_write(category, level, message, &buffer);
+    
+    if(level == WI_LOG_FATAL)
+        exit(1);
+    
+    _wi_log_json_buffer_destroy(&buffer);
 }
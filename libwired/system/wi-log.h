@@ -45,7 +45,8 @@ typedef enum _wi_log_level          wi_log_level_t;
 
 enum _wi_log_style {
     WI_LOG_DAEMON,
-    WI_LOG_TOOL
+    WI_LOG_TOOL,
+    WI_LOG_JSON
 };
 typedef enum _wi_log_style          wi_log_style_t;
 
@@ -53,8 +54,19 @@ typedef enum _wi_log_style          wi_log_style_t;
 typedef void                        wi_log_callback_func_t(wi_log_level_t, wi_string_t *);
 
 
+WI_EXPORT wi_runtime_id_t           wi_log_category_runtime_id(void);
+
+WI_EXPORT wi_log_category_t *       wi_log_category_with_name(wi_string_t *);
+
+WI_EXPORT wi_string_t *             wi_log_category_name(wi_log_category_t *);
+WI_EXPORT void                      wi_log_category_set_level(wi_log_category_t *, wi_log_level_t);
+WI_EXPORT void                      wi_log_category_reset_level(wi_log_category_t *);
+WI_EXPORT wi_log_level_t            wi_log_category_level(wi_log_category_t *);
+WI_EXPORT wi_boolean_t              wi_log_category_is_enabled(wi_log_category_t *, wi_log_level_t);
+
 WI_EXPORT void                      wi_log_set_level(wi_log_level_t);
 WI_EXPORT wi_log_level_t            wi_log_level(void);
+WI_EXPORT wi_boolean_t              wi_log_is_enabled(wi_log_level_t);
 
 WI_EXPORT void                      wi_log_add_stdout_logger(wi_log_style_t);
 WI_EXPORT void                      wi_log_remove_stdout_logger(void);
@@ -73,4 +85,7 @@ WI_EXPORT void                      wi_log_warn(wi_string_t *, ...);
 WI_EXPORT void                      wi_log_error(wi_string_t *, ...);
 WI_EXPORT void                      wi_log_fatal(wi_string_t *, ...);
 
+WI_EXPORT void                      wi_log_category_log(wi_log_category_t *, wi_log_level_t, wi_string_t *, ...);
+WI_EXPORT void                      wi_log_structured(wi_log_category_t *, wi_log_level_t, wi_string_t *, ...) WI_SENTINEL;
+
 #endif /* WI_LOG_H */
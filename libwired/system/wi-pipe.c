@@ -36,11 +36,16 @@
 #include <dirent.h>
 
 #include <wired/wi-assert.h>
+#include <wired/wi-data.h>
+#include <wired/wi-macros.h>
 #include <wired/wi-pipe.h>
 #include <wired/wi-pool.h>
 #include <wired/wi-private.h>
 #include <wired/wi-runtime.h>
 #include <wired/wi-string.h>
+#include <wired/wi-system.h>
+
+#define _WI_PIPE_MAX_CHUNK_SIZE             (1024 * 1024)
 
 #define _WI_PIPE_ASSERT_OPEN(pipe) \
     WI_ASSERT((pipe)->rd >= 0 && (pipe)->wd >= 0, "%@ is not open", (pipe))
@@ -160,60 +165,57 @@ int wi_pipe_descriptor_for_writing(wi_pipe_t *pipe) {
 #pragma mark -
 
 wi_data_t * wi_pipe_read(wi_pipe_t *pipe, wi_uinteger_t length) {
-    wi_mutable_data_t   *data;
-    char                buffer[WI_PIPE_BUFFER_SIZE];
-    wi_integer_t        bytes = -1;
+    char                *buffer;
+    wi_integer_t        bytes;
     
     _WI_PIPE_ASSERT_OPEN(pipe);
     
-    data = wi_data_init_with_capacity(wi_mutable_data_alloc(), length);
-    
-    while(length > 0) {
-        bytes = wi_pipe_read_bytes(pipe, buffer, WI_MIN(sizeof(buffer), length));
-        
-        if(bytes <= 0)
-            break;
-        
-        wi_mutable_data_append_bytes(data, buffer, bytes);
-        
-        length -= bytes;
-    }
+    buffer  = wi_malloc(WI_MAX(length, 1));
+    bytes   = wi_pipe_read_bytes(pipe, buffer, length);
     
     if(bytes < 0) {
-        wi_release(data);
+        wi_free(buffer);
         
-        data = NULL;
+        return NULL;
     }
     
-    wi_runtime_make_immutable(data);
-    
-    return wi_autorelease(data);
+    return wi_autorelease(wi_data_init_with_bytes_no_copy(wi_data_alloc(), buffer, bytes, true));
 }
 
 
 
 wi_data_t * wi_pipe_read_to_end_of_pipe(wi_pipe_t *pipe) {
     wi_mutable_data_t   *data;
-    char                buffer[WI_PIPE_BUFFER_SIZE];
+    char                *buffer;
+    wi_uinteger_t       length;
     wi_integer_t        bytes;
     
     _WI_PIPE_ASSERT_OPEN(pipe);
     
-    data = wi_data_init_with_capacity(wi_mutable_data_alloc(), WI_PIPE_BUFFER_SIZE);
+    /* Read straight into chunks that the data adopts, they are only copied if the data is flattened */
+    data    = wi_data_init_with_capacity(wi_mutable_data_alloc(), 0);
+    length  = WI_PIPE_BUFFER_SIZE;
     
     while(true) {
-        bytes = wi_pipe_read_bytes(pipe, buffer, sizeof(buffer));
+        buffer  = wi_malloc(length);
+        bytes   = wi_pipe_read_bytes(pipe, buffer, length);
         
-        if(bytes <= 0)
+        if(bytes <= 0) {
+            wi_free(buffer);
+            
             break;
+        }
+        
+        wi_mutable_data_append_bytes_no_copy(data, buffer, bytes);
         
-        wi_mutable_data_append_bytes(data, buffer, bytes);
+        if(length < _WI_PIPE_MAX_CHUNK_SIZE)
+            length *= 2;
     }
     
     if(bytes < 0) {
         wi_release(data);
         
-        data = NULL;
+        return NULL;
     }
     
     wi_runtime_make_immutable(data);
@@ -256,6 +258,23 @@ wi_integer_t wi_pipe_read_bytes(wi_pipe_t *pipe, void *buffer, wi_uinteger_t len
 
 
 
+wi_integer_t wi_pipe_read_available_bytes(wi_pipe_t *pipe, void *buffer, wi_uinteger_t length) {
+    wi_integer_t    bytes;
+    
+    _WI_PIPE_ASSERT_OPEN(pipe);
+    
+    do {
+        bytes = read(pipe->rd, buffer, length);
+    } while(bytes < 0 && errno == EINTR);
+    
+    if(bytes < 0)
+        wi_error_set_errno(errno);
+    
+    return bytes;
+}
+
+
+
 #pragma mark -
 
 wi_integer_t wi_pipe_write(wi_pipe_t *pipe, wi_data_t *data) {
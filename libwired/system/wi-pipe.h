@@ -46,6 +46,7 @@ WI_EXPORT int                       wi_pipe_descriptor_for_writing(wi_pipe_t *);
 WI_EXPORT wi_data_t *               wi_pipe_read(wi_pipe_t *, wi_uinteger_t);
 WI_EXPORT wi_data_t *               wi_pipe_read_to_end_of_pipe(wi_pipe_t *);
 WI_EXPORT wi_integer_t              wi_pipe_read_bytes(wi_pipe_t *, void *, wi_uinteger_t);
+WI_EXPORT wi_integer_t              wi_pipe_read_available_bytes(wi_pipe_t *, void *, wi_uinteger_t);
 
 WI_EXPORT wi_integer_t              wi_pipe_write(wi_pipe_t *, wi_data_t *);
 WI_EXPORT wi_integer_t              wi_pipe_write_bytes(wi_pipe_t *, const void *, wi_uinteger_t);
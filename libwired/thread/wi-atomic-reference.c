@@ -0,0 +1,236 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <sched.h>
+
+#include <wired/wi-atomic-reference.h>
+#include <wired/wi-fast-lock.h>
+#include <wired/wi-pool.h>
+#include <wired/wi-private.h>
+#include <wired/wi-runtime.h>
+#include <wired/wi-string.h>
+
+#define _WI_ATOMIC_REFERENCE_SPINS_MAX      100
+
+
+struct _wi_atomic_reference {
+    wi_runtime_base_t                   base;
+    
+    wi_runtime_instance_t * volatile    instance;
+    
+    volatile wi_uinteger_t              epoch;
+    volatile wi_uinteger_t              readers[2];
+    
+    wi_fast_lock_t                      writer_lock;
+};
+
+
+static void                             _wi_atomic_reference_dealloc(wi_runtime_instance_t *);
+static wi_string_t *                    _wi_atomic_reference_description(wi_runtime_instance_t *);
+
+static wi_runtime_instance_t *          _wi_atomic_reference_snapshot(wi_runtime_instance_t *);
+static void                             _wi_atomic_reference_publish(wi_atomic_reference_t *, wi_runtime_instance_t *);
+
+
+static wi_runtime_id_t                  _wi_atomic_reference_runtime_id = WI_RUNTIME_ID_NULL;
+static wi_runtime_class_t               _wi_atomic_reference_runtime_class = {
+    "wi_atomic_reference_t",
+    _wi_atomic_reference_dealloc,
+    NULL,
+    NULL,
+    _wi_atomic_reference_description,
+    NULL
+};
+
+
+
+void wi_atomic_reference_register(void) {
+    _wi_atomic_reference_runtime_id = wi_runtime_register_class(&_wi_atomic_reference_runtime_class);
+}
+
+
+
+void wi_atomic_reference_initialize(void) {
+}
+
+
+
+#pragma mark -
+
+wi_runtime_id_t wi_atomic_reference_runtime_id(void) {
+    return _wi_atomic_reference_runtime_id;
+}
+
+
+
+#pragma mark -
+
+wi_atomic_reference_t * wi_atomic_reference_with_instance(wi_runtime_instance_t *instance) {
+    return wi_autorelease(wi_atomic_reference_init_with_instance(wi_atomic_reference_alloc(), instance));
+}
+
+
+
+#pragma mark -
+
+wi_atomic_reference_t * wi_atomic_reference_alloc(void) {
+    return wi_runtime_create_instance(_wi_atomic_reference_runtime_id, sizeof(wi_atomic_reference_t));
+}
+
+
+
+wi_atomic_reference_t * wi_atomic_reference_init(wi_atomic_reference_t *reference) {
+    return wi_atomic_reference_init_with_instance(reference, NULL);
+}
+
+
+
+wi_atomic_reference_t * wi_atomic_reference_init_with_instance(wi_atomic_reference_t *reference, wi_runtime_instance_t *instance) {
+    wi_fast_lock_t      lock = WI_FAST_LOCK_INITIALIZER;
+    
+    reference->writer_lock  = lock;
+    reference->instance     = _wi_atomic_reference_snapshot(instance);
+    
+    return reference;
+}
+
+
+
+#pragma mark -
+
+static void _wi_atomic_reference_dealloc(wi_runtime_instance_t *instance) {
+    wi_atomic_reference_t     *reference = instance;
+    
+    wi_release(reference->instance);
+}
+
+
+
+static wi_string_t * _wi_atomic_reference_description(wi_runtime_instance_t *instance) {
+    wi_atomic_reference_t     *reference = instance;
+    
+    return wi_string_with_format(WI_STR("<%@ %p>{instance = %@}"),
+        wi_runtime_class_name(reference),
+        reference,
+        wi_atomic_reference_instance(reference));
+}
+
+
+
+#pragma mark -
+
+wi_runtime_instance_t * wi_atomic_reference_instance(wi_atomic_reference_t *reference) {
+    wi_runtime_instance_t   *instance;
+    wi_uinteger_t           epoch;
+    
+    while(true) {
+        epoch = reference->epoch;
+        
+        __sync_fetch_and_add(&reference->readers[epoch], 1);
+        
+        if(reference->epoch == epoch)
+            break;
+        
+        __sync_fetch_and_sub(&reference->readers[epoch], 1);
+    }
+    
+    instance = wi_retain(reference->instance);
+    
+    __sync_fetch_and_sub(&reference->readers[epoch], 1);
+    
+    return wi_autorelease(instance);
+}
+
+
+
+void wi_atomic_reference_set_instance(wi_atomic_reference_t *reference, wi_runtime_instance_t *instance) {
+    wi_fast_lock_lock(&reference->writer_lock);
+    
+    _wi_atomic_reference_publish(reference, _wi_atomic_reference_snapshot(instance));
+    
+    wi_fast_lock_unlock(&reference->writer_lock);
+}
+
+
+
+wi_boolean_t wi_atomic_reference_compare_and_set_instance(wi_atomic_reference_t *reference, wi_runtime_instance_t *old_instance, wi_runtime_instance_t *new_instance) {
+    wi_boolean_t    result = false;
+    
+    wi_fast_lock_lock(&reference->writer_lock);
+    
+    if(reference->instance == old_instance) {
+        _wi_atomic_reference_publish(reference, _wi_atomic_reference_snapshot(new_instance));
+        
+        result = true;
+    }
+    
+    wi_fast_lock_unlock(&reference->writer_lock);
+    
+    return result;
+}
+
+
+
+#pragma mark -
+
+static wi_runtime_instance_t * _wi_atomic_reference_snapshot(wi_runtime_instance_t *instance) {
+    wi_runtime_instance_t   *snapshot;
+    
+    if(!instance || !(wi_runtime_options(instance) & WI_RUNTIME_OPTION_MUTABLE))
+        return wi_retain(instance);
+    
+    snapshot = wi_copy(instance);
+    
+    wi_runtime_make_immutable(snapshot);
+    
+    return snapshot;
+}
+
+
+
+static void _wi_atomic_reference_publish(wi_atomic_reference_t *reference, wi_runtime_instance_t *instance) {
+    wi_runtime_instance_t   *old_instance;
+    wi_uinteger_t           epoch, spins;
+    
+    old_instance = reference->instance;
+    reference->instance = instance;
+    
+    __sync_synchronize();
+    
+    epoch = reference->epoch;
+    reference->epoch = !epoch;
+    
+    __sync_synchronize();
+    
+    for(spins = 0; reference->readers[epoch] > 0; spins++) {
+        if(spins >= _WI_ATOMIC_REFERENCE_SPINS_MAX)
+            sched_yield();
+    }
+    
+    wi_release(old_instance);
+}
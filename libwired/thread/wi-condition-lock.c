@@ -40,6 +40,7 @@ int wi_condition_lock_dummy = 1;
 #include <wired/wi-assert.h>
 #include <wired/wi-date.h>
 #include <wired/wi-condition-lock.h>
+#include <wired/wi-lock-profiling.h>
 #include <wired/wi-private.h>
 #include <wired/wi-string.h>
 #include <wired/wi-runtime.h>
@@ -51,10 +52,17 @@ struct _wi_condition_lock {
     pthread_cond_t                      cond;
     
     int                                 condition;
+    
+    void                                *site;
+    wi_lock_statistics_t                *statistics;
+    uint64_t                            locked_at;
 };
 
 static void                             _wi_condition_lock_dealloc(wi_runtime_instance_t *);
 
+static void                             _wi_condition_lock_did_lock(wi_condition_lock_t *, void *, wi_boolean_t, uint64_t);
+static void                             _wi_condition_lock_will_unlock(wi_condition_lock_t *);
+
 static wi_runtime_id_t                  _wi_condition_lock_runtime_id = WI_RUNTIME_ID_NULL;
 static wi_runtime_class_t               _wi_condition_lock_runtime_class = {
     "wi_condition_lock_t",
@@ -95,7 +103,10 @@ wi_condition_lock_t * wi_condition_lock_alloc(void) {
 
 
 wi_condition_lock_t * wi_condition_lock_init(wi_condition_lock_t *lock) {
-    return wi_condition_lock_init_with_condition(lock, 0);
+    lock = wi_condition_lock_init_with_condition(lock, 0);
+    lock->site = __builtin_return_address(0);
+    
+    return lock;
 }
 
 
@@ -117,6 +128,7 @@ wi_condition_lock_t * wi_condition_lock_init_with_condition(wi_condition_lock_t
         WI_ASSERT(false, "pthread_cond_init: %s", strerror(err));
     
     lock->condition = condition;
+    lock->site = __builtin_return_address(0);
 
     return lock;
 }
@@ -141,20 +153,48 @@ static void _wi_condition_lock_dealloc(wi_runtime_instance_t *instance) {
 #pragma mark -
 
 void wi_condition_lock_lock(wi_condition_lock_t *lock) {
-    int     err;
+    uint64_t        start = 0;
+    wi_boolean_t    profiling, contended = true;
+    int             err;
+    
+    profiling = wi_lock_profiling_enabled;
+    
+    if(profiling) {
+        start = wi_lock_statistics_time();
+        contended = (pthread_mutex_trylock(&lock->mutex) != 0);
+    }
+    
+    if(contended) {
+        if((err = pthread_mutex_lock(&lock->mutex)) != 0)
+            WI_ASSERT(false, "pthread_mutex_lock: %s", strerror(err));
+    }
     
-    if((err = pthread_mutex_lock(&lock->mutex)) != 0)
-        WI_ASSERT(false, "pthread_mutex_lock: %s", strerror(err));
+    if(profiling)
+        _wi_condition_lock_did_lock(lock, __builtin_return_address(0), contended, start);
 }
 
 
 
 wi_boolean_t wi_condition_lock_lock_when_condition(wi_condition_lock_t *lock, int condition, wi_time_interval_t time) {
     struct timespec     ts;
+    uint64_t            start = 0;
+    wi_boolean_t        profiling, contended = true;
     int                 err;
     
-    if((err = pthread_mutex_lock(&lock->mutex)) != 0)
-        WI_ASSERT(false, "pthread_mutex_lock: %s", strerror(err));
+    profiling = wi_lock_profiling_enabled;
+    
+    if(profiling) {
+        start = wi_lock_statistics_time();
+        contended = (pthread_mutex_trylock(&lock->mutex) != 0);
+    }
+    
+    if(contended) {
+        if((err = pthread_mutex_lock(&lock->mutex)) != 0)
+            WI_ASSERT(false, "pthread_mutex_lock: %s", strerror(err));
+    }
+    
+    if(profiling)
+        _wi_condition_lock_did_lock(lock, __builtin_return_address(0), contended, start);
     
     if(lock->condition != condition) {
         if(time > 0.0) {
@@ -168,6 +208,8 @@ wi_boolean_t wi_condition_lock_lock_when_condition(wi_condition_lock_t *lock, in
             } while(lock->condition != condition && err != ETIMEDOUT);
 
             if(err == ETIMEDOUT) {
+                lock->locked_at = 0;
+                
                 if((err = pthread_mutex_unlock(&lock->mutex)) != 0)
                     WI_ASSERT(false, "pthread_mutex_unlock: %s", strerror(err));
                 
@@ -179,6 +221,9 @@ wi_boolean_t wi_condition_lock_lock_when_condition(wi_condition_lock_t *lock, in
                     WI_ASSERT(false, "pthread_cond_wait: %s", strerror(err));
             } while(lock->condition != condition);
         }
+        
+        if(profiling)
+            lock->locked_at = wi_lock_statistics_time();
     }
     
     return true;
@@ -187,7 +232,13 @@ wi_boolean_t wi_condition_lock_lock_when_condition(wi_condition_lock_t *lock, in
 
 
 wi_boolean_t wi_condition_lock_try_lock(wi_condition_lock_t *lock) {
-    return (pthread_mutex_trylock(&lock->mutex) == 0);
+    if(pthread_mutex_trylock(&lock->mutex) != 0)
+        return false;
+    
+    if(wi_lock_profiling_enabled)
+        _wi_condition_lock_did_lock(lock, __builtin_return_address(0), false, 0);
+    
+    return true;
 }
 
 
@@ -210,6 +261,9 @@ wi_boolean_t wi_condition_lock_try_lock_when_condition(wi_condition_lock_t *lock
 void wi_condition_lock_unlock(wi_condition_lock_t *lock) {
     int     err;
     
+    if(lock->locked_at)
+        _wi_condition_lock_will_unlock(lock);
+    
     if((err = pthread_cond_broadcast(&lock->cond)) != 0)
         WI_ASSERT(false, "pthread_cond_broadcast: %s", strerror(err));
 
@@ -224,6 +278,9 @@ void wi_condition_lock_unlock_with_condition(wi_condition_lock_t *lock, int cond
     
     lock->condition = condition;
     
+    if(lock->locked_at)
+        _wi_condition_lock_will_unlock(lock);
+    
     if((err = pthread_cond_broadcast(&lock->cond)) != 0)
         WI_ASSERT(false, "pthread_cond_broadcast: %s", strerror(err));
     
@@ -237,5 +294,24 @@ int wi_condition_lock_condition(wi_condition_lock_t *lock) {
     return lock->condition;
 }
 
+
+
+#pragma mark -
+
+static void _wi_condition_lock_did_lock(wi_condition_lock_t *lock, void *caller, wi_boolean_t contended, uint64_t start) {
+    if(!lock->statistics)
+        lock->statistics = wi_lock_statistics_with_site("wi_condition_lock_t", NULL, lock->site);
+    
+    lock->locked_at = wi_lock_statistics_did_lock(lock->statistics, caller, contended, start);
+}
+
+
+
+static void _wi_condition_lock_will_unlock(wi_condition_lock_t *lock) {
+    wi_lock_statistics_will_unlock(lock->statistics, lock->locked_at);
+    
+    lock->locked_at = 0;
+}
+
 #endif
 
@@ -0,0 +1,178 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <time.h>
+#include <sched.h>
+
+#ifdef HAVE_LINUX_FUTEX_H
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <wired/wi-fast-lock.h>
+#include <wired/wi-macros.h>
+#include <wired/wi-private.h>
+
+#define _WI_FAST_LOCK_SPINS_MIN         10
+#define _WI_FAST_LOCK_SPINS_MAX         1000
+#define _WI_FAST_LOCK_YIELDS_MAX        16
+
+
+static void                             _wi_fast_lock_acquire(wi_fast_lock_t *);
+static void                             _wi_fast_lock_pause(void);
+static void                             _wi_fast_lock_park(wi_fast_lock_t *, wi_uinteger_t);
+
+static void                             _wi_fast_lock_did_lock(wi_fast_lock_t *, void *, wi_boolean_t, uint64_t);
+
+
+
+void wi_fast_lock_register(void) {
+}
+
+
+
+void wi_fast_lock_initialize(void) {
+}
+
+
+
+#pragma mark -
+
+void _wi_fast_lock_lock_contended(wi_fast_lock_t *lock) {
+    void            *caller;
+    uint64_t        start = 0;
+    wi_boolean_t    profiling, contended;
+    
+    caller = __builtin_return_address(0);
+    profiling = wi_lock_profiling_enabled;
+    
+    if(profiling)
+        start = wi_lock_statistics_time();
+    
+    contended = !__sync_bool_compare_and_swap(&lock->state, 0, 1);
+    
+    if(contended)
+        _wi_fast_lock_acquire(lock);
+    
+    if(profiling)
+        _wi_fast_lock_did_lock(lock, caller, contended, start);
+}
+
+
+
+void _wi_fast_lock_did_try_lock(wi_fast_lock_t *lock) {
+    _wi_fast_lock_did_lock(lock, __builtin_return_address(0), false, 0);
+}
+
+
+
+void _wi_fast_lock_will_unlock(wi_fast_lock_t *lock) {
+    wi_lock_statistics_will_unlock(lock->statistics, lock->locked_at);
+    
+    lock->locked_at = 0;
+}
+
+
+
+void _wi_fast_lock_wake(wi_fast_lock_t *lock) {
+    __sync_lock_release(&lock->state);
+
+#ifdef HAVE_LINUX_FUTEX_H
+    syscall(SYS_futex, &lock->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+}
+
+
+
+#pragma mark -
+
+static void _wi_fast_lock_acquire(wi_fast_lock_t *lock) {
+    wi_uinteger_t   rounds;
+    int32_t         i, spins;
+    
+    spins = WI_MIN(lock->spins * 2 + _WI_FAST_LOCK_SPINS_MIN, _WI_FAST_LOCK_SPINS_MAX);
+    
+    for(i = 0; i < spins; i++) {
+        _wi_fast_lock_pause();
+
+        if(lock->state == 0 && __sync_bool_compare_and_swap(&lock->state, 0, 1)) {
+            lock->spins += (i - lock->spins) / 8;
+            
+            return;
+        }
+    }
+    
+    for(rounds = 0; __sync_lock_test_and_set(&lock->state, 2) != 0; rounds++)
+        _wi_fast_lock_park(lock, rounds);
+
+    lock->spins += (spins - lock->spins) / 8;
+}
+
+
+
+static void _wi_fast_lock_pause(void) {
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause" ::: "memory");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+
+
+static void _wi_fast_lock_park(wi_fast_lock_t *lock, wi_uinteger_t rounds) {
+#ifdef HAVE_LINUX_FUTEX_H
+    syscall(SYS_futex, &lock->state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+#else
+    struct timespec     ts;
+    
+    if(rounds < _WI_FAST_LOCK_YIELDS_MAX) {
+        sched_yield();
+    } else {
+        ts.tv_sec = 0;
+        ts.tv_nsec = 1000 * WI_MIN(rounds - _WI_FAST_LOCK_YIELDS_MAX + 1, 1000);
+        
+        nanosleep(&ts, NULL);
+    }
+#endif
+}
+
+
+
+#pragma mark -
+
+static void _wi_fast_lock_did_lock(wi_fast_lock_t *lock, void *caller, wi_boolean_t contended, uint64_t start) {
+    if(!lock->statistics)
+        lock->statistics = wi_lock_statistics_with_site("wi_fast_lock_t", lock->site, NULL);
+    
+    lock->locked_at = wi_lock_statistics_did_lock(lock->statistics, caller, contended, start);
+}
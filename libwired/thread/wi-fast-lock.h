@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WI_FAST_LOCK_H
+#define WI_FAST_LOCK_H 1
+
+#include <wired/wi-base.h>
+#include <wired/wi-lock-profiling.h>
+#include <wired/wi-runtime.h>
+
+#define _WI_FAST_LOCK_STRINGIFY(x) \
+    #x
+
+#define _WI_FAST_LOCK_SITE(line) \
+    __FILE__ ":" _WI_FAST_LOCK_STRINGIFY(line)
+
+#define WI_FAST_LOCK_INITIALIZER \
+    { 0, 0, _WI_FAST_LOCK_SITE(__LINE__), NULL, 0 }
+
+
+struct _wi_fast_lock {
+    volatile int32_t                    state;
+    int32_t                             spins;
+    const char                          *site;
+    struct _wi_lock_statistics          *statistics;
+    uint64_t                            locked_at;
+};
+typedef struct _wi_fast_lock            wi_fast_lock_t;
+
+
+WI_EXPORT void                          _wi_fast_lock_lock_contended(wi_fast_lock_t *);
+WI_EXPORT void                          _wi_fast_lock_did_try_lock(wi_fast_lock_t *);
+WI_EXPORT void                          _wi_fast_lock_will_unlock(wi_fast_lock_t *);
+WI_EXPORT void                          _wi_fast_lock_wake(wi_fast_lock_t *);
+
+
+
+WI_STATIC_INLINE void wi_fast_lock_lock(wi_fast_lock_t *lock) {
+    if(wi_lock_profiling_enabled || !__sync_bool_compare_and_swap(&lock->state, 0, 1))
+        _wi_fast_lock_lock_contended(lock);
+}
+
+
+
+WI_STATIC_INLINE wi_boolean_t wi_fast_lock_try_lock(wi_fast_lock_t *lock) {
+    if(!__sync_bool_compare_and_swap(&lock->state, 0, 1))
+        return false;
+    
+    if(wi_lock_profiling_enabled)
+        _wi_fast_lock_did_try_lock(lock);
+    
+    return true;
+}
+
+
+
+WI_STATIC_INLINE void wi_fast_lock_unlock(wi_fast_lock_t *lock) {
+    if(lock->locked_at)
+        _wi_fast_lock_will_unlock(lock);
+    
+    if(__sync_fetch_and_sub(&lock->state, 1) != 1)
+        _wi_fast_lock_wake(lock);
+}
+
+#endif /* WI_FAST_LOCK_H */
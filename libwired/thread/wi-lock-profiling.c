@@ -0,0 +1,392 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+
+#ifdef WI_PTHREADS
+#include <pthread.h>
+#endif
+
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+
+#include <wired/wi-array.h>
+#include <wired/wi-dictionary.h>
+#include <wired/wi-lock-profiling.h>
+#include <wired/wi-log.h>
+#include <wired/wi-number.h>
+#include <wired/wi-pool.h>
+#include <wired/wi-private.h>
+#include <wired/wi-string.h>
+#include <wired/wi-system.h>
+#include <wired/wi-thread.h>
+
+struct _wi_lock_statistics {
+    const char                          *type;
+    const char                          *site;
+    void                                *site_address;
+    void                                *hottest_caller;
+
+    uint64_t                            acquisitions;
+    uint64_t                            contentions;
+    uint64_t                            wait_time;
+    uint64_t                            max_wait_time;
+    uint64_t                            hold_time;
+    uint64_t                            max_hold_time;
+    
+    struct _wi_lock_statistics          *next;
+};
+
+
+static wi_boolean_t                     _wi_lock_statistics_update_max(uint64_t *, uint64_t);
+static wi_dictionary_t *                _wi_lock_statistics_dictionary(wi_lock_statistics_t *);
+static wi_string_t *                    _wi_lock_statistics_site_string(wi_lock_statistics_t *);
+static wi_string_t *                    _wi_lock_statistics_address_string(void *);
+static wi_integer_t                     _wi_lock_statistics_compare(wi_runtime_instance_t *, wi_runtime_instance_t *);
+
+#ifdef WI_PTHREADS
+static void                             _wi_lock_profiling_signal_thread(wi_runtime_instance_t *);
+#endif
+
+
+wi_boolean_t                            wi_lock_profiling_enabled = false;
+
+static wi_lock_statistics_t             *_wi_lock_statistics_list;
+
+
+
+void wi_lock_profiling_register(void) {
+}
+
+
+
+void wi_lock_profiling_initialize(void) {
+    char    *env;
+    
+    env = getenv("wi_lock_profiling_enabled");
+    
+    if(env)
+        wi_lock_profiling_enabled = (strcmp(env, "0") != 0);
+}
+
+
+
+#pragma mark -
+
+wi_lock_statistics_t * wi_lock_statistics_with_site(const char *type, const char *site, void *site_address) {
+    wi_lock_statistics_t    *statistics, *head, *new_statistics = NULL;
+    
+    while(true) {
+        head = _wi_lock_statistics_list;
+        
+        for(statistics = head; statistics; statistics = statistics->next) {
+            if(strcmp(statistics->type, type) == 0 && statistics->site_address == site_address &&
+               (statistics->site == site || (statistics->site && site && strcmp(statistics->site, site) == 0))) {
+                if(new_statistics)
+                    wi_free(new_statistics);
+                
+                return statistics;
+            }
+        }
+        
+        if(!new_statistics) {
+            new_statistics = wi_malloc(sizeof(wi_lock_statistics_t));
+            new_statistics->type            = type;
+            new_statistics->site            = site;
+            new_statistics->site_address    = site_address;
+        }
+        
+        new_statistics->next = head;
+        
+        if(__sync_bool_compare_and_swap(&_wi_lock_statistics_list, head, new_statistics))
+            return new_statistics;
+    }
+}
+
+
+
+uint64_t wi_lock_statistics_time(void) {
+    struct timespec     ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    return ((uint64_t) ts.tv_sec * 1000000000ULL) + (uint64_t) ts.tv_nsec;
+}
+
+
+
+uint64_t wi_lock_statistics_did_lock(wi_lock_statistics_t *statistics, void *caller, wi_boolean_t contended, uint64_t start) {
+    uint64_t    now, wait_time;
+    
+    now = wi_lock_statistics_time();
+    
+    __sync_fetch_and_add(&statistics->acquisitions, 1);
+    
+    if(contended) {
+        wait_time = now - start;
+        
+        __sync_fetch_and_add(&statistics->contentions, 1);
+        __sync_fetch_and_add(&statistics->wait_time, wait_time);
+        
+        if(_wi_lock_statistics_update_max(&statistics->max_wait_time, wait_time))
+            statistics->hottest_caller = caller;
+    }
+    
+    return now;
+}
+
+
+
+void wi_lock_statistics_will_unlock(wi_lock_statistics_t *statistics, uint64_t locked_at) {
+    uint64_t    hold_time;
+    
+    hold_time = wi_lock_statistics_time() - locked_at;
+    
+    __sync_fetch_and_add(&statistics->hold_time, hold_time);
+    
+    _wi_lock_statistics_update_max(&statistics->max_hold_time, hold_time);
+}
+
+
+
+#pragma mark -
+
+static wi_boolean_t _wi_lock_statistics_update_max(uint64_t *max, uint64_t value) {
+    uint64_t    old_value;
+    
+    do {
+        old_value = *max;
+        
+        if(value < old_value)
+            return false;
+    } while(!__sync_bool_compare_and_swap(max, old_value, value));
+    
+    return true;
+}
+
+
+
+static wi_dictionary_t * _wi_lock_statistics_dictionary(wi_lock_statistics_t *statistics) {
+    wi_mutable_dictionary_t     *dictionary;
+    
+    dictionary = wi_mutable_dictionary_with_data_and_keys(
+        wi_string_with_utf8_string(statistics->type),                           WI_STR("type"),
+        _wi_lock_statistics_site_string(statistics),                            WI_STR("site"),
+        wi_number_with_int64(statistics->acquisitions),                         WI_STR("acquisitions"),
+        wi_number_with_int64(statistics->contentions),                          WI_STR("contentions"),
+        wi_number_with_double(statistics->wait_time / 1000000000.0),            WI_STR("wait_time"),
+        wi_number_with_double(statistics->max_wait_time / 1000000000.0),        WI_STR("max_wait_time"),
+        wi_number_with_double(statistics->hold_time / 1000000000.0),            WI_STR("hold_time"),
+        wi_number_with_double(statistics->max_hold_time / 1000000000.0),        WI_STR("max_hold_time"),
+        NULL);
+    
+    if(statistics->hottest_caller)
+        wi_mutable_dictionary_set_data_for_key(dictionary, _wi_lock_statistics_address_string(statistics->hottest_caller), WI_STR("hottest_caller"));
+    
+    wi_runtime_make_immutable(dictionary);
+    
+    return dictionary;
+}
+
+
+
+static wi_string_t * _wi_lock_statistics_site_string(wi_lock_statistics_t *statistics) {
+    const char      *site;
+    
+    if(!statistics->site)
+        return _wi_lock_statistics_address_string(statistics->site_address);
+    
+    site = strrchr(statistics->site, '/');
+    site = site ? site + 1 : statistics->site;
+    
+    return wi_string_with_utf8_string(site);
+}
+
+
+
+static wi_string_t * _wi_lock_statistics_address_string(void *address) {
+#ifdef HAVE_EXECINFO_H
+    wi_string_t     *string;
+    char            **symbols;
+    
+    symbols = backtrace_symbols(&address, 1);
+    
+    if(symbols) {
+        string = wi_string_with_utf8_string(symbols[0]);
+        
+        free(symbols);
+        
+        return string;
+    }
+#endif
+
+    return wi_string_with_format(WI_STR("%p"), address);
+}
+
+
+
+static wi_integer_t _wi_lock_statistics_compare(wi_runtime_instance_t *instance1, wi_runtime_instance_t *instance2) {
+    double      wait_time1, wait_time2;
+    
+    wait_time1 = wi_number_double(wi_dictionary_data_for_key(instance1, WI_STR("wait_time")));
+    wait_time2 = wi_number_double(wi_dictionary_data_for_key(instance2, WI_STR("wait_time")));
+    
+    if(wait_time1 > wait_time2)
+        return -1;
+    else if(wait_time1 < wait_time2)
+        return 1;
+    
+    return 0;
+}
+
+
+
+#pragma mark -
+
+wi_array_t * wi_lock_profiling_statistics(void) {
+    wi_mutable_array_t      *array;
+    wi_lock_statistics_t    *statistics;
+    
+    array = wi_mutable_array();
+    
+    for(statistics = _wi_lock_statistics_list; statistics; statistics = statistics->next) {
+        if(statistics->acquisitions > 0)
+            wi_mutable_array_add_data(array, _wi_lock_statistics_dictionary(statistics));
+    }
+    
+    wi_mutable_array_sort(array, _wi_lock_statistics_compare);
+    
+    wi_runtime_make_immutable(array);
+    
+    return array;
+}
+
+
+
+void wi_lock_profiling_reset(void) {
+    wi_lock_statistics_t    *statistics;
+    
+    for(statistics = _wi_lock_statistics_list; statistics; statistics = statistics->next) {
+        statistics->hottest_caller  = NULL;
+        statistics->acquisitions    = 0;
+        statistics->contentions     = 0;
+        statistics->wait_time       = 0;
+        statistics->max_wait_time   = 0;
+        statistics->hold_time       = 0;
+        statistics->max_hold_time   = 0;
+    }
+}
+
+
+
+void wi_lock_profiling_log_statistics(void) {
+    wi_enumerator_t         *enumerator;
+    wi_log_category_t       *category;
+    wi_dictionary_t         *statistics;
+    wi_string_t             *caller;
+    
+    category = wi_log_category_with_name(WI_STR("locks"));
+    enumerator = wi_array_data_enumerator(wi_lock_profiling_statistics());
+    
+    while((statistics = wi_enumerator_next_data(enumerator))) {
+        caller = wi_dictionary_data_for_key(statistics, WI_STR("hottest_caller"));
+
+        wi_log_category_log(category, WI_LOG_INFO, WI_STR("%@ %@: %lld acquisitions, %lld contentions, %.6fs wait (%.6fs max), %.6fs hold (%.6fs max)%@%@"),
+            wi_dictionary_data_for_key(statistics, WI_STR("type")),
+            wi_dictionary_data_for_key(statistics, WI_STR("site")),
+            wi_number_int64(wi_dictionary_data_for_key(statistics, WI_STR("acquisitions"))),
+            wi_number_int64(wi_dictionary_data_for_key(statistics, WI_STR("contentions"))),
+            wi_number_double(wi_dictionary_data_for_key(statistics, WI_STR("wait_time"))),
+            wi_number_double(wi_dictionary_data_for_key(statistics, WI_STR("max_wait_time"))),
+            wi_number_double(wi_dictionary_data_for_key(statistics, WI_STR("hold_time"))),
+            wi_number_double(wi_dictionary_data_for_key(statistics, WI_STR("max_hold_time"))),
+            caller ? WI_STR(", hottest caller ") : WI_STR(""),
+            caller ? caller : WI_STR(""));
+    }
+}
+
+
+
+/* The signal is blocked in the calling thread and in the threads it goes on
+   to create, and a dedicated thread waits for it. Threads that already exist
+   keep the default action, which for SIGUSR1 terminates the process, so this
+   must be called before any other thread is spawned. */
+wi_boolean_t wi_lock_profiling_log_statistics_on_signal(int signal) {
+#ifdef WI_PTHREADS
+    sigset_t    signals;
+    int         err;
+    
+    sigemptyset(&signals);
+    sigaddset(&signals, signal);
+    
+    if((err = pthread_sigmask(SIG_BLOCK, &signals, NULL)) != 0) {
+        wi_error_set_errno(err);
+        
+        return false;
+    }
+    
+    return wi_thread_create_thread(_wi_lock_profiling_signal_thread, wi_number_with_int(signal));
+#else
+    wi_error_set_errno(ENOTSUP);
+    
+    return false;
+#endif
+}
+
+
+
+#ifdef WI_PTHREADS
+
+static void _wi_lock_profiling_signal_thread(wi_runtime_instance_t *argument) {
+    wi_pool_t       *pool;
+    int             signal;
+    
+    pool = wi_pool_init(wi_pool_alloc());
+    
+    wi_thread_set_name(WI_STR("wi_lock_profiling"));
+    
+    signal = wi_number_int(argument);
+    
+    while(true) {
+        wi_thread_wait_for_signals(signal, 0);
+        
+        wi_lock_profiling_log_statistics();
+        
+        wi_pool_drain(pool);
+    }
+    
+    wi_release(pool);
+}
+
+#endif
@@ -40,6 +40,7 @@ int wi_lock_dummy = 1;
 #include <wired/wi-assert.h>
 #include <wired/wi-date.h>
 #include <wired/wi-lock.h>
+#include <wired/wi-lock-profiling.h>
 #include <wired/wi-private.h>
 #include <wired/wi-string.h>
 #include <wired/wi-runtime.h>
@@ -48,10 +49,16 @@ struct _wi_lock {
     wi_runtime_base_t                   base;
     
     pthread_mutex_t                     mutex;
+    
+    void                                *site;
+    wi_lock_statistics_t                *statistics;
+    uint64_t                            locked_at;
 };
 
 static void                             _wi_lock_dealloc(wi_runtime_instance_t *);
 
+static void                             _wi_lock_did_lock(wi_lock_t *, void *, wi_boolean_t, uint64_t);
+
 static wi_runtime_id_t                  _wi_lock_runtime_id = WI_RUNTIME_ID_NULL;
 static wi_runtime_class_t               _wi_lock_runtime_class = {
     "wi_lock_t",
@@ -107,6 +114,8 @@ wi_lock_t * wi_lock_init(wi_lock_t *lock) {
     if((err = pthread_mutexattr_destroy(&attr)) != 0)
         WI_ASSERT(false, "pthread_mutexattr_destroy: %s", strerror(err));
     
+    lock->site = __builtin_return_address(0);
+    
     return lock;
 }
 
@@ -127,16 +136,36 @@ static void _wi_lock_dealloc(wi_runtime_instance_t *instance) {
 #pragma mark -
 
 void wi_lock_lock(wi_lock_t *lock) {
-    int     err;
+    uint64_t        start = 0;
+    wi_boolean_t    profiling, contended = true;
+    int             err;
     
-    if((err = pthread_mutex_lock(&lock->mutex)) != 0)
-        WI_ASSERT(false, "pthread_mutex_lock: %s", strerror(err));
+    profiling = wi_lock_profiling_enabled;
+    
+    if(profiling) {
+        start = wi_lock_statistics_time();
+        contended = (pthread_mutex_trylock(&lock->mutex) != 0);
+    }
+    
+    if(contended) {
+        if((err = pthread_mutex_lock(&lock->mutex)) != 0)
+            WI_ASSERT(false, "pthread_mutex_lock: %s", strerror(err));
+    }
+    
+    if(profiling)
+        _wi_lock_did_lock(lock, __builtin_return_address(0), contended, start);
 }
 
 
 
 wi_boolean_t wi_lock_try_lock(wi_lock_t *lock) {
-    return (pthread_mutex_trylock(&lock->mutex) == 0);
+    if(pthread_mutex_trylock(&lock->mutex) != 0)
+        return false;
+    
+    if(wi_lock_profiling_enabled)
+        _wi_lock_did_lock(lock, __builtin_return_address(0), false, 0);
+    
+    return true;
 }
 
 
@@ -144,8 +173,25 @@ wi_boolean_t wi_lock_try_lock(wi_lock_t *lock) {
 void wi_lock_unlock(wi_lock_t *lock) {
     int     err;
     
+    if(lock->locked_at) {
+        wi_lock_statistics_will_unlock(lock->statistics, lock->locked_at);
+        
+        lock->locked_at = 0;
+    }
+    
     if((err = pthread_mutex_unlock(&lock->mutex)) != 0)
         WI_ASSERT(false, "pthread_mutex_unlock: %s", strerror(err));
 }
 
+
+
+#pragma mark -
+
+static void _wi_lock_did_lock(wi_lock_t *lock, void *caller, wi_boolean_t contended, uint64_t start) {
+    if(!lock->statistics)
+        lock->statistics = wi_lock_statistics_with_site("wi_lock_t", NULL, lock->site);
+    
+    lock->locked_at = wi_lock_statistics_did_lock(lock->statistics, caller, contended, start);
+}
+
 #endif
@@ -35,23 +35,60 @@ int wi_readwrite_lock_dummy = 1;
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
+#include <sched.h>
 #include <pthread.h>
 
 #include <wired/wi-assert.h>
 #include <wired/wi-date.h>
+#include <wired/wi-lock-profiling.h>
 #include <wired/wi-readwrite-lock.h>
 #include <wired/wi-private.h>
 #include <wired/wi-string.h>
+#include <wired/wi-system.h>
 #include <wired/wi-runtime.h>
 
+#define _WI_READWRITE_LOCK_CACHE_LINE_SIZE      64
+#define _WI_READWRITE_LOCK_READER_SLOTS_MAX     1024
+#define _WI_READWRITE_LOCK_SPINS_MAX            100
+
+
+struct _wi_readwrite_lock_reader_slot {
+    volatile wi_integer_t               readers;
+    
+    char                                padding[_WI_READWRITE_LOCK_CACHE_LINE_SIZE - sizeof(wi_integer_t)];
+};
+typedef struct _wi_readwrite_lock_reader_slot   _wi_readwrite_lock_reader_slot_t;
+
+
 struct _wi_readwrite_lock {
     wi_runtime_base_t                   base;
     
     pthread_rwlock_t                    rwlock;
+    
+    _wi_readwrite_lock_reader_slot_t    *reader_slots;
+    void                                *reader_slots_buffer;
+    pthread_mutex_t                     writer_mutex;
+    pthread_t                           writer_thread;
+    volatile wi_boolean_t               writer;
+    
+    void                                *site;
+    wi_lock_statistics_t                *statistics;
+    uint64_t                            locked_at;
 };
 
 static void                             _wi_readwrite_lock_dealloc(wi_runtime_instance_t *);
 
+static wi_boolean_t                     _wi_readwrite_lock_distributed_read_lock(wi_readwrite_lock_t *, wi_boolean_t);
+static wi_boolean_t                     _wi_readwrite_lock_distributed_write_lock(wi_readwrite_lock_t *, wi_boolean_t);
+static void                             _wi_readwrite_lock_distributed_unlock(wi_readwrite_lock_t *);
+static _wi_readwrite_lock_reader_slot_t * _wi_readwrite_lock_reader_slot(wi_readwrite_lock_t *);
+static wi_boolean_t                     _wi_readwrite_lock_has_readers(wi_readwrite_lock_t *);
+static void                             _wi_readwrite_lock_did_lock(wi_readwrite_lock_t *, void *, wi_boolean_t, uint64_t, wi_boolean_t);
+
+
+static wi_uinteger_t                    _wi_readwrite_lock_reader_slots_count;
+
 static wi_runtime_id_t                  _wi_readwrite_lock_runtime_id = WI_RUNTIME_ID_NULL;
 static wi_runtime_class_t               _wi_readwrite_lock_runtime_class = {
     "wi_readwrite_lock_t",
@@ -71,6 +108,18 @@ void wi_readwrite_lock_register(void) {
 
 
 void wi_readwrite_lock_initialize(void) {
+    long    cpus;
+    
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    
+    if(cpus < 1)
+        cpus = 1;
+    
+    _wi_readwrite_lock_reader_slots_count = 1;
+    
+    while(_wi_readwrite_lock_reader_slots_count < (wi_uinteger_t) cpus * 2 &&
+          _wi_readwrite_lock_reader_slots_count < _WI_READWRITE_LOCK_READER_SLOTS_MAX)
+        _wi_readwrite_lock_reader_slots_count *= 2;
 }
 
 
@@ -97,6 +146,24 @@ wi_readwrite_lock_t * wi_readwrite_lock_init(wi_readwrite_lock_t *lock) {
     if((err = pthread_rwlock_init(&lock->rwlock, NULL)) != 0)
         WI_ASSERT(false, "pthread_rwlock_init: %s", strerror(err));
     
+    lock->site = __builtin_return_address(0);
+    
+    return lock;
+}
+
+
+
+wi_readwrite_lock_t * wi_readwrite_lock_init_with_distributed_readers(wi_readwrite_lock_t *lock) {
+    int     err;
+    
+    if((err = pthread_mutex_init(&lock->writer_mutex, NULL)) != 0)
+        WI_ASSERT(false, "pthread_mutex_init: %s", strerror(err));
+    
+    lock->reader_slots_buffer = wi_malloc((_wi_readwrite_lock_reader_slots_count + 1) * sizeof(_wi_readwrite_lock_reader_slot_t));
+    lock->reader_slots = (void *) (((uintptr_t) lock->reader_slots_buffer + _WI_READWRITE_LOCK_CACHE_LINE_SIZE - 1) &
+                                   ~((uintptr_t) _WI_READWRITE_LOCK_CACHE_LINE_SIZE - 1));
+    lock->site = __builtin_return_address(0);
+    
     return lock;
 }
 
@@ -108,8 +175,15 @@ static void _wi_readwrite_lock_dealloc(wi_runtime_instance_t *instance) {
     wi_readwrite_lock_t     *lock = instance;
     int                     err;
     
-    if((err = pthread_rwlock_destroy(&lock->rwlock)) != 0)
-        WI_ASSERT(false, "pthread_rwlock_destroy: %s", strerror(err));
+    if(lock->reader_slots) {
+        if((err = pthread_mutex_destroy(&lock->writer_mutex)) != 0)
+            WI_ASSERT(false, "pthread_mutex_destroy: %s", strerror(err));
+        
+        wi_free(lock->reader_slots_buffer);
+    } else {
+        if((err = pthread_rwlock_destroy(&lock->rwlock)) != 0)
+            WI_ASSERT(false, "pthread_rwlock_destroy: %s", strerror(err));
+    }
 }
 
 
@@ -117,31 +191,91 @@ static void _wi_readwrite_lock_dealloc(wi_runtime_instance_t *instance) {
 #pragma mark -
 
 void wi_readwrite_lock_write_lock(wi_readwrite_lock_t *lock) {
-    int     err;
+    uint64_t        start = 0;
+    wi_boolean_t    profiling, contended = true;
+    int             err;
+    
+    profiling = wi_lock_profiling_enabled;
+    
+    if(profiling)
+        start = wi_lock_statistics_time();
     
-    if((err = pthread_rwlock_wrlock(&lock->rwlock)) != 0)
-        WI_ASSERT(false, "pthread_rwlock_wrlock: %s", strerror(err));
+    if(lock->reader_slots) {
+        contended = _wi_readwrite_lock_distributed_write_lock(lock, false);
+    } else {
+        if(profiling)
+            contended = (pthread_rwlock_trywrlock(&lock->rwlock) != 0);
+    
+        if(contended) {
+            if((err = pthread_rwlock_wrlock(&lock->rwlock)) != 0)
+                WI_ASSERT(false, "pthread_rwlock_wrlock: %s", strerror(err));
+        }
+    }
+    
+    if(profiling)
+        _wi_readwrite_lock_did_lock(lock, __builtin_return_address(0), contended, start, true);
 }
 
 
 
 wi_boolean_t wi_readwrite_lock_try_write_lock(wi_readwrite_lock_t *lock) {
-    return (pthread_rwlock_trywrlock(&lock->rwlock) == 0);
+    if(lock->reader_slots) {
+        if(_wi_readwrite_lock_distributed_write_lock(lock, true))
+            return false;
+    } else {
+        if(pthread_rwlock_trywrlock(&lock->rwlock) != 0)
+            return false;
+    }
+    
+    if(wi_lock_profiling_enabled)
+        _wi_readwrite_lock_did_lock(lock, __builtin_return_address(0), false, 0, true);
+    
+    return true;
 }
 
 
 
 void wi_readwrite_lock_read_lock(wi_readwrite_lock_t *lock) {
-    int     err;
+    uint64_t        start = 0;
+    wi_boolean_t    profiling, contended = true;
+    int             err;
     
-    if((err = pthread_rwlock_rdlock(&lock->rwlock)) != 0)
-        WI_ASSERT(false, "pthread_rwlock_rdlock: %s", strerror(err));
+    profiling = wi_lock_profiling_enabled;
+    
+    if(profiling)
+        start = wi_lock_statistics_time();
+    
+    if(lock->reader_slots) {
+        contended = _wi_readwrite_lock_distributed_read_lock(lock, false);
+    } else {
+        if(profiling)
+            contended = (pthread_rwlock_tryrdlock(&lock->rwlock) != 0);
+        
+        if(contended) {
+            if((err = pthread_rwlock_rdlock(&lock->rwlock)) != 0)
+                WI_ASSERT(false, "pthread_rwlock_rdlock: %s", strerror(err));
+        }
+    }
+    
+    if(profiling)
+        _wi_readwrite_lock_did_lock(lock, __builtin_return_address(0), contended, start, false);
 }
 
 
 
 wi_boolean_t wi_readwrite_lock_try_read_lock(wi_readwrite_lock_t *lock) {
-    return (pthread_rwlock_tryrdlock(&lock->rwlock) == 0);
+    if(lock->reader_slots) {
+        if(_wi_readwrite_lock_distributed_read_lock(lock, true))
+            return false;
+    } else {
+        if(pthread_rwlock_tryrdlock(&lock->rwlock) != 0)
+            return false;
+    }
+    
+    if(wi_lock_profiling_enabled)
+        _wi_readwrite_lock_did_lock(lock, __builtin_return_address(0), false, 0, false);
+    
+    return true;
 }
 
 
@@ -149,8 +283,166 @@ wi_boolean_t wi_readwrite_lock_try_read_lock(wi_readwrite_lock_t *lock) {
 void wi_readwrite_lock_unlock(wi_readwrite_lock_t *lock) {
     int     err;
     
-    if((err = pthread_rwlock_unlock(&lock->rwlock)) != 0)
-        WI_ASSERT(false, "pthread_rwlock_unlock: %s", strerror(err));
+    if(lock->locked_at) {
+        wi_lock_statistics_will_unlock(lock->statistics, lock->locked_at);
+        
+        lock->locked_at = 0;
+    }
+    
+    if(lock->reader_slots) {
+        _wi_readwrite_lock_distributed_unlock(lock);
+    } else {
+        if((err = pthread_rwlock_unlock(&lock->rwlock)) != 0)
+            WI_ASSERT(false, "pthread_rwlock_unlock: %s", strerror(err));
+    }
+}
+
+
+
+#pragma mark -
+
+static wi_boolean_t _wi_readwrite_lock_distributed_read_lock(wi_readwrite_lock_t *lock, wi_boolean_t try) {
+    _wi_readwrite_lock_reader_slot_t    *slot;
+    wi_boolean_t                        contended = false;
+    int                                 err;
+    
+    slot = _wi_readwrite_lock_reader_slot(lock);
+    
+    while(true) {
+        __sync_fetch_and_add(&slot->readers, 1);
+        
+        if(!lock->writer)
+            return contended;
+        
+        __sync_fetch_and_sub(&slot->readers, 1);
+        
+        if(try)
+            return true;
+        
+        contended = true;
+        
+        if((err = pthread_mutex_lock(&lock->writer_mutex)) != 0)
+            WI_ASSERT(false, "pthread_mutex_lock: %s", strerror(err));
+        
+        if((err = pthread_mutex_unlock(&lock->writer_mutex)) != 0)
+            WI_ASSERT(false, "pthread_mutex_unlock: %s", strerror(err));
+    }
+}
+
+
+
+static wi_boolean_t _wi_readwrite_lock_distributed_write_lock(wi_readwrite_lock_t *lock, wi_boolean_t try) {
+    wi_uinteger_t   spins;
+    wi_boolean_t    contended = false;
+    int             err;
+    
+    if(pthread_mutex_trylock(&lock->writer_mutex) != 0) {
+        if(try)
+            return true;
+        
+        contended = true;
+        
+        if((err = pthread_mutex_lock(&lock->writer_mutex)) != 0)
+            WI_ASSERT(false, "pthread_mutex_lock: %s", strerror(err));
+    }
+    
+    /* The owner is published before the flag, so a thread that sees the flag
+       also sees who set it */
+    lock->writer_thread = pthread_self();
+    
+    __sync_synchronize();
+    
+    lock->writer = true;
+    
+    __sync_synchronize();
+    
+    for(spins = 0; _wi_readwrite_lock_has_readers(lock); spins++) {
+        if(try) {
+            memset(&lock->writer_thread, 0, sizeof(lock->writer_thread));
+            
+            __sync_synchronize();
+            
+            lock->writer = false;
+            
+            if((err = pthread_mutex_unlock(&lock->writer_mutex)) != 0)
+                WI_ASSERT(false, "pthread_mutex_unlock: %s", strerror(err));
+            
+            return true;
+        }
+        
+        contended = true;
+        
+        if(spins >= _WI_READWRITE_LOCK_SPINS_MAX)
+            sched_yield();
+    }
+    
+    return contended;
+}
+
+
+
+static void _wi_readwrite_lock_distributed_unlock(wi_readwrite_lock_t *lock) {
+    wi_boolean_t    writer;
+    int             err;
+    
+    writer = lock->writer;
+    
+    __sync_synchronize();
+    
+    /* The owner is cleared before the mutex is released, so a thread that
+       wrote earlier and now reads can never match its own stale entry */
+    if(writer && pthread_equal(lock->writer_thread, pthread_self())) {
+        memset(&lock->writer_thread, 0, sizeof(lock->writer_thread));
+        
+        __sync_synchronize();
+        
+        lock->writer = false;
+        
+        if((err = pthread_mutex_unlock(&lock->writer_mutex)) != 0)
+            WI_ASSERT(false, "pthread_mutex_unlock: %s", strerror(err));
+    } else {
+        __sync_fetch_and_sub(&_wi_readwrite_lock_reader_slot(lock)->readers, 1);
+    }
+}
+
+
+
+static _wi_readwrite_lock_reader_slot_t * _wi_readwrite_lock_reader_slot(wi_readwrite_lock_t *lock) {
+    uint64_t    thread;
+    
+    thread = (uint64_t) (uintptr_t) pthread_self();
+    thread *= 0x9E3779B97F4A7C15ULL;
+    
+    return &lock->reader_slots[(thread >> 32) & (_wi_readwrite_lock_reader_slots_count - 1)];
+}
+
+
+
+static wi_boolean_t _wi_readwrite_lock_has_readers(wi_readwrite_lock_t *lock) {
+    wi_uinteger_t   i;
+    
+    for(i = 0; i < _wi_readwrite_lock_reader_slots_count; i++) {
+        if(lock->reader_slots[i].readers > 0)
+            return true;
+    }
+    
+    return false;
+}
+
+
+
+#pragma mark -
+
+static void _wi_readwrite_lock_did_lock(wi_readwrite_lock_t *lock, void *caller, wi_boolean_t contended, uint64_t start, wi_boolean_t write) {
+    uint64_t    locked_at;
+    
+    if(!lock->statistics)
+        lock->statistics = wi_lock_statistics_with_site("wi_readwrite_lock_t", NULL, lock->site);
+    
+    locked_at = wi_lock_statistics_did_lock(lock->statistics, caller, contended, start);
+    
+    if(write)
+        lock->locked_at = locked_at;
 }
 
 #endif
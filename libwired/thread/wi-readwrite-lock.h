@@ -34,6 +34,7 @@ WI_EXPORT wi_runtime_id_t               wi_readwrite_lock_runtime_id(void);
 
 WI_EXPORT wi_readwrite_lock_t *         wi_readwrite_lock_alloc(void);
 WI_EXPORT wi_readwrite_lock_t *         wi_readwrite_lock_init(wi_readwrite_lock_t *);
+WI_EXPORT wi_readwrite_lock_t *         wi_readwrite_lock_init_with_distributed_readers(wi_readwrite_lock_t *);
 
 WI_EXPORT void                          wi_readwrite_lock_write_lock(wi_readwrite_lock_t *);
 WI_EXPORT wi_boolean_t                  wi_readwrite_lock_try_write_lock(wi_readwrite_lock_t *);
@@ -39,6 +39,7 @@ int wi_recursive_lock_dummy = 1;
 
 #include <wired/wi-assert.h>
 #include <wired/wi-date.h>
+#include <wired/wi-lock-profiling.h>
 #include <wired/wi-private.h>
 #include <wired/wi-recursive-lock.h>
 #include <wired/wi-string.h>
@@ -50,10 +51,18 @@ struct _wi_recursive_lock {
 #ifdef WI_PTHREADS
     pthread_mutex_t                     mutex;
 #endif
+    
+    wi_uinteger_t                       depth;
+    
+    void                                *site;
+    wi_lock_statistics_t                *statistics;
+    uint64_t                            locked_at;
 };
 
 static void                             _wi_recursive_lock_dealloc(wi_runtime_instance_t *);
 
+static void                             _wi_recursive_lock_did_lock(wi_recursive_lock_t *, void *, wi_boolean_t, uint64_t);
+
 static wi_runtime_id_t                  _wi_recursive_lock_runtime_id = WI_RUNTIME_ID_NULL;
 static wi_runtime_class_t               _wi_recursive_lock_runtime_class = {
     "wi_recursive_lock_t",
@@ -108,6 +117,8 @@ wi_recursive_lock_t * wi_recursive_lock_init(wi_recursive_lock_t *lock) {
 
     if((err = pthread_mutexattr_destroy(&attr)) != 0)
         WI_ASSERT(false, "pthread_mutexattr_destroy: %s", strerror(err));
+    
+    lock->site = __builtin_return_address(0);
 
     return lock;
 }
@@ -129,16 +140,40 @@ static void _wi_recursive_lock_dealloc(wi_runtime_instance_t *instance) {
 #pragma mark -
 
 void wi_recursive_lock_lock(wi_recursive_lock_t *lock) {
-    int     err;
+    uint64_t        start = 0;
+    wi_boolean_t    profiling, contended = true;
+    int             err;
+    
+    profiling = wi_lock_profiling_enabled;
     
-    if((err = pthread_mutex_lock(&lock->mutex)) != 0)
-        WI_ASSERT(false, "pthread_mutex_lock: %s", strerror(err));
+    if(profiling) {
+        start = wi_lock_statistics_time();
+        contended = (pthread_mutex_trylock(&lock->mutex) != 0);
+    }
+    
+    if(contended) {
+        if((err = pthread_mutex_lock(&lock->mutex)) != 0)
+            WI_ASSERT(false, "pthread_mutex_lock: %s", strerror(err));
+    }
+    
+    lock->depth++;
+    
+    if(profiling)
+        _wi_recursive_lock_did_lock(lock, __builtin_return_address(0), contended, start);
 }
 
 
 
 wi_boolean_t wi_recursive_lock_try_lock(wi_recursive_lock_t *lock) {
-    return (pthread_mutex_trylock(&lock->mutex) == 0);
+    if(pthread_mutex_trylock(&lock->mutex) != 0)
+        return false;
+    
+    lock->depth++;
+    
+    if(wi_lock_profiling_enabled)
+        _wi_recursive_lock_did_lock(lock, __builtin_return_address(0), false, 0);
+    
+    return true;
 }
 
 
@@ -146,8 +181,30 @@ wi_boolean_t wi_recursive_lock_try_lock(wi_recursive_lock_t *lock) {
 void wi_recursive_lock_unlock(wi_recursive_lock_t *lock) {
     int     err;
     
+    if(--lock->depth == 0 && lock->locked_at) {
+        wi_lock_statistics_will_unlock(lock->statistics, lock->locked_at);
+        
+        lock->locked_at = 0;
+    }
+    
     if((err = pthread_mutex_unlock(&lock->mutex)) != 0)
         WI_ASSERT(false, "pthread_mutex_unlock: %s", strerror(err));
 }
 
+
+
+#pragma mark -
+
+static void _wi_recursive_lock_did_lock(wi_recursive_lock_t *lock, void *caller, wi_boolean_t contended, uint64_t start) {
+    uint64_t    locked_at;
+    
+    if(!lock->statistics)
+        lock->statistics = wi_lock_statistics_with_site("wi_recursive_lock_t", NULL, lock->site);
+    
+    locked_at = wi_lock_statistics_did_lock(lock->statistics, caller, contended, start);
+    
+    if(lock->depth == 1)
+        lock->locked_at = locked_at;
+}
+
 #endif
@@ -28,7 +28,9 @@
 #define WIRED_H 1
 
 #include <wired/wi-address.h>
+#include <wired/wi-archive.h>
 #include <wired/wi-array.h>
+#include <wired/wi-atomic-reference.h>
 #include <wired/wi-assert.h>
 #include <wired/wi-base.h>
 #include <wired/wi-base64.h>
@@ -41,17 +43,25 @@
 #include <wired/wi-dh.h>
 #include <wired/wi-dictionary.h>
 #include <wired/wi-directory-enumerator.h>
+#include <wired/wi-directory-reader.h>
 #include <wired/wi-dsa.h>
 #include <wired/wi-enumerator.h>
 #include <wired/wi-error.h>
+#include <wired/wi-fast-lock.h>
 #include <wired/wi-file.h>
+#include <wired/wi-file-index.h>
 #include <wired/wi-filesystem.h>
 #include <wired/wi-filesystem-events.h>
 #include <wired/wi-fts.h>
 #include <wired/wi-host.h>
 #include <wired/wi-indexset.h>
+#include <wired/wi-io-engine.h>
 #include <wired/wi-json.h>
+#include <wired/wi-json-document.h>
+#include <wired/wi-json-reader.h>
+#include <wired/wi-json-writer.h>
 #include <wired/wi-lock.h>
+#include <wired/wi-lock-profiling.h>
 #include <wired/wi-log.h>
 #include <wired/wi-macros.h>
 #include <wired/wi-md5.h>
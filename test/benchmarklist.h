@@ -0,0 +1,9 @@
+WI_BENCHMARK_EXPORT void                    wi_test_archive_benchmark(void);
+WI_BENCHMARK_EXPORT void                wi_test_base64_benchmark(void);
+WI_BENCHMARK_EXPORT void                    wi_test_json_document_benchmark(void);
+WI_BENCHMARK_EXPORT void                wi_test_json_benchmark(void);
+WI_BENCHMARK_EXPORT void                wi_test_json_serialization_benchmark(void);
+WI_BENCHMARK_EXPORT void                wi_test_plist_serialization_benchmark(void);
+WI_BENCHMARK_EXPORT void                wi_test_plist_parsing_benchmark(void);
+WI_BENCHMARK_EXPORT void                wi_test_readwrite_lock_benchmark(void);
+WI_BENCHMARK_EXPORT void                wi_test_string_format_benchmark(void);
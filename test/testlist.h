@@ -4,6 +4,10 @@ WI_TEST_EXPORT void                     wi_test_address_comparison(void);
 WI_TEST_EXPORT void                     wi_test_address_accessors(void);
 WI_TEST_EXPORT void                     wi_test_address_matching(void);
 WI_TEST_EXPORT void                     wi_test_address_mutation(void);
+WI_TEST_EXPORT void                         wi_test_archive(void);
+WI_TEST_EXPORT void                         wi_test_archive_errors(void);
+WI_TEST_EXPORT void                         wi_test_archive_streams(void);
+WI_TEST_EXPORT void                         wi_test_archive_short_reads(void);
 WI_TEST_EXPORT void                     wi_test_array_creation(void);
 WI_TEST_EXPORT void                     wi_test_array_serialization(void);
 WI_TEST_EXPORT void                     wi_test_array_runtime_functions(void);
@@ -11,8 +15,14 @@ WI_TEST_EXPORT void                     wi_test_array_instances(void);
 WI_TEST_EXPORT void                     wi_test_array_scalars(void);
 WI_TEST_EXPORT void                     wi_test_array_enumeration(void);
 WI_TEST_EXPORT void                     wi_test_array_mutation(void);
+WI_TEST_EXPORT void                     wi_test_atomic_reference_creation(void);
+WI_TEST_EXPORT void                     wi_test_atomic_reference_runtime_functions(void);
+WI_TEST_EXPORT void                     wi_test_atomic_reference_publishing(void);
+WI_TEST_EXPORT void                     wi_test_atomic_reference_concurrency(void);
 WI_TEST_EXPORT void                     wi_test_base(void);
 WI_TEST_EXPORT void                     wi_test_base64(void);
+WI_TEST_EXPORT void                     wi_test_base64_buffers(void);
+WI_TEST_EXPORT void                     wi_test_base64_streaming(void);
 WI_TEST_EXPORT void                     wi_test_byteorder(void);
 WI_TEST_EXPORT void                     wi_test_cipher_creation(void);
 WI_TEST_EXPORT void                     wi_test_cipher_runtime_functions(void);
@@ -49,6 +59,7 @@ WI_TEST_EXPORT void                     wi_test_dictionary_scalars(void);
 WI_TEST_EXPORT void                     wi_test_dictionary_enumeration(void);
 WI_TEST_EXPORT void                     wi_test_dictionary_mutation(void);
 WI_TEST_EXPORT void                     wi_test_directory_enumerator(void);
+WI_TEST_EXPORT void                     wi_test_directory_reader(void);
 WI_TEST_EXPORT void                     wi_test_dsa_creation(void);
 WI_TEST_EXPORT void                     wi_test_dsa_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_dsa_accessors(void);
@@ -57,15 +68,27 @@ WI_TEST_EXPORT void                     wi_test_enumerator_instances_all_data(vo
 WI_TEST_EXPORT void                     wi_test_enumerator_scalars_enumeration(void);
 WI_TEST_EXPORT void                     wi_test_enumerator_scalars_all_data(void);
 WI_TEST_EXPORT void                     wi_test_error(void);
+WI_TEST_EXPORT void                     wi_test_fast_lock_locking(void);
+WI_TEST_EXPORT void                     wi_test_fast_lock_contention(void);
+WI_TEST_EXPORT void                     wi_test_fast_lock_profiling(void);
+WI_TEST_EXPORT void                     wi_test_file_index(void);
 WI_TEST_EXPORT void                     wi_test_file_creation(void);
 WI_TEST_EXPORT void                     wi_test_file_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_file_reading(void);
 WI_TEST_EXPORT void                     wi_test_file_writing(void);
 WI_TEST_EXPORT void                     wi_test_file_updating(void);
 WI_TEST_EXPORT void                     wi_test_file_truncating(void);
+WI_TEST_EXPORT void                     wi_test_file_mapping(void);
+WI_TEST_EXPORT void                     wi_test_file_positional_io(void);
 WI_TEST_EXPORT void                     wi_test_filesystem_events(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_events_recursive(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_events_overlapping(void);
 WI_TEST_EXPORT void                     wi_test_filesystem_successes(void);
 WI_TEST_EXPORT void                     wi_test_filesystem_failures(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_copying(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_walking(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_walking_deep(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_file_stats_fields(void);
 WI_TEST_EXPORT void                     wi_test_host_creation(void);
 WI_TEST_EXPORT void                     wi_test_host_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_host_addresses(void);
@@ -75,12 +98,30 @@ WI_TEST_EXPORT void                     wi_test_indexset_indexes(void);
 WI_TEST_EXPORT void                     wi_test_indexset_enumeration_with_index(void);
 WI_TEST_EXPORT void                     wi_test_indexset_enumeration_with_range(void);
 WI_TEST_EXPORT void                     wi_test_indexset_mutation(void);
+WI_TEST_EXPORT void                     wi_test_io_engine_creation(void);
+WI_TEST_EXPORT void                     wi_test_io_engine_runtime_functions(void);
+WI_TEST_EXPORT void                     wi_test_io_engine_files(void);
+WI_TEST_EXPORT void                     wi_test_io_engine_sockets(void);
+WI_TEST_EXPORT void                     wi_test_io_engine_release_in_flight(void);
+WI_TEST_EXPORT void                         wi_test_json_document(void);
+WI_TEST_EXPORT void                         wi_test_json_document_parsing(void);
+WI_TEST_EXPORT void                         wi_test_json_reader(void);
+WI_TEST_EXPORT void                         wi_test_json_reader_errors(void);
+WI_TEST_EXPORT void                         wi_test_json_writer(void);
+WI_TEST_EXPORT void                         wi_test_json_writer_pipe(void);
+WI_TEST_EXPORT void                         wi_test_json_writer_errors(void);
 WI_TEST_EXPORT void                     wi_test_json(void);
+WI_TEST_EXPORT void                     wi_test_json_parsing(void);
+WI_TEST_EXPORT void                     wi_test_json_serialization(void);
+WI_TEST_EXPORT void                     wi_test_lock_profiling_statistics(void);
+WI_TEST_EXPORT void                     wi_test_lock_profiling_log_statistics(void);
 WI_TEST_EXPORT void                     wi_test_lock_creation(void);
 WI_TEST_EXPORT void                     wi_test_lock_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_lock_locking(void);
 WI_TEST_EXPORT void                     wi_test_log_file_logging(void);
 WI_TEST_EXPORT void                     wi_test_log_callback_logging(void);
+WI_TEST_EXPORT void                     wi_test_log_categories(void);
+WI_TEST_EXPORT void                     wi_test_log_structured_logging(void);
 WI_TEST_EXPORT void                     wi_test_md5_creation(void);
 WI_TEST_EXPORT void                     wi_test_md5_digest(void);
 WI_TEST_EXPORT void                     wi_test_null_creation(void);
@@ -93,11 +134,18 @@ WI_TEST_EXPORT void                     wi_test_number_values(void);
 WI_TEST_EXPORT void                     wi_test_pipe_creation(void);
 WI_TEST_EXPORT void                     wi_test_pipe_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_pipe_reading_and_writing(void);
+WI_TEST_EXPORT void                     wi_test_pipe_reading_available_bytes(void);
+WI_TEST_EXPORT void                     wi_test_pipe_reading_to_end_of_pipe(void);
 WI_TEST_EXPORT void                     wi_test_plist(void);
+WI_TEST_EXPORT void                     wi_test_plist_invalid(void);
+WI_TEST_EXPORT void                     wi_test_plist_binary(void);
 WI_TEST_EXPORT void                     wi_test_process(void);
 WI_TEST_EXPORT void                     wi_test_readwrite_lock_creation(void);
 WI_TEST_EXPORT void                     wi_test_readwrite_lock_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_readwrite_lock_locking(void);
+WI_TEST_EXPORT void                     wi_test_readwrite_lock_distributed_readers_locking(void);
+WI_TEST_EXPORT void                     wi_test_readwrite_lock_distributed_readers_contention(void);
+WI_TEST_EXPORT void                     wi_test_readwrite_lock_distributed_readers_mixed(void);
 WI_TEST_EXPORT void                     wi_test_recursive_lock_creation(void);
 WI_TEST_EXPORT void                     wi_test_recursive_lock_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_recursive_lock_locking(void);
@@ -139,6 +187,7 @@ WI_TEST_EXPORT void                     wi_test_string_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_string_comparison(void);
 WI_TEST_EXPORT void                     wi_test_string_constant(void);
 WI_TEST_EXPORT void                     wi_test_string_formatting(void);
+WI_TEST_EXPORT void                     wi_test_string_format_conversions(void);
 WI_TEST_EXPORT void                     wi_test_string_accessors(void);
 WI_TEST_EXPORT void                     wi_test_string_appending(void);
 WI_TEST_EXPORT void                     wi_test_string_inserting(void);
@@ -176,3 +225,5 @@ WI_TEST_EXPORT void                     wi_test_x509_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_x509_accessors(void);
 WI_TEST_EXPORT void                     wi_test_xml_parser_success(void);
 WI_TEST_EXPORT void                     wi_test_xml_parser_failure(void);
+WI_TEST_EXPORT void                     wi_test_xml_parser_lazy_nodes(void);
+WI_TEST_EXPORT void                     wi_test_xml_parser_xpath(void);
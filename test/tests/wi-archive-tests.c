@@ -0,0 +1,278 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <wired/wired.h>
+#include <wired/wi-private.h>
+#include <string.h>
+#include "test.h"
+
+#define _WI_TEST_ARCHIVE_BENCHMARK_COUNT        100000
+
+WI_TEST_EXPORT void                         wi_test_archive(void);
+WI_TEST_EXPORT void                         wi_test_archive_errors(void);
+WI_TEST_EXPORT void                         wi_test_archive_streams(void);
+WI_TEST_EXPORT void                         wi_test_archive_short_reads(void);
+WI_BENCHMARK_EXPORT void                    wi_test_archive_benchmark(void);
+
+
+static wi_runtime_instance_t *              _wi_test_archive_instance(void);
+static wi_integer_t                         _wi_test_archive_short_read(wi_runtime_instance_t *, wi_time_interval_t, void *, wi_uinteger_t);
+
+
+void wi_test_archive(void) {
+    wi_runtime_instance_t   *instance1, *instance2;
+    wi_data_t               *data1, *data2;
+    const char              *bytes;
+    
+    instance1 = _wi_test_archive_instance();
+    data1 = wi_archive_data_for_instance(instance1);
+    
+    WI_TEST_ASSERT_NOT_NULL(data1, "%m");
+    
+    instance2 = wi_archive_instance_for_data(data1);
+    
+    WI_TEST_ASSERT_NOT_NULL(instance2, "%m");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(instance2, instance1, "");
+    
+    /* Data values point into the archive instead of being copied */
+    data2 = wi_dictionary_data_for_key(instance2, WI_STR("data"));
+    bytes = wi_data_bytes(data2);
+    
+    WI_TEST_ASSERT_TRUE(bytes > (const char *) wi_data_bytes(data1), "");
+    WI_TEST_ASSERT_TRUE(bytes + wi_data_length(data2) <= (const char *) wi_data_bytes(data1) + wi_data_length(data1), "");
+    
+    /* Each repeated string is written once */
+    WI_TEST_ASSERT_TRUE(wi_data_length(data1) < 200, "%lu", wi_data_length(data1));
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_archive_instance_for_data(wi_archive_data_for_instance(WI_STR("hello"))), WI_STR("hello"), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_archive_instance_for_data(wi_archive_data_for_instance(wi_array())), wi_array(), "");
+}
+
+
+
+void wi_test_archive_errors(void) {
+    wi_mutable_array_t      *array;
+    wi_data_t               *data;
+    unsigned char           bytes[10];
+    wi_uinteger_t           length;
+    
+    data = wi_archive_data_for_instance(_wi_test_archive_instance());
+    length = wi_data_length(data);
+    
+    memcpy(bytes, wi_data_bytes(data), 8);
+    
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_with_bytes(bytes, 7)), "");
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_with_bytes(wi_data_bytes(data), length - 1)), "");
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_by_appending_bytes(data, "", 1)), "");
+    
+    bytes[4] = bytes[5] = bytes[6] = 0;
+    bytes[7] = 2;
+    
+    /* Unknown tag, truncated varint, string reference without strings, trailing bytes */
+    bytes[8] = 0x7F;
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_with_bytes(bytes, 10)), "");
+    bytes[8] = 0x03;
+    bytes[9] = 0x80;
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_with_bytes(bytes, 10)), "");
+    bytes[8] = 0x06;
+    bytes[9] = 0x00;
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_with_bytes(bytes, 10)), "");
+    bytes[8] = 0x00;
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_with_bytes(bytes, 10)), "");
+    
+    /* An array count larger than the rest of the archive */
+    bytes[8] = 0x09;
+    bytes[9] = 0x7F;
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_with_bytes(bytes, 10)), "");
+    
+    bytes[2] = 2;
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_with_bytes(bytes, 10)), "");
+    bytes[0] = 'X';
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_with_bytes(bytes, 10)), "");
+    
+    /* A dictionary key that is not a string */
+    WI_TEST_ASSERT_NULL(wi_archive_instance_for_data(wi_data_with_bytes("\x57\x41\x01\x00\x00\x00\x00\x06\x0a\x01\x00\x01\x6b\x00", 14)), "");
+    
+    WI_TEST_ASSERT_NULL(wi_archive_data_for_instance(wi_set()), "");
+    WI_TEST_ASSERT_NULL(wi_archive_data_for_instance(wi_dictionary_with_data_and_keys(WI_STR("value"), wi_number_with_integer(1), NULL)), "");
+    
+    array = wi_mutable_array();
+    
+    wi_mutable_array_add_data(array, array);
+    
+    WI_TEST_ASSERT_NULL(wi_archive_data_for_instance(array), "");
+    
+    wi_mutable_array_remove_all_data(array);
+}
+
+
+
+void wi_test_archive_streams(void) {
+    wi_runtime_instance_t   *instance;
+    wi_file_t               *file;
+    wi_pipe_t               *pipe;
+    
+    instance = _wi_test_archive_instance();
+    file = wi_file_temporary_file();
+    
+    WI_TEST_ASSERT_TRUE(wi_archive_write_instance_to_file(instance, file), "%m");
+    WI_TEST_ASSERT_TRUE(wi_archive_write_instance_to_file(WI_STR("second"), file), "%m");
+    
+    wi_file_seek(file, 0);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_archive_read_instance_from_file(file), instance, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_archive_read_instance_from_file(file), WI_STR("second"), "");
+    WI_TEST_ASSERT_NULL(wi_archive_read_instance_from_file(file), "");
+    WI_TEST_ASSERT_EQUALS(wi_error_code(), WI_ERROR_SOCKET_EOF, "");
+    
+    pipe = wi_pipe();
+    
+    WI_TEST_ASSERT_TRUE(wi_archive_write_instance_to_pipe(instance, pipe), "%m");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_archive_read_instance_from_pipe(pipe), instance, "");
+}
+
+
+
+void wi_test_archive_short_reads(void) {
+    wi_runtime_instance_t   *instance;
+    wi_data_t               *data;
+    wi_file_t               *file;
+    
+    instance = _wi_test_archive_instance();
+    data = wi_archive_data_for_instance(instance);
+    file = wi_file_temporary_file();
+    
+    WI_TEST_ASSERT_TRUE(wi_file_write_bytes(file, wi_data_bytes(data), wi_data_length(data)) > 0, "%m");
+    
+    wi_file_seek(file, 0);
+    
+    /* Like a TLS socket, the source hands out the header and payload in pieces */
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_archive_read_instance_with_function(file, 0.0, _wi_test_archive_short_read), instance, "");
+    WI_TEST_ASSERT_NULL(wi_archive_read_instance_with_function(file, 0.0, _wi_test_archive_short_read), "");
+    WI_TEST_ASSERT_EQUALS(wi_error_code(), WI_ERROR_SOCKET_EOF, "");
+    
+    file = wi_file_temporary_file();
+    
+    WI_TEST_ASSERT_TRUE(wi_file_write_bytes(file, wi_data_bytes(data), wi_data_length(data) - 1) > 0, "%m");
+    
+    wi_file_seek(file, 0);
+    
+    WI_TEST_ASSERT_NULL(wi_archive_read_instance_with_function(file, 0.0, _wi_test_archive_short_read), "");
+    WI_TEST_ASSERT_EQUALS(wi_error_code(), WI_ERROR_ARCHIVE_READFAILED, "");
+}
+
+
+
+static wi_integer_t _wi_test_archive_short_read(wi_runtime_instance_t *source, wi_time_interval_t timeout, void *buffer, wi_uinteger_t length) {
+    return wi_file_read_bytes(source, buffer, WI_MIN(length, 3));
+}
+
+
+
+void wi_test_archive_benchmark(void) {
+#ifdef WI_PLIST
+    wi_mutable_array_t      *array;
+    wi_data_t               *archive, *plist;
+    wi_runtime_instance_t   *instance;
+    wi_time_interval_t      interval, archive_interval, plist_interval;
+    wi_uinteger_t           i;
+    
+    array = wi_array_init_with_capacity(wi_mutable_array_alloc(), _WI_TEST_ARCHIVE_BENCHMARK_COUNT);
+    
+    for(i = 0; i < _WI_TEST_ARCHIVE_BENCHMARK_COUNT; i++) {
+        wi_mutable_array_add_data(array, wi_dictionary_with_data_and_keys(
+            wi_number_with_integer(i),
+                wi_string_with_format(WI_STR("id")),
+            wi_string_with_format(WI_STR("user %lu"), i),
+                wi_string_with_format(WI_STR("name")),
+            wi_number_with_double((i % 1000) + 0.25),
+                wi_string_with_format(WI_STR("ratio")),
+            wi_number_with_bool(i % 2),
+                wi_string_with_format(WI_STR("admin")),
+            NULL));
+    }
+    
+    interval = wi_time_interval();
+    archive = wi_archive_data_for_instance(array);
+    instance = wi_archive_instance_for_data(archive);
+    archive_interval = wi_time_interval() - interval;
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(instance, array, "");
+    
+    interval = wi_time_interval();
+    plist = wi_plist_data_for_instance(array, WI_PLIST_FORMAT_XML);
+    instance = wi_plist_instance_for_data(plist);
+    plist_interval = wi_time_interval() - interval;
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(instance, array, "");
+    
+    wi_log_info(WI_STR("Archived %lu entries to %.1f MB in %.2f seconds, property list %.1f MB in %.2f seconds"),
+        wi_array_count(array),
+        (double) wi_data_length(archive) / (1024.0 * 1024.0),
+        archive_interval,
+        (double) wi_data_length(plist) / (1024.0 * 1024.0),
+        plist_interval);
+    
+    wi_release(array);
+#endif
+}
+
+
+
+#pragma mark -
+
+static wi_runtime_instance_t * _wi_test_archive_instance(void) {
+    return wi_dictionary_with_data_and_keys(
+        WI_STR("h\xc3\xa9llo"),
+            WI_STR("string"),
+        wi_number_with_bool(true),
+            WI_STR("true"),
+        wi_number_with_bool(false),
+            WI_STR("false"),
+        wi_number_with_integer(42),
+            WI_STR("small"),
+        wi_number_with_integer(-42),
+            WI_STR("negative"),
+        wi_number_with_int64(INT64_MAX),
+            WI_STR("large"),
+        wi_number_with_int64(INT64_MIN),
+            WI_STR("min"),
+        wi_number_with_double(3.14),
+            WI_STR("real"),
+        wi_date_with_time_interval(1212341280.5),
+            WI_STR("date"),
+        wi_data_with_bytes("hello world", 11),
+            WI_STR("data"),
+        wi_null(),
+            WI_STR("null"),
+        wi_array_with_data(
+            wi_dictionary_with_data_and_keys(WI_STR("h\xc3\xa9llo"), WI_STR("string"), NULL),
+            wi_dictionary_with_data_and_keys(WI_STR("h\xc3\xa9llo"), WI_STR("string"), NULL),
+            wi_dictionary_with_data_and_keys(WI_STR("h\xc3\xa9llo"), WI_STR("string"), NULL),
+            NULL),
+            WI_STR("array"),
+        NULL);
+}
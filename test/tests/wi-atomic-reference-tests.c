@@ -0,0 +1,174 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <wired/wired.h>
+
+#define _WI_TEST_ATOMIC_REFERENCE_THREADS           4
+#define _WI_TEST_ATOMIC_REFERENCE_ITERATIONS        10000
+
+WI_TEST_EXPORT void                     wi_test_atomic_reference_creation(void);
+WI_TEST_EXPORT void                     wi_test_atomic_reference_runtime_functions(void);
+WI_TEST_EXPORT void                     wi_test_atomic_reference_publishing(void);
+WI_TEST_EXPORT void                     wi_test_atomic_reference_concurrency(void);
+
+#ifdef WI_PTHREADS
+static void                             _wi_test_atomic_reference_concurrency_thread(wi_runtime_instance_t *);
+
+
+static wi_atomic_reference_t            *_wi_test_atomic_reference_reference;
+static wi_condition_lock_t              *_wi_test_atomic_reference_finished_lock;
+static wi_uinteger_t                    _wi_test_atomic_reference_threads;
+static wi_boolean_t                     _wi_test_atomic_reference_failed;
+#endif
+
+
+void wi_test_atomic_reference_creation(void) {
+    wi_atomic_reference_t   *reference;
+    
+    reference = wi_atomic_reference_with_instance(WI_STR("hello world"));
+    
+    WI_TEST_ASSERT_NOT_NULL(reference, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_atomic_reference_instance(reference), WI_STR("hello world"), "");
+    
+    reference = wi_autorelease(wi_atomic_reference_init(wi_atomic_reference_alloc()));
+    
+    WI_TEST_ASSERT_NOT_NULL(reference, "");
+    WI_TEST_ASSERT_NULL(wi_atomic_reference_instance(reference), "");
+}
+
+
+
+void wi_test_atomic_reference_runtime_functions(void) {
+    wi_atomic_reference_t   *reference;
+    
+    reference = wi_atomic_reference_with_instance(WI_STR("hello world"));
+    
+    WI_TEST_ASSERT_EQUALS(wi_runtime_id(reference), wi_atomic_reference_runtime_id(), "");
+    
+    WI_TEST_ASSERT_NOT_EQUALS(wi_string_index_of_string(wi_description(reference), WI_STR("wi_atomic_reference_t"), 0), WI_NOT_FOUND, "");
+    WI_TEST_ASSERT_NOT_EQUALS(wi_string_index_of_string(wi_description(reference), WI_STR("hello world"), 0), WI_NOT_FOUND, "");
+}
+
+
+
+void wi_test_atomic_reference_publishing(void) {
+    wi_atomic_reference_t       *reference;
+    wi_mutable_dictionary_t     *dictionary;
+    wi_dictionary_t             *snapshot, *new_snapshot;
+    
+    dictionary = wi_mutable_dictionary_with_data_and_keys(WI_STR("value1"), WI_STR("key1"), NULL);
+    reference = wi_atomic_reference_with_instance(dictionary);
+    snapshot = wi_atomic_reference_instance(reference);
+    
+    WI_TEST_ASSERT_TRUE(snapshot != dictionary, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(snapshot, dictionary, "");
+    WI_TEST_ASSERT_FALSE(wi_runtime_options(snapshot) & WI_RUNTIME_OPTION_MUTABLE, "");
+    
+    wi_mutable_dictionary_set_data_for_key(dictionary, WI_STR("value2"), WI_STR("key2"));
+    
+    WI_TEST_ASSERT_EQUALS(wi_dictionary_count(snapshot), 1U, "");
+    
+    wi_atomic_reference_set_instance(reference, dictionary);
+    new_snapshot = wi_atomic_reference_instance(reference);
+    
+    WI_TEST_ASSERT_EQUALS(wi_dictionary_count(new_snapshot), 2U, "");
+    WI_TEST_ASSERT_EQUALS(wi_dictionary_count(snapshot), 1U, "");
+    
+    WI_TEST_ASSERT_FALSE(wi_atomic_reference_compare_and_set_instance(reference, snapshot, wi_dictionary()), "");
+    WI_TEST_ASSERT_EQUALS(wi_dictionary_count(wi_atomic_reference_instance(reference)), 2U, "");
+    
+    WI_TEST_ASSERT_TRUE(wi_atomic_reference_compare_and_set_instance(reference, new_snapshot, wi_dictionary()), "");
+    WI_TEST_ASSERT_EQUALS(wi_dictionary_count(wi_atomic_reference_instance(reference)), 0U, "");
+}
+
+
+
+void wi_test_atomic_reference_concurrency(void) {
+#ifdef WI_PTHREADS
+    wi_mutable_array_t      *array;
+    wi_uinteger_t           i;
+    
+    _wi_test_atomic_reference_reference = wi_atomic_reference_init_with_instance(wi_atomic_reference_alloc(), wi_array());
+    _wi_test_atomic_reference_finished_lock = wi_condition_lock_init_with_condition(wi_condition_lock_alloc(), 0);
+    _wi_test_atomic_reference_threads = _WI_TEST_ATOMIC_REFERENCE_THREADS;
+    _wi_test_atomic_reference_failed = false;
+    
+    for(i = 0; i < _WI_TEST_ATOMIC_REFERENCE_THREADS; i++)
+        WI_TEST_ASSERT_TRUE(wi_thread_create_thread(_wi_test_atomic_reference_concurrency_thread, NULL), "");
+    
+    for(i = 0; i < _WI_TEST_ATOMIC_REFERENCE_ITERATIONS; i++) {
+        array = wi_array_init(wi_mutable_array_alloc());
+        
+        wi_mutable_array_add_data(array, wi_number_with_integer(i));
+        wi_mutable_array_add_data(array, wi_number_with_integer(i));
+        
+        wi_atomic_reference_set_instance(_wi_test_atomic_reference_reference, array);
+        
+        wi_release(array);
+    }
+    
+    wi_condition_lock_lock_when_condition(_wi_test_atomic_reference_finished_lock, 1, 0.0);
+    wi_condition_lock_unlock(_wi_test_atomic_reference_finished_lock);
+    
+    WI_TEST_ASSERT_FALSE(_wi_test_atomic_reference_failed, "");
+    
+    wi_release(_wi_test_atomic_reference_finished_lock);
+    wi_release(_wi_test_atomic_reference_reference);
+#endif
+}
+
+
+
+#ifdef WI_PTHREADS
+
+static void _wi_test_atomic_reference_concurrency_thread(wi_runtime_instance_t *argument) {
+    wi_pool_t       *pool;
+    wi_array_t      *array;
+    wi_uinteger_t   i;
+    
+    pool = wi_pool_init(wi_pool_alloc());
+    
+    for(i = 0; i < _WI_TEST_ATOMIC_REFERENCE_ITERATIONS; i++) {
+        array = wi_atomic_reference_instance(_wi_test_atomic_reference_reference);
+        
+        if(wi_array_count(array) > 0 && !wi_is_equal(WI_ARRAY(array, 0), WI_ARRAY(array, 1)))
+            _wi_test_atomic_reference_failed = true;
+        
+        if(i % 100 == 0)
+            wi_pool_drain(pool);
+    }
+    
+    wi_release(pool);
+    
+    wi_condition_lock_lock(_wi_test_atomic_reference_finished_lock);
+    
+    if(--_wi_test_atomic_reference_threads == 0)
+        wi_condition_lock_unlock_with_condition(_wi_test_atomic_reference_finished_lock, 1);
+    else
+        wi_condition_lock_unlock(_wi_test_atomic_reference_finished_lock);
+}
+
+#endif
@@ -25,8 +25,15 @@
  */
 
 #include <wired/wired.h>
+#include <string.h>
+
+#define _WI_TEST_BASE64_BENCHMARK_LENGTH        (16 * 1024 * 1024)
+
 
 WI_TEST_EXPORT void                     wi_test_base64(void);
+WI_TEST_EXPORT void                     wi_test_base64_buffers(void);
+WI_TEST_EXPORT void                     wi_test_base64_streaming(void);
+WI_BENCHMARK_EXPORT void                wi_test_base64_benchmark(void);
 
 
 
@@ -40,3 +47,129 @@ void wi_test_base64(void) {
     WI_TEST_ASSERT_EQUAL_INSTANCES(string, WI_STR("aGVsbG8gd29ybGQ="), "");
     WI_TEST_ASSERT_EQUAL_INSTANCES(wi_data_from_base64_string(string), wi_data_with_base64_string(WI_STR("aGVsbG8gd29ybGQ=")), "");
 }
+
+
+
+void wi_test_base64_buffers(void) {
+    static const char   *vectors[][2] = {
+        { "",       "" },
+        { "f",      "Zg==" },
+        { "fo",     "Zm8=" },
+        { "foo",    "Zm9v" },
+        { "foob",   "Zm9vYg==" },
+        { "fooba",  "Zm9vYmE=" },
+        { "foobar", "Zm9vYmFy" },
+    };
+    unsigned char       bytes[256], buffer[256];
+    char                string[512];
+    wi_uinteger_t       i, length;
+    
+    for(i = 0; i < WI_ARRAY_SIZE(vectors); i++) {
+        length = wi_base64_encode(vectors[i][0], strlen(vectors[i][0]), string);
+        
+        WI_TEST_ASSERT_EQUALS(length, strlen(vectors[i][1]), "");
+        WI_TEST_ASSERT_EQUALS(length, wi_base64_encoded_length(strlen(vectors[i][0])), "");
+        WI_TEST_ASSERT_EQUALS(memcmp(string, vectors[i][1], length), 0, "");
+        
+        length = wi_base64_decode(vectors[i][1], strlen(vectors[i][1]), buffer);
+        
+        WI_TEST_ASSERT_EQUALS(length, strlen(vectors[i][0]), "");
+        WI_TEST_ASSERT_EQUALS(memcmp(buffer, vectors[i][0], length), 0, "");
+    }
+    
+    for(i = 0; i < sizeof(bytes); i++)
+        bytes[i] = (i * 37) ^ 0xA5;
+    
+    for(i = 0; i <= sizeof(bytes); i++) {
+        length = wi_base64_encode(bytes, i, string);
+        
+        WI_TEST_ASSERT_EQUALS(wi_base64_decode(string, length, buffer), i, "");
+        WI_TEST_ASSERT_EQUALS(memcmp(buffer, bytes, i), 0, "");
+    }
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_data_with_base64_string(WI_STR("aGVs\nbG8g\r\nd29y bGQ=")),
+                                   wi_data_with_base64_string(WI_STR("aGVsbG8gd29ybGQ=")),
+                                   "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_data_with_base64_string(WI_STR("aGVsbG8gd29ybGQ")),
+                                   wi_data_with_base64_string(WI_STR("aGVsbG8gd29ybGQ=")),
+                                   "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_data_with_base64_string(WI_STR("aGVsbG8gd29ybGQ=aGVsbG8=")),
+                                   wi_data_with_base64_string(WI_STR("aGVsbG8gd29ybGQ=")),
+                                   "");
+}
+
+
+
+void wi_test_base64_streaming(void) {
+    wi_base64_encoder_t     *encoder;
+    wi_base64_decoder_t     *decoder;
+    unsigned char           bytes[1000], buffer[1000];
+    char                    string[1400], streamed_string[1400];
+    wi_uinteger_t           i, length, streamed_length, chunk;
+    
+    for(i = 0; i < sizeof(bytes); i++)
+        bytes[i] = (i * 131) >> 3;
+    
+    length = wi_base64_encode(bytes, sizeof(bytes), string);
+    encoder = wi_base64_encoder();
+    streamed_length = 0;
+    
+    for(i = 0; i < sizeof(bytes); i += chunk) {
+        chunk = WI_MIN(sizeof(bytes) - i, (i % 7) + 1);
+        streamed_length += wi_base64_encoder_update(encoder, bytes + i, chunk, streamed_string + streamed_length);
+    }
+    
+    streamed_length += wi_base64_encoder_close(encoder, streamed_string + streamed_length);
+    
+    WI_TEST_ASSERT_EQUALS(streamed_length, length, "");
+    WI_TEST_ASSERT_EQUALS(memcmp(streamed_string, string, length), 0, "");
+    
+    decoder = wi_base64_decoder();
+    streamed_length = 0;
+    
+    for(i = 0; i < length; i += chunk) {
+        chunk = WI_MIN(length - i, (i % 5) + 1);
+        streamed_length += wi_base64_decoder_update(decoder, string + i, chunk, buffer + streamed_length);
+    }
+    
+    streamed_length += wi_base64_decoder_close(decoder, buffer + streamed_length);
+    
+    WI_TEST_ASSERT_EQUALS(streamed_length, sizeof(bytes), "");
+    WI_TEST_ASSERT_EQUALS(memcmp(buffer, bytes, sizeof(bytes)), 0, "");
+}
+
+
+
+void wi_test_base64_benchmark(void) {
+    wi_mutable_data_t       *data;
+    wi_data_t               *decoded;
+    wi_string_t             *string;
+    wi_time_interval_t      interval, encode_interval, decode_interval;
+    uint32_t                value;
+    wi_uinteger_t           i;
+    
+    data = wi_data_init_with_capacity(wi_mutable_data_alloc(), _WI_TEST_BASE64_BENCHMARK_LENGTH);
+    
+    for(i = 0, value = 1; i < _WI_TEST_BASE64_BENCHMARK_LENGTH; i += sizeof(value)) {
+        value = (value * 1103515245) + 12345;
+        
+        wi_mutable_data_append_bytes(data, &value, sizeof(value));
+    }
+    
+    interval = wi_time_interval();
+    string = wi_base64_string_from_data(data);
+    encode_interval = wi_time_interval() - interval;
+    
+    interval = wi_time_interval();
+    decoded = wi_data_from_base64_string(string);
+    decode_interval = wi_time_interval() - interval;
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(decoded, data, "");
+    
+    wi_log_info(WI_STR("Encoded %.0f MB of base64 at %.0f MB/s, decoded at %.0f MB/s"),
+        (double) wi_data_length(data) / (1024.0 * 1024.0),
+        ((double) wi_data_length(data) / (1024.0 * 1024.0)) / encode_interval,
+        ((double) wi_data_length(data) / (1024.0 * 1024.0)) / decode_interval);
+    
+    wi_release(data);
+}
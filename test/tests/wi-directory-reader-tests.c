@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <wired/wired.h>
+
+WI_TEST_EXPORT void                     wi_test_directory_reader(void);
+
+
+void wi_test_directory_reader(void) {
+    wi_directory_reader_t               *reader;
+    wi_mutable_dictionary_t             *entries;
+    wi_string_t                         *path, *name;
+    wi_directory_entry_t                entry;
+    wi_directory_entry_stats_t          stats;
+    wi_directory_reader_status_t        status;
+    wi_boolean_t                        result;
+    wi_uinteger_t                       i;
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-directory-reader.XXXXXXX"));
+    result = wi_filesystem_create_directory_at_path(path);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    reader = wi_filesystem_directory_reader_at_path(path);
+    
+    WI_TEST_ASSERT_NOT_NULL(reader, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_directory_reader_path(reader), path, "");
+    
+    status = wi_directory_reader_read_entry(reader, &entry);
+    
+    WI_TEST_ASSERT_TRUE(status == WI_DIRECTORY_READER_EOF, "");
+    
+    result = wi_filesystem_create_directory_at_path(wi_string_by_appending_path_component(path, WI_STR("directory")));
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    result = wi_string_write_utf8_string_to_path(WI_STR("file"), wi_string_by_appending_path_component(path, WI_STR("file")));
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    result = wi_filesystem_create_symbolic_link_from_path(WI_STR("file"), wi_string_by_appending_path_component(path, WI_STR("link")));
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    for(i = 0; i < 1000; i++) {
+        result = wi_filesystem_create_directory_at_path(wi_string_by_appending_path_component(path, wi_string_with_format(WI_STR("directory%lu"), i)));
+        
+        WI_TEST_ASSERT_TRUE(result, "");
+    }
+    
+    reader = wi_filesystem_directory_reader_at_path(path);
+    entries = wi_mutable_dictionary();
+    
+    WI_TEST_ASSERT_NOT_NULL(reader, "");
+    
+    while((status = wi_directory_reader_read_entry(reader, &entry)) == WI_DIRECTORY_READER_ENTRY) {
+        name = wi_string_with_utf8_bytes(entry.name, entry.name_length);
+        
+        WI_TEST_ASSERT_TRUE(entry.inode > 0, "");
+        WI_TEST_ASSERT_EQUAL_INSTANCES(wi_directory_reader_path_for_entry(reader, &entry), wi_string_by_appending_path_component(path, name), "");
+        
+        if(wi_is_equal(name, WI_STR("file"))) {
+            result = wi_directory_reader_get_stats_for_entry(reader, &entry, WI_DIRECTORY_ENTRY_TYPE | WI_DIRECTORY_ENTRY_SIZE, &stats);
+            
+            WI_TEST_ASSERT_TRUE(result, "");
+            WI_TEST_ASSERT_EQUALS(stats.size, 4ULL, "");
+        } else if(entry.type == WI_DIRECTORY_ENTRY_UNKNOWN) {
+            result = wi_directory_reader_get_stats_for_entry(reader, &entry, WI_DIRECTORY_ENTRY_TYPE, &stats);
+            
+            WI_TEST_ASSERT_TRUE(result, "");
+        }
+        
+        wi_mutable_dictionary_set_data_for_key(entries, WI_INT32(entry.type), name);
+    }
+    
+    WI_TEST_ASSERT_TRUE(status == WI_DIRECTORY_READER_EOF, "");
+    WI_TEST_ASSERT_EQUALS(wi_dictionary_count(entries), 1003U, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_dictionary_data_for_key(entries, WI_STR("directory")), WI_INT32(WI_DIRECTORY_ENTRY_DIRECTORY), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_dictionary_data_for_key(entries, WI_STR("directory999")), WI_INT32(WI_DIRECTORY_ENTRY_DIRECTORY), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_dictionary_data_for_key(entries, WI_STR("file")), WI_INT32(WI_DIRECTORY_ENTRY_FILE), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_dictionary_data_for_key(entries, WI_STR("link")), WI_INT32(WI_DIRECTORY_ENTRY_SYMBOLIC_LINK), "");
+    
+    WI_TEST_ASSERT_EQUALS(wi_array_count(wi_filesystem_directory_contents_at_path(path)), 1003U, "");
+    
+    reader = wi_filesystem_directory_reader_at_path(wi_string_by_appending_path_component(path, WI_STR("file")));
+    
+    WI_TEST_ASSERT_NULL(reader, "");
+    
+    reader = wi_filesystem_directory_reader_at_path(WI_STR("/"));
+    
+    WI_TEST_ASSERT_NOT_NULL(reader, "");
+    
+    status = wi_directory_reader_read_entry(reader, &entry);
+    
+    WI_TEST_ASSERT_TRUE(status == WI_DIRECTORY_READER_ENTRY, "");
+    
+    name = wi_string_with_utf8_bytes(entry.name, entry.name_length);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_directory_reader_path_for_entry(reader, &entry), wi_string_by_appending_string(WI_STR("/"), name), "");
+    
+    wi_filesystem_delete_path(path);
+}
@@ -0,0 +1,141 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <wired/wired.h>
+
+#define _WI_TEST_FAST_LOCK_THREADS              4
+#define _WI_TEST_FAST_LOCK_ITERATIONS           100000
+
+WI_TEST_EXPORT void                     wi_test_fast_lock_locking(void);
+WI_TEST_EXPORT void                     wi_test_fast_lock_contention(void);
+WI_TEST_EXPORT void                     wi_test_fast_lock_profiling(void);
+
+#ifdef WI_PTHREADS
+static void                             _wi_test_fast_lock_contention_thread(wi_runtime_instance_t *);
+#endif
+
+
+static wi_fast_lock_t                   _wi_test_fast_lock_lock = WI_FAST_LOCK_INITIALIZER;
+static wi_uinteger_t                    _wi_test_fast_lock_counter;
+static wi_uinteger_t                    _wi_test_fast_lock_finished;
+
+
+void wi_test_fast_lock_locking(void) {
+    wi_fast_lock_t  lock = WI_FAST_LOCK_INITIALIZER;
+    wi_boolean_t    result;
+    
+    wi_fast_lock_lock(&lock);
+    
+    result = wi_fast_lock_try_lock(&lock);
+    
+    WI_TEST_ASSERT_FALSE(result, "");
+    
+    wi_fast_lock_unlock(&lock);
+    
+    result = wi_fast_lock_try_lock(&lock);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    wi_fast_lock_unlock(&lock);
+}
+
+
+
+void wi_test_fast_lock_contention(void) {
+#ifdef WI_PTHREADS
+    wi_uinteger_t   i;
+    wi_boolean_t    finished;
+    
+    _wi_test_fast_lock_counter = 0;
+    _wi_test_fast_lock_finished = 0;
+    
+    for(i = 0; i < _WI_TEST_FAST_LOCK_THREADS; i++)
+        WI_TEST_ASSERT_TRUE(wi_thread_create_thread(_wi_test_fast_lock_contention_thread, NULL), "");
+    
+    do {
+        wi_thread_sleep(0.01);
+        
+        wi_fast_lock_lock(&_wi_test_fast_lock_lock);
+        finished = (_wi_test_fast_lock_finished == _WI_TEST_FAST_LOCK_THREADS);
+        wi_fast_lock_unlock(&_wi_test_fast_lock_lock);
+    } while(!finished);
+    
+    WI_TEST_ASSERT_EQUALS(_wi_test_fast_lock_counter, (wi_uinteger_t) _WI_TEST_FAST_LOCK_THREADS * _WI_TEST_FAST_LOCK_ITERATIONS, "");
+#endif
+}
+
+
+
+#ifdef WI_PTHREADS
+
+static void _wi_test_fast_lock_contention_thread(wi_runtime_instance_t *argument) {
+    wi_uinteger_t   i;
+    
+    for(i = 0; i < _WI_TEST_FAST_LOCK_ITERATIONS; i++) {
+        wi_fast_lock_lock(&_wi_test_fast_lock_lock);
+        _wi_test_fast_lock_counter++;
+        wi_fast_lock_unlock(&_wi_test_fast_lock_lock);
+    }
+    
+    wi_fast_lock_lock(&_wi_test_fast_lock_lock);
+    _wi_test_fast_lock_finished++;
+    wi_fast_lock_unlock(&_wi_test_fast_lock_lock);
+}
+
+#endif
+
+
+
+void wi_test_fast_lock_profiling(void) {
+    static wi_fast_lock_t   lock = WI_FAST_LOCK_INITIALIZER;
+    wi_enumerator_t         *enumerator;
+    wi_dictionary_t         *statistics, *lock_statistics;
+    wi_boolean_t            enabled;
+    
+    enabled = wi_lock_profiling_enabled;
+    wi_lock_profiling_enabled = true;
+    
+    wi_fast_lock_lock(&lock);
+    wi_fast_lock_unlock(&lock);
+    
+    if(wi_fast_lock_try_lock(&lock))
+        wi_fast_lock_unlock(&lock);
+    
+    wi_lock_profiling_enabled = enabled;
+    
+    lock_statistics = NULL;
+    enumerator = wi_array_data_enumerator(wi_lock_profiling_statistics());
+    
+    while((statistics = wi_enumerator_next_data(enumerator))) {
+        if(wi_string_has_prefix(wi_dictionary_data_for_key(statistics, WI_STR("site")), WI_STR("wi-fast-lock-tests.c:")))
+            lock_statistics = statistics;
+    }
+    
+    WI_TEST_ASSERT_NOT_NULL(lock_statistics, "");
+    WI_TEST_ASSERT_EQUALS(wi_number_integer(wi_dictionary_data_for_key(lock_statistics, WI_STR("acquisitions"))), 2, "");
+    WI_TEST_ASSERT_EQUALS(wi_number_integer(wi_dictionary_data_for_key(lock_statistics, WI_STR("contentions"))), 0, "");
+    WI_TEST_ASSERT_NOT_NULL(wi_dictionary_data_for_key(lock_statistics, WI_STR("hold_time")), "");
+}
@@ -0,0 +1,157 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <wired/wired.h>
+
+WI_TEST_EXPORT void                     wi_test_file_index(void);
+
+
+void wi_test_file_index(void) {
+    wi_file_index_t                     *index;
+    wi_file_index_entry_t               entry;
+    wi_time_interval_t                  modification_time;
+    wi_array_t                          *paths;
+    wi_string_t                         *path, *indexpath, *subpath;
+    wi_uinteger_t                       i, j;
+    wi_boolean_t                        result;
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-file-index.XXXXXXX"));
+    indexpath = wi_string_by_appending_path_extension(path, WI_STR("index"));
+    result = wi_filesystem_create_directory_at_path(path);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    for(i = 0; i < 10; i++) {
+        subpath = wi_string_by_appending_path_component(path, wi_string_with_format(WI_STR("directory%lu"), i));
+        result = wi_filesystem_create_directory_at_path(subpath);
+        
+        WI_TEST_ASSERT_TRUE(result, "");
+        
+        for(j = 0; j < 10; j++) {
+            result = wi_string_write_utf8_string_to_path(WI_STR("file"), wi_string_by_appending_path_component(subpath, wi_string_with_format(WI_STR("file%lu"), j)));
+            
+            WI_TEST_ASSERT_TRUE(result, "");
+        }
+    }
+    
+    result = wi_string_write_utf8_string_to_path(WI_STR("readme"), wi_string_by_appending_path_component(path, WI_STR("ReadMe.txt")));
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    result = wi_string_write_utf8_string_to_path(WI_STR("hidden"), wi_string_by_appending_path_component(path, WI_STR(".hidden")));
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    index = wi_autorelease(wi_file_index_init_with_path(wi_file_index_alloc(), path));
+    
+    WI_TEST_ASSERT_NOT_NULL(index, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_file_index_root_path(index), path, "");
+    WI_TEST_ASSERT_EQUALS(wi_file_index_count(index), 111U, "");
+    
+    result = wi_file_index_get_entry_for_path(index, wi_string_by_appending_path_component(path, WI_STR("ReadMe.txt")), &entry);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    WI_TEST_ASSERT_TRUE(entry.type == WI_FILE_REGULAR, "");
+    WI_TEST_ASSERT_EQUALS(entry.size, 6ULL, "");
+    WI_TEST_ASSERT_TRUE(entry.modification_time > 0.0, "");
+    
+    /* An update of an unchanged file must see the same time as the scan did */
+    modification_time = entry.modification_time;
+    result = wi_file_index_update_path_for_event(index, wi_string_by_appending_path_component(path, WI_STR("ReadMe.txt")), WI_FILESYSTEM_EVENT_MODIFIED);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    result = wi_file_index_get_entry_for_path(index, wi_string_by_appending_path_component(path, WI_STR("ReadMe.txt")), &entry);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    WI_TEST_ASSERT_EQUALS(entry.modification_time, modification_time, "");
+    
+    result = wi_file_index_get_entry_for_path(index, wi_string_by_appending_path_component(path, WI_STR("directory9")), &entry);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    WI_TEST_ASSERT_TRUE(entry.type == WI_FILE_DIRECTORY, "");
+    
+    WI_TEST_ASSERT_FALSE(wi_file_index_get_entry_for_path(index, wi_string_by_appending_path_component(path, WI_STR(".hidden")), &entry), "");
+    
+    paths = wi_file_index_paths_matching_name(index, WI_STR("readme"), WI_FILE_INDEX_MATCH_PREFIX);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(paths, wi_array_with_data(wi_string_by_appending_path_component(path, WI_STR("ReadMe.txt")), NULL), "");
+    WI_TEST_ASSERT_EQUALS(wi_array_count(wi_file_index_paths_matching_name(index, WI_STR("FILE1"), WI_FILE_INDEX_MATCH_PREFIX)), 10U, "");
+    WI_TEST_ASSERT_EQUALS(wi_array_count(wi_file_index_paths_matching_name(index, WI_STR("ory"), WI_FILE_INDEX_MATCH_PREFIX)), 0U, "");
+    WI_TEST_ASSERT_EQUALS(wi_array_count(wi_file_index_paths_matching_name(index, WI_STR("ory"), WI_FILE_INDEX_MATCH_SUBSTRING)), 10U, "");
+    
+    subpath = wi_string_by_appending_path_component(path, WI_STR("directory0/newfile"));
+    result = wi_string_write_utf8_string_to_path(WI_STR("newfile"), subpath);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    result = wi_file_index_update_path_for_event(index, subpath, WI_FILESYSTEM_EVENT_CREATED);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    WI_TEST_ASSERT_EQUALS(wi_file_index_count(index), 112U, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_file_index_paths_matching_name(index, WI_STR("newf"), WI_FILE_INDEX_MATCH_PREFIX), wi_array_with_data(subpath, NULL), "");
+    
+    subpath = wi_string_by_appending_path_component(path, WI_STR("directory1"));
+    result = wi_filesystem_delete_path(subpath);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    result = wi_file_index_update_path_for_event(index, subpath, WI_FILESYSTEM_EVENT_DELETED);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    WI_TEST_ASSERT_EQUALS(wi_file_index_count(index), 101U, "");
+    WI_TEST_ASSERT_EQUALS(wi_array_count(wi_file_index_paths_matching_name(index, WI_STR("file1"), WI_FILE_INDEX_MATCH_PREFIX)), 9U, "");
+    WI_TEST_ASSERT_FALSE(wi_file_index_get_entry_for_path(index, wi_string_by_appending_path_component(subpath, WI_STR("file1")), &entry), "");
+    
+    result = wi_file_index_write_to_path(index, indexpath);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    index = wi_autorelease(wi_file_index_init_with_contents_of_file(wi_file_index_alloc(), indexpath));
+    
+    WI_TEST_ASSERT_NOT_NULL(index, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_file_index_root_path(index), path, "");
+    WI_TEST_ASSERT_EQUALS(wi_file_index_count(index), 101U, "");
+    WI_TEST_ASSERT_EQUALS(wi_array_count(wi_file_index_paths_matching_name(index, WI_STR("file1"), WI_FILE_INDEX_MATCH_PREFIX)), 9U, "");
+    WI_TEST_ASSERT_TRUE(wi_file_index_get_entry_for_path(index, wi_string_by_appending_path_component(path, WI_STR("directory0/newfile")), &entry), "");
+    WI_TEST_ASSERT_EQUALS(entry.size, 7ULL, "");
+    
+    result = wi_file_index_update_path(index, path);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    WI_TEST_ASSERT_EQUALS(wi_file_index_count(index), 101U, "");
+    
+    result = wi_string_write_utf8_string_to_path(WI_STR("not an index"), indexpath);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    index = wi_autorelease(wi_file_index_init_with_contents_of_file(wi_file_index_alloc(), indexpath));
+    
+    WI_TEST_ASSERT_NULL(index, "");
+    
+    wi_filesystem_delete_path(indexpath);
+    wi_filesystem_delete_path(path);
+}
@@ -24,6 +24,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <string.h>
 #include <wired/wired.h>
 #include "test.h"
 
@@ -33,6 +34,8 @@ WI_TEST_EXPORT void                     wi_test_file_reading(void);
 WI_TEST_EXPORT void                     wi_test_file_writing(void);
 WI_TEST_EXPORT void                     wi_test_file_updating(void);
 WI_TEST_EXPORT void                     wi_test_file_truncating(void);
+WI_TEST_EXPORT void                     wi_test_file_mapping(void);
+WI_TEST_EXPORT void                     wi_test_file_positional_io(void);
 
 
 void wi_test_file_creation(void) {
@@ -212,3 +215,122 @@ void wi_test_file_truncating(void) {
     
     wi_filesystem_delete_path(path);
 }
+
+
+
+void wi_test_file_mapping(void) {
+    wi_file_t       *file;
+    wi_string_t     *path;
+    wi_data_t       *data, *contents;
+    char            *bytes;
+    wi_uinteger_t   i, length;
+    
+    path = wi_string_by_appending_path_component(wi_test_fixture_path, WI_STR("wi-file-tests-2.txt"));
+    file = wi_file_for_reading(path);
+    data = wi_file_map(file, 14, 14);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(data, wi_string_utf8_data(WI_STR("hello world 2\n")), "");
+    
+    data = wi_file_map(file, 0, 0);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(data, wi_file_read_to_end_of_file(file), "");
+    
+    data = wi_file_map(file, 1000, 0);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(data, wi_data(), "");
+    WI_TEST_ASSERT_NOT_NULL(wi_file_map(file, 140, 1), "");
+    WI_TEST_ASSERT_NULL(wi_file_map(file, 140, 2), "");
+    WI_TEST_ASSERT_NULL(wi_file_map(file, 1000, 1), "");
+    
+    length = 512 * 1024;
+    bytes = wi_malloc(length);
+    
+    for(i = 0; i < length; i++)
+        bytes[i] = 'a' + (i % 26);
+    
+    contents = wi_data_with_bytes(bytes, length);
+    
+    wi_free(bytes);
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-file.XXXXXXX"));
+    file = wi_file_for_updating(path);
+    
+    wi_file_write(file, contents);
+    
+    data = wi_file_map_with_advice(file, 0, 0, WI_FILE_ADVICE_SEQUENTIAL);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(data, contents, "");
+    
+    data = wi_file_map_with_advice(file, 5000, 10, WI_FILE_ADVICE_RANDOM);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(data, wi_data_with_bytes("ijklmnopqr", 10), "");
+    
+    data = wi_data_with_contents_of_file(path);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(data, contents, "");
+    
+    wi_filesystem_delete_path(path);
+}
+
+
+
+void wi_test_file_positional_io(void) {
+    wi_file_t       *file, *reader;
+    wi_string_t     *path;
+    wi_data_t       *data;
+    wi_integer_t    length;
+    struct iovec    vectors[3];
+    char            buffer1[6], buffer2[1], buffer3[32];
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-file.XXXXXXX"));
+    file = wi_file_for_writing(path);
+    reader = wi_file_for_reading(path);
+    length = wi_file_write_at_offset(file, wi_string_utf8_data(WI_STR("world")), 6);
+    
+    WI_TEST_ASSERT_EQUALS(length, 5, "");
+    WI_TEST_ASSERT_EQUALS(wi_file_offset(file), 0ULL, "");
+    
+    length = wi_file_write_bytes_at_offset(file, "hello ", 6, 0);
+    
+    WI_TEST_ASSERT_EQUALS(length, 6, "");
+    
+    data = wi_file_read_at_offset(reader, 5, 6);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(data, wi_string_utf8_data(WI_STR("world")), "");
+    
+    data = wi_file_read_at_offset(reader, 100, 2);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(data, wi_string_utf8_data(WI_STR("llo world")), "");
+    
+    vectors[0].iov_base = "HELLO";
+    vectors[0].iov_len  = 5;
+    vectors[1].iov_base = "-";
+    vectors[1].iov_len  = 1;
+    vectors[2].iov_base = "WORLD";
+    vectors[2].iov_len  = 5;
+    
+    length = wi_file_write_vectors_at_offset(file, vectors, 3, 0);
+    
+    WI_TEST_ASSERT_EQUALS(length, 11, "");
+    
+    vectors[0].iov_base = buffer1;
+    vectors[0].iov_len  = sizeof(buffer1);
+    vectors[1].iov_base = buffer2;
+    vectors[1].iov_len  = sizeof(buffer2);
+    vectors[2].iov_base = buffer3;
+    vectors[2].iov_len  = sizeof(buffer3);
+    
+    length = wi_file_read_vectors_at_offset(reader, vectors, 3, 0);
+    
+    WI_TEST_ASSERT_EQUALS(length, 11, "");
+    WI_TEST_ASSERT_TRUE(memcmp(buffer1, "HELLO-", 6) == 0, "");
+    WI_TEST_ASSERT_TRUE(memcmp(buffer2, "W", 1) == 0, "");
+    WI_TEST_ASSERT_TRUE(memcmp(buffer3, "ORLD", 4) == 0, "");
+    
+    WI_TEST_ASSERT_TRUE(wi_file_advise(reader, 0, 0, WI_FILE_ADVICE_SEQUENTIAL), "");
+    WI_TEST_ASSERT_TRUE(wi_file_read_ahead(reader, 0, 11), "");
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_file_read_to_end_of_file(reader), wi_string_utf8_data(WI_STR("HELLO-WORLD")), "");
+    
+    wi_filesystem_delete_path(path);
+}
@@ -27,15 +27,24 @@
 #include <wired/wired.h>
 
 WI_TEST_EXPORT void                     wi_test_filesystem_events(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_events_recursive(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_events_overlapping(void);
 
 #if defined(WI_FILESYSTEM_EVENTS)
 static void                             _wi_test_filesystem_events_callback(wi_filesystem_events_t *, wi_string_t *);
+static void                             _wi_test_filesystem_events_recursive_callback(wi_filesystem_events_t *, wi_string_t *, wi_filesystem_event_kind_t);
+static wi_boolean_t                     _wi_test_filesystem_events_wait_for_kinds(wi_string_t *, wi_filesystem_event_kind_t, wi_time_interval_t);
 #endif
 
 
 #if defined(WI_FILESYSTEM_EVENTS)
 static wi_condition_lock_t              *_wi_test_filesystem_events_lock;
 static wi_mutable_set_t                 *_wi_test_filesystem_events_paths;
+static wi_mutable_dictionary_t          *_wi_test_filesystem_events_kinds;
+static wi_string_t                      *_wi_test_filesystem_events_file_path;
+static wi_uinteger_t                    _wi_test_filesystem_events_file_count;
+static wi_string_t                      *_wi_test_filesystem_events_wait_path;
+static wi_filesystem_event_kind_t       _wi_test_filesystem_events_wait_kinds;
 #endif
 
 
@@ -89,3 +98,176 @@ static void _wi_test_filesystem_events_callback(wi_filesystem_events_t *filesyst
     
     wi_filesystem_events_remove_path(filesystem_events, path);
 }
+
+
+
+void wi_test_filesystem_events_recursive(void) {
+#if defined(WI_FILESYSTEM_EVENTS)
+    wi_filesystem_events_t  *filesystem_events;
+    wi_file_t               *file;
+    wi_string_t             *path, *subpath;
+    wi_uinteger_t           i;
+    wi_boolean_t            result;
+    
+    _wi_test_filesystem_events_lock = wi_autorelease(wi_condition_lock_init_with_condition(wi_condition_lock_alloc(), 0));
+    _wi_test_filesystem_events_kinds = wi_mutable_dictionary();
+    _wi_test_filesystem_events_file_count = 0;
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-filesystem.XXXXXXX"));
+    subpath = wi_string_by_appending_path_component(path, WI_STR("directory"));
+    _wi_test_filesystem_events_file_path = wi_string_by_appending_path_component(subpath, WI_STR("file"));
+    
+    result = wi_filesystem_create_directory_at_path(path);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    filesystem_events = wi_filesystem_events();
+    
+    WI_TEST_ASSERT_NOT_NULL(filesystem_events, "");
+    
+    wi_filesystem_events_set_coalescing_interval(filesystem_events, 0.2);
+    
+    result = wi_filesystem_events_add_path_with_options_and_callback(filesystem_events, path, WI_FILESYSTEM_EVENTS_RECURSIVE, _wi_test_filesystem_events_recursive_callback);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    result = wi_filesystem_create_directory_at_path(subpath);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    /* The new directory is watched by the time its creation is reported */
+    if(!_wi_test_filesystem_events_wait_for_kinds(subpath, WI_FILESYSTEM_EVENT_CREATED, 2.0))
+        WI_TEST_FAIL("timed out waiting for filesystem events thread");
+    
+    wi_condition_lock_unlock(_wi_test_filesystem_events_lock);
+    
+    file = wi_file_for_writing(_wi_test_filesystem_events_file_path);
+    
+    WI_TEST_ASSERT_NOT_NULL(file, "");
+    
+    for(i = 0; i < 10; i++)
+        wi_file_write(file, wi_string_utf8_data(WI_STR("hello world")));
+    
+    wi_file_close(file);
+    
+    /* The writes may be coalesced into the creation or arrive after it */
+    if(!_wi_test_filesystem_events_wait_for_kinds(_wi_test_filesystem_events_file_path, WI_FILESYSTEM_EVENT_CREATED | WI_FILESYSTEM_EVENT_MODIFIED, 2.0))
+        WI_TEST_FAIL("timed out waiting for filesystem events thread");
+    
+    WI_TEST_ASSERT_TRUE(wi_number_int32(wi_dictionary_data_for_key(_wi_test_filesystem_events_kinds, subpath)) & WI_FILESYSTEM_EVENT_CREATED, "");
+    WI_TEST_ASSERT_TRUE(_wi_test_filesystem_events_file_count < 10, "");
+    
+    wi_condition_lock_unlock(_wi_test_filesystem_events_lock);
+    
+    wi_filesystem_events_remove_path(filesystem_events, path);
+    wi_filesystem_delete_path(path);
+#endif
+}
+
+
+
+void wi_test_filesystem_events_overlapping(void) {
+#if defined(WI_FILESYSTEM_EVENTS)
+    wi_filesystem_events_t  *filesystem_events;
+    wi_file_t               *file;
+    wi_string_t             *path, *subpath;
+    wi_boolean_t            result;
+    
+    _wi_test_filesystem_events_lock = wi_autorelease(wi_condition_lock_init_with_condition(wi_condition_lock_alloc(), 0));
+    _wi_test_filesystem_events_kinds = wi_mutable_dictionary();
+    _wi_test_filesystem_events_file_count = 0;
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-filesystem.XXXXXXX"));
+    subpath = wi_string_by_appending_path_component(path, WI_STR("directory"));
+    _wi_test_filesystem_events_file_path = wi_string_by_appending_path_component(subpath, WI_STR("file"));
+    
+    result = wi_filesystem_create_directory_at_path(path);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    result = wi_filesystem_create_directory_at_path(subpath);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    filesystem_events = wi_filesystem_events();
+    
+    WI_TEST_ASSERT_NOT_NULL(filesystem_events, "");
+    
+    result = wi_filesystem_events_add_path_with_options_and_callback(filesystem_events, path, WI_FILESYSTEM_EVENTS_RECURSIVE, _wi_test_filesystem_events_recursive_callback);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    /* The subdirectory is already watched by the recursive watch, removing the second watch must not end the first */
+    result = wi_filesystem_events_add_path_with_callback(filesystem_events, subpath, NULL);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    wi_filesystem_events_remove_path(filesystem_events, subpath);
+    
+    file = wi_file_for_writing(_wi_test_filesystem_events_file_path);
+    
+    WI_TEST_ASSERT_NOT_NULL(file, "");
+    
+    wi_file_close(file);
+    
+    if(!_wi_test_filesystem_events_wait_for_kinds(_wi_test_filesystem_events_file_path, WI_FILESYSTEM_EVENT_CREATED, 2.0))
+        WI_TEST_FAIL("timed out waiting for filesystem events thread");
+    
+    wi_condition_lock_unlock(_wi_test_filesystem_events_lock);
+    
+    wi_filesystem_events_remove_path(filesystem_events, path);
+    wi_filesystem_delete_path(path);
+#endif
+}
+
+
+
+#if defined(WI_FILESYSTEM_EVENTS)
+
+static void _wi_test_filesystem_events_recursive_callback(wi_filesystem_events_t *filesystem_events, wi_string_t *path, wi_filesystem_event_kind_t kinds) {
+    wi_number_t     *number;
+    
+    wi_condition_lock_lock(_wi_test_filesystem_events_lock);
+    
+    number = wi_dictionary_data_for_key(_wi_test_filesystem_events_kinds, path);
+    
+    if(number)
+        kinds |= wi_number_int32(number);
+    
+    wi_mutable_dictionary_set_data_for_key(_wi_test_filesystem_events_kinds, WI_INT32(kinds), path);
+    
+    if(wi_is_equal(path, _wi_test_filesystem_events_file_path))
+        _wi_test_filesystem_events_file_count++;
+    
+    if(_wi_test_filesystem_events_wait_path && wi_is_equal(path, _wi_test_filesystem_events_wait_path) &&
+       (kinds & _wi_test_filesystem_events_wait_kinds) == _wi_test_filesystem_events_wait_kinds)
+        wi_condition_lock_unlock_with_condition(_wi_test_filesystem_events_lock, 1);
+    else
+        wi_condition_lock_unlock(_wi_test_filesystem_events_lock);
+}
+
+
+
+static wi_boolean_t _wi_test_filesystem_events_wait_for_kinds(wi_string_t *path, wi_filesystem_event_kind_t kinds, wi_time_interval_t timeout) {
+    wi_number_t     *number;
+    
+    wi_condition_lock_lock(_wi_test_filesystem_events_lock);
+    
+    _wi_test_filesystem_events_wait_path = path;
+    _wi_test_filesystem_events_wait_kinds = kinds;
+    
+    /* The kinds may already have been reported before the wait started */
+    number = wi_dictionary_data_for_key(_wi_test_filesystem_events_kinds, path);
+    
+    wi_condition_lock_unlock_with_condition(_wi_test_filesystem_events_lock, (number && (wi_number_int32(number) & kinds) == kinds) ? 1 : 0);
+    
+    /* Returns with the lock held on success, like wi_condition_lock_lock_when_condition() */
+    if(!wi_condition_lock_lock_when_condition(_wi_test_filesystem_events_lock, 1, timeout))
+        return false;
+    
+    _wi_test_filesystem_events_wait_path = NULL;
+    
+    return true;
+}
+
+#endif
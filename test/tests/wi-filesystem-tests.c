@@ -24,13 +24,25 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/resource.h>
 #include <wired/wired.h>
 
 WI_TEST_EXPORT void                     wi_test_filesystem_successes(void);
 WI_TEST_EXPORT void                     wi_test_filesystem_failures(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_copying(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_walking(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_walking_deep(void);
+WI_TEST_EXPORT void                     wi_test_filesystem_file_stats_fields(void);
 
 static void                             _wi_test_filesystem_successes_copy_callback(wi_string_t *, wi_string_t *);
 static void                             _wi_test_filesystem_successes_delete_callback(wi_string_t *);
+static void                             _wi_test_filesystem_copying_progress_callback(wi_string_t *, wi_string_t *, uint64_t, uint64_t);
+static void                             _wi_test_filesystem_walking_walk_callback(wi_array_t *);
+static void                             _wi_test_filesystem_walking_delete_callback(wi_string_t *);
+
+
+static uint64_t                         _wi_test_filesystem_copying_bytes;
+static wi_mutable_set_t                 *_wi_test_filesystem_walking_paths;
 
 
 void wi_test_filesystem_successes(void) {
@@ -186,3 +198,254 @@ void wi_test_filesystem_failures(void) {
     
     WI_TEST_ASSERT_FALSE(result, "");
 }
+
+
+
+void wi_test_filesystem_copying(void) {
+    wi_mutable_data_t       *data;
+    wi_string_t             *path, *otherpath, *filename;
+    wi_uinteger_t           i;
+    wi_boolean_t            result;
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-filesystem.XXXXXXX"));
+    otherpath = wi_string_by_appending_string(path, WI_STR("-copy"));
+    
+    result = wi_filesystem_create_directory_at_path(path);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    result = wi_filesystem_create_directory_at_path(wi_string_by_appending_path_component(path, WI_STR("subdirectory")));
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    data = wi_mutable_data();
+    
+    for(i = 0; i < 100000; i++)
+        wi_mutable_data_append_bytes(data, "0123456789abcdefghijklmnopqrstuvwxyz", 36);
+    
+    result = wi_data_write_to_path(data, wi_string_by_appending_path_component(path, WI_STR("large")));
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    for(i = 0; i < 10; i++) {
+        filename = wi_string_with_format(WI_STR("subdirectory/file%lu"), i);
+        result = wi_string_write_utf8_string_to_path(filename, wi_string_by_appending_path_component(path, filename));
+        
+        WI_TEST_ASSERT_TRUE(result, "");
+    }
+    
+    _wi_test_filesystem_copying_bytes = 0;
+    
+    result = wi_filesystem_copy_path_with_progress_callback(path, otherpath, _wi_test_filesystem_copying_progress_callback);
+    
+    WI_TEST_ASSERT_TRUE(result, "%@", wi_error_string());
+    WI_TEST_ASSERT_EQUALS(_wi_test_filesystem_copying_bytes, 3600000ULL, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_data_with_contents_of_file(wi_string_by_appending_path_component(otherpath, WI_STR("large"))), data, "");
+    
+    for(i = 0; i < 10; i++) {
+        filename = wi_string_with_format(WI_STR("subdirectory/file%lu"), i);
+        
+        WI_TEST_ASSERT_EQUAL_INSTANCES(wi_string_with_utf8_contents_of_file(wi_string_by_appending_path_component(otherpath, filename)), filename, "");
+    }
+    
+    result = wi_filesystem_copy_path(path, otherpath);
+    
+    WI_TEST_ASSERT_FALSE(result, "");
+    
+    wi_filesystem_delete_path(otherpath);
+    wi_filesystem_delete_path(path);
+}
+
+
+
+static void _wi_test_filesystem_copying_progress_callback(wi_string_t *frompath, wi_string_t *topath, uint64_t bytes, uint64_t size) {
+    /* Only the large file is big enough to report, count its final progress */
+    if(wi_is_equal(wi_string_last_path_component(frompath), WI_STR("large")) && bytes == size)
+        _wi_test_filesystem_copying_bytes = bytes;
+}
+
+
+
+void wi_test_filesystem_walking(void) {
+    wi_mutable_set_t        *paths;
+    wi_string_t             *path, *subpath;
+    wi_uinteger_t           i, j;
+    wi_boolean_t            result;
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-filesystem.XXXXXXX"));
+    paths = wi_mutable_set();
+    
+    result = wi_filesystem_create_directory_at_path(path);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    /* Enough directories that the walk outgrows its serial start and goes threaded */
+    for(i = 0; i < 40; i++) {
+        subpath = wi_string_by_appending_path_component(path, wi_string_with_format(WI_STR("directory%lu"), i));
+        result = wi_filesystem_create_directory_at_path(subpath);
+        
+        WI_TEST_ASSERT_TRUE(result, "");
+        
+        wi_mutable_set_add_data(paths, subpath);
+        
+        for(j = 0; j < 20; j++) {
+            subpath = wi_string_by_appending_path_component(path, wi_string_with_format(WI_STR("directory%lu/file%lu"), i, j));
+            result = wi_string_write_utf8_string_to_path(subpath, subpath);
+            
+            WI_TEST_ASSERT_TRUE(result, "");
+            
+            wi_mutable_set_add_data(paths, subpath);
+        }
+    }
+    
+    subpath = wi_string_by_appending_path_component(path, WI_STR("directory0/link"));
+    result = wi_filesystem_create_symbolic_link_from_path(path, subpath);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    wi_mutable_set_add_data(paths, subpath);
+    
+    _wi_test_filesystem_walking_paths = wi_mutable_set();
+    
+    result = wi_filesystem_walk_path_with_callback(path, _wi_test_filesystem_walking_walk_callback);
+    
+    WI_TEST_ASSERT_TRUE(result, "%@", wi_error_string());
+    WI_TEST_ASSERT_EQUAL_INSTANCES(_wi_test_filesystem_walking_paths, paths, "");
+    
+    wi_mutable_set_add_data(paths, path);
+    
+    _wi_test_filesystem_walking_paths = wi_mutable_set();
+    
+    result = wi_filesystem_delete_path_with_callback(path, _wi_test_filesystem_walking_delete_callback);
+    
+    WI_TEST_ASSERT_TRUE(result, "%@", wi_error_string());
+    WI_TEST_ASSERT_EQUAL_INSTANCES(_wi_test_filesystem_walking_paths, paths, "");
+    WI_TEST_ASSERT_FALSE(wi_filesystem_file_exists_at_path(path, NULL), "");
+    
+    result = wi_filesystem_walk_path_with_callback(path, _wi_test_filesystem_walking_walk_callback);
+    
+    WI_TEST_ASSERT_FALSE(result, "");
+    
+    _wi_test_filesystem_walking_paths = NULL;
+}
+
+
+
+void wi_test_filesystem_walking_deep(void) {
+    wi_mutable_set_t        *paths;
+    wi_string_t             *path, *subpath;
+    struct rlimit           rl, lowered;
+    wi_uinteger_t           i;
+    wi_boolean_t            result;
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-filesystem.XXXXXXX"));
+    paths = wi_mutable_set();
+    
+    result = wi_filesystem_create_directory_at_path(path);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    /* Every level has a sibling, so no directory is finished with before its children are queued */
+    subpath = path;
+    
+    for(i = 0; i < 300; i++) {
+        result = wi_filesystem_create_directory_at_path(wi_string_by_appending_path_component(subpath, WI_STR("sibling")));
+        
+        WI_TEST_ASSERT_TRUE(result, "%@", wi_error_string());
+        
+        wi_mutable_set_add_data(paths, wi_string_by_appending_path_component(subpath, WI_STR("sibling")));
+        
+        subpath = wi_string_by_appending_path_component(subpath, WI_STR("directory"));
+        result = wi_filesystem_create_directory_at_path(subpath);
+        
+        WI_TEST_ASSERT_TRUE(result, "%@", wi_error_string());
+        
+        wi_mutable_set_add_data(paths, subpath);
+    }
+    
+    /* A tree deeper than the descriptor limit must still walk */
+    getrlimit(RLIMIT_NOFILE, &rl);
+    
+    lowered = rl;
+    lowered.rlim_cur = WI_MIN(rl.rlim_cur, 128);
+    
+    setrlimit(RLIMIT_NOFILE, &lowered);
+    
+    _wi_test_filesystem_walking_paths = wi_mutable_set();
+    
+    result = wi_filesystem_walk_path_with_callback(path, _wi_test_filesystem_walking_walk_callback);
+    
+    setrlimit(RLIMIT_NOFILE, &rl);
+    
+    WI_TEST_ASSERT_TRUE(result, "%@", wi_error_string());
+    WI_TEST_ASSERT_EQUAL_INSTANCES(_wi_test_filesystem_walking_paths, paths, "");
+    
+    wi_mutable_set_add_data(paths, path);
+    
+    _wi_test_filesystem_walking_paths = wi_mutable_set();
+    
+    setrlimit(RLIMIT_NOFILE, &lowered);
+    
+    result = wi_filesystem_delete_path_with_callback(path, _wi_test_filesystem_walking_delete_callback);
+    
+    setrlimit(RLIMIT_NOFILE, &rl);
+    
+    WI_TEST_ASSERT_TRUE(result, "%@", wi_error_string());
+    WI_TEST_ASSERT_EQUAL_INSTANCES(_wi_test_filesystem_walking_paths, paths, "");
+    WI_TEST_ASSERT_FALSE(wi_filesystem_file_exists_at_path(path, NULL), "");
+    
+    _wi_test_filesystem_walking_paths = NULL;
+}
+
+
+
+static void _wi_test_filesystem_walking_walk_callback(wi_array_t *paths) {
+    wi_mutable_set_add_data_from_array(_wi_test_filesystem_walking_paths, paths);
+}
+
+
+
+static void _wi_test_filesystem_walking_delete_callback(wi_string_t *path) {
+    wi_mutable_set_add_data(_wi_test_filesystem_walking_paths, path);
+}
+
+
+
+void wi_test_filesystem_file_stats_fields(void) {
+    wi_string_t             *path;
+    wi_file_stats_t         stats;
+    wi_boolean_t            result;
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-filesystem.XXXXXXX"));
+    result = wi_string_write_utf8_string_to_path(WI_STR("foobar"), path);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    result = wi_filesystem_get_file_stats_for_path_with_fields(path, 0, &stats);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    WI_TEST_ASSERT_EQUALS(stats.size, 6ULL, "");
+    WI_TEST_ASSERT_EQUALS(stats.user_id, (uint32_t) wi_user_id(), "");
+    WI_TEST_ASSERT_NULL(stats.user, "");
+    WI_TEST_ASSERT_NULL(stats.group, "");
+    WI_TEST_ASSERT_NULL(stats.creation_date, "");
+    WI_TEST_ASSERT_NULL(stats.modification_date, "");
+    WI_TEST_ASSERT_TRUE(stats.modification_time > 0.0, "");
+    
+    result = wi_filesystem_get_file_stats_for_path_with_fields(path, WI_FILE_STATS_USER | WI_FILE_STATS_MODIFICATION_DATE, &stats);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(stats.user, wi_user_name(), "");
+    WI_TEST_ASSERT_NULL(stats.group, "");
+    WI_TEST_ASSERT_NULL(stats.creation_date, "");
+    WI_TEST_ASSERT_EQUALS(wi_date_time_interval(stats.modification_date), stats.modification_time, "");
+    
+    result = wi_filesystem_get_file_stats_for_path(path, &stats);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(stats.user, wi_user_name(), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(stats.group, wi_group_name(), "");
+    WI_TEST_ASSERT_NOT_NULL(stats.creation_date, "");
+    
+    wi_filesystem_delete_path(path);
+}
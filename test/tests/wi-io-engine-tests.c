@@ -0,0 +1,272 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/socket.h>
+#include <string.h>
+#include <wired/wired.h>
+
+WI_TEST_EXPORT void                     wi_test_io_engine_creation(void);
+WI_TEST_EXPORT void                     wi_test_io_engine_runtime_functions(void);
+WI_TEST_EXPORT void                     wi_test_io_engine_files(void);
+WI_TEST_EXPORT void                     wi_test_io_engine_sockets(void);
+WI_TEST_EXPORT void                     wi_test_io_engine_release_in_flight(void);
+
+static void                             _wi_test_io_engine_completion(wi_io_engine_t *, wi_integer_t, void *);
+static wi_array_t *                     _wi_test_io_engine_engines(void);
+static void                             _wi_test_io_engine_wait(wi_io_engine_t *);
+
+
+void wi_test_io_engine_creation(void) {
+    wi_io_engine_t      *engine;
+    
+    engine = wi_io_engine();
+    
+    WI_TEST_ASSERT_NOT_NULL(engine, "");
+    WI_TEST_ASSERT_EQUALS(wi_io_engine_pending_count(engine), 0U, "");
+    WI_TEST_ASSERT_EQUALS(wi_io_engine_wait_for_completions(engine, 0.0), 0, "");
+    
+    engine = wi_autorelease(wi_io_engine_init_with_backend(wi_io_engine_alloc(), WI_IO_ENGINE_POLL));
+    
+    WI_TEST_ASSERT_NOT_NULL(engine, "");
+    WI_TEST_ASSERT_TRUE(wi_io_engine_backend(engine) == WI_IO_ENGINE_POLL, "");
+}
+
+
+
+void wi_test_io_engine_runtime_functions(void) {
+    wi_io_engine_t      *engine;
+    
+    engine = wi_io_engine();
+    
+    WI_TEST_ASSERT_EQUALS(wi_runtime_id(engine), wi_io_engine_runtime_id(), "");
+    WI_TEST_ASSERT_TRUE(wi_string_contains_string(wi_description(engine), WI_STR("pending = 0"), 0), "");
+}
+
+
+
+void wi_test_io_engine_files(void) {
+    wi_enumerator_t     *enumerator;
+    wi_io_engine_t      *engine;
+    wi_file_t           *file;
+    wi_string_t         *path;
+    wi_integer_t        results[4];
+    struct iovec        buffer;
+    char                bytes[32];
+    
+    enumerator = wi_array_data_enumerator(_wi_test_io_engine_engines());
+    
+    while((engine = wi_enumerator_next_data(enumerator))) {
+        path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-io-engine.XXXXXXX"));
+        file = wi_file_for_updating(path);
+        
+        memset(bytes, 0, sizeof(bytes));
+        memset(results, 0, sizeof(results));
+        
+        buffer.iov_base     = bytes;
+        buffer.iov_len      = sizeof(bytes);
+        
+        WI_TEST_ASSERT_TRUE(wi_io_engine_register_buffers(engine, &buffer, 1), "%@", wi_error_string());
+        
+        WI_TEST_ASSERT_TRUE(wi_io_engine_write_file(engine, file, "hello ", 6, 0, _wi_test_io_engine_completion, &results[0]), "");
+        WI_TEST_ASSERT_TRUE(wi_io_engine_write_file(engine, file, "world", 5, 6, _wi_test_io_engine_completion, &results[1]), "");
+        WI_TEST_ASSERT_EQUALS(wi_io_engine_pending_count(engine), 2U, "");
+        WI_TEST_ASSERT_TRUE(wi_io_engine_submit(engine) >= 0, "");
+        
+        /* Completions are only delivered by waiting */
+        WI_TEST_ASSERT_EQUALS(results[0], 0, "");
+        
+        _wi_test_io_engine_wait(engine);
+        
+        WI_TEST_ASSERT_EQUALS(results[0], 6, "");
+        WI_TEST_ASSERT_EQUALS(results[1], 5, "");
+        
+        WI_TEST_ASSERT_TRUE(wi_io_engine_synchronize_file(engine, file, _wi_test_io_engine_completion, &results[2]), "");
+        
+        _wi_test_io_engine_wait(engine);
+        
+        WI_TEST_ASSERT_EQUALS(results[2], 0, "");
+        
+        WI_TEST_ASSERT_TRUE(wi_io_engine_read_file(engine, file, bytes, sizeof(bytes), 0, _wi_test_io_engine_completion, &results[3]), "");
+        
+        _wi_test_io_engine_wait(engine);
+        
+        WI_TEST_ASSERT_EQUALS(results[3], 11, "");
+        WI_TEST_ASSERT_TRUE(memcmp(bytes, "hello world", 11) == 0, "");
+        
+        wi_filesystem_delete_path(path);
+    }
+}
+
+
+
+void wi_test_io_engine_sockets(void) {
+    wi_enumerator_t     *enumerator;
+    wi_io_engine_t      *engine;
+    wi_address_t        *address;
+    wi_socket_t         *server_socket, *client_socket, *accepted_socket;
+    wi_integer_t        results[4];
+    char                bytes[32];
+    
+    address = wi_address_with_string(WI_STR("127.0.0.1"));
+    
+    WI_TEST_ASSERT_NOT_NULL(address, "");
+    
+    enumerator = wi_array_data_enumerator(_wi_test_io_engine_engines());
+    
+    while((engine = wi_enumerator_next_data(enumerator))) {
+        server_socket = wi_socket_with_address(address, WI_SOCKET_TCP);
+        
+        wi_socket_set_port(server_socket, 0);
+        
+        WI_TEST_ASSERT_TRUE(wi_socket_listen(server_socket), "%@", wi_error_string());
+        
+        client_socket = wi_socket_with_address(address, WI_SOCKET_TCP);
+        
+        wi_socket_set_port(client_socket, wi_socket_port(server_socket));
+        
+        memset(results, 0, sizeof(results));
+        
+        WI_TEST_ASSERT_TRUE(wi_io_engine_accept_socket(engine, server_socket, _wi_test_io_engine_completion, &results[0]), "");
+        WI_TEST_ASSERT_TRUE(wi_io_engine_connect_socket(engine, client_socket, _wi_test_io_engine_completion, &results[1]), "");
+        
+        _wi_test_io_engine_wait(engine);
+        
+        WI_TEST_ASSERT_TRUE(results[0] >= 0, "");
+        WI_TEST_ASSERT_EQUALS(results[1], 0, "");
+        
+        accepted_socket = wi_autorelease(wi_socket_init_with_descriptor(wi_socket_alloc(), results[0]));
+        
+        WI_TEST_ASSERT_TRUE(wi_io_engine_read_socket(engine, accepted_socket, bytes, sizeof(bytes), _wi_test_io_engine_completion, &results[2]), "");
+        WI_TEST_ASSERT_TRUE(wi_io_engine_write_socket(engine, client_socket, "hello world", 11, _wi_test_io_engine_completion, &results[3]), "");
+        
+        _wi_test_io_engine_wait(engine);
+        
+        WI_TEST_ASSERT_EQUALS(results[3], 11, "");
+        WI_TEST_ASSERT_EQUALS(results[2], 11, "");
+        WI_TEST_ASSERT_TRUE(memcmp(bytes, "hello world", 11) == 0, "");
+        
+        wi_socket_close(accepted_socket);
+        wi_socket_close(client_socket);
+        wi_socket_close(server_socket);
+        
+        /* Nothing listens on the port anymore, so the connect is refused */
+        client_socket = wi_socket_with_address(address, WI_SOCKET_TCP);
+        
+        wi_socket_set_port(client_socket, wi_socket_port(server_socket));
+        
+        WI_TEST_ASSERT_TRUE(wi_io_engine_connect_socket(engine, client_socket, _wi_test_io_engine_completion, &results[1]), "");
+        
+        _wi_test_io_engine_wait(engine);
+        
+        WI_TEST_ASSERT_EQUALS(results[1], -1, "");
+        
+        wi_socket_close(client_socket);
+    }
+}
+
+
+
+void wi_test_io_engine_release_in_flight(void) {
+    wi_io_engine_backend_t  backends[] = { WI_IO_ENGINE_IO_URING, WI_IO_ENGINE_POLL };
+    wi_io_engine_t          *engine;
+    wi_address_t            *address;
+    wi_socket_t             *server_socket;
+    wi_uinteger_t           i;
+    uint32_t                retain_count;
+    wi_integer_t            result;
+    
+    address = wi_address_with_string(WI_STR("127.0.0.1"));
+    
+    WI_TEST_ASSERT_NOT_NULL(address, "");
+    
+    for(i = 0; i < WI_ARRAY_SIZE(backends); i++) {
+        engine = wi_io_engine_init_with_backend(wi_io_engine_alloc(), backends[i]);
+        
+        if(!engine)
+            continue;
+        
+        server_socket = wi_socket_with_address(address, WI_SOCKET_TCP);
+        
+        wi_socket_set_port(server_socket, 0);
+        
+        WI_TEST_ASSERT_TRUE(wi_socket_listen(server_socket), "%@", wi_error_string());
+        
+        retain_count = wi_retain_count(server_socket);
+        result = -1;
+        
+        /* Nobody connects, so the accept is still pending when the engine goes away */
+        WI_TEST_ASSERT_TRUE(wi_io_engine_accept_socket(engine, server_socket, _wi_test_io_engine_completion, &result), "");
+        WI_TEST_ASSERT_TRUE(wi_io_engine_submit(engine) >= 0, "");
+        WI_TEST_ASSERT_EQUALS(wi_retain_count(server_socket), retain_count + 1, "");
+        
+        wi_release(engine);
+        
+        WI_TEST_ASSERT_EQUALS(wi_retain_count(server_socket), retain_count, "");
+        WI_TEST_ASSERT_EQUALS(result, -1, "");
+        
+        wi_socket_close(server_socket);
+    }
+}
+
+
+
+#pragma mark -
+
+static void _wi_test_io_engine_completion(wi_io_engine_t *engine, wi_integer_t result, void *context) {
+    *(wi_integer_t *) context = result;
+}
+
+
+
+static wi_array_t * _wi_test_io_engine_engines(void) {
+    wi_mutable_array_t  *engines;
+    wi_io_engine_t      *engine;
+    
+    engines = wi_mutable_array();
+    engine = wi_io_engine_init_with_backend(wi_io_engine_alloc(), WI_IO_ENGINE_IO_URING);
+    
+    /* io_uring may be missing or blocked, the fallback must work regardless */
+    if(engine) {
+        wi_mutable_array_add_data(engines, engine);
+        wi_release(engine);
+    }
+    
+    engine = wi_io_engine_init_with_backend(wi_io_engine_alloc(), WI_IO_ENGINE_POLL);
+    
+    wi_mutable_array_add_data(engines, engine);
+    wi_release(engine);
+    
+    return engines;
+}
+
+
+
+static void _wi_test_io_engine_wait(wi_io_engine_t *engine) {
+    while(wi_io_engine_pending_count(engine) > 0) {
+        if(wi_io_engine_wait_for_completions(engine, 5.0) < 0)
+            break;
+    }
+}
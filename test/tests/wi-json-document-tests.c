@@ -0,0 +1,209 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <wired/wired.h>
+#include "test.h"
+
+#define _WI_TEST_JSON_DOCUMENT_BENCHMARK_SIZE     (50 * 1024 * 1024)
+
+WI_TEST_EXPORT void                         wi_test_json_document(void);
+WI_TEST_EXPORT void                         wi_test_json_document_parsing(void);
+WI_BENCHMARK_EXPORT void                    wi_test_json_document_benchmark(void);
+
+
+void wi_test_json_document(void) {
+    wi_json_document_t      *document;
+    wi_json_value_t         root, value;
+    wi_string_t             *string;
+    
+    string = wi_string_with_utf8_contents_of_file(wi_string_by_appending_path_component(wi_test_fixture_path, WI_STR("wi-json-tests-1.json")));
+    document = wi_json_document_with_string(string);
+    
+    WI_TEST_ASSERT_NOT_NULL(document, "%m");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_document_instance_for_value(document, wi_json_document_root_value(document)), wi_json_instance_for_string(string), "");
+    
+    document = wi_json_document_with_string(WI_STR("{\"name\": \"wired\", \"count\": 3, \"ratio\": 0.5, \"open\": true, \"parent\": null, \"list\": [1, [2, 3], {\"x\": 4}], \"name\": \"last\"}"));
+    
+    WI_TEST_ASSERT_NOT_NULL(document, "%m");
+    
+    root = wi_json_document_root_value(document);
+    
+    WI_TEST_ASSERT_TRUE(wi_json_document_value_type(document, root) == WI_JSON_OBJECT, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_value_count(document, root), 7U, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_document_string_for_value(document, wi_json_document_value_for_key(document, root, WI_STR("name"))), WI_STR("last"), "");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_integer_for_value(document, wi_json_document_value_for_key(document, root, WI_STR("count"))), 3, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_double_for_value(document, wi_json_document_value_for_key(document, root, WI_STR("ratio"))), 0.5, "");
+    WI_TEST_ASSERT_TRUE(wi_json_document_bool_for_value(document, wi_json_document_value_for_key(document, root, WI_STR("open"))), "");
+    WI_TEST_ASSERT_TRUE(wi_json_document_value_type(document, wi_json_document_value_for_key(document, root, WI_STR("parent"))) == WI_JSON_NULL, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_value_for_key(document, root, WI_STR("missing")), WI_NOT_FOUND, "");
+    
+    value = wi_json_document_value_for_key(document, root, WI_STR("list"));
+    
+    WI_TEST_ASSERT_TRUE(wi_json_document_value_type(document, value) == WI_JSON_ARRAY, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_value_count(document, value), 3U, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_value_at_index(document, value, 3), WI_NOT_FOUND, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_integer_for_value(document, wi_json_document_value_for_key(document, wi_json_document_value_at_index(document, value, 2), WI_STR("x"))), 4, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_document_instance_for_value(document, wi_json_document_value_at_index(document, value, 1)),
+        wi_array_with_data(wi_number_with_integer(2), wi_number_with_integer(3), NULL), "");
+    
+    value = wi_json_document_first_value(document, root);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_document_key_for_value(document, value), WI_STR("name"), "");
+    
+    value = wi_json_document_next_value(document, value);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_document_key_for_value(document, value), WI_STR("count"), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_key_for_value(document, root), "");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_next_value(document, root), WI_NOT_FOUND, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_document_instance_for_value(document, root), wi_json_instance_for_string(WI_STR("{\"name\": \"last\", \"count\": 3, \"ratio\": 0.5, \"open\": true, \"parent\": null, \"list\": [1, [2, 3], {\"x\": 4}]}")), "");
+    
+    document = wi_json_document_with_string(WI_STR("42"));
+    
+    WI_TEST_ASSERT_NOT_NULL(document, "%m");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_integer_for_value(document, wi_json_document_root_value(document)), 42, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_first_value(document, wi_json_document_root_value(document)), WI_NOT_FOUND, "");
+}
+
+
+
+void wi_test_json_document_parsing(void) {
+    wi_json_document_t      *document;
+    wi_mutable_string_t     *string;
+    wi_uinteger_t           i, j;
+    
+    /* Strings and escapes that straddle the 64 byte blocks of the structural scan */
+    for(i = 0; i < 130; i++) {
+        string = wi_mutable_string();
+        
+        for(j = 0; j < i; j++)
+            wi_mutable_string_append_string(string, WI_STR(" "));
+        
+        wi_mutable_string_append_string(string, WI_STR("["));
+        
+        for(j = 0; j < i % 7; j++)
+            wi_mutable_string_append_string(string, WI_STR("\"\\\\\","));
+        
+        wi_mutable_string_append_string(string, WI_STR("\""));
+        
+        for(j = 0; j < i; j++)
+            wi_mutable_string_append_string(string, WI_STR("x"));
+        
+        wi_mutable_string_append_string(string, WI_STR("\\\"\\\\\\u00e5\xc3\xa4\", {\"k\\\"ey\": [true, -12.5e1, null]}, 123456789, \"\\\\\"]"));
+        
+        document = wi_json_document_with_string(string);
+        
+        WI_TEST_ASSERT_NOT_NULL(document, "%lu: %m", i);
+        WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_document_instance_for_value(document, wi_json_document_root_value(document)), wi_json_instance_for_string(string), "%lu", i);
+    }
+    
+    /* Containers too large for the count kept in the tape */
+    string = wi_mutable_string();
+    
+    wi_mutable_string_append_string(string, WI_STR("[1"));
+    
+    for(i = 1; i < 70000; i++)
+        wi_mutable_string_append_string(string, WI_STR(",1"));
+    
+    wi_mutable_string_append_string(string, WI_STR("]"));
+    
+    document = wi_json_document_with_string(string);
+    
+    WI_TEST_ASSERT_EQUALS(wi_json_document_value_count(document, wi_json_document_root_value(document)), 70000U, "");
+    
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("{\"a\" 1}")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("{\"a\": 1,}")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("{1: 1}")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[1, 2")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[1 2]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[1}")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[\"unterminated]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[\"\\x\"]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[tru]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[truex]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[12a]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[\"\xc0\xaf\"]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[\"\xed\xa0\x80\"]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[\"\xe2\x82\"]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(WI_STR("[1] 2")), "");
+    WI_TEST_ASSERT_TRUE(wi_error_domain() == WI_ERROR_DOMAIN_LIBWIRED, "");
+    WI_TEST_ASSERT_TRUE(wi_error_code() == WI_ERROR_JSON_READFAILED, "");
+    
+    string = wi_mutable_string();
+    
+    for(i = 0; i < 10000; i++)
+        wi_mutable_string_append_string(string, WI_STR("["));
+    
+    WI_TEST_ASSERT_NULL(wi_json_document_with_string(string), "");
+}
+
+
+
+void wi_test_json_document_benchmark(void) {
+    wi_json_document_t      *document;
+    wi_mutable_string_t     *string;
+    wi_json_value_t         value;
+    wi_time_interval_t      interval;
+    wi_uinteger_t           i, count;
+    
+    string = wi_string_init_with_capacity(wi_mutable_string_alloc(), _WI_TEST_JSON_DOCUMENT_BENCHMARK_SIZE + 1024);
+    
+    wi_mutable_string_append_string(string, WI_STR("["));
+    
+    for(count = 0; wi_string_length(string) < _WI_TEST_JSON_DOCUMENT_BENCHMARK_SIZE; count++) {
+        if(count > 0)
+            wi_mutable_string_append_string(string, WI_STR(","));
+        
+        wi_mutable_string_append_format(string,
+            WI_STR("{\"id\": %lu, \"name\": \"user %lu\", \"score\": %lu.25, \"active\": true, \"parent\": null, "
+                   "\"tags\": [\"alpha\", \"beta\", -%lu], \"description\": \"Lorem ipsum dolor sit amet, consectetur adipiscing elit, "
+                   "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua \\\"%lu\\\" \\u00e5\\u00e4\\u00f6\"}"),
+            count, count, count, count, count);
+    }
+    
+    wi_mutable_string_append_string(string, WI_STR("]"));
+    
+    interval = wi_time_interval();
+    document = wi_json_document_init_with_string(wi_json_document_alloc(), string);
+    interval = wi_time_interval() - interval;
+    
+    WI_TEST_ASSERT_NOT_NULL(document, "%m");
+    WI_TEST_ASSERT_EQUALS(wi_json_document_value_count(document, wi_json_document_root_value(document)), count, "");
+    
+    i = count - 1;
+    value = wi_json_document_value_at_index(document, wi_json_document_root_value(document), i);
+    
+    WI_TEST_ASSERT_EQUALS(wi_json_document_integer_for_value(document, wi_json_document_value_for_key(document, value, WI_STR("id"))), (wi_integer_t) i, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_document_string_for_value(document, wi_json_document_value_for_key(document, value, WI_STR("name"))), wi_string_with_format(WI_STR("user %lu"), i), "");
+    
+    wi_log_info(WI_STR("Indexed %.1f MB of JSON in %.2f seconds, %.1f MB/s"),
+        (double) wi_string_length(string) / (1024.0 * 1024.0),
+        interval,
+        ((double) wi_string_length(string) / (1024.0 * 1024.0)) / interval);
+    
+    wi_release(document);
+    wi_release(string);
+}
@@ -0,0 +1,260 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <wired/wired.h>
+#include "test.h"
+
+WI_TEST_EXPORT void                         wi_test_json_reader(void);
+WI_TEST_EXPORT void                         wi_test_json_reader_errors(void);
+WI_TEST_EXPORT void                         wi_test_json_writer(void);
+WI_TEST_EXPORT void                         wi_test_json_writer_pipe(void);
+WI_TEST_EXPORT void                         wi_test_json_writer_errors(void);
+
+
+static wi_json_reader_t *                   _wi_test_json_reader_with_string(wi_string_t *);
+
+
+void wi_test_json_reader(void) {
+    wi_json_reader_t        *reader;
+    wi_mutable_string_t     *string, *large;
+    wi_runtime_instance_t   *instance;
+    wi_uinteger_t           i;
+    
+    large = wi_mutable_string();
+    
+    /* Longer than the read buffer, so the window has to grow */
+    for(i = 0; i < 20000; i++)
+        wi_mutable_string_append_string(large, WI_STR("abc\\\"def"));
+    
+    string = wi_mutable_string_with_format(WI_STR("{\"name\": \"wired\", \"list\": [1, -2.5, true, false, null, {\"a\": []}], \"large\": \"%@\"}\n"), large);
+    
+    for(i = 0; i < 1000; i++)
+        wi_mutable_string_append_format(string, WI_STR("{\"id\": %lu, \"tags\": [\"t\\u00e5%lu\"]}\n"), i, i);
+    
+    reader = _wi_test_json_reader_with_string(string);
+    
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_OBJECT_START, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_reader_depth(reader), 1U, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_KEY, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_reader_string(reader), WI_STR("name"), "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_STRING, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_reader_string(reader), WI_STR("wired"), "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_KEY, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_ARRAY_START, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_INTEGER, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_reader_integer(reader), 1, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_REAL, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_reader_double(reader), -2.5, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_BOOLEAN, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_bool(reader), "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_skip_value(reader), "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_BOOLEAN, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_NULL, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_OBJECT_START, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_skip_value(reader), "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_ARRAY_END, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_KEY, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_STRING, "");
+    WI_TEST_ASSERT_EQUALS(wi_string_length(wi_json_reader_string(reader)), 20000U * 7U, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_OBJECT_END, "");
+    WI_TEST_ASSERT_EQUALS(wi_json_reader_depth(reader), 0U, "");
+    
+    /* Values that follow each other are read one at a time */
+    for(i = 0; i < 1000; i++) {
+        WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_OBJECT_START, "%lu", i);
+        
+        instance = wi_json_reader_instance(reader);
+        
+        WI_TEST_ASSERT_EQUAL_INSTANCES(instance, wi_json_instance_for_string(wi_string_with_format(WI_STR("{\"id\": %lu, \"tags\": [\"t\\u00e5%lu\"]}"), i, i)), "%lu", i);
+    }
+    
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_NONE, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_NONE, "");
+}
+
+
+
+void wi_test_json_reader_errors(void) {
+    wi_json_reader_t        *reader;
+    wi_json_token_t         token;
+    wi_uinteger_t           i;
+    const char              *strings[] = {
+        "{\"a\" 1}", "{\"a\": 1,}", "{1: 1}", "[1, 2", "[1 2]", "[1}", "[\"unterminated]", "[\"\\x\"]", "[tru]", "[truex]", "[12a]", "[1] ]"
+    };
+    
+    for(i = 0; i < WI_ARRAY_SIZE(strings); i++) {
+        reader = _wi_test_json_reader_with_string(wi_string_with_utf8_string(strings[i]));
+        
+        while((token = wi_json_reader_next_token(reader)) != WI_JSON_TOKEN_NONE && token != WI_JSON_TOKEN_ERROR)
+            ;
+        
+        WI_TEST_ASSERT_TRUE(token == WI_JSON_TOKEN_ERROR, "%s", strings[i]);
+        WI_TEST_ASSERT_TRUE(wi_error_code() == WI_ERROR_JSON_READFAILED, "%s", strings[i]);
+        WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_ERROR, "%s", strings[i]);
+    }
+    
+    reader = _wi_test_json_reader_with_string(WI_STR("[1, [2, 3"));
+    
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_ARRAY_START, "");
+    WI_TEST_ASSERT_NULL(wi_json_reader_instance(reader), "");
+}
+
+
+
+void wi_test_json_writer(void) {
+    wi_json_writer_t        *writer;
+    wi_json_reader_t        *reader;
+    wi_file_t               *file;
+    wi_dictionary_t         *dictionary;
+    wi_string_t             *string;
+    wi_data_t               *data;
+    wi_uinteger_t           i;
+    
+    dictionary = wi_json_instance_for_string(wi_string_with_utf8_contents_of_file(wi_string_by_appending_path_component(wi_test_fixture_path, WI_STR("wi-json-tests-1.json"))));
+    
+    file = wi_file_temporary_file();
+    writer = wi_json_writer_init_with_file(wi_json_writer_alloc(), file);
+    
+    WI_TEST_ASSERT_TRUE(wi_json_writer_write_instance(writer, dictionary), "%m");
+    
+    /* Enough values to go through the buffer a few times */
+    WI_TEST_ASSERT_TRUE(wi_json_writer_begin_array(writer), "");
+    
+    for(i = 0; i < 50000; i++) {
+        WI_TEST_ASSERT_TRUE(wi_json_writer_begin_object(writer), "");
+        WI_TEST_ASSERT_TRUE(wi_json_writer_write_key(writer, WI_STR("id")), "");
+        WI_TEST_ASSERT_TRUE(wi_json_writer_write_integer(writer, i), "");
+        WI_TEST_ASSERT_TRUE(wi_json_writer_write_key(writer, WI_STR("escaped\n")), "");
+        WI_TEST_ASSERT_TRUE(wi_json_writer_write_string(writer, WI_STR("tab\tquote\"backslash\\\x01")), "");
+        WI_TEST_ASSERT_TRUE(wi_json_writer_end_object(writer), "");
+    }
+    
+    WI_TEST_ASSERT_TRUE(wi_json_writer_end_array(writer), "");
+    WI_TEST_ASSERT_TRUE(wi_json_writer_flush(writer), "%m");
+    
+    wi_release(writer);
+    
+    wi_file_seek(file, 0);
+    
+    data = wi_file_read_to_end_of_file(file);
+    string = wi_string_with_utf8_bytes(wi_data_bytes(data), wi_string_length(wi_json_string_for_instance(dictionary)));
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(string, wi_json_string_for_instance(dictionary), "");
+    
+    wi_file_seek(file, 0);
+    
+    reader = wi_json_reader_init_with_file(wi_autorelease(wi_json_reader_alloc()), file);
+    
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_OBJECT_START, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_reader_instance(reader), dictionary, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_ARRAY_START, "");
+    
+    for(i = 0; i < 50000; i++) {
+        WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_OBJECT_START, "");
+        WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_reader_instance(reader), wi_dictionary_with_data_and_keys(
+            wi_number_with_integer(i),
+                WI_STR("id"),
+            WI_STR("tab\tquote\"backslash\\\x01"),
+                WI_STR("escaped\n"),
+            NULL), "%lu", i);
+    }
+    
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_ARRAY_END, "");
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_NONE, "");
+}
+
+
+
+void wi_test_json_writer_pipe(void) {
+    wi_json_writer_t        *writer;
+    wi_json_reader_t        *reader;
+    wi_pipe_t               *pipe;
+    wi_array_t              *array;
+    
+    pipe = wi_pipe();
+    array = wi_array_with_data(WI_STR("hello"), wi_number_with_integer(42), wi_null(), NULL);
+    
+    writer = wi_json_writer_init_with_pipe(wi_autorelease(wi_json_writer_alloc()), pipe);
+    
+    WI_TEST_ASSERT_TRUE(wi_json_writer_write_instance(writer, array), "%m");
+    WI_TEST_ASSERT_TRUE(wi_json_writer_flush(writer), "%m");
+    
+    /* The value is complete before the pipe is, so reading must not wait for more */
+    reader = wi_json_reader_init_with_pipe(wi_autorelease(wi_json_reader_alloc()), pipe);
+    
+    WI_TEST_ASSERT_TRUE(wi_json_reader_next_token(reader) == WI_JSON_TOKEN_ARRAY_START, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_reader_instance(reader), array, "");
+}
+
+
+
+void wi_test_json_writer_errors(void) {
+    wi_json_writer_t        *writer;
+    wi_pipe_t               *pipe;
+    char                    buffer[64];
+    wi_integer_t            bytes;
+    
+    pipe = wi_pipe();
+    writer = wi_json_writer_init_with_pipe(wi_json_writer_alloc(), pipe);
+    
+    WI_TEST_ASSERT_TRUE(wi_json_writer_begin_array(writer), "");
+    WI_TEST_ASSERT_TRUE(wi_json_writer_write_string(writer, WI_STR("one")), "");
+    WI_TEST_ASSERT_FALSE(wi_json_writer_write_instance(writer, wi_dictionary_with_data_and_keys(
+        WI_STR("one"),
+            WI_STR("key"),
+        WI_STR("two"),
+            wi_number_with_integer(2),
+        NULL)), "");
+    
+    /* The array was left open, so the writer refuses to go on */
+    WI_TEST_ASSERT_FALSE(wi_json_writer_write_string(writer, WI_STR("two")), "");
+    WI_TEST_ASSERT_FALSE(wi_json_writer_end_array(writer), "");
+    WI_TEST_ASSERT_FALSE(wi_json_writer_flush(writer), "");
+    
+    /* Nor does it flush the partial output when it goes away */
+    wi_release(writer);
+    
+    wi_pipe_write(pipe, wi_string_utf8_data(WI_STR("null")));
+    
+    bytes = wi_pipe_read_available_bytes(pipe, buffer, sizeof(buffer));
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_string_with_utf8_bytes(buffer, bytes), WI_STR("null"), "");
+}
+
+
+
+#pragma mark -
+
+static wi_json_reader_t * _wi_test_json_reader_with_string(wi_string_t *string) {
+    wi_file_t       *file;
+    
+    file = wi_file_temporary_file();
+    
+    wi_file_write_bytes(file, wi_string_utf8_string(string), wi_string_length(string));
+    wi_file_seek(file, 0);
+    
+    return wi_autorelease(wi_json_reader_init_with_file(wi_json_reader_alloc(), file));
+}
@@ -24,10 +24,18 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <math.h>
 #include <wired/wired.h>
 #include "test.h"
 
+#define _WI_TEST_JSON_BENCHMARK_SIZE          (50 * 1024 * 1024)
+#define _WI_TEST_JSON_SERIALIZATION_COUNT     100000
+
 WI_TEST_EXPORT void                     wi_test_json(void);
+WI_TEST_EXPORT void                     wi_test_json_parsing(void);
+WI_BENCHMARK_EXPORT void                wi_test_json_benchmark(void);
+WI_TEST_EXPORT void                     wi_test_json_serialization(void);
+WI_BENCHMARK_EXPORT void                wi_test_json_serialization_benchmark(void);
 
 
 void wi_test_json(void) {
@@ -65,3 +73,158 @@ void wi_test_json(void) {
     
     WI_TEST_ASSERT_EQUAL_INSTANCES(string1, string2, "");
 }
+
+
+
+void wi_test_json_parsing(void) {
+    wi_runtime_instance_t   *instance;
+    wi_mutable_string_t     *string;
+    wi_uinteger_t           i;
+    
+    instance = wi_json_instance_for_string(WI_STR("{\"a\": {\"b\": [1, [2, {\"c\": 3}]], \"d\": -4}, \"e\": [-1.5e2, 9223372036854775807, 1e400]}"));
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(instance, wi_dictionary_with_data_and_keys(
+        wi_dictionary_with_data_and_keys(
+            wi_array_with_data(wi_number_with_integer(1), wi_array_with_data(wi_number_with_integer(2), wi_dictionary_with_data_and_keys(wi_number_with_integer(3), WI_STR("c"), NULL), NULL), NULL),
+                WI_STR("b"),
+            wi_number_with_integer(-4),
+                WI_STR("d"),
+            NULL),
+            WI_STR("a"),
+        wi_array_with_data(wi_number_with_double(-150.0), wi_number_with_integer(WI_INTEGER_MAX), wi_number_with_double(HUGE_VAL), NULL),
+            WI_STR("e"),
+        NULL), "");
+    
+    instance = wi_json_instance_for_string(WI_STR("[\"tab\\tnewline\\nquote\\\"slash\\/\", \"\\u00e5\\u20ac\\ud83d\\ude00\", \"\"]"));
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(instance, wi_array_with_data(
+        WI_STR("tab\tnewline\nquote\"slash/"),
+        WI_STR("\xc3\xa5\xe2\x82\xac\xf0\x9f\x98\x80"),
+        WI_STR(""),
+        NULL), "");
+    
+    instance = wi_json_instance_for_string(WI_STR(" [ true , false , null ] "));
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(instance, wi_array_with_data(wi_number_with_bool(true), wi_number_with_bool(false), wi_null(), NULL), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_instance_for_string(WI_STR("{}")), wi_dictionary(), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_instance_for_string(WI_STR("[]")), wi_array(), "");
+    
+    WI_TEST_ASSERT_NULL(wi_json_instance_for_string(WI_STR("{\"a\" 1}")), "");
+    WI_TEST_ASSERT_NULL(wi_json_instance_for_string(WI_STR("[1, 2")), "");
+    WI_TEST_ASSERT_NULL(wi_json_instance_for_string(WI_STR("[\"unterminated]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_instance_for_string(WI_STR("[\"\\x\"]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_instance_for_string(WI_STR("[tru]")), "");
+    WI_TEST_ASSERT_NULL(wi_json_instance_for_string(WI_STR("[1] 2")), "");
+    WI_TEST_ASSERT_TRUE(wi_error_domain() == WI_ERROR_DOMAIN_LIBWIRED, "");
+    WI_TEST_ASSERT_TRUE(wi_error_code() == WI_ERROR_JSON_READFAILED, "");
+    
+    string = wi_mutable_string();
+    
+    for(i = 0; i < 10000; i++)
+        wi_mutable_string_append_string(string, WI_STR("["));
+    
+    WI_TEST_ASSERT_NULL(wi_json_instance_for_string(string), "");
+}
+
+
+
+void wi_test_json_benchmark(void) {
+    wi_mutable_string_t     *string;
+    wi_array_t              *array;
+    wi_time_interval_t      interval;
+    wi_uinteger_t           i, count;
+    
+    string = wi_string_init_with_capacity(wi_mutable_string_alloc(), _WI_TEST_JSON_BENCHMARK_SIZE + 1024);
+    
+    wi_mutable_string_append_string(string, WI_STR("["));
+    
+    for(count = 0; wi_string_length(string) < _WI_TEST_JSON_BENCHMARK_SIZE; count++) {
+        if(count > 0)
+            wi_mutable_string_append_string(string, WI_STR(","));
+        
+        wi_mutable_string_append_format(string,
+            WI_STR("{\"id\": %lu, \"name\": \"user %lu\", \"score\": %lu.25, \"active\": true, \"parent\": null, "
+                   "\"tags\": [\"alpha\", \"beta\", -%lu], \"description\": \"Lorem ipsum dolor sit amet, consectetur adipiscing elit, "
+                   "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua \\\"%lu\\\" \\u00e5\\u00e4\\u00f6\"}"),
+            count, count, count, count, count);
+    }
+    
+    wi_mutable_string_append_string(string, WI_STR("]"));
+    
+    interval = wi_time_interval();
+    array = wi_json_instance_for_string(string);
+    interval = wi_time_interval() - interval;
+    
+    WI_TEST_ASSERT_NOT_NULL(array, "%m");
+    WI_TEST_ASSERT_EQUALS(wi_array_count(array), count, "");
+    
+    i = count - 1;
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_dictionary_data_for_key(WI_ARRAY(array, i), WI_STR("id")), wi_number_with_integer(i), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_dictionary_data_for_key(WI_ARRAY(array, i), WI_STR("name")), wi_string_with_format(WI_STR("user %lu"), i), "");
+    
+    wi_log_info(WI_STR("Parsed %.1f MB of JSON in %.2f seconds, %.1f MB/s"),
+        (double) wi_string_length(string) / (1024.0 * 1024.0),
+        interval,
+        ((double) wi_string_length(string) / (1024.0 * 1024.0)) / interval);
+    
+    wi_release(string);
+}
+
+
+
+void wi_test_json_serialization(void) {
+    wi_runtime_instance_t   *instance;
+    wi_string_t             *string;
+    
+    instance = wi_array_with_data(
+        WI_STR("tab\tquote\"backslash\\\x01"),
+        wi_dictionary_with_data_and_keys(wi_number_with_integer(-1), WI_STR("b"), wi_number_with_double(0.5), WI_STR("a"), wi_dictionary(), WI_STR("c"), NULL),
+        wi_array(),
+        wi_null(),
+        NULL);
+    string = wi_json_string_for_instance(instance);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(string, WI_STR("[\"tab\\tquote\\\"backslash\\\\\\u0001\", {\"a\":0.5, \"b\":-1, \"c\":{}}, [], null]"), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_instance_for_string(string), instance, "");
+    
+    instance = wi_dictionary_with_data_and_keys(WI_STR("value"), wi_number_with_integer(1), NULL);
+    
+    WI_TEST_ASSERT_NULL(wi_json_string_for_instance(instance), "");
+    WI_TEST_ASSERT_TRUE(wi_error_code() == WI_ERROR_JSON_WRITEFAILED, "");
+}
+
+
+
+void wi_test_json_serialization_benchmark(void) {
+    wi_mutable_dictionary_t     *dictionary;
+    wi_string_t                 *string;
+    wi_time_interval_t          interval;
+    wi_uinteger_t               i;
+    
+    dictionary = wi_dictionary_init_with_capacity(wi_mutable_dictionary_alloc(), _WI_TEST_JSON_SERIALIZATION_COUNT);
+    
+    for(i = 0; i < _WI_TEST_JSON_SERIALIZATION_COUNT; i++) {
+        wi_mutable_dictionary_set_data_for_key(dictionary, wi_array_with_data(
+            wi_number_with_integer(i),
+            wi_string_with_format(WI_STR("user \"%lu\""), i),
+            wi_number_with_double((i % 1000) + 0.25),
+            wi_number_with_bool(i % 2),
+            NULL), wi_string_with_format(WI_STR("key %lu"), i));
+    }
+    
+    interval = wi_time_interval();
+    string = wi_json_string_for_instance(dictionary);
+    interval = wi_time_interval() - interval;
+    
+    WI_TEST_ASSERT_NOT_NULL(string, "%m");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_json_instance_for_string(string), dictionary, "");
+    
+    wi_log_info(WI_STR("Serialized %lu entries to %.1f MB of JSON in %.2f seconds, %.1f MB/s"),
+        wi_dictionary_count(dictionary),
+        (double) wi_string_length(string) / (1024.0 * 1024.0),
+        interval,
+        ((double) wi_string_length(string) / (1024.0 * 1024.0)) / interval);
+    
+    wi_release(dictionary);
+}
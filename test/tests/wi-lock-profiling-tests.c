@@ -0,0 +1,183 @@
+/*
+ *  Copyright (c) 2015 Axel Andersson
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <wired/wired.h>
+
+WI_TEST_EXPORT void                     wi_test_lock_profiling_statistics(void);
+WI_TEST_EXPORT void                     wi_test_lock_profiling_log_statistics(void);
+
+#ifdef WI_PTHREADS
+static wi_dictionary_t *                _wi_test_lock_profiling_statistics_for_type(wi_string_t *);
+static void                             _wi_test_lock_profiling_log_statistics_callback(wi_log_level_t, wi_string_t *);
+
+
+static wi_mutable_array_t               *_wi_test_lock_profiling_logs;
+#endif
+
+
+
+void wi_test_lock_profiling_statistics(void) {
+#ifdef WI_PTHREADS
+    wi_lock_t               *lock;
+    wi_recursive_lock_t     *recursive_lock;
+    wi_readwrite_lock_t     *readwrite_lock;
+    wi_condition_lock_t     *condition_lock;
+    wi_dictionary_t         *statistics;
+    wi_boolean_t            enabled;
+    
+    lock = wi_autorelease(wi_lock_init(wi_lock_alloc()));
+    recursive_lock = wi_autorelease(wi_recursive_lock_init(wi_recursive_lock_alloc()));
+    readwrite_lock = wi_autorelease(wi_readwrite_lock_init(wi_readwrite_lock_alloc()));
+    condition_lock = wi_autorelease(wi_condition_lock_init(wi_condition_lock_alloc()));
+    
+    enabled = wi_lock_profiling_enabled;
+    wi_lock_profiling_enabled = true;
+    
+    wi_lock_profiling_reset();
+    
+    wi_lock_lock(lock);
+    wi_lock_unlock(lock);
+    
+    if(wi_lock_try_lock(lock))
+        wi_lock_unlock(lock);
+    
+    wi_recursive_lock_lock(recursive_lock);
+    wi_recursive_lock_lock(recursive_lock);
+    wi_recursive_lock_unlock(recursive_lock);
+    wi_recursive_lock_unlock(recursive_lock);
+    
+    wi_readwrite_lock_read_lock(readwrite_lock);
+    wi_readwrite_lock_unlock(readwrite_lock);
+    wi_readwrite_lock_write_lock(readwrite_lock);
+    wi_readwrite_lock_unlock(readwrite_lock);
+    
+    wi_condition_lock_lock(condition_lock);
+    wi_condition_lock_unlock_with_condition(condition_lock, 1);
+    
+    if(wi_condition_lock_lock_when_condition(condition_lock, 1, 0.0))
+        wi_condition_lock_unlock(condition_lock);
+    
+    wi_lock_profiling_enabled = enabled;
+    
+    statistics = _wi_test_lock_profiling_statistics_for_type(WI_STR("wi_lock_t"));
+    
+    WI_TEST_ASSERT_NOT_NULL(statistics, "");
+    WI_TEST_ASSERT_NOT_NULL(wi_dictionary_data_for_key(statistics, WI_STR("site")), "");
+    WI_TEST_ASSERT_EQUALS(wi_number_integer(wi_dictionary_data_for_key(statistics, WI_STR("acquisitions"))), 2, "");
+    
+    statistics = _wi_test_lock_profiling_statistics_for_type(WI_STR("wi_recursive_lock_t"));
+    
+    WI_TEST_ASSERT_NOT_NULL(statistics, "");
+    WI_TEST_ASSERT_EQUALS(wi_number_integer(wi_dictionary_data_for_key(statistics, WI_STR("acquisitions"))), 2, "");
+    
+    statistics = _wi_test_lock_profiling_statistics_for_type(WI_STR("wi_readwrite_lock_t"));
+    
+    WI_TEST_ASSERT_NOT_NULL(statistics, "");
+    WI_TEST_ASSERT_EQUALS(wi_number_integer(wi_dictionary_data_for_key(statistics, WI_STR("acquisitions"))), 2, "");
+    
+    statistics = _wi_test_lock_profiling_statistics_for_type(WI_STR("wi_condition_lock_t"));
+    
+    WI_TEST_ASSERT_NOT_NULL(statistics, "");
+    WI_TEST_ASSERT_EQUALS(wi_number_integer(wi_dictionary_data_for_key(statistics, WI_STR("acquisitions"))), 2, "");
+#endif
+}
+
+
+
+void wi_test_lock_profiling_log_statistics(void) {
+#ifdef WI_PTHREADS
+    wi_enumerator_t     *enumerator;
+    wi_lock_t           *lock;
+    wi_string_t         *string;
+    wi_boolean_t        enabled, found;
+    
+    lock = wi_autorelease(wi_lock_init(wi_lock_alloc()));
+    
+    enabled = wi_lock_profiling_enabled;
+    wi_lock_profiling_enabled = true;
+    
+    wi_lock_profiling_reset();
+    
+    wi_lock_lock(lock);
+    wi_lock_unlock(lock);
+    
+    wi_lock_profiling_enabled = enabled;
+    
+    _wi_test_lock_profiling_logs = wi_array_init(wi_mutable_array_alloc());
+    
+    wi_log_add_callback_logger(_wi_test_lock_profiling_log_statistics_callback);
+    
+    wi_lock_profiling_log_statistics();
+    
+    wi_log_remove_callback_logger();
+    
+    found = false;
+    enumerator = wi_array_data_enumerator(_wi_test_lock_profiling_logs);
+    
+    while((string = wi_enumerator_next_data(enumerator))) {
+        if(wi_string_index_of_string(string, WI_STR("wi_lock_t"), 0) != WI_NOT_FOUND &&
+           wi_string_index_of_string(string, WI_STR("acquisitions"), 0) != WI_NOT_FOUND)
+            found = true;
+    }
+    
+    WI_TEST_ASSERT_TRUE(found, "");
+    
+    wi_release(_wi_test_lock_profiling_logs);
+    _wi_test_lock_profiling_logs = NULL;
+#endif
+}
+
+
+
+#ifdef WI_PTHREADS
+
+static wi_dictionary_t * _wi_test_lock_profiling_statistics_for_type(wi_string_t *type) {
+    wi_enumerator_t     *enumerator;
+    wi_dictionary_t     *statistics, *type_statistics;
+    
+    type_statistics = NULL;
+    enumerator = wi_array_data_enumerator(wi_lock_profiling_statistics());
+    
+    while((statistics = wi_enumerator_next_data(enumerator))) {
+        if(!wi_is_equal(wi_dictionary_data_for_key(statistics, WI_STR("type")), type))
+            continue;
+        
+        if(!type_statistics ||
+           wi_number_integer(wi_dictionary_data_for_key(statistics, WI_STR("acquisitions"))) >
+           wi_number_integer(wi_dictionary_data_for_key(type_statistics, WI_STR("acquisitions"))))
+            type_statistics = statistics;
+    }
+    
+    return type_statistics;
+}
+
+
+
+static void _wi_test_lock_profiling_log_statistics_callback(wi_log_level_t level, wi_string_t *string) {
+    wi_mutable_array_add_data(_wi_test_lock_profiling_logs, string);
+}
+
+#endif
@@ -28,6 +28,8 @@
 
 WI_TEST_EXPORT void                     wi_test_log_file_logging(void);
 WI_TEST_EXPORT void                     wi_test_log_callback_logging(void);
+WI_TEST_EXPORT void                     wi_test_log_categories(void);
+WI_TEST_EXPORT void                     wi_test_log_structured_logging(void);
 
 static void                             _wi_test_log_callback_logging_callback(wi_log_level_t, wi_string_t *);
 
@@ -86,6 +88,85 @@ void wi_test_log_callback_logging(void) {
 
 
 
+void wi_test_log_categories(void) {
+    wi_log_category_t   *category;
+    wi_log_level_t      level;
+    
+    _wi_test_log_callback_logging_logs = wi_array_init(wi_mutable_array_alloc());
+    
+    category = wi_log_category_with_name(WI_STR("test"));
+    
+    WI_TEST_ASSERT_EQUALS(category, wi_log_category_with_name(WI_STR("test")), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_log_category_name(category), WI_STR("test"), "");
+    WI_TEST_ASSERT_EQUALS(wi_log_category_level(category), wi_log_level(), "");
+    
+    WI_TEST_ASSERT_TRUE(wi_log_category_is_enabled(category, WI_LOG_INFO), "");
+    
+    wi_log_add_callback_logger(_wi_test_log_callback_logging_callback);
+    
+    wi_log_category_set_level(category, WI_LOG_WARN);
+    
+    WI_TEST_ASSERT_EQUALS(wi_log_category_level(category), WI_LOG_WARN, "");
+    WI_TEST_ASSERT_FALSE(wi_log_category_is_enabled(category, WI_LOG_INFO), "");
+    WI_TEST_ASSERT_TRUE(wi_log_is_enabled(WI_LOG_INFO), "");
+    
+    wi_log_category_log(category, WI_LOG_INFO, WI_STR("hello world %d"), 1);
+    wi_log_category_log(category, WI_LOG_WARN, WI_STR("hello world %d"), 2);
+    
+    wi_log_remove_callback_logger();
+    
+    /* A reset category follows the global level again */
+    wi_log_category_reset_level(category);
+    
+    level = wi_log_level();
+    
+    wi_log_set_level(WI_LOG_ERROR);
+    
+    WI_TEST_ASSERT_EQUALS(wi_log_category_level(category), WI_LOG_ERROR, "");
+    
+    wi_log_set_level(level);
+    
+    WI_TEST_ASSERT_EQUALS(wi_log_category_level(category), level, "");
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(_wi_test_log_callback_logging_logs,
+                                   wi_array_with_data(WI_STR("[test] hello world 2"), NULL),
+                                   "");
+    
+    wi_release(_wi_test_log_callback_logging_logs);
+    _wi_test_log_callback_logging_logs = NULL;
+}
+
+
+
+void wi_test_log_structured_logging(void) {
+    _wi_test_log_callback_logging_logs = wi_array_init(wi_mutable_array_alloc());
+    
+    wi_log_add_callback_logger(_wi_test_log_callback_logging_callback);
+    
+    wi_log_structured(NULL, WI_LOG_INFO, WI_STR("hello \"world\""),
+                      "count", wi_number_with_integer(42),
+                      "ratio", wi_number_with_double(0.5),
+                      "enabled", wi_number_with_bool(true),
+                      "name", WI_STR("line 1\nline 2"),
+                      "nothing", wi_null(),
+                      NULL);
+    
+    wi_log_structured(wi_log_category_with_name(WI_STR("test")), WI_LOG_DEBUG, WI_STR("hello"), NULL);
+    
+    wi_log_remove_callback_logger();
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(_wi_test_log_callback_logging_logs,
+                                   wi_array_with_data(WI_STR("{\"message\":\"hello \\\"world\\\"\",\"count\":42,\"ratio\":0.5,\"enabled\":true,\"name\":\"line 1\\nline 2\",\"nothing\":null}"),
+                                                      WI_STR("{\"message\":\"hello\",\"category\":\"test\"}"),
+                                                      NULL),
+                                   "");
+    
+    wi_release(_wi_test_log_callback_logging_logs);
+    _wi_test_log_callback_logging_logs = NULL;
+}
+
+
+
 static void _wi_test_log_callback_logging_callback(wi_log_level_t level, wi_string_t *line) {
     wi_mutable_array_add_data(_wi_test_log_callback_logging_logs, line);
 }
@@ -24,11 +24,15 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <fcntl.h>
+#include <unistd.h>
 #include <wired/wired.h>
 
 WI_TEST_EXPORT void                     wi_test_pipe_creation(void);
 WI_TEST_EXPORT void                     wi_test_pipe_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_pipe_reading_and_writing(void);
+WI_TEST_EXPORT void                     wi_test_pipe_reading_available_bytes(void);
+WI_TEST_EXPORT void                     wi_test_pipe_reading_to_end_of_pipe(void);
 
 
 void wi_test_pipe_creation(void) {
@@ -67,3 +71,53 @@ void wi_test_pipe_reading_and_writing(void) {
     
     WI_TEST_ASSERT_EQUAL_INSTANCES(wi_string_with_utf8_data(data), WI_STR("hello world\n"), "");
 }
+
+
+
+void wi_test_pipe_reading_available_bytes(void) {
+    wi_pipe_t       *pipe;
+    char            buffer[64];
+    wi_integer_t    bytes;
+    
+    pipe = wi_pipe();
+    
+    wi_pipe_write(pipe, wi_string_utf8_data(WI_STR("hello world\n")));
+    
+    bytes = wi_pipe_read_available_bytes(pipe, buffer, sizeof(buffer));
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_string_with_utf8_bytes(buffer, bytes), WI_STR("hello world\n"), "");
+}
+
+
+
+void wi_test_pipe_reading_to_end_of_pipe(void) {
+    wi_pipe_t       *pipe;
+    wi_data_t       *data, *contents;
+    char            *bytes;
+    wi_uinteger_t   i, length;
+    int             fd;
+    
+    length = 40000;
+    bytes = wi_malloc(length);
+    
+    for(i = 0; i < length; i++)
+        bytes[i] = 'a' + (i % 26);
+    
+    contents = wi_data_with_bytes(bytes, length);
+    
+    wi_free(bytes);
+    
+    pipe = wi_pipe();
+    
+    wi_pipe_write(pipe, contents);
+    
+    fd = open("/dev/null", O_WRONLY);
+    dup2(fd, wi_pipe_descriptor_for_writing(pipe));
+    close(fd);
+    
+    data = wi_pipe_read_to_end_of_pipe(pipe);
+    
+    WI_TEST_ASSERT_EQUALS(wi_data_length(data), length, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(data, contents, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_data_by_appending_data(data, data), wi_data_by_appending_data(contents, contents), "");
+}
@@ -27,7 +27,13 @@
 #include <wired/wired.h>
 #include "test.h"
 
+#define _WI_TEST_PLIST_SERIALIZATION_COUNT      100000
+
 WI_TEST_EXPORT void                     wi_test_plist(void);
+WI_TEST_EXPORT void                     wi_test_plist_invalid(void);
+WI_TEST_EXPORT void                     wi_test_plist_binary(void);
+WI_BENCHMARK_EXPORT void                wi_test_plist_serialization_benchmark(void);
+WI_BENCHMARK_EXPORT void                wi_test_plist_parsing_benchmark(void);
 
 
 void wi_test_plist(void) {
@@ -69,3 +75,198 @@ void wi_test_plist(void) {
     WI_TEST_ASSERT_EQUAL_INSTANCES(string1, string2, "");
 #endif
 }
+
+
+
+void wi_test_plist_invalid(void) {
+#ifdef WI_PLIST
+    wi_runtime_instance_t   *instance;
+    
+    instance = wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><array><string></string><string><![CDATA[<a & b>]]></string><integer>0x10</integer><true></true></array></plist>"));
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(instance, wi_array_with_data(WI_STR(""), WI_STR("<a & b>"), wi_number_with_integer(16), wi_number_with_bool(true), NULL), "");
+    
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<dict/>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"2.0\"><dict/></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"/>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><dict/><dict/></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><dict><key>a</key></dict></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><dict><string>a</string><true/></dict></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><dict><key></key><true/></dict></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><array><set/></array></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><string><true/></string></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><array><true/></plist>")), "");
+    
+    instance = wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><array><integer> 7\n</integer><real>-1.5</real><data>\n\taGVsbG8g\n\td29ybGQ=\n</data><data/></array></plist>"));
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(instance, wi_array_with_data(wi_number_with_integer(7), wi_number_with_double(-1.5), wi_data_with_bytes("hello world", 11), wi_data(), NULL), "");
+    
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><integer>12abc</integer></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><integer/></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><integer>99999999999999999999</integer></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><real>pi</real></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><data>!!!!</data></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><data>aGVs=bG8=</data></plist>")), "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_string(WI_STR("<plist version=\"1.0\"><data>aGVsb</data></plist>")), "");
+#endif
+}
+
+
+
+void wi_test_plist_binary(void) {
+#ifdef WI_PLIST
+    wi_runtime_instance_t   *instance1, *instance2;
+    wi_mutable_array_t      *array;
+    wi_data_t               *data;
+    wi_string_t             *path;
+    wi_uinteger_t           i;
+    
+    instance1 = wi_plist_read_instance_from_path(wi_string_by_appending_path_component(wi_test_fixture_path, WI_STR("wi-plist-tests-1.plist")));
+    instance2 = wi_plist_read_instance_from_path(wi_string_by_appending_path_component(wi_test_fixture_path, WI_STR("wi-plist-tests-2.plist")));
+    
+    WI_TEST_ASSERT_NOT_NULL(instance1, "%m");
+    WI_TEST_ASSERT_NOT_NULL(instance2, "%m");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(instance1, instance2, "");
+    
+    array = wi_mutable_array();
+    
+    for(i = 0; i < 1000; i++)
+        wi_mutable_array_add_data(array, wi_string_with_format(WI_STR("repeated string %lu"), i % 10));
+    
+    instance1 = wi_array_with_data(
+        instance2,
+        array,
+        WI_STR("\xc3\xa5\xe2\x82\xac\xf0\x9f\x98\x80 non-ASCII"),
+        wi_number_with_integer(-1),
+        wi_number_with_integer(70000),
+        wi_number_with_int64(INT64_MAX),
+        wi_number_with_double(-0.5),
+        wi_number_with_double(1.0),
+        wi_number_with_integer(1),
+        wi_data_with_bytes("a longer piece of data", 22),
+        wi_dictionary(),
+        NULL);
+    
+    data = wi_plist_data_for_instance(instance1, WI_PLIST_FORMAT_BINARY);
+    
+    WI_TEST_ASSERT_NOT_NULL(data, "%m");
+    WI_TEST_ASSERT_TRUE(wi_data_length(data) < 2000, "%lu", wi_data_length(data));
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_plist_instance_for_data(data), instance1, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_plist_instance_for_data(wi_plist_data_for_instance(instance1, WI_PLIST_FORMAT_XML)), instance1, "");
+    
+    /* One uniqued string referenced more often than a 16 bit count could hold */
+    array = wi_mutable_array();
+    
+    for(i = 0; i < 70000; i++)
+        wi_mutable_array_add_data(array, wi_string_with_format(WI_STR("shared")));
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_plist_instance_for_data(wi_plist_data_for_instance(array, WI_PLIST_FORMAT_BINARY)), array, "");
+    
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_data(wi_data_with_bytes(wi_data_bytes(data), wi_data_length(data) - 1)), "");
+    WI_TEST_ASSERT_TRUE(wi_error_code() == WI_ERROR_PLIST_READFAILED, "");
+    WI_TEST_ASSERT_NULL(wi_plist_instance_for_data(wi_data_with_bytes("bplist00", 8)), "");
+    WI_TEST_ASSERT_NULL(wi_plist_data_for_instance(wi_array_with_data(wi_null(), NULL), WI_PLIST_FORMAT_BINARY), "");
+    WI_TEST_ASSERT_TRUE(wi_error_code() == WI_ERROR_PLIST_WRITEFAILED, "");
+    
+    /* An array that contains itself is nested deeper than the reader would accept */
+    array = wi_mutable_array();
+    
+    wi_mutable_array_add_data(array, array);
+    
+    WI_TEST_ASSERT_NULL(wi_plist_data_for_instance(array, WI_PLIST_FORMAT_BINARY), "");
+    WI_TEST_ASSERT_TRUE(wi_error_code() == WI_ERROR_PLIST_WRITEFAILED, "");
+    
+    wi_mutable_array_remove_all_data(array);
+    
+    path = wi_filesystem_temporary_path_with_template(WI_STR("/tmp/libwired-test-plist.XXXXXXX"));
+    
+    WI_TEST_ASSERT_TRUE(wi_dictionary_write_to_path_with_format(instance2, path, WI_PLIST_FORMAT_BINARY), "%m");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_dictionary_with_plist_file(path), instance2, "");
+    WI_TEST_ASSERT_TRUE(wi_array_write_to_path_with_format(instance1, path, WI_PLIST_FORMAT_BINARY), "%m");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_array_with_plist_file(path), instance1, "");
+    
+    wi_filesystem_delete_path(path);
+#endif
+}
+
+
+
+void wi_test_plist_serialization_benchmark(void) {
+#ifdef WI_PLIST
+    wi_mutable_dictionary_t     *dictionary;
+    wi_string_t                 *string;
+    wi_time_interval_t          interval;
+    wi_uinteger_t               i;
+    
+    dictionary = wi_dictionary_init_with_capacity(wi_mutable_dictionary_alloc(), _WI_TEST_PLIST_SERIALIZATION_COUNT);
+    
+    for(i = 0; i < _WI_TEST_PLIST_SERIALIZATION_COUNT; i++) {
+        wi_mutable_dictionary_set_data_for_key(dictionary, wi_array_with_data(
+            wi_number_with_integer(i),
+            wi_string_with_format(WI_STR("<user %lu & co>"), i),
+            wi_number_with_double((i % 1000) + 0.25),
+            wi_number_with_bool(i % 2),
+            NULL), wi_string_with_format(WI_STR("key %lu"), i));
+    }
+    
+    interval = wi_time_interval();
+    string = wi_plist_string_for_instance(dictionary);
+    interval = wi_time_interval() - interval;
+    
+    WI_TEST_ASSERT_NOT_NULL(string, "%m");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_plist_instance_for_string(string), dictionary, "");
+    
+    wi_log_info(WI_STR("Serialized %lu entries to %.1f MB of property list in %.2f seconds, %.1f MB/s"),
+        wi_dictionary_count(dictionary),
+        (double) wi_string_length(string) / (1024.0 * 1024.0),
+        interval,
+        ((double) wi_string_length(string) / (1024.0 * 1024.0)) / interval);
+    
+    wi_release(dictionary);
+#endif
+}
+
+
+
+void wi_test_plist_parsing_benchmark(void) {
+#ifdef WI_PLIST
+    wi_mutable_array_t          *array;
+    wi_string_t                 *string;
+    wi_runtime_instance_t       *instance;
+    wi_time_interval_t          interval;
+    wi_uinteger_t               i;
+    
+    array = wi_array_init_with_capacity(wi_mutable_array_alloc(), _WI_TEST_PLIST_SERIALIZATION_COUNT);
+    
+    for(i = 0; i < _WI_TEST_PLIST_SERIALIZATION_COUNT; i++) {
+        wi_mutable_array_add_data(array, wi_dictionary_with_data_and_keys(
+            wi_number_with_integer(i),
+                wi_string_with_format(WI_STR("id")),
+            wi_string_with_format(WI_STR("<user %lu & co>"), i),
+                wi_string_with_format(WI_STR("name")),
+            wi_number_with_double((i % 1000) + 0.25),
+                wi_string_with_format(WI_STR("ratio")),
+            wi_number_with_bool(i % 2),
+                wi_string_with_format(WI_STR("admin")),
+            NULL));
+    }
+    
+    string = wi_plist_string_for_instance(array);
+    
+    WI_TEST_ASSERT_NOT_NULL(string, "%m");
+    
+    interval = wi_time_interval();
+    instance = wi_plist_instance_for_string(string);
+    interval = wi_time_interval() - interval;
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(instance, array, "");
+    
+    wi_log_info(WI_STR("Parsed %lu entries from %.1f MB of property list in %.2f seconds, %.1f MB/s"),
+        wi_array_count(array),
+        (double) wi_string_length(string) / (1024.0 * 1024.0),
+        interval,
+        ((double) wi_string_length(string) / (1024.0 * 1024.0)) / interval);
+    
+    wi_release(array);
+#endif
+}
@@ -26,9 +26,34 @@
 
 #include <wired/wired.h>
 
+#define _WI_TEST_READWRITE_LOCK_THREADS                  4
+#define _WI_TEST_READWRITE_LOCK_ITERATIONS               20000
+#define _WI_TEST_READWRITE_LOCK_BENCHMARK_THREADS        64
+#define _WI_TEST_READWRITE_LOCK_BENCHMARK_ITERATIONS     200000
+
 WI_TEST_EXPORT void                     wi_test_readwrite_lock_creation(void);
 WI_TEST_EXPORT void                     wi_test_readwrite_lock_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_readwrite_lock_locking(void);
+WI_TEST_EXPORT void                     wi_test_readwrite_lock_distributed_readers_locking(void);
+WI_TEST_EXPORT void                     wi_test_readwrite_lock_distributed_readers_contention(void);
+WI_TEST_EXPORT void                     wi_test_readwrite_lock_distributed_readers_mixed(void);
+WI_BENCHMARK_EXPORT void                wi_test_readwrite_lock_benchmark(void);
+
+#ifdef WI_PTHREADS
+static void                             _wi_test_readwrite_lock_run_threads(wi_thread_func_t *, wi_uinteger_t);
+static void                             _wi_test_readwrite_lock_thread_finished(void);
+static void                             _wi_test_readwrite_lock_contention_thread(wi_runtime_instance_t *);
+static void                             _wi_test_readwrite_lock_mixed_thread(wi_runtime_instance_t *);
+static void                             _wi_test_readwrite_lock_benchmark_thread(wi_runtime_instance_t *);
+
+
+static wi_readwrite_lock_t              *_wi_test_readwrite_lock_lock;
+static wi_condition_lock_t              *_wi_test_readwrite_lock_finished_lock;
+static wi_uinteger_t                    _wi_test_readwrite_lock_threads;
+static wi_uinteger_t                    _wi_test_readwrite_lock_counter1;
+static wi_uinteger_t                    _wi_test_readwrite_lock_counter2;
+static wi_boolean_t                     _wi_test_readwrite_lock_failed;
+#endif
 
 
 void wi_test_readwrite_lock_creation(void) {
@@ -83,3 +108,217 @@ void wi_test_readwrite_lock_locking(void) {
     wi_readwrite_lock_unlock(lock);
 #endif
 }
+
+
+
+void wi_test_readwrite_lock_distributed_readers_locking(void) {
+#ifdef WI_PTHREADS
+    wi_readwrite_lock_t     *lock;
+    wi_boolean_t            result;
+    
+    lock = wi_autorelease(wi_readwrite_lock_init_with_distributed_readers(wi_readwrite_lock_alloc()));
+    
+    wi_readwrite_lock_read_lock(lock);
+    
+    result = wi_readwrite_lock_try_read_lock(lock);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    wi_readwrite_lock_unlock(lock);
+    
+    result = wi_readwrite_lock_try_write_lock(lock);
+    
+    WI_TEST_ASSERT_FALSE(result, "");
+    
+    wi_readwrite_lock_unlock(lock);
+    
+    wi_readwrite_lock_write_lock(lock);
+    
+    result = wi_readwrite_lock_try_read_lock(lock);
+    
+    WI_TEST_ASSERT_FALSE(result, "");
+    
+    result = wi_readwrite_lock_try_write_lock(lock);
+    
+    WI_TEST_ASSERT_FALSE(result, "");
+    
+    wi_readwrite_lock_unlock(lock);
+    
+    result = wi_readwrite_lock_try_write_lock(lock);
+    
+    WI_TEST_ASSERT_TRUE(result, "");
+    
+    wi_readwrite_lock_unlock(lock);
+#endif
+}
+
+
+
+void wi_test_readwrite_lock_distributed_readers_contention(void) {
+#ifdef WI_PTHREADS
+    _wi_test_readwrite_lock_lock = wi_readwrite_lock_init_with_distributed_readers(wi_readwrite_lock_alloc());
+    _wi_test_readwrite_lock_counter1 = 0;
+    _wi_test_readwrite_lock_counter2 = 0;
+    _wi_test_readwrite_lock_failed = false;
+    
+    _wi_test_readwrite_lock_run_threads(_wi_test_readwrite_lock_contention_thread, _WI_TEST_READWRITE_LOCK_THREADS);
+    
+    WI_TEST_ASSERT_FALSE(_wi_test_readwrite_lock_failed, "");
+    WI_TEST_ASSERT_EQUALS(_wi_test_readwrite_lock_counter1, (wi_uinteger_t) _WI_TEST_READWRITE_LOCK_ITERATIONS, "");
+    WI_TEST_ASSERT_EQUALS(_wi_test_readwrite_lock_counter2, (wi_uinteger_t) _WI_TEST_READWRITE_LOCK_ITERATIONS, "");
+    
+    wi_release(_wi_test_readwrite_lock_lock);
+    _wi_test_readwrite_lock_lock = NULL;
+#endif
+}
+
+
+
+void wi_test_readwrite_lock_distributed_readers_mixed(void) {
+#ifdef WI_PTHREADS
+    _wi_test_readwrite_lock_lock = wi_readwrite_lock_init_with_distributed_readers(wi_readwrite_lock_alloc());
+    _wi_test_readwrite_lock_counter1 = 0;
+    _wi_test_readwrite_lock_counter2 = 0;
+    _wi_test_readwrite_lock_failed = false;
+    
+    _wi_test_readwrite_lock_run_threads(_wi_test_readwrite_lock_mixed_thread, _WI_TEST_READWRITE_LOCK_THREADS);
+    
+    WI_TEST_ASSERT_FALSE(_wi_test_readwrite_lock_failed, "");
+    WI_TEST_ASSERT_EQUALS(_wi_test_readwrite_lock_counter1, (wi_uinteger_t) _WI_TEST_READWRITE_LOCK_THREADS * (_WI_TEST_READWRITE_LOCK_ITERATIONS / 2), "");
+    WI_TEST_ASSERT_EQUALS(_wi_test_readwrite_lock_counter2, (wi_uinteger_t) _WI_TEST_READWRITE_LOCK_THREADS * (_WI_TEST_READWRITE_LOCK_ITERATIONS / 2), "");
+    
+    wi_release(_wi_test_readwrite_lock_lock);
+    _wi_test_readwrite_lock_lock = NULL;
+#endif
+}
+
+
+
+void wi_test_readwrite_lock_benchmark(void) {
+#ifdef WI_PTHREADS
+    wi_time_interval_t      interval, distributed_interval;
+    wi_uinteger_t           threads, operations;
+    
+    for(threads = 1; threads <= _WI_TEST_READWRITE_LOCK_BENCHMARK_THREADS; threads *= 2) {
+        operations = threads * _WI_TEST_READWRITE_LOCK_BENCHMARK_ITERATIONS;
+        
+        _wi_test_readwrite_lock_lock = wi_readwrite_lock_init(wi_readwrite_lock_alloc());
+        
+        interval = wi_time_interval();
+        _wi_test_readwrite_lock_run_threads(_wi_test_readwrite_lock_benchmark_thread, threads);
+        interval = wi_time_interval() - interval;
+        
+        wi_release(_wi_test_readwrite_lock_lock);
+        
+        _wi_test_readwrite_lock_lock = wi_readwrite_lock_init_with_distributed_readers(wi_readwrite_lock_alloc());
+        
+        distributed_interval = wi_time_interval();
+        _wi_test_readwrite_lock_run_threads(_wi_test_readwrite_lock_benchmark_thread, threads);
+        distributed_interval = wi_time_interval() - distributed_interval;
+        
+        wi_release(_wi_test_readwrite_lock_lock);
+        _wi_test_readwrite_lock_lock = NULL;
+        
+        wi_log_info(WI_STR("%2lu threads: %.2f M read locks/s with pthread_rwlock_t, %.2f M read locks/s with distributed readers"),
+            threads,
+            operations / interval / 1000000.0,
+            operations / distributed_interval / 1000000.0);
+    }
+#endif
+}
+
+
+
+#ifdef WI_PTHREADS
+
+static void _wi_test_readwrite_lock_run_threads(wi_thread_func_t *function, wi_uinteger_t count) {
+    wi_uinteger_t   i;
+    
+    _wi_test_readwrite_lock_finished_lock = wi_condition_lock_init_with_condition(wi_condition_lock_alloc(), 0);
+    _wi_test_readwrite_lock_threads = count;
+    
+    for(i = 0; i < count; i++)
+        WI_TEST_ASSERT_TRUE(wi_thread_create_thread(function, wi_number_with_integer(i)), "");
+    
+    wi_condition_lock_lock_when_condition(_wi_test_readwrite_lock_finished_lock, 1, 0.0);
+    wi_condition_lock_unlock(_wi_test_readwrite_lock_finished_lock);
+    
+    wi_release(_wi_test_readwrite_lock_finished_lock);
+    _wi_test_readwrite_lock_finished_lock = NULL;
+}
+
+
+
+static void _wi_test_readwrite_lock_thread_finished(void) {
+    wi_condition_lock_lock(_wi_test_readwrite_lock_finished_lock);
+    
+    if(--_wi_test_readwrite_lock_threads == 0)
+        wi_condition_lock_unlock_with_condition(_wi_test_readwrite_lock_finished_lock, 1);
+    else
+        wi_condition_lock_unlock(_wi_test_readwrite_lock_finished_lock);
+}
+
+
+
+static void _wi_test_readwrite_lock_contention_thread(wi_runtime_instance_t *argument) {
+    wi_uinteger_t   i;
+    
+    for(i = 0; i < _WI_TEST_READWRITE_LOCK_ITERATIONS; i++) {
+        if(wi_number_integer(argument) == 0) {
+            wi_readwrite_lock_write_lock(_wi_test_readwrite_lock_lock);
+            _wi_test_readwrite_lock_counter1++;
+            _wi_test_readwrite_lock_counter2++;
+            wi_readwrite_lock_unlock(_wi_test_readwrite_lock_lock);
+        } else {
+            wi_readwrite_lock_read_lock(_wi_test_readwrite_lock_lock);
+            
+            if(_wi_test_readwrite_lock_counter1 != _wi_test_readwrite_lock_counter2)
+                _wi_test_readwrite_lock_failed = true;
+            
+            wi_readwrite_lock_unlock(_wi_test_readwrite_lock_lock);
+        }
+    }
+    
+    _wi_test_readwrite_lock_thread_finished();
+}
+
+
+
+static void _wi_test_readwrite_lock_mixed_thread(wi_runtime_instance_t *argument) {
+    wi_uinteger_t   i;
+    
+    /* Every thread alternates, so a writer goes on to read while another
+       thread takes the write lock */
+    for(i = 0; i < _WI_TEST_READWRITE_LOCK_ITERATIONS; i++) {
+        if(i % 2 == 0) {
+            wi_readwrite_lock_write_lock(_wi_test_readwrite_lock_lock);
+            _wi_test_readwrite_lock_counter1++;
+            _wi_test_readwrite_lock_counter2++;
+            wi_readwrite_lock_unlock(_wi_test_readwrite_lock_lock);
+        } else {
+            wi_readwrite_lock_read_lock(_wi_test_readwrite_lock_lock);
+            
+            if(_wi_test_readwrite_lock_counter1 != _wi_test_readwrite_lock_counter2)
+                _wi_test_readwrite_lock_failed = true;
+            
+            wi_readwrite_lock_unlock(_wi_test_readwrite_lock_lock);
+        }
+    }
+    
+    _wi_test_readwrite_lock_thread_finished();
+}
+
+
+
+static void _wi_test_readwrite_lock_benchmark_thread(wi_runtime_instance_t *argument) {
+    wi_uinteger_t   i;
+    
+    for(i = 0; i < _WI_TEST_READWRITE_LOCK_BENCHMARK_ITERATIONS; i++) {
+        wi_readwrite_lock_read_lock(_wi_test_readwrite_lock_lock);
+        wi_readwrite_lock_unlock(_wi_test_readwrite_lock_lock);
+    }
+    
+    _wi_test_readwrite_lock_thread_finished();
+}
+
+#endif
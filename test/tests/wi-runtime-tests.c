@@ -240,6 +240,7 @@ void wi_test_runtime_pool(void) {
 
 void wi_test_runtime_retain(void) {
     _wi_runtimetest_t   *runtimetest, *runtimetest2;
+    wi_uinteger_t       i;
     
     _wi_runtimetest_deallocs = 0;
 
@@ -256,6 +257,17 @@ void wi_test_runtime_retain(void) {
     
     WI_TEST_ASSERT_EQUALS(wi_retain_count(runtimetest), 1U, "");
     
+    for(i = 0; i < 70000; i++)
+        wi_retain(runtimetest);
+    
+    WI_TEST_ASSERT_EQUALS(wi_retain_count(runtimetest), 70001U, "");
+    
+    for(i = 0; i < 70000; i++)
+        wi_release(runtimetest);
+    
+    WI_TEST_ASSERT_EQUALS(wi_retain_count(runtimetest), 1U, "");
+    WI_TEST_ASSERT_EQUALS(_wi_runtimetest_deallocs, 0U, "");
+    
     wi_release(runtimetest);
     
     WI_TEST_ASSERT_EQUALS(_wi_runtimetest_deallocs, 1U, "");
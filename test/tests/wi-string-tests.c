@@ -28,11 +28,15 @@
 #include <string.h>
 #include "test.h"
 
+#define _WI_TEST_STRING_FORMAT_BENCHMARK_COUNT  200000
+
 WI_TEST_EXPORT void                     wi_test_string_creation(void);
 WI_TEST_EXPORT void                     wi_test_string_runtime_functions(void);
 WI_TEST_EXPORT void                     wi_test_string_comparison(void);
 WI_TEST_EXPORT void                     wi_test_string_constant(void);
 WI_TEST_EXPORT void                     wi_test_string_formatting(void);
+WI_TEST_EXPORT void                     wi_test_string_format_conversions(void);
+WI_BENCHMARK_EXPORT void                wi_test_string_format_benchmark(void);
 WI_TEST_EXPORT void                     wi_test_string_accessors(void);
 WI_TEST_EXPORT void                     wi_test_string_appending(void);
 WI_TEST_EXPORT void                     wi_test_string_inserting(void);
@@ -205,6 +209,73 @@ void wi_test_string_formatting(void) {
 
 
 
+void wi_test_string_format_conversions(void) {
+    static const double     doubles[] = { 0.0, -0.0, 0.5, 1.5, 2.5, 0.125, 0.0005, -3.14159265358979, 1e-300, 123456789.987654321, 1e15, 5e-324 };
+    static const long long  integers[] = { 0, 1, -1, 9, 10, 99, 100, -12345, 4294967295LL, -9223372036854775807LL - 1, 9223372036854775807LL };
+    char                    buffer[512];
+    wi_uinteger_t           i;
+    
+    for(i = 0; i < WI_ARRAY_SIZE(integers); i++) {
+        snprintf(buffer, sizeof(buffer), "%lld|%5lld|%-5lld|%05lld|%.3lld|%+lld|%llu|%llx|%08llX|%llo|%#llx|%d|%hhd|%hu",
+            integers[i], integers[i], integers[i], integers[i], integers[i], integers[i], integers[i], integers[i],
+            integers[i], integers[i], integers[i], (int) integers[i], (int) integers[i], (int) integers[i]);
+        
+        WI_TEST_ASSERT_EQUAL_INSTANCES(
+            wi_string_with_format(WI_STR("%lld|%5lld|%-5lld|%05lld|%.3lld|%+lld|%llu|%llx|%08llX|%llo|%#llx|%d|%hhd|%hu"),
+                integers[i], integers[i], integers[i], integers[i], integers[i], integers[i], integers[i], integers[i],
+                integers[i], integers[i], integers[i], (int) integers[i], (int) integers[i], (int) integers[i]),
+            wi_string_with_utf8_string(buffer), "");
+    }
+    
+    for(i = 0; i < WI_ARRAY_SIZE(doubles); i++) {
+        snprintf(buffer, sizeof(buffer), "%f|%.0f|%.2f|%.17f|%10.3f|%-10.1f|%010.2f|%+.1f|%e|%g",
+            doubles[i], doubles[i], doubles[i], doubles[i], doubles[i], doubles[i], doubles[i], doubles[i], doubles[i], doubles[i]);
+        
+        WI_TEST_ASSERT_EQUAL_INSTANCES(
+            wi_string_with_format(WI_STR("%f|%.0f|%.2f|%.17f|%10.3f|%-10.1f|%010.2f|%+.1f|%e|%g"),
+                doubles[i], doubles[i], doubles[i], doubles[i], doubles[i], doubles[i], doubles[i], doubles[i], doubles[i], doubles[i]),
+            wi_string_with_utf8_string(buffer), "");
+    }
+    
+    snprintf(buffer, sizeof(buffer), "%f", 1e300);
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_string_with_format(WI_STR("%f"), 1e300), wi_string_with_utf8_string(buffer), "");
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_string_with_format(WI_STR("'%-*d' '%*d' '%.*s' '%5.2s' '%-3c' '%%' '%p'"), -4, 7, 4, 7, 2, "hello", "hello", 'x', (void *) 0xfeed),
+                                   WI_STR("'7   ' '   7' 'he' '   he' 'x  ' '%' '0xfeed'"), "");
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_string_with_format(wi_string_with_utf8_string("%@ %lu %s"), WI_STR("hello"), 42UL, "world"),
+                                   WI_STR("hello 42 world"), "");
+}
+
+
+
+void wi_test_string_format_benchmark(void) {
+    wi_string_t             *string = NULL;
+    wi_time_interval_t      interval;
+    wi_uinteger_t           i;
+    
+    interval = wi_time_interval();
+    
+    for(i = 0; i < _WI_TEST_STRING_FORMAT_BENCHMARK_COUNT; i++) {
+        wi_release(string);
+        
+        string = wi_string_init_with_format(wi_string_alloc(), WI_STR("%@ %lu files, %d dirs, %.2f%% done at %s"),
+            WI_STR("transfer"), (unsigned long) i, (int) i, (double) i / 3.0, "/usr/local");
+    }
+    
+    interval = wi_time_interval() - interval;
+    
+    WI_TEST_ASSERT_EQUAL_INSTANCES(string, WI_STR("transfer 199999 files, 199999 dirs, 66666.33% done at /usr/local"), "");
+    
+    wi_log_info(WI_STR("Formatted %u strings at %.0f ns per string"),
+        _WI_TEST_STRING_FORMAT_BENCHMARK_COUNT, (interval * 1000000000.0) / _WI_TEST_STRING_FORMAT_BENCHMARK_COUNT);
+    
+    wi_release(string);
+}
+
+
+
 void wi_test_string_accessors(void) {
     wi_string_t     *string;
     
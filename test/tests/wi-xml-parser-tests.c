@@ -29,6 +29,8 @@
 
 WI_TEST_EXPORT void                     wi_test_xml_parser_success(void);
 WI_TEST_EXPORT void                     wi_test_xml_parser_failure(void);
+WI_TEST_EXPORT void                     wi_test_xml_parser_lazy_nodes(void);
+WI_TEST_EXPORT void                     wi_test_xml_parser_xpath(void);
 
 
 void wi_test_xml_parser_success(void) {
@@ -252,3 +254,88 @@ void wi_test_xml_parser_failure(void) {
     WI_TEST_ASSERT_NULL(node, "");
 #endif
 }
+
+
+
+void wi_test_xml_parser_lazy_nodes(void) {
+#ifdef WI_XML
+    wi_pool_t               *pool;
+    wi_mutable_string_t     *string;
+    wi_dictionary_t         *attributes;
+    wi_xml_node_t           *node, *child_node;
+    wi_uinteger_t           i;
+    
+    pool = wi_pool_init(wi_pool_alloc());
+    node = wi_xml_parser_read_node_from_path(wi_string_by_appending_path_component(wi_test_fixture_path, WI_STR("wi-xml-parser-tests-1.xml")));
+    
+    WI_TEST_ASSERT_NOT_NULL(node, "");
+    WI_TEST_ASSERT_EQUALS(wi_xml_node_number_of_children(node), 4U, "");
+    WI_TEST_ASSERT_TRUE(wi_xml_node_element(wi_xml_node_child_at_index(node, 0)) == wi_xml_node_element(wi_xml_node_child_at_index(node, 1)), "");
+    
+    child_node = wi_retain(wi_xml_node_child_at_index(wi_xml_node_child_at_index(node, 0), 0));
+    
+    wi_release(pool);
+    
+    /* The document stays alive as long as any of its nodes does */
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_xml_node_element(child_node), WI_STR("Name"), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_xml_node_text(child_node), WI_STR("Ellen Adams"), "");
+    
+    wi_release(child_node);
+    
+    /* Every sibling shares the one interned element name of the document */
+    string = wi_mutable_string_with_format(WI_STR("<list>"));
+    
+    for(i = 0; i < 1000; i++)
+        wi_mutable_string_append_string(string, WI_STR("<item id=\"x\"/>"));
+    
+    wi_mutable_string_append_string(string, WI_STR("</list>"));
+    
+    node = wi_xml_parser_node_from_data(wi_string_utf8_data(string));
+    attributes = wi_dictionary_with_data_and_keys(WI_STR("x"), WI_STR("id"), NULL);
+    
+    WI_TEST_ASSERT_NOT_NULL(node, "");
+    WI_TEST_ASSERT_EQUALS(wi_xml_node_number_of_children(node), 1000U, "");
+    
+    for(i = 0; i < 1000; i++) {
+        child_node = wi_xml_node_child_at_index(node, i);
+        
+        WI_TEST_ASSERT_EQUAL_INSTANCES(wi_xml_node_element(child_node), WI_STR("item"), "");
+        WI_TEST_ASSERT_TRUE(wi_xml_node_element(child_node) == wi_xml_node_element(wi_xml_node_child_at_index(node, 0)), "");
+        WI_TEST_ASSERT_EQUAL_INSTANCES(wi_xml_node_attributes(child_node), attributes, "");
+    }
+#endif
+}
+
+
+
+void wi_test_xml_parser_xpath(void) {
+#ifdef WI_XML
+    wi_xml_node_t   *node;
+    wi_array_t      *nodes;
+    
+    node = wi_xml_parser_read_node_from_path(wi_string_by_appending_path_component(wi_test_fixture_path, WI_STR("wi-xml-parser-tests-1.xml")));
+    
+    WI_TEST_ASSERT_NOT_NULL(node, "");
+    
+    nodes = wi_xml_node_nodes_for_xpath(node, WI_STR("/PurchaseOrder/Address/City"));
+    
+    WI_TEST_ASSERT_EQUALS(wi_array_count(nodes), 2U, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_xml_node_text(WI_ARRAY(nodes, 0)), WI_STR("Mill Valley"), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_xml_node_text(WI_ARRAY(nodes, 1)), WI_STR("Old Town"), "");
+    
+    nodes = wi_xml_node_nodes_for_xpath(wi_xml_node_child_at_index(node, 3), WI_STR("Item[ShipDate]"));
+    
+    WI_TEST_ASSERT_EQUALS(wi_array_count(nodes), 1U, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_xml_node_attributes(WI_ARRAY(nodes, 0)),
+                                   wi_dictionary_with_data_and_keys(WI_STR("926-AA"), WI_STR("PartNumber"), NULL),
+                                   "");
+    
+    WI_TEST_ASSERT_EQUALS(wi_array_count(wi_xml_node_nodes_for_xpath(node, WI_STR("//Item/@PartNumber"))), 0U, "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_xml_node_string_for_xpath(node, WI_STR("//Item[2]/@PartNumber")), WI_STR("926-AA"), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_xml_node_string_for_xpath(node, WI_STR("count(//Item)")), WI_STR("2"), "");
+    WI_TEST_ASSERT_EQUAL_INSTANCES(wi_xml_node_string_for_xpath(node, WI_STR("Address[@Type='Billing']/Zip")), WI_STR("95819"), "");
+    
+    WI_TEST_ASSERT_NULL(wi_xml_node_nodes_for_xpath(node, WI_STR("//Item[")), "");
+    WI_TEST_ASSERT_NULL(wi_xml_node_string_for_xpath(node, WI_STR("//Item[")), "");
+#endif
+}